@@ -0,0 +1,43 @@
+#include <stdio.h>
+
+#include "hype_pub_sub/hpb_sim_scenario.h"
+
+int main(int argc, char *argv[])
+{
+    // The seed and the scenario are taken from the command line, so that a run can be repeated and bisected
+    uint64_t seed = (argc > 1) ? strtoull(argv[1], NULL, 10) : 1;
+    const char *only = (argc > 2) ? argv[2] : NULL;
+    HpbSimLink link = {5000, 2000, 250000, 0.01}; // 5 ms + up to 2 ms, 2 Mbit/s and 1% loss on every link
+
+    HpbSimScenario scenarios[] = {
+        // name, link, seed, nodes, topics, subscriptions, publish interval, storms, joins, leaves, storm duration, storm interval
+        {"steady", link, seed, 100, 50, 3, 20000, 0, 0, 0, 0, 30000000},
+        {"join-storm", link, seed, 100, 50, 3, 20000, 3, 20, 0, 1000000, 20000000},
+        {"leave-storm", link, seed, 100, 50, 3, 20000, 3, 0, 20, 1000000, 20000000},
+        {"flash-crowd", link, seed, 50, 50, 3, 20000, 1, 100, 0, 0, 30000000},
+        {"rolling-churn", link, seed, 100, 50, 3, 20000, 5, 5, 5, 10000000, 20000000}
+    };
+
+    // The reports go to stdout, which is the same for the same seed, and the CPU times to stderr
+    for(size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+    {
+        if(only != NULL && strcmp(only, scenarios[i].name) != 0) {
+            continue;
+        }
+
+        HpbSimReport report;
+        if(hpb_sim_scenario_run(&(scenarios[i]), &report) != 0)
+        {
+            fprintf(stderr, "scenario %s could not run\n", scenarios[i].name);
+            return 1;
+        }
+
+        hpb_sim_scenario_print_report(stdout, &(scenarios[i]), &report);
+        fflush(stdout);
+        uint64_t n_changes = report.n_joins + report.n_leaves;
+        fprintf(stderr, "  cpu: storms %.1f ms (%.2f ms per membership event), quiet %.1f ms\n", report.storm_cpu_ms,
+                (n_changes > 0) ? report.storm_cpu_ms / n_changes : 0.0, report.quiet_cpu_ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include <stdio.h>
+
+#include "hype_pub_sub/hpb_sim.h"
+
+#define HPB_BENCH_N_NODES 40
+#define HPB_BENCH_SETTLE_US (10 * 1000000) // Virtual time given to the mesh to settle after each change
+#define HPB_BENCH_N_PUBLISHES 600
+#define HPB_BENCH_PUBLISH_INTERVAL_US 50000 // The publishes last past the refreshes of the subscriber list
+#define HPB_BENCH_SERVICE_NAME "direct-topic"
+
+/**
+ * @brief Latency from the publish to the delivery of a message to a subscriber, and the messages sent by the mesh
+ *        while the messages are published.
+ */
+typedef struct HpbDirectResult_
+{
+    double p50; /**< Median latency in milliseconds. */
+    double p99; /**< 99th percentile of the latency in milliseconds. */
+    double delivery; /**< Ratio of the messages delivered to the messages expected by the subscribers. */
+    double msgs_per_publish; /**< Messages sent by the mesh per message published, including the control messages. */
+    uint64_t list_msgs; /**< Subscriber list requests, pushes and replies sent by the mesh. */
+} HpbDirectResult;
+
+static double *latencies = NULL;
+static size_t n_latencies = 0;
+static size_t max_latencies = 0;
+
+static HpbDirectResult hpb_bench_run(size_t n_subscribers, bool is_direct, HpbSimLink link);
+static void hpb_bench_on_message_received(char *service_name, char *msg, size_t msg_length);
+static int hpb_bench_compare(const void *latency1, const void *latency2);
+
+int main(int argc, char *argv[])
+{
+    size_t n_subscribers[] = {1, 8, HPB_DIRECT_MAX_SUBSCRIBERS - 1}; // The joining subscriber stays within the subscribers published directly
+    HpbSimLink link = {5000, 3000, 250000, 0.0}; // 5 ms + up to 3 ms and 2 Mbit/s on every link
+
+    printf("Link: %.1f ms + up to %.1f ms, %llu B/s; %d nodes, %d publishes every %d ms, a subscriber joins and leaves "
+           "during them\n\n", link.latency_us / 1000.0, link.jitter_us / 1000.0, (unsigned long long) link.bandwidth,
+           HPB_BENCH_N_NODES, HPB_BENCH_N_PUBLISHES, HPB_BENCH_PUBLISH_INTERVAL_US / 1000);
+
+    printf("%-12s %-8s %10s %10s %9s %10s %10s\n", "subscribers", "path", "p50 (ms)", "p99 (ms)", "delivery", "msgs/pub", "list msgs");
+    for(size_t i = 0; i < sizeof(n_subscribers) / sizeof(n_subscribers[0]); i++)
+    {
+        HpbDirectResult two_hops = hpb_bench_run(n_subscribers[i], false, link);
+        HpbDirectResult one_hop = hpb_bench_run(n_subscribers[i], true, link);
+        printf("%-12zu %-8s %10.2f %10.2f %9.3f %10.2f %10llu\n", n_subscribers[i], "manager", two_hops.p50, two_hops.p99,
+               two_hops.delivery, two_hops.msgs_per_publish, (unsigned long long) two_hops.list_msgs);
+        printf("%-12zu %-8s %10.2f %10.2f %9.3f %10.2f %10llu\n", n_subscribers[i], "direct", one_hop.p50, one_hop.p99,
+               one_hop.delivery, one_hop.msgs_per_publish, (unsigned long long) one_hop.list_msgs);
+    }
+
+    return 0;
+}
+
+static HpbDirectResult hpb_bench_run(size_t n_subscribers, bool is_direct, HpbSimLink link)
+{
+    HpbDirectResult result;
+    HpbSim *sim = hpb_sim_create(link, 1);
+    for(size_t i = 0; i < HPB_BENCH_N_NODES; i++) {
+        hpb_sim_add_node(sim, 1);
+    }
+    hpb_sim_run(sim, HPB_BENCH_SETTLE_US);
+
+    // The publisher and the subscribers are other nodes than the manager, so that the messages go through it
+    HLByte service_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) HPB_BENCH_SERVICE_NAME, strlen(HPB_BENCH_SERVICE_NAME), service_key);
+    hpb_sim_select_node(sim, 0);
+    size_t manager = hpb_sim_get_node_index(hpb_network_get_service_manager_id(hpb_get()->network, service_key));
+    size_t nodes[HPB_DIRECT_MAX_SUBSCRIBERS + 2] = {0};
+    size_t n_nodes = 0;
+    for(size_t i = 0; i < HPB_BENCH_N_NODES && n_nodes < n_subscribers + 2; i++)
+    {
+        if(i != manager) {
+            nodes[n_nodes++] = i;
+        }
+    }
+    size_t publisher = nodes[0];
+    size_t joining_subscriber = nodes[n_subscribers + 1];
+
+    for(size_t i = 1; i <= n_subscribers + 1; i++)
+    {
+        hpb_sim_select_node(sim, nodes[i]);
+        hpb_set_message_received_callback(hpb_bench_on_message_received);
+        if(i <= n_subscribers) {
+            hpb_issue_subscribe_req(HPB_BENCH_SERVICE_NAME);
+        }
+    }
+    hpb_sim_select_node(sim, publisher);
+    if(is_direct) {
+        hpb_set_direct_publish(HPB_BENCH_SERVICE_NAME, true);
+    }
+    hpb_sim_run(sim, HPB_BENCH_SETTLE_US);
+
+    // The messages carry the virtual time at which they were published
+    max_latencies = HPB_BENCH_N_PUBLISHES * (n_subscribers + 1);
+    latencies = (double *) malloc(max_latencies * sizeof(double));
+    n_latencies = 0;
+    size_t n_expected = 0;
+    uint64_t n_sent = sim->n_sent;
+    uint64_t n_list_sent = sim->n_sent_by_type[SUBSCRIBER_LIST];
+    for(int i = 0; i < HPB_BENCH_N_PUBLISHES; i++)
+    {
+        // The subscriber which joins and leaves makes the manager push the subscribers to the direct publisher
+        if(i == HPB_BENCH_N_PUBLISHES / 3 || i == 2 * HPB_BENCH_N_PUBLISHES / 3)
+        {
+            hpb_sim_select_node(sim, joining_subscriber);
+            if(i == HPB_BENCH_N_PUBLISHES / 3) {
+                hpb_issue_subscribe_req(HPB_BENCH_SERVICE_NAME);
+            }
+            else {
+                hpb_issue_unsubscribe_req(HPB_BENCH_SERVICE_NAME);
+            }
+        }
+
+        char msg[32];
+        int msg_length = snprintf(msg, sizeof(msg), "%llu", (unsigned long long) hpb_clock_now_us());
+        hpb_sim_select_node(sim, publisher);
+        hpb_issue_publish_req(HPB_BENCH_SERVICE_NAME, msg, msg_length + 1);
+        n_expected += n_subscribers + ((i >= HPB_BENCH_N_PUBLISHES / 3 && i < 2 * HPB_BENCH_N_PUBLISHES / 3) ? 1 : 0);
+        hpb_sim_run(sim, HPB_BENCH_PUBLISH_INTERVAL_US);
+    }
+    hpb_sim_run(sim, 1000000);
+    result.msgs_per_publish = (double) (sim->n_sent - n_sent) / HPB_BENCH_N_PUBLISHES;
+    result.list_msgs = sim->n_sent_by_type[SUBSCRIBER_LIST] - n_list_sent;
+
+    qsort(latencies, n_latencies, sizeof(double), hpb_bench_compare);
+    result.p50 = (n_latencies > 0) ? latencies[n_latencies / 2] : 0;
+    result.p99 = (n_latencies > 0) ? latencies[(n_latencies * 99) / 100] : 0;
+    result.delivery = (double) n_latencies / n_expected;
+    free(latencies);
+    latencies = NULL;
+
+    hpb_sim_destroy(&sim);
+    return result;
+}
+
+static void hpb_bench_on_message_received(char *service_name, char *msg, size_t msg_length)
+{
+    if(latencies == NULL) {
+        return;
+    }
+
+    // The retries may deliver a message more than once
+    if(n_latencies == max_latencies)
+    {
+        max_latencies *= 2;
+        latencies = (double *) realloc(latencies, max_latencies * sizeof(double));
+    }
+
+    uint64_t published_us = strtoull(msg, NULL, 10);
+    latencies[n_latencies++] = (double) (hpb_clock_now_us() - published_us) / 1000;
+}
+
+static int hpb_bench_compare(const void *latency1, const void *latency2)
+{
+    double l1 = *((const double *) latency1);
+    double l2 = *((const double *) latency2);
+    return (l1 > l2) - (l1 < l2);
+}
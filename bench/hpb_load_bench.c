@@ -0,0 +1,117 @@
+#include <stdio.h>
+
+#include "hype_pub_sub/hpb_sim.h"
+#include "hype_pub_sub/hpb_load.h"
+
+#define HPB_BENCH_N_NODES 20
+#define HPB_BENCH_N_SINKS 5 // Nodes 1 to HPB_BENCH_N_SINKS subscribe the load published by node 0
+#define HPB_BENCH_N_TOPICS 8
+#define HPB_BENCH_MSG_SIZE 256
+#define HPB_BENCH_DURATION_US (5 * 1000000)
+#define HPB_BENCH_SETTLE_US (10 * 1000000)
+#define HPB_BENCH_TICK_US 1000
+
+static HpbSim *sim = NULL;
+static HpbLoadSink *sinks[HPB_BENCH_N_SINKS];
+
+static void hpb_bench_run(double rate, HpbSimLink link);
+static void hpb_bench_on_message_received(char *service_name, char *msg, size_t msg_length);
+
+int main(int argc, char *argv[])
+{
+    // The default rates go past the bandwidth of the links, where the queues build up
+    double default_rates[] = {500, 2000, 4000, 8000};
+    double *rates = default_rates;
+    size_t n_rates = sizeof(default_rates) / sizeof(default_rates[0]);
+    if(argc > 1)
+    {
+        rates = (double *) malloc((argc - 1) * sizeof(double));
+        n_rates = argc - 1;
+        for(int i = 1; i < argc; i++) {
+            rates[i - 1] = strtod(argv[i], NULL);
+        }
+    }
+
+    HpbSimLink link = {2000, 1000, 1250000, 0.001}; // 2 ms + up to 1 ms, 10 Mbit/s and 0.1% loss on every link
+
+    printf("Link: %.1f ms + up to %.1f ms, %llu B/s, %.1f%% loss; %d nodes, %d sinks, %d topics, %d B messages, %d s\n\n",
+           link.latency_us / 1000.0, link.jitter_us / 1000.0, (unsigned long long) link.bandwidth, 100 * link.loss,
+           HPB_BENCH_N_NODES, HPB_BENCH_N_SINKS, HPB_BENCH_N_TOPICS, HPB_BENCH_MSG_SIZE, HPB_BENCH_DURATION_US / 1000000);
+
+    printf("%-8s %10s %8s %10s %10s %10s %10s %12s\n", "msg/s", "recv msg/s", "loss", "p50 (ms)", "p99 (ms)",
+           "p99.9 (ms)", "max (ms)", "raw p99 (ms)");
+    for(size_t i = 0; i < n_rates; i++) {
+        hpb_bench_run(rates[i], link);
+    }
+
+    if(rates != default_rates) {
+        free(rates);
+    }
+
+    return 0;
+}
+
+static void hpb_bench_run(double rate, HpbSimLink link)
+{
+    sim = hpb_sim_create(link, 1);
+
+    for(int i = 0; i < HPB_BENCH_N_NODES; i++) {
+        hpb_sim_add_node(sim, 1);
+    }
+    hpb_sim_run(sim, HPB_BENCH_SETTLE_US);
+
+    for(size_t i = 0; i < HPB_BENCH_N_SINKS; i++)
+    {
+        sinks[i] = hpb_load_sink_create(HPB_BENCH_N_TOPICS);
+        hpb_sim_select_node(sim, i + 1);
+        hpb_set_message_received_callback(hpb_bench_on_message_received);
+        hpb_load_sink_subscribe(sinks[i]);
+    }
+    hpb_sim_run(sim, HPB_BENCH_SETTLE_US);
+
+    // The generator is ticked as often as by the event loop of the executable
+    hpb_sim_select_node(sim, 0);
+    HpbLoadGenerator *generator = hpb_load_generator_create(1, rate, HPB_BENCH_N_TOPICS, HPB_BENCH_DURATION_US, HPB_BENCH_MSG_SIZE);
+    while(!hpb_load_generator_is_done(generator))
+    {
+        hpb_sim_run(sim, HPB_BENCH_TICK_US);
+        hpb_sim_select_node(sim, 0);
+        hpb_load_generator_tick(generator);
+    }
+    hpb_sim_run(sim, HPB_BENCH_SETTLE_US);
+
+    // The sinks are merged, and the loss counts the messages published which each sink did not receive
+    HpbHistogram *latency = hpb_histogram_create(HPB_LOAD_HISTOGRAM_HIGHEST_US, HPB_LOAD_HISTOGRAM_FIGURES);
+    HpbHistogram *uncorrected_latency = hpb_histogram_create(HPB_LOAD_HISTOGRAM_HIGHEST_US, HPB_LOAD_HISTOGRAM_FIGURES);
+    uint64_t n_received = 0;
+    double received_rate = 0.0;
+    for(size_t i = 0; i < HPB_BENCH_N_SINKS; i++)
+    {
+        hpb_histogram_add(latency, sinks[i]->latency);
+        hpb_histogram_add(uncorrected_latency, sinks[i]->uncorrected_latency);
+        n_received += sinks[i]->n_received;
+        if(sinks[i]->last_us > sinks[i]->first_us) {
+            received_rate += sinks[i]->n_received * 1000000.0 / (sinks[i]->last_us - sinks[i]->first_us) / HPB_BENCH_N_SINKS;
+        }
+        hpb_load_sink_destroy(&sinks[i]);
+    }
+
+    uint64_t n_expected = generator->n_sent * HPB_BENCH_N_SINKS;
+    printf("%-8.0f %10.1f %7.2f%% %10.2f %10.2f %10.2f %10.2f %12.2f\n", rate, received_rate,
+           (n_expected > 0) ? 100.0 * (n_expected - n_received) / n_expected : 0.0,
+           hpb_histogram_get_value_at_percentile(latency, 50.0) / 1000.0,
+           hpb_histogram_get_value_at_percentile(latency, 99.0) / 1000.0,
+           hpb_histogram_get_value_at_percentile(latency, 99.9) / 1000.0,
+           hpb_histogram_get_value_at_percentile(latency, 100.0) / 1000.0,
+           hpb_histogram_get_value_at_percentile(uncorrected_latency, 99.0) / 1000.0);
+
+    hpb_histogram_destroy(&latency);
+    hpb_histogram_destroy(&uncorrected_latency);
+    hpb_load_generator_destroy(&generator);
+    hpb_sim_destroy(&sim);
+}
+
+static void hpb_bench_on_message_received(char *service_name, char *msg, size_t msg_length)
+{
+    hpb_load_sink_receive(sinks[sim->current - 1], msg, msg_length);
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "hype_pub_sub/hpb_network.h"
+
+#define HPB_BENCH_N_TOPICS 10000
+#define HPB_BENCH_ID_SIZE 12
+
+/**
+ * @brief Topics per device of a placement, over a simulated network.
+ */
+typedef struct HpbPlacementResult_
+{
+    double mean; /**< Mean number of topics per device. */
+    double stddev; /**< Standard deviation of the number of topics per device. */
+    size_t max; /**< Maximum number of topics of a device. */
+    double skew; /**< Load skew reported by the network. */
+} HpbPlacementResult;
+
+static HypeInstance *hpb_bench_create_instance(uint32_t index);
+static HpbPlacementResult hpb_bench_run(size_t n_devices, HpbPlacement placement);
+static void hpb_bench_print(const char *name, HpbPlacementResult result);
+
+int main(int argc, char *argv[])
+{
+    size_t n_devices[] = {5, 20, 100};
+
+    printf("%-8s %-7s %10s %10s %8s %9s %6s\n", "devices", "mode", "mean", "stddev", "cv", "max/mean", "skew");
+    for(size_t i = 0; i < sizeof(n_devices) / sizeof(n_devices[0]); i++)
+    {
+        printf("%-8zu ", n_devices[i]);
+        hpb_bench_print("xor", hpb_bench_run(n_devices[i], HPB_PLACEMENT_XOR));
+        printf("%-8zu ", n_devices[i]);
+        hpb_bench_print("vnodes", hpb_bench_run(n_devices[i], HPB_PLACEMENT_VNODES));
+    }
+
+    return 0;
+}
+
+static HypeInstance *hpb_bench_create_instance(uint32_t index)
+{
+    HLByte id[HPB_BENCH_ID_SIZE] = {0};
+    binary_utils_write_uint32(id, index);
+
+    HypeBuffer *identifier = hype_buffer_create_from(id, HPB_BENCH_ID_SIZE);
+    HypeInstance *instance = hype_instance_create(identifier, NULL, true);
+    hype_buffer_release(identifier);
+    return instance;
+}
+
+static HpbPlacementResult hpb_bench_run(size_t n_devices, HpbPlacement placement)
+{
+    HypeInstance *own_instance = hpb_bench_create_instance(0);
+    HpbNetwork *net = hpb_network_create(own_instance);
+    hype_instance_release(own_instance);
+
+    HypeInstance **instances = (HypeInstance **) calloc(n_devices, sizeof(HypeInstance *));
+    instances[0] = net->own_client->hype_instance;
+    for(size_t i = 1; i < n_devices; i++)
+    {
+        HypeInstance *instance = hpb_bench_create_instance((uint32_t) i);
+        instances[i] = hpb_network_add_client(net, instance)->hype_instance;
+        hype_instance_release(instance);
+    }
+    hpb_network_set_placement(net, placement);
+
+    size_t *n_topics = (size_t *) calloc(n_devices, sizeof(size_t));
+    char topic[32];
+    HLByte service_key[SHA1_BLOCK_SIZE];
+    for(int i = 0; i < HPB_BENCH_N_TOPICS; i++)
+    {
+        int topic_length = snprintf(topic, sizeof(topic), "topic-%d", i);
+        sha1_digest((const BYTE *) topic, (size_t) topic_length, service_key);
+
+        HypeInstance *manager = hpb_network_get_service_manager_id(net, service_key);
+        for(size_t j = 0; j < n_devices; j++)
+        {
+            if(instances[j] == manager)
+            {
+                n_topics[j]++;
+                break;
+            }
+        }
+    }
+
+    HpbPlacementResult result = {0};
+    result.mean = (double) HPB_BENCH_N_TOPICS / n_devices;
+    for(size_t i = 0; i < n_devices; i++)
+    {
+        result.stddev += (n_topics[i] - result.mean) * (n_topics[i] - result.mean);
+        result.max = (n_topics[i] > result.max) ? n_topics[i] : result.max;
+    }
+    result.stddev = sqrt(result.stddev / n_devices);
+    result.skew = hpb_network_get_load_skew(net, NULL, 0);
+
+    free(n_topics);
+    free(instances);
+    hpb_network_destroy(&net);
+    return result;
+}
+
+static void hpb_bench_print(const char *name, HpbPlacementResult result)
+{
+    printf("%-7s %10.1f %10.1f %8.3f %9.2f %6.2f\n", name, result.mean, result.stddev, result.stddev / result.mean,
+           result.max / result.mean, result.skew);
+}
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <time.h>
+#include <malloc.h>
+
+#include "hype_pub_sub/hpb_sim.h"
+
+#define HPB_BENCH_SETTLE_US (10 * 1000000) // Virtual time given to the mesh to settle after each change
+#define HPB_BENCH_N_PUBLISHES 200
+#define HPB_BENCH_SUBSCRIBERS_PER_TOPIC 10
+
+/**
+ * @brief Measurements of a simulated mesh of a given size.
+ */
+typedef struct HpbSimResult_
+{
+    double node_kb; /**< Heap used per node once the mesh settled, in KB. */
+    double settle_s; /**< CPU time taken to settle the mesh, in seconds. */
+    uint64_t rebalance_msgs; /**< Messages sent by the mesh when a node joins. */
+    uint64_t rebalance_kb; /**< KB sent by the mesh when a node joins. */
+    double rebalance_ms; /**< CPU time taken by the mesh to settle after a node joins, in milliseconds. */
+    double p50; /**< Median latency from the publish to the delivery of a message, in milliseconds. */
+    double p99; /**< 99th percentile of the latency, in milliseconds. */
+    double delivery; /**< Ratio of the messages delivered to the messages expected by the subscribers. */
+} HpbSimResult;
+
+static double *latencies = NULL;
+static size_t n_latencies = 0;
+static size_t max_latencies = 0;
+
+static HpbSimResult hpb_bench_run(size_t n_nodes, HpbSimLink link);
+static double hpb_bench_cpu_ms();
+static void hpb_bench_on_message_received(char *service_name, char *msg, size_t msg_length);
+static int hpb_bench_compare(const void *latency1, const void *latency2);
+
+int main(int argc, char *argv[])
+{
+    // The settling of the mesh grows with the cube of the nodes, so the larger meshes are given on the command line
+    size_t default_n_nodes[] = {100, 250, 500};
+    size_t *n_nodes = default_n_nodes;
+    size_t n_sizes = sizeof(default_n_nodes) / sizeof(default_n_nodes[0]);
+    if(argc > 1)
+    {
+        n_nodes = (size_t *) malloc((argc - 1) * sizeof(size_t));
+        n_sizes = argc - 1;
+        for(int i = 1; i < argc; i++) {
+            n_nodes[i - 1] = strtoul(argv[i], NULL, 10);
+        }
+    }
+
+    HpbSimLink link = {5000, 2000, 250000, 0.01}; // 5 ms + up to 2 ms, 2 Mbit/s and 1% loss on every link
+
+    printf("Link: %.1f ms + up to %.1f ms, %llu B/s, %.1f%% loss; %d subscribers per topic\n\n", link.latency_us / 1000.0,
+           link.jitter_us / 1000.0, (unsigned long long) link.bandwidth, 100 * link.loss, HPB_BENCH_SUBSCRIBERS_PER_TOPIC);
+
+    printf("%-6s %9s %10s %10s %10s %12s %9s %9s %9s\n", "nodes", "KB/node", "settle (s)", "join msgs", "join KB",
+           "join cpu(ms)", "p50 (ms)", "p99 (ms)", "delivery");
+    for(size_t i = 0; i < n_sizes; i++)
+    {
+        HpbSimResult result = hpb_bench_run(n_nodes[i], link);
+        printf("%-6zu %9.1f %10.2f %10llu %10llu %12.1f %9.2f %9.2f %9.3f\n", n_nodes[i], result.node_kb, result.settle_s,
+               (unsigned long long) result.rebalance_msgs, (unsigned long long) result.rebalance_kb, result.rebalance_ms,
+               result.p50, result.p99, result.delivery);
+    }
+
+    if(n_nodes != default_n_nodes) {
+        free(n_nodes);
+    }
+
+    return 0;
+}
+
+static HpbSimResult hpb_bench_run(size_t n_nodes, HpbSimLink link)
+{
+    HpbSimResult result;
+    size_t n_topics = (n_nodes > HPB_BENCH_SUBSCRIBERS_PER_TOPIC) ? n_nodes / HPB_BENCH_SUBSCRIBERS_PER_TOPIC : 1;
+    char service_name[32];
+
+    // The heap of the nodes is measured once they resolved each other and subscribed
+    size_t heap_before = mallinfo2().uordblks;
+    double cpu_start_ms = hpb_bench_cpu_ms();
+    HpbSim *sim = hpb_sim_create(link, 1);
+    for(size_t i = 0; i < n_nodes; i++) {
+        hpb_sim_add_node(sim, 1);
+    }
+    hpb_sim_run(sim, HPB_BENCH_SETTLE_US);
+
+    for(size_t i = 0; i < n_nodes; i++)
+    {
+        hpb_sim_select_node(sim, i);
+        hpb_set_message_received_callback(hpb_bench_on_message_received);
+        snprintf(service_name, sizeof(service_name), "topic-%zu", i % n_topics);
+        hpb_issue_subscribe_req(service_name);
+    }
+    hpb_sim_run(sim, HPB_BENCH_SETTLE_US);
+    result.settle_s = (hpb_bench_cpu_ms() - cpu_start_ms) / 1000;
+    result.node_kb = (double) (mallinfo2().uordblks - heap_before) / n_nodes / 1024;
+
+    // The services are rebalanced over the new node
+    uint64_t n_sent = sim->n_sent;
+    uint64_t bytes_sent = sim->bytes_sent;
+    cpu_start_ms = hpb_bench_cpu_ms();
+    hpb_sim_add_node(sim, 1);
+    hpb_sim_run(sim, HPB_BENCH_SETTLE_US);
+    result.rebalance_ms = hpb_bench_cpu_ms() - cpu_start_ms;
+    result.rebalance_msgs = sim->n_sent - n_sent;
+    result.rebalance_kb = (sim->bytes_sent - bytes_sent) / 1024;
+
+    // The messages carry the virtual time at which they were published
+    max_latencies = HPB_BENCH_N_PUBLISHES * HPB_BENCH_SUBSCRIBERS_PER_TOPIC * 2;
+    latencies = (double *) malloc(max_latencies * sizeof(double));
+    n_latencies = 0;
+    size_t n_expected = 0;
+    for(int i = 0; i < HPB_BENCH_N_PUBLISHES; i++)
+    {
+        size_t topic = hpb_sim_random(sim) % n_topics;
+        char msg[32];
+        int msg_length = snprintf(msg, sizeof(msg), "%llu", (unsigned long long) hpb_clock_now_us());
+        snprintf(service_name, sizeof(service_name), "topic-%zu", topic);
+        hpb_sim_select_node(sim, hpb_sim_random(sim) % n_nodes);
+        hpb_issue_publish_req(service_name, msg, msg_length + 1);
+        n_expected += n_nodes / n_topics + ((topic < n_nodes % n_topics) ? 1 : 0);
+        hpb_sim_run(sim, 10000);
+    }
+    hpb_sim_run(sim, HPB_BENCH_SETTLE_US);
+
+    qsort(latencies, n_latencies, sizeof(double), hpb_bench_compare);
+    result.p50 = (n_latencies > 0) ? latencies[n_latencies / 2] : 0;
+    result.p99 = (n_latencies > 0) ? latencies[(n_latencies * 99) / 100] : 0;
+    result.delivery = (double) n_latencies / n_expected;
+    free(latencies);
+    latencies = NULL;
+
+    hpb_sim_destroy(&sim);
+    return result;
+}
+
+static double hpb_bench_cpu_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void hpb_bench_on_message_received(char *service_name, char *msg, size_t msg_length)
+{
+    if(latencies == NULL) {
+        return;
+    }
+
+    // The retries and the subscribers which join late may deliver more messages than expected
+    if(n_latencies == max_latencies)
+    {
+        max_latencies *= 2;
+        latencies = (double *) realloc(latencies, max_latencies * sizeof(double));
+    }
+
+    uint64_t published_us = strtoull(msg, NULL, 10);
+    latencies[n_latencies++] = (double) (hpb_clock_now_us() - published_us) / 1000;
+}
+
+static int hpb_bench_compare(const void *latency1, const void *latency2)
+{
+    double l1 = *((const double *) latency1);
+    double l2 = *((const double *) latency2);
+    return (l1 > l2) - (l1 < l2);
+}
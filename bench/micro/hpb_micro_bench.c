@@ -0,0 +1,163 @@
+#include <time.h>
+
+#include "hpb_micro_bench.h"
+
+// Linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc, so that the calls of the library come here first
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static uint64_t hpb_micro_n_allocs = 0;
+
+static uint64_t hpb_micro_bench_now_ns();
+static HpbMicroBenchResult hpb_micro_bench_measure(const HpbMicroBench *bench, size_t size, uint64_t target_ns);
+static void hpb_micro_bench_print_table(HpbMicroBenchResult *results, size_t n_results);
+static void hpb_micro_bench_print_json(HpbMicroBenchResult *results, size_t n_results);
+
+void *__wrap_malloc(size_t size)
+{
+    __atomic_fetch_add(&hpb_micro_n_allocs, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    __atomic_fetch_add(&hpb_micro_n_allocs, 1, __ATOMIC_RELAXED);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    __atomic_fetch_add(&hpb_micro_n_allocs, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+uint64_t hpb_micro_bench_get_allocs()
+{
+    return __atomic_load_n(&hpb_micro_n_allocs, __ATOMIC_RELAXED);
+}
+
+int main(int argc, char *argv[])
+{
+    bool is_json = false;
+    uint64_t target_ns = HPB_MICRO_BENCH_TARGET_NS;
+    const char *filter = NULL;
+
+    // Usage: HypePubSubBench [--json] [--quick] [name filter]
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--json") == 0) {
+            is_json = true;
+        }
+        else if(strcmp(argv[i], "--quick") == 0) {
+            target_ns = HPB_MICRO_BENCH_QUICK_TARGET_NS;
+        }
+        else {
+            filter = argv[i];
+        }
+    }
+
+    HpbMicroBenchResult *results = (HpbMicroBenchResult *) malloc(hpb_micro_n_benches * HPB_MICRO_BENCH_MAX_SIZES * sizeof(HpbMicroBenchResult));
+    size_t n_results = 0;
+    for(size_t i = 0; i < hpb_micro_n_benches; i++)
+    {
+        const HpbMicroBench *bench = &(hpb_micro_benches[i]);
+        if(filter != NULL && strstr(bench->name, filter) == NULL) {
+            continue;
+        }
+
+        for(size_t j = 0; j < HPB_MICRO_BENCH_MAX_SIZES && bench->sizes[j] != 0; j++) {
+            results[n_results++] = hpb_micro_bench_measure(bench, bench->sizes[j], target_ns);
+        }
+    }
+
+    if(is_json) {
+        hpb_micro_bench_print_json(results, n_results);
+    }
+    else {
+        hpb_micro_bench_print_table(results, n_results);
+    }
+
+    free(results);
+    return 0;
+}
+
+static uint64_t hpb_micro_bench_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+static HpbMicroBenchResult hpb_micro_bench_measure(const HpbMicroBench *bench, size_t size, uint64_t target_ns)
+{
+    HpbMicroBenchResult result;
+    result.bench = bench;
+    result.size = size;
+
+    void *state = bench->setup(size);
+
+    // The number of operations grows until a run takes a tenth of the target, and is then scaled to the target
+    uint64_t n_ops = 1;
+    uint64_t elapsed_ns = 0;
+    while(n_ops < HPB_MICRO_BENCH_MAX_OPS)
+    {
+        uint64_t start_ns = hpb_micro_bench_now_ns();
+        bench->run(state, n_ops);
+        elapsed_ns = hpb_micro_bench_now_ns() - start_ns;
+        if(elapsed_ns >= target_ns / 10) {
+            break;
+        }
+        n_ops *= (elapsed_ns < target_ns / 1000) ? 100 : 10;
+    }
+
+    n_ops = (elapsed_ns > 0) ? (uint64_t) ((double) n_ops * target_ns / elapsed_ns) : n_ops;
+    n_ops = (n_ops == 0) ? 1 : (n_ops > HPB_MICRO_BENCH_MAX_OPS) ? HPB_MICRO_BENCH_MAX_OPS : n_ops;
+
+    uint64_t n_allocs = hpb_micro_bench_get_allocs();
+    uint64_t start_ns = hpb_micro_bench_now_ns();
+    bench->run(state, n_ops);
+    elapsed_ns = hpb_micro_bench_now_ns() - start_ns;
+    n_allocs = hpb_micro_bench_get_allocs() - n_allocs;
+
+    bench->teardown(state);
+
+    result.n_ops = n_ops;
+    result.ns_per_op = (double) elapsed_ns / n_ops;
+    result.allocs_per_op = (double) n_allocs / n_ops;
+    result.ops_per_s = (elapsed_ns > 0) ? n_ops * 1e9 / elapsed_ns : 0;
+    result.mb_per_s = (bench->is_size_bytes) ? result.ops_per_s * size / 1e6 : 0;
+    return result;
+}
+
+static void hpb_micro_bench_print_table(HpbMicroBenchResult *results, size_t n_results)
+{
+    printf("%-42s %-7s %12s %12s %10s %14s %10s\n", "benchmark", "size", "ops", "ns/op", "allocs/op", "ops/s", "MB/s");
+    for(size_t i = 0; i < n_results; i++)
+    {
+        HpbMicroBenchResult *result = &(results[i]);
+        printf("%-42s %-7zu %12llu %12.1f %10.2f %14.0f ", result->bench->name, result->size, (unsigned long long) result->n_ops,
+               result->ns_per_op, result->allocs_per_op, result->ops_per_s);
+        if(result->bench->is_size_bytes) {
+            printf("%10.1f\n", result->mb_per_s);
+        }
+        else {
+            printf("%10s\n", "-");
+        }
+    }
+}
+
+static void hpb_micro_bench_print_json(HpbMicroBenchResult *results, size_t n_results)
+{
+    printf("{\n  \"benchmarks\": [\n");
+    for(size_t i = 0; i < n_results; i++)
+    {
+        HpbMicroBenchResult *result = &(results[i]);
+        printf("    {\"name\": \"%s\", \"op\": \"%s\", \"size\": %zu, \"size_unit\": \"%s\", \"iterations\": %llu, "
+               "\"ns_per_op\": %.2f, \"allocs_per_op\": %.3f, \"ops_per_s\": %.1f, \"mb_per_s\": %.2f}%s\n",
+               result->bench->name, result->bench->op, result->size, (result->bench->is_size_bytes) ? "bytes" : "elements",
+               (unsigned long long) result->n_ops, result->ns_per_op, result->allocs_per_op, result->ops_per_s, result->mb_per_s,
+               (i + 1 < n_results) ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
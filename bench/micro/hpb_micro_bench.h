@@ -0,0 +1,53 @@
+#ifndef HPB_MICRO_BENCH_H_INCLUDED_
+#define HPB_MICRO_BENCH_H_INCLUDED_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HPB_MICRO_BENCH_MAX_SIZES 4
+#define HPB_MICRO_BENCH_TARGET_NS 200000000ULL // Time measured for each size of each benchmark
+#define HPB_MICRO_BENCH_QUICK_TARGET_NS 20000000ULL
+#define HPB_MICRO_BENCH_MAX_OPS (1ULL << 32)
+
+/**
+ * @brief This struct describes a micro-benchmark, which repeats an operation on a state prepared for each size.
+ */
+typedef struct HpbMicroBench_
+{
+    const char *name; /**< Name of the benchmark, after the function measured. */
+    const char *op; /**< Description of an operation. */
+    bool is_size_bytes; /**< Indicates if the size is the number of bytes processed by an operation, which gives a throughput in MB/s. */
+    size_t sizes[HPB_MICRO_BENCH_MAX_SIZES]; /**< Sizes at which the benchmark runs, ended by 0 if there are less than the maximum. */
+    void *(*setup)(size_t size); /**< Prepares the state of the benchmark, outside of the measure. */
+    void (*run)(void *state, uint64_t n_ops); /**< Runs the given number of operations. */
+    void (*teardown)(void *state); /**< Deallocates the state of the benchmark. */
+} HpbMicroBench;
+
+/**
+ * @brief This struct holds the measure of a benchmark at a given size.
+ */
+typedef struct HpbMicroBenchResult_
+{
+    const HpbMicroBench *bench; /**< Benchmark measured. */
+    size_t size; /**< Size at which it was measured. */
+    uint64_t n_ops; /**< Number of operations measured. */
+    double ns_per_op; /**< Time per operation, in nanoseconds. */
+    double allocs_per_op; /**< Calls to malloc, calloc and realloc per operation. */
+    double ops_per_s; /**< Operations per second. */
+    double mb_per_s; /**< Megabytes processed per second, or 0 if the size is not a number of bytes. */
+} HpbMicroBenchResult;
+
+extern const HpbMicroBench hpb_micro_benches[]; /**< Benchmarks of the hot primitives, defined by hpb_micro_cases.c. */
+extern const size_t hpb_micro_n_benches; /**< Number of benchmarks. */
+
+/**
+ * @brief Returns the number of allocations made by the process so far. The allocations are counted by
+ *        wrapping malloc, calloc and realloc at link time, so those made inside the C library are not.
+ * @return Returns the number of allocations.
+ */
+uint64_t hpb_micro_bench_get_allocs();
+
+#endif /* HPB_MICRO_BENCH_H_INCLUDED_ */
@@ -0,0 +1,591 @@
+#include "hpb_micro_bench.h"
+
+#include "linked_list.h"
+#include "hype_pub_sub/hype_pub_sub.h"
+#include "hype_pub_sub/hpb_protocol.h"
+#include "hype_pub_sub/hpb_network.h"
+#include "hype_pub_sub/hpb_transport.h"
+#include "hype_pub_sub/hpb_subscriptions_list.h"
+#include "hype_pub_sub/hpb_service_managers_list.h"
+#include "hype_pub_sub/hpb_metrics.h"
+
+#define HPB_MICRO_N_KEYS 256 // Keys looked up in turn, so that a lookup does not always take the same path
+#define HPB_MICRO_ID_SIZE 12
+#define HPB_MICRO_PAYLOAD_SIZE 64
+#define HPB_MICRO_MAX_TOPIC_SIZE 128
+#define HPB_MICRO_TOPIC "building-7/floor-3/room-12/sensors/temperature/celsius/average/last-minute/device-a41f/" \
+                        "firmware-2.3.1/calibrated/raw/signal/quality/high/x"
+
+/**
+ * @brief State of the benchmarks of a linked list.
+ */
+typedef struct HpbMicroListState_
+{
+    LinkedList *list; /**< List of the given size. */
+    size_t *elements; /**< Elements of the list. */
+    size_t size; /**< Size of the list. */
+} HpbMicroListState;
+
+/**
+ * @brief State of the benchmarks of the lookup of the manager of a service.
+ */
+typedef struct HpbMicroNetworkState_
+{
+    HpbNetwork *net; /**< Network with the given number of clients. */
+    HLByte keys[HPB_MICRO_N_KEYS][SHA1_BLOCK_SIZE]; /**< Service keys looked up. */
+} HpbMicroNetworkState;
+
+/**
+ * @brief State of the benchmarks of the protocol and of the SHA-1 keys.
+ */
+typedef struct HpbMicroPacketState_
+{
+    HLByte service_key[SHA1_BLOCK_SIZE]; /**< Key of the service of the packets. */
+    char *msg; /**< Payload of the given size. */
+    size_t msg_length; /**< Size of the payload. */
+    HLByte *packet; /**< Packet received by the receive benchmarks. */
+    size_t packet_size; /**< Size of the packet. */
+    HpbTransport *transport; /**< Transport of the application which receives the packets, which drops the messages sent. */
+    HypePubSub *context; /**< Application which receives the packets. */
+    HypeInstance *origin; /**< Instance from which the packets are received. */
+    uint32_t seq; /**< Sequence number of the last packet received. */
+} HpbMicroPacketState;
+
+/**
+ * @brief State of the benchmarks of the lists of subscriptions and of managed services.
+ */
+typedef struct HpbMicroServicesState_
+{
+    HpbSubscriptionsList *subscriptions; /**< List of subscriptions of the given size. */
+    HpbServiceManagersList *services; /**< List of managed services of the given size. */
+    HypeInstance *manager; /**< Manager of the subscriptions. */
+    HLByte (*keys)[SHA1_BLOCK_SIZE]; /**< Keys of the services of the lists. */
+    size_t size; /**< Size of the lists. */
+    size_t next; /**< Index of the next key looked up. */
+} HpbMicroServicesState;
+
+/**
+ * @brief State of the benchmarks of the metrics.
+ */
+typedef struct HpbMicroMetricsState_
+{
+    HpbMetrics *metrics; /**< Registry with a shard of this thread. */
+    FILE *out; /**< Stream on which the metrics are printed, which discards them. */
+} HpbMicroMetricsState;
+
+static volatile uintptr_t hpb_micro_sink = 0; // Keeps the results of the operations alive
+
+static HypeInstance *hpb_micro_create_instance(uint32_t id);
+static void hpb_micro_random_key(HLByte key[SHA1_BLOCK_SIZE]);
+
+static void *hpb_micro_list_setup(size_t size);
+static void hpb_micro_list_run_add(void *state, uint64_t n_ops);
+static void hpb_micro_list_run_find(void *state, uint64_t n_ops);
+static void hpb_micro_list_run_remove(void *state, uint64_t n_ops);
+static void hpb_micro_list_teardown(void *state);
+
+static void *hpb_micro_network_setup_xor(size_t size);
+static void *hpb_micro_network_setup_vnodes(size_t size);
+static void hpb_micro_network_run(void *state, uint64_t n_ops);
+static void hpb_micro_network_teardown(void *state);
+
+static void *hpb_micro_packet_setup(size_t size);
+static void hpb_micro_packet_run_build_subscribe(void *state, uint64_t n_ops);
+static void hpb_micro_packet_run_build_publish(void *state, uint64_t n_ops);
+static void hpb_micro_packet_run_build_info(void *state, uint64_t n_ops);
+static void hpb_micro_packet_run_sha1(void *state, uint64_t n_ops);
+static void *hpb_micro_receive_setup_publish(size_t size);
+static void *hpb_micro_receive_setup_info(size_t size);
+static void hpb_micro_receive_run_publish(void *state, uint64_t n_ops);
+static void hpb_micro_receive_run_info(void *state, uint64_t n_ops);
+static void hpb_micro_packet_teardown(void *state);
+
+static void *hpb_micro_services_setup(size_t size);
+static void hpb_micro_services_run_find_subscription(void *state, uint64_t n_ops);
+static void hpb_micro_services_run_find_service(void *state, uint64_t n_ops);
+static void hpb_micro_services_run_add_service(void *state, uint64_t n_ops);
+static void hpb_micro_services_teardown(void *state);
+
+static void *hpb_micro_metrics_setup(size_t size);
+static void hpb_micro_metrics_run_add(void *state, uint64_t n_ops);
+static void hpb_micro_metrics_run_print(void *state, uint64_t n_ops);
+static void hpb_micro_metrics_teardown(void *state);
+
+static int hpb_micro_transport_start(HpbTransport *transport);
+static void hpb_micro_transport_stop(HpbTransport *transport);
+static HypeInstance *hpb_micro_transport_get_own_instance(HpbTransport *transport);
+static uint64_t hpb_micro_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination);
+static void hpb_micro_transport_resolve(HpbTransport *transport, HypeInstance *instance);
+static void hpb_micro_transport_destroy(HpbTransport *transport);
+static void hpb_micro_on_message_received(char *service_name, char *msg, size_t msg_length);
+static bool linked_list_callback_is_same_element(void *element1, void *element2);
+static void linked_list_callback_keep_element(void **element);
+
+static const HpbTransportOps hpb_micro_transport_ops = {
+    "micro",
+    hpb_micro_transport_start,
+    hpb_micro_transport_stop,
+    hpb_micro_transport_get_own_instance,
+    hpb_micro_transport_send,
+    hpb_micro_transport_resolve,
+    hpb_micro_transport_destroy
+};
+
+const HpbMicroBench hpb_micro_benches[] = {
+    {"linked_list_add", "append to a list of the size and remove the head", false, {16, 256, 4096, 0},
+     hpb_micro_list_setup, hpb_micro_list_run_add, hpb_micro_list_teardown},
+    {"linked_list_find", "find the last element", false, {16, 256, 4096, 0},
+     hpb_micro_list_setup, hpb_micro_list_run_find, hpb_micro_list_teardown},
+    {"linked_list_remove", "remove the last element and append it again", false, {16, 256, 4096, 0},
+     hpb_micro_list_setup, hpb_micro_list_run_remove, hpb_micro_list_teardown},
+    {"hpb_network_get_service_manager_id/xor", "find the manager among the clients", false, {4, 64, 1024, 0},
+     hpb_micro_network_setup_xor, hpb_micro_network_run, hpb_micro_network_teardown},
+    {"hpb_network_get_service_manager_id/vnodes", "find the manager on the ring of the clients", false, {4, 64, 1024, 0},
+     hpb_micro_network_setup_vnodes, hpb_micro_network_run, hpb_micro_network_teardown},
+    {"hpb_protocol_build_subscribe_msg", "build and free a packet", false, {1, 0},
+     hpb_micro_packet_setup, hpb_micro_packet_run_build_subscribe, hpb_micro_packet_teardown},
+    {"hpb_protocol_build_publish_msg", "build and free a packet with a payload of the size", true, {16, 256, 4096, 0},
+     hpb_micro_packet_setup, hpb_micro_packet_run_build_publish, hpb_micro_packet_teardown},
+    {"hpb_protocol_build_info_msg", "build and free a packet with a payload of the size", true, {16, 256, 4096, 0},
+     hpb_micro_packet_setup, hpb_micro_packet_run_build_info, hpb_micro_packet_teardown},
+    {"hpb_protocol_receive_msg/publish", "receive a publish as manager of the size of subscribers", false, {1, 16, 128, 0},
+     hpb_micro_receive_setup_publish, hpb_micro_receive_run_publish, hpb_micro_packet_teardown},
+    {"hpb_protocol_receive_msg/info", "receive an info with a payload of the size as subscriber", true, {16, 256, 4096, 0},
+     hpb_micro_receive_setup_info, hpb_micro_receive_run_info, hpb_micro_packet_teardown},
+    {"sha1_digest", "hash a topic name of the size", true, {8, 32, 128, 0},
+     hpb_micro_packet_setup, hpb_micro_packet_run_sha1, hpb_micro_packet_teardown},
+    {"hpb_list_subscriptions_find", "find a subscription among the size", false, {16, 256, 4096, 0},
+     hpb_micro_services_setup, hpb_micro_services_run_find_subscription, hpb_micro_services_teardown},
+    {"hpb_list_service_managers_find", "find a managed service among the size", false, {16, 256, 4096, 0},
+     hpb_micro_services_setup, hpb_micro_services_run_find_service, hpb_micro_services_teardown},
+    {"hpb_list_service_managers_add", "add a managed service to the size and remove it", false, {16, 256, 4096, 0},
+     hpb_micro_services_setup, hpb_micro_services_run_add_service, hpb_micro_services_teardown},
+    {"hpb_metrics_add_by_type", "count a message and its bytes, as each send and receive does", false, {1, 0},
+     hpb_micro_metrics_setup, hpb_micro_metrics_run_add, hpb_micro_metrics_teardown},
+    {"hpb_metrics_print_prometheus", "format the metrics, as each scrape does", false, {1, 0},
+     hpb_micro_metrics_setup, hpb_micro_metrics_run_print, hpb_micro_metrics_teardown}
+};
+
+const size_t hpb_micro_n_benches = sizeof(hpb_micro_benches) / sizeof(hpb_micro_benches[0]);
+
+static HypeInstance *hpb_micro_create_instance(uint32_t id)
+{
+    HLByte identifier_bytes[HPB_MICRO_ID_SIZE] = {0};
+    binary_utils_write_uint32(identifier_bytes, id);
+    HypeBuffer *identifier = hype_buffer_create_from(identifier_bytes, HPB_MICRO_ID_SIZE);
+    HLByte capacity = 1;
+    HypeBuffer *announcement = hype_buffer_create_from(&capacity, sizeof(capacity));
+    HypeInstance *instance = hype_instance_create(identifier, announcement, true);
+    hype_buffer_release(identifier);
+    hype_buffer_release(announcement);
+    return instance;
+}
+
+static void hpb_micro_random_key(HLByte key[SHA1_BLOCK_SIZE])
+{
+    for(int i = 0; i < SHA1_BLOCK_SIZE; i++) {
+        key[i] = (HLByte) rand();
+    }
+}
+
+//
+// Linked list
+//
+
+static void *hpb_micro_list_setup(size_t size)
+{
+    HpbMicroListState *s = (HpbMicroListState *) malloc(sizeof(HpbMicroListState));
+    s->list = linked_list_create();
+    s->elements = (size_t *) malloc(size * sizeof(size_t));
+    s->size = size;
+    for(size_t i = 0; i < size; i++)
+    {
+        s->elements[i] = i;
+        linked_list_add(s->list, &(s->elements[i]));
+    }
+    return s;
+}
+
+static void hpb_micro_list_run_add(void *state, uint64_t n_ops)
+{
+    HpbMicroListState *s = (HpbMicroListState *) state;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        // The head is appended before it is removed, so that the list keeps its size
+        void *element = s->list->head->element;
+        linked_list_add(s->list, element);
+        linked_list_remove(s->list, element, linked_list_callback_is_same_element, linked_list_callback_keep_element);
+    }
+}
+
+static void hpb_micro_list_run_find(void *state, uint64_t n_ops)
+{
+    HpbMicroListState *s = (HpbMicroListState *) state;
+    for(uint64_t i = 0; i < n_ops; i++) {
+        hpb_micro_sink += (uintptr_t) linked_list_find(s->list, &(s->elements[s->size - 1]), linked_list_callback_is_same_element);
+    }
+}
+
+static void hpb_micro_list_run_remove(void *state, uint64_t n_ops)
+{
+    HpbMicroListState *s = (HpbMicroListState *) state;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        void *element = &(s->elements[s->size - 1]);
+        linked_list_remove(s->list, element, linked_list_callback_is_same_element, linked_list_callback_keep_element);
+        linked_list_add(s->list, element);
+    }
+}
+
+static void hpb_micro_list_teardown(void *state)
+{
+    HpbMicroListState *s = (HpbMicroListState *) state;
+    linked_list_destroy(&(s->list), linked_list_callback_keep_element);
+    free(s->elements);
+    free(s);
+}
+
+//
+// Network
+//
+
+static void *hpb_micro_network_setup_xor(size_t size)
+{
+    HpbMicroNetworkState *s = (HpbMicroNetworkState *) malloc(sizeof(HpbMicroNetworkState));
+    HypeInstance *own_instance = hpb_micro_create_instance(0);
+    s->net = hpb_network_create(own_instance);
+    hype_instance_release(own_instance);
+
+    // The own client counts among the clients of the network
+    for(size_t i = 1; i < size; i++)
+    {
+        HypeInstance *instance = hpb_micro_create_instance((uint32_t) i);
+        hpb_network_add_client(s->net, instance);
+        hype_instance_release(instance);
+    }
+
+    for(int i = 0; i < HPB_MICRO_N_KEYS; i++) {
+        hpb_micro_random_key(s->keys[i]);
+    }
+    return s;
+}
+
+static void *hpb_micro_network_setup_vnodes(size_t size)
+{
+    HpbMicroNetworkState *s = (HpbMicroNetworkState *) hpb_micro_network_setup_xor(size);
+    hpb_network_set_placement(s->net, HPB_PLACEMENT_VNODES);
+    hpb_network_get_service_manager_id(s->net, s->keys[0]); // The ring is built outside of the measure
+    return s;
+}
+
+static void hpb_micro_network_run(void *state, uint64_t n_ops)
+{
+    HpbMicroNetworkState *s = (HpbMicroNetworkState *) state;
+    for(uint64_t i = 0; i < n_ops; i++) {
+        hpb_micro_sink += (uintptr_t) hpb_network_get_service_manager_id(s->net, s->keys[i % HPB_MICRO_N_KEYS]);
+    }
+}
+
+static void hpb_micro_network_teardown(void *state)
+{
+    HpbMicroNetworkState *s = (HpbMicroNetworkState *) state;
+    hpb_network_destroy(&(s->net));
+    free(s);
+}
+
+//
+// Protocol and SHA-1
+//
+
+static void *hpb_micro_packet_setup(size_t size)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) calloc(1, sizeof(HpbMicroPacketState));
+    hpb_micro_random_key(s->service_key);
+
+    // The payload of the SHA-1 benchmark is a topic name of the size
+    s->msg_length = size;
+    s->msg = (char *) malloc(size + 1);
+    for(size_t i = 0; i < size; i++) {
+        s->msg[i] = HPB_MICRO_TOPIC[i % HPB_MICRO_MAX_TOPIC_SIZE];
+    }
+    s->msg[size] = '\0';
+    return s;
+}
+
+static void hpb_micro_packet_run_build_subscribe(void *state, uint64_t n_ops)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) state;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        HLByte *packet;
+        hpb_micro_sink += hpb_protocol_build_subscribe_msg(s->service_key, &packet);
+        free(packet);
+    }
+}
+
+static void hpb_micro_packet_run_build_publish(void *state, uint64_t n_ops)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) state;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        HLByte *packet;
+        HpbPublishOrigin origin = {1, (uint32_t) i};
+        hpb_micro_sink += hpb_protocol_build_publish_msg(s->service_key, origin, s->msg, s->msg_length, &packet);
+        free(packet);
+    }
+}
+
+static void hpb_micro_packet_run_build_info(void *state, uint64_t n_ops)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) state;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        HLByte *packet;
+        HpbPublishOrigin origin = {1, (uint32_t) i};
+        hpb_micro_sink += hpb_protocol_build_info_msg(s->service_key, (uint32_t) i, origin, s->msg, s->msg_length, &packet);
+        free(packet);
+    }
+}
+
+static void hpb_micro_packet_run_sha1(void *state, uint64_t n_ops)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) state;
+    HLByte key[SHA1_BLOCK_SIZE];
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        sha1_digest((const BYTE *) s->msg, s->msg_length, key);
+        hpb_micro_sink += key[0];
+    }
+}
+
+static void *hpb_micro_receive_setup_publish(size_t size)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) hpb_micro_packet_setup(HPB_MICRO_PAYLOAD_SIZE);
+    s->transport = hpb_transport_create(&hpb_micro_transport_ops, NULL, hpb_transport_get_pub_sub_callbacks(NULL), NULL);
+    s->context = hpb_create(s->transport);
+    s->context->fanout->n_workers = 0; // The fan-out is measured on the calling thread
+    hpb_set_current(s->context);
+
+    // This application manages the service, to which the given number of clients subscribed
+    for(size_t i = 0; i < size; i++)
+    {
+        HypeInstance *subscriber = hpb_micro_create_instance((uint32_t) (i + 1));
+        hpb_process_subscribe_req(s->service_key, subscriber);
+        hype_instance_release(subscriber);
+    }
+
+    s->origin = hpb_micro_create_instance(1);
+    HpbPublishOrigin origin = {1, 0};
+    s->packet_size = hpb_protocol_build_publish_msg(s->service_key, origin, s->msg, s->msg_length, &(s->packet));
+    return s;
+}
+
+static void *hpb_micro_receive_setup_info(size_t size)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) hpb_micro_packet_setup(size);
+    s->transport = hpb_transport_create(&hpb_micro_transport_ops, NULL, hpb_transport_get_pub_sub_callbacks(NULL), NULL);
+    s->context = hpb_create(s->transport);
+    hpb_set_current(s->context);
+    hpb_set_message_received_callback(hpb_micro_on_message_received);
+
+    // This application subscribed to the service, whose manager sends the packets
+    s->origin = hpb_micro_create_instance(1);
+    HpbSubscription *subscription = hpb_list_subscriptions_add(s->context->own_subscriptions, "topic", strlen("topic"), s->origin);
+    memcpy(s->service_key, subscription->service_key, SHA1_BLOCK_SIZE);
+
+    HpbPublishOrigin origin = {1, 0};
+    s->packet_size = hpb_protocol_build_info_msg(s->service_key, 0, origin, s->msg, s->msg_length, &(s->packet));
+    return s;
+}
+
+static void hpb_micro_receive_run_publish(void *state, uint64_t n_ops)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) state;
+    size_t origin_offset = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        // Each publish has an origin of its own, so that none is taken for a duplicate
+        binary_utils_write_uint32(s->packet + origin_offset + sizeof(uint32_t), ++(s->seq));
+        hpb_protocol_receive_msg(s->origin, s->packet, s->packet_size);
+    }
+}
+
+static void hpb_micro_receive_run_info(void *state, uint64_t n_ops)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) state;
+    size_t seq_offset = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE;
+    size_t origin_offset = seq_offset + HPB_PROTOCOL_SEQ_SIZE;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        // The messages follow each other without gaps, from origins of their own
+        ++(s->seq);
+        binary_utils_write_uint32(s->packet + seq_offset, s->seq);
+        binary_utils_write_uint32(s->packet + origin_offset + sizeof(uint32_t), s->seq);
+        hpb_protocol_receive_msg(s->origin, s->packet, s->packet_size);
+    }
+}
+
+static void hpb_micro_packet_teardown(void *state)
+{
+    HpbMicroPacketState *s = (HpbMicroPacketState *) state;
+    hpb_destroy_context(&(s->context));
+    hpb_transport_destroy(&(s->transport));
+    if(s->origin != NULL) {
+        hype_instance_release(s->origin);
+    }
+    free(s->packet);
+    free(s->msg);
+    free(s);
+}
+
+//
+// Lists of subscriptions and of managed services
+//
+
+static void *hpb_micro_services_setup(size_t size)
+{
+    HpbMicroServicesState *s = (HpbMicroServicesState *) malloc(sizeof(HpbMicroServicesState));
+    s->subscriptions = hpb_list_subscriptions_create();
+    s->services = hpb_list_service_managers_create();
+    s->manager = hpb_micro_create_instance(1);
+    s->keys = malloc(size * SHA1_BLOCK_SIZE);
+    s->size = size;
+    s->next = 0;
+
+    for(size_t i = 0; i < size; i++)
+    {
+        char service_name[32];
+        int service_name_length = snprintf(service_name, sizeof(service_name), "sensors/%zu", i);
+        HpbSubscription *subscription = hpb_list_subscriptions_add(s->subscriptions, service_name, service_name_length, s->manager);
+        memcpy(s->keys[i], subscription->service_key, SHA1_BLOCK_SIZE);
+        hpb_list_service_managers_add(s->services, s->keys[i]);
+    }
+    return s;
+}
+
+static void hpb_micro_services_run_find_subscription(void *state, uint64_t n_ops)
+{
+    HpbMicroServicesState *s = (HpbMicroServicesState *) state;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        hpb_micro_sink += (uintptr_t) hpb_list_subscriptions_find(s->subscriptions, s->keys[s->next]);
+        s->next = (s->next + 1) % s->size;
+    }
+}
+
+static void hpb_micro_services_run_find_service(void *state, uint64_t n_ops)
+{
+    HpbMicroServicesState *s = (HpbMicroServicesState *) state;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        hpb_micro_sink += (uintptr_t) hpb_list_service_managers_find(s->services, s->keys[s->next]);
+        s->next = (s->next + 1) % s->size;
+    }
+}
+
+static void hpb_micro_services_run_add_service(void *state, uint64_t n_ops)
+{
+    HpbMicroServicesState *s = (HpbMicroServicesState *) state;
+    HLByte key[SHA1_BLOCK_SIZE];
+    hpb_micro_random_key(key);
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        hpb_micro_sink += (uintptr_t) hpb_list_service_managers_add(s->services, key);
+        hpb_list_service_managers_remove(s->services, key);
+    }
+}
+
+static void hpb_micro_services_teardown(void *state)
+{
+    HpbMicroServicesState *s = (HpbMicroServicesState *) state;
+    hpb_list_subscriptions_destroy(&(s->subscriptions));
+    hpb_list_service_managers_destroy(&(s->services));
+    hype_instance_release(s->manager);
+    free(s->keys);
+    free(s);
+}
+
+//
+// Transport which drops the messages sent
+//
+
+static int hpb_micro_transport_start(HpbTransport *transport)
+{
+    return 0;
+}
+
+static void hpb_micro_transport_stop(HpbTransport *transport)
+{
+}
+
+static HypeInstance *hpb_micro_transport_get_own_instance(HpbTransport *transport)
+{
+    return hpb_micro_create_instance(0);
+}
+
+static void *hpb_micro_metrics_setup(size_t size)
+{
+    HpbMicroMetricsState *s = (HpbMicroMetricsState *) calloc(1, sizeof(HpbMicroMetricsState));
+    s->metrics = hpb_metrics_create();
+    s->out = fopen("/dev/null", "w");
+
+    // The shard of the thread is allocated by its first count, outside of the measure
+    hpb_metrics_add_by_type(s->metrics, HPB_METRICS_MESSAGES_IN, INFO, 1);
+    return s;
+}
+
+static void hpb_micro_metrics_run_add(void *state, uint64_t n_ops)
+{
+    HpbMicroMetricsState *s = (HpbMicroMetricsState *) state;
+    for(uint64_t i = 0; i < n_ops; i++)
+    {
+        hpb_metrics_add_by_type(s->metrics, HPB_METRICS_MESSAGES_IN, INFO, 1);
+        hpb_metrics_add_by_type(s->metrics, HPB_METRICS_BYTES_IN, INFO, HPB_MICRO_PAYLOAD_SIZE);
+    }
+}
+
+static void hpb_micro_metrics_run_print(void *state, uint64_t n_ops)
+{
+    HpbMicroMetricsState *s = (HpbMicroMetricsState *) state;
+    for(uint64_t i = 0; i < n_ops; i++) {
+        hpb_metrics_print_prometheus(s->out, s->metrics);
+    }
+}
+
+static void hpb_micro_metrics_teardown(void *state)
+{
+    HpbMicroMetricsState *s = (HpbMicroMetricsState *) state;
+    hpb_metrics_destroy(&(s->metrics));
+    fclose(s->out);
+    free(s);
+}
+
+static uint64_t hpb_micro_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination)
+{
+    // The messages are not tracked, so that the retry queue does not grow during the measure
+    hpb_micro_sink += data_size;
+    return 0;
+}
+
+static void hpb_micro_transport_resolve(HpbTransport *transport, HypeInstance *instance)
+{
+}
+
+static void hpb_micro_transport_destroy(HpbTransport *transport)
+{
+}
+
+static void hpb_micro_on_message_received(char *service_name, char *msg, size_t msg_length)
+{
+    hpb_micro_sink += msg_length;
+}
+
+static bool linked_list_callback_is_same_element(void *element1, void *element2)
+{
+    return element1 == element2;
+}
+
+static void linked_list_callback_keep_element(void **element)
+{
+    // The elements belong to the benchmark
+}
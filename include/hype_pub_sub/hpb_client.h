@@ -9,8 +9,14 @@
 #include "sha/sha1.h"
 #include "hpb_constants.h"
 #include "binary_utils.h"
+#include "hpb_filter.h"
 #include <hype/hype.h>
 
+#define HPB_CLIENT_DEFAULT_CAPACITY 1
+#define HPB_CLIENT_MAX_CAPACITY 16
+#define HPB_CLIENT_DEFAULT_LINK_COST_MS 500 // Cost of the links which were not measured yet
+#define HPB_CLIENT_FAILED_LINK_COST_MS 10000 // Sample taken when a message to the client is given up
+#define HPB_CLIENT_LINK_COST_WEIGHT 8 // Each sample moves the cost by 1/8 of its difference to the cost
 
 /**
  * @brief This struct represents a publisher-subscriber client.
@@ -19,12 +25,20 @@ typedef struct HpbClient_
 {
     HypeInstance *hype_instance;/**< Hype instance of the client. */
     HLByte key[SHA1_BLOCK_SIZE]; /**< Key of the managed service. */
+    uint64_t lease_expiration_ms; /**< Time at which the subscription of the client expires, unless renewed. */
+    uint64_t lease_timer_ms; /**< Deadline of the lease timer scheduled for the client, or 0 if there is none. */
+    HpbFilter *filter; /**< Filter of the messages delivered to the client, shared with the other clients with the same filter, or NULL. */
+    uint8_t capacity; /**< Relative capacity of the client, announced in the first byte of the announcement of its instance. */
+    bool is_sharded; /**< Indicates if the messages of a service are delivered to the client by the owner of its shard instead of the manager. */
+    uint32_t link_cost_ms; /**< Moving average of the time taken by the messages to the client to be delivered. */
+    uint32_t n_link_samples; /**< Number of delivery times averaged in the link cost. */
 } HpbClient;
 
 /**
- * @brief Allocates space for a HpbClient struct, and initializes its instance and key.
+ * @brief Allocates space for a HpbClient struct, and initializes its instance, key and capacity.
  *        It allocates spaces for a new Hype instance struct which is initialized
- *        with the content of the instance given as parameter.
+ *        with the content of the instance given as parameter. Instances which do not
+ *        announce a capacity between 1 and HPB_CLIENT_MAX_CAPACITY get HPB_CLIENT_DEFAULT_CAPACITY.
  * @param instance Hype instance of the client.
  * @return Returns a pointer to the created struct.
  */
@@ -38,6 +52,14 @@ HpbClient * hpb_client_create(HypeInstance *instance);
  */
 bool hpb_client_is_instance_equal(HpbClient *client, HypeInstance *instance);
 
+/**
+ * @brief Adds a sample to the exponentially weighted moving average of the delivery times of the messages
+ *        to the client. The first sample replaces HPB_CLIENT_DEFAULT_LINK_COST_MS.
+ * @param client HpbClient whose link was measured.
+ * @param sample_ms Time from the first attempt to the delivery of a message, or HPB_CLIENT_FAILED_LINK_COST_MS if it was given up.
+ */
+void hpb_client_update_link_cost(HpbClient *client, uint32_t sample_ms);
+
 /**
  * @brief Deallocates the space previously allocated for the given HpbClient struct.
  * @param client Pointer to the pointer of the HpbClient struct to be deallocated.
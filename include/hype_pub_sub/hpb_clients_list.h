@@ -46,4 +46,12 @@ void hpb_list_clients_destroy(HpbClientsList **list_cl);
 HpbClient *hpb_list_clients_find(HpbClientsList *list_cl, HypeInstance *instance);
 
 
+/**
+ * @brief Finds the client with a given key in a linked list.
+ * @param list_cl List in which the HpbClient should be searched.
+ * @param key Key of the HpbClient to be searched.
+ * @return Returns a pointer to the HpbClient if the search is successful or NULL otherwise.
+ */
+HpbClient *hpb_list_clients_find_by_key(HpbClientsList *list_cl, HLByte key[SHA1_BLOCK_SIZE]);
+
 #endif /* HPB_LIST_CLIENTS_H_INCLUDED_ */
@@ -0,0 +1,31 @@
+
+#ifndef HPB_CLOCK_H_INCLUDED_
+#define HPB_CLOCK_H_INCLUDED_
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Source of the time of the HypePubSub clock, in microseconds.
+ */
+typedef uint64_t (*HpbClockSource) ();
+
+/**
+ * @brief Returns the current time of the monotonic clock used by the HypePubSub timers.
+ * @return Returns the number of milliseconds elapsed since an arbitrary starting point.
+ */
+uint64_t hpb_clock_now_ms();
+
+/**
+ * @brief Returns the current time of the monotonic clock with microsecond resolution.
+ * @return Returns the number of microseconds elapsed since an arbitrary starting point.
+ */
+uint64_t hpb_clock_now_us();
+
+/**
+ * @brief Replaces the monotonic clock, so that a simulation runs the HypePubSub timers on its virtual time.
+ * @param source Source of the time, or NULL to restore the monotonic clock.
+ */
+void hpb_clock_set_source(HpbClockSource source);
+
+#endif /* HPB_CLOCK_H_INCLUDED_ */
@@ -14,24 +14,58 @@
 #define HPB_CMD_INTERFACE_INIT_ARG "HypePubSub "
 
 #define HPB_CMD_INTERFACE_SUBSCRIBE "subscribe"
+#define HPB_CMD_INTERFACE_SUBSCRIBE_FILTERED "subscribe-filtered"
 #define HPB_CMD_INTERFACE_UNSUBSCRIBE "unsubscribe"
 #define HPB_CMD_INTERFACE_PUBLISH "publish"
+#define HPB_CMD_INTERFACE_PUBLISH_RETAINED "publish-retained"
 #define HPB_CMD_INTERFACE_PRINT_OWN_ID "print-own-id"
 #define HPB_CMD_INTERFACE_PRINT_HYPE_DEVICES "print-hype-devices"
 #define HPB_CMD_INTERFACE_PRINT_MANAGED_SERVICES "print-managed-services"
 #define HPB_CMD_INTERFACE_PRINT_SUBSCRIPTIONS "print-subscriptions"
+#define HPB_CMD_INTERFACE_PRINT_FANOUT_STATS "print-fanout-stats"
+#define HPB_CMD_INTERFACE_PRINT_RESOLUTION_STATS "print-resolution-stats"
+#define HPB_CMD_INTERFACE_PRINT_STATS "print-stats"
+#define HPB_CMD_INTERFACE_SET_REPLICAS "set-replicas"
+#define HPB_CMD_INTERFACE_SET_MEMBERSHIP_WINDOW "set-membership-window"
+#define HPB_CMD_INTERFACE_SET_PLACEMENT "set-placement"
+#define HPB_CMD_INTERFACE_PLACEMENT_XOR "xor"
+#define HPB_CMD_INTERFACE_PLACEMENT_VNODES "vnodes"
+#define HPB_CMD_INTERFACE_SET_SHARDS "set-shards"
+#define HPB_CMD_INTERFACE_SET_RELAY_TREE "set-relay-tree"
+#define HPB_CMD_INTERFACE_SET_DIRECT "set-direct"
+#define HPB_CMD_INTERFACE_UNSET_DIRECT "unset-direct"
+#define HPB_CMD_INTERFACE_SET_RESOLUTIONS "set-resolutions"
+#define HPB_CMD_INTERFACE_LOAD_GENERATE "load-generate"
+#define HPB_CMD_INTERFACE_LOAD_SINK "load-sink"
+#define HPB_CMD_INTERFACE_PRINT_LOAD_STATS "print-load-stats"
 #define HPB_CMD_INTERFACE_HELP "help"
 #define HPB_CMD_INTERFACE_QUIT "quit"
 
 static struct option hpb_cmd_interface_long_options[] =
 {
     {HPB_CMD_INTERFACE_SUBSCRIBE, required_argument, NULL, 's'},
+    {HPB_CMD_INTERFACE_SUBSCRIBE_FILTERED, required_argument, NULL, 'l'},
     {HPB_CMD_INTERFACE_UNSUBSCRIBE, required_argument, NULL, 'u'},
     {HPB_CMD_INTERFACE_PUBLISH, required_argument, NULL, 'p'},
+    {HPB_CMD_INTERFACE_PUBLISH_RETAINED, required_argument, NULL, 'r'},
     {HPB_CMD_INTERFACE_PRINT_OWN_ID, no_argument, NULL, 'i'},
     {HPB_CMD_INTERFACE_PRINT_HYPE_DEVICES, no_argument, NULL, 'd'},
     {HPB_CMD_INTERFACE_PRINT_MANAGED_SERVICES, no_argument, NULL, 'm'},
     {HPB_CMD_INTERFACE_PRINT_SUBSCRIPTIONS, no_argument, NULL, 'n'},
+    {HPB_CMD_INTERFACE_PRINT_FANOUT_STATS, no_argument, NULL, 'f'},
+    {HPB_CMD_INTERFACE_PRINT_RESOLUTION_STATS, no_argument, NULL, 'o'},
+    {HPB_CMD_INTERFACE_PRINT_STATS, no_argument, NULL, 'y'},
+    {HPB_CMD_INTERFACE_SET_REPLICAS, required_argument, NULL, 'k'},
+    {HPB_CMD_INTERFACE_SET_MEMBERSHIP_WINDOW, required_argument, NULL, 'w'},
+    {HPB_CMD_INTERFACE_SET_PLACEMENT, required_argument, NULL, 'v'},
+    {HPB_CMD_INTERFACE_SET_SHARDS, required_argument, NULL, 'a'},
+    {HPB_CMD_INTERFACE_SET_RELAY_TREE, required_argument, NULL, 'b'},
+    {HPB_CMD_INTERFACE_SET_DIRECT, required_argument, NULL, 'e'},
+    {HPB_CMD_INTERFACE_UNSET_DIRECT, required_argument, NULL, 'x'},
+    {HPB_CMD_INTERFACE_SET_RESOLUTIONS, required_argument, NULL, 'c'},
+    {HPB_CMD_INTERFACE_LOAD_GENERATE, required_argument, NULL, 'g'},
+    {HPB_CMD_INTERFACE_LOAD_SINK, required_argument, NULL, 'j'},
+    {HPB_CMD_INTERFACE_PRINT_LOAD_STATS, no_argument, NULL, 't'},
     {HPB_CMD_INTERFACE_HELP, no_argument, NULL, 'h'},
     {HPB_CMD_INTERFACE_QUIT, no_argument, NULL, 'q'}
 };
@@ -43,6 +77,14 @@ static struct option hpb_cmd_interface_long_options[] =
  */
 void hpb_cmd_interface_subscribe(HypePubSub *hpb, char* service_name);
 
+/**
+ * @brief This method establishes the interface between the user filtered subscribe request and the HypePubSub application.
+ * @param hpb Pointer to the HypePubSub application.
+ * @param service_name Name of the service to be subscribed.
+ * @param filter Filter expression of the messages to be received.
+ */
+void hpb_cmd_interface_subscribe_filtered(HypePubSub *hpb, char* service_name, char *filter);
+
 /**
  * @brief This method establishes the interface between the user unsubscribe request and the HypePubSub application.
  * @param hpb Pointer to the HypePubSub application.
@@ -54,8 +96,17 @@ void hpb_cmd_interface_unsubscribe(HypePubSub *hpb, char *service_name);
  * @brief This method establishes the interface between the user publish request and the HypePubSub application.
  * @param hpb Pointer to the HypePubSub application.
  * @param service_name Name of the service in which to publish.
+ * @param msg Message to be published.
  */
-void hpb_cmd_interface_publish(HypePubSub *hpb, char* service_name);
+void hpb_cmd_interface_publish(HypePubSub *hpb, char* service_name, char *msg);
+
+/**
+ * @brief This method establishes the interface between the user retained publish request and the HypePubSub application.
+ * @param hpb Pointer to the HypePubSub application.
+ * @param service_name Name of the service in which to publish.
+ * @param msg Message to be published and retained for the future subscribers.
+ */
+void hpb_cmd_interface_publish_retained(HypePubSub *hpb, char* service_name, char *msg);
 
 /**
  * @brief Prints the ID and the key of this client.
@@ -64,7 +115,7 @@ void hpb_cmd_interface_publish(HypePubSub *hpb, char* service_name);
 void hpb_cmd_interface_print_own_id(HypePubSub *hpb);
 
 /**
- * @brief Prints the IDs and the keys of the clients found on the network.
+ * @brief Prints the IDs and the keys of the clients found on the network, and the share of the services of each one.
  * @param hpb Pointer to the HypePubSub application.
  */
 void hpb_cmd_interface_print_hype_devices(HypePubSub *hpb);
@@ -81,6 +132,75 @@ void hpb_cmd_interface_print_managed_services(HypePubSub *hpb);
  */
 void hpb_cmd_interface_print_subscriptions(HypePubSub *hpb);
 
+/**
+ * @brief Prints the p50 and p99 "time to last subscriber" of the fan-outs done by this client, by fan-out size.
+ * @param hpb Pointer to the HypePubSub application.
+ */
+void hpb_cmd_interface_print_fanout_stats(HypePubSub *hpb);
+
+/**
+ * @brief Prints the instances waiting to be resolved, the handshakes in progress and their latency.
+ * @param hpb Pointer to the HypePubSub application.
+ */
+void hpb_cmd_interface_print_resolution_stats(HypePubSub *hpb);
+
+/**
+ * @brief Prints the messages and bytes sent and received by type, the send failures, the rebalances, the
+ *        sizes of the fan-outs and the sizes of the lists of this client.
+ * @param hpb Pointer to the HypePubSub application.
+ */
+void hpb_cmd_interface_print_stats(HypePubSub *hpb);
+
+/**
+ * @brief Sets the number of clients to which the state of the services managed by this client is replicated.
+ * @param hpb Pointer to the HypePubSub application.
+ * @param n_replicas Number of replicas, as typed by the user. 0 disables the replication.
+ */
+void hpb_cmd_interface_set_replicas(HypePubSub *hpb, char *n_replicas);
+
+/**
+ * @brief Sets the time without membership events after which the network changes are applied.
+ * @param hpb Pointer to the HypePubSub application.
+ * @param window_ms Window in milliseconds, as typed by the user. 0 applies each event at once.
+ */
+void hpb_cmd_interface_set_membership_window(HypePubSub *hpb, char *window_ms);
+
+/**
+ * @brief Sets how the services are placed on the hype devices.
+ * @param hpb Pointer to the HypePubSub application.
+ * @param placement "xor" for the device with the closest key or "vnodes" for virtual keys weighted by capacity.
+ */
+void hpb_cmd_interface_set_placement(HypePubSub *hpb, char *placement);
+
+/**
+ * @brief Sets the number of shards among which the subscribers of the hot managed services are split.
+ * @param hpb Pointer to the HypePubSub application.
+ * @param n_shards Number of shards, as typed by the user. 0 disables the sharding.
+ */
+void hpb_cmd_interface_set_shards(HypePubSub *hpb, char *n_shards);
+
+/**
+ * @brief Sets the branching factor of the relay trees through which the managed services send their messages.
+ * @param hpb Pointer to the HypePubSub application.
+ * @param branching Branching factor, as typed by the user. 0 sends each message to every subscriber.
+ */
+void hpb_cmd_interface_set_relay_tree(HypePubSub *hpb, char *branching);
+
+/**
+ * @brief Sends the messages published by this device in a service directly to its subscribers, or through its manager again.
+ * @param hpb Pointer to the HypePubSub application.
+ * @param service_name Name of the service.
+ * @param is_direct Indicates if the messages are sent directly or through the manager.
+ */
+void hpb_cmd_interface_set_direct(HypePubSub *hpb, char *service_name, bool is_direct);
+
+/**
+ * @brief Sets the maximum number of handshakes in progress with the instances found on the network.
+ * @param hpb Pointer to the HypePubSub application.
+ * @param max_resolutions Maximum number of handshakes, as typed by the user.
+ */
+void hpb_cmd_interface_set_resolutions(HypePubSub *hpb, char *max_resolutions);
+
 /**
  * @brief Prints an helper menu with the possible user interactions with the HypePubSub application.
  */
@@ -0,0 +1,63 @@
+
+#ifndef HPB_DEDUP_H_INCLUDED_
+#define HPB_DEDUP_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hpb_seq_window.h"
+
+#define HPB_DEDUP_MAX_PUBLISHERS 16
+
+/**
+ * @brief This struct identifies a published message independently of the manager which delivers it:
+ *        the publisher tag is derived from the key of the publisher, and the publisher sequence
+ *        number is incremented by the publisher on every publish.
+ */
+typedef struct HpbPublishOrigin_
+{
+    uint32_t publisher_tag; /**< Tag of the publisher of the message. */
+    uint32_t publisher_seq; /**< Sequence number assigned to the message by its publisher. */
+} HpbPublishOrigin;
+
+/**
+ * @brief This struct represents the sliding window of the messages received from a publisher.
+ */
+typedef struct HpbDedupPublisher_
+{
+    uint32_t publisher_tag; /**< Tag of the publisher. */
+    HpbSeqWindow window; /**< Sequence numbers received from the publisher. */
+    uint64_t last_use; /**< Value of the use counter of the cache the last time the publisher was seen. */
+} HpbDedupPublisher;
+
+/**
+ * @brief This struct represents a compact cache of the messages recently delivered on a service. It
+ *        keeps a sliding bitmap for each of the last HPB_DEDUP_MAX_PUBLISHERS publishers seen, so that
+ *        a message delivered twice (e.g. by the old and the new manager during a rebalance) is only
+ *        processed once.
+ */
+typedef struct HpbDedupCache_
+{
+    HpbDedupPublisher publishers[HPB_DEDUP_MAX_PUBLISHERS]; /**< Windows of the publishers seen. */
+    size_t n_publishers; /**< Number of publishers seen. */
+    uint64_t use_counter; /**< Counter used to find the least recently seen publisher. */
+    uint64_t n_suppressed; /**< Number of duplicated messages suppressed. */
+} HpbDedupCache;
+
+/**
+ * @brief Forgets the publishers seen by a cache. The number of duplicates suppressed is kept.
+ * @param cache Pointer to the cache.
+ */
+void hpb_dedup_cache_reset(HpbDedupCache *cache);
+
+/**
+ * @brief Registers a message in the cache. The least recently seen publisher is forgotten when
+ *        the cache is full.
+ * @param cache Pointer to the cache.
+ * @param origin Origin of the message.
+ * @return Returns true if the message was already registered and should be suppressed.
+ */
+bool hpb_dedup_cache_is_duplicate(HpbDedupCache *cache, HpbPublishOrigin origin);
+
+#endif /* HPB_DEDUP_H_INCLUDED_ */
@@ -0,0 +1,79 @@
+#ifndef HPB_DIRECT_ROUTE_H_INCLUDED_
+#define HPB_DIRECT_ROUTE_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hpb_clients_list.h"
+#include "sha/sha1.h"
+#include <hype/hype.h>
+
+#define HPB_DIRECT_ROUTE_EXPIRATION_MS 30000 // A list not renewed for this long may miss subscribers
+
+/**
+ * @brief This struct represents the subscribers of a service to which this client publishes directly, as pushed
+ *        by the manager of the service. The list is versioned by the manager, so that a list which arrives late
+ *        does not replace a newer one.
+ */
+typedef struct HpbDirectRoute_
+{
+    char *service_name; /**< Name of the service. */
+    HLByte service_key[SHA1_BLOCK_SIZE]; /**< Key of the service. */
+    HpbClient *manager; /**< Manager from which the subscribers were requested, or NULL. */
+    HpbClientsList *subscribers; /**< Subscribers of the service, as last pushed by the manager. */
+    uint32_t version; /**< Version of the subscribers given by the manager. */
+    bool has_version; /**< Indicates if a list was received from the manager. */
+    bool is_valid; /**< Indicates if the manager accepted the direct publishes, so that the list can be used. */
+    uint64_t received_ms; /**< Time at which the last list was received. */
+    uint64_t requested_ms; /**< Time at which the list was last requested. */
+} HpbDirectRoute;
+
+/**
+ * @brief Allocates space for a route without subscribers.
+ * @param service_name Name of the service, null terminated.
+ * @return Returns a pointer to the created route or NULL if the space could not be allocated.
+ */
+HpbDirectRoute *hpb_direct_route_create(char *service_name);
+
+/**
+ * @brief Sets the manager from which the subscribers are requested. The list of a previous manager is forgotten,
+ *        since each manager has its own versions.
+ * @param route Direct route.
+ * @param manager Hype instance of the manager.
+ * @return Returns true if the manager changed and false otherwise.
+ */
+bool hpb_direct_route_set_manager(HpbDirectRoute *route, HypeInstance *manager);
+
+/**
+ * @brief Replaces the subscribers of the route by a list pushed by the manager, unless the list comes from
+ *        another client or is older than the current one.
+ * @param route Direct route.
+ * @param manager Hype instance which sent the list.
+ * @param version Version of the list.
+ * @param is_refused Indicates if the manager refused the direct publishes, in which case the list is empty.
+ * @param subscribers Subscribers of the service.
+ * @param n_subscribers Number of subscribers.
+ * @param now_ms Current time.
+ * @return Returns true if the list was applied and false if it was discarded.
+ */
+bool hpb_direct_route_update(HpbDirectRoute *route, HypeInstance *manager, uint32_t version, bool is_refused,
+                             HypeInstance *subscribers[], size_t n_subscribers, uint64_t now_ms);
+
+/**
+ * @brief Checks if the messages of the service can be sent directly to the subscribers of the route.
+ * @param route Direct route.
+ * @param manager Hype instance of the current manager of the service.
+ * @param now_ms Current time.
+ * @return Returns true if the list is valid, comes from the current manager and did not expire, and false otherwise.
+ */
+bool hpb_direct_route_is_usable(HpbDirectRoute *route, HypeInstance *manager, uint64_t now_ms);
+
+/**
+ * @brief Deallocates the space previously allocated for the given route.
+ * @param route Pointer to the pointer of the route to be deallocated.
+ */
+void hpb_direct_route_destroy(HpbDirectRoute **route);
+
+#endif /* HPB_DIRECT_ROUTE_H_INCLUDED_ */
@@ -0,0 +1,144 @@
+
+#ifndef HPB_EVENT_LOOP_H_INCLUDED_
+#define HPB_EVENT_LOOP_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "linked_list.h"
+#include "hpb_clock.h"
+
+#define HPB_EVENT_LOOP_MAX_EVENTS 16
+
+typedef void (*HpbEventLoopFdCallback) (int fd, void *arg);
+typedef void (*HpbEventLoopTaskCallback) (void *arg);
+
+/**
+ * @brief This struct represents a file descriptor watched by the event loop.
+ */
+typedef struct HpbEventLoopWatch_
+{
+    int fd; /**< File descriptor being watched for input. */
+    HpbEventLoopFdCallback callback; /**< Callback invoked when the file descriptor is readable. */
+    void *arg; /**< Argument given to the callback. */
+} HpbEventLoopWatch;
+
+/**
+ * @brief This struct represents a one-shot or periodic timer of the event loop.
+ */
+typedef struct HpbEventLoopTimer_
+{
+    int id; /**< Identifier returned when the timer was added. */
+    uint64_t deadline_ms; /**< Time, in the HypePubSub clock, at which the timer fires next. */
+    uint64_t period_ms; /**< Period of the timer, or 0 for one-shot timers. */
+    HpbEventLoopTaskCallback callback; /**< Callback invoked when the timer fires. */
+    void *arg; /**< Argument given to the callback. */
+} HpbEventLoopTimer;
+
+/**
+ * @brief This struct represents a task posted to the event loop, possibly from another thread.
+ */
+typedef struct HpbEventLoopTask_
+{
+    HpbEventLoopTaskCallback callback; /**< Callback to be invoked by the event loop thread. */
+    void *arg; /**< Argument given to the callback. */
+    HpbEventLoopTaskCallback free_arg; /**< Callback which frees the argument if the task is discarded, or NULL. */
+    struct HpbEventLoopTask_ *next; /**< Next task of the queue. */
+} HpbEventLoopTask;
+
+/**
+ * @brief This struct represents an event loop which multiplexes file descriptors, timers and
+ *        tasks posted by other threads (e.g. Hype SDK callbacks) on a single thread.
+ */
+typedef struct HpbEventLoop_
+{
+    int epoll_fd; /**< epoll instance used to wait for events. */
+    int event_fd; /**< eventfd used to wake the loop when tasks are posted. */
+    int timer_fd; /**< timerfd armed with the deadline of the earliest timer. */
+    LinkedList *watches; /**< List of HpbEventLoopWatch elements. */
+    LinkedList *timers; /**< List of HpbEventLoopTimer elements. */
+    int next_timer_id; /**< Identifier to be given to the next timer. */
+    HpbEventLoopTask *tasks_head; /**< First task of the queue of posted tasks. */
+    HpbEventLoopTask *tasks_tail; /**< Last task of the queue of posted tasks. */
+    pthread_mutex_t tasks_mutex; /**< Mutex protecting the queue of posted tasks. */
+    volatile bool is_running; /**< Indicates if the loop should keep running. */
+} HpbEventLoop;
+
+/**
+ * @brief Allocates space for a HpbEventLoop struct and creates its epoll, eventfd and timerfd descriptors.
+ * @return Returns a pointer to the created struct or NULL if the loop could not be created.
+ */
+HpbEventLoop *hpb_event_loop_create();
+
+/**
+ * @brief Watches a file descriptor for input. The callback is invoked on the loop thread whenever
+ *        the file descriptor becomes readable.
+ * @param loop Event loop.
+ * @param fd File descriptor to be watched.
+ * @param callback Callback invoked when the file descriptor is readable.
+ * @param arg Argument given to the callback.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_event_loop_add_fd(HpbEventLoop *loop, int fd, HpbEventLoopFdCallback callback, void *arg);
+
+/**
+ * @brief Stops watching a file descriptor. The file descriptor is not closed.
+ * @param loop Event loop.
+ * @param fd File descriptor to stop watching.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_event_loop_remove_fd(HpbEventLoop *loop, int fd);
+
+/**
+ * @brief Adds a timer to the event loop. Must be called from the loop thread or before the loop runs.
+ * @param loop Event loop.
+ * @param delay_ms Delay, in milliseconds, after which the timer fires for the first time.
+ * @param period_ms Period, in milliseconds, of the timer. Use 0 for a one-shot timer.
+ * @param callback Callback invoked when the timer fires.
+ * @param arg Argument given to the callback.
+ * @return Returns the identifier of the timer (> 0) or -1 in case of failure.
+ */
+int hpb_event_loop_add_timer(HpbEventLoop *loop, uint64_t delay_ms, uint64_t period_ms, HpbEventLoopTaskCallback callback, void *arg);
+
+/**
+ * @brief Cancels a timer previously added to the event loop.
+ * @param loop Event loop.
+ * @param timer_id Identifier of the timer to be cancelled.
+ * @return Returns 0 in case of success and -1 if the timer was not found.
+ */
+int hpb_event_loop_cancel_timer(HpbEventLoop *loop, int timer_id);
+
+/**
+ * @brief Posts a task to be executed on the loop thread. This method is thread-safe and it is the way
+ *        other threads (e.g. the Hype SDK threads) hand work over to the loop.
+ * @param loop Event loop.
+ * @param callback Callback to be invoked on the loop thread.
+ * @param arg Argument given to the callback.
+ * @param free_arg Callback which frees the argument if the loop is destroyed before the task runs, or NULL.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_event_loop_post(HpbEventLoop *loop, HpbEventLoopTaskCallback callback, void *arg, HpbEventLoopTaskCallback free_arg);
+
+/**
+ * @brief Runs the event loop on the calling thread until hpb_event_loop_stop() is called.
+ * @param loop Event loop.
+ * @return Returns 0 if the loop was stopped and -1 in case of failure.
+ */
+int hpb_event_loop_run(HpbEventLoop *loop);
+
+/**
+ * @brief Requests the event loop to stop. This method is thread-safe.
+ * @param loop Event loop.
+ */
+void hpb_event_loop_stop(HpbEventLoop *loop);
+
+/**
+ * @brief Deallocates the space previously allocated for the given HpbEventLoop struct. Tasks which
+ *        were posted but not executed are discarded, and their arguments freed.
+ * @param loop Pointer to the pointer of the HpbEventLoop struct to be deallocated.
+ */
+void hpb_event_loop_destroy(HpbEventLoop **loop);
+
+#endif /* HPB_EVENT_LOOP_H_INCLUDED_ */
@@ -0,0 +1,116 @@
+
+#ifndef HPB_FANOUT_H_INCLUDED_
+#define HPB_FANOUT_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "binary_utils.h"
+#include "hpb_clock.h"
+#include <hype/hype.h>
+
+#define HPB_FANOUT_PARALLEL_THRESHOLD 64 // Fan-outs with less recipients than this are sent serially
+#define HPB_FANOUT_CHUNK_SIZE 32 // Number of recipients handed to a worker at a time
+#define HPB_FANOUT_DEFAULT_WORKERS 4
+#define HPB_FANOUT_MAX_WORKERS 16
+#define HPB_FANOUT_STATS_SAMPLES 1024 // Number of samples kept per fan-out size bucket
+#define HPB_FANOUT_STATS_BUCKETS 4
+
+typedef void (*HpbFanoutSendCallback) (HLByte *frame, size_t frame_size, HypeInstance *destination, void *arg);
+
+/**
+ * @brief This struct keeps the most recent "time to last subscriber" samples of the fan-outs,
+ *        grouped by fan-out size: [1, 16], [17, 256], [257, 4096] and more than 4096 recipients.
+ */
+typedef struct HpbFanoutStats_
+{
+    uint64_t samples_us[HPB_FANOUT_STATS_BUCKETS][HPB_FANOUT_STATS_SAMPLES]; /**< Circular buffers of samples, in microseconds. */
+    size_t n_samples[HPB_FANOUT_STATS_BUCKETS]; /**< Number of valid samples of each bucket. */
+    size_t next_sample[HPB_FANOUT_STATS_BUCKETS]; /**< Index where the next sample of each bucket is written. */
+    uint64_t n_fanouts[HPB_FANOUT_STATS_BUCKETS]; /**< Total number of fan-outs of each bucket. */
+} HpbFanoutStats;
+
+/**
+ * @brief This struct represents the fan-out engine. Fan-outs above HPB_FANOUT_PARALLEL_THRESHOLD
+ *        recipients are split in chunks which are sent by a pool of worker threads, all of them
+ *        sharing the same pre-encoded frame.
+ */
+typedef struct HpbFanout_
+{
+    size_t n_workers; /**< Number of worker threads of the pool. */
+    bool are_workers_started; /**< Workers are only started by the first parallel fan-out. */
+    pthread_t workers[HPB_FANOUT_MAX_WORKERS]; /**< Worker threads. */
+    pthread_mutex_t mutex; /**< Mutex protecting the job being sent. */
+    pthread_cond_t job_cond; /**< Signals the workers that a job is available. */
+    pthread_cond_t done_cond; /**< Signals the caller that all the chunks of the job were sent. */
+    HpbFanoutSendCallback send_callback; /**< Callback used to send the frame to a single recipient. */
+    HLByte *frame; /**< Pre-encoded frame of the current job. */
+    size_t frame_size; /**< Size of the pre-encoded frame of the current job. */
+    void *arg; /**< Argument of the current job, given to the send callback. */
+    HypeInstance **recipients; /**< Recipients of the current job. */
+    size_t n_recipients; /**< Number of recipients of the current job. */
+    size_t next_chunk; /**< Index of the next chunk to be taken by a worker. */
+    size_t n_chunks; /**< Number of chunks of the current job. */
+    size_t n_chunks_done; /**< Number of chunks of the current job already sent. */
+    uint64_t job_id; /**< Incremented for every parallel job. */
+    bool is_stopping; /**< Requests the workers to terminate. */
+    HpbFanoutStats stats; /**< Time to last subscriber statistics. */
+} HpbFanout;
+
+/**
+ * @brief Allocates space for a HpbFanout struct. The worker threads are only started when the first
+ *        parallel fan-out is requested.
+ * @param n_workers Number of worker threads. 0 disables the parallel fan-out.
+ * @param send_callback Callback used to send the frame to a single recipient. It may be invoked from the worker threads.
+ * @return Returns a pointer to the created struct or NULL if the space could not be allocated.
+ */
+HpbFanout *hpb_fanout_create(size_t n_workers, HpbFanoutSendCallback send_callback);
+
+/**
+ * @brief Sets the number of worker threads of a given HpbFanout, before its first parallel fan-out.
+ * @param fanout Fan-out engine.
+ * @param n_workers Number of worker threads, at most HPB_FANOUT_MAX_WORKERS. 0 disables the parallel fan-out.
+ * @return Returns 0 in case of success and -1 if the worker threads were already started.
+ */
+int hpb_fanout_set_workers(HpbFanout *fanout, size_t n_workers);
+
+/**
+ * @brief Sends a pre-encoded frame to a set of recipients. Small sets are sent serially on the calling
+ *        thread. Sets with at least HPB_FANOUT_PARALLEL_THRESHOLD recipients are split in chunks shared by
+ *        the worker threads and the calling thread. This method returns when the frame was handed to all
+ *        the recipients.
+ * @param fanout Fan-out engine.
+ * @param frame Pre-encoded frame to be sent.
+ * @param frame_size Size of the frame.
+ * @param recipients Array of recipients.
+ * @param n_recipients Number of recipients.
+ * @param arg Argument given to the send callback for each recipient, e.g. the state which owns the frame.
+ * @return Returns the number of recipients to which the frame was sent or -1 in case of failure.
+ */
+int hpb_fanout_send(HpbFanout *fanout, HLByte *frame, size_t frame_size, HypeInstance **recipients, size_t n_recipients, void *arg);
+
+/**
+ * @brief Computes the p50 and p99 "time to last subscriber" of a bucket of fan-out sizes.
+ * @param fanout Fan-out engine.
+ * @param bucket Index of the bucket (see HpbFanoutStats).
+ * @param p50_us In-out parameter where the 50th percentile, in microseconds, is stored.
+ * @param p99_us In-out parameter where the 99th percentile, in microseconds, is stored.
+ * @return Returns the number of samples used or 0 if the bucket has no samples.
+ */
+size_t hpb_fanout_get_percentiles(HpbFanout *fanout, int bucket, uint64_t *p50_us, uint64_t *p99_us);
+
+/**
+ * @brief Prints the p50 and p99 "time to last subscriber" of each bucket of fan-out sizes.
+ * @param fanout Fan-out engine.
+ */
+void hpb_fanout_print_stats(HpbFanout *fanout);
+
+/**
+ * @brief Stops the worker threads and deallocates the space previously allocated for the given HpbFanout struct.
+ * @param fanout Pointer to the pointer of the HpbFanout struct to be deallocated.
+ */
+void hpb_fanout_destroy(HpbFanout **fanout);
+
+#endif /* HPB_FANOUT_H_INCLUDED_ */
@@ -0,0 +1,106 @@
+#ifndef HPB_FILTER_H_INCLUDED_
+#define HPB_FILTER_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HPB_FILTER_MAX_LENGTH 255
+#define HPB_FILTER_MAX_INSTRUCTIONS 32
+#define HPB_FILTER_MAX_DEPTH 16
+#define HPB_FILTER_ATTRIBUTE_LENGTH "$length"
+#define HPB_FILTER_ATTRIBUTE_PUBLISHER "$publisher"
+#define HPB_FILTER_ATTRIBUTE_TOPIC "$topic"
+
+/**
+ * @brief This enum represents the opcodes of the filter bytecode, which is evaluated on a stack of booleans.
+ */
+typedef enum {
+    HPB_FILTER_OP_TEST, /**< Pushes the result of a test over a field of the message */
+    HPB_FILTER_OP_NOT, /**< Negates the top of the stack */
+    HPB_FILTER_OP_AND, /**< Replaces the two tops of the stack by their conjunction */
+    HPB_FILTER_OP_OR /**< Replaces the two tops of the stack by their disjunction */
+} HpbFilterOpcode;
+
+/**
+ * @brief This enum represents the comparisons of the tests of a filter.
+ */
+typedef enum {
+    HPB_FILTER_CMP_EXISTS, /**< The field is present */
+    HPB_FILTER_CMP_EQ, /**< == */
+    HPB_FILTER_CMP_NE, /**< != */
+    HPB_FILTER_CMP_LT, /**< < */
+    HPB_FILTER_CMP_LE, /**< <= */
+    HPB_FILTER_CMP_GT, /**< > */
+    HPB_FILTER_CMP_GE, /**< >= */
+    HPB_FILTER_CMP_CONTAINS /**< ~, the field contains the value */
+} HpbFilterComparison;
+
+/**
+ * @brief This enum represents the fields of a message which can be tested by a filter.
+ */
+typedef enum {
+    HPB_FILTER_FIELD_PAYLOAD, /**< A name=value field of the message */
+    HPB_FILTER_FIELD_LENGTH, /**< $length, the length of the message */
+    HPB_FILTER_FIELD_PUBLISHER, /**< $publisher, the publisher tag of the message */
+    HPB_FILTER_FIELD_TOPIC /**< $topic, the topic of a message delivered to a wildcard subscription */
+} HpbFilterField;
+
+/**
+ * @brief This struct represents an instruction of the filter bytecode.
+ */
+typedef struct HpbFilterInstruction_
+{
+    uint8_t opcode; /**< HpbFilterOpcode of the instruction. */
+    uint8_t comparison; /**< HpbFilterComparison of a test. */
+    uint8_t field; /**< HpbFilterField tested. */
+    char *name; /**< Name of the payload field tested, or NULL. */
+    char *value; /**< Value to which the field is compared, or NULL. */
+    double number; /**< Numeric value to which the field is compared, if the value is a number. */
+    bool is_number; /**< Indicates if the value is a number. */
+} HpbFilterInstruction;
+
+/**
+ * @brief This struct represents a filter expression compiled into bytecode, such as
+ *        "type == alarm && (device == 7 || level >= 3)". The filter can be shared by all the
+ *        subscribers of a service with the same expression, so that it runs once per message.
+ */
+typedef struct HpbFilter_
+{
+    char *expression; /**< Expression without the whitespace outside quotes, which identifies the filter. */
+    HpbFilterInstruction code[HPB_FILTER_MAX_INSTRUCTIONS]; /**< Bytecode of the filter, in postfix order. */
+    size_t n_instructions; /**< Number of instructions of the bytecode. */
+    size_t n_subscribers; /**< Number of subscribers which share the filter. */
+    bool last_result; /**< Result of the last evaluation of the filter. */
+} HpbFilter;
+
+/**
+ * @brief Compiles a filter expression. Tests compare a field with a value, which is a word or a quoted string,
+ *        with ==, !=, <, <=, >, >= or ~ (contains), or check that a field is present when no comparison is given.
+ *        Numbers are compared as numbers. Tests are combined with !, && and || and grouped by parentheses.
+ *        Fields are the name=value (or name:value) fields of the message, or the attributes $length, $publisher and $topic.
+ * @param expression Filter expression, null terminated.
+ * @return Returns a pointer to the compiled filter or NULL if the expression is invalid.
+ */
+HpbFilter *hpb_filter_compile(char *expression);
+
+/**
+ * @brief Evaluates a filter over a message, and keeps the result in the filter.
+ * @param filter Compiled filter.
+ * @param msg Message, which does not need to be null terminated.
+ * @param msg_length Length of the message.
+ * @param publisher_tag Publisher tag of the message.
+ * @param topic Topic of the message, or NULL.
+ * @param topic_length Length of the topic.
+ * @return Returns true if the message passes the filter and false otherwise.
+ */
+bool hpb_filter_evaluate(HpbFilter *filter, char *msg, size_t msg_length, uint32_t publisher_tag, char *topic, size_t topic_length);
+
+/**
+ * @brief Deallocates the space previously allocated for the given filter.
+ * @param filter Pointer to the pointer of the filter to be deallocated.
+ */
+void hpb_filter_destroy(HpbFilter **filter);
+
+#endif /* HPB_FILTER_H_INCLUDED_ */
@@ -0,0 +1,135 @@
+
+#ifndef HPB_HANDOVER_H_INCLUDED_
+#define HPB_HANDOVER_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "linked_list.h"
+#include "hpb_constants.h"
+#include "hpb_dedup.h"
+#include "sha/sha1.h"
+#include <hype/hype.h>
+
+#define HPB_HANDOVER_FORWARD_TTL_MS 10000
+#define HPB_HANDOVER_BUFFER_TTL_MS 5000
+#define HPB_HANDOVER_BUFFER_MAX_BYTES (64 * 1024)
+
+/**
+ * @brief This struct records that a service was handed over to a new manager. Publishes received
+ *        by the old manager for that service are forwarded to the new one until the record expires.
+ */
+typedef struct HpbHandoverForward_
+{
+    HLByte service_key[SHA1_BLOCK_SIZE]; /**< Key of the service handed over. */
+    HypeInstance *new_manager; /**< Instance which manages the service now. */
+    uint64_t expiration_ms; /**< Time after which the publishes are no longer forwarded. */
+} HpbHandoverForward;
+
+/**
+ * @brief This struct represents a publish received for a service without subscribers yet. It is
+ *        held until the first subscriber of the service arrives or it expires.
+ */
+typedef struct HpbHandoverPublish_
+{
+    HLByte service_key[SHA1_BLOCK_SIZE]; /**< Key of the service in which the message was published. */
+    HpbPublishOrigin origin; /**< Publisher tag and publisher sequence number of the message. */
+    char *msg; /**< Message published. */
+    size_t msg_length; /**< Length of the message published. */
+    uint64_t expiration_ms; /**< Time after which the message is dropped. */
+} HpbHandoverPublish;
+
+/**
+ * @brief This struct holds the state kept by a HypePubSub application while services move
+ *        between managers: the forwarding records of the old manager and the early publishes
+ *        buffered by the new manager.
+ */
+typedef struct HpbHandover_
+{
+    LinkedList *forwards; /**< List of HpbHandoverForward elements. */
+    LinkedList *publishes; /**< List of HpbHandoverPublish elements, from the oldest to the newest. */
+    size_t n_bytes; /**< Number of bytes of the buffered publishes. */
+    size_t max_bytes; /**< Maximum number of bytes of the buffered publishes. */
+    uint64_t n_forwarded; /**< Number of publishes forwarded to a new manager. */
+    uint64_t n_flushed; /**< Number of buffered publishes delivered to the first subscriber. */
+    uint64_t n_dropped; /**< Number of buffered publishes dropped because they expired or did not fit. */
+    uint64_t n_services_sent; /**< Number of services whose state was transferred to a new manager. */
+    uint64_t n_services_received; /**< Number of services whose state was received from the previous manager. */
+} HpbHandover;
+
+typedef void (*HpbHandoverFlushCallback) (HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, void *arg);
+
+/**
+ * @brief Allocates space for a HpbHandover struct.
+ * @param max_bytes Maximum number of bytes of the buffered publishes.
+ * @return Returns a pointer to the created struct or NULL if the space could not be allocated.
+ */
+HpbHandover *hpb_handover_create(size_t max_bytes);
+
+/**
+ * @brief Records that a service was handed over to a new manager. A previous record of the same
+ *        service is replaced.
+ * @param handover Pointer to the HpbHandover struct.
+ * @param service_key Key of the service handed over.
+ * @param new_manager Instance which manages the service now. It is copied.
+ * @param now_ms Current time.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_handover_add_forward(HpbHandover *handover, HLByte service_key[], HypeInstance *new_manager, uint64_t now_ms);
+
+/**
+ * @brief Removes the forwarding record of a service, if any. It is called when this
+ *        HypePubSub application manages the service again.
+ * @param handover Pointer to the HpbHandover struct.
+ * @param service_key Key of the service.
+ */
+void hpb_handover_remove_forward(HpbHandover *handover, HLByte service_key[]);
+
+/**
+ * @brief Obtains the manager to which the publishes of a service should be forwarded.
+ * @param handover Pointer to the HpbHandover struct.
+ * @param service_key Key of the service.
+ * @param now_ms Current time.
+ * @return Returns the new manager of the service or NULL if it was not recently handed over.
+ */
+HypeInstance *hpb_handover_find_forward(HpbHandover *handover, HLByte service_key[], uint64_t now_ms);
+
+/**
+ * @brief Buffers a publish received for a service without subscribers. The oldest buffered
+ *        publishes are dropped to make room for the new one.
+ * @param handover Pointer to the HpbHandover struct.
+ * @param service_key Key of the service in which the message was published.
+ * @param origin Origin of the message.
+ * @param msg Message published. It is copied.
+ * @param msg_length Length of the message published.
+ * @param now_ms Current time.
+ * @return Returns 0 in case of success and -1 if the message is larger than the buffer.
+ */
+int hpb_handover_buffer_publish(HpbHandover *handover, HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, uint64_t now_ms);
+
+/**
+ * @brief Delivers the buffered publishes of a service, from the oldest to the newest, and removes them.
+ * @param handover Pointer to the HpbHandover struct.
+ * @param service_key Key of the service.
+ * @param callback Callback called for each buffered publish.
+ * @param arg Argument given to the callback.
+ * @return Returns the number of publishes delivered.
+ */
+int hpb_handover_flush(HpbHandover *handover, HLByte service_key[], HpbHandoverFlushCallback callback, void *arg);
+
+/**
+ * @brief Removes the forwarding records and the buffered publishes which expired.
+ * @param handover Pointer to the HpbHandover struct.
+ * @param now_ms Current time.
+ */
+void hpb_handover_expire(HpbHandover *handover, uint64_t now_ms);
+
+/**
+ * @brief Deallocates the space previously allocated for a HpbHandover struct.
+ * @param handover Pointer to the pointer of the HpbHandover struct to be deallocated.
+ */
+void hpb_handover_destroy(HpbHandover **handover);
+
+#endif /* HPB_HANDOVER_H_INCLUDED_ */
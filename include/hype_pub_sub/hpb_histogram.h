@@ -0,0 +1,90 @@
+#ifndef HPB_HISTOGRAM_H_INCLUDED_
+#define HPB_HISTOGRAM_H_INCLUDED_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HPB_HISTOGRAM_MIN_SIGNIFICANT_FIGURES 1
+#define HPB_HISTOGRAM_MAX_SIGNIFICANT_FIGURES 5
+
+/**
+ * @brief This struct represents a high dynamic range histogram of positive values, in the manner of
+ *        HdrHistogram: the values are counted in buckets of exponentially growing width, each split in
+ *        linear sub-buckets, so that any recorded value is known within a fixed number of significant
+ *        figures while the memory only grows with the logarithm of the range.
+ */
+typedef struct HpbHistogram_
+{
+    uint64_t highest_value; /**< Highest value which can be recorded. Higher values are recorded as this one. */
+    int significant_figures; /**< Number of significant decimal figures kept of each value. */
+    int sub_bucket_half_count_magnitude; /**< Base 2 logarithm of half the number of sub-buckets. */
+    uint64_t sub_bucket_half_count; /**< Half the number of sub-buckets of each bucket. */
+    uint64_t sub_bucket_count; /**< Number of sub-buckets of each bucket. */
+    uint64_t sub_bucket_mask; /**< Mask of the values which fall in the first bucket. */
+    int bucket_count; /**< Number of buckets needed to reach the highest value. */
+    size_t counts_length; /**< Number of counters. */
+    uint64_t *counts; /**< Number of values recorded in each sub-bucket. */
+    uint64_t total_count; /**< Number of values recorded. */
+    uint64_t n_clamped; /**< Number of values recorded above the highest value. */
+    uint64_t min; /**< Lowest value recorded, exactly. */
+    uint64_t max; /**< Highest value recorded, exactly, even above the highest value. */
+    double sum; /**< Sum of the values recorded, for the mean. */
+} HpbHistogram;
+
+/**
+ * @brief Allocates space for a histogram.
+ * @param highest_value Highest value which can be recorded, at least 2.
+ * @param significant_figures Number of significant figures kept, from HPB_HISTOGRAM_MIN_SIGNIFICANT_FIGURES
+ *        to HPB_HISTOGRAM_MAX_SIGNIFICANT_FIGURES.
+ * @return Returns a pointer to the created histogram or NULL if the parameters are invalid.
+ */
+HpbHistogram *hpb_histogram_create(uint64_t highest_value, int significant_figures);
+
+/**
+ * @brief Records a value. Values above the highest value are counted as the highest value.
+ * @param histogram Pointer to the histogram.
+ * @param value Value to be recorded.
+ * @return Returns 0 if the value was recorded as is and -1 if it was clamped.
+ */
+int hpb_histogram_record(HpbHistogram *histogram, uint64_t value);
+
+/**
+ * @brief Adds the values recorded by a histogram to another one with the same parameters.
+ * @param histogram Pointer to the histogram to which the values are added.
+ * @param other Pointer to the histogram whose values are added.
+ * @return Returns 0 in case of success and -1 if the histograms have different parameters.
+ */
+int hpb_histogram_add(HpbHistogram *histogram, HpbHistogram *other);
+
+/**
+ * @brief Obtains the value below which a given percentage of the recorded values fall.
+ * @param histogram Pointer to the histogram.
+ * @param percentile Percentage, from 0 to 100.
+ * @return Returns the highest value equivalent to the percentile, within the significant figures, the
+ *         exact maximum for 100, or 0 if no value was recorded.
+ */
+uint64_t hpb_histogram_get_value_at_percentile(HpbHistogram *histogram, double percentile);
+
+/**
+ * @brief Obtains the mean of the recorded values.
+ * @param histogram Pointer to the histogram.
+ * @return Returns the mean, or 0 if no value was recorded.
+ */
+double hpb_histogram_get_mean(HpbHistogram *histogram);
+
+/**
+ * @brief Forgets every value recorded.
+ * @param histogram Pointer to the histogram.
+ */
+void hpb_histogram_reset(HpbHistogram *histogram);
+
+/**
+ * @brief Deallocates the space previously allocated for a histogram.
+ * @param histogram Pointer to the pointer of the histogram to be deallocated.
+ */
+void hpb_histogram_destroy(HpbHistogram **histogram);
+
+#endif /* HPB_HISTOGRAM_H_INCLUDED_ */
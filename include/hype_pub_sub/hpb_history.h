@@ -0,0 +1,70 @@
+
+#ifndef HPB_HISTORY_H_INCLUDED_
+#define HPB_HISTORY_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hpb_dedup.h"
+
+#define HPB_HISTORY_MAX_ENTRIES 64
+#define HPB_HISTORY_MAX_BYTES (64 * 1024)
+
+/**
+ * @brief This struct represents a message kept in the history of a service.
+ */
+typedef struct HpbHistoryEntry_
+{
+    uint32_t seq; /**< Sequence number assigned to the message. */
+    HpbPublishOrigin origin; /**< Publisher tag and publisher sequence number of the message. */
+    char *msg; /**< Message sent. */
+    size_t msg_length; /**< Length of the message sent. */
+} HpbHistoryEntry;
+
+/**
+ * @brief This struct represents a bounded ring buffer with the last messages sent on a service,
+ *        which are resent to the subscribers that missed them.
+ */
+typedef struct HpbHistory_
+{
+    HpbHistoryEntry entries[HPB_HISTORY_MAX_ENTRIES]; /**< Ring buffer of messages. */
+    size_t first; /**< Index of the oldest message. */
+    size_t size; /**< Number of messages kept. */
+    size_t n_bytes; /**< Number of bytes of the messages kept. */
+    size_t max_bytes; /**< Maximum number of bytes of the messages kept. */
+} HpbHistory;
+
+/**
+ * @brief Allocates space for a HpbHistory struct.
+ * @param max_bytes Maximum number of bytes of the messages kept.
+ * @return Returns a pointer to the created struct or NULL if the space could not be allocated.
+ */
+HpbHistory *hpb_history_create(size_t max_bytes);
+
+/**
+ * @brief Adds a message to the history. The oldest messages are dropped to make room for it.
+ * @param history Pointer to the history.
+ * @param seq Sequence number of the message.
+ * @param origin Origin of the message.
+ * @param msg Message to be kept. It is copied.
+ * @param msg_length Length of the message.
+ * @return Returns 0 in case of success and -1 if the message is larger than the history.
+ */
+int hpb_history_add(HpbHistory *history, uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length);
+
+/**
+ * @brief Finds a message of the history by its sequence number.
+ * @param history Pointer to the history.
+ * @param seq Sequence number of the message.
+ * @return Returns the message or NULL if it is not kept.
+ */
+HpbHistoryEntry *hpb_history_find(HpbHistory *history, uint32_t seq);
+
+/**
+ * @brief Deallocates the space previously allocated for a HpbHistory struct.
+ * @param history Pointer to the pointer of the HpbHistory struct to be deallocated.
+ */
+void hpb_history_destroy(HpbHistory **history);
+
+#endif /* HPB_HISTORY_H_INCLUDED_ */
@@ -13,23 +13,31 @@
 #define HPB_HYPE_INTERFACE_H_INCLUDED_
 
 #include <hype/hype.h>
-#include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <time.h>
 #include <unistd.h>
 
-pthread_cond_t cond;
-pthread_mutex_t mutex;
+#include "hpb_event_loop.h"
+#include "hpb_transport.h"
 
 /**
- * @brief This method should be invoked to request the Hype SDK to start.
+ * @brief Creates the transport backed by the Hype SDK. The Hype SDK callbacks are invoked on the SDK
+ *        threads and are forwarded to the given event loop, where they are reported through the callbacks.
+ *        Starting the transport requests the Hype SDK to start, and stopping it requests the SDK to stop.
+ * @param loop Event loop on which the Hype SDK events are processed.
+ * @param callbacks Callbacks through which the Hype SDK events are reported.
+ * @return Returns the transport, or NULL if the Hype transport already exists.
  */
-void hpb_hype_interface_request_to_start();
+HpbTransport *hpb_hype_interface_create_transport(HpbEventLoop *loop, HpbTransportCallbacks callbacks);
 
 /**
- * @brief This method should be invoked to request the Hype SDK to stop.
+ * @brief Sets the capacity announced to the other devices, which weights the share of the services placed
+ *        on this device with the vnodes placement. It must be called before the Hype transport starts.
+ * @param capacity Capacity, from 1 to HPB_CLIENT_MAX_CAPACITY.
+ * @return Returns 0 in case of success and -1 if the capacity is out of range.
  */
-void hpb_hype_interface_request_to_stop();
+int hpb_hype_interface_set_capacity(int capacity);
 
 
 #endif /* HPB_HYPE_INTERFACE_H_INCLUDED_ */
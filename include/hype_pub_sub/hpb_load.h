@@ -0,0 +1,199 @@
+#ifndef HPB_LOAD_H_INCLUDED_
+#define HPB_LOAD_H_INCLUDED_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "linked_list.h"
+#include "hype_pub_sub.h"
+#include "hpb_histogram.h"
+#include "hpb_clock.h"
+
+#define HPB_LOAD_MAGIC "hpbload"
+#define HPB_LOAD_TOPIC_PREFIX "load-"
+#define HPB_LOAD_MAX_TOPIC_NAME 32
+#define HPB_LOAD_MAX_TOPICS 1024
+#define HPB_LOAD_MAX_HEADER_SIZE 192
+#define HPB_LOAD_MAX_MSG_SIZE 65536
+#define HPB_LOAD_DEFAULT_MSG_SIZE 128
+#define HPB_LOAD_MAX_BURST 1000 // Messages published by a tick at most, so that a late generator does not block its loop
+#define HPB_LOAD_TICK_MS 1
+#define HPB_LOAD_HISTOGRAM_HIGHEST_US (60 * 1000000ULL) // Latencies above one minute are counted as one minute
+#define HPB_LOAD_HISTOGRAM_FIGURES 3
+
+/**
+ * @brief This struct represents a load generator, which publishes at a constant rate in a set of topics,
+ *        named HPB_LOAD_TOPIC_PREFIX followed by their index, in turn. Each message carries the tag of the
+ *        generator, its number of topics and of messages scheduled, its topic, its sequence number in the topic,
+ *        the number of messages of the topic given up so far, the time at which it was scheduled and the time at
+ *        which it was actually published. A publish is given up when the completion callback of the HypePubSub
+ *        application reports that the manager of its topic never received it.
+ *        The schedule does not depend on when the previous messages went out, so a generator which falls
+ *        behind publishes the late messages at once, stamped with their scheduled time. Measuring the latency
+ *        from the scheduled time corrects the coordinated omission: a stall of the publisher counts against
+ *        every message it delayed, and not only against the one which was waiting.
+ */
+typedef struct HpbLoadGenerator_
+{
+    uint32_t tag; /**< Tag of the generator, which tells apart the sequence numbers of several generators. */
+    double rate; /**< Messages published per second. */
+    size_t n_topics; /**< Number of topics. */
+    size_t msg_size; /**< Size of each message, at least the size of its header. */
+    uint64_t n_scheduled; /**< Number of messages to be published. */
+    uint64_t start_us; /**< Time at which the first message is scheduled. */
+    uint64_t n_sent; /**< Number of messages published. */
+    uint64_t n_failed; /**< Number of messages published which were given up. */
+    uint64_t *n_failed_by_topic; /**< Number of messages of each topic which were given up. */
+    HLByte *topic_keys; /**< Keys of the topics, SHA1_BLOCK_SIZE bytes each, which tell the topic of a completion. */
+    uint64_t max_lag_us; /**< Highest delay between the scheduled and the actual publish of a message. */
+    char *msg; /**< Buffer in which the messages are written. */
+} HpbLoadGenerator;
+
+/**
+ * @brief This struct holds what a sink received in a topic from a generator.
+ */
+typedef struct HpbLoadTopicStats_
+{
+    uint64_t n_received; /**< Number of messages received. */
+    uint64_t next_seq; /**< Sequence number following the highest one received. */
+    uint64_t n_reordered; /**< Number of messages received after one with a higher sequence number. */
+    uint64_t n_failed; /**< Highest number of messages of the topic which the generator gave up, as carried by the messages. */
+} HpbLoadTopicStats;
+
+/**
+ * @brief This struct holds what a sink received from a generator, in each topic.
+ */
+typedef struct HpbLoadSource_
+{
+    uint32_t tag; /**< Tag of the generator. */
+    size_t n_topics; /**< Number of topics of the generator. */
+    uint64_t n_scheduled; /**< Number of messages scheduled by the generator, in all its topics. */
+    HpbLoadTopicStats *topics; /**< Statistics of each topic of the sink. */
+} HpbLoadSource;
+
+/**
+ * @brief This struct represents a load sink, which subscribes the topics of the generators and measures the
+ *        throughput, the loss and the end to end latency of the messages. The latency is only meaningful if
+ *        the generators and the sink share a monotonic clock, as the nodes of a machine or of a simulation do.
+ */
+typedef struct HpbLoadSink_
+{
+    size_t n_topics; /**< Number of topics subscribed. */
+    LinkedList *sources; /**< HpbLoadSource elements of the generators heard. */
+    HpbHistogram *latency; /**< Latency from the scheduled publish, corrected for coordinated omission, in microseconds. */
+    HpbHistogram *uncorrected_latency; /**< Latency from the actual publish, in microseconds. */
+    uint64_t n_received; /**< Number of load messages received. */
+    uint64_t bytes_received; /**< Number of bytes of the load messages received. */
+    uint64_t n_invalid; /**< Number of messages received which are not load messages. */
+    uint64_t first_us; /**< Time at which the first load message was received. */
+    uint64_t last_us; /**< Time at which the last load message was received. */
+} HpbLoadSink;
+
+/**
+ * @brief Allocates space for a load generator.
+ * @param tag Tag of the generator.
+ * @param rate Messages published per second, above 0.
+ * @param n_topics Number of topics, from 1 to HPB_LOAD_MAX_TOPICS.
+ * @param duration_us Time during which the messages are published.
+ * @param msg_size Size of each message, up to HPB_LOAD_MAX_MSG_SIZE. Smaller sizes than the header are raised to it.
+ * @return Returns a pointer to the created generator, whose first message is scheduled now, or NULL if the
+ *         parameters are invalid.
+ */
+HpbLoadGenerator *hpb_load_generator_create(uint32_t tag, double rate, size_t n_topics, uint64_t duration_us, size_t msg_size);
+
+/**
+ * @brief Publishes, through the current HypePubSub application, the messages scheduled up to now which were
+ *        not published yet, at most HPB_LOAD_MAX_BURST of them. The times are taken from the HypePubSub clock.
+ * @param generator Pointer to the generator.
+ * @return Returns the number of messages published.
+ */
+size_t hpb_load_generator_tick(HpbLoadGenerator *generator);
+
+/**
+ * @brief Checks if a generator published all its messages.
+ * @param generator Pointer to the generator.
+ * @return Returns true if the generator is done and false otherwise.
+ */
+bool hpb_load_generator_is_done(HpbLoadGenerator *generator);
+
+/**
+ * @brief Counts a publish given up in the topic of a generator. Meant to be called from the publish completion
+ *        callback of the HypePubSub application, so that the next messages of the topic carry the failure.
+ * @param generator Pointer to the generator.
+ * @param service_key Key of the topic of the publish.
+ * @param success Whether the publish was delivered.
+ * @return Returns 0 if the failed publish is of one of the topics of the generator and -1 otherwise.
+ */
+int hpb_load_generator_on_publish_completion(HpbLoadGenerator *generator, HLByte service_key[], bool success);
+
+/**
+ * @brief Prints the messages published by a generator and how far behind its schedule it fell.
+ * @param out Stream on which the report is printed.
+ * @param generator Pointer to the generator.
+ */
+void hpb_load_generator_print_report(FILE *out, HpbLoadGenerator *generator);
+
+/**
+ * @brief Deallocates the space previously allocated for a load generator.
+ * @param generator Pointer to the pointer of the generator to be deallocated.
+ */
+void hpb_load_generator_destroy(HpbLoadGenerator **generator);
+
+/**
+ * @brief Allocates space for a load sink.
+ * @param n_topics Number of topics, from 1 to HPB_LOAD_MAX_TOPICS.
+ * @return Returns a pointer to the created sink or NULL if the number of topics is invalid.
+ */
+HpbLoadSink *hpb_load_sink_create(size_t n_topics);
+
+/**
+ * @brief Subscribes the topics of a sink through the current HypePubSub application.
+ * @param sink Pointer to the sink.
+ * @return Returns 0 in case of success and -1 if a subscription failed.
+ */
+int hpb_load_sink_subscribe(HpbLoadSink *sink);
+
+/**
+ * @brief Measures a message received now, on the HypePubSub clock. Meant to be called from the callback of
+ *        the messages received.
+ * @param sink Pointer to the sink.
+ * @param msg Message received.
+ * @param msg_length Length of the message.
+ * @return Returns 0 if the message is a load message of one of the topics of the sink and -1 otherwise.
+ */
+int hpb_load_sink_receive(HpbLoadSink *sink, char *msg, size_t msg_length);
+
+/**
+ * @brief Obtains the number of messages lost on the way to a sink: the messages scheduled by the generators
+ *        heard in the topics of the sink, including the topics nothing was received from, which were neither
+ *        received nor reported as failed by the generator. The total scheduled is only reached once the
+ *        generators are done, and the failures after the last message received in a topic are counted as lost.
+ * @param sink Pointer to the sink.
+ * @return Returns the number of messages lost.
+ */
+uint64_t hpb_load_sink_get_lost(HpbLoadSink *sink);
+
+/**
+ * @brief Obtains the number of messages which the generators heard could not publish in the topics of a sink.
+ * @param sink Pointer to the sink.
+ * @return Returns the number of messages which failed to be published.
+ */
+uint64_t hpb_load_sink_get_failed(HpbLoadSink *sink);
+
+/**
+ * @brief Prints the throughput, the loss and the percentiles of the latency measured by a sink.
+ * @param out Stream on which the report is printed.
+ * @param sink Pointer to the sink.
+ */
+void hpb_load_sink_print_report(FILE *out, HpbLoadSink *sink);
+
+/**
+ * @brief Deallocates the space previously allocated for a load sink.
+ * @param sink Pointer to the pointer of the sink to be deallocated.
+ */
+void hpb_load_sink_destroy(HpbLoadSink **sink);
+
+#endif /* HPB_LOAD_H_INCLUDED_ */
@@ -0,0 +1,90 @@
+#ifndef HPB_MEMBERSHIP_H_INCLUDED_
+#define HPB_MEMBERSHIP_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "linked_list.h"
+#include "hpb_constants.h"
+#include <hype/hype.h>
+
+#define HPB_MEMBERSHIP_DEFAULT_WINDOW_MS 250
+#define HPB_MEMBERSHIP_MAX_DELAY_MS 2000
+#define HPB_MEMBERSHIP_HOLD_DOWN_MS 10000
+
+/**
+ * @brief This struct represents the net change of membership of a Hype instance: the state reported
+ *        by its last event, which cancels the previous events of the same instance.
+ */
+typedef struct HpbMembershipChange_
+{
+    HypeInstance *instance; /**< Instance which was resolved or lost. */
+    bool is_resolved; /**< Indicates if the instance was resolved, or lost otherwise. */
+    bool is_held; /**< Indicates if the change was already held back because the instance was lost recently. */
+    uint64_t changed_ms; /**< Time of the last event of the instance, or of its loss for the lost list. */
+} HpbMembershipChange;
+
+/**
+ * @brief This struct coalesces the membership events reported by the Hype SDK, so that a burst of
+ *        events leads to a single rebalance of the services over their net change. Instances which
+ *        come back shortly after being lost are only added once they stayed for HPB_MEMBERSHIP_HOLD_DOWN_MS,
+ *        so that a flapping instance does not move services back and forth.
+ */
+typedef struct HpbMembership_
+{
+    LinkedList *changes; /**< List of HpbMembershipChange elements waiting to be applied. */
+    LinkedList *lost; /**< List of HpbMembershipChange elements of the instances lost recently. */
+    uint64_t window_ms; /**< Time without events after which the changes are applied. */
+    uint64_t first_change_ms; /**< Time of the first event since the changes were last applied. */
+    uint64_t last_change_ms; /**< Time of the last event. */
+    uint64_t n_events; /**< Number of membership events reported. */
+    uint64_t n_applies; /**< Number of times the changes were applied. */
+    uint64_t n_held; /**< Number of instances held back because they were lost recently. */
+} HpbMembership;
+
+/**
+ * @brief Callback called for each membership change applied.
+ * @param instance Instance which was resolved or lost.
+ * @param is_resolved Indicates if the instance was resolved, or lost otherwise.
+ * @param arg Argument given to hpb_membership_apply().
+ */
+typedef void (*HpbMembershipApplyCallback)(HypeInstance *instance, bool is_resolved, void *arg);
+
+/**
+ * @brief Allocates space for a HpbMembership struct without changes.
+ * @param window_ms Time without events after which the changes are applied.
+ * @return Returns a pointer to the created struct or NULL if the space could not be allocated.
+ */
+HpbMembership *hpb_membership_create(uint64_t window_ms);
+
+/**
+ * @brief Registers a membership event. It replaces the change waiting for the same instance, if any.
+ * @param membership Pointer to the membership struct.
+ * @param instance Instance which was resolved or lost.
+ * @param is_resolved Indicates if the instance was resolved, or lost otherwise.
+ * @param now_ms Current time.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_membership_add_event(HpbMembership *membership, HypeInstance *instance, bool is_resolved, uint64_t now_ms);
+
+/**
+ * @brief Applies the changes once no event was registered for the window, or once the first change waited
+ *        for HPB_MEMBERSHIP_MAX_DELAY_MS, so that a steady stream of events cannot postpone them forever.
+ *        Instances resolved less than HPB_MEMBERSHIP_HOLD_DOWN_MS after being lost stay waiting.
+ * @param membership Pointer to the membership struct.
+ * @param now_ms Current time.
+ * @param callback Callback called for each change applied.
+ * @param arg Argument passed to the callback.
+ * @return Returns the number of changes applied.
+ */
+size_t hpb_membership_apply(HpbMembership *membership, uint64_t now_ms, HpbMembershipApplyCallback callback, void *arg);
+
+/**
+ * @brief Deallocates the space previously allocated for the membership struct and its changes.
+ * @param membership Pointer to the pointer of the membership struct to be deallocated.
+ */
+void hpb_membership_destroy(HpbMembership **membership);
+
+#endif /* HPB_MEMBERSHIP_H_INCLUDED_ */
@@ -0,0 +1,207 @@
+#ifndef HPB_METRICS_H_INCLUDED_
+#define HPB_METRICS_H_INCLUDED_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hpb_event_loop.h"
+
+#define HPB_METRICS_N_MESSAGE_TYPES 12 // Every MessageType, INVALID included
+#define HPB_METRICS_MAX_SHARDS 32 // Threads beyond this number share the shards of the first ones
+#define HPB_METRICS_HISTOGRAM_N_BUCKETS 14 // Buckets of the values up to 1, 2, 4, ... 8192, besides +Inf
+#define HPB_METRICS_MAX_CLIENTS 8
+#define HPB_METRICS_MAX_REQUEST 1024
+
+/**
+ * @brief Counters of the metrics. The first ones are kept apart for each MessageType.
+ */
+typedef enum HpbMetricsCounter_
+{
+    HPB_METRICS_MESSAGES_IN, /**< Messages received. */
+    HPB_METRICS_BYTES_IN, /**< Bytes of the messages received. */
+    HPB_METRICS_MESSAGES_OUT, /**< Messages handed to the transport, retries included. */
+    HPB_METRICS_BYTES_OUT, /**< Bytes of the messages handed to the transport. */
+    HPB_METRICS_SEND_FAILURES, /**< Messages which the transport failed to deliver. */
+    HPB_METRICS_SEND_GIVE_UPS, /**< Messages given up after all their attempts failed. */
+    HPB_METRICS_REBALANCES, /**< Changes of membership which moved services between the clients. */
+    HPB_METRICS_N_COUNTERS
+} HpbMetricsCounter;
+
+#define HPB_METRICS_N_TYPED_COUNTERS (HPB_METRICS_BYTES_OUT + 1) // The counters kept apart for each MessageType
+
+/**
+ * @brief Gauges of the metrics, which are the sizes of the lists of a HypePubSub application.
+ */
+typedef enum HpbMetricsGauge_
+{
+    HPB_METRICS_NETWORK_CLIENTS, /**< Clients in the network. */
+    HPB_METRICS_MANAGED_SERVICES, /**< Services managed. */
+    HPB_METRICS_SUBSCRIPTIONS, /**< Services subscribed. */
+    HPB_METRICS_REPLICAS, /**< Replicas of the services managed by other clients. */
+    HPB_METRICS_SHARDS, /**< Shards of the services managed by other clients. */
+    HPB_METRICS_DIRECT_ROUTES, /**< Services published directly to their subscribers. */
+    HPB_METRICS_RETRY_ENTRIES, /**< Messages waiting to be delivered or retried. */
+    HPB_METRICS_RETRY_BYTES, /**< Bytes of the messages waiting to be delivered or retried. */
+    HPB_METRICS_PENDING_RESOLUTIONS, /**< Instances waiting to be resolved. */
+    HPB_METRICS_MEMBERSHIP_CHANGES, /**< Membership changes waiting to be applied. */
+    HPB_METRICS_N_GAUGES
+} HpbMetricsGauge;
+
+/**
+ * @brief Histograms of the metrics, with buckets of powers of two.
+ */
+typedef enum HpbMetricsHistogram_
+{
+    HPB_METRICS_FANOUT_SIZE, /**< Recipients of each message of the managed services. */
+    HPB_METRICS_N_HISTOGRAMS
+} HpbMetricsHistogram;
+
+#define HPB_METRICS_HISTOGRAM_SLOTS (HPB_METRICS_HISTOGRAM_N_BUCKETS + 2) // Buckets, sum and count of each histogram
+#define HPB_METRICS_N_SLOTS (HPB_METRICS_N_COUNTERS * HPB_METRICS_N_MESSAGE_TYPES + HPB_METRICS_N_HISTOGRAMS * HPB_METRICS_HISTOGRAM_SLOTS)
+
+/**
+ * @brief This struct holds the counters and histograms incremented by a thread, or by the threads which share it.
+ */
+typedef struct HpbMetricsShard_
+{
+    uint64_t slots[HPB_METRICS_N_SLOTS]; /**< Counters by type and then buckets, sum and count of the histograms. */
+} HpbMetricsShard;
+
+/**
+ * @brief This struct represents a registry of metrics. Each thread increments the counters of its own shard,
+ *        so that the fan-out workers do not contend on a cache line, and the shards are added up when the
+ *        metrics are read. Nothing is computed nor formatted until then.
+ */
+typedef struct HpbMetrics_
+{
+    HpbMetricsShard *shards[HPB_METRICS_MAX_SHARDS]; /**< Shards of the threads, allocated when a thread first counts. */
+    int64_t gauges[HPB_METRICS_N_GAUGES]; /**< Values of the gauges. */
+} HpbMetrics;
+
+/**
+ * @brief This struct holds the values of a histogram read from the shards.
+ */
+typedef struct HpbMetricsHistogramValues_
+{
+    uint64_t buckets[HPB_METRICS_HISTOGRAM_N_BUCKETS]; /**< Values up to each power of two, and above the previous one. */
+    uint64_t sum; /**< Sum of the values. */
+    uint64_t count; /**< Number of values, those above the last bucket included. */
+} HpbMetricsHistogramValues;
+
+/**
+ * @brief Callback which updates the gauges of a registry and returns it, called when the metrics are scraped.
+ */
+typedef HpbMetrics *(*HpbMetricsCollectCallback) ();
+
+/**
+ * @brief This struct represents an endpoint which serves the metrics in the Prometheus text format on a Unix
+ *        socket. It only costs a watched file descriptor until a client connects: the metrics are collected
+ *        and formatted once a client sends a request, as a HTTP response if it is a HTTP GET and as plain text
+ *        otherwise, and the connection is closed.
+ */
+typedef struct HpbMetricsExporter_
+{
+    HpbEventLoop *loop; /**< Event loop which watches the socket and the clients. */
+    int fd; /**< Listening socket. */
+    char *path; /**< Path of the socket, removed when the exporter is destroyed. */
+    HpbMetricsCollectCallback collect; /**< Callback which returns the metrics to be served. */
+    int clients[HPB_METRICS_MAX_CLIENTS]; /**< Connections waiting for their request, oldest first. */
+    size_t n_clients; /**< Number of connections waiting for their request. */
+    uint64_t n_scrapes; /**< Number of requests served. */
+} HpbMetricsExporter;
+
+/**
+ * @brief Allocates space for a registry of metrics, all of them at 0.
+ * @return Returns a pointer to the created registry.
+ */
+HpbMetrics *hpb_metrics_create();
+
+/**
+ * @brief Adds a value to a counter. It can be called from any thread.
+ * @param metrics Pointer to the registry.
+ * @param counter Counter to which the value is added.
+ * @param value Value to be added.
+ */
+void hpb_metrics_add(HpbMetrics *metrics, HpbMetricsCounter counter, uint64_t value);
+
+/**
+ * @brief Adds a value to a counter kept apart for each MessageType. It can be called from any thread.
+ * @param metrics Pointer to the registry.
+ * @param counter Counter to which the value is added, one of the first HPB_METRICS_N_TYPED_COUNTERS.
+ * @param type MessageType of the message counted.
+ * @param value Value to be added.
+ */
+void hpb_metrics_add_by_type(HpbMetrics *metrics, HpbMetricsCounter counter, int type, uint64_t value);
+
+/**
+ * @brief Records a value in a histogram. It can be called from any thread.
+ * @param metrics Pointer to the registry.
+ * @param histogram Histogram in which the value is recorded.
+ * @param value Value to be recorded.
+ */
+void hpb_metrics_observe(HpbMetrics *metrics, HpbMetricsHistogram histogram, uint64_t value);
+
+/**
+ * @brief Sets the value of a gauge.
+ * @param metrics Pointer to the registry.
+ * @param gauge Gauge to be set.
+ * @param value Value of the gauge.
+ */
+void hpb_metrics_set_gauge(HpbMetrics *metrics, HpbMetricsGauge gauge, int64_t value);
+
+/**
+ * @brief Reads a counter, adding up the shards of all the threads.
+ * @param metrics Pointer to the registry.
+ * @param counter Counter to be read.
+ * @param type MessageType of the counters kept apart for each of them, or -1 for the sum of all the types.
+ * @return Returns the value of the counter.
+ */
+uint64_t hpb_metrics_get_counter(HpbMetrics *metrics, HpbMetricsCounter counter, int type);
+
+/**
+ * @brief Reads a histogram, adding up the shards of all the threads.
+ * @param metrics Pointer to the registry.
+ * @param histogram Histogram to be read.
+ * @param values In-out parameter where the values of the histogram are stored.
+ */
+void hpb_metrics_get_histogram(HpbMetrics *metrics, HpbMetricsHistogram histogram, HpbMetricsHistogramValues *values);
+
+/**
+ * @brief Prints the metrics in a table.
+ * @param out Stream on which the metrics are printed.
+ * @param metrics Pointer to the registry.
+ */
+void hpb_metrics_print(FILE *out, HpbMetrics *metrics);
+
+/**
+ * @brief Prints the metrics in the Prometheus text exposition format.
+ * @param out Stream on which the metrics are printed.
+ * @param metrics Pointer to the registry.
+ */
+void hpb_metrics_print_prometheus(FILE *out, HpbMetrics *metrics);
+
+/**
+ * @brief Deallocates the space previously allocated for a registry of metrics and its shards.
+ * @param metrics Pointer to the pointer of the registry to be deallocated.
+ */
+void hpb_metrics_destroy(HpbMetrics **metrics);
+
+/**
+ * @brief Creates an endpoint which serves the metrics on a Unix socket, replacing any file at its path.
+ * @param loop Event loop which watches the socket.
+ * @param path Path of the socket.
+ * @param collect Callback which returns the metrics to be served.
+ * @return Returns a pointer to the created exporter or NULL if the socket could not be created.
+ */
+HpbMetricsExporter *hpb_metrics_exporter_create(HpbEventLoop *loop, const char *path, HpbMetricsCollectCallback collect);
+
+/**
+ * @brief Closes the socket and the connections of an exporter, removes its socket file and deallocates it.
+ * @param exporter Pointer to the pointer of the exporter to be deallocated.
+ */
+void hpb_metrics_exporter_destroy(HpbMetricsExporter **exporter);
+
+#endif /* HPB_METRICS_H_INCLUDED_ */
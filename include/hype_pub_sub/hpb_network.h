@@ -10,6 +10,36 @@
 #include "hpb_constants.h"
 #include "binary_utils.h"
 
+#define HPB_NETWORK_VNODES_PER_CAPACITY 64
+#define HPB_NETWORK_LOAD_SAMPLES 4096
+
+/**
+ * @brief This enum represents the ways in which the services are placed at the Hype devices.
+ *        All the devices of a network must use the same placement.
+ */
+typedef enum {
+    HPB_PLACEMENT_XOR, /**< The manager of a service is the device whose key is closest to the service key */
+    HPB_PLACEMENT_VNODES /**< The manager of a service is the owner of the next virtual key of a ring, with virtual keys in proportion to capacity */
+} HpbPlacement;
+
+/**
+ * @brief This struct represents a virtual key of a Hype device in the ring of the virtual nodes placement.
+ */
+typedef struct HpbNetworkVnode_
+{
+    HLByte key[SHA1_BLOCK_SIZE]; /**< Virtual key, the hash of the key of the device and of the index of the virtual key. */
+    HpbClient *client; /**< Device which owns the virtual key. */
+} HpbNetworkVnode;
+
+/**
+ * @brief This struct represents the share of the key space managed by a Hype device.
+ */
+typedef struct HpbNetworkLoad_
+{
+    HpbClient *client; /**< Device. */
+    size_t n_keys; /**< Number of sample keys managed by the device. */
+    double skew; /**< Share of the sample keys managed by the device over its share of the total capacity. 1 is a perfect balance. */
+} HpbNetworkLoad;
 
 /**
  * @brief This struct represents an HpbNetwork manager.
@@ -18,6 +48,10 @@ typedef struct HpbNetwork_
 {
     HpbClient *own_client; /**< Pointer to the HpbClient of this application */
     HpbClientsList *network_clients; /**< Pointer to a HpbClientsList containing all the Hype devices found in the network */
+    HpbPlacement placement; /**< Placement of the services at the devices. */
+    HpbNetworkVnode *ring; /**< Virtual keys of the devices sorted by key, or NULL if they were not built. */
+    size_t ring_size; /**< Number of virtual keys of the ring. */
+    bool is_ring_dirty; /**< Indicates if the devices changed since the ring was built. */
 } HpbNetwork;
 
 /**
@@ -28,14 +62,61 @@ typedef struct HpbNetwork_
 HpbNetwork *hpb_network_create(HypeInstance *own_instance);
 
 /**
- * @brief Returns the ID of the hype device which is responsible for a given service. The hype device with the key closest to
- *        to the service key is responsible for that service.
+ * @brief Adds a Hype device to the network.
+ * @param net Pointer to the HpbNetwork.
+ * @param instance Hype instance of the device.
+ * @return Returns a pointer to the HpbClient of the device.
+ */
+HpbClient *hpb_network_add_client(HpbNetwork *net, HypeInstance *instance);
+
+/**
+ * @brief Removes a Hype device from the network.
+ * @param net Pointer to the HpbNetwork.
+ * @param instance Hype instance of the device.
+ * @return Returns >=0 if the device was removed and <0 otherwise.
+ */
+int hpb_network_remove_client(HpbNetwork *net, HypeInstance *instance);
+
+/**
+ * @brief Sets the placement of the services at the Hype devices.
+ * @param net Pointer to the HpbNetwork.
+ * @param placement Placement of the services.
+ */
+void hpb_network_set_placement(HpbNetwork *net, HpbPlacement placement);
+
+/**
+ * @brief Returns the ID of the hype device which is responsible for a given service. With the XOR placement the hype device
+ *        with the key closest to the service key is responsible for that service. With the virtual nodes placement it is the
+ *        owner of the first virtual key following the service key in the ring, so that each device gets a share of the
+ *        services in proportion to its capacity.
  * @param net Pointer to the HpbNetwork.
  * @param service_key Key of the service to be analyzed.
  * @return Returns a byte array containing the ID of the hype device responsible for the service.
  */
 HypeInstance *hpb_network_get_service_manager_id(HpbNetwork *net, HLByte service_key[SHA1_BLOCK_SIZE]);
 
+/**
+ * @brief Returns the hype devices with the keys closest to a given service, this device included, from
+ *        the closest one, which is the manager of the service, to the farthest one. With the virtual nodes
+ *        placement they are the distinct owners of the virtual keys following the service key in the ring.
+ * @param net Pointer to the HpbNetwork.
+ * @param service_key Key of the service to be analyzed.
+ * @param instances Array where the instances of the closest devices are stored.
+ * @param max_instances Maximum number of instances to be stored.
+ * @return Returns the number of instances stored.
+ */
+size_t hpb_network_get_closest_instances(HpbNetwork *net, HLByte service_key[SHA1_BLOCK_SIZE], HypeInstance *instances[], size_t max_instances);
+
+/**
+ * @brief Measures the balance of the placement, from the share of HPB_NETWORK_LOAD_SAMPLES sample keys managed by
+ *        each hype device, this device included, compared to its share of the total capacity.
+ * @param net Pointer to the HpbNetwork.
+ * @param loads Array where the load of each device is stored, or NULL.
+ * @param max_loads Maximum number of loads to be stored.
+ * @return Returns the load skew of the network: the highest skew of its devices.
+ */
+double hpb_network_get_load_skew(HpbNetwork *net, HpbNetworkLoad loads[], size_t max_loads);
+
 /**
  * @brief Updates the list of known hype devices according to the InstanceFound and InstanceLost.
  * @param net Pointer to the HpbNetwork.
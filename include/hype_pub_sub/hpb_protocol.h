@@ -5,10 +5,45 @@
 #include <stdarg.h>
 
 #include "hpb_constants.h"
+#include "hpb_seq_window.h"
+#include "hpb_dedup.h"
+#include "hpb_relay_tree.h"
 #include "hype_pub_sub.h"
 
 #define MESSAGE_TYPE_BYTE_SIZE 1
 
+// The high bits of the message type byte carry flags, so that old packets keep their meaning
+#define HPB_PROTOCOL_MESSAGE_TYPE_MASK 0x0F
+#define HPB_PROTOCOL_FLAG_RETAIN 0x80
+#define HPB_PROTOCOL_FLAG_UNKNOWN 0x80 // Same bit as the retain flag, which is only set on publish messages
+#define HPB_PROTOCOL_FLAG_REPLICA 0x40
+#define HPB_PROTOCOL_FLAG_DIRECT 0x40 // Same bit as the replica flag, which is only set on handover messages
+#define HPB_PROTOCOL_FLAG_WILDCARD 0x20
+#define HPB_PROTOCOL_FLAG_FILTER 0x10
+#define HPB_PROTOCOL_FLAG_NO_ECHO 0x10 // Same bit as the filter flag, which is only set on subscribe messages
+
+#define HPB_PROTOCOL_SEQ_SIZE 4
+#define HPB_PROTOCOL_ORIGIN_SIZE 8
+#define HPB_PROTOCOL_NACK_COUNT_SIZE 1
+#define HPB_PROTOCOL_NACK_RANGE_SIZE (2 * HPB_PROTOCOL_SEQ_SIZE)
+#define HPB_PROTOCOL_NACK_MAX_RANGES 16
+#define HPB_PROTOCOL_HANDOVER_COUNT_SIZE 4
+#define HPB_PROTOCOL_HANDOVER_LENGTH_SIZE 4
+#define HPB_PROTOCOL_HANDOVER_ID_SIZE 1
+#define HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE 4
+#define HPB_PROTOCOL_PATTERN_LENGTH_SIZE 2
+#define HPB_PROTOCOL_FILTER_LENGTH_SIZE 2
+#define HPB_PROTOCOL_RELAY_BRANCHING_SIZE 1
+#define HPB_PROTOCOL_RELAY_COUNT_SIZE 4
+#define HPB_PROTOCOL_SUBSCRIBER_LIST_VERSION_SIZE 4
+#define HPB_PROTOCOL_SUBSCRIBER_LIST_COUNT_SIZE 4
+#define HPB_PROTOCOL_SUBSCRIBER_LIST_REFUSED 0xFFFFFFFF // Count of the lists of the services which cannot be published directly
+#define HPB_PROTOCOL_RELAY_HEADER_SIZE (MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_SEQ_SIZE + HPB_PROTOCOL_ORIGIN_SIZE \
+                                        + HPB_PROTOCOL_RELAY_BRANCHING_SIZE + HPB_PROTOCOL_RELAY_COUNT_SIZE)
+#define HPB_PROTOCOL_HANDOVER_SERVICE_HEADER_SIZE (SHA1_BLOCK_SIZE + HPB_PROTOCOL_SEQ_SIZE + HPB_PROTOCOL_ORIGIN_SIZE \
+                                                   + HPB_PROTOCOL_HANDOVER_LENGTH_SIZE + HPB_PROTOCOL_PATTERN_LENGTH_SIZE \
+                                                   + HPB_PROTOCOL_HANDOVER_COUNT_SIZE)
+
 /**
  * @brief This struct represents the message types of the HpbProtocol packets.
  */
@@ -17,6 +52,13 @@ typedef enum {
     UNSUBSCRIBE_SERVICE, /**< Represents a packet which contains a unsubscribe message */
     PUBLISH, /**< Represents a packet which contains a publish message */
     INFO, /**< Represents a packet which contains a info message */
+    NACK, /**< Represents a packet which contains the ranges of info messages missed by a subscriber */
+    HANDOVER, /**< Represents a packet which contains the state of the services handed over to a new manager */
+    HEARTBEAT, /**< Represents a packet which renews the subscriptions of a client to several services */
+    SHARD, /**< Represents a packet which contains the subscribers of the shards of services owned by the destination */
+    SHARD_PUBLISH, /**< Represents a packet which contains a message forwarded by a manager to the owner of shards of its subscribers */
+    RELAY, /**< Represents a packet which contains a info message and the subscribers to which the destination relays it */
+    SUBSCRIBER_LIST, /**< Represents a packet which requests or contains the subscribers to which a publisher sends its messages directly */
     INVALID /**< Represents a invalid packet */
 } MessageType;
 
@@ -37,6 +79,27 @@ typedef struct HpbProtocolPacketField_
  */
 size_t hpb_protocol_build_subscribe_msg(HLByte service_key[SHA1_BLOCK_SIZE], HLByte ** packet);
 
+/**
+ * @brief Method to send a subscribe message to a topic pattern, which is sent to the manager of the
+ *        rendezvous key of the pattern.
+ * @param service_key Key of the pattern.
+ * @param pattern Topic pattern, null terminated.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_pattern_subscribe_msg(HLByte service_key[SHA1_BLOCK_SIZE], char *pattern, HLByte ** packet);
+
+/**
+ * @brief Method to send a subscribe message with a filter, evaluated by the manager before
+ *        forwarding each message of the service to the subscriber.
+ * @param service_key Service to subscribe, or key of the pattern.
+ * @param pattern Topic pattern, null terminated, or NULL to subscribe a single topic.
+ * @param filter Filter expression, null terminated.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_filtered_subscribe_msg(HLByte service_key[SHA1_BLOCK_SIZE], char *pattern, char *filter, HLByte ** packet);
+
 /**
  * @brief Method to send an unsubscribe message.
  * @param service_key Service to unsubscribe.
@@ -48,22 +111,189 @@ size_t hpb_protocol_build_unsubscribe_msg(HLByte service_key[SHA1_BLOCK_SIZE], H
 /**
  * @brief Method to send a publish message.
  * @param service_key Service in which to publish.
+ * @param origin Publisher tag and publisher sequence number of the message.
  * @param msg Message to be published.
  * @param msg_length Length of the message to be published.
  * @param packet In-out parameter where the packet is stored.
  * @return Returns the size of the packet created.
  */
-size_t hpb_protocol_build_publish_msg(HLByte service_key[SHA1_BLOCK_SIZE], char *msg, size_t msg_length, HLByte ** packet);
+size_t hpb_protocol_build_publish_msg(HLByte service_key[SHA1_BLOCK_SIZE], HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet);
+
+/**
+ * @brief Method to send a publish message whose content should be retained by the service manager
+ *        and sent to the future subscribers of the service.
+ * @param service_key Service in which to publish.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param msg Message to be published.
+ * @param msg_length Length of the message to be published.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_retained_publish_msg(HLByte service_key[SHA1_BLOCK_SIZE], HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet);
+
+/**
+ * @brief Method to send a publish message of a publisher subscribed to the service, which already delivered
+ *        the message to itself. The manager does not send the message back to the publisher.
+ * @param service_key Service in which to publish.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param is_retained Indicates if the message should be retained by the service manager.
+ * @param msg Message to be published.
+ * @param msg_length Length of the message to be published.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_no_echo_publish_msg(HLByte service_key[SHA1_BLOCK_SIZE], HpbPublishOrigin origin, bool is_retained, char *msg, size_t msg_length, HLByte ** packet);
+
+/**
+ * @brief Method to send a publish message to the wildcard subscriptions of a hierarchical topic, which is
+ *        sent to the manager of the rendezvous key of the topic.
+ * @param rendezvous_key Rendezvous key of the topic.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param payload Topic and message, built by hpb_topic_build_payload().
+ * @param payload_length Length of the payload.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_pattern_publish_msg(HLByte rendezvous_key[SHA1_BLOCK_SIZE], HpbPublishOrigin origin, char *payload, size_t payload_length, HLByte ** packet);
 
 /**
  * @brief Method to send an info message.
  * @param service_key Service to which the info message belongs.
+ * @param seq Sequence number assigned to the message by the service manager.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param msg Message to be sent.
+ * @param msg_length Length of the message to be sent.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_info_msg(HLByte service_key[SHA1_BLOCK_SIZE], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet);
+
+/**
+ * @brief Method to send a direct info message, sent by a publisher to the subscribers of a service without
+ *        going through its manager. It has the format of a publish message.
+ * @param service_key Service to which the info message belongs.
+ * @param origin Publisher tag and publisher sequence number of the message.
  * @param msg Message to be sent.
  * @param msg_length Length of the message to be sent.
  * @param packet In-out parameter where the packet is stored.
  * @return Returns the size of the packet created.
  */
-size_t hpb_protocol_build_info_msg(HLByte service_key[SHA1_BLOCK_SIZE], char *msg, size_t msg_length, HLByte ** packet);
+size_t hpb_protocol_build_direct_info_msg(HLByte service_key[SHA1_BLOCK_SIZE], HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet);
+
+/**
+ * @brief Method to send a subscriber list request, which asks the manager of a service for its subscribers and
+ *        renews the lease of the publisher on the pushes of the list.
+ * @param service_key Service to which the publisher publishes directly.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_subscriber_list_req(HLByte service_key[SHA1_BLOCK_SIZE], HLByte ** packet);
+
+/**
+ * @brief Method to send a subscriber list message, which gives to a publisher the version and the identifiers
+ *        of the subscribers of a service, or tells it that the service cannot be published directly.
+ * @param service_key Service to which the subscribers belong.
+ * @param version Version of the subscribers.
+ * @param subscribers Subscribers of the service, or NULL if the direct publishes are refused.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_subscriber_list_msg(HLByte service_key[SHA1_BLOCK_SIZE], uint32_t version, HpbClientsList *subscribers, HLByte ** packet);
+
+/**
+ * @brief Method to send a NACK message, which asks the service manager to resend the info messages missed.
+ * @param service_key Service to which the missed info messages belong.
+ * @param ranges Ranges of sequence numbers missed.
+ * @param n_ranges Number of ranges. At most HPB_PROTOCOL_NACK_MAX_RANGES are sent.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_nack_msg(HLByte service_key[SHA1_BLOCK_SIZE], HpbSeqRange ranges[], size_t n_ranges, HLByte ** packet);
+
+/**
+ * @brief Method to send a handover message, which transfers the state of several services to their new
+ *        manager at once: for each service, its key, the sequence number of its next message, its retained
+ *        message, its topic pattern if any, and the identifiers of its subscribers.
+ * @param services Services handed over.
+ * @param n_services Number of services.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_handover_msg(HpbServiceManager *services[], size_t n_services, HLByte ** packet);
+
+/**
+ * @brief Method to send a replica message, which copies the state of several services to a client which
+ *        takes over their management if the manager is lost. It has the format of a handover message.
+ * @param services Services replicated.
+ * @param n_services Number of services.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_replica_msg(HpbServiceManager *services[], size_t n_services, HLByte ** packet);
+
+/**
+ * @brief Method to send a shard message, which gives to the owner of shards of the subscribers of several
+ *        services the subscribers to which it sends their messages. It has the format of a handover message,
+ *        and a service without subscribers tells the owner to drop its shards.
+ * @param services Services with the subscribers of the shards of the destination.
+ * @param n_services Number of services.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_shard_msg(HpbServiceManager *services[], size_t n_services, HLByte ** packet);
+
+/**
+ * @brief Method to send a shard publish message, which forwards a message of a service once to the owner of
+ *        shards of its subscribers. It has the format of an info message.
+ * @param service_key Service to which the message belongs.
+ * @param seq Sequence number assigned to the message by the service manager.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param msg Message to be forwarded.
+ * @param msg_length Length of the message to be forwarded.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_shard_publish_msg(HLByte service_key[SHA1_BLOCK_SIZE], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet);
+
+/**
+ * @brief Method to send a relay message, which delivers a message of a service to a subscriber which relays it
+ *        to the subscribers of its subtree: the fields of an info message, the branching factor of the tree, the
+ *        identifiers of the subscribers of the subtree and the message.
+ * @param service_key Service to which the message belongs.
+ * @param seq Sequence number assigned to the message by the service manager.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param branching Number of branches in which the destination splits its subtree.
+ * @param children Subscribers of the subtree of the destination.
+ * @param n_children Number of subscribers of the subtree.
+ * @param msg Message to be relayed.
+ * @param msg_length Length of the message to be relayed.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_relay_msg(HLByte service_key[SHA1_BLOCK_SIZE], uint32_t seq, HpbPublishOrigin origin, uint8_t branching,
+                                    HpbRelayMember children[], size_t n_children, char *msg, size_t msg_length, HLByte ** packet);
+
+/**
+ * @brief Method to send a heartbeat message, which renews at once the leases of the subscriptions of
+ *        this client to all the services managed by the destination.
+ * @param service_keys Keys of the services, one after the other.
+ * @param key_flags Wildcard and filter flags of each subscription, which the manager needs to renew it,
+ *                  or NULL if no subscription has them. The flags follow the keys in the packet.
+ * @param n_services Number of services.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_heartbeat_msg(HLByte *service_keys, HLByte *key_flags, size_t n_services, HLByte ** packet);
+
+/**
+ * @brief Method to reply to a heartbeat with the subscriptions the manager could not renew, which
+ *        the subscriber should subscribe again.
+ * @param service_keys Keys of the services, one after the other.
+ * @param n_services Number of services.
+ * @param packet In-out parameter where the packet is stored.
+ * @return Returns the size of the packet created.
+ */
+size_t hpb_protocol_build_unknown_heartbeat_msg(HLByte *service_keys, size_t n_services, HLByte ** packet);
 
 /**
  * @brief Method called when a message is received.
@@ -74,4 +304,18 @@ size_t hpb_protocol_build_info_msg(HLByte service_key[SHA1_BLOCK_SIZE], char *ms
  */
 int hpb_protocol_receive_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length);
 
+/**
+ * @brief Reads the type of a packet from its first byte.
+ * @param msg Packet, of at least one byte.
+ * @return Returns the type of the packet, or INVALID if it is unknown.
+ */
+MessageType hpb_protocol_get_message_type(HLByte *msg);
+
+/**
+ * @brief Obtains the name of a type of packet, in lower case, as shown in the statistics.
+ * @param type Type of the packet.
+ * @return Returns the name of the type, or "invalid" if it is unknown.
+ */
+const char *hpb_protocol_get_message_type_name(MessageType type);
+
 #endif /* HPB_PROTOCOL_H_INCLUDED_ */
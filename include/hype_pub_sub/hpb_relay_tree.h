@@ -0,0 +1,65 @@
+#ifndef HPB_RELAY_TREE_H_INCLUDED_
+#define HPB_RELAY_TREE_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sha/sha1.h"
+#include "binary_utils.h"
+#include <hype/hype.h>
+
+#define HPB_RELAY_TREE_MAX_BRANCHING 16
+
+/**
+ * @brief This struct represents a member of a relay tree: a subscriber which receives a message
+ *        and may forward it to the members of its subtree.
+ */
+typedef struct HpbRelayMember_
+{
+    HypeInstance *instance; /**< Hype instance of the member, which is not owned by the tree. */
+    HLByte key[SHA1_BLOCK_SIZE]; /**< Key of the member, which orders the members of the tree. */
+    uint32_t link_cost_ms; /**< Cost of the link from the sender to the member. */
+} HpbRelayMember;
+
+/**
+ * @brief This struct represents a branch of a relay tree: the relay to which the message is sent
+ *        and the members of the subtree to which the relay forwards it.
+ */
+typedef struct HpbRelayBranch_
+{
+    HpbRelayMember *relay; /**< Relay of the branch. */
+    HpbRelayMember *children; /**< Members of the subtree of the relay, in key order. */
+    size_t n_children; /**< Number of members of the subtree of the relay. */
+} HpbRelayBranch;
+
+/**
+ * @brief Sorts the members of a relay tree by key, so that each subtree covers a contiguous range of keys.
+ * @param members Members of the tree.
+ * @param n_members Number of members.
+ */
+void hpb_relay_tree_sort(HpbRelayMember members[], size_t n_members);
+
+/**
+ * @brief Splits the members of a tree, sorted by key, in up to branching contiguous ranges of similar sizes.
+ *        The member of each range with the cheapest link, the first one on ties, becomes the relay of the
+ *        range and is moved to its front, and the other members of the range form its subtree.
+ *        The trees are not kept: the sender splits the members of its subtree again for each message,
+ *        so that a lost member or a bad link stops being a relay at the next message.
+ * @param members Members of the tree, sorted by key.
+ * @param n_members Number of members.
+ * @param branching Maximum number of branches, up to HPB_RELAY_TREE_MAX_BRANCHING.
+ * @param branches In-out parameter where the branches are stored.
+ * @return Returns the number of branches.
+ */
+size_t hpb_relay_tree_split(HpbRelayMember members[], size_t n_members, size_t branching, HpbRelayBranch branches[]);
+
+/**
+ * @brief Computes the depth of a relay tree, which is the number of hops from the sender to the farthest member.
+ * @param n_members Number of members.
+ * @param branching Number of branches of each relay.
+ * @return Returns the depth of the tree, or 0 if it has no members.
+ */
+size_t hpb_relay_tree_get_depth(size_t n_members, size_t branching);
+
+#endif /* HPB_RELAY_TREE_H_INCLUDED_ */
@@ -0,0 +1,122 @@
+#ifndef HPB_RESOLVER_H_INCLUDED_
+#define HPB_RESOLVER_H_INCLUDED_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "linked_list.h"
+#include "hpb_client.h"
+#include "sha/sha1.h"
+#include <hype/hype.h>
+
+#define HPB_RESOLVER_DEFAULT_MAX_IN_FLIGHT 4
+#define HPB_RESOLVER_MAX_IN_FLIGHT 64
+#define HPB_RESOLVER_TIMEOUT_MS 15000 // A handshake not reported by the SDK for this long frees its slot
+
+/**
+ * @brief This struct represents an instance found on the network which waits to be resolved, or whose
+ *        handshake is in progress.
+ */
+typedef struct HpbResolverEntry_
+{
+    HpbClient *client; /**< Instance found and its key. */
+    uint64_t found_ms; /**< Time at which the instance was found. */
+    uint64_t started_ms; /**< Time at which the handshake started, or 0 if it waits to be resolved. */
+} HpbResolverEntry;
+
+/**
+ * @brief This struct schedules the handshakes with the instances found on the network. At most max_in_flight
+ *        handshakes run at the same time, so that a dense network does not delay the traffic with a storm of
+ *        handshakes, and the instances whose keys are closest to the keys of interest are resolved first.
+ */
+typedef struct HpbResolver_
+{
+    LinkedList *pending; /**< HpbResolverEntry elements waiting to be resolved, in the order in which they were found. */
+    LinkedList *in_flight; /**< HpbResolverEntry elements whose handshake is in progress. */
+    size_t max_in_flight; /**< Maximum number of handshakes in progress. */
+    size_t max_pending; /**< Highest number of instances which waited to be resolved at the same time. */
+    uint64_t n_found; /**< Number of instances found. */
+    uint64_t n_resolved; /**< Number of handshakes which succeeded. */
+    uint64_t n_failed; /**< Number of handshakes which failed, or whose instance was lost during the handshake. */
+    uint64_t n_timeouts; /**< Number of handshakes not reported by the SDK in HPB_RESOLVER_TIMEOUT_MS. */
+    uint64_t wait_total_ms; /**< Sum of the times from the instance found to the start of its handshake. */
+    uint64_t wait_max_ms; /**< Longest time from an instance found to the start of its handshake. */
+    uint64_t handshake_total_ms; /**< Sum of the durations of the handshakes which succeeded. */
+    uint64_t handshake_max_ms; /**< Longest duration of a handshake which succeeded. */
+} HpbResolver;
+
+typedef void (*HpbResolveCallback) (HypeInstance *instance, void *arg);
+
+/**
+ * @brief Allocates space for a HpbResolver struct.
+ * @param max_in_flight Maximum number of handshakes in progress.
+ * @return Returns a pointer to the created struct or NULL if the space could not be allocated.
+ */
+HpbResolver *hpb_resolver_create(size_t max_in_flight);
+
+/**
+ * @brief Queues an instance found on the network, unless it is already queued or being resolved.
+ * @param resolver Pointer to the HpbResolver struct.
+ * @param instance Instance found. It is copied.
+ * @param now_ms Current time.
+ * @return Returns true if the instance was queued and false otherwise.
+ */
+bool hpb_resolver_add(HpbResolver *resolver, HypeInstance *instance, uint64_t now_ms);
+
+/**
+ * @brief Ends the handshake with an instance, which frees its slot, and measures its duration if it succeeded.
+ * @param resolver Pointer to the HpbResolver struct.
+ * @param instance Instance whose handshake ended.
+ * @param success Indicates if the instance was resolved.
+ * @param now_ms Current time.
+ * @return Returns true if the handshake was in progress and false otherwise.
+ */
+bool hpb_resolver_complete(HpbResolver *resolver, HypeInstance *instance, bool success, uint64_t now_ms);
+
+/**
+ * @brief Forgets an instance lost, whether it waits to be resolved or its handshake is in progress.
+ * @param resolver Pointer to the HpbResolver struct.
+ * @param instance Instance lost.
+ * @return Returns true if the instance was queued or being resolved and false otherwise.
+ */
+bool hpb_resolver_remove(HpbResolver *resolver, HypeInstance *instance);
+
+/**
+ * @brief Frees the slots of the handshakes which timed out and starts the handshakes of the queued instances
+ *        while slots are free. The instance whose key is closest to one of the keys of interest, by XOR
+ *        distance, is resolved first; without keys of interest, the instances are resolved in the order in
+ *        which they were found.
+ * @param resolver Pointer to the HpbResolver struct.
+ * @param keys Keys of interest, one after the other.
+ * @param n_keys Number of keys of interest.
+ * @param now_ms Current time.
+ * @param resolve Callback which starts the handshake with an instance.
+ * @param arg Argument given to the callback.
+ * @return Returns the number of handshakes started.
+ */
+size_t hpb_resolver_dispatch(HpbResolver *resolver, HLByte *keys, size_t n_keys, uint64_t now_ms, HpbResolveCallback resolve, void *arg);
+
+/**
+ * @brief Sets the maximum number of handshakes in progress. The handshakes already started are not interrupted.
+ * @param resolver Pointer to the HpbResolver struct.
+ * @param max_in_flight Maximum number of handshakes, from 1 to HPB_RESOLVER_MAX_IN_FLIGHT.
+ * @return Returns 0 in case of success and -1 if the number is out of range.
+ */
+int hpb_resolver_set_max_in_flight(HpbResolver *resolver, size_t max_in_flight);
+
+/**
+ * @brief Prints the queue and handshake metrics of the resolver.
+ * @param resolver Pointer to the HpbResolver struct.
+ */
+void hpb_resolver_print_stats(HpbResolver *resolver);
+
+/**
+ * @brief Deallocates the space previously allocated for a HpbResolver struct.
+ * @param resolver Pointer to the pointer of the HpbResolver struct to be deallocated.
+ */
+void hpb_resolver_destroy(HpbResolver **resolver);
+
+#endif /* HPB_RESOLVER_H_INCLUDED_ */
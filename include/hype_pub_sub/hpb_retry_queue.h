@@ -0,0 +1,168 @@
+
+#ifndef HPB_RETRY_QUEUE_H_INCLUDED_
+#define HPB_RETRY_QUEUE_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "binary_utils.h"
+#include <hype/hype.h>
+
+#define HPB_RETRY_QUEUE_MAX_ENTRIES 4096
+#define HPB_RETRY_QUEUE_MAX_BYTES (1024 * 1024)
+#define HPB_RETRY_INITIAL_BACKOFF_MS 100
+#define HPB_RETRY_MAX_BACKOFF_MS 5000
+#define HPB_RETRY_DEADLINE_MS 30000
+#define HPB_RETRY_INDEX_LOAD 4 // Entries per bucket of the index when the queue is full
+
+/**
+ * @brief Priority of a message kept by the retry queue. Control messages are retried before data
+ *        messages and are the last ones to be evicted when the queue is full.
+ */
+typedef enum {
+    HPB_RETRY_PRIORITY_CONTROL, /**< Subscribe and unsubscribe messages. */
+    HPB_RETRY_PRIORITY_DATA /**< Publish and info messages. */
+} HpbRetryPriority;
+
+/**
+ * @brief This struct represents a packet kept by the retry queue. The same packet can be shared by
+ *        several entries (e.g. an info message sent to many subscribers), so it is reference counted
+ *        and its bytes are only accounted once, while at least one entry tracks it.
+ */
+typedef struct HpbRetryPacket_
+{
+    HLByte *data; /**< Bytes of the packet. */
+    size_t size; /**< Size of the packet. */
+    size_t ref_count; /**< Number of references to the packet, of the entries and of its senders. */
+    size_t n_entries; /**< Number of entries tracking the packet. */
+} HpbRetryPacket;
+
+/**
+ * @brief This struct represents a message tracked by the retry queue until it is delivered, it
+ *        reaches its deadline or it is evicted.
+ */
+typedef struct HpbRetryEntry_
+{
+    uint64_t message_id; /**< Identifier of the Hype message info of the last attempt. */
+    HpbRetryPacket *packet; /**< Packet to be resent. */
+    HypeInstance *destination; /**< Destination of the packet. */
+    HpbRetryPriority priority; /**< Priority of the packet. */
+    bool is_failed; /**< Indicates that the last attempt failed and a retry is scheduled. */
+    unsigned int n_attempts; /**< Number of attempts done so far. */
+    uint64_t next_attempt_ms; /**< Time at which the next attempt is done, if the entry is failed. */
+    uint64_t deadline_ms; /**< Time after which the message is given up. */
+    uint64_t sent_ms; /**< Time at which the message was first sent. */
+    struct HpbRetryEntry_ *prev; /**< Previous entry in insertion order. */
+    struct HpbRetryEntry_ *next; /**< Next entry in insertion order. */
+    struct HpbRetryEntry_ *next_by_id; /**< Next entry of the same bucket of the index by message identifier. */
+} HpbRetryEntry;
+
+/**
+ * @brief This struct represents a bounded queue of messages which are retried with exponential
+ *        backoff and jitter when the Hype SDK reports that sending them failed.
+ */
+typedef struct HpbRetryQueue_
+{
+    HpbRetryEntry *head; /**< Oldest entry, in insertion order. */
+    HpbRetryEntry *tail; /**< Newest entry, in insertion order. */
+    size_t n_entries; /**< Number of entries of the queue, the ones being resent included. */
+    HpbRetryEntry **index; /**< Buckets of the entries by message identifier, which the delivery reports look up. */
+    size_t index_mask; /**< Number of buckets of the index minus one, a power of two minus one. */
+    size_t n_bytes; /**< Number of bytes of the packets tracked by the entries of the queue. */
+    size_t max_entries; /**< Maximum number of entries of the queue. */
+    size_t max_bytes; /**< Maximum number of bytes of the packets kept by the queue. */
+    uint32_t rng_state; /**< State of the generator used for the backoff jitter. */
+    uint64_t n_retries; /**< Number of attempts done after a failure. */
+    uint64_t n_expired; /**< Number of messages given up after their deadline. */
+    uint64_t n_evicted; /**< Number of messages dropped because the queue was full. */
+    pthread_mutex_t mutex; /**< Entries are added by the fan-out worker threads as well. */
+} HpbRetryQueue;
+
+typedef uint64_t (*HpbRetrySendCallback) (HLByte *packet, size_t packet_size, HypeInstance *destination, void *arg);
+typedef void (*HpbRetryCompletionCallback) (HpbRetryEntry *entry, bool success, void *arg);
+
+/**
+ * @brief Allocates space for a HpbRetryQueue struct.
+ * @param max_entries Maximum number of entries of the queue.
+ * @param max_bytes Maximum number of bytes of the packets kept by the queue.
+ * @param seed Seed of the generator used for the backoff jitter.
+ * @return Returns a pointer to the created struct or NULL if the space could not be allocated.
+ */
+HpbRetryQueue *hpb_retry_queue_create(size_t max_entries, size_t max_bytes, uint32_t seed);
+
+/**
+ * @brief Creates a packet which can be tracked by the retry queue. The bytes are copied, and only accounted
+ *        by the queue once the packet is tracked.
+ * @param queue Retry queue.
+ * @param data Bytes of the packet.
+ * @param size Size of the packet.
+ * @return Returns a pointer to the created packet with a reference count of 1.
+ */
+HpbRetryPacket *hpb_retry_queue_packet_create(HpbRetryQueue *queue, HLByte *data, size_t size);
+
+/**
+ * @brief Releases a reference to a packet. The packet is deallocated when no references remain.
+ * @param queue Retry queue.
+ * @param packet Packet to be released.
+ */
+void hpb_retry_queue_packet_release(HpbRetryQueue *queue, HpbRetryPacket *packet);
+
+/**
+ * @brief Starts tracking a message which was just sent. The entry takes a reference to the packet.
+ *        If the queue is full the oldest data entry is evicted, or the message is not tracked if only
+ *        control entries remain and the message is a data message.
+ * @param queue Retry queue.
+ * @param message_id Identifier of the Hype message info of the message.
+ * @param packet Packet that was sent.
+ * @param destination Destination of the message. The instance is copied.
+ * @param priority Priority of the message.
+ * @param now_ms Current time.
+ * @return Returns 0 if the message is tracked and -1 otherwise.
+ */
+int hpb_retry_queue_track(HpbRetryQueue *queue, uint64_t message_id, HpbRetryPacket *packet, HypeInstance *destination, HpbRetryPriority priority, uint64_t now_ms);
+
+/**
+ * @brief Stops tracking a message which was delivered and invokes the completion callback.
+ * @param queue Retry queue.
+ * @param message_id Identifier of the Hype message info of the message.
+ * @param completion_callback Callback invoked with the delivered entry, or NULL.
+ * @param arg Argument given to the callback.
+ * @return Returns 0 if the message was tracked and -1 otherwise.
+ */
+int hpb_retry_queue_delivered(HpbRetryQueue *queue, uint64_t message_id, HpbRetryCompletionCallback completion_callback, void *arg);
+
+/**
+ * @brief Schedules a retry of a message which failed to be sent. The delay grows exponentially with
+ *        the number of attempts, up to HPB_RETRY_MAX_BACKOFF_MS, and is randomized (jitter).
+ * @param queue Retry queue.
+ * @param message_id Identifier of the Hype message info of the message.
+ * @param now_ms Current time.
+ * @return Returns 0 if the message was tracked and -1 otherwise.
+ */
+int hpb_retry_queue_failed(HpbRetryQueue *queue, uint64_t message_id, uint64_t now_ms);
+
+/**
+ * @brief Resends the failed messages whose retry is due, control messages first, and gives up the
+ *        messages whose deadline passed, invoking the completion callback for them. The callbacks are
+ *        invoked without holding the mutex of the queue, so they may report deliveries and failures.
+ * @param queue Retry queue.
+ * @param now_ms Current time.
+ * @param send_callback Callback used to resend a packet. It returns the new message identifier or 0 on failure.
+ * @param send_arg Argument given to the send callback.
+ * @param completion_callback Callback invoked with the expired entries, or NULL.
+ * @param completion_arg Argument given to the completion callback.
+ * @return Returns the number of messages resent.
+ */
+int hpb_retry_queue_process(HpbRetryQueue *queue, uint64_t now_ms, HpbRetrySendCallback send_callback, void *send_arg,
+                            HpbRetryCompletionCallback completion_callback, void *completion_arg);
+
+/**
+ * @brief Deallocates the space previously allocated for the given HpbRetryQueue struct.
+ * @param queue Pointer to the pointer of the HpbRetryQueue struct to be deallocated.
+ */
+void hpb_retry_queue_destroy(HpbRetryQueue **queue);
+
+#endif /* HPB_RETRY_QUEUE_H_INCLUDED_ */
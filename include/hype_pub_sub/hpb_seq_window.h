@@ -0,0 +1,81 @@
+
+#ifndef HPB_SEQ_WINDOW_H_INCLUDED_
+#define HPB_SEQ_WINDOW_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HPB_SEQ_WINDOW_SIZE 64
+#define HPB_SEQ_RESET_DISTANCE 1024
+
+/**
+ * @brief Result of receiving a sequence number in a HpbSeqWindow.
+ */
+typedef enum {
+    HPB_SEQ_NEW, /**< The sequence number was not received before. */
+    HPB_SEQ_DUPLICATE, /**< The sequence number was already received. */
+    HPB_SEQ_TOO_OLD, /**< The sequence number is older than the window, it cannot be told apart from a duplicate. */
+    HPB_SEQ_RESET /**< The sequence number is too far from the window, the sender started a new sequence. */
+} HpbSeqResult;
+
+/**
+ * @brief This struct represents an inclusive range of sequence numbers.
+ */
+typedef struct HpbSeqRange_
+{
+    uint32_t first; /**< First sequence number of the range. */
+    uint32_t last; /**< Last sequence number of the range. */
+} HpbSeqRange;
+
+/**
+ * @brief This struct keeps track of the last HPB_SEQ_WINDOW_SIZE sequence numbers received from a
+ *        sender, which allows to detect duplicates and missing messages. Sequence numbers are
+ *        compared with serial number arithmetic, so they can wrap around.
+ */
+typedef struct HpbSeqWindow_
+{
+    bool is_initialized; /**< Indicates if a sequence number was already received. */
+    uint32_t highest; /**< Highest sequence number received. */
+    uint64_t received_mask; /**< Bit i is set if the sequence number highest - i was received. */
+} HpbSeqWindow;
+
+/**
+ * @brief Resets a window, as if nothing was received.
+ * @param window Pointer to the window.
+ */
+void hpb_seq_window_reset(HpbSeqWindow *window);
+
+/**
+ * @brief Registers the reception of a sequence number. The messages sent before the first sequence
+ *        number received, or before a reset, are never reported as missing.
+ * @param window Pointer to the window.
+ * @param seq Sequence number received.
+ * @return Returns the result of the reception. Messages should only be delivered on HPB_SEQ_NEW and HPB_SEQ_RESET.
+ */
+HpbSeqResult hpb_seq_window_receive(HpbSeqWindow *window, uint32_t seq);
+
+/**
+ * @brief Obtains the ranges of sequence numbers missing from the window, from the oldest to the newest.
+ * @param window Pointer to the window.
+ * @param ranges Array where the ranges are stored.
+ * @param max_ranges Size of the array.
+ * @return Returns the number of ranges stored.
+ */
+size_t hpb_seq_window_get_missing(HpbSeqWindow *window, HpbSeqRange ranges[], size_t max_ranges);
+
+/**
+ * @brief Counts the sequence numbers missing from the window.
+ * @param window Pointer to the window.
+ * @return Returns the number of sequence numbers missing.
+ */
+size_t hpb_seq_window_count_missing(HpbSeqWindow *window);
+
+/**
+ * @brief Marks the missing sequence numbers of the window as received. It is used to give up
+ *        the messages which could not be recovered.
+ * @param window Pointer to the window.
+ */
+void hpb_seq_window_skip_missing(HpbSeqWindow *window);
+
+#endif /* HPB_SEQ_WINDOW_H_INCLUDED_ */
@@ -8,8 +8,15 @@
 
 #include "hpb_clients_list.h"
 #include "hpb_constants.h"
+#include "hpb_history.h"
+#include "hpb_clock.h"
+#include "hpb_topic_trie.h"
+#include "hpb_filter.h"
 #include "sha/sha1.h"
 
+#define HPB_SERVICE_MANAGER_SHARD_SIZE 1
+#define HPB_SERVICE_MANAGER_RATE_WINDOW_MS 1000
+
 /**
  * @brief This struct represents a service managed by this HypePubSub application.
  * Each HpbServiceManager associates a given service with a list of subscribers.
@@ -18,10 +25,31 @@ typedef struct HpbServiceManager_
 {
     HLByte service_key[SHA1_BLOCK_SIZE]; /**< Key of the managed service. */
     HpbClientsList *subscribers; /**< Linked list with the subscribers of the service. */
+    char *retained_msg; /**< Last message published as retained, sent to new subscribers, or NULL. */
+    size_t retained_msg_length; /**< Length of the retained message. */
+    HpbPublishOrigin retained_origin; /**< Publisher tag and publisher sequence number of the retained message. */
+    uint32_t next_seq; /**< Sequence number assigned to the next message of the service. */
+    HpbHistory *history; /**< Last messages of the service, resent to the subscribers which missed them. */
+    bool is_replica_dirty; /**< Indicates if the state of the service changed since it was last replicated. */
+    uint64_t replicated_ms; /**< Time at which the service was last replicated, or at which the replica was last updated. */
+    char *pattern; /**< Topic pattern of a wildcard subscription, or NULL for the services of a single topic. */
+    HLByte placement_key[SHA1_BLOCK_SIZE]; /**< Key from which the manager of the service is chosen: the rendezvous key of the pattern, or the service key. */
+    LinkedList *filters; /**< List of the distinct HpbFilter elements of the subscribers, each shared by the subscribers with the same filter. */
+    uint8_t n_shards; /**< Number of shards among which the subscribers are split, or 0 if the service is not sharded. */
+    bool is_shard_dirty; /**< Indicates if the subscribers changed since they were last sent to the owners of the shards. */
+    uint64_t sharded_ms; /**< Time at which the subscribers were last sent to the owners of the shards. */
+    HpbClientsList *shard_owners; /**< Clients to which each message is forwarded once, to be sent to the subscribers of their shards. */
+    uint64_t rate_window_ms; /**< Time at which the current window of the publish rate started. */
+    uint32_t n_window_publishes; /**< Number of messages published in the current window. */
+    uint32_t publish_rate; /**< Number of messages published in the last complete window, per second. */
+    uint32_t subscribers_version; /**< Version of the subscribers, incremented when a subscriber is added or removed, its filter changes or the service is sharded. */
+    uint32_t pushed_version; /**< Version of the subscribers last pushed to the direct publishers. */
+    HpbClientsList *direct_publishers; /**< Publishers which send the messages directly to the subscribers, whose lease expiration is kept by the client. */
 } HpbServiceManager;
 
 /**
- * @brief Allocates space for a HpbServiceManager struct.
+ * @brief Allocates space for a HpbServiceManager struct. The sequence numbers of the service start at
+ *        an arbitrary value, so that the subscribers can tell apart a manager which lost its state.
  * @param service_key Service key of the HpbServiceManager to be created.
  * @return Returns a pointer to the created struct or NULL if the space could not be allocated.
  */
@@ -43,6 +71,72 @@ int hpb_service_manager_add_subscriber(HpbServiceManager *serv_man, HypeInstance
  */
 int hpb_service_manager_remove_subscriber(HpbServiceManager *serv_man, HypeInstance * instance);
 
+/**
+ * @brief Replaces the retained message of a given HpbServiceManager.
+ * @param serv_man HpbServiceManager whose retained message should be replaced.
+ * @param origin Origin of the message to be retained.
+ * @param msg Message to be retained. It is copied. If NULL the retained message is cleared.
+ * @param msg_length Length of the message to be retained.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_service_manager_set_retained_msg(HpbServiceManager *serv_man, HpbPublishOrigin origin, char *msg, size_t msg_length);
+
+/**
+ * @brief Turns a given HpbServiceManager into the service of a wildcard subscription, which is placed
+ *        at the manager of the rendezvous key of the pattern instead of the service key.
+ * @param serv_man HpbServiceManager of the wildcard subscription.
+ * @param pattern Topic pattern, null terminated. It is copied.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_service_manager_set_pattern(HpbServiceManager *serv_man, char *pattern);
+
+/**
+ * @brief Sets the filter of the messages delivered to a subscriber of a given HpbServiceManager.
+ *        Subscribers with the same filter share a single compiled filter.
+ * @param serv_man HpbServiceManager of the subscriber.
+ * @param instance Hype instance of the subscriber.
+ * @param expression Filter expression, null terminated. If NULL the filter of the subscriber is cleared.
+ * @return Returns 0 in case of success and -1 if the subscriber was not found or the expression is invalid.
+ */
+int hpb_service_manager_set_filter(HpbServiceManager *serv_man, HypeInstance *instance, char *expression);
+
+/**
+ * @brief Evaluates each filter of a given HpbServiceManager once over a message, keeping the result in the
+ *        filter for all the subscribers which share it. The messages of a wildcard subscription are
+ *        evaluated without the topic prefix, and their topic is the $topic attribute.
+ * @param serv_man HpbServiceManager whose filters should be evaluated.
+ * @param origin Origin of the message.
+ * @param msg Message.
+ * @param msg_length Length of the message.
+ * @return Returns the number of filters evaluated.
+ */
+size_t hpb_service_manager_evaluate_filters(HpbServiceManager *serv_man, HpbPublishOrigin origin, char *msg, size_t msg_length);
+
+/**
+ * @brief Obtains the key of a shard of the subscribers of a given HpbServiceManager, which is the hash of the
+ *        service key followed by the index of the shard. The owner of the shard is the manager of this key.
+ * @param serv_man HpbServiceManager whose subscribers are sharded.
+ * @param shard Index of the shard.
+ * @param shard_key In-out parameter where the key of the shard is stored.
+ */
+void hpb_service_manager_get_shard_key(HpbServiceManager *serv_man, uint8_t shard, HLByte shard_key[SHA1_BLOCK_SIZE]);
+
+/**
+ * @brief Obtains the shard of a subscriber of a given HpbServiceManager, from the key of the subscriber.
+ * @param serv_man HpbServiceManager whose subscribers are sharded.
+ * @param client Subscriber.
+ * @return Returns the index of the shard of the subscriber, or 0 if the service is not sharded.
+ */
+uint8_t hpb_service_manager_get_shard(HpbServiceManager *serv_man, HpbClient *client);
+
+/**
+ * @brief Counts the messages published in a given HpbServiceManager, and updates its publish rate at the end of each window.
+ * @param serv_man HpbServiceManager in which the messages were published.
+ * @param n_publishes Number of messages published, which may be 0 to close the window of a quiet service.
+ * @param now_ms Current time in milliseconds.
+ */
+void hpb_service_manager_count_publishes(HpbServiceManager *serv_man, uint32_t n_publishes, uint64_t now_ms);
+
 /**
  * @brief Deallocates the space previously allocated for the given HpbServiceManager struct.
  * @param serv_man Pointer to the pointer of the HpbServiceManager struct to be deallocated.
@@ -0,0 +1,196 @@
+#ifndef HPB_SIM_H_INCLUDED_
+#define HPB_SIM_H_INCLUDED_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "linked_list.h"
+#include "binary_utils.h"
+#include "hype_pub_sub.h"
+#include "hpb_transport.h"
+#include "hpb_protocol.h"
+#include "hpb_clock.h"
+#include <hype/hype.h>
+
+#define HPB_SIM_ID_SIZE 12 // Same size as the identifiers of the Hype SDK
+#define HPB_SIM_INITIAL_EVENTS 1024
+#define HPB_SIM_N_MESSAGE_TYPES (INVALID + 1)
+#define HPB_SIM_TRACE_HASH_BASIS 0xCBF29CE484222325ULL // FNV-1a offset basis
+#define HPB_SIM_TRACE_HASH_PRIME 0x100000001B3ULL
+
+/**
+ * @brief This struct holds the properties of a simulated link.
+ */
+typedef struct HpbSimLink_
+{
+    uint64_t latency_us; /**< One way latency of the link. */
+    uint64_t jitter_us; /**< Maximum delay added at random to the latency of each message. */
+    uint64_t bandwidth; /**< Bytes per second which the sender transmits on the link, or 0 for no limit. */
+    double loss; /**< Probability, from 0 to 1, that a message is lost. Lost messages are reported as failed to the sender. */
+} HpbSimLink;
+
+typedef enum HpbSimEventType_
+{
+    HPB_SIM_EVENT_START,
+    HPB_SIM_EVENT_PERIODIC,
+    HPB_SIM_EVENT_FOUND,
+    HPB_SIM_EVENT_RESOLVED,
+    HPB_SIM_EVENT_FAILED_RESOLVING,
+    HPB_SIM_EVENT_LOST,
+    HPB_SIM_EVENT_RECEIVED,
+    HPB_SIM_EVENT_DELIVERED,
+    HPB_SIM_EVENT_SEND_FAILED
+} HpbSimEventType;
+
+/**
+ * @brief This struct represents an event of the simulation, which happens to a node at a given virtual time.
+ */
+typedef struct HpbSimEvent_
+{
+    uint64_t time_us; /**< Virtual time of the event. */
+    uint64_t seq; /**< Order in which the event was scheduled, which breaks the ties between events of the same time. */
+    HpbSimEventType type; /**< Type of the event. */
+    size_t node; /**< Index of the node to which the event happens. */
+    size_t peer; /**< Index of the other node concerned, if any. */
+    uint64_t message_id; /**< Identifier of the message concerned, for send notifications. */
+    HLByte *data; /**< Message received, owned by the event. */
+    size_t data_size; /**< Size of the message received. */
+} HpbSimEvent;
+
+typedef struct HpbSim_ HpbSim;
+
+/**
+ * @brief This struct represents a node of the simulation: a HypePubSub application with its own transport.
+ */
+typedef struct HpbSimNode_
+{
+    HpbSim *sim; /**< Simulation which hosts the node. */
+    size_t index; /**< Index of the node, which is also its identifier. */
+    HypeInstance *instance; /**< Instance of the node, seen by the other nodes. */
+    HpbTransport *transport; /**< Transport of the node on the simulated network. */
+    HypePubSub *context; /**< HypePubSub application of the node, or NULL once removed. */
+    uint64_t uplink_free_us; /**< Virtual time at which the node finishes transmitting the messages queued. */
+    uint64_t next_message_id; /**< Identifier of the next message sent by the node. */
+} HpbSimNode;
+
+/**
+ * @brief This struct represents a link with properties of its own, which overrides the default link.
+ */
+typedef struct HpbSimLinkOverride_
+{
+    size_t from; /**< Index of the sending node. */
+    size_t to; /**< Index of the receiving node. */
+    HpbSimLink link; /**< Properties of the link. */
+} HpbSimLinkOverride;
+
+/**
+ * @brief This struct hosts many HypePubSub nodes in a single process, connected by a simulated network in
+ *        memory. The simulation runs on a virtual clock, which is also the clock of the HypePubSub timers,
+ *        and every node finds every other node present.
+ */
+struct HpbSim_
+{
+    HpbSimNode **nodes; /**< Nodes of the simulation, present or removed. */
+    size_t n_nodes; /**< Number of nodes added. */
+    size_t max_nodes; /**< Number of nodes which fit the array of nodes. */
+    HpbSimEvent *events; /**< Binary heap of the scheduled events, earliest first. */
+    size_t n_events; /**< Number of scheduled events. */
+    size_t max_events; /**< Number of events which fit the heap. */
+    uint64_t next_seq; /**< Sequence number of the next event scheduled. */
+    uint64_t now_us; /**< Virtual time. */
+    uint64_t rng; /**< State of the random generator of the jitter and of the losses. */
+    size_t current; /**< Index of the node whose application is current. */
+    HpbSimLink link; /**< Properties of the links without an override. */
+    LinkedList *link_overrides; /**< HpbSimLinkOverride elements of the links with properties of their own. */
+    uint64_t n_sent; /**< Number of messages sent. */
+    uint64_t bytes_sent; /**< Number of bytes sent. */
+    uint64_t n_delivered; /**< Number of messages delivered. */
+    uint64_t n_lost; /**< Number of messages lost or sent to nodes not present. */
+    uint64_t n_membership_events; /**< Number of instances resolved and lost reported to the nodes. */
+    uint64_t n_sent_by_type[HPB_SIM_N_MESSAGE_TYPES]; /**< Number of messages sent of each MessageType. */
+    uint64_t trace_hash; /**< Hash of the events processed, which differs between two runs as soon as they diverge. */
+};
+
+/**
+ * @brief Allocates space for a simulation and makes its virtual clock the clock of the HypePubSub timers.
+ *        There is at most one simulation at a time.
+ * @param link Properties of the links.
+ * @param seed Seed of the random generator, so that a simulation can be repeated.
+ * @return Returns a pointer to the created simulation or NULL if there is already one.
+ */
+HpbSim *hpb_sim_create(HpbSimLink link, uint64_t seed);
+
+/**
+ * @brief Adds a node, which starts at the current virtual time and is found by every node present.
+ * @param sim Pointer to the simulation.
+ * @param capacity Capacity announced by the node, from 1 to HPB_CLIENT_MAX_CAPACITY.
+ * @return Returns the index of the node.
+ */
+size_t hpb_sim_add_node(HpbSim *sim, uint8_t capacity);
+
+/**
+ * @brief Removes a node, which is lost by every node present, and deallocates its HypePubSub application.
+ * @param sim Pointer to the simulation.
+ * @param index Index of the node.
+ */
+void hpb_sim_remove_node(HpbSim *sim, size_t index);
+
+/**
+ * @brief Checks if a node was added and not removed.
+ * @param sim Pointer to the simulation.
+ * @param index Index of the node.
+ * @return Returns true if the node is present and false otherwise.
+ */
+bool hpb_sim_is_node_present(HpbSim *sim, size_t index);
+
+/**
+ * @brief Gives a link properties of its own. Meant for a few links, since the overrides are searched on each message.
+ * @param sim Pointer to the simulation.
+ * @param from Index of the sending node.
+ * @param to Index of the receiving node.
+ * @param link Properties of the link.
+ */
+void hpb_sim_set_link(HpbSim *sim, size_t from, size_t to, HpbSimLink link);
+
+/**
+ * @brief Makes the HypePubSub application of a node the current one, so that the hpb_issue methods are
+ *        issued by that node.
+ * @param sim Pointer to the simulation.
+ * @param index Index of the node.
+ * @return Returns 0 in case of success and -1 if the node is not present.
+ */
+int hpb_sim_select_node(HpbSim *sim, size_t index);
+
+/**
+ * @brief Processes the events scheduled in the given virtual time, in order, and advances the virtual clock.
+ * @param sim Pointer to the simulation.
+ * @param duration_us Virtual time to be simulated.
+ * @return Returns the number of events processed.
+ */
+uint64_t hpb_sim_run(HpbSim *sim, uint64_t duration_us);
+
+/**
+ * @brief Obtains the index of the node with a given instance.
+ * @param instance Instance of a node of the simulation.
+ * @return Returns the index of the node.
+ */
+size_t hpb_sim_get_node_index(HypeInstance *instance);
+
+/**
+ * @brief Draws a random number from the generator of the simulation.
+ * @param sim Pointer to the simulation.
+ * @return Returns a number from 0 to UINT64_MAX.
+ */
+uint64_t hpb_sim_random(HpbSim *sim);
+
+/**
+ * @brief Deallocates the space previously allocated for a simulation, its nodes and its events, and
+ *        restores the monotonic clock.
+ * @param sim Pointer to the pointer of the simulation to be deallocated.
+ */
+void hpb_sim_destroy(HpbSim **sim);
+
+#endif /* HPB_SIM_H_INCLUDED_ */
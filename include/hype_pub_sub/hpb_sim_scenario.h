@@ -0,0 +1,101 @@
+#ifndef HPB_SIM_SCENARIO_H_INCLUDED_
+#define HPB_SIM_SCENARIO_H_INCLUDED_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "hpb_sim.h"
+
+#define HPB_SIM_SCENARIO_FORMATION_US (10 * 1000000) // Time given to the initial nodes to resolve each other and subscribe
+#define HPB_SIM_SCENARIO_SETTLE_US (5 * 1000000) // Time after a storm counted as part of it, longer than the membership window
+#define HPB_SIM_SCENARIO_MAX_MSG_SIZE 32
+
+/**
+ * @brief This struct describes a churn scenario: a mesh of nodes subscribed to topics, which publish at a
+ *        steady rate while storms of nodes join and leave it.
+ */
+typedef struct HpbSimScenario_
+{
+    const char *name; /**< Name of the scenario. */
+    HpbSimLink link; /**< Properties of the links. */
+    uint64_t seed; /**< Seed of the simulation, so that the scenario can be repeated. */
+    size_t n_nodes; /**< Number of nodes present before the first storm. */
+    size_t n_topics; /**< Number of topics. */
+    size_t subscriptions_per_node; /**< Number of topics to which each node subscribes when it joins. */
+    uint64_t publish_interval_us; /**< Mean time between two publishes of the whole mesh, or 0 for no publish. */
+    size_t n_storms; /**< Number of storms. */
+    size_t storm_joins; /**< Number of nodes which join during each storm. */
+    size_t storm_leaves; /**< Number of nodes which leave during each storm, chosen at random among those present. */
+    uint64_t storm_duration_us; /**< Time over which the joins and leaves of a storm are spread, or 0 for all at once. */
+    uint64_t storm_interval_us; /**< Time between the starts of two storms, also measured without churn before the first. */
+} HpbSimScenario;
+
+/**
+ * @brief This struct holds the outcome of a churn scenario. All the fields but the CPU times are the same
+ *        each time the scenario runs with the same seed.
+ */
+typedef struct HpbSimReport_
+{
+    uint64_t n_joins; /**< Number of nodes which joined during the storms. */
+    uint64_t n_leaves; /**< Number of nodes which left during the storms. */
+    uint64_t n_instance_events; /**< Number of instances resolved and lost reported to the nodes during the storms. */
+    uint64_t storm_us; /**< Virtual time of the storms, each with the HPB_SIM_SCENARIO_SETTLE_US which follow it. */
+    uint64_t quiet_us; /**< Virtual time without churn. */
+    uint64_t storm_msgs; /**< Number of messages sent during the storms. */
+    uint64_t quiet_msgs; /**< Number of messages sent without churn. */
+    uint64_t storm_bytes; /**< Number of bytes sent during the storms. */
+    uint64_t quiet_bytes; /**< Number of bytes sent without churn. */
+    uint64_t n_sent_by_type[HPB_SIM_N_MESSAGE_TYPES]; /**< Number of messages sent of each MessageType after the formation. */
+    uint64_t n_lost; /**< Number of messages lost or sent to nodes not present after the formation. */
+    uint64_t n_published; /**< Number of messages published. */
+    uint64_t n_expected; /**< Number of deliveries expected by subscribers present from the publish to the end. */
+    uint64_t n_received; /**< Number of the expected deliveries which were received. */
+    uint64_t trace_hash; /**< Hash of the events of the simulation. */
+    double storm_cpu_ms; /**< CPU time taken by the storms. */
+    double quiet_cpu_ms; /**< CPU time taken without churn. */
+} HpbSimReport;
+
+/**
+ * @brief This struct holds the workload of a node during a scenario.
+ */
+typedef struct HpbSimScenarioNode_
+{
+    size_t *topics; /**< Topics to which the node subscribed. */
+    uint64_t subscribed_us; /**< Virtual time at which the node subscribed. */
+} HpbSimScenarioNode;
+
+/**
+ * @brief This struct represents a message published during a scenario and the subscribers which expect it.
+ */
+typedef struct HpbSimPublish_
+{
+    size_t *subscribers; /**< Indexes of the nodes subscribed to the topic when the message was published. */
+    bool *is_received; /**< Indicates, for each subscriber, if it received the message. */
+    size_t n_subscribers; /**< Number of subscribers. */
+} HpbSimPublish;
+
+/**
+ * @brief Runs a churn scenario on a new simulation. The initial nodes resolve each other and subscribe for
+ *        HPB_SIM_SCENARIO_FORMATION_US, which is not measured, then the mesh publishes without churn for
+ *        one storm interval and goes through the storms. The joins and leaves of a storm are evenly spaced
+ *        over its duration, in a random order, and each node which joins subscribes at once.
+ * @param scenario Scenario to be run.
+ * @param report In-out parameter where the outcome of the scenario is stored.
+ * @return Returns 0 in case of success and -1 if the scenario is invalid or a simulation is already running.
+ */
+int hpb_sim_scenario_run(const HpbSimScenario *scenario, HpbSimReport *report);
+
+/**
+ * @brief Prints the outcome of a scenario, without its CPU times, so that the output of two runs with the
+ *        same seed can be compared byte for byte.
+ * @param out Stream on which the report is printed.
+ * @param scenario Scenario which was run.
+ * @param report Outcome of the scenario.
+ */
+void hpb_sim_scenario_print_report(FILE *out, const HpbSimScenario *scenario, const HpbSimReport *report);
+
+#endif /* HPB_SIM_SCENARIO_H_INCLUDED_ */
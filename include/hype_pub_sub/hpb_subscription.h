@@ -8,6 +8,9 @@
 #include "hpb_constants.h"
 #include "sha/sha1.h"
 #include "binary_utils.h"
+#include "hpb_seq_window.h"
+#include "hpb_dedup.h"
+#include "hpb_topic_trie.h"
 #include <hype/hype.h>
 
 /**
@@ -18,14 +21,32 @@ typedef struct HpbSubscription_
     char *service_name; /**< Name of the service subscribed. */
     HLByte service_key[SHA1_BLOCK_SIZE]; /**< Key of the service subscribed. */
     HypeInstance * manager_instance; /**< Hype ID of the manager of the service */
+    HpbSeqWindow seq_window; /**< Sequence numbers of the info messages received from the manager. */
+    uint64_t gap_detected_ms; /**< Time at which missing info messages were detected, or 0 if none are missing. */
+    uint64_t last_nack_ms; /**< Time at which the last NACK was sent. */
+    unsigned int n_nacks; /**< Number of NACKs sent for the current gap. */
+    unsigned int n_unechoed; /**< Number of own messages delivered locally, whose sequence numbers the manager skips in the info messages. */
+    HpbDedupCache dedup_cache; /**< Messages recently delivered on the service, by publisher. It survives manager changes. */
+    uint64_t manager_change_ms; /**< Time at which the manager changed, or 0 if a message was received since then. */
+    bool is_pattern; /**< Indicates if the service name is a topic pattern with wildcards. */
+    HLByte placement_key[SHA1_BLOCK_SIZE]; /**< Key from which the manager is chosen: the rendezvous key of the pattern, or the service key. */
+    char *filter; /**< Filter expression evaluated by the manager before forwarding each message, or NULL. */
 } HpbSubscription;
 
 /**
  * @brief Allocates space for a HpbSubscription struct, and it initializes the service name, service key and manager ID.
+ *        Service names which are valid topic patterns become wildcard subscriptions.
  * @return Returns a pointer to the created struct or NULL if the space could not be allocated.
  */
 HpbSubscription *hpb_subscription_create(char *serv_name, size_t serv_name_len, HypeInstance * instance);
 
+/**
+ * @brief Forgets the sequence numbers received, the missing messages and the own messages not echoed. It is
+ *        called when the manager of the service changes, since each manager has its own sequence.
+ * @param subs Pointer to the HpbSubscription struct.
+ */
+void hpb_subscription_reset_sequence(HpbSubscription *subs);
+
 /**
  * @brief Deallocates the space previously allocated for the given HpbSubscription struct.
  * @param subs Pointer to the pointer of the HpbSubscription struct to be deallocated.
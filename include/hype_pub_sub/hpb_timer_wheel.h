@@ -0,0 +1,81 @@
+#ifndef HPB_TIMER_WHEEL_H_INCLUDED_
+#define HPB_TIMER_WHEEL_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sha/sha1.h"
+#include <hype/hype.h>
+
+#define HPB_TIMER_WHEEL_N_SLOTS 64
+#define HPB_TIMER_WHEEL_TICK_MS 1000
+
+/**
+ * @brief This struct represents a timer of a HpbTimerWheel, which identifies a subscriber of a service.
+ */
+typedef struct HpbTimer_
+{
+    uint64_t deadline_ms; /**< Time at which the timer expires. */
+    HLByte service_key[SHA1_BLOCK_SIZE]; /**< Key of the service. */
+    HLByte client_key[SHA1_BLOCK_SIZE]; /**< Key of the subscriber. */
+    struct HpbTimer_ *next; /**< Next timer of the same slot. */
+} HpbTimer;
+
+/**
+ * @brief This struct is a hashed timer wheel: timers are kept in HPB_TIMER_WHEEL_N_SLOTS slots of
+ *        HPB_TIMER_WHEEL_TICK_MS each, so that scheduling costs O(1) and advancing the wheel only visits
+ *        the slots of the ticks elapsed. Timers further than a full turn stay in their slot until their round.
+ */
+typedef struct HpbTimerWheel_
+{
+    HpbTimer *slots[HPB_TIMER_WHEEL_N_SLOTS]; /**< Timers of each slot. */
+    uint64_t current_tick; /**< Tick up to which the wheel was advanced. */
+    bool is_started; /**< Indicates if the wheel was already advanced once. */
+    size_t size; /**< Number of timers scheduled. */
+} HpbTimerWheel;
+
+/**
+ * @brief Callback called for each timer which expired.
+ * @param service_key Key of the service of the timer.
+ * @param client_key Key of the subscriber of the timer.
+ * @param deadline_ms Time at which the timer expired.
+ * @param arg Argument given to hpb_timer_wheel_advance().
+ */
+typedef void (*HpbTimerWheelCallback)(HLByte service_key[], HLByte client_key[], uint64_t deadline_ms, void *arg);
+
+/**
+ * @brief Allocates space for an empty HpbTimerWheel.
+ * @return Returns a pointer to the created wheel or NULL if the space could not be allocated.
+ */
+HpbTimerWheel *hpb_timer_wheel_create();
+
+/**
+ * @brief Schedules a timer. Timers scheduled in the past expire at the next advance.
+ * @param wheel Timer wheel.
+ * @param deadline_ms Time at which the timer expires.
+ * @param service_key Key of the service.
+ * @param client_key Key of the subscriber.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_timer_wheel_schedule(HpbTimerWheel *wheel, uint64_t deadline_ms, HLByte service_key[SHA1_BLOCK_SIZE], HLByte client_key[SHA1_BLOCK_SIZE]);
+
+/**
+ * @brief Removes the timers which expired up to the given time, and calls the callback for each one of them.
+ *        The callback may schedule new timers.
+ * @param wheel Timer wheel.
+ * @param now_ms Current time.
+ * @param callback Callback called for each timer which expired.
+ * @param arg Argument passed to the callback.
+ * @return Returns the number of timers which expired.
+ */
+size_t hpb_timer_wheel_advance(HpbTimerWheel *wheel, uint64_t now_ms, HpbTimerWheelCallback callback, void *arg);
+
+/**
+ * @brief Deallocates the space previously allocated for the wheel and its timers.
+ * @param wheel Pointer to the pointer of the wheel to be deallocated.
+ */
+void hpb_timer_wheel_destroy(HpbTimerWheel **wheel);
+
+#endif /* HPB_TIMER_WHEEL_H_INCLUDED_ */
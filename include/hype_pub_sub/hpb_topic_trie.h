@@ -0,0 +1,139 @@
+#ifndef HPB_TOPIC_TRIE_H_INCLUDED_
+#define HPB_TOPIC_TRIE_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "linked_list.h"
+#include "binary_utils.h"
+#include "sha/sha1.h"
+
+#define HPB_TOPIC_LEVEL_SEPARATOR '/'
+#define HPB_TOPIC_SINGLE_LEVEL_WILDCARD '+'
+#define HPB_TOPIC_MULTI_LEVEL_WILDCARD '#'
+#define HPB_TOPIC_LENGTH_SIZE 2
+#define HPB_TOPIC_MAX_LENGTH 0xFFFF
+
+/**
+ * @brief This struct represents a level of the topic trie. The patterns which end at the node are
+ *        identified by the keys of their services.
+ */
+typedef struct HpbTopicTrieNode_
+{
+    char *level; /**< Level of the node, which may be a wildcard. NULL for the root. */
+    LinkedList *children; /**< List of HpbTopicTrieNode elements. */
+    LinkedList *keys; /**< Keys of the services of the patterns which end at this node. */
+} HpbTopicTrieNode;
+
+/**
+ * @brief This struct is a trie of topic patterns, shared by all the wildcard subscriptions of a manager,
+ *        so that a topic is matched against all of them in a single walk of its levels.
+ *        A '+' level matches exactly one level and a trailing '#' level matches one or more levels.
+ */
+typedef struct HpbTopicTrie_
+{
+    HpbTopicTrieNode *root; /**< Root of the trie. */
+    size_t n_patterns; /**< Number of patterns in the trie. */
+} HpbTopicTrie;
+
+/**
+ * @brief Callback called for each pattern which matches a topic.
+ * @param service_key Key of the service of the pattern.
+ * @param arg Argument given to hpb_topic_trie_match().
+ */
+typedef void (*HpbTopicTrieMatchCallback)(HLByte service_key[], void *arg);
+
+/**
+ * @brief Checks if a topic name contains wildcards.
+ * @param topic Topic name, null terminated.
+ * @return Returns true if the topic is a pattern and false otherwise.
+ */
+bool hpb_topic_is_pattern(char *topic);
+
+/**
+ * @brief Checks if a pattern can be subscribed: it has wildcards, which take whole levels, '#' is the last
+ *        level, and its first level is a literal, which gives the rendezvous key of the pattern.
+ * @param pattern Pattern, null terminated.
+ * @return Returns true if the pattern is valid and false otherwise.
+ */
+bool hpb_topic_is_valid_pattern(char *pattern);
+
+/**
+ * @brief Obtains the rendezvous key of a hierarchical topic or pattern: the key of its first level followed
+ *        by the separator. Wildcard subscriptions are placed at the manager of this key, to which the publishers
+ *        of hierarchical topics also send their messages.
+ * @param topic Topic name or pattern.
+ * @param topic_length Length of the topic.
+ * @param key In-out parameter where the key is stored.
+ * @return Returns 0 in case of success and -1 if the topic is not hierarchical.
+ */
+int hpb_topic_get_rendezvous_key(char *topic, size_t topic_length, HLByte key[SHA1_BLOCK_SIZE]);
+
+/**
+ * @brief Prefixes a message with the topic in which it was published, so that the subscribers of a
+ *        pattern know the topic of each message.
+ * @param topic Topic name.
+ * @param topic_length Length of the topic name, up to HPB_TOPIC_MAX_LENGTH.
+ * @param msg Message.
+ * @param msg_length Length of the message.
+ * @param payload In-out parameter where the payload is stored.
+ * @return Returns the length of the payload, or 0 if the topic is too long.
+ */
+size_t hpb_topic_build_payload(char *topic, size_t topic_length, char *msg, size_t msg_length, char **payload);
+
+/**
+ * @brief Splits a payload built by hpb_topic_build_payload() into the topic and the message, without copies.
+ * @param payload Payload.
+ * @param payload_length Length of the payload.
+ * @param topic In-out parameter where the topic is stored. It is not null terminated.
+ * @param topic_length In-out parameter where the length of the topic is stored.
+ * @param msg In-out parameter where the message is stored.
+ * @param msg_length In-out parameter where the length of the message is stored.
+ * @return Returns 0 in case of success and -1 if the payload is truncated.
+ */
+int hpb_topic_parse_payload(char *payload, size_t payload_length, char **topic, size_t *topic_length, char **msg, size_t *msg_length);
+
+/**
+ * @brief Allocates space for an empty topic trie.
+ * @return Returns a pointer to the created trie or NULL if the space could not be allocated.
+ */
+HpbTopicTrie *hpb_topic_trie_create();
+
+/**
+ * @brief Adds a pattern to the trie.
+ * @param trie Topic trie.
+ * @param pattern Pattern, null terminated.
+ * @param service_key Key of the service of the pattern.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_topic_trie_add(HpbTopicTrie *trie, char *pattern, HLByte service_key[SHA1_BLOCK_SIZE]);
+
+/**
+ * @brief Removes a pattern from the trie, together with the levels left without patterns.
+ * @param trie Topic trie.
+ * @param pattern Pattern, null terminated.
+ * @param service_key Key of the service of the pattern.
+ * @return Returns 0 if the pattern was removed and -1 if it was not found.
+ */
+int hpb_topic_trie_remove(HpbTopicTrie *trie, char *pattern, HLByte service_key[SHA1_BLOCK_SIZE]);
+
+/**
+ * @brief Finds the patterns which match a topic.
+ * @param trie Topic trie.
+ * @param topic Topic name, which does not need to be null terminated.
+ * @param topic_length Length of the topic name.
+ * @param callback Callback called for each pattern which matches the topic.
+ * @param arg Argument passed to the callback.
+ * @return Returns the number of patterns which match the topic.
+ */
+size_t hpb_topic_trie_match(HpbTopicTrie *trie, char *topic, size_t topic_length, HpbTopicTrieMatchCallback callback, void *arg);
+
+/**
+ * @brief Deallocates the space previously allocated for the trie.
+ * @param trie Pointer to the pointer of the trie to be deallocated.
+ */
+void hpb_topic_trie_destroy(HpbTopicTrie **trie);
+
+#endif /* HPB_TOPIC_TRIE_H_INCLUDED_ */
@@ -0,0 +1,114 @@
+#ifndef HPB_TRANSPORT_H_INCLUDED_
+#define HPB_TRANSPORT_H_INCLUDED_
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hpb_event_loop.h"
+#include <hype/hype.h>
+
+typedef struct HpbTransport_ HpbTransport;
+
+/**
+ * @brief This struct holds the callbacks through which a transport reports the network events. They are
+ *        always invoked on the loop thread of the transport. Callbacks left NULL are not invoked.
+ */
+typedef struct HpbTransportCallbacks_
+{
+    void (*on_start) (bool success); /**< The transport started, or failed starting. */
+    void (*on_instance_found) (HypeInstance *instance); /**< An instance was found, and it can be resolved. */
+    void (*on_instance_resolved) (HypeInstance *instance); /**< An instance was resolved, so that messages can be sent to it. */
+    void (*on_instance_failed_resolving) (HypeInstance *instance); /**< The handshake with an instance failed. */
+    void (*on_instance_lost) (HypeInstance *instance); /**< An instance can no longer be reached. */
+    void (*on_message_received) (HypeInstance *origin, HLByte *data, size_t data_size); /**< A message arrived from an instance. */
+    void (*on_message_delivered) (uint64_t message_id); /**< A message sent was delivered to its destination. */
+    void (*on_message_send_failed) (uint64_t message_id); /**< A message sent could not be delivered. */
+} HpbTransportCallbacks;
+
+/**
+ * @brief This struct holds the operations of a transport backend, such as the Hype SDK or the local sockets.
+ */
+typedef struct HpbTransportOps_
+{
+    const char *name; /**< Name of the backend. */
+    int (*start) (HpbTransport *transport); /**< Starts the transport, which reports on_start once started. */
+    void (*stop) (HpbTransport *transport); /**< Stops the transport. */
+    HypeInstance *(*get_own_instance) (HpbTransport *transport); /**< Returns a new reference to the instance of this device. */
+    uint64_t (*send) (HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination); /**< Sends a message, returning its identifier or 0. */
+    void (*resolve) (HpbTransport *transport, HypeInstance *instance); /**< Starts the handshake with an instance found. */
+    void (*destroy) (HpbTransport *transport); /**< Deallocates the state of the backend. */
+} HpbTransportOps;
+
+/**
+ * @brief This struct represents a transport through which the HypePubSub application exchanges its messages.
+ */
+struct HpbTransport_
+{
+    const HpbTransportOps *ops; /**< Operations of the backend. */
+    HpbEventLoop *loop; /**< Event loop on which the callbacks are invoked. */
+    HpbTransportCallbacks callbacks; /**< Callbacks through which the network events are reported. */
+    void *state; /**< State of the backend. */
+};
+
+/**
+ * @brief Allocates space for a transport. It is called by the backends.
+ * @param ops Operations of the backend.
+ * @param loop Event loop on which the callbacks are invoked.
+ * @param callbacks Callbacks through which the network events are reported.
+ * @param state State of the backend, deallocated by its destroy operation.
+ * @return Returns a pointer to the created transport or NULL if the space could not be allocated.
+ */
+HpbTransport *hpb_transport_create(const HpbTransportOps *ops, HpbEventLoop *loop, HpbTransportCallbacks callbacks, void *state);
+
+/**
+ * @brief Obtains the callbacks which report the network events to the HypePubSub application.
+ * @param on_start Callback invoked when the transport starts or fails starting.
+ * @return Returns the callbacks.
+ */
+HpbTransportCallbacks hpb_transport_get_pub_sub_callbacks(void (*on_start) (bool success));
+
+/**
+ * @brief Starts a transport.
+ * @param transport Transport.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_transport_start(HpbTransport *transport);
+
+/**
+ * @brief Stops a transport.
+ * @param transport Transport.
+ */
+void hpb_transport_stop(HpbTransport *transport);
+
+/**
+ * @brief Obtains the instance of this device on the transport.
+ * @param transport Transport.
+ * @return Returns a new reference to the instance, to be released by the caller.
+ */
+HypeInstance *hpb_transport_get_own_instance(HpbTransport *transport);
+
+/**
+ * @brief Sends a message to an instance. Its delivery or failure is reported later through the callbacks.
+ * @param transport Transport.
+ * @param data Message to be sent.
+ * @param data_size Size of the message.
+ * @param destination Instance to which the message is sent.
+ * @return Returns the identifier of the message, or 0 if it could not be sent.
+ */
+uint64_t hpb_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination);
+
+/**
+ * @brief Starts the handshake with an instance found. Its result is reported later through the callbacks.
+ * @param transport Transport.
+ * @param instance Instance to be resolved.
+ */
+void hpb_transport_resolve(HpbTransport *transport, HypeInstance *instance);
+
+/**
+ * @brief Deallocates the space previously allocated for a transport and its backend.
+ * @param transport Pointer to the pointer of the transport to be deallocated.
+ */
+void hpb_transport_destroy(HpbTransport **transport);
+
+#endif /* HPB_TRANSPORT_H_INCLUDED_ */
@@ -0,0 +1,67 @@
+#ifndef HPB_TRANSPORT_SOCKET_H_INCLUDED_
+#define HPB_TRANSPORT_SOCKET_H_INCLUDED_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "linked_list.h"
+#include "hpb_transport.h"
+#include "hpb_event_loop.h"
+#include <hype/hype.h>
+
+#define HPB_TRANSPORT_SOCKET_MAX_NAME 32
+#define HPB_TRANSPORT_SOCKET_MAX_PATH 108 // Size of the path of a Unix socket address, terminator included
+#define HPB_TRANSPORT_SOCKET_MAX_FRAME (64 * 1024)
+#define HPB_TRANSPORT_SOCKET_SCAN_INTERVAL_MS 1000
+
+#define HPB_TRANSPORT_SOCKET_FRAME_DATA 0x01
+#define HPB_TRANSPORT_SOCKET_FRAME_HELLO 0x02
+#define HPB_TRANSPORT_SOCKET_FRAME_HELLO_ACK 0x03
+#define HPB_TRANSPORT_SOCKET_FRAME_BYE 0x04
+
+/**
+ * @brief This struct represents a node bound in the directory of the socket transport.
+ */
+typedef struct HpbSocketPeer_
+{
+    HypeInstance *instance; /**< Instance of the node, whose identifier is its name. */
+    uint64_t inode; /**< Inode of the socket file, which changes when the node restarts. */
+    bool is_resolved; /**< Indicates if the handshake with the node was completed. */
+    bool is_lost; /**< Indicates if the node could not be reached, so that it is not found again until its socket changes. */
+} HpbSocketPeer;
+
+/**
+ * @brief This struct holds the state of a transport over Unix datagram sockets, which runs several
+ *        HypePubSub nodes on a single machine without the Hype SDK. Each node binds a socket named after
+ *        it in a shared directory, and finds the other nodes by scanning that directory.
+ */
+typedef struct HpbSocketState_
+{
+    int fd; /**< Datagram socket bound by this node, or -1 if the transport is stopped. */
+    char dir[HPB_TRANSPORT_SOCKET_MAX_PATH]; /**< Directory shared by the nodes. */
+    char name[HPB_TRANSPORT_SOCKET_MAX_NAME + 1]; /**< Name of this node. */
+    uint8_t capacity; /**< Capacity announced to the other nodes. */
+    int scan_timer_id; /**< Timer which scans the directory, or -1. */
+    LinkedList *peers; /**< HpbSocketPeer elements of the nodes found. Only accessed from the loop thread. */
+    HLByte *buffer; /**< Buffer into which the frames are received. */
+    uint64_t next_message_id; /**< Identifier of the next message sent. */
+    pthread_mutex_t mutex; /**< Guards the message identifiers, since the fan-out workers send as well. */
+} HpbSocketState;
+
+/**
+ * @brief Creates a transport over Unix datagram sockets. The frames sent to a node are delivered as soon as
+ *        they are queued on its socket, and a node is lost when its socket disappears or refuses the frames.
+ * @param loop Event loop on which the socket is read and the callbacks are invoked.
+ * @param callbacks Callbacks through which the network events are reported.
+ * @param dir Directory shared by the nodes, which must exist.
+ * @param name Name of this node, unique in the directory.
+ * @param capacity Capacity announced to the other nodes, from 1 to HPB_CLIENT_MAX_CAPACITY.
+ * @return Returns the transport, or NULL if the name is invalid or the space could not be allocated.
+ */
+HpbTransport *hpb_transport_socket_create(HpbEventLoop *loop, HpbTransportCallbacks callbacks, const char *dir, const char *name, uint8_t capacity);
+
+#endif /* HPB_TRANSPORT_SOCKET_H_INCLUDED_ */
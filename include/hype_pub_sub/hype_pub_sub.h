@@ -9,32 +9,152 @@
 #include "hpb_subscriptions_list.h"
 #include "hpb_network.h"
 #include "hpb_protocol.h"
+#include "hpb_fanout.h"
+#include "hpb_retry_queue.h"
+#include "hpb_handover.h"
+#include "hpb_seq_window.h"
+#include "hpb_dedup.h"
+#include "hpb_clock.h"
+#include "hpb_timer_wheel.h"
+#include "hpb_membership.h"
+#include "hpb_topic_trie.h"
+#include "hpb_filter.h"
+#include "hpb_relay_tree.h"
+#include "hpb_direct_route.h"
+#include "hpb_resolver.h"
+#include "hpb_transport.h"
+#include "hpb_metrics.h"
+
+#define HPB_PERIODIC_TASKS_INTERVAL_MS 50
+#define HPB_RETAINED_MAX_BYTES (256 * 1024)
+#define HPB_NACK_DELAY_MS 100
+#define HPB_NACK_INTERVAL_MS 500
+#define HPB_NACK_MAX_ATTEMPTS 3
+#define HPB_LEASE_DURATION_MS 30000
+#define HPB_LEASE_RENEWAL_MS 10000
+#define HPB_REPLICATION_DEFAULT_FACTOR 2
+#define HPB_REPLICATION_MAX_FACTOR 8
+#define HPB_REPLICATION_REFRESH_MS 10000
+#define HPB_REPLICATION_EXPIRATION_MS (3 * HPB_REPLICATION_REFRESH_MS)
+#define HPB_SHARDING_DEFAULT_SHARDS 4
+#define HPB_SHARDING_MAX_SHARDS 16
+#define HPB_SHARDING_SUBSCRIBERS_THRESHOLD 32
+#define HPB_SHARDING_PUBLISH_RATE_THRESHOLD 20
+#define HPB_SHARDING_MIN_SUBSCRIBERS 8
+#define HPB_SHARDING_REFRESH_MS 10000
+#define HPB_SHARDING_EXPIRATION_MS (3 * HPB_SHARDING_REFRESH_MS)
+#define HPB_DIRECT_MAX_SUBSCRIBERS 32
+#define HPB_DIRECT_REFRESH_MS 10000
+#define HPB_DIRECT_LEASE_MS (3 * HPB_DIRECT_REFRESH_MS)
+
+/**
+ * @brief Callback used to notify the application about the outcome of a publish request sent to a
+ *        remote service manager: it was delivered, or it was given up after its retry deadline.
+ */
+typedef void (*HpbPublishCompletionCallback) (HLByte service_key[], bool success);
+
+/**
+ * @brief Callback used to hand the messages received on the own subscriptions to the application, instead of
+ *        printing them.
+ */
+typedef void (*HpbMessageReceivedCallback) (char *service_name, char *msg, size_t msg_length);
 
 /**
  * @brief This struct represents a HypePubSub application.
  */
 typedef struct HypePubSub_
 {
+    HpbTransport *transport; /**< Transport through which the messages are sent, not owned by this HypePubSub application. */
     HpbSubscriptionsList *own_subscriptions; /**< List of subscriptions of this HypePubSub application. */
     HpbServiceManagersList *managed_services; /**< List of services managed by this HypePubSub application. */
     HpbNetwork *network; /**< Pointer to the network manager of this HypePubSub application. */
+    HpbFanout *fanout; /**< Pointer to the engine which sends the info messages to the subscribers. */
+    HpbRetryQueue *retry_queue; /**< Queue of the sent messages which are retried if sending them fails. */
+    HpbHandover *handover; /**< Publishes forwarded and buffered while services move between managers. */
+    HpbPublishCompletionCallback publish_completion_callback; /**< Callback for the outcome of publish requests, or NULL. */
+    HpbMessageReceivedCallback message_received_callback; /**< Callback for the messages received, or NULL to print them. */
+    uint32_t publisher_tag; /**< Tag which identifies the messages published by this HypePubSub application. */
+    uint32_t next_publisher_seq; /**< Publisher sequence number assigned to the next message published. */
+    uint64_t n_duplicates_suppressed; /**< Number of duplicated info messages which were not delivered. */
+    HpbServiceManagersList *replicas; /**< Copies of the services managed by other clients, taken over if their manager is lost. */
+    size_t replication_factor; /**< Number of clients to which the state of each managed service is replicated. */
+    uint64_t n_promotions; /**< Number of replicas which became managed services. */
+    uint64_t n_failovers; /**< Number of manager changes of the own subscriptions followed by a message. */
+    uint64_t failover_total_ms; /**< Sum of the times from a manager change to the first message of the new manager. */
+    uint64_t failover_max_ms; /**< Longest time from a manager change to the first message of the new manager. */
+    HpbTimerWheel *lease_timers; /**< Timers of the leases of the subscribers of the managed services. */
+    uint64_t last_heartbeat_ms; /**< Time at which the leases of the own subscriptions were last renewed. */
+    uint64_t n_lease_expirations; /**< Number of subscribers removed because their lease expired. */
+    HpbMembership *membership; /**< Membership events waiting to be applied to the network in a single rebalance. */
+    HpbTopicTrie *topic_trie; /**< Patterns of the wildcard subscriptions managed by this HypePubSub application. */
+    uint64_t n_filter_evaluations; /**< Number of evaluations of the filters of the subscribers of the managed services. */
+    uint64_t n_filtered; /**< Number of info messages not sent because they did not pass the filter of their subscriber. */
+    size_t n_shards; /**< Number of shards among which the subscribers of a hot service are split. 0 disables the sharding. */
+    HpbServiceManagersList *shards; /**< Subscribers of the shards owned by this client of the services managed by other clients. */
+    uint64_t n_shard_forwards; /**< Number of messages of the managed services forwarded to the owners of their shards. */
+    uint64_t n_shard_deliveries; /**< Number of info messages sent to the subscribers of the shards owned by this client. */
+    size_t relay_branching; /**< Number of relays to which a message is sent instead of all its subscribers. 0 disables the relay trees. */
+    uint64_t n_relay_trees; /**< Number of messages sent through a relay tree. */
+    uint64_t n_relay_forwards; /**< Number of messages forwarded by this client as a relay of the subscribers of its subtree. */
+    LinkedList *direct_routes; /**< HpbDirectRoute elements of the services to which this client publishes directly. */
+    uint64_t n_direct_publishes; /**< Number of messages sent by this client directly to the subscribers instead of to the manager. */
+    uint64_t n_local_deliveries; /**< Number of own messages delivered to the own subscriptions when published, without waiting for the manager. */
+    uint64_t n_echoes_suppressed; /**< Number of info messages not sent back to their publisher, which already delivered them. */
+    HpbResolver *resolver; /**< Handshakes with the instances found on the network, limited in number and closest to the services of this client first. */
+    HpbMetrics *metrics; /**< Counters of the messages sent and received, incremented by the fan-out workers too. */
 } HypePubSub;
 
 /**
- * @brief This method returns the HypePubSub singleton. If the singleton was not previously
- *        created this methods creates it.
- * @return Returns a pointer to the HypePubSub singleton.
+ * @brief This method returns the current HypePubSub application, on which all the other methods operate.
+ *        If there is none this methods creates the singleton.
+ * @return Returns a pointer to the current HypePubSub application.
  */
 HypePubSub *hpb_get();
 
+/**
+ * @brief Creates a HypePubSub application independent from the singleton, so that a simulation hosts many
+ *        of them in a single process. It is used by making it the current application.
+ * @param transport Transport of the application, from which its own instance is obtained. It is not owned.
+ * @return Returns a pointer to the created application.
+ */
+HypePubSub *hpb_create(HpbTransport *transport);
+
+/**
+ * @brief Makes an application the current one, on which all the other methods operate until another one
+ *        is made current. The fan-out workers send on behalf of the current application, so it must not be
+ *        changed while a fan-out is in progress.
+ * @param context Application created by hpb_create, or NULL.
+ */
+void hpb_set_current(HypePubSub *context);
+
+/**
+ * @brief Sets the transport through which the messages are sent and the instances are resolved. It must be
+ *        called before the singleton is created, since the own instance is obtained from the transport.
+ *        The transport is not owned by the singleton. Without a transport nothing is sent.
+ * @param transport Transport, or NULL.
+ */
+void hpb_set_transport(HpbTransport *transport);
+
 /**
  * @brief Obtains the Hype client responsible for a given service through the network manager
  *        and it uses the protocol manager to send a subscribe request to that Hype client.
+ *        Service names which are valid topic patterns, such as "site1/+/temperature" or "site1/#",
+ *        subscribe all the hierarchical topics they match, through the manager of their first level.
  * @param service_name Name of the service to be subscribed.
  * @return Return 0 in case of success and -1 otherwise.
  */
 int hpb_issue_subscribe_req(char *service_name);
 
+/**
+ * @brief Subscribes a service as hpb_issue_subscribe_req(), with a filter which the manager evaluates over each
+ *        message of the service before forwarding it, such as "type == alarm && device == 7".
+ *        Subscribing a service again replaces its filter.
+ * @param service_name Name of the service to be subscribed.
+ * @param filter Filter expression, null terminated, or NULL to receive all the messages.
+ * @return Return 0 in case of success and -1 if the filter is invalid or the subscription failed.
+ */
+int hpb_issue_filtered_subscribe_req(char *service_name, char *filter);
+
 /**
  * @brief Obtains the Hype client responsible for a given service through the network manager
  *        and it uses the protocol manager to send a unsubscribe request to that Hype client.
@@ -46,6 +166,8 @@ int hpb_issue_unsubscribe_req(char *service_name);
 /**
  * @brief Obtains the Hype client responsible for a given service through the network manager
  *        and it uses the protocol manager to send a publish request to that Hype client.
+ *        The messages of hierarchical topics are also sent to the manager of their first level,
+ *        which delivers them to the wildcard subscriptions they match.
  * @param hpb Pointer to the HypePubSub application.
  * @param service_name Name of the service in which to publish.
  * @param msg Pointer to the message to be published.
@@ -54,10 +176,22 @@ int hpb_issue_unsubscribe_req(char *service_name);
  */
 int hpb_issue_publish_req(char *service_name, char *msg, size_t msg_length);
 
+/**
+ * @brief Obtains the Hype client responsible for a given service through the network manager
+ *        and it uses the protocol manager to send a retained publish request to that Hype client.
+ *        The manager keeps the message and sends it to every new subscriber of the service.
+ * @param service_name Name of the service in which to publish.
+ * @param msg Pointer to the message to be published.
+ * @param msg_length Lenght of the message to be published
+ * @return Return 0 in case of success and -1 otherwise.
+ */
+int hpb_issue_retained_publish_req(char *service_name, char *msg, size_t msg_length);
+
 /**
  * @brief Processes a subscribe request to a given service. It adds the ID of the Hype client that sent the
  *        request to the list of the subscribers of the specified service. If the service does not exist in
- *        the list of managed services, it is added.
+ *        the list of managed services, it is added and the publishes buffered for it are delivered. The
+ *        retained message of the service, if any, is sent to the new subscriber.
  * @param hpb Pointer to the HypePubSub application.
  * @param service_key Key of the service to be subscribed.
  * @param requester_client_id Hype ID of the client that sent the subscribe message.
@@ -65,6 +199,27 @@ int hpb_issue_publish_req(char *service_name, char *msg, size_t msg_length);
  */
 int hpb_process_subscribe_req(HLByte service_key[], HypeInstance * instance);
 
+/**
+ * @brief Processes a subscribe request to a topic pattern. The service of the pattern is created if
+ *        needed and its pattern is added to the topic trie, so that the hierarchical topics it matches
+ *        are delivered to it. The subscriber is then added as by hpb_process_subscribe_req().
+ * @param service_key Key of the pattern.
+ * @param pattern Topic pattern, null terminated.
+ * @param instance Hype instance of the subscriber.
+ * @return Returns 0 in case of success and < 0 otherwise.
+ */
+int hpb_process_pattern_subscribe_req(HLByte service_key[], char *pattern, HypeInstance * instance);
+
+/**
+ * @brief Processes the filter of a subscribe request, which replaces the filter of the subscriber. Subscribers
+ *        whose filter is invalid get all the messages of the service.
+ * @param service_key Key of the service subscribed.
+ * @param filter Filter expression, null terminated, or NULL to clear the filter.
+ * @param instance Hype instance of the subscriber.
+ * @return Returns 0 in case of success and < 0 otherwise.
+ */
+int hpb_process_filter_req(HLByte service_key[], char *filter, HypeInstance * instance);
+
 /**
  * @brief Processes an unsubscribe request to a given service. It removes the ID of the Hype client that sent
  *        the request from the list of the subscribers of the specified service. If the service does not exist
@@ -78,24 +233,300 @@ int hpb_process_unsubscribe_req(HLByte service_key[], HypeInstance * instance);
 
 /**
  * @brief Processes a publish request to a given service. It sends the message to all the subscribers of the
- *        specified service. If the service does not exist in the list of managed services nothing is done.
+ *        specified service. If the service does not exist in the list of managed services and it was recently
+ *        handed over to another manager, the publish is forwarded to that manager. Otherwise the publish is
+ *        buffered for a short time, until the first subscriber of the service arrives.
+ *        The info message is encoded once and the same frame is handed to the fan-out engine, which sends
+ *        it in parallel when the service has many subscribers.
  * @param hpb Pointer to the HypePubSub application.
  * @param service_key Key of the service in which to publish.
+ * @param origin Publisher tag and publisher sequence number of the message.
  * @param msg Message to be sent.
  * @param msg_length Length of the message to be sent.
  * @return Returns 0 in case of success and < 0 otherwise.
  */
-int hpb_process_publish_req(HLByte service_key[], char *msg, size_t msg_length);
+int hpb_process_publish_req(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length);
 
 /**
- * @brief Process an info message received.
+ * @brief Processes a publish request of a publisher subscribed to the service, which already delivered the
+ *        message to itself. The message is published as any other message, except that it is not sent
+ *        back to the publisher, which is the instance which sent the request.
+ * @param service_key Key of the service in which to publish.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param msg Message to be sent.
+ * @param msg_length Length of the message to be sent.
+ * @param is_retained Indicates if the message is retained by the service.
+ * @param instance_origin Instance of the publisher.
+ * @return Returns 0 in case of success and < 0 otherwise.
+ */
+int hpb_process_no_echo_publish_req(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, bool is_retained, HypeInstance * instance_origin);
+
+/**
+ * @brief Processes a publish request to the wildcard subscriptions of a hierarchical topic. The topic
+ *        is matched against the topic trie and the message is published in the service of each pattern
+ *        which matches it, with the topic as a prefix, so that the subscribers know where it was published.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param payload Topic and message, built by hpb_topic_build_payload().
+ * @param payload_length Length of the payload.
+ * @return Returns the number of patterns which match the topic, or -1 if the payload is invalid.
+ */
+int hpb_process_pattern_publish_req(HpbPublishOrigin origin, char *payload, size_t payload_length);
+
+/**
+ * @brief Processes a retained publish request to a given service. The message replaces the retained
+ *        message of the service, as long as the retained messages of all the services fit in
+ *        HPB_RETAINED_MAX_BYTES, and it is then published as any other message.
+ * @param service_key Key of the service in which to publish.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param msg Message to be retained and sent.
+ * @param msg_length Length of the message.
+ * @return Returns 0 in case of success and < 0 otherwise.
+ */
+int hpb_process_retained_publish_req(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length);
+
+/**
+ * @brief Process an info message received. A message already delivered, e.g. by both the old and
+ *        the new manager of the service during a rebalance, is recognized by its origin and suppressed.
  * @param hpb Pointer to the HypePubSub application.
  * @param service_key Key of the service to which the message belongs.
+ * @param origin Publisher tag and publisher sequence number of the message.
  * @param msg Message received.
  * @param msg_length Length of the received message.
- * @return Returns 0 in case of success and < 0 otherwise.
+ * @return Returns 0 in case of success, -2 if the message is a duplicate and -1 otherwise.
+ */
+int hpb_process_info_msg(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length);
+
+/**
+ * @brief Process an info message received from a service manager. Duplicated messages are discarded,
+ *        and the messages missed by this client are detected from the gaps in the sequence numbers.
+ *        The missing messages are requested to the manager from hpb_process_periodic_tasks().
+ * @param service_key Key of the service to which the message belongs.
+ * @param seq Sequence number assigned to the message by the service manager.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param msg Message received.
+ * @param msg_length Length of the received message.
+ * @return Returns 0 in case of success, -2 if the message is a duplicate and -1 otherwise.
+ */
+int hpb_process_sequenced_info_msg(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length);
+
+/**
+ * @brief Processes a NACK sent by a subscriber which missed some messages of a given service. The
+ *        messages which are still kept in the history of the service are resent to that subscriber.
+ * @param service_key Key of the service.
+ * @param ranges Ranges of sequence numbers missed by the subscriber.
+ * @param n_ranges Number of ranges.
+ * @param instance_origin Hype instance of the subscriber.
+ * @return Returns the number of messages resent, or -1 if the service is not managed by this client.
+ */
+int hpb_process_nack_req(HLByte service_key[], HpbSeqRange ranges[], size_t n_ranges, HypeInstance * instance_origin);
+
+/**
+ * @brief Processes the state of a service handed over by its previous manager. The subscribers are
+ *        added to the service, which is served right away without waiting for them to subscribe again.
+ *        The sequence numbers of the service are continued, unless this client already sent messages
+ *        on it, and the retained message is kept if there is none and it fits. The publishes buffered
+ *        for the service are delivered.
+ * @param service_key Key of the service.
+ * @param pattern Topic pattern of the service, or NULL.
+ * @param next_seq Sequence number assigned to the next message of the service.
+ * @param retained_origin Origin of the retained message.
+ * @param retained_msg Retained message of the service, or NULL.
+ * @param retained_msg_length Length of the retained message.
+ * @param subscribers Hype instances of the subscribers of the service.
+ * @param n_subscribers Number of subscribers.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_process_handover_req(HLByte service_key[], char *pattern, uint32_t next_seq, HpbPublishOrigin retained_origin, char *retained_msg,
+                             size_t retained_msg_length, HypeInstance *subscribers[], size_t n_subscribers);
+
+/**
+ * @brief Renews the leases of the subscriptions of a client to the services managed by this client.
+ *        A client which is not a subscriber of one of the services, for example because its lease
+ *        already expired, subscribes it again. A wildcard or filtered subscription cannot be recreated
+ *        from its key, so the keys of those which are unknown are sent back to the client instead.
+ * @param service_keys Keys of the services, one after the other.
+ * @param key_flags Wildcard and filter flags of each subscription, or NULL if no subscription has them.
+ * @param n_services Number of services.
+ * @param instance_origin Hype instance of the subscriber.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_process_heartbeat_req(HLByte *service_keys, HLByte *key_flags, size_t n_services, HypeInstance *instance_origin);
+
+/**
+ * @brief Subscribes again the subscriptions of this client which a manager could not renew.
+ * @param service_keys Keys of the services, one after the other.
+ * @param n_services Number of services.
+ * @param instance_origin Hype instance of the manager.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_process_unknown_heartbeat_msg(HLByte *service_keys, size_t n_services, HypeInstance *instance_origin);
+
+/**
+ * @brief Processes a copy of the state of a service managed by another client. The copy replaces the
+ *        previous one and it is dropped if the service has no subscribers nor retained message.
+ * @param service_key Key of the service.
+ * @param pattern Topic pattern of the service, or NULL.
+ * @param next_seq Sequence number assigned to the next message of the service.
+ * @param retained_origin Origin of the retained message.
+ * @param retained_msg Retained message of the service, or NULL.
+ * @param retained_msg_length Length of the retained message.
+ * @param subscribers Hype instances of the subscribers of the service.
+ * @param n_subscribers Number of subscribers.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_process_replica_req(HLByte service_key[], char *pattern, uint32_t next_seq, HpbPublishOrigin retained_origin, char *retained_msg,
+                            size_t retained_msg_length, HypeInstance *subscribers[], size_t n_subscribers);
+
+/**
+ * @brief Sets the number of clients, next closest to each service after its manager, to which the
+ *        state of the services managed by this client is replicated. 0 disables the replication.
+ * @param replication_factor Number of replicas, up to HPB_REPLICATION_MAX_FACTOR.
+ * @return Returns 0 in case of success and -1 if the number of replicas is too high.
+ */
+int hpb_set_replication_factor(size_t replication_factor);
+
+/**
+ * @brief Processes the subscribers of the shards of a service, sent by its manager, to which this client
+ *        sends the messages forwarded by the manager. They replace the previous subscribers of the shards.
+ * @param service_key Key of the service.
+ * @param subscribers Subscribers of the shards owned by this client.
+ * @param n_subscribers Number of subscribers. 0 drops the shards of the service.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_process_shard_req(HLByte service_key[], HypeInstance *subscribers[], size_t n_subscribers);
+
+/**
+ * @brief Processes a message forwarded by the manager of a service to this client, which sends it to the
+ *        subscribers of its shards with the sequence number given by the manager.
+ * @param service_key Key of the service.
+ * @param seq Sequence number assigned to the message by the manager.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param msg Message.
+ * @param msg_length Length of the message.
+ * @return Returns 0 in case of success and -1 if this client owns no shard of the service.
+ */
+int hpb_process_shard_publish_req(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length);
+
+/**
+ * @brief Sets the number of shards among which the subscribers of a managed service are split once it has
+ *        HPB_SHARDING_SUBSCRIBERS_THRESHOLD subscribers, or HPB_SHARDING_PUBLISH_RATE_THRESHOLD messages per second.
+ * @param n_shards Number of shards, up to HPB_SHARDING_MAX_SHARDS. 0 or 1 disables the sharding.
+ * @return Returns 0 in case of success and -1 if the number of shards is too high.
+ */
+int hpb_set_shards(size_t n_shards);
+
+/**
+ * @brief Processes a message relayed to this client, which is delivered to the own subscription and forwarded
+ *        to the subscribers of the subtree of this client, split among the relays with the cheapest links.
+ * @param service_key Key of the service.
+ * @param seq Sequence number assigned to the message by the manager.
+ * @param origin Publisher tag and publisher sequence number of the message.
+ * @param branching Number of branches in which the subtree is split.
+ * @param children Subscribers of the subtree of this client, sorted by key.
+ * @param n_children Number of subscribers of the subtree.
+ * @param msg Message, null terminated.
+ * @param msg_length Length of the message, without the null terminator.
+ * @return Returns 0 in case of success and -1 if the subtree cannot be split.
+ */
+int hpb_process_relay_req(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, uint8_t branching,
+                          HypeInstance *children[], size_t n_children, char *msg, size_t msg_length);
+
+/**
+ * @brief Sets the branching factor of the relay trees. A message with more recipients than the branching factor
+ *        is sent to that many relays, which forward it to their subtrees, so that the sends of the manager do not
+ *        grow with the number of subscribers.
+ * @param branching Branching factor, up to HPB_RELAY_TREE_MAX_BRANCHING. 0 or 1 sends each message to every subscriber.
+ * @return Returns 0 in case of success and -1 if the branching factor is too high.
+ */
+int hpb_set_relay_branching(size_t branching);
+
+/**
+ * @brief Processes a subscriber list request, which a publisher sends to the manager of a service to send its
+ *        messages directly to the subscribers. The manager replies with the current subscribers and pushes them
+ *        again whenever they change, until the lease of the publisher expires.
+ * @param service_key Key of the service.
+ * @param publisher Hype instance of the publisher.
+ * @return Returns 0 if the subscribers were sent and -1 if the service cannot be published directly.
+ */
+int hpb_process_subscriber_list_req(HLByte service_key[], HypeInstance *publisher);
+
+/**
+ * @brief Processes a subscriber list pushed by the manager of a service to which this client publishes directly.
+ * @param service_key Key of the service.
+ * @param version Version of the subscribers.
+ * @param is_refused Indicates if the manager refused the direct publishes.
+ * @param subscribers Subscribers of the service.
+ * @param n_subscribers Number of subscribers.
+ * @param manager Hype instance which sent the list.
+ * @return Returns 0 if the list was applied and -1 if it was discarded.
+ */
+int hpb_process_subscriber_list_msg(HLByte service_key[], uint32_t version, bool is_refused, HypeInstance *subscribers[],
+                                    size_t n_subscribers, HypeInstance *manager);
+
+/**
+ * @brief Sends the messages published by this client in a service directly to its subscribers, as pushed by
+ *        the manager, instead of through the manager. The manager still sends the retained messages, and the
+ *        messages published while the subscribers are not known.
+ * @param service_name Name of the service.
+ * @param is_direct Indicates if the messages are sent directly or through the manager.
+ * @return Returns 0 in case of success and -1 otherwise.
+ */
+int hpb_set_direct_publish(char *service_name, bool is_direct);
+
+/**
+ * @brief Registers that a Hype instance was resolved or lost. The events are coalesced over the membership
+ *        window and their net change is applied to the network in a single rebalance of the services.
+ * @param instance Hype instance resolved or lost.
+ * @param is_resolved Indicates if the instance was resolved, or lost otherwise.
+ * @return Returns 0 in case of success and -1 otherwise.
  */
-int hpb_process_info_msg(HLByte service_key[], char *msg, size_t msg_length);
+int hpb_process_membership_event(HypeInstance *instance, bool is_resolved);
+
+/**
+ * @brief Registers that a Hype instance was found on the network. The handshake with the instance is started
+ *        when fewer than the maximum number of handshakes are in progress, the instances closest to the
+ *        services subscribed or managed by this client first, since they are the likely managers and
+ *        subscribers of those services.
+ * @param instance Hype instance found.
+ * @return Returns 0 in case of success and -1 if the instance is already queued or being resolved.
+ */
+int hpb_process_instance_found(HypeInstance *instance);
+
+/**
+ * @brief Registers that the handshake with a Hype instance failed, which frees its slot for the next instance.
+ * @param instance Hype instance which could not be resolved.
+ * @return Returns 0 in case of success and -1 if the handshake was not in progress.
+ */
+int hpb_process_instance_failed_resolving(HypeInstance *instance);
+
+/**
+ * @brief Sets the maximum number of handshakes in progress with the instances found on the network.
+ * @param max_resolutions Maximum number of handshakes, from 1 to HPB_RESOLVER_MAX_IN_FLIGHT.
+ * @return Returns 0 in case of success and -1 if the number is out of range.
+ */
+int hpb_set_max_resolutions(size_t max_resolutions);
+
+/**
+ * @brief Sets the time without membership events after which their net change is applied.
+ *        0 applies each event at once, as long as the instance is not held back for flapping.
+ * @param window_ms Window in milliseconds.
+ */
+void hpb_set_membership_window(uint64_t window_ms);
+
+/**
+ * @brief Sets how the services are placed on the hype devices, and moves the managed services and the
+ *        subscriptions to their new managers. All the devices of the network must use the same placement.
+ * @param placement Placement of the services.
+ */
+void hpb_set_placement(HpbPlacement placement);
+
+/**
+ * @brief This method is called when a Hype instance is lost. The replicas of the services for which
+ *        this client is now the closest one become managed services at once, so that they are served
+ *        before their subscribers notice the loss of their manager.
+ * @return Returns the number of replicas promoted.
+ */
+int hpb_promote_replicas();
 
 /**
  * @brief This method is called when a Hype instance is resolved. Its
@@ -103,7 +534,10 @@ int hpb_process_info_msg(HLByte service_key[], char *msg, size_t msg_length);
  *        the key of any of the services managed by this client. If this
  *        happens the new instance will be responsible for managing that
  *        service and so we can remove it from the list of managed
- *        services of this client.
+ *        services of this client. The state of the services moving to
+ *        the same manager is sent to it in a single handover message,
+ *        and the publishes received for those services during the
+ *        transition are forwarded to the new manager.
  * @return
  */
 int hpb_update_managed_services();
@@ -129,9 +563,60 @@ void hpb_remove_subscriptions_from_lost_instance(HypeInstance * instance);
 int hpb_update_own_subscriptions();
 
 /**
- * @brief Deallocates the space previously allocated for the HypePubSub singleton.
+ * @brief Sets the callback called when a publish request sent to a remote service manager is
+ *        delivered or given up.
+ * @param callback Callback to be called, or NULL.
+ */
+void hpb_set_publish_completion_callback(HpbPublishCompletionCallback callback);
+
+/**
+ * @brief Sets the callback to which the messages received on the own subscriptions are handed.
+ * @param callback Callback to be called, or NULL to print the messages.
+ */
+void hpb_set_message_received_callback(HpbMessageReceivedCallback callback);
+
+/**
+ * @brief This method is called when the Hype SDK reports that a message could not be sent.
+ *        The message is scheduled to be retried with exponential backoff.
+ * @param message_id Identifier of the message which failed.
+ * @return Returns 0 if the message was being tracked and -1 otherwise.
+ */
+int hpb_process_message_failed(uint64_t message_id);
+
+/**
+ * @brief This method is called when the Hype SDK reports that a message was delivered.
+ *        The message stops being tracked by the retry queue.
+ * @param message_id Identifier of the message which was delivered.
+ * @return Returns 0 if the message was being tracked and -1 otherwise.
+ */
+int hpb_process_message_delivered(uint64_t message_id);
+
+/**
+ * @brief Samples the sizes of the lists of the current HypePubSub application into the gauges of its metrics.
+ *        The counters and histograms are kept up to date as the messages are sent and received.
+ * @return Returns a pointer to the metrics of the current HypePubSub application.
+ */
+HpbMetrics *hpb_collect_metrics();
+
+/**
+ * @brief Runs the time based maintenance of the HypePubSub application, such as resending the
+ *        failed messages whose backoff elapsed, dropping the expired handover state and requesting the
+ *        info messages missed by this client. It should be called every
+ *        HPB_PERIODIC_TASKS_INTERVAL_MS milliseconds.
+ */
+void hpb_process_periodic_tasks();
+
+/**
+ * @brief Deallocates the space previously allocated for the current HypePubSub application.
  *        This method is specially useful to clear previous states for unit tests.
  */
 void hpb_destroy();
 
+/**
+ * @brief Deallocates the space previously allocated for a HypePubSub application. If it is the current one,
+ *        there is no current application anymore.
+ * @param context Pointer to the pointer of the application to be deallocated.
+ */
+void hpb_destroy_context(HypePubSub **context);
+
 #endif /* HPB_H_INCLUDED_ */
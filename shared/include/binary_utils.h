@@ -4,6 +4,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 
 typedef unsigned char HLByte;
 
@@ -42,6 +43,20 @@ char *binary_utils_to_binary_char_array(HLByte *byte_array, size_t byte_array_si
  */
 char *binary_utils_get_formatted_binary_str(HLByte *byte_array, size_t byte_array_size);
 
+/**
+ * @brief Writes a 32 bits integer in a byte array, as BigEndian.
+ * @param byte_array Byte array with at least 4 bytes where the value is written.
+ * @param value Value to be written.
+ */
+void binary_utils_write_uint32(HLByte *byte_array, uint32_t value);
+
+/**
+ * @brief Reads a 32 bits integer from a byte array, interpreted as BigEndian.
+ * @param byte_array Byte array with at least 4 bytes from where the value is read.
+ * @return Returns the value read.
+ */
+uint32_t binary_utils_read_uint32(HLByte *byte_array);
+
 /**
  * @brief Prints a byte array in its hexadecimal form.
  * @param array Array to be printed
@@ -80,6 +80,19 @@ char *binary_utils_get_formatted_binary_str(HLByte *byte_array, size_t byte_arra
     return formatted_str;
 }
 
+void binary_utils_write_uint32(HLByte *byte_array, uint32_t value)
+{
+    byte_array[0] = (HLByte) (value >> 24);
+    byte_array[1] = (HLByte) (value >> 16);
+    byte_array[2] = (HLByte) (value >> 8);
+    byte_array[3] = (HLByte) value;
+}
+
+uint32_t binary_utils_read_uint32(HLByte *byte_array)
+{
+    return ((uint32_t) byte_array[0] << 24) | ((uint32_t) byte_array[1] << 16) | ((uint32_t) byte_array[2] << 8) | (uint32_t) byte_array[3];
+}
+
 void binary_utils_print_hex_array(HLByte *array, size_t len)
 {
     printf("0x");
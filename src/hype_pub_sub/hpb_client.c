@@ -6,6 +6,18 @@ HpbClient *hpb_client_create(HypeInstance *instance)
     HpbClient* client = (HpbClient*) malloc(sizeof(HpbClient));
     client->hype_instance = hype_instance_create(instance->identifier,instance->announcement,instance->is_resolved);
     sha1_digest(client->hype_instance->identifier->data, client->hype_instance->identifier->size, client->key);
+    client->lease_expiration_ms = 0;
+    client->lease_timer_ms = 0;
+    client->filter = NULL;
+    client->is_sharded = false;
+    client->link_cost_ms = HPB_CLIENT_DEFAULT_LINK_COST_MS;
+    client->n_link_samples = 0;
+
+    client->capacity = HPB_CLIENT_DEFAULT_CAPACITY;
+    HypeBuffer *announcement = client->hype_instance->announcement;
+    if(announcement != NULL && announcement->size >= 1 && announcement->data[0] >= 1 && announcement->data[0] <= HPB_CLIENT_MAX_CAPACITY) {
+        client->capacity = announcement->data[0];
+    }
     return client;
 }
 
@@ -21,6 +33,17 @@ bool hpb_client_is_instance_equal(HpbClient *client, HypeInstance *instance)
     return false;
 }
 
+void hpb_client_update_link_cost(HpbClient *client, uint32_t sample_ms)
+{
+    if(client->n_link_samples == 0) {
+        client->link_cost_ms = sample_ms;
+    }
+    else {
+        client->link_cost_ms = (uint32_t) ((int64_t) client->link_cost_ms + ((int64_t) sample_ms - (int64_t) client->link_cost_ms) / HPB_CLIENT_LINK_COST_WEIGHT);
+    }
+    client->n_link_samples++;
+}
+
 void hpb_client_destroy(HpbClient **client)
 {
     if((*client) == NULL) {
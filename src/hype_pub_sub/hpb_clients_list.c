@@ -6,6 +6,7 @@
 //
 
 static bool linked_list_callback_is_client_instance(void *client, void *id);
+static bool linked_list_callback_is_client_key(void *client, void *key);
 static void linked_list_callback_free_client(void **client);
 
 //
@@ -56,6 +57,17 @@ HpbClient *hpb_list_clients_find(HpbClientsList *list_cl, HypeInstance * instanc
     return (HpbClient*) node->element;
 }
 
+HpbClient *hpb_list_clients_find_by_key(HpbClientsList *list_cl, HLByte key[])
+{
+    HpbClientsListNode *node = linked_list_find(list_cl, key, linked_list_callback_is_client_key);
+
+    if(node == NULL) {
+        return NULL;
+    }
+
+    return (HpbClient*) node->element;
+}
+
 //
 // Static functions implementation
 //
@@ -69,6 +81,15 @@ static bool linked_list_callback_is_client_instance(void *client, void *id)
     return hpb_client_is_instance_equal((((HpbClient *) client)), (HypeInstance *) id);
 }
 
+static bool linked_list_callback_is_client_key(void *client, void *key)
+{
+    if(client == NULL || key == NULL) {
+        return false;
+    }
+
+    return memcmp(((HpbClient *) client)->key, key, SHA1_BLOCK_SIZE) == 0;
+}
+
 static void linked_list_callback_free_client(void **client)
 {
     hpb_client_destroy((HpbClient **) client);
@@ -0,0 +1,31 @@
+
+#include "hype_pub_sub/hpb_clock.h"
+
+static HpbClockSource hpb_clock_source = NULL;
+
+uint64_t hpb_clock_now_ms()
+{
+    if(hpb_clock_source != NULL) {
+        return hpb_clock_source() / 1000;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000 + ((uint64_t) ts.tv_nsec) / 1000000;
+}
+
+uint64_t hpb_clock_now_us()
+{
+    if(hpb_clock_source != NULL) {
+        return hpb_clock_source();
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000000 + ((uint64_t) ts.tv_nsec) / 1000;
+}
+
+void hpb_clock_set_source(HpbClockSource source)
+{
+    hpb_clock_source = source;
+}
@@ -7,24 +7,30 @@ void hpb_cmd_interface_subscribe(HypePubSub *hpb, char* service_name)
     hpb_issue_subscribe_req(service_name);
 }
 
+void hpb_cmd_interface_subscribe_filtered(HypePubSub *hpb, char* service_name, char *filter)
+{
+    string_utils_to_lower_case(service_name);
+    hpb_issue_filtered_subscribe_req(service_name, filter);
+}
+
 void hpb_cmd_interface_unsubscribe(HypePubSub *hpb, char* service_name)
 {
     string_utils_to_lower_case(service_name);
     hpb_issue_unsubscribe_req(service_name);
 }
 
-void hpb_cmd_interface_publish(HypePubSub *hpb, char* service_name)
+void hpb_cmd_interface_publish(HypePubSub *hpb, char* service_name, char *msg)
 {
     string_utils_to_lower_case(service_name);
-    printf("Insert message to be published on the service '%s': ", service_name);
-    size_t msg_size = 1000;
-    char msg[msg_size];
-    fgets(msg, msg_size, stdin);
-    msg[strcspn(msg, "\n")] = '\0'; // Remove \n read by fgets()
-
     hpb_issue_publish_req(service_name, msg, strlen(msg));
 }
 
+void hpb_cmd_interface_publish_retained(HypePubSub *hpb, char* service_name, char *msg)
+{
+    string_utils_to_lower_case(service_name);
+    hpb_issue_retained_publish_req(service_name, msg, strlen(msg));
+}
+
 void hpb_cmd_interface_print_own_id(HypePubSub *hpb)
 {
     printf("\n");
@@ -42,6 +48,25 @@ void hpb_cmd_interface_print_hype_devices(HypePubSub *hpb)
         return;
     }
     hpb_cmd_interface_print_client_list(hpb->network->network_clients);
+
+    size_t n_loads = hpb->network->network_clients->size + 1;
+    HpbNetworkLoad *loads = (HpbNetworkLoad *) calloc(n_loads, sizeof(HpbNetworkLoad));
+    double skew = hpb_network_get_load_skew(hpb->network, loads, n_loads);
+    printf("Placement: %s, load skew: %.2f\n", (hpb->network->placement == HPB_PLACEMENT_VNODES) ?
+           HPB_CMD_INTERFACE_PLACEMENT_VNODES : HPB_CMD_INTERFACE_PLACEMENT_XOR, skew);
+    for(size_t i = 0; i < n_loads && loads[i].client != NULL; i++)
+    {
+        printf("%s %zu: capacity %u, %.1f%% of the services", (i == 0) ? "Own device" : "Device", i, loads[i].client->capacity,
+               100.0 * loads[i].n_keys / HPB_NETWORK_LOAD_SAMPLES);
+        if(i > 0) {
+            printf(", link cost %u ms (%u samples)", loads[i].client->link_cost_ms, loads[i].client->n_link_samples);
+        }
+        printf("\n");
+    }
+    free(loads);
+    printf("Membership events: %llu, rebalances: %llu, flapping devices held back: %llu\n",
+           (unsigned long long) hpb->membership->n_events, (unsigned long long) hpb->membership->n_applies,
+           (unsigned long long) hpb->membership->n_held);
 }
 
 void hpb_cmd_interface_print_managed_services(HypePubSub *hpb)
@@ -67,14 +92,42 @@ void hpb_cmd_interface_print_managed_services(HypePubSub *hpb)
 
         printf("Managed Service %i Key: ", srvc_n);
         binary_utils_print_hex_array(srvc->service_key, SHA1_BLOCK_SIZE);
+        if(srvc->pattern != NULL) {
+            printf("Managed Service %i Pattern: %s\n", srvc_n, srvc->pattern);
+        }
+        for(LinkedListNode *node = srvc->filters->head; node != NULL; node = node->next)
+        {
+            HpbFilter *filter = (HpbFilter *) node->element;
+            printf("Managed Service %i Filter: %s (%zu subscribers)\n", srvc_n, filter->expression, filter->n_subscribers);
+        }
         printf("Managed Service %i Subscribers: ", srvc_n);
         hpb_cmd_interface_print_client_list(srvc->subscribers);
+        printf("Managed Service %i Publish rate: %u msg/s\n", srvc_n, srvc->publish_rate);
+        if(srvc->n_shards > 0)
+        {
+            printf("Managed Service %i Shards: %u, owners: ", srvc_n, srvc->n_shards);
+            hpb_cmd_interface_print_client_list(srvc->shard_owners);
+        }
+        if(srvc->direct_publishers->size > 0)
+        {
+            printf("Managed Service %i Direct publishers (subscribers version %u): ", srvc_n, srvc->subscribers_version);
+            hpb_cmd_interface_print_client_list(srvc->direct_publishers);
+        }
         printf("\n");
 
         srvc_n++;
     } while(linked_list_iterator_advance(it) != -1);
 
     linked_list_iterator_destroy(&it);
+
+    printf("Subscribers removed on lease expiration: %llu\n", (unsigned long long) hpb->n_lease_expirations);
+    printf("Messages filtered out: %llu (%llu filter evaluations)\n", (unsigned long long) hpb->n_filtered,
+           (unsigned long long) hpb->n_filter_evaluations);
+    printf("Messages forwarded to shard owners: %llu, sent to the subscribers of %zu owned shards: %llu\n",
+           (unsigned long long) hpb->n_shard_forwards, hpb->shards->size, (unsigned long long) hpb->n_shard_deliveries);
+    printf("Messages sent through relay trees: %llu, relayed for other devices: %llu\n",
+           (unsigned long long) hpb->n_relay_trees, (unsigned long long) hpb->n_relay_forwards);
+    printf("Messages not sent back to their publisher: %llu\n", (unsigned long long) hpb->n_echoes_suppressed);
 }
 
 void hpb_cmd_interface_print_subscriptions(HypePubSub *hpb)
@@ -101,14 +154,150 @@ void hpb_cmd_interface_print_subscriptions(HypePubSub *hpb)
         printf("Subscription %i service name: %s\n", sbscrptn_n, sbscrptn->service_name);
         printf("Subscription %i service key: ", sbscrptn_n);
         binary_utils_print_hex_array(sbscrptn->service_key, SHA1_BLOCK_SIZE);
+        if(sbscrptn->filter != NULL) {
+            printf("Subscription %i filter: %s\n", sbscrptn_n, sbscrptn->filter);
+        }
         printf("Subscription %i manager ID: ", sbscrptn_n);
         binary_utils_print_hex_array(sbscrptn->manager_instance->identifier->data, sbscrptn->manager_instance->identifier->size);
+        printf("Subscription %i duplicates suppressed: %llu\n", sbscrptn_n, (unsigned long long) sbscrptn->dedup_cache.n_suppressed);
         printf("\n");
 
         sbscrptn_n++;
     } while(linked_list_iterator_advance(it) != -1);
 
     linked_list_iterator_destroy(&it);
+
+    printf("Duplicates suppressed: %llu\n", (unsigned long long) hpb->n_duplicates_suppressed);
+    printf("Own messages delivered when published: %llu\n", (unsigned long long) hpb->n_local_deliveries);
+    printf("Failovers: %llu (avg %llu ms, max %llu ms)\n", (unsigned long long) hpb->n_failovers,
+           (unsigned long long) ((hpb->n_failovers > 0) ? hpb->failover_total_ms / hpb->n_failovers : 0),
+           (unsigned long long) hpb->failover_max_ms);
+}
+
+void hpb_cmd_interface_print_fanout_stats(HypePubSub *hpb)
+{
+    hpb_fanout_print_stats(hpb->fanout);
+}
+
+void hpb_cmd_interface_print_resolution_stats(HypePubSub *hpb)
+{
+    hpb_resolver_print_stats(hpb->resolver);
+}
+
+void hpb_cmd_interface_print_stats(HypePubSub *hpb)
+{
+    hpb_metrics_print(stdout, hpb_collect_metrics());
+}
+
+void hpb_cmd_interface_set_replicas(HypePubSub *hpb, char *n_replicas)
+{
+    char *end;
+    long replication_factor = strtol(n_replicas, &end, 10);
+
+    if(end == n_replicas || *end != '\0' || replication_factor < 0 || hpb_set_replication_factor((size_t) replication_factor) != 0) {
+        printf("The number of replicas must be between 0 and %i\n", HPB_REPLICATION_MAX_FACTOR);
+        return;
+    }
+
+    printf("Managed services are replicated to %li clients (%llu replicas held, %llu promoted)\n", replication_factor,
+           (unsigned long long) hpb->replicas->size, (unsigned long long) hpb->n_promotions);
+}
+
+void hpb_cmd_interface_set_membership_window(HypePubSub *hpb, char *window_ms)
+{
+    char *end;
+    long window = strtol(window_ms, &end, 10);
+
+    if(end == window_ms || *end != '\0' || window < 0) {
+        printf("The membership window must be a number of milliseconds\n");
+        return;
+    }
+
+    hpb_set_membership_window((uint64_t) window);
+    printf("Membership changes are applied after %li ms without events\n", window);
+}
+
+void hpb_cmd_interface_set_placement(HypePubSub *hpb, char *placement)
+{
+    string_utils_to_lower_case(placement);
+
+    if(strcmp(placement, HPB_CMD_INTERFACE_PLACEMENT_XOR) == 0) {
+        hpb_set_placement(HPB_PLACEMENT_XOR);
+    }
+    else if(strcmp(placement, HPB_CMD_INTERFACE_PLACEMENT_VNODES) == 0) {
+        hpb_set_placement(HPB_PLACEMENT_VNODES);
+    }
+    else
+    {
+        printf("The placement must be '%s' or '%s'\n", HPB_CMD_INTERFACE_PLACEMENT_XOR, HPB_CMD_INTERFACE_PLACEMENT_VNODES);
+        return;
+    }
+
+    printf("Services are placed with '%s', load skew: %.2f\n", placement, hpb_network_get_load_skew(hpb->network, NULL, 0));
+}
+
+void hpb_cmd_interface_set_shards(HypePubSub *hpb, char *n_shards)
+{
+    char *end;
+    long shards = strtol(n_shards, &end, 10);
+
+    if(end == n_shards || *end != '\0' || shards < 0 || hpb_set_shards((size_t) shards) != 0) {
+        printf("The number of shards must be between 0 and %i\n", HPB_SHARDING_MAX_SHARDS);
+        return;
+    }
+
+    printf("Hot managed services are split in %zu shards\n", hpb->n_shards);
+}
+
+void hpb_cmd_interface_set_relay_tree(HypePubSub *hpb, char *branching)
+{
+    char *end;
+    long relay_branching = strtol(branching, &end, 10);
+
+    if(end == branching || *end != '\0' || relay_branching < 0 || hpb_set_relay_branching((size_t) relay_branching) != 0) {
+        printf("The branching factor must be between 0 and %i\n", HPB_RELAY_TREE_MAX_BRANCHING);
+        return;
+    }
+
+    if(hpb->relay_branching == 0) {
+        printf("Messages are sent to every subscriber\n");
+        return;
+    }
+
+    printf("Messages are sent to %zu relays, which forward them to their subtrees\n", hpb->relay_branching);
+}
+
+void hpb_cmd_interface_set_direct(HypePubSub *hpb, char *service_name, bool is_direct)
+{
+    string_utils_to_lower_case(service_name);
+
+    if(hpb_set_direct_publish(service_name, is_direct) != 0)
+    {
+        if(is_direct) {
+            printf("The messages of a topic pattern cannot be sent directly\n");
+        }
+        else {
+            printf("The messages of the service '%s' are not sent directly\n", service_name);
+        }
+        return;
+    }
+
+    printf("Messages published in the service '%s' are sent %s (%llu messages sent directly so far)\n", service_name,
+           is_direct ? "directly to its subscribers" : "through its manager", (unsigned long long) hpb->n_direct_publishes);
+}
+
+void hpb_cmd_interface_set_resolutions(HypePubSub *hpb, char *max_resolutions)
+{
+    char *end;
+    long resolutions = strtol(max_resolutions, &end, 10);
+
+    if(end == max_resolutions || *end != '\0' || resolutions < 1 || hpb_set_max_resolutions((size_t) resolutions) != 0) {
+        printf("The number of handshakes must be between 1 and %i\n", HPB_RESOLVER_MAX_IN_FLIGHT);
+        return;
+    }
+
+    printf("At most %zu handshakes run at the same time (%zu instances waiting)\n", hpb->resolver->max_in_flight,
+           hpb->resolver->pending->size);
 }
 
 void hpb_cmd_interface_print_helper()
@@ -116,12 +305,28 @@ void hpb_cmd_interface_print_helper()
     printf("\n");
     printf("The followings options are available:\n");
     printf(" --%-25s : Allows to subscribe a service.\n" ,HPB_CMD_INTERFACE_SUBSCRIBE);
+    printf(" --%-25s : Allows to subscribe a service, receiving only the messages which pass a filter.\n" ,HPB_CMD_INTERFACE_SUBSCRIBE_FILTERED);
     printf(" --%-25s : Allows to unsubscribe a service.\n" ,HPB_CMD_INTERFACE_UNSUBSCRIBE);
     printf(" --%-25s : Allows to publish a message in a service.\n" ,HPB_CMD_INTERFACE_PUBLISH);
+    printf(" --%-25s : Allows to publish a message which is also sent to the future subscribers.\n" ,HPB_CMD_INTERFACE_PUBLISH_RETAINED);
     printf(" --%-25s : Prints the Hype identifier and the key of this device.\n" ,HPB_CMD_INTERFACE_PRINT_OWN_ID);
     printf(" --%-25s : Prints the Hype identifier and the key of the devices found in the network.\n" ,HPB_CMD_INTERFACE_PRINT_HYPE_DEVICES);
     printf(" --%-25s : Prints the services which are managed by this device.\n" ,HPB_CMD_INTERFACE_PRINT_MANAGED_SERVICES);
     printf(" --%-25s : Prints the services subscribed by this device.\n" ,HPB_CMD_INTERFACE_PRINT_SUBSCRIPTIONS);
+    printf(" --%-25s : Prints the time to last subscriber of the fan-outs, by fan-out size.\n" ,HPB_CMD_INTERFACE_PRINT_FANOUT_STATS);
+    printf(" --%-25s : Prints the devices waiting to be resolved and the latency of the handshakes.\n" ,HPB_CMD_INTERFACE_PRINT_RESOLUTION_STATS);
+    printf(" --%-25s : Prints the messages and bytes sent and received by type, the send failures and the list sizes.\n" ,HPB_CMD_INTERFACE_PRINT_STATS);
+    printf(" --%-25s : Sets the number of devices to which the managed services are replicated.\n" ,HPB_CMD_INTERFACE_SET_REPLICAS);
+    printf(" --%-25s : Sets the time without devices found or lost after which the services are rebalanced.\n" ,HPB_CMD_INTERFACE_SET_MEMBERSHIP_WINDOW);
+    printf(" --%-25s : Places the services on the device with the closest key (xor) or on weighted virtual keys (vnodes).\n" ,HPB_CMD_INTERFACE_SET_PLACEMENT);
+    printf(" --%-25s : Sets the number of shards among which the subscribers of the hot managed services are split.\n" ,HPB_CMD_INTERFACE_SET_SHARDS);
+    printf(" --%-25s : Sets the number of subscribers which relay each message to the others (0 sends to every subscriber).\n" ,HPB_CMD_INTERFACE_SET_RELAY_TREE);
+    printf(" --%-25s : Sends the messages published in a service directly to its subscribers instead of through the manager.\n" ,HPB_CMD_INTERFACE_SET_DIRECT);
+    printf(" --%-25s : Sends the messages published in a service through its manager again.\n" ,HPB_CMD_INTERFACE_UNSET_DIRECT);
+    printf(" --%-25s : Sets the maximum number of handshakes with the devices found which run at the same time.\n" ,HPB_CMD_INTERFACE_SET_RESOLUTIONS);
+    printf(" --%-25s : Publishes at a constant rate in the topics load-0, load-1, ... given rate,topics,seconds[,size].\n" ,HPB_CMD_INTERFACE_LOAD_GENERATE);
+    printf(" --%-25s : Subscribes the given number of load topics and measures the messages received.\n" ,HPB_CMD_INTERFACE_LOAD_SINK);
+    printf(" --%-25s : Prints the throughput, loss and end to end latency of the load.\n" ,HPB_CMD_INTERFACE_PRINT_LOAD_STATS);
     printf(" --%-25s : Prints the helper menu of this application.\n" ,HPB_CMD_INTERFACE_HELP);
     printf(" --%-25s : Terminates the application.\n" ,HPB_CMD_INTERFACE_QUIT);
     printf("\n");
@@ -0,0 +1,46 @@
+
+#include "hype_pub_sub/hpb_dedup.h"
+
+void hpb_dedup_cache_reset(HpbDedupCache *cache)
+{
+    cache->n_publishers = 0;
+    cache->use_counter = 0;
+}
+
+bool hpb_dedup_cache_is_duplicate(HpbDedupCache *cache, HpbPublishOrigin origin)
+{
+    HpbDedupPublisher *publisher = NULL;
+    HpbDedupPublisher *least_recent = NULL;
+
+    for(size_t i = 0; i < cache->n_publishers; i++)
+    {
+        if(cache->publishers[i].publisher_tag == origin.publisher_tag)
+        {
+            publisher = &(cache->publishers[i]);
+            break;
+        }
+
+        if(least_recent == NULL || cache->publishers[i].last_use < least_recent->last_use) {
+            least_recent = &(cache->publishers[i]);
+        }
+    }
+
+    if(publisher == NULL)
+    {
+        publisher = (cache->n_publishers < HPB_DEDUP_MAX_PUBLISHERS) ? &(cache->publishers[cache->n_publishers++]) : least_recent;
+        publisher->publisher_tag = origin.publisher_tag;
+        hpb_seq_window_reset(&(publisher->window));
+    }
+
+    publisher->last_use = ++(cache->use_counter);
+
+    // Messages older than the window cannot be told apart from duplicates, so they are suppressed as well
+    HpbSeqResult result = hpb_seq_window_receive(&(publisher->window), origin.publisher_seq);
+    if(result == HPB_SEQ_DUPLICATE || result == HPB_SEQ_TOO_OLD)
+    {
+        cache->n_suppressed++;
+        return true;
+    }
+
+    return false;
+}
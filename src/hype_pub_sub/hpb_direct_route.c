@@ -0,0 +1,96 @@
+#include "hype_pub_sub/hpb_direct_route.h"
+
+//
+// Header functions implementation
+//
+
+HpbDirectRoute *hpb_direct_route_create(char *service_name)
+{
+    HpbDirectRoute *route = (HpbDirectRoute *) malloc(sizeof(HpbDirectRoute));
+
+    if(route == NULL) {
+        return NULL;
+    }
+
+    size_t service_name_length = strlen(service_name);
+    route->service_name = (char *) malloc((service_name_length + 1) * sizeof(char));
+    if(route->service_name == NULL)
+    {
+        free(route);
+        return NULL;
+    }
+    memcpy(route->service_name, service_name, service_name_length + 1);
+    sha1_digest((const BYTE *) service_name, service_name_length, route->service_key);
+
+    route->manager = NULL;
+    route->subscribers = hpb_list_clients_create();
+    route->version = 0;
+    route->has_version = false;
+    route->is_valid = false;
+    route->received_ms = 0;
+    route->requested_ms = 0;
+    return route;
+}
+
+bool hpb_direct_route_set_manager(HpbDirectRoute *route, HypeInstance *manager)
+{
+    if(route->manager != NULL && hpb_client_is_instance_equal(route->manager, manager)) {
+        return false;
+    }
+
+    hpb_client_destroy(&(route->manager));
+    route->manager = hpb_client_create(manager);
+
+    hpb_list_clients_destroy(&(route->subscribers));
+    route->subscribers = hpb_list_clients_create();
+    route->has_version = false;
+    route->is_valid = false;
+    return true;
+}
+
+bool hpb_direct_route_update(HpbDirectRoute *route, HypeInstance *manager, uint32_t version, bool is_refused,
+                             HypeInstance *subscribers[], size_t n_subscribers, uint64_t now_ms)
+{
+    if(route->manager == NULL || !hpb_client_is_instance_equal(route->manager, manager)) {
+        return false;
+    }
+
+    // The versions wrap around, so they are compared by their distance
+    if(route->has_version && (int32_t) (version - route->version) < 0) {
+        return false;
+    }
+
+    hpb_list_clients_destroy(&(route->subscribers));
+    route->subscribers = hpb_list_clients_create();
+    for(size_t i = 0; i < n_subscribers && !is_refused; i++) {
+        hpb_list_clients_add(route->subscribers, subscribers[i]);
+    }
+
+    route->version = version;
+    route->has_version = true;
+    route->is_valid = !is_refused;
+    route->received_ms = now_ms;
+    return true;
+}
+
+bool hpb_direct_route_is_usable(HpbDirectRoute *route, HypeInstance *manager, uint64_t now_ms)
+{
+    if(!route->is_valid || route->manager == NULL || !hpb_client_is_instance_equal(route->manager, manager)) {
+        return false;
+    }
+
+    return now_ms < route->received_ms + HPB_DIRECT_ROUTE_EXPIRATION_MS;
+}
+
+void hpb_direct_route_destroy(HpbDirectRoute **route)
+{
+    if((*route) == NULL) {
+        return;
+    }
+
+    hpb_client_destroy(&((*route)->manager));
+    hpb_list_clients_destroy(&((*route)->subscribers));
+    free((*route)->service_name);
+    free(*route);
+    (*route) = NULL;
+}
@@ -0,0 +1,405 @@
+
+#include "hype_pub_sub/hpb_event_loop.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+//
+// Static functions declaration
+//
+
+static int hpb_event_loop_watch_fd(HpbEventLoop *loop, int fd);
+static void hpb_event_loop_arm_timer_fd(HpbEventLoop *loop);
+static void hpb_event_loop_run_tasks(HpbEventLoop *loop);
+static void hpb_event_loop_run_timers(HpbEventLoop *loop);
+static HpbEventLoopWatch *hpb_event_loop_find_watch(HpbEventLoop *loop, int fd);
+static bool linked_list_callback_is_watch_fd(void *watch, void *fd);
+static bool linked_list_callback_is_timer_id(void *timer, void *id);
+static bool linked_list_callback_is_same_element(void *element1, void *element2);
+static void linked_list_callback_free_element(void **element);
+
+//
+// Header functions implementation
+//
+
+HpbEventLoop *hpb_event_loop_create()
+{
+    HpbEventLoop *loop = (HpbEventLoop *) malloc(sizeof(HpbEventLoop));
+
+    if(loop == NULL) {
+        return NULL;
+    }
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    loop->watches = linked_list_create();
+    loop->timers = linked_list_create();
+    loop->next_timer_id = 1;
+    loop->tasks_head = NULL;
+    loop->tasks_tail = NULL;
+    loop->is_running = false;
+    pthread_mutex_init(&loop->tasks_mutex, NULL);
+
+    if(loop->epoll_fd < 0 || loop->event_fd < 0 || loop->timer_fd < 0
+       || hpb_event_loop_watch_fd(loop, loop->event_fd) != 0
+       || hpb_event_loop_watch_fd(loop, loop->timer_fd) != 0)
+    {
+        hpb_event_loop_destroy(&loop);
+        return NULL;
+    }
+
+    return loop;
+}
+
+int hpb_event_loop_add_fd(HpbEventLoop *loop, int fd, HpbEventLoopFdCallback callback, void *arg)
+{
+    if(loop == NULL || callback == NULL || hpb_event_loop_find_watch(loop, fd) != NULL) {
+        return -1;
+    }
+
+    if(hpb_event_loop_watch_fd(loop, fd) != 0) {
+        return -1;
+    }
+
+    HpbEventLoopWatch *watch = (HpbEventLoopWatch *) malloc(sizeof(HpbEventLoopWatch));
+    watch->fd = fd;
+    watch->callback = callback;
+    watch->arg = arg;
+    linked_list_add(loop->watches, watch);
+    return 0;
+}
+
+int hpb_event_loop_remove_fd(HpbEventLoop *loop, int fd)
+{
+    if(loop == NULL) {
+        return -1;
+    }
+
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+
+    if(linked_list_remove(loop->watches, &fd, linked_list_callback_is_watch_fd, linked_list_callback_free_element) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int hpb_event_loop_add_timer(HpbEventLoop *loop, uint64_t delay_ms, uint64_t period_ms, HpbEventLoopTaskCallback callback, void *arg)
+{
+    if(loop == NULL || callback == NULL) {
+        return -1;
+    }
+
+    HpbEventLoopTimer *timer = (HpbEventLoopTimer *) malloc(sizeof(HpbEventLoopTimer));
+    timer->id = loop->next_timer_id++;
+    timer->deadline_ms = hpb_clock_now_ms() + delay_ms;
+    timer->period_ms = period_ms;
+    timer->callback = callback;
+    timer->arg = arg;
+    linked_list_add(loop->timers, timer);
+
+    hpb_event_loop_arm_timer_fd(loop);
+    return timer->id;
+}
+
+int hpb_event_loop_cancel_timer(HpbEventLoop *loop, int timer_id)
+{
+    if(loop == NULL) {
+        return -1;
+    }
+
+    if(linked_list_remove(loop->timers, &timer_id, linked_list_callback_is_timer_id, linked_list_callback_free_element) < 0) {
+        return -1;
+    }
+
+    hpb_event_loop_arm_timer_fd(loop);
+    return 0;
+}
+
+int hpb_event_loop_post(HpbEventLoop *loop, HpbEventLoopTaskCallback callback, void *arg, HpbEventLoopTaskCallback free_arg)
+{
+    if(loop == NULL || callback == NULL) {
+        return -1;
+    }
+
+    HpbEventLoopTask *task = (HpbEventLoopTask *) malloc(sizeof(HpbEventLoopTask));
+
+    if(task == NULL) {
+        return -1;
+    }
+
+    task->callback = callback;
+    task->arg = arg;
+    task->free_arg = free_arg;
+    task->next = NULL;
+
+    pthread_mutex_lock(&loop->tasks_mutex);
+    if(loop->tasks_tail == NULL) {
+        loop->tasks_head = task;
+    }
+    else {
+        loop->tasks_tail->next = task;
+    }
+    loop->tasks_tail = task;
+    pthread_mutex_unlock(&loop->tasks_mutex);
+
+    // Wake the loop. Tasks posted before the loop runs stay queued, so no event is ever lost.
+    uint64_t one = 1;
+    if(write(loop->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int hpb_event_loop_run(HpbEventLoop *loop)
+{
+    if(loop == NULL) {
+        return -1;
+    }
+
+    struct epoll_event events[HPB_EVENT_LOOP_MAX_EVENTS];
+    loop->is_running = true;
+
+    // Tasks posted before the loop started are executed right away
+    hpb_event_loop_run_tasks(loop);
+
+    while(loop->is_running)
+    {
+        int n_events = epoll_wait(loop->epoll_fd, events, HPB_EVENT_LOOP_MAX_EVENTS, -1);
+
+        if(n_events < 0)
+        {
+            if(errno == EINTR) {
+                continue;
+            }
+            loop->is_running = false;
+            return -1;
+        }
+
+        for(int i = 0; i < n_events && loop->is_running; i++)
+        {
+            int fd = events[i].data.fd;
+
+            if(fd == loop->event_fd) {
+                hpb_event_loop_run_tasks(loop);
+            }
+            else if(fd == loop->timer_fd) {
+                hpb_event_loop_run_timers(loop);
+            }
+            else
+            {
+                HpbEventLoopWatch *watch = hpb_event_loop_find_watch(loop, fd);
+                if(watch != NULL) {
+                    watch->callback(fd, watch->arg);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+void hpb_event_loop_stop(HpbEventLoop *loop)
+{
+    if(loop == NULL) {
+        return;
+    }
+
+    loop->is_running = false;
+
+    uint64_t one = 1;
+    if(write(loop->event_fd, &one, sizeof(one)) < 0) {
+        return;
+    }
+}
+
+void hpb_event_loop_destroy(HpbEventLoop **loop)
+{
+    if((*loop) == NULL) {
+        return;
+    }
+
+    HpbEventLoopTask *task = (*loop)->tasks_head;
+    while(task != NULL)
+    {
+        HpbEventLoopTask *next_task = task->next;
+        if(task->free_arg != NULL) {
+            task->free_arg(task->arg);
+        }
+        free(task);
+        task = next_task;
+    }
+
+    linked_list_destroy(&((*loop)->watches), linked_list_callback_free_element);
+    linked_list_destroy(&((*loop)->timers), linked_list_callback_free_element);
+
+    if((*loop)->epoll_fd >= 0) {
+        close((*loop)->epoll_fd);
+    }
+    if((*loop)->event_fd >= 0) {
+        close((*loop)->event_fd);
+    }
+    if((*loop)->timer_fd >= 0) {
+        close((*loop)->timer_fd);
+    }
+
+    pthread_mutex_destroy(&((*loop)->tasks_mutex));
+    free(*loop);
+    (*loop) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static int hpb_event_loop_watch_fd(HpbEventLoop *loop, int fd)
+{
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+static void hpb_event_loop_arm_timer_fd(HpbEventLoop *loop)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+
+    uint64_t earliest = UINT64_MAX;
+    LinkedListNode *node = loop->timers->head;
+    while(node != NULL)
+    {
+        HpbEventLoopTimer *timer = (HpbEventLoopTimer *) node->element;
+        if(timer->deadline_ms < earliest) {
+            earliest = timer->deadline_ms;
+        }
+        node = node->next;
+    }
+
+    if(earliest != UINT64_MAX)
+    {
+        uint64_t now = hpb_clock_now_ms();
+        uint64_t delay_ms = (earliest > now) ? (earliest - now) : 0;
+
+        // An all-zero it_value disarms the timer, so due timers are armed with 1ns instead
+        spec.it_value.tv_sec = delay_ms / 1000;
+        spec.it_value.tv_nsec = (delay_ms % 1000) * 1000000;
+        if(delay_ms == 0) {
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+
+    timerfd_settime(loop->timer_fd, 0, &spec, NULL);
+}
+
+static void hpb_event_loop_run_tasks(HpbEventLoop *loop)
+{
+    uint64_t counter;
+    if(read(loop->event_fd, &counter, sizeof(counter)) < 0 && errno != EAGAIN) {
+        return;
+    }
+
+    // Detach the whole queue so that the tasks run without holding the mutex
+    pthread_mutex_lock(&loop->tasks_mutex);
+    HpbEventLoopTask *task = loop->tasks_head;
+    loop->tasks_head = NULL;
+    loop->tasks_tail = NULL;
+    pthread_mutex_unlock(&loop->tasks_mutex);
+
+    while(task != NULL)
+    {
+        HpbEventLoopTask *next_task = task->next;
+        task->callback(task->arg);
+        free(task);
+        task = next_task;
+    }
+}
+
+static void hpb_event_loop_run_timers(HpbEventLoop *loop)
+{
+    uint64_t expirations;
+    if(read(loop->timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        return;
+    }
+
+    // Timers are handled one at a time since a callback may add or cancel other timers
+    while(loop->is_running)
+    {
+        uint64_t now = hpb_clock_now_ms();
+        HpbEventLoopTimer *due_timer = NULL;
+
+        LinkedListNode *node = loop->timers->head;
+        while(node != NULL)
+        {
+            HpbEventLoopTimer *timer = (HpbEventLoopTimer *) node->element;
+            if(timer->deadline_ms <= now && (due_timer == NULL || timer->deadline_ms < due_timer->deadline_ms)) {
+                due_timer = timer;
+            }
+            node = node->next;
+        }
+
+        if(due_timer == NULL) {
+            break;
+        }
+
+        HpbEventLoopTaskCallback callback = due_timer->callback;
+        void *arg = due_timer->arg;
+
+        if(due_timer->period_ms > 0) {
+            due_timer->deadline_ms = now + due_timer->period_ms;
+        }
+        else {
+            linked_list_remove(loop->timers, due_timer, linked_list_callback_is_same_element, linked_list_callback_free_element);
+        }
+
+        callback(arg);
+    }
+
+    hpb_event_loop_arm_timer_fd(loop);
+}
+
+static HpbEventLoopWatch *hpb_event_loop_find_watch(HpbEventLoop *loop, int fd)
+{
+    LinkedListNode *node = linked_list_find(loop->watches, &fd, linked_list_callback_is_watch_fd);
+
+    if(node == NULL) {
+        return NULL;
+    }
+
+    return (HpbEventLoopWatch *) node->element;
+}
+
+static bool linked_list_callback_is_watch_fd(void *watch, void *fd)
+{
+    if(watch == NULL || fd == NULL) {
+        return false;
+    }
+
+    return ((HpbEventLoopWatch *) watch)->fd == *((int *) fd);
+}
+
+static bool linked_list_callback_is_timer_id(void *timer, void *id)
+{
+    if(timer == NULL || id == NULL) {
+        return false;
+    }
+
+    return ((HpbEventLoopTimer *) timer)->id == *((int *) id);
+}
+
+static bool linked_list_callback_is_same_element(void *element1, void *element2)
+{
+    return element1 == element2;
+}
+
+static void linked_list_callback_free_element(void **element)
+{
+    free(*element);
+    (*element) = NULL;
+}
@@ -0,0 +1,273 @@
+
+#include "hype_pub_sub/hpb_fanout.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//
+// Static functions declaration
+//
+
+static void *hpb_fanout_worker(void *arg);
+static void hpb_fanout_start_workers(HpbFanout *fanout);
+static void hpb_fanout_take_chunks(HpbFanout *fanout);
+static void hpb_fanout_send_range(HpbFanout *fanout, HLByte *frame, size_t frame_size, HypeInstance **recipients, size_t n_recipients, void *arg);
+static void hpb_fanout_record_sample(HpbFanout *fanout, size_t n_recipients, uint64_t elapsed_us);
+static int hpb_fanout_get_bucket(size_t n_recipients);
+static int hpb_fanout_compare_samples(const void *sample1, const void *sample2);
+
+static const char *hpb_fanout_bucket_names[HPB_FANOUT_STATS_BUCKETS] = { "1-16", "17-256", "257-4096", ">4096" };
+
+//
+// Header functions implementation
+//
+
+HpbFanout *hpb_fanout_create(size_t n_workers, HpbFanoutSendCallback send_callback)
+{
+    HpbFanout *fanout = (HpbFanout *) calloc(1, sizeof(HpbFanout));
+
+    if(fanout == NULL) {
+        return NULL;
+    }
+
+    fanout->n_workers = (n_workers > HPB_FANOUT_MAX_WORKERS) ? HPB_FANOUT_MAX_WORKERS : n_workers;
+    fanout->send_callback = send_callback;
+    pthread_mutex_init(&fanout->mutex, NULL);
+    pthread_cond_init(&fanout->job_cond, NULL);
+    pthread_cond_init(&fanout->done_cond, NULL);
+    return fanout;
+}
+
+int hpb_fanout_set_workers(HpbFanout *fanout, size_t n_workers)
+{
+    if(fanout == NULL || fanout->are_workers_started) {
+        return -1;
+    }
+
+    fanout->n_workers = (n_workers > HPB_FANOUT_MAX_WORKERS) ? HPB_FANOUT_MAX_WORKERS : n_workers;
+    return 0;
+}
+
+int hpb_fanout_send(HpbFanout *fanout, HLByte *frame, size_t frame_size, HypeInstance **recipients, size_t n_recipients, void *arg)
+{
+    if(fanout == NULL || fanout->send_callback == NULL) {
+        return -1;
+    }
+
+    if(n_recipients == 0) {
+        return 0;
+    }
+
+    uint64_t start_us = hpb_clock_now_us();
+
+    if(n_recipients < HPB_FANOUT_PARALLEL_THRESHOLD || fanout->n_workers == 0)
+    {
+        hpb_fanout_send_range(fanout, frame, frame_size, recipients, n_recipients, arg);
+        hpb_fanout_record_sample(fanout, n_recipients, hpb_clock_now_us() - start_us);
+        return (int) n_recipients;
+    }
+
+    if(!fanout->are_workers_started) {
+        hpb_fanout_start_workers(fanout);
+    }
+
+    pthread_mutex_lock(&fanout->mutex);
+    fanout->frame = frame;
+    fanout->frame_size = frame_size;
+    fanout->arg = arg;
+    fanout->recipients = recipients;
+    fanout->n_recipients = n_recipients;
+    fanout->next_chunk = 0;
+    fanout->n_chunks = (n_recipients + HPB_FANOUT_CHUNK_SIZE - 1) / HPB_FANOUT_CHUNK_SIZE;
+    fanout->n_chunks_done = 0;
+    fanout->job_id++;
+    pthread_cond_broadcast(&fanout->job_cond);
+
+    // The calling thread sends chunks too instead of sitting idle
+    hpb_fanout_take_chunks(fanout);
+
+    while(fanout->n_chunks_done < fanout->n_chunks) {
+        pthread_cond_wait(&fanout->done_cond, &fanout->mutex);
+    }
+
+    fanout->frame = NULL;
+    fanout->arg = NULL;
+    fanout->recipients = NULL;
+    fanout->n_recipients = 0;
+    fanout->n_chunks = 0;
+    fanout->next_chunk = 0;
+    pthread_mutex_unlock(&fanout->mutex);
+
+    hpb_fanout_record_sample(fanout, n_recipients, hpb_clock_now_us() - start_us);
+    return (int) n_recipients;
+}
+
+size_t hpb_fanout_get_percentiles(HpbFanout *fanout, int bucket, uint64_t *p50_us, uint64_t *p99_us)
+{
+    if(fanout == NULL || bucket < 0 || bucket >= HPB_FANOUT_STATS_BUCKETS) {
+        return 0;
+    }
+
+    size_t n_samples = fanout->stats.n_samples[bucket];
+    if(n_samples == 0) {
+        return 0;
+    }
+
+    uint64_t *sorted = (uint64_t *) malloc(n_samples * sizeof(uint64_t));
+    memcpy(sorted, fanout->stats.samples_us[bucket], n_samples * sizeof(uint64_t));
+    qsort(sorted, n_samples, sizeof(uint64_t), hpb_fanout_compare_samples);
+
+    *p50_us = sorted[(n_samples - 1) * 50 / 100];
+    *p99_us = sorted[(n_samples - 1) * 99 / 100];
+
+    free(sorted);
+    return n_samples;
+}
+
+void hpb_fanout_print_stats(HpbFanout *fanout)
+{
+    printf("\n");
+    printf("%-12s %-12s %-18s %-18s\n", "Fan-out", "Fan-outs", "p50 TTLS (us)", "p99 TTLS (us)");
+
+    for(int bucket = 0; bucket < HPB_FANOUT_STATS_BUCKETS; bucket++)
+    {
+        uint64_t p50_us = 0;
+        uint64_t p99_us = 0;
+        hpb_fanout_get_percentiles(fanout, bucket, &p50_us, &p99_us);
+        printf("%-12s %-12llu %-18llu %-18llu\n", hpb_fanout_bucket_names[bucket],
+               (unsigned long long) fanout->stats.n_fanouts[bucket], (unsigned long long) p50_us, (unsigned long long) p99_us);
+    }
+    printf("\n");
+}
+
+void hpb_fanout_destroy(HpbFanout **fanout)
+{
+    if((*fanout) == NULL) {
+        return;
+    }
+
+    if((*fanout)->are_workers_started)
+    {
+        pthread_mutex_lock(&((*fanout)->mutex));
+        (*fanout)->is_stopping = true;
+        pthread_cond_broadcast(&((*fanout)->job_cond));
+        pthread_mutex_unlock(&((*fanout)->mutex));
+
+        for(size_t i = 0; i < (*fanout)->n_workers; i++) {
+            pthread_join((*fanout)->workers[i], NULL);
+        }
+    }
+
+    pthread_mutex_destroy(&((*fanout)->mutex));
+    pthread_cond_destroy(&((*fanout)->job_cond));
+    pthread_cond_destroy(&((*fanout)->done_cond));
+    free(*fanout);
+    (*fanout) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static void *hpb_fanout_worker(void *arg)
+{
+    HpbFanout *fanout = (HpbFanout *) arg;
+
+    pthread_mutex_lock(&fanout->mutex);
+    while(!fanout->is_stopping)
+    {
+        if(fanout->next_chunk < fanout->n_chunks) {
+            hpb_fanout_take_chunks(fanout);
+            continue;
+        }
+
+        pthread_cond_wait(&fanout->job_cond, &fanout->mutex);
+    }
+    pthread_mutex_unlock(&fanout->mutex);
+
+    return NULL;
+}
+
+static void hpb_fanout_start_workers(HpbFanout *fanout)
+{
+    size_t n_started = 0;
+
+    for(size_t i = 0; i < fanout->n_workers; i++)
+    {
+        if(pthread_create(&fanout->workers[n_started], NULL, hpb_fanout_worker, fanout) == 0) {
+            n_started++;
+        }
+    }
+
+    fanout->n_workers = n_started;
+    fanout->are_workers_started = true;
+}
+
+// Must be called with the mutex locked. The mutex is released while each chunk is being sent.
+static void hpb_fanout_take_chunks(HpbFanout *fanout)
+{
+    while(fanout->next_chunk < fanout->n_chunks)
+    {
+        size_t chunk = fanout->next_chunk++;
+        size_t first = chunk * HPB_FANOUT_CHUNK_SIZE;
+        size_t n_chunk_recipients = fanout->n_recipients - first;
+        if(n_chunk_recipients > HPB_FANOUT_CHUNK_SIZE) {
+            n_chunk_recipients = HPB_FANOUT_CHUNK_SIZE;
+        }
+
+        HLByte *frame = fanout->frame;
+        size_t frame_size = fanout->frame_size;
+        void *arg = fanout->arg;
+        HypeInstance **recipients = fanout->recipients + first;
+
+        pthread_mutex_unlock(&fanout->mutex);
+        hpb_fanout_send_range(fanout, frame, frame_size, recipients, n_chunk_recipients, arg);
+        pthread_mutex_lock(&fanout->mutex);
+
+        fanout->n_chunks_done++;
+        if(fanout->n_chunks_done == fanout->n_chunks) {
+            pthread_cond_signal(&fanout->done_cond);
+        }
+    }
+}
+
+static void hpb_fanout_send_range(HpbFanout *fanout, HLByte *frame, size_t frame_size, HypeInstance **recipients, size_t n_recipients, void *arg)
+{
+    for(size_t i = 0; i < n_recipients; i++) {
+        fanout->send_callback(frame, frame_size, recipients[i], arg);
+    }
+}
+
+static void hpb_fanout_record_sample(HpbFanout *fanout, size_t n_recipients, uint64_t elapsed_us)
+{
+    int bucket = hpb_fanout_get_bucket(n_recipients);
+    HpbFanoutStats *stats = &fanout->stats;
+
+    stats->samples_us[bucket][stats->next_sample[bucket]] = elapsed_us;
+    stats->next_sample[bucket] = (stats->next_sample[bucket] + 1) % HPB_FANOUT_STATS_SAMPLES;
+    if(stats->n_samples[bucket] < HPB_FANOUT_STATS_SAMPLES) {
+        stats->n_samples[bucket]++;
+    }
+    stats->n_fanouts[bucket]++;
+}
+
+static int hpb_fanout_get_bucket(size_t n_recipients)
+{
+    if(n_recipients <= 16) {
+        return 0;
+    }
+    if(n_recipients <= 256) {
+        return 1;
+    }
+    if(n_recipients <= 4096) {
+        return 2;
+    }
+    return 3;
+}
+
+static int hpb_fanout_compare_samples(const void *sample1, const void *sample2)
+{
+    uint64_t s1 = *((const uint64_t *) sample1);
+    uint64_t s2 = *((const uint64_t *) sample2);
+    return (s1 > s2) - (s1 < s2);
+}
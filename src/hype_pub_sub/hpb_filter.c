@@ -0,0 +1,588 @@
+#include "hype_pub_sub/hpb_filter.h"
+
+#include <stdio.h>
+#include <math.h>
+
+#define HPB_FILTER_NUMBER_MAX_LENGTH 32
+
+/**
+ * @brief This struct keeps the state of the compilation of an expression.
+ */
+typedef struct HpbFilterParser_
+{
+    char *cursor; /**< Next character to be parsed. */
+    HpbFilter *filter; /**< Filter being compiled. */
+    size_t stack_depth; /**< Depth of the evaluation stack after the instructions emitted so far. */
+} HpbFilterParser;
+
+/**
+ * @brief This struct represents the message over which a filter is evaluated.
+ */
+typedef struct HpbFilterMessage_
+{
+    char *msg; /**< Message. */
+    size_t msg_length; /**< Length of the message. */
+    uint32_t publisher_tag; /**< Publisher tag of the message. */
+    char *topic; /**< Topic of the message, or NULL. */
+    size_t topic_length; /**< Length of the topic. */
+} HpbFilterMessage;
+
+//
+// Static functions declaration
+//
+
+static int hpb_filter_parse_or(HpbFilterParser *parser);
+static int hpb_filter_parse_and(HpbFilterParser *parser);
+static int hpb_filter_parse_not(HpbFilterParser *parser);
+static int hpb_filter_parse_test(HpbFilterParser *parser);
+static int hpb_filter_parse_word(HpbFilterParser *parser, char **word, bool *is_quoted);
+static bool hpb_filter_parse_comparison(HpbFilterParser *parser, uint8_t *comparison);
+static bool hpb_filter_parse_token(HpbFilterParser *parser, const char *token);
+static void hpb_filter_skip_spaces(HpbFilterParser *parser);
+static int hpb_filter_emit(HpbFilterParser *parser, HpbFilterInstruction *instruction);
+static char *hpb_filter_get_canonical_expression(char *expression);
+static bool hpb_filter_test(HpbFilterInstruction *instruction, HpbFilterMessage *message);
+static bool hpb_filter_get_field(HpbFilterInstruction *instruction, HpbFilterMessage *message, char buffer[], char **value, size_t *value_length);
+static bool hpb_filter_find_payload_field(char *msg, size_t msg_length, char *name, char **value, size_t *value_length);
+static bool hpb_filter_parse_number(char *value, size_t value_length, double *number);
+static int hpb_filter_compare_strings(char *value1, size_t length1, char *value2, size_t length2);
+static bool hpb_filter_contains(char *value, size_t value_length, char *part, size_t part_length);
+static void hpb_filter_strip_quotes(char **value, size_t *value_length);
+static bool hpb_filter_is_word_char(char c);
+static bool hpb_filter_is_payload_separator(char c);
+
+//
+// Header functions implementation
+//
+
+HpbFilter *hpb_filter_compile(char *expression)
+{
+    if(expression == NULL || strlen(expression) == 0 || strlen(expression) > HPB_FILTER_MAX_LENGTH) {
+        return NULL;
+    }
+
+    HpbFilter *filter = (HpbFilter *) calloc(1, sizeof(HpbFilter));
+    if(filter == NULL) {
+        return NULL;
+    }
+
+    HpbFilterParser parser;
+    parser.cursor = expression;
+    parser.filter = filter;
+    parser.stack_depth = 0;
+
+    int result = hpb_filter_parse_or(&parser);
+    hpb_filter_skip_spaces(&parser);
+
+    // The whole expression must be consumed by a single boolean
+    if(result != 0 || (*parser.cursor) != '\0' || parser.stack_depth != 1)
+    {
+        hpb_filter_destroy(&filter);
+        return NULL;
+    }
+
+    filter->expression = hpb_filter_get_canonical_expression(expression);
+    if(filter->expression == NULL)
+    {
+        hpb_filter_destroy(&filter);
+        return NULL;
+    }
+
+    return filter;
+}
+
+bool hpb_filter_evaluate(HpbFilter *filter, char *msg, size_t msg_length, uint32_t publisher_tag, char *topic, size_t topic_length)
+{
+    if(filter == NULL) {
+        return true;
+    }
+
+    HpbFilterMessage message;
+    message.msg = msg;
+    message.msg_length = msg_length;
+    message.publisher_tag = publisher_tag;
+    message.topic = topic;
+    message.topic_length = topic_length;
+
+    bool stack[HPB_FILTER_MAX_DEPTH];
+    size_t top = 0;
+
+    for(size_t i = 0; i < filter->n_instructions; i++)
+    {
+        HpbFilterInstruction *instruction = &(filter->code[i]);
+        switch(instruction->opcode)
+        {
+            case HPB_FILTER_OP_TEST:
+                stack[top++] = hpb_filter_test(instruction, &message);
+                break;
+            case HPB_FILTER_OP_NOT:
+                stack[top - 1] = !stack[top - 1];
+                break;
+            case HPB_FILTER_OP_AND:
+                top--;
+                stack[top - 1] = stack[top - 1] && stack[top];
+                break;
+            case HPB_FILTER_OP_OR:
+                top--;
+                stack[top - 1] = stack[top - 1] || stack[top];
+                break;
+        }
+    }
+
+    filter->last_result = stack[0];
+    return filter->last_result;
+}
+
+void hpb_filter_destroy(HpbFilter **filter)
+{
+    if((*filter) == NULL) {
+        return;
+    }
+
+    for(size_t i = 0; i < (*filter)->n_instructions; i++)
+    {
+        free((*filter)->code[i].name);
+        free((*filter)->code[i].value);
+    }
+
+    free((*filter)->expression);
+    free(*filter);
+    (*filter) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static int hpb_filter_parse_or(HpbFilterParser *parser)
+{
+    if(hpb_filter_parse_and(parser) != 0) {
+        return -1;
+    }
+
+    while(hpb_filter_parse_token(parser, "||"))
+    {
+        if(hpb_filter_parse_and(parser) != 0) {
+            return -1;
+        }
+
+        HpbFilterInstruction instruction = { .opcode = HPB_FILTER_OP_OR };
+        if(hpb_filter_emit(parser, &instruction) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int hpb_filter_parse_and(HpbFilterParser *parser)
+{
+    if(hpb_filter_parse_not(parser) != 0) {
+        return -1;
+    }
+
+    while(hpb_filter_parse_token(parser, "&&"))
+    {
+        if(hpb_filter_parse_not(parser) != 0) {
+            return -1;
+        }
+
+        HpbFilterInstruction instruction = { .opcode = HPB_FILTER_OP_AND };
+        if(hpb_filter_emit(parser, &instruction) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int hpb_filter_parse_not(HpbFilterParser *parser)
+{
+    hpb_filter_skip_spaces(parser);
+
+    if(parser->cursor[0] == '!' && parser->cursor[1] != '=')
+    {
+        parser->cursor++;
+        if(hpb_filter_parse_not(parser) != 0) {
+            return -1;
+        }
+
+        HpbFilterInstruction instruction = { .opcode = HPB_FILTER_OP_NOT };
+        return hpb_filter_emit(parser, &instruction);
+    }
+
+    if(parser->cursor[0] == '(')
+    {
+        parser->cursor++;
+        if(hpb_filter_parse_or(parser) != 0 || !hpb_filter_parse_token(parser, ")")) {
+            return -1;
+        }
+        return 0;
+    }
+
+    return hpb_filter_parse_test(parser);
+}
+
+static int hpb_filter_parse_test(HpbFilterParser *parser)
+{
+    HpbFilterInstruction instruction = { .opcode = HPB_FILTER_OP_TEST, .comparison = HPB_FILTER_CMP_EXISTS, .field = HPB_FILTER_FIELD_PAYLOAD };
+    bool is_quoted;
+
+    if(hpb_filter_parse_word(parser, &(instruction.name), &is_quoted) != 0) {
+        return -1;
+    }
+
+    if(!is_quoted && instruction.name[0] == '$')
+    {
+        if(strcmp(instruction.name, HPB_FILTER_ATTRIBUTE_LENGTH) == 0) {
+            instruction.field = HPB_FILTER_FIELD_LENGTH;
+        }
+        else if(strcmp(instruction.name, HPB_FILTER_ATTRIBUTE_PUBLISHER) == 0) {
+            instruction.field = HPB_FILTER_FIELD_PUBLISHER;
+        }
+        else if(strcmp(instruction.name, HPB_FILTER_ATTRIBUTE_TOPIC) == 0) {
+            instruction.field = HPB_FILTER_FIELD_TOPIC;
+        }
+        else
+        {
+            free(instruction.name);
+            return -1;
+        }
+    }
+
+    if(hpb_filter_parse_comparison(parser, &(instruction.comparison)))
+    {
+        if(hpb_filter_parse_word(parser, &(instruction.value), &is_quoted) != 0)
+        {
+            free(instruction.name);
+            return -1;
+        }
+
+        // Quoted values are always compared as strings
+        instruction.is_number = !is_quoted && hpb_filter_parse_number(instruction.value, strlen(instruction.value), &(instruction.number));
+    }
+
+    if(hpb_filter_emit(parser, &instruction) != 0)
+    {
+        free(instruction.name);
+        free(instruction.value);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int hpb_filter_parse_word(HpbFilterParser *parser, char **word, bool *is_quoted)
+{
+    hpb_filter_skip_spaces(parser);
+
+    char *start = parser->cursor;
+    size_t length = 0;
+    (*is_quoted) = (start[0] == '"' || start[0] == '\'');
+
+    if(*is_quoted)
+    {
+        char *end = strchr(start + 1, start[0]);
+        if(end == NULL) {
+            return -1;
+        }
+        start++;
+        length = (size_t) (end - start);
+        parser->cursor = end + 1;
+    }
+    else
+    {
+        while(hpb_filter_is_word_char(start[length])) {
+            length++;
+        }
+        if(length == 0) {
+            return -1;
+        }
+        parser->cursor = start + length;
+    }
+
+    (*word) = (char *) malloc((length + 1) * sizeof(char));
+    if((*word) == NULL) {
+        return -1;
+    }
+
+    memcpy(*word, start, length);
+    (*word)[length] = '\0';
+    return 0;
+}
+
+static bool hpb_filter_parse_comparison(HpbFilterParser *parser, uint8_t *comparison)
+{
+    // Two character operators are checked first, so that "<=" is not taken as "<"
+    if(hpb_filter_parse_token(parser, "==")) {
+        (*comparison) = HPB_FILTER_CMP_EQ;
+    }
+    else if(hpb_filter_parse_token(parser, "!=")) {
+        (*comparison) = HPB_FILTER_CMP_NE;
+    }
+    else if(hpb_filter_parse_token(parser, "<=")) {
+        (*comparison) = HPB_FILTER_CMP_LE;
+    }
+    else if(hpb_filter_parse_token(parser, ">=")) {
+        (*comparison) = HPB_FILTER_CMP_GE;
+    }
+    else if(hpb_filter_parse_token(parser, "<")) {
+        (*comparison) = HPB_FILTER_CMP_LT;
+    }
+    else if(hpb_filter_parse_token(parser, ">")) {
+        (*comparison) = HPB_FILTER_CMP_GT;
+    }
+    else if(hpb_filter_parse_token(parser, "~")) {
+        (*comparison) = HPB_FILTER_CMP_CONTAINS;
+    }
+    else {
+        return false;
+    }
+
+    return true;
+}
+
+static bool hpb_filter_parse_token(HpbFilterParser *parser, const char *token)
+{
+    hpb_filter_skip_spaces(parser);
+
+    size_t length = strlen(token);
+    if(strncmp(parser->cursor, token, length) != 0) {
+        return false;
+    }
+
+    parser->cursor += length;
+    return true;
+}
+
+static void hpb_filter_skip_spaces(HpbFilterParser *parser)
+{
+    while((*parser->cursor) == ' ' || (*parser->cursor) == '\t') {
+        parser->cursor++;
+    }
+}
+
+static int hpb_filter_emit(HpbFilterParser *parser, HpbFilterInstruction *instruction)
+{
+    HpbFilter *filter = parser->filter;
+
+    if(filter->n_instructions >= HPB_FILTER_MAX_INSTRUCTIONS) {
+        return -1;
+    }
+
+    if(instruction->opcode == HPB_FILTER_OP_TEST)
+    {
+        if(parser->stack_depth >= HPB_FILTER_MAX_DEPTH) {
+            return -1;
+        }
+        parser->stack_depth++;
+    }
+    else if(instruction->opcode == HPB_FILTER_OP_AND || instruction->opcode == HPB_FILTER_OP_OR) {
+        parser->stack_depth--;
+    }
+
+    filter->code[filter->n_instructions++] = (*instruction);
+    return 0;
+}
+
+static char *hpb_filter_get_canonical_expression(char *expression)
+{
+    char *canonical = (char *) malloc((strlen(expression) + 1) * sizeof(char));
+    if(canonical == NULL) {
+        return NULL;
+    }
+
+    size_t length = 0;
+    char quote = '\0';
+    for(char *c = expression; (*c) != '\0'; c++)
+    {
+        if(quote == '\0' && ((*c) == ' ' || (*c) == '\t')) {
+            continue;
+        }
+
+        if(quote == '\0' && ((*c) == '"' || (*c) == '\'')) {
+            quote = (*c);
+        }
+        else if((*c) == quote) {
+            quote = '\0';
+        }
+        canonical[length++] = (*c);
+    }
+
+    canonical[length] = '\0';
+    return canonical;
+}
+
+static bool hpb_filter_test(HpbFilterInstruction *instruction, HpbFilterMessage *message)
+{
+    char buffer[HPB_FILTER_NUMBER_MAX_LENGTH];
+    char *value;
+    size_t value_length;
+
+    // A missing field fails every test
+    if(!hpb_filter_get_field(instruction, message, buffer, &value, &value_length)) {
+        return false;
+    }
+
+    if(instruction->comparison == HPB_FILTER_CMP_EXISTS) {
+        return true;
+    }
+
+    size_t length = strlen(instruction->value);
+    if(instruction->comparison == HPB_FILTER_CMP_CONTAINS) {
+        return length == 0 || hpb_filter_contains(value, value_length, instruction->value, length);
+    }
+
+    int order;
+    double number;
+    if(instruction->is_number && hpb_filter_parse_number(value, value_length, &number)) {
+        order = (number > instruction->number) - (number < instruction->number);
+    }
+    else {
+        order = hpb_filter_compare_strings(value, value_length, instruction->value, length);
+    }
+
+    switch(instruction->comparison)
+    {
+        case HPB_FILTER_CMP_EQ:
+            return order == 0;
+        case HPB_FILTER_CMP_NE:
+            return order != 0;
+        case HPB_FILTER_CMP_LT:
+            return order < 0;
+        case HPB_FILTER_CMP_LE:
+            return order <= 0;
+        case HPB_FILTER_CMP_GT:
+            return order > 0;
+        case HPB_FILTER_CMP_GE:
+            return order >= 0;
+        default:
+            return false;
+    }
+}
+
+static bool hpb_filter_get_field(HpbFilterInstruction *instruction, HpbFilterMessage *message, char buffer[], char **value, size_t *value_length)
+{
+    switch(instruction->field)
+    {
+        case HPB_FILTER_FIELD_LENGTH:
+            (*value_length) = (size_t) snprintf(buffer, HPB_FILTER_NUMBER_MAX_LENGTH, "%zu", message->msg_length);
+            (*value) = buffer;
+            return true;
+        case HPB_FILTER_FIELD_PUBLISHER:
+            (*value_length) = (size_t) snprintf(buffer, HPB_FILTER_NUMBER_MAX_LENGTH, "%u", message->publisher_tag);
+            (*value) = buffer;
+            return true;
+        case HPB_FILTER_FIELD_TOPIC:
+            (*value) = message->topic;
+            (*value_length) = message->topic_length;
+            return message->topic != NULL;
+        default:
+            return hpb_filter_find_payload_field(message->msg, message->msg_length, instruction->name, value, value_length);
+    }
+}
+
+static bool hpb_filter_find_payload_field(char *msg, size_t msg_length, char *name, char **value, size_t *value_length)
+{
+    size_t name_length = strlen(name);
+    size_t i = 0;
+
+    while(i < msg_length)
+    {
+        if(hpb_filter_is_payload_separator(msg[i]))
+        {
+            i++;
+            continue;
+        }
+
+        char *field_name = msg + i;
+        size_t field_name_length = 0;
+        while(i < msg_length && !hpb_filter_is_payload_separator(msg[i]) && msg[i] != '=' && msg[i] != ':')
+        {
+            i++;
+            field_name_length++;
+        }
+
+        if(i >= msg_length || (msg[i] != '=' && msg[i] != ':')) { // A word without value
+            continue;
+        }
+        i++;
+
+        // The value may be separated by spaces, as in "name": value
+        while(i < msg_length && (msg[i] == ' ' || msg[i] == '\t')) {
+            i++;
+        }
+
+        char *field_value = msg + i;
+        while(i < msg_length && !hpb_filter_is_payload_separator(msg[i])) {
+            i++;
+        }
+
+        hpb_filter_strip_quotes(&field_name, &field_name_length);
+        if(field_name_length == name_length && memcmp(field_name, name, name_length) == 0)
+        {
+            (*value) = field_value;
+            (*value_length) = (size_t) (msg + i - field_value);
+            hpb_filter_strip_quotes(value, value_length);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool hpb_filter_parse_number(char *value, size_t value_length, double *number)
+{
+    if(value_length == 0 || value_length >= HPB_FILTER_NUMBER_MAX_LENGTH) {
+        return false;
+    }
+
+    char buffer[HPB_FILTER_NUMBER_MAX_LENGTH];
+    memcpy(buffer, value, value_length);
+    buffer[value_length] = '\0';
+
+    char *end;
+    (*number) = strtod(buffer, &end);
+    return end == buffer + value_length && isfinite(*number);
+}
+
+static int hpb_filter_compare_strings(char *value1, size_t length1, char *value2, size_t length2)
+{
+    int result = memcmp(value1, value2, (length1 < length2) ? length1 : length2);
+    if(result != 0) {
+        return result;
+    }
+
+    return (length1 > length2) - (length1 < length2);
+}
+
+static bool hpb_filter_contains(char *value, size_t value_length, char *part, size_t part_length)
+{
+    for(size_t i = 0; i + part_length <= value_length; i++)
+    {
+        if(memcmp(value + i, part, part_length) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void hpb_filter_strip_quotes(char **value, size_t *value_length)
+{
+    if((*value_length) >= 2 && ((*value)[0] == '"' || (*value)[0] == '\'') && (*value)[(*value_length) - 1] == (*value)[0])
+    {
+        (*value)++;
+        (*value_length) -= 2;
+    }
+}
+
+static bool hpb_filter_is_word_char(char c)
+{
+    return c != '\0' && strchr(" \t()!=<>~&|\"'", c) == NULL;
+}
+
+static bool hpb_filter_is_payload_separator(char c)
+{
+    return c == '\0' || strchr(" \t\r\n,;&{}", c) != NULL;
+}
@@ -0,0 +1,231 @@
+
+#include "hype_pub_sub/hpb_handover.h"
+
+//
+// Static functions declaration
+//
+
+static HpbHandoverForward *hpb_handover_get_forward(HpbHandover *handover, HLByte service_key[]);
+static void hpb_handover_remove_publish(HpbHandover *handover, HpbHandoverPublish *publish);
+static bool linked_list_callback_is_same_element(void *element1, void *element2);
+static void linked_list_callback_free_forward(void **element);
+static void linked_list_callback_free_publish(void **element);
+static void linked_list_callback_free_nothing(void **element);
+
+//
+// Header functions implementation
+//
+
+HpbHandover *hpb_handover_create(size_t max_bytes)
+{
+    HpbHandover *handover = (HpbHandover *) calloc(1, sizeof(HpbHandover));
+
+    if(handover == NULL) {
+        return NULL;
+    }
+
+    handover->forwards = linked_list_create();
+    handover->publishes = linked_list_create();
+    handover->max_bytes = max_bytes;
+    return handover;
+}
+
+int hpb_handover_add_forward(HpbHandover *handover, HLByte service_key[], HypeInstance *new_manager, uint64_t now_ms)
+{
+    if(handover == NULL || new_manager == NULL) {
+        return -1;
+    }
+
+    HpbHandoverForward *forward = hpb_handover_get_forward(handover, service_key);
+    if(forward != NULL) {
+        linked_list_remove(handover->forwards, forward, linked_list_callback_is_same_element, linked_list_callback_free_forward);
+    }
+
+    forward = (HpbHandoverForward *) malloc(sizeof(HpbHandoverForward));
+    memcpy(forward->service_key, service_key, SHA1_BLOCK_SIZE);
+    forward->new_manager = hype_instance_create(new_manager->identifier, new_manager->announcement, new_manager->is_resolved);
+    forward->expiration_ms = now_ms + HPB_HANDOVER_FORWARD_TTL_MS;
+    linked_list_add(handover->forwards, forward);
+    return 0;
+}
+
+void hpb_handover_remove_forward(HpbHandover *handover, HLByte service_key[])
+{
+    HpbHandoverForward *forward = hpb_handover_get_forward(handover, service_key);
+    if(forward != NULL) {
+        linked_list_remove(handover->forwards, forward, linked_list_callback_is_same_element, linked_list_callback_free_forward);
+    }
+}
+
+HypeInstance *hpb_handover_find_forward(HpbHandover *handover, HLByte service_key[], uint64_t now_ms)
+{
+    HpbHandoverForward *forward = hpb_handover_get_forward(handover, service_key);
+
+    if(forward == NULL || forward->expiration_ms <= now_ms) {
+        return NULL;
+    }
+
+    handover->n_forwarded++;
+    return forward->new_manager;
+}
+
+int hpb_handover_buffer_publish(HpbHandover *handover, HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, uint64_t now_ms)
+{
+    if(handover == NULL || msg_length > handover->max_bytes)
+    {
+        if(handover != NULL) {
+            handover->n_dropped++;
+        }
+        return -1;
+    }
+
+    // Drop the oldest publishes until the new one fits
+    while(handover->n_bytes + msg_length > handover->max_bytes)
+    {
+        hpb_handover_remove_publish(handover, (HpbHandoverPublish *) handover->publishes->head->element);
+        handover->n_dropped++;
+    }
+
+    HpbHandoverPublish *publish = (HpbHandoverPublish *) malloc(sizeof(HpbHandoverPublish));
+    memcpy(publish->service_key, service_key, SHA1_BLOCK_SIZE);
+    publish->origin = origin;
+    publish->msg = (char *) malloc(msg_length * sizeof(char));
+    memcpy(publish->msg, msg, msg_length);
+    publish->msg_length = msg_length;
+    publish->expiration_ms = now_ms + HPB_HANDOVER_BUFFER_TTL_MS;
+    linked_list_add(handover->publishes, publish);
+    handover->n_bytes += msg_length;
+    return 0;
+}
+
+int hpb_handover_flush(HpbHandover *handover, HLByte service_key[], HpbHandoverFlushCallback callback, void *arg)
+{
+    if(handover == NULL) {
+        return 0;
+    }
+
+    // The publishes are unlinked before calling the callback, so that it can safely buffer new publishes
+    LinkedList *flushed = linked_list_create();
+    LinkedListNode *node = handover->publishes->head;
+    while(node != NULL)
+    {
+        HpbHandoverPublish *publish = (HpbHandoverPublish *) node->element;
+        node = node->next;
+
+        if(memcmp(publish->service_key, service_key, SHA1_BLOCK_SIZE) != 0) {
+            continue;
+        }
+
+        linked_list_remove(handover->publishes, publish, linked_list_callback_is_same_element, linked_list_callback_free_nothing);
+        handover->n_bytes -= publish->msg_length;
+        linked_list_add(flushed, publish);
+    }
+
+    int n_flushed = (int) flushed->size;
+    for(node = flushed->head; node != NULL; node = node->next)
+    {
+        HpbHandoverPublish *publish = (HpbHandoverPublish *) node->element;
+        callback(publish->service_key, publish->origin, publish->msg, publish->msg_length, arg);
+    }
+
+    handover->n_flushed += flushed->size;
+    linked_list_destroy(&flushed, linked_list_callback_free_publish);
+    return n_flushed;
+}
+
+void hpb_handover_expire(HpbHandover *handover, uint64_t now_ms)
+{
+    if(handover == NULL) {
+        return;
+    }
+
+    LinkedListNode *node = handover->forwards->head;
+    while(node != NULL)
+    {
+        HpbHandoverForward *forward = (HpbHandoverForward *) node->element;
+        node = node->next;
+
+        if(forward->expiration_ms <= now_ms) {
+            linked_list_remove(handover->forwards, forward, linked_list_callback_is_same_element, linked_list_callback_free_forward);
+        }
+    }
+
+    // Publishes are kept in arrival order, so the expired ones are at the head
+    while(handover->publishes->head != NULL)
+    {
+        HpbHandoverPublish *publish = (HpbHandoverPublish *) handover->publishes->head->element;
+        if(publish->expiration_ms > now_ms) {
+            break;
+        }
+
+        hpb_handover_remove_publish(handover, publish);
+        handover->n_dropped++;
+    }
+}
+
+void hpb_handover_destroy(HpbHandover **handover)
+{
+    if((*handover) == NULL) {
+        return;
+    }
+
+    linked_list_destroy(&((*handover)->forwards), linked_list_callback_free_forward);
+    linked_list_destroy(&((*handover)->publishes), linked_list_callback_free_publish);
+    free(*handover);
+    (*handover) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static HpbHandoverForward *hpb_handover_get_forward(HpbHandover *handover, HLByte service_key[])
+{
+    if(handover == NULL) {
+        return NULL;
+    }
+
+    LinkedListNode *node = handover->forwards->head;
+    while(node != NULL)
+    {
+        HpbHandoverForward *forward = (HpbHandoverForward *) node->element;
+        if(memcmp(forward->service_key, service_key, SHA1_BLOCK_SIZE) == 0) {
+            return forward;
+        }
+        node = node->next;
+    }
+
+    return NULL;
+}
+
+static void hpb_handover_remove_publish(HpbHandover *handover, HpbHandoverPublish *publish)
+{
+    handover->n_bytes -= publish->msg_length;
+    linked_list_remove(handover->publishes, publish, linked_list_callback_is_same_element, linked_list_callback_free_publish);
+}
+
+static bool linked_list_callback_is_same_element(void *element1, void *element2)
+{
+    return element1 == element2;
+}
+
+static void linked_list_callback_free_forward(void **element)
+{
+    HpbHandoverForward *forward = (HpbHandoverForward *) (*element);
+    hype_instance_release(forward->new_manager);
+    free(forward);
+    (*element) = NULL;
+}
+
+static void linked_list_callback_free_publish(void **element)
+{
+    HpbHandoverPublish *publish = (HpbHandoverPublish *) (*element);
+    free(publish->msg);
+    free(publish);
+    (*element) = NULL;
+}
+
+static void linked_list_callback_free_nothing(void **element)
+{
+    // The element is still referenced elsewhere
+}
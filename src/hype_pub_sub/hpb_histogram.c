@@ -0,0 +1,205 @@
+
+#include "hype_pub_sub/hpb_histogram.h"
+
+//
+// Static functions declaration
+//
+
+static size_t hpb_histogram_get_counts_index(HpbHistogram *histogram, uint64_t value);
+static uint64_t hpb_histogram_get_value_from_index(HpbHistogram *histogram, size_t index);
+static uint64_t hpb_histogram_get_highest_equivalent_value(HpbHistogram *histogram, uint64_t value);
+static int hpb_histogram_get_bucket_index(HpbHistogram *histogram, uint64_t value);
+
+//
+// Header functions implementation
+//
+
+HpbHistogram *hpb_histogram_create(uint64_t highest_value, int significant_figures)
+{
+    if(highest_value < 2 || significant_figures < HPB_HISTOGRAM_MIN_SIGNIFICANT_FIGURES || significant_figures > HPB_HISTOGRAM_MAX_SIGNIFICANT_FIGURES) {
+        return NULL;
+    }
+
+    HpbHistogram *histogram = (HpbHistogram *) calloc(1, sizeof(HpbHistogram));
+    if(histogram == NULL) {
+        return NULL;
+    }
+
+    // The sub-buckets must tell apart two values which differ in the last significant figure
+    uint64_t largest_single_unit_resolution = 2;
+    for(int i = 0; i < significant_figures; i++) {
+        largest_single_unit_resolution *= 10;
+    }
+
+    int sub_bucket_count_magnitude = 0;
+    while((1ULL << sub_bucket_count_magnitude) < largest_single_unit_resolution) {
+        sub_bucket_count_magnitude++;
+    }
+
+    histogram->highest_value = highest_value;
+    histogram->significant_figures = significant_figures;
+    histogram->sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+    histogram->sub_bucket_count = 1ULL << sub_bucket_count_magnitude;
+    histogram->sub_bucket_half_count = histogram->sub_bucket_count / 2;
+    histogram->sub_bucket_mask = histogram->sub_bucket_count - 1;
+
+    // Each bucket doubles the range covered by the previous ones
+    uint64_t smallest_untrackable_value = histogram->sub_bucket_count;
+    histogram->bucket_count = 1;
+    while(smallest_untrackable_value <= highest_value)
+    {
+        histogram->bucket_count++;
+        if(smallest_untrackable_value > UINT64_MAX / 2) {
+            break;
+        }
+        smallest_untrackable_value <<= 1;
+    }
+
+    histogram->counts_length = (size_t) (histogram->bucket_count + 1) * histogram->sub_bucket_half_count;
+    histogram->counts = (uint64_t *) calloc(histogram->counts_length, sizeof(uint64_t));
+    if(histogram->counts == NULL)
+    {
+        free(histogram);
+        return NULL;
+    }
+
+    histogram->min = UINT64_MAX;
+    return histogram;
+}
+
+int hpb_histogram_record(HpbHistogram *histogram, uint64_t value)
+{
+    histogram->total_count++;
+    histogram->sum += (double) value;
+    histogram->min = (value < histogram->min) ? value : histogram->min;
+    histogram->max = (value > histogram->max) ? value : histogram->max;
+
+    if(value > histogram->highest_value)
+    {
+        histogram->n_clamped++;
+        histogram->counts[hpb_histogram_get_counts_index(histogram, histogram->highest_value)]++;
+        return -1;
+    }
+
+    histogram->counts[hpb_histogram_get_counts_index(histogram, value)]++;
+    return 0;
+}
+
+int hpb_histogram_add(HpbHistogram *histogram, HpbHistogram *other)
+{
+    if(histogram->highest_value != other->highest_value || histogram->significant_figures != other->significant_figures) {
+        return -1;
+    }
+
+    for(size_t i = 0; i < histogram->counts_length; i++) {
+        histogram->counts[i] += other->counts[i];
+    }
+
+    histogram->total_count += other->total_count;
+    histogram->n_clamped += other->n_clamped;
+    histogram->sum += other->sum;
+    histogram->min = (other->min < histogram->min) ? other->min : histogram->min;
+    histogram->max = (other->max > histogram->max) ? other->max : histogram->max;
+    return 0;
+}
+
+uint64_t hpb_histogram_get_value_at_percentile(HpbHistogram *histogram, double percentile)
+{
+    if(histogram->total_count == 0) {
+        return 0;
+    }
+
+    if(percentile >= 100.0) {
+        return histogram->max;
+    }
+
+    percentile = (percentile < 0.0) ? 0.0 : percentile;
+    uint64_t count_at_percentile = (uint64_t) (percentile / 100.0 * (double) histogram->total_count + 0.5);
+    count_at_percentile = (count_at_percentile < 1) ? 1 : count_at_percentile;
+
+    uint64_t total = 0;
+    for(size_t i = 0; i < histogram->counts_length; i++)
+    {
+        total += histogram->counts[i];
+        if(total >= count_at_percentile)
+        {
+            uint64_t value = hpb_histogram_get_highest_equivalent_value(histogram, hpb_histogram_get_value_from_index(histogram, i));
+            return (value < histogram->max) ? value : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+double hpb_histogram_get_mean(HpbHistogram *histogram)
+{
+    if(histogram->total_count == 0) {
+        return 0.0;
+    }
+
+    return histogram->sum / (double) histogram->total_count;
+}
+
+void hpb_histogram_reset(HpbHistogram *histogram)
+{
+    memset(histogram->counts, 0, histogram->counts_length * sizeof(uint64_t));
+    histogram->total_count = 0;
+    histogram->n_clamped = 0;
+    histogram->min = UINT64_MAX;
+    histogram->max = 0;
+    histogram->sum = 0.0;
+}
+
+void hpb_histogram_destroy(HpbHistogram **histogram)
+{
+    if((*histogram) == NULL) {
+        return;
+    }
+
+    free((*histogram)->counts);
+    free(*histogram);
+    (*histogram) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static int hpb_histogram_get_bucket_index(HpbHistogram *histogram, uint64_t value)
+{
+    // Position of the highest bit of the value, counting the values of the first bucket as a whole
+    int pow2_ceiling = 64 - __builtin_clzll(value | histogram->sub_bucket_mask);
+    return pow2_ceiling - (histogram->sub_bucket_half_count_magnitude + 1);
+}
+
+static size_t hpb_histogram_get_counts_index(HpbHistogram *histogram, uint64_t value)
+{
+    int bucket_index = hpb_histogram_get_bucket_index(histogram, value);
+    uint64_t sub_bucket_index = value >> bucket_index;
+
+    // The lower half of the sub-buckets of every bucket but the first overlaps the previous bucket, so it is not stored
+    return (((size_t) bucket_index + 1) << histogram->sub_bucket_half_count_magnitude) + (sub_bucket_index - histogram->sub_bucket_half_count);
+}
+
+static uint64_t hpb_histogram_get_value_from_index(HpbHistogram *histogram, size_t index)
+{
+    int bucket_index = (int) (index >> histogram->sub_bucket_half_count_magnitude) - 1;
+    uint64_t sub_bucket_index = (index & (histogram->sub_bucket_half_count - 1)) + histogram->sub_bucket_half_count;
+
+    if(bucket_index < 0)
+    {
+        sub_bucket_index -= histogram->sub_bucket_half_count;
+        bucket_index = 0;
+    }
+
+    return sub_bucket_index << bucket_index;
+}
+
+static uint64_t hpb_histogram_get_highest_equivalent_value(HpbHistogram *histogram, uint64_t value)
+{
+    int bucket_index = hpb_histogram_get_bucket_index(histogram, value);
+    uint64_t sub_bucket_index = value >> bucket_index;
+    uint64_t lowest_equivalent_value = sub_bucket_index << bucket_index;
+
+    return lowest_equivalent_value + (1ULL << bucket_index) - 1;
+}
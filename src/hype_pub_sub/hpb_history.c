@@ -0,0 +1,101 @@
+
+#include "hype_pub_sub/hpb_history.h"
+
+//
+// Static functions declaration
+//
+
+static void hpb_history_remove_oldest(HpbHistory *history);
+
+//
+// Header functions implementation
+//
+
+HpbHistory *hpb_history_create(size_t max_bytes)
+{
+    HpbHistory *history = (HpbHistory *) calloc(1, sizeof(HpbHistory));
+
+    if(history == NULL) {
+        return NULL;
+    }
+
+    history->max_bytes = max_bytes;
+    return history;
+}
+
+int hpb_history_add(HpbHistory *history, uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    if(history == NULL || msg_length > history->max_bytes) {
+        return -1;
+    }
+
+    while(history->size == HPB_HISTORY_MAX_ENTRIES || history->n_bytes + msg_length > history->max_bytes) {
+        hpb_history_remove_oldest(history);
+    }
+
+    HpbHistoryEntry *entry = &(history->entries[(history->first + history->size) % HPB_HISTORY_MAX_ENTRIES]);
+    entry->seq = seq;
+    entry->origin = origin;
+    entry->msg = (char *) malloc(msg_length * sizeof(char));
+    memcpy(entry->msg, msg, msg_length);
+    entry->msg_length = msg_length;
+    history->size++;
+    history->n_bytes += msg_length;
+    return 0;
+}
+
+HpbHistoryEntry *hpb_history_find(HpbHistory *history, uint32_t seq)
+{
+    if(history == NULL || history->size == 0) {
+        return NULL;
+    }
+
+    // Sequence numbers are usually consecutive, so the entry is found by its distance to the oldest one
+    uint32_t offset = seq - history->entries[history->first].seq;
+    if(offset < history->size)
+    {
+        HpbHistoryEntry *entry = &(history->entries[(history->first + offset) % HPB_HISTORY_MAX_ENTRIES]);
+        if(entry->seq == seq) {
+            return entry;
+        }
+    }
+
+    // Messages too large for the history leave holes in the sequence
+    for(size_t i = 0; i < history->size; i++)
+    {
+        HpbHistoryEntry *entry = &(history->entries[(history->first + i) % HPB_HISTORY_MAX_ENTRIES]);
+        if(entry->seq == seq) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+void hpb_history_destroy(HpbHistory **history)
+{
+    if((*history) == NULL) {
+        return;
+    }
+
+    while((*history)->size > 0) {
+        hpb_history_remove_oldest(*history);
+    }
+
+    free(*history);
+    (*history) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static void hpb_history_remove_oldest(HpbHistory *history)
+{
+    HpbHistoryEntry *entry = &(history->entries[history->first]);
+    history->n_bytes -= entry->msg_length;
+    free(entry->msg);
+    entry->msg = NULL;
+    history->first = (history->first + 1) % HPB_HISTORY_MAX_ENTRIES;
+    history->size--;
+}
@@ -12,8 +12,24 @@
 #include <hype_pub_sub/hpb_hype_interface.h>
 #include <hype_pub_sub/hpb_constants.h>
 #include <hype_pub_sub/hpb_clients_list.h>
-#include <hype_pub_sub/hype_pub_sub.h>
 #include <stdio.h>
+#include <pthread.h>
+
+/**
+ * @brief This struct carries a Hype SDK callback from the SDK thread to the event loop thread.
+ *        The instance and the message data are copies owned by the event.
+ */
+typedef struct HpbHypeEvent_
+{
+    HypeInstance *instance; /**< Copy of the instance given by the SDK, or NULL. */
+    HLByte *data; /**< Copy of the received message data, or NULL. */
+    size_t data_size; /**< Size of the received message data. */
+    uint64_t message_id; /**< Identifier of the message info given by the SDK, for send notifications. */
+} HpbHypeEvent;
+
+static HpbTransport *hpb_hype_transport = NULL;
+static uint8_t hpb_hype_capacity = HPB_CLIENT_DEFAULT_CAPACITY;
+static pthread_mutex_t hpb_hype_send_mutex = PTHREAD_MUTEX_INITIALIZER; // The SDK is not known to be thread safe, and the fan-out workers send concurrently
 
 //
 // Static functions declaration
@@ -34,12 +50,70 @@ static void hpb_hype_on_message_send_failed(HypeMessageInfo * message_info, Hype
 static void hpb_hype_on_message_sent(HypeMessageInfo * message_info,HypeInstance * instance, float progress, bool done);
 static void hpb_hype_on_message_delivered(HypeMessageInfo * message_info, HypeInstance * instance, float progress, bool done);
 
+static int hpb_hype_transport_start(HpbTransport *transport);
+static void hpb_hype_transport_stop(HpbTransport *transport);
+static HypeInstance *hpb_hype_transport_get_own_instance(HpbTransport *transport);
+static uint64_t hpb_hype_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination);
+static void hpb_hype_transport_resolve(HpbTransport *transport, HypeInstance *instance);
+static void hpb_hype_transport_destroy(HpbTransport *transport);
+
+static HpbHypeEvent *hpb_hype_event_create(HypeInstance *instance, HLByte *data, size_t data_size);
+static void hpb_hype_event_destroy(HpbHypeEvent **event);
+static void hpb_hype_task_free_event(void *arg);
+static void hpb_hype_task_started(void *arg);
+static void hpb_hype_task_start_failed(void *arg);
+static void hpb_hype_task_instance_found(void *arg);
+static void hpb_hype_task_instance_lost(void *arg);
+static void hpb_hype_task_instance_resolved(void *arg);
+static void hpb_hype_task_instance_failed_resolving(void *arg);
+static void hpb_hype_task_message_received(void *arg);
+static void hpb_hype_task_message_send_failed(void *arg);
+static void hpb_hype_task_message_delivered(void *arg);
+
+static const HpbTransportOps hpb_hype_transport_ops = {
+    "hype",
+    hpb_hype_transport_start,
+    hpb_hype_transport_stop,
+    hpb_hype_transport_get_own_instance,
+    hpb_hype_transport_send,
+    hpb_hype_transport_resolve,
+    hpb_hype_transport_destroy
+};
+
 //
 // Headers functions implementation
 //
 
-void hpb_hype_interface_request_to_start()
+HpbTransport *hpb_hype_interface_create_transport(HpbEventLoop *loop, HpbTransportCallbacks callbacks)
+{
+    // The SDK is a singleton, so there is at most one Hype transport
+    if(hpb_hype_transport != NULL) {
+        return NULL;
+    }
+
+    hpb_hype_transport = hpb_transport_create(&hpb_hype_transport_ops, loop, callbacks, NULL);
+    return hpb_hype_transport;
+}
+
+int hpb_hype_interface_set_capacity(int capacity)
 {
+    if(capacity < 1 || capacity > HPB_CLIENT_MAX_CAPACITY) {
+        return -1;
+    }
+
+    hpb_hype_capacity = (uint8_t) capacity;
+    return 0;
+}
+
+//
+// Static functions implementation
+//
+
+static int hpb_hype_transport_start(HpbTransport *transport)
+{
+    // Every SDK callback is forwarded to the loop of the transport, so that the HypePubSub
+    // state is only ever touched from the loop thread.
+
     // Adding itself as an Hype state observer makes sure that the application gets
     // notifications for lifecycle events being triggered by the Hype framework. These
     // events include starting and stopping, as well as some error handling.
@@ -76,31 +150,61 @@ void hpb_hype_interface_request_to_start()
 
     hype_set_transport_type(HYPE_TRANSPORT_TYPE_WIFI_INFRA);
 
+    // The first byte of the announcement is the capacity of this device
+    HypeBuffer *announcement = hype_buffer_create_from(&hpb_hype_capacity, sizeof(hpb_hype_capacity));
+    hype_set_announcement(announcement);
+    hype_buffer_release(announcement);
+
     // Requesting Hype to start is equivalent to requesting the device to publish
     // itself on the network and start browsing for other devices in proximity. If
     // everything goes well, the onStart(Hype) observer method gets called, indicating
     // that the device is actively participating on the network.
     hype_start();
+    return 0;
 }
 
-void hpb_hype_interface_request_to_stop()
+static void hpb_hype_transport_stop(HpbTransport *transport)
 {
     hype_stop();
 }
 
-//
-// Static functions implementation
-//
+static HypeInstance *hpb_hype_transport_get_own_instance(HpbTransport *transport)
+{
+    HypeInstance *host = hype_get_host_instance();
+    return hype_instance_create(host->identifier, host->announcement, host->is_resolved);
+}
 
-static void hpb_hype_on_start()
+static uint64_t hpb_hype_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination)
 {
-    //Signal the start of hype service
-    if (pthread_cond_signal(&cond) != 0) {
-        perror("pthread_cond_signal() error");
-        exit(4);
+    // Delivery tracking is requested so that the SDK reports the delivery or the failure of the message
+    pthread_mutex_lock(&hpb_hype_send_mutex);
+    HypeMessage *hype_msg = hype_send(data, data_size, destination, true);
+    pthread_mutex_unlock(&hpb_hype_send_mutex);
+    if(hype_msg == NULL) {
+        return 0;
     }
 
-    fflush(stdout);
+    uint64_t message_id = hype_msg->info->identifier;
+    hype_message_release(hype_msg);
+    return message_id;
+}
+
+static void hpb_hype_transport_resolve(HpbTransport *transport, HypeInstance *instance)
+{
+    // In case of success the SDK reports the instance resolved, and otherwise that it failed resolving
+    hype_resolve(instance);
+}
+
+static void hpb_hype_transport_destroy(HpbTransport *transport)
+{
+    hpb_hype_transport = NULL;
+}
+
+static void hpb_hype_on_start()
+{
+    // Signal the start of hype service. The task stays queued in the loop even if the
+    // loop is not waiting yet, so the start notification cannot be lost.
+    hpb_event_loop_post(hpb_hype_transport->loop, hpb_hype_task_started, NULL, NULL);
 }
 
 static void hpb_hype_on_stop(HypeError * err)
@@ -134,7 +238,7 @@ static void hpb_hype_on_start_failed(HypeError * err)
     // adapter being turned off. The error parameter always indicates the
     // cause for the failure, it's never null.
 
-    exit(1);
+    hpb_event_loop_post(hpb_hype_transport->loop, hpb_hype_task_start_failed, NULL, NULL);
 }
 
 static void hpb_hype_on_state_change()
@@ -181,15 +285,12 @@ static const char * hpb_hype_on_request_access_token(uint32_t user_identifier)
 static void hpb_hype_on_instance_found(HypeInstance * instance)
 {
     // Resolving an instance consists of forcing the two devices to perform an handshake,
-    // a necessary step for communicating. In this demo all instances are resolved, but
-    // implementations should first assert whether the found instance is interesting,
-    // whatever that means in the context of the app. Only instances deemed interesting
-    // should be resolved, saving network overhead. In case of success, the SDK calls
-    // the hype_instance_resolved called. In case of failure, the method
-    // hype_on_fail_resolving is called instead.
-    hype_resolve(instance);
-
-    fflush(stdout);
+    // a necessary step for communicating. The instances are not resolved at once: only a
+    // few handshakes run at the same time, so that a dense network does not delay the
+    // traffic, and the instances closest to the services of this device go first. In case
+    // of success, the SDK calls hype_on_instance_resolved. In case of failure, the
+    // method hype_on_fail_resolving is called instead.
+    hpb_event_loop_post(hpb_hype_transport->loop, hpb_hype_task_instance_found, hpb_hype_event_create(instance, NULL, 0), hpb_hype_task_free_event);
 }
 
 static void hpb_hype_on_instance_lost(HypeInstance * instance, HypeError * err)
@@ -199,22 +300,12 @@ static void hpb_hype_on_instance_lost(HypeInstance * instance, HypeError * err)
     // times out or the device goes out of range. Another possibility is the user turning
     // the adapters off, in which case not only are all instances lost but the framework
     // also stops with an error.
-    HypePubSub * hpb_get();
-
-    hpb_list_clients_remove(hpb_get()->network->network_clients, instance);
-    hpb_update_own_subscriptions();
-    hpb_remove_subscriptions_from_lost_instance(instance);
-
-    fflush(stdout);
+    hpb_event_loop_post(hpb_hype_transport->loop, hpb_hype_task_instance_lost, hpb_hype_event_create(instance, NULL, 0), hpb_hype_task_free_event);
 }
 
 static void hpb_hype_on_instance_resolved(HypeInstance * instance)
 {
-    hpb_list_clients_add(hpb_get()->network->network_clients, instance);
-    hpb_update_managed_services();
-    hpb_update_own_subscriptions();
-
-    fflush(stdout);
+    hpb_event_loop_post(hpb_hype_transport->loop, hpb_hype_task_instance_resolved, hpb_hype_event_create(instance, NULL, 0), hpb_hype_task_free_event);
 }
 
 static void hpb_hype_on_instance_failed_resolving(HypeInstance * instance, HypeError * err)
@@ -224,7 +315,7 @@ static void hpb_hype_on_instance_failed_resolving(HypeInstance * instance, HypeE
     // to perform an handshake and Hype is refusing to communicate with it. The error
     // argument indicates a proper cause for the error.
 
-    fflush(stdout);
+    hpb_event_loop_post(hpb_hype_transport->loop, hpb_hype_task_instance_failed_resolving, hpb_hype_event_create(instance, NULL, 0), hpb_hype_task_free_event);
 }
 
 static void hpb_hype_on_message_received(HypeMessage * message, HypeInstance * instance)
@@ -233,9 +324,8 @@ static void hpb_hype_on_message_received(HypeMessage * message, HypeInstance * i
     // to be text encoded in UTF-8 format, the same protocol that was used when sending
     // a message.
 
-    hpb_protocol_receive_msg(instance,message->buffer->data,message->buffer->size);
-
-    fflush(stdout);
+    HpbHypeEvent *event = hpb_hype_event_create(instance, message->buffer->data, message->buffer->size);
+    hpb_event_loop_post(hpb_hype_transport->loop, hpb_hype_task_message_received, event, hpb_hype_task_free_event);
 }
 
 static void hpb_hype_on_message_send_failed(HypeMessageInfo * message_info, HypeInstance * instance, HypeError * err)
@@ -244,8 +334,11 @@ static void hpb_hype_on_message_send_failed(HypeMessageInfo * message_info, Hype
     // Sending messages can fail for a lot of reasons, such as the adapters
     // (Bluetooth) being turned off by the user while the process
     // of sending the data is still ongoing. The error parameter describes
-    // the cause for the failure.
+    // the cause for the failure. The message is handed to the retry queue.
 
+    HpbHypeEvent *event = hpb_hype_event_create(instance, NULL, 0);
+    event->message_id = message_info->identifier;
+    hpb_event_loop_post(hpb_hype_transport->loop, hpb_hype_task_message_send_failed, event, hpb_hype_task_free_event);
 }
 
 static void hpb_hype_on_message_sent(HypeMessageInfo * message_info,HypeInstance * instance, float progress, bool done)
@@ -268,5 +361,146 @@ static void hpb_hype_on_message_delivered(HypeMessageInfo * message_info, HypeIn
     // has been fully delivered and the content is available on the destination
     // device. This method is useful for implementing progress bars.
 
+    if(!done) {
+        return;
+    }
+
+    HpbHypeEvent *event = hpb_hype_event_create(instance, NULL, 0);
+    event->message_id = message_info->identifier;
+    hpb_event_loop_post(hpb_hype_transport->loop, hpb_hype_task_message_delivered, event, hpb_hype_task_free_event);
+}
+
+static HpbHypeEvent *hpb_hype_event_create(HypeInstance *instance, HLByte *data, size_t data_size)
+{
+    HpbHypeEvent *event = (HpbHypeEvent *) malloc(sizeof(HpbHypeEvent));
+    event->instance = hype_instance_create(instance->identifier, instance->announcement, instance->is_resolved);
+    event->data = NULL;
+    event->data_size = data_size;
+    event->message_id = 0;
+
+    if(data_size > 0)
+    {
+        event->data = (HLByte *) malloc(data_size * sizeof(HLByte));
+        memcpy(event->data, data, data_size);
+    }
+
+    return event;
+}
+
+static void hpb_hype_event_destroy(HpbHypeEvent **event)
+{
+    if((*event) == NULL) {
+        return;
+    }
+
+    hype_instance_release((*event)->instance);
+    free((*event)->data);
+    free(*event);
+    (*event) = NULL;
+}
+
+static void hpb_hype_task_free_event(void *arg)
+{
+    HpbHypeEvent *event = (HpbHypeEvent *) arg;
+    hpb_hype_event_destroy(&event);
+}
+
+static void hpb_hype_task_started(void *arg)
+{
+    if(hpb_hype_transport->callbacks.on_start != NULL) {
+        hpb_hype_transport->callbacks.on_start(true);
+    }
+
+    fflush(stdout);
+}
+
+static void hpb_hype_task_start_failed(void *arg)
+{
+    if(hpb_hype_transport->callbacks.on_start != NULL) {
+        hpb_hype_transport->callbacks.on_start(false);
+    }
+
+    fflush(stdout);
+}
+
+static void hpb_hype_task_instance_found(void *arg)
+{
+    HpbHypeEvent *event = (HpbHypeEvent *) arg;
+
+    if(hpb_hype_transport->callbacks.on_instance_found != NULL) {
+        hpb_hype_transport->callbacks.on_instance_found(event->instance);
+    }
+
+    hpb_hype_event_destroy(&event);
+    fflush(stdout);
+}
+
+static void hpb_hype_task_instance_lost(void *arg)
+{
+    HpbHypeEvent *event = (HpbHypeEvent *) arg;
+
+    if(hpb_hype_transport->callbacks.on_instance_lost != NULL) {
+        hpb_hype_transport->callbacks.on_instance_lost(event->instance);
+    }
+
+    hpb_hype_event_destroy(&event);
+    fflush(stdout);
+}
+
+static void hpb_hype_task_instance_resolved(void *arg)
+{
+    HpbHypeEvent *event = (HpbHypeEvent *) arg;
+
+    if(hpb_hype_transport->callbacks.on_instance_resolved != NULL) {
+        hpb_hype_transport->callbacks.on_instance_resolved(event->instance);
+    }
+
+    hpb_hype_event_destroy(&event);
+    fflush(stdout);
+}
+
+static void hpb_hype_task_instance_failed_resolving(void *arg)
+{
+    HpbHypeEvent *event = (HpbHypeEvent *) arg;
+
+    if(hpb_hype_transport->callbacks.on_instance_failed_resolving != NULL) {
+        hpb_hype_transport->callbacks.on_instance_failed_resolving(event->instance);
+    }
+
+    hpb_hype_event_destroy(&event);
     fflush(stdout);
 }
+
+static void hpb_hype_task_message_received(void *arg)
+{
+    HpbHypeEvent *event = (HpbHypeEvent *) arg;
+
+    if(hpb_hype_transport->callbacks.on_message_received != NULL) {
+        hpb_hype_transport->callbacks.on_message_received(event->instance, event->data, event->data_size);
+    }
+
+    hpb_hype_event_destroy(&event);
+    fflush(stdout);
+}
+
+static void hpb_hype_task_message_send_failed(void *arg)
+{
+    HpbHypeEvent *event = (HpbHypeEvent *) arg;
+
+    if(hpb_hype_transport->callbacks.on_message_send_failed != NULL) {
+        hpb_hype_transport->callbacks.on_message_send_failed(event->message_id);
+    }
+
+    hpb_hype_event_destroy(&event);
+}
+
+static void hpb_hype_task_message_delivered(void *arg)
+{
+    HpbHypeEvent *event = (HpbHypeEvent *) arg;
+
+    if(hpb_hype_transport->callbacks.on_message_delivered != NULL) {
+        hpb_hype_transport->callbacks.on_message_delivered(event->message_id);
+    }
+
+    hpb_hype_event_destroy(&event);
+}
@@ -0,0 +1,372 @@
+
+#include "hype_pub_sub/hpb_load.h"
+
+#include <inttypes.h>
+
+//
+// Static functions declaration
+//
+
+static size_t hpb_load_generator_write_msg(HpbLoadGenerator *generator, size_t topic, uint64_t seq, uint64_t scheduled_us, uint64_t sent_us);
+static HpbLoadSource *hpb_load_sink_get_source(HpbLoadSink *sink, uint32_t tag, size_t n_topics, uint64_t n_scheduled);
+static void hpb_load_print_latency(FILE *out, const char *name, HpbHistogram *histogram);
+static bool linked_list_callback_is_source_tag(void *source, void *tag);
+static void linked_list_callback_free_source(void **element);
+
+//
+// Header functions implementation
+//
+
+HpbLoadGenerator *hpb_load_generator_create(uint32_t tag, double rate, size_t n_topics, uint64_t duration_us, size_t msg_size)
+{
+    if(rate <= 0.0 || n_topics < 1 || n_topics > HPB_LOAD_MAX_TOPICS || msg_size > HPB_LOAD_MAX_MSG_SIZE) {
+        return NULL;
+    }
+
+    HpbLoadGenerator *generator = (HpbLoadGenerator *) calloc(1, sizeof(HpbLoadGenerator));
+    if(generator == NULL) {
+        return NULL;
+    }
+
+    // The header of the messages is rewritten in place, in front of a padding which never changes
+    size_t buffer_size = (msg_size > HPB_LOAD_MAX_HEADER_SIZE) ? msg_size : HPB_LOAD_MAX_HEADER_SIZE;
+    generator->msg = (char *) malloc(buffer_size);
+    generator->n_failed_by_topic = (uint64_t *) calloc(n_topics, sizeof(uint64_t));
+    generator->topic_keys = (HLByte *) malloc(n_topics * SHA1_BLOCK_SIZE);
+    if(generator->msg == NULL || generator->n_failed_by_topic == NULL || generator->topic_keys == NULL)
+    {
+        free(generator->msg);
+        free(generator->n_failed_by_topic);
+        free(generator->topic_keys);
+        free(generator);
+        return NULL;
+    }
+    memset(generator->msg, '.', buffer_size);
+
+    char topic_name[HPB_LOAD_MAX_TOPIC_NAME];
+    for(size_t i = 0; i < n_topics; i++)
+    {
+        snprintf(topic_name, sizeof(topic_name), HPB_LOAD_TOPIC_PREFIX "%zu", i);
+        sha1_digest((const BYTE *) topic_name, strlen(topic_name), generator->topic_keys + i * SHA1_BLOCK_SIZE);
+    }
+
+    generator->tag = tag;
+    generator->rate = rate;
+    generator->n_topics = n_topics;
+    generator->msg_size = msg_size;
+    generator->n_scheduled = (uint64_t) ((double) duration_us * rate / 1000000.0);
+    generator->start_us = hpb_clock_now_us();
+    return generator;
+}
+
+size_t hpb_load_generator_tick(HpbLoadGenerator *generator)
+{
+    uint64_t now_us = hpb_clock_now_us();
+    char topic_name[HPB_LOAD_MAX_TOPIC_NAME];
+    size_t n_published = 0;
+
+    while(!hpb_load_generator_is_done(generator) && n_published < HPB_LOAD_MAX_BURST)
+    {
+        // Message k is due at a fixed offset from the start, whatever happened to the previous ones
+        uint64_t index = generator->n_sent;
+        uint64_t scheduled_us = generator->start_us + (uint64_t) ((double) index * 1000000.0 / generator->rate);
+        if(scheduled_us > now_us) {
+            break;
+        }
+
+        size_t topic = (size_t) (index % generator->n_topics);
+        uint64_t sent_us = hpb_clock_now_us();
+        size_t msg_length = hpb_load_generator_write_msg(generator, topic, index / generator->n_topics, scheduled_us, sent_us);
+        snprintf(topic_name, sizeof(topic_name), HPB_LOAD_TOPIC_PREFIX "%zu", topic);
+
+        // The publishes which never reach the manager are reported later, through the completion callback
+        hpb_issue_publish_req(topic_name, generator->msg, msg_length);
+        generator->n_sent++;
+
+        generator->max_lag_us = (sent_us - scheduled_us > generator->max_lag_us) ? sent_us - scheduled_us : generator->max_lag_us;
+        n_published++;
+    }
+
+    return n_published;
+}
+
+bool hpb_load_generator_is_done(HpbLoadGenerator *generator)
+{
+    return generator->n_sent >= generator->n_scheduled;
+}
+
+int hpb_load_generator_on_publish_completion(HpbLoadGenerator *generator, HLByte service_key[], bool success)
+{
+    if(success) {
+        return -1;
+    }
+
+    for(size_t i = 0; i < generator->n_topics; i++)
+    {
+        if(memcmp(generator->topic_keys + i * SHA1_BLOCK_SIZE, service_key, SHA1_BLOCK_SIZE) == 0)
+        {
+            generator->n_failed++;
+            generator->n_failed_by_topic[i]++;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+void hpb_load_generator_print_report(FILE *out, HpbLoadGenerator *generator)
+{
+    fprintf(out, "Load generator %08" PRIx32 ": %llu of %llu messages published (%llu given up) at %.1f msg/s in %zu topics, "
+            "at most %.2f ms behind the schedule\n", generator->tag, (unsigned long long) generator->n_sent,
+            (unsigned long long) generator->n_scheduled, (unsigned long long) generator->n_failed, generator->rate,
+            generator->n_topics, generator->max_lag_us / 1000.0);
+}
+
+void hpb_load_generator_destroy(HpbLoadGenerator **generator)
+{
+    if((*generator) == NULL) {
+        return;
+    }
+
+    free((*generator)->msg);
+    free((*generator)->n_failed_by_topic);
+    free((*generator)->topic_keys);
+    free(*generator);
+    (*generator) = NULL;
+}
+
+HpbLoadSink *hpb_load_sink_create(size_t n_topics)
+{
+    if(n_topics < 1 || n_topics > HPB_LOAD_MAX_TOPICS) {
+        return NULL;
+    }
+
+    HpbLoadSink *sink = (HpbLoadSink *) calloc(1, sizeof(HpbLoadSink));
+    if(sink == NULL) {
+        return NULL;
+    }
+
+    sink->n_topics = n_topics;
+    sink->sources = linked_list_create();
+    sink->latency = hpb_histogram_create(HPB_LOAD_HISTOGRAM_HIGHEST_US, HPB_LOAD_HISTOGRAM_FIGURES);
+    sink->uncorrected_latency = hpb_histogram_create(HPB_LOAD_HISTOGRAM_HIGHEST_US, HPB_LOAD_HISTOGRAM_FIGURES);
+    if(sink->sources == NULL || sink->latency == NULL || sink->uncorrected_latency == NULL) {
+        hpb_load_sink_destroy(&sink);
+    }
+
+    return sink;
+}
+
+int hpb_load_sink_subscribe(HpbLoadSink *sink)
+{
+    char topic_name[HPB_LOAD_MAX_TOPIC_NAME];
+    int result = 0;
+
+    for(size_t i = 0; i < sink->n_topics; i++)
+    {
+        snprintf(topic_name, sizeof(topic_name), HPB_LOAD_TOPIC_PREFIX "%zu", i);
+        if(hpb_issue_subscribe_req(topic_name) != 0) {
+            result = -1;
+        }
+    }
+
+    return result;
+}
+
+int hpb_load_sink_receive(HpbLoadSink *sink, char *msg, size_t msg_length)
+{
+    uint64_t now_us = hpb_clock_now_us();
+
+    // The header is parsed from a copy, since the message is not necessarily terminated
+    char header[HPB_LOAD_MAX_HEADER_SIZE];
+    size_t header_length = (msg_length < sizeof(header) - 1) ? msg_length : sizeof(header) - 1;
+    memcpy(header, msg, header_length);
+    header[header_length] = '\0';
+
+    uint32_t tag;
+    size_t n_topics;
+    uint64_t n_scheduled;
+    size_t topic;
+    uint64_t seq;
+    uint64_t n_failed;
+    uint64_t scheduled_us;
+    uint64_t sent_us;
+    if(strncmp(header, HPB_LOAD_MAGIC " ", strlen(HPB_LOAD_MAGIC " ")) != 0 ||
+       sscanf(header + strlen(HPB_LOAD_MAGIC), " %" SCNu32 " %zu %" SCNu64 " %zu %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64,
+              &tag, &n_topics, &n_scheduled, &topic, &seq, &n_failed, &scheduled_us, &sent_us) != 8 ||
+       topic >= sink->n_topics || topic >= n_topics)
+    {
+        sink->n_invalid++;
+        return -1;
+    }
+
+    HpbLoadSource *source = hpb_load_sink_get_source(sink, tag, n_topics, n_scheduled);
+    if(source == NULL) {
+        return -1;
+    }
+
+    HpbLoadTopicStats *stats = &source->topics[topic];
+    stats->n_received++;
+    stats->n_failed = (n_failed > stats->n_failed) ? n_failed : stats->n_failed;
+    if(seq >= stats->next_seq) {
+        stats->next_seq = seq + 1;
+    }
+    else {
+        stats->n_reordered++;
+    }
+
+    hpb_histogram_record(sink->latency, (now_us > scheduled_us) ? now_us - scheduled_us : 0);
+    hpb_histogram_record(sink->uncorrected_latency, (now_us > sent_us) ? now_us - sent_us : 0);
+
+    if(sink->n_received == 0) {
+        sink->first_us = now_us;
+    }
+    sink->last_us = now_us;
+    sink->n_received++;
+    sink->bytes_received += msg_length;
+    return 0;
+}
+
+uint64_t hpb_load_sink_get_lost(HpbLoadSink *sink)
+{
+    uint64_t n_lost = 0;
+
+    for(LinkedListNode *node = sink->sources->head; node != NULL; node = node->next)
+    {
+        HpbLoadSource *source = (HpbLoadSource *) node->element;
+        for(size_t i = 0; i < sink->n_topics && i < source->n_topics; i++)
+        {
+            // The generator publishes message k in topic k % n_topics
+            uint64_t n_expected = (i < source->n_scheduled) ? (source->n_scheduled - i - 1) / source->n_topics + 1 : 0;
+            uint64_t n_accounted = source->topics[i].n_received + source->topics[i].n_failed;
+            if(n_expected > n_accounted) {
+                n_lost += n_expected - n_accounted;
+            }
+        }
+    }
+
+    return n_lost;
+}
+
+uint64_t hpb_load_sink_get_failed(HpbLoadSink *sink)
+{
+    uint64_t n_failed = 0;
+
+    for(LinkedListNode *node = sink->sources->head; node != NULL; node = node->next)
+    {
+        HpbLoadSource *source = (HpbLoadSource *) node->element;
+        for(size_t i = 0; i < sink->n_topics; i++) {
+            n_failed += source->topics[i].n_failed;
+        }
+    }
+
+    return n_failed;
+}
+
+void hpb_load_sink_print_report(FILE *out, HpbLoadSink *sink)
+{
+    uint64_t n_lost = hpb_load_sink_get_lost(sink);
+    uint64_t n_reordered = 0;
+
+    for(LinkedListNode *node = sink->sources->head; node != NULL; node = node->next)
+    {
+        HpbLoadSource *source = (HpbLoadSource *) node->element;
+        for(size_t i = 0; i < sink->n_topics; i++) {
+            n_reordered += source->topics[i].n_reordered;
+        }
+    }
+
+    double elapsed_s = (sink->last_us - sink->first_us) / 1000000.0;
+    fprintf(out, "Load sink: %llu messages (%.1f KB) in %.2f s: %.1f msg/s, %.1f KB/s\n", (unsigned long long) sink->n_received,
+            sink->bytes_received / 1024.0, elapsed_s, (elapsed_s > 0.0) ? sink->n_received / elapsed_s : 0.0,
+            (elapsed_s > 0.0) ? sink->bytes_received / 1024.0 / elapsed_s : 0.0);
+    fprintf(out, "Lost: %llu (%.3f%%), given up by the generators: %llu, reordered: %llu, other messages: %llu, from %zu generators in %zu topics\n",
+            (unsigned long long) n_lost, (n_lost + sink->n_received > 0) ? 100.0 * n_lost / (n_lost + sink->n_received) : 0.0,
+            (unsigned long long) hpb_load_sink_get_failed(sink), (unsigned long long) n_reordered, (unsigned long long) sink->n_invalid, sink->sources->size, sink->n_topics);
+
+    fprintf(out, "%-26s %10s %10s %10s %10s %10s\n", "Latency (us)", "p50", "p99", "p99.9", "max", "mean");
+    hpb_load_print_latency(out, "From the schedule", sink->latency);
+    hpb_load_print_latency(out, "From the publish", sink->uncorrected_latency);
+}
+
+void hpb_load_sink_destroy(HpbLoadSink **sink)
+{
+    if((*sink) == NULL) {
+        return;
+    }
+
+    linked_list_destroy(&(*sink)->sources, linked_list_callback_free_source);
+    hpb_histogram_destroy(&(*sink)->latency);
+    hpb_histogram_destroy(&(*sink)->uncorrected_latency);
+    free(*sink);
+    (*sink) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static size_t hpb_load_generator_write_msg(HpbLoadGenerator *generator, size_t topic, uint64_t seq, uint64_t scheduled_us, uint64_t sent_us)
+{
+    char header[HPB_LOAD_MAX_HEADER_SIZE];
+    int header_length = snprintf(header, sizeof(header), HPB_LOAD_MAGIC " %" PRIu32 " %zu %" PRIu64 " %zu %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " ",
+                                 generator->tag, generator->n_topics, generator->n_scheduled, topic, seq, generator->n_failed_by_topic[topic],
+                                 scheduled_us, sent_us);
+
+    // The message keeps its terminator, so that it can be printed by the nodes which are not sinks
+    size_t msg_length = (generator->msg_size > (size_t) header_length) ? generator->msg_size : (size_t) header_length + 1;
+    size_t padding_end = (msg_length - 1 < HPB_LOAD_MAX_HEADER_SIZE) ? msg_length - 1 : HPB_LOAD_MAX_HEADER_SIZE;
+    memcpy(generator->msg, header, (size_t) header_length);
+    memset(generator->msg + header_length, '.', padding_end - (size_t) header_length); // Over the end of a longer previous header
+    generator->msg[msg_length - 1] = '\0';
+    return msg_length;
+}
+
+static HpbLoadSource *hpb_load_sink_get_source(HpbLoadSink *sink, uint32_t tag, size_t n_topics, uint64_t n_scheduled)
+{
+    LinkedListNode *node = linked_list_find(sink->sources, &tag, linked_list_callback_is_source_tag);
+    if(node != NULL) {
+        return (HpbLoadSource *) node->element;
+    }
+
+    HpbLoadSource *source = (HpbLoadSource *) malloc(sizeof(HpbLoadSource));
+    if(source == NULL) {
+        return NULL;
+    }
+
+    source->tag = tag;
+    source->n_topics = n_topics;
+    source->n_scheduled = n_scheduled;
+    source->topics = (HpbLoadTopicStats *) calloc(sink->n_topics, sizeof(HpbLoadTopicStats));
+    if(source->topics == NULL)
+    {
+        free(source);
+        return NULL;
+    }
+
+    linked_list_add(sink->sources, source);
+    return source;
+}
+
+static void hpb_load_print_latency(FILE *out, const char *name, HpbHistogram *histogram)
+{
+    fprintf(out, "%-26s %10llu %10llu %10llu %10llu %10.1f\n", name,
+            (unsigned long long) hpb_histogram_get_value_at_percentile(histogram, 50.0),
+            (unsigned long long) hpb_histogram_get_value_at_percentile(histogram, 99.0),
+            (unsigned long long) hpb_histogram_get_value_at_percentile(histogram, 99.9),
+            (unsigned long long) hpb_histogram_get_value_at_percentile(histogram, 100.0),
+            hpb_histogram_get_mean(histogram));
+}
+
+static bool linked_list_callback_is_source_tag(void *source, void *tag)
+{
+    return ((HpbLoadSource *) source)->tag == *((uint32_t *) tag);
+}
+
+static void linked_list_callback_free_source(void **element)
+{
+    HpbLoadSource *source = (HpbLoadSource *) (*element);
+    free(source->topics);
+    free(source);
+    (*element) = NULL;
+}
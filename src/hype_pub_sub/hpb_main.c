@@ -1,78 +1,172 @@
 #include<stdio.h>
 #include<string.h>
+#include<signal.h>
+#include<errno.h>
+#include<sys/signalfd.h>
 
 #include "hype_pub_sub/hype_pub_sub.h"
 #include "hype_pub_sub/hpb_cmd_interface.h"
+#include "hype_pub_sub/hpb_event_loop.h"
 #include <hype_pub_sub/hpb_hype_interface.h>
+#include <hype_pub_sub/hpb_transport_socket.h>
+#include <hype_pub_sub/hpb_load.h>
 
 #define HPB_INVALID_COMMAND_MESSAGE "Invalid command. Please see the helper (-h)"
+#define HPB_DAEMON_ARG "--daemon"
+#define HPB_CAPACITY_ARG "--capacity"
+#define HPB_LOCAL_DIR_ARG "--local-dir"
+#define HPB_NODE_NAME_ARG "--node-name"
+#define HPB_METRICS_SOCKET_ARG "--metrics-socket"
+#define HPB_USER_INPUT_SIZE 1000
+
+/**
+ * @brief This struct holds the state of the HypePubSub executable driven by the event loop.
+ */
+typedef struct HpbMain_
+{
+    HpbEventLoop *loop; /**< Event loop multiplexing stdin, transport callbacks, signals and timers. */
+    HpbTransport *transport; /**< Transport through which the messages are exchanged: the Hype SDK, or the local sockets. */
+    char *local_dir; /**< Directory of the local sockets, or NULL to use the Hype SDK. */
+    char node_name[HPB_TRANSPORT_SOCKET_MAX_NAME + 1]; /**< Name of this node on the local sockets. */
+    int capacity; /**< Capacity announced to the other devices. */
+    bool is_daemon; /**< Indicates if the application runs headless, without reading stdin. */
+    int n_startup_args; /**< Number of command line arguments to be executed once Hype starts. */
+    char **startup_args; /**< Command line arguments to be executed once Hype starts. */
+    int signal_fd; /**< signalfd used to terminate the loop on SIGINT and SIGTERM. */
+    char user_input[HPB_USER_INPUT_SIZE]; /**< Line being read from stdin. */
+    size_t user_input_length; /**< Number of bytes of the line read so far. */
+    char pending_publish_service[HPB_USER_INPUT_SIZE]; /**< Service waiting for the message to be published or for the filter of its subscription, if any. */
+    bool is_pending_publish_retained; /**< Indicates if the pending message should be retained. */
+    bool is_pending_filter; /**< Indicates if the pending line is the filter of a subscription instead of a message. */
+    HpbLoadGenerator *load_generator; /**< Generator of the load published by this node, if any. */
+    int load_timer_id; /**< Timer which ticks the load generator. */
+    HpbLoadSink *load_sink; /**< Sink of the load received by this node, if any. */
+    char *metrics_socket; /**< Path of the Unix socket on which the metrics are served, or NULL. */
+    HpbMetricsExporter *metrics_exporter; /**< Endpoint which serves the metrics, if any. */
+    int exit_code; /**< Exit code of the application. */
+} HpbMain;
+
+static HpbMain hpb_main;
 
 bool parse_user_arguments(int n_args, char *args[], HypePubSub *hpb);
+static void hpb_main_on_transport_start(bool success);
+static void hpb_main_on_stdin(int fd, void *arg);
+static void hpb_main_on_stdin_task(void *arg);
+static void hpb_main_on_signal(int fd, void *arg);
+static void hpb_main_on_periodic_timer(void *arg);
+static void hpb_main_on_load_timer(void *arg);
+static void hpb_main_on_message_received(char *service_name, char *msg, size_t msg_length);
+static void hpb_main_on_publish_completion(HLByte service_key[], bool success);
+static void hpb_main_start_load_generator(char *parameters);
+static void hpb_main_start_load_sink(char *n_topics);
+static void hpb_main_print_load_stats();
+static void hpb_main_process_line(char *line);
+static void hpb_main_print_prompt();
 
-int main()
+int main(int argc, char *argv[])
 {
-    int ret;
-    //Start Hype Services
-    hpb_hype_interface_request_to_start();
+    memset(&hpb_main, 0, sizeof(hpb_main));
 
-    if (pthread_mutex_init(&mutex, NULL) != 0) {
-        perror("pthread_mutex_init() error");
-        exit(1);
-    }
+    hpb_main.capacity = HPB_CLIENT_DEFAULT_CAPACITY;
+    snprintf(hpb_main.node_name, sizeof(hpb_main.node_name), "node-%d", (int) getpid());
 
-    if (pthread_cond_init(&cond, NULL) != 0) {
-        perror("pthread_cond_init() error");
-        exit(2);
+    // Every argument other than those of the startup is interpreted as a command to be executed once the transport starts
+    hpb_main.startup_args = (char **) calloc(argc + 1, sizeof(char *));
+    hpb_main.startup_args[hpb_main.n_startup_args++] = argv[0];
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], HPB_DAEMON_ARG) == 0) {
+            hpb_main.is_daemon = true;
+        }
+        else if(strcmp(argv[i], HPB_CAPACITY_ARG) == 0 && i + 1 < argc)
+        {
+            // The capacity is announced, so it must be known before the transport starts
+            if(hpb_hype_interface_set_capacity(atoi(argv[++i])) != 0) {
+                printf("The capacity must be between 1 and %i\n", HPB_CLIENT_MAX_CAPACITY);
+            }
+            else {
+                hpb_main.capacity = atoi(argv[i]);
+            }
+        }
+        else if(strcmp(argv[i], HPB_LOCAL_DIR_ARG) == 0 && i + 1 < argc) {
+            hpb_main.local_dir = argv[++i];
+        }
+        else if(strcmp(argv[i], HPB_NODE_NAME_ARG) == 0 && i + 1 < argc) {
+            snprintf(hpb_main.node_name, sizeof(hpb_main.node_name), "%s", argv[++i]);
+        }
+        else if(strcmp(argv[i], HPB_METRICS_SOCKET_ARG) == 0 && i + 1 < argc) {
+            hpb_main.metrics_socket = argv[++i];
+        }
+        else {
+            hpb_main.startup_args[hpb_main.n_startup_args++] = argv[i];
+        }
     }
 
-    if (pthread_cond_wait(&cond, &mutex) != 0) {
-        perror("pthread_cond_timedwait() error");
-        exit(7);
+    hpb_main.loop = hpb_event_loop_create();
+    if(hpb_main.loop == NULL) {
+        perror("hpb_event_loop_create() error");
+        exit(1);
     }
 
-    // TODO: Exit if Hype fails starting
-
-    //The Hype Services
-    HypePubSub *hpb = hpb_get();
-
-    hpb_cmd_interface_print_header();
+    // Signals are received through the loop as well so that a daemon can be terminated cleanly
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    hpb_main.signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if(hpb_main.signal_fd >= 0) {
+        hpb_event_loop_add_fd(hpb_main.loop, hpb_main.signal_fd, hpb_main_on_signal, NULL);
+    }
 
-    while(true)
+    // With a directory of local sockets several nodes run on this machine without the Hype SDK
+    HpbTransportCallbacks callbacks = hpb_transport_get_pub_sub_callbacks(hpb_main_on_transport_start);
+    if(hpb_main.local_dir != NULL) {
+        hpb_main.transport = hpb_transport_socket_create(hpb_main.loop, callbacks, hpb_main.local_dir, hpb_main.node_name, (uint8_t) hpb_main.capacity);
+    }
+    else {
+        hpb_main.transport = hpb_hype_interface_create_transport(hpb_main.loop, callbacks);
+    }
+    if(hpb_main.transport == NULL)
     {
-        printf("> ");
-        size_t user_input_size = 1000;
-        char user_input[user_input_size];
-        fgets(user_input, user_input_size, stdin);
+        printf("The transport could not be created. The node name must have up to %i characters, without '/', "
+               "and the socket paths up to %i\n", HPB_TRANSPORT_SOCKET_MAX_NAME, HPB_TRANSPORT_SOCKET_MAX_PATH - 1);
+        exit(1);
+    }
 
-        ret = strncmp(user_input, "-", 1);
+    //Start Hype Services
+    hpb_set_transport(hpb_main.transport);
+    hpb_transport_start(hpb_main.transport);
 
-        //Validation for use '-' i the beginning of the option.
-        if(ret != 0)
-        {
-             printf("%s\n",HPB_INVALID_COMMAND_MESSAGE);
-             continue;
+    // The metrics are only collected when they are scraped, so the socket costs nothing while nobody reads it
+    if(hpb_main.metrics_socket != NULL)
+    {
+        hpb_main.metrics_exporter = hpb_metrics_exporter_create(hpb_main.loop, hpb_main.metrics_socket, hpb_collect_metrics);
+        if(hpb_main.metrics_exporter == NULL) {
+            printf("The metrics socket could not be created at %s\n", hpb_main.metrics_socket);
         }
+    }
 
-        // Remove \n read by fgets()
-        user_input[strcspn(user_input, "\n")] = '\0';
-
-        // Simulate original 'argv' array which contains the name of the program to be executed in the first index.
-        char sim_argv[user_input_size + strlen(HPB_CMD_INTERFACE_INIT_ARG)];
-        strcpy(sim_argv, HPB_CMD_INTERFACE_INIT_ARG);
-        strcat(sim_argv, user_input);
-
-        char *args[HPB_CMD_INTERFACE_MAX_ARGS];
-        int n_args = hpb_cmd_interface_arg_split(args, sim_argv, HPB_CMD_INTERFACE_ARG_DELIM);
-
-        bool is_to_quit = parse_user_arguments(n_args, args, hpb);
+    hpb_event_loop_run(hpb_main.loop);
 
-        if(is_to_quit) {
-            break;
-        }
+    // A headless sink reports the load it measured when it is terminated
+    if(hpb_main.is_daemon && hpb_main.load_sink != NULL) {
+        hpb_main_print_load_stats();
     }
+    hpb_load_generator_destroy(&hpb_main.load_generator);
+    hpb_load_sink_destroy(&hpb_main.load_sink);
+    hpb_metrics_exporter_destroy(&hpb_main.metrics_exporter);
 
-    // TODO: Hype Stop
+    hpb_transport_stop(hpb_main.transport);
     hpb_destroy();
+    hpb_set_transport(NULL);
+    hpb_transport_destroy(&hpb_main.transport);
+    hpb_event_loop_destroy(&hpb_main.loop);
+    if(hpb_main.signal_fd >= 0) {
+        close(hpb_main.signal_fd);
+    }
+    free(hpb_main.startup_args);
+    return hpb_main.exit_code;
 }
 
 bool parse_user_arguments(int n_args, char *args[], HypePubSub *hpb)
@@ -92,7 +186,25 @@ bool parse_user_arguments(int n_args, char *args[], HypePubSub *hpb)
                 hpb_cmd_interface_unsubscribe(hpb, optarg);
                 break;
             case 'p' :
-                hpb_cmd_interface_publish(hpb, optarg);
+            case 'r' :
+            case 'l' :
+                // A daemon never reads stdin, where the message or the filter would come from
+                if(hpb_main.is_daemon)
+                {
+                    printf("--%s is not available with %s, since the message or the filter is read from stdin\n",
+                           hpb_cmd_interface_long_options[long_index].name, HPB_DAEMON_ARG);
+                    break;
+                }
+                // The message or the filter, which may contain spaces, is read from the next input line, without blocking the loop
+                strncpy(hpb_main.pending_publish_service, optarg, HPB_USER_INPUT_SIZE - 1);
+                hpb_main.is_pending_publish_retained = (opt == 'r');
+                hpb_main.is_pending_filter = (opt == 'l');
+                if(hpb_main.is_pending_filter) {
+                    printf("Insert filter of the subscription to the service '%s': ", optarg);
+                }
+                else {
+                    printf("Insert message to be published on the service '%s': ", optarg);
+                }
                 break;
             case 'i' :
                 hpb_cmd_interface_print_own_id(hpb);
@@ -106,6 +218,46 @@ bool parse_user_arguments(int n_args, char *args[], HypePubSub *hpb)
             case 'n' :
                 hpb_cmd_interface_print_subscriptions(hpb);
                 break;
+            case 'f' :
+                hpb_cmd_interface_print_fanout_stats(hpb);
+                break;
+            case 'o' :
+                hpb_cmd_interface_print_resolution_stats(hpb);
+                break;
+            case 'y' :
+                hpb_cmd_interface_print_stats(hpb);
+                break;
+            case 'k' :
+                hpb_cmd_interface_set_replicas(hpb, optarg);
+                break;
+            case 'w' :
+                hpb_cmd_interface_set_membership_window(hpb, optarg);
+                break;
+            case 'v' :
+                hpb_cmd_interface_set_placement(hpb, optarg);
+                break;
+            case 'a' :
+                hpb_cmd_interface_set_shards(hpb, optarg);
+                break;
+            case 'b' :
+                hpb_cmd_interface_set_relay_tree(hpb, optarg);
+                break;
+            case 'e' :
+            case 'x' :
+                hpb_cmd_interface_set_direct(hpb, optarg, opt == 'e');
+                break;
+            case 'c' :
+                hpb_cmd_interface_set_resolutions(hpb, optarg);
+                break;
+            case 'g' :
+                hpb_main_start_load_generator(optarg);
+                break;
+            case 'j' :
+                hpb_main_start_load_sink(optarg);
+                break;
+            case 't' :
+                hpb_main_print_load_stats();
+                break;
             case 'h' :
                 hpb_cmd_interface_print_helper();
                 break;
@@ -117,3 +269,253 @@ bool parse_user_arguments(int n_args, char *args[], HypePubSub *hpb)
     }
     return false;
 }
+
+static void hpb_main_on_transport_start(bool success)
+{
+    if(!success)
+    {
+        hpb_main.exit_code = 1;
+        hpb_event_loop_stop(hpb_main.loop);
+        return;
+    }
+
+    //The Hype Services
+    HypePubSub *hpb = hpb_get();
+    hpb_event_loop_add_timer(hpb_main.loop, HPB_PERIODIC_TASKS_INTERVAL_MS, HPB_PERIODIC_TASKS_INTERVAL_MS, hpb_main_on_periodic_timer, NULL);
+
+    if(hpb_main.n_startup_args > 1 && parse_user_arguments(hpb_main.n_startup_args, hpb_main.startup_args, hpb))
+    {
+        hpb_event_loop_stop(hpb_main.loop);
+        return;
+    }
+
+    if(hpb_main.is_daemon) {
+        return;
+    }
+
+    hpb_cmd_interface_print_header();
+    hpb_main_print_prompt();
+    if(hpb_event_loop_add_fd(hpb_main.loop, STDIN_FILENO, hpb_main_on_stdin, NULL) == 0) {
+        return;
+    }
+
+    // epoll refuses regular files, which are always readable, so a redirected file is read a chunk per iteration of the loop
+    if(errno == EPERM) {
+        hpb_event_loop_post(hpb_main.loop, hpb_main_on_stdin_task, NULL, NULL);
+    }
+    else
+    {
+        perror("The standard input could not be watched");
+        hpb_main.exit_code = 1;
+        hpb_event_loop_stop(hpb_main.loop);
+    }
+}
+
+static void hpb_main_on_stdin(int fd, void *arg)
+{
+    char buffer[HPB_USER_INPUT_SIZE];
+    ssize_t n_read = read(fd, buffer, sizeof(buffer));
+
+    if(n_read <= 0) // End of input. Nothing else will be read.
+    {
+        hpb_event_loop_remove_fd(hpb_main.loop, fd);
+        hpb_event_loop_stop(hpb_main.loop);
+        return;
+    }
+
+    for(ssize_t i = 0; i < n_read; i++)
+    {
+        if(buffer[i] != '\n')
+        {
+            if(hpb_main.user_input_length < HPB_USER_INPUT_SIZE - 1) {
+                hpb_main.user_input[hpb_main.user_input_length++] = buffer[i];
+            }
+            continue;
+        }
+
+        hpb_main.user_input[hpb_main.user_input_length] = '\0';
+        hpb_main.user_input_length = 0;
+        hpb_main_process_line(hpb_main.user_input);
+
+        if(!hpb_main.loop->is_running) {
+            return;
+        }
+    }
+}
+
+static void hpb_main_on_stdin_task(void *arg)
+{
+    hpb_main_on_stdin(STDIN_FILENO, NULL);
+
+    // Posted again so that the timers and the transport run between the chunks
+    if(hpb_main.loop->is_running) {
+        hpb_event_loop_post(hpb_main.loop, hpb_main_on_stdin_task, NULL, NULL);
+    }
+}
+
+static void hpb_main_on_signal(int fd, void *arg)
+{
+    struct signalfd_siginfo info;
+    if(read(fd, &info, sizeof(info)) > 0) {
+        hpb_event_loop_stop(hpb_main.loop);
+    }
+}
+
+static void hpb_main_on_periodic_timer(void *arg)
+{
+    hpb_process_periodic_tasks();
+}
+
+static void hpb_main_on_load_timer(void *arg)
+{
+    hpb_load_generator_tick(hpb_main.load_generator);
+
+    if(hpb_load_generator_is_done(hpb_main.load_generator))
+    {
+        hpb_event_loop_cancel_timer(hpb_main.loop, hpb_main.load_timer_id);
+        hpb_load_generator_print_report(stdout, hpb_main.load_generator);
+    }
+}
+
+static void hpb_main_on_message_received(char *service_name, char *msg, size_t msg_length)
+{
+    if(hpb_load_sink_receive(hpb_main.load_sink, msg, msg_length) == 0) {
+        return;
+    }
+
+    printf("\n### Message Received! ###\n");
+    printf("ServiceName: %s \n", service_name);
+    printf("Message: %.*s\n\n", (int) msg_length, msg);
+}
+
+static void hpb_main_on_publish_completion(HLByte service_key[], bool success)
+{
+    if(hpb_main.load_generator != NULL) {
+        hpb_load_generator_on_publish_completion(hpb_main.load_generator, service_key, success);
+    }
+}
+
+static void hpb_main_start_load_generator(char *parameters)
+{
+    double rate = 0.0;
+    size_t n_topics = 0;
+    double duration_s = 0.0;
+    size_t msg_size = HPB_LOAD_DEFAULT_MSG_SIZE;
+
+    if(hpb_main.load_generator != NULL && !hpb_load_generator_is_done(hpb_main.load_generator))
+    {
+        printf("A load is already being published\n");
+        return;
+    }
+
+    hpb_load_generator_destroy(&hpb_main.load_generator);
+    if(sscanf(parameters, "%lf,%zu,%lf,%zu", &rate, &n_topics, &duration_s, &msg_size) >= 3 && duration_s > 0.0) {
+        hpb_main.load_generator = hpb_load_generator_create((uint32_t) getpid() ^ (uint32_t) hpb_clock_now_us(), rate, n_topics,
+                                                            (uint64_t) (duration_s * 1000000.0), msg_size);
+    }
+
+    if(hpb_main.load_generator == NULL)
+    {
+        printf("The load must be given as rate,topics,seconds[,size], with up to %i topics and messages of up to %i bytes\n",
+               HPB_LOAD_MAX_TOPICS, HPB_LOAD_MAX_MSG_SIZE);
+        return;
+    }
+
+    hpb_set_publish_completion_callback(hpb_main_on_publish_completion);
+    hpb_main.load_timer_id = hpb_event_loop_add_timer(hpb_main.loop, HPB_LOAD_TICK_MS, HPB_LOAD_TICK_MS, hpb_main_on_load_timer, NULL);
+    printf("Publishing %llu messages at %.1f msg/s in %zu topics\n", (unsigned long long) hpb_main.load_generator->n_scheduled,
+           rate, n_topics);
+}
+
+static void hpb_main_start_load_sink(char *n_topics)
+{
+    char *end;
+    long topics = strtol(n_topics, &end, 10);
+
+    if(hpb_main.load_sink != NULL)
+    {
+        printf("The load topics are already subscribed\n");
+        return;
+    }
+
+    if(end == n_topics || *end != '\0' || topics < 1 || topics > HPB_LOAD_MAX_TOPICS)
+    {
+        printf("The number of load topics must be between 1 and %i\n", HPB_LOAD_MAX_TOPICS);
+        return;
+    }
+
+    hpb_main.load_sink = hpb_load_sink_create((size_t) topics);
+    hpb_set_message_received_callback(hpb_main_on_message_received);
+    hpb_load_sink_subscribe(hpb_main.load_sink);
+    printf("Measuring the load received in %li topics\n", topics);
+}
+
+static void hpb_main_print_load_stats()
+{
+    if(hpb_main.load_generator == NULL && hpb_main.load_sink == NULL)
+    {
+        printf("No load is being published or measured\n");
+        return;
+    }
+
+    if(hpb_main.load_generator != NULL) {
+        hpb_load_generator_print_report(stdout, hpb_main.load_generator);
+    }
+    if(hpb_main.load_sink != NULL) {
+        hpb_load_sink_print_report(stdout, hpb_main.load_sink);
+    }
+}
+
+static void hpb_main_process_line(char *line)
+{
+    HypePubSub *hpb = hpb_get();
+
+    if(hpb_main.pending_publish_service[0] != '\0')
+    {
+        if(hpb_main.is_pending_filter) {
+            hpb_cmd_interface_subscribe_filtered(hpb, hpb_main.pending_publish_service, line);
+        }
+        else if(hpb_main.is_pending_publish_retained) {
+            hpb_cmd_interface_publish_retained(hpb, hpb_main.pending_publish_service, line);
+        }
+        else {
+            hpb_cmd_interface_publish(hpb, hpb_main.pending_publish_service, line);
+        }
+        hpb_main.pending_publish_service[0] = '\0';
+        hpb_main_print_prompt();
+        return;
+    }
+
+    //Validation for use '-' i the beginning of the option.
+    if(strncmp(line, "-", 1) != 0)
+    {
+         printf("%s\n",HPB_INVALID_COMMAND_MESSAGE);
+         hpb_main_print_prompt();
+         return;
+    }
+
+    // Simulate original 'argv' array which contains the name of the program to be executed in the first index.
+    char sim_argv[HPB_USER_INPUT_SIZE + strlen(HPB_CMD_INTERFACE_INIT_ARG)];
+    strcpy(sim_argv, HPB_CMD_INTERFACE_INIT_ARG);
+    strcat(sim_argv, line);
+
+    char *args[HPB_CMD_INTERFACE_MAX_ARGS];
+    int n_args = hpb_cmd_interface_arg_split(args, sim_argv, HPB_CMD_INTERFACE_ARG_DELIM);
+
+    bool is_to_quit = parse_user_arguments(n_args, args, hpb);
+
+    if(is_to_quit) {
+        hpb_event_loop_stop(hpb_main.loop);
+        return;
+    }
+
+    if(hpb_main.pending_publish_service[0] == '\0') {
+        hpb_main_print_prompt();
+    }
+}
+
+static void hpb_main_print_prompt()
+{
+    printf("> ");
+    fflush(stdout);
+}
@@ -0,0 +1,168 @@
+#include "hype_pub_sub/hpb_membership.h"
+
+//
+// Static functions declaration
+//
+
+static HpbMembershipChange *hpb_membership_find(LinkedList *list, HypeInstance *instance);
+static HpbMembershipChange *hpb_membership_set(LinkedList *list, HypeInstance *instance, bool is_resolved, uint64_t now_ms);
+static bool hpb_membership_is_same_instance(HypeInstance *instance1, HypeInstance *instance2);
+static bool linked_list_callback_is_same_element(void *element1, void *element2);
+static void linked_list_callback_free_change(void **element);
+
+//
+// Header functions implementation
+//
+
+HpbMembership *hpb_membership_create(uint64_t window_ms)
+{
+    HpbMembership *membership = (HpbMembership *) calloc(1, sizeof(HpbMembership));
+
+    if(membership == NULL) {
+        return NULL;
+    }
+
+    membership->changes = linked_list_create();
+    membership->lost = linked_list_create();
+    membership->window_ms = window_ms;
+    return membership;
+}
+
+int hpb_membership_add_event(HpbMembership *membership, HypeInstance *instance, bool is_resolved, uint64_t now_ms)
+{
+    if(membership == NULL || instance == NULL) {
+        return -1;
+    }
+
+    if(hpb_membership_set(membership->changes, instance, is_resolved, now_ms) == NULL) {
+        return -1;
+    }
+
+    if(membership->first_change_ms == 0) {
+        membership->first_change_ms = now_ms;
+    }
+    membership->last_change_ms = now_ms;
+    membership->n_events++;
+    return 0;
+}
+
+size_t hpb_membership_apply(HpbMembership *membership, uint64_t now_ms, HpbMembershipApplyCallback callback, void *arg)
+{
+    if(membership == NULL || membership->changes->size == 0) {
+        return 0;
+    }
+
+    // Wait for the end of the burst
+    if(now_ms < membership->last_change_ms + membership->window_ms && now_ms < membership->first_change_ms + HPB_MEMBERSHIP_MAX_DELAY_MS) {
+        return 0;
+    }
+
+    // The instances lost long ago are no longer suspected of flapping
+    LinkedListNode *node = membership->lost->head;
+    while(node != NULL)
+    {
+        HpbMembershipChange *lost = (HpbMembershipChange *) node->element;
+        node = node->next;
+
+        if(now_ms >= lost->changed_ms + HPB_MEMBERSHIP_HOLD_DOWN_MS) {
+            linked_list_remove(membership->lost, lost, linked_list_callback_is_same_element, linked_list_callback_free_change);
+        }
+    }
+
+    size_t n_applied = 0;
+    node = membership->changes->head;
+    while(node != NULL)
+    {
+        HpbMembershipChange *change = (HpbMembershipChange *) node->element;
+        node = node->next;
+
+        if(change->is_resolved && hpb_membership_find(membership->lost, change->instance) != NULL)
+        {
+            membership->n_held += (change->is_held) ? 0 : 1;
+            change->is_held = true;
+            continue;
+        }
+
+        if(!change->is_resolved) {
+            hpb_membership_set(membership->lost, change->instance, false, now_ms);
+        }
+
+        callback(change->instance, change->is_resolved, arg);
+        linked_list_remove(membership->changes, change, linked_list_callback_is_same_element, linked_list_callback_free_change);
+        n_applied++;
+    }
+
+    // The changes held back are applied by the next calls, without waiting for a window
+    membership->first_change_ms = (membership->changes->size > 0) ? membership->first_change_ms : 0;
+    membership->n_applies += (n_applied > 0) ? 1 : 0;
+    return n_applied;
+}
+
+void hpb_membership_destroy(HpbMembership **membership)
+{
+    if((*membership) == NULL) {
+        return;
+    }
+
+    linked_list_destroy(&((*membership)->changes), linked_list_callback_free_change);
+    linked_list_destroy(&((*membership)->lost), linked_list_callback_free_change);
+    free(*membership);
+    (*membership) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static HpbMembershipChange *hpb_membership_find(LinkedList *list, HypeInstance *instance)
+{
+    for(LinkedListNode *node = list->head; node != NULL; node = node->next)
+    {
+        HpbMembershipChange *change = (HpbMembershipChange *) node->element;
+        if(hpb_membership_is_same_instance(change->instance, instance)) {
+            return change;
+        }
+    }
+
+    return NULL;
+}
+
+static HpbMembershipChange *hpb_membership_set(LinkedList *list, HypeInstance *instance, bool is_resolved, uint64_t now_ms)
+{
+    HpbMembershipChange *change = hpb_membership_find(list, instance);
+
+    if(change == NULL)
+    {
+        change = (HpbMembershipChange *) malloc(sizeof(HpbMembershipChange));
+        if(change == NULL) {
+            return NULL;
+        }
+
+        change->instance = hype_instance_create(instance->identifier, instance->announcement, instance->is_resolved);
+        change->is_held = false;
+        linked_list_add(list, change);
+    }
+
+    change->is_resolved = is_resolved;
+    change->changed_ms = now_ms;
+    return change;
+}
+
+static bool hpb_membership_is_same_instance(HypeInstance *instance1, HypeInstance *instance2)
+{
+    return instance1->identifier->size == instance2->identifier->size
+           && memcmp(instance1->identifier->data, instance2->identifier->data, instance1->identifier->size) == 0;
+}
+
+static bool linked_list_callback_is_same_element(void *element1, void *element2)
+{
+    return element1 == element2;
+}
+
+static void linked_list_callback_free_change(void **element)
+{
+    HpbMembershipChange *change = (HpbMembershipChange *) (*element);
+    hype_instance_release(change->instance);
+    free(change);
+    (*element) = NULL;
+}
@@ -0,0 +1,429 @@
+
+#include "hype_pub_sub/hpb_metrics.h"
+#include "hype_pub_sub/hpb_protocol.h"
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+//
+// Static functions declaration
+//
+
+static HpbMetricsShard *hpb_metrics_get_shard(HpbMetrics *metrics);
+static void hpb_metrics_add_to_slot(HpbMetrics *metrics, size_t slot, uint64_t value);
+static uint64_t hpb_metrics_get_slot(HpbMetrics *metrics, size_t slot);
+static size_t hpb_metrics_get_histogram_slot(HpbMetricsHistogram histogram);
+static void hpb_metrics_exporter_on_accept(int fd, void *arg);
+static void hpb_metrics_exporter_on_request(int fd, void *arg);
+static void hpb_metrics_exporter_serve(HpbMetricsExporter *exporter, int fd, bool is_http);
+static void hpb_metrics_exporter_close_client(HpbMetricsExporter *exporter, size_t index);
+
+_Static_assert(HPB_METRICS_N_MESSAGE_TYPES == INVALID + 1, "There must be a counter for each MessageType");
+
+static const char *hpb_metrics_counter_names[HPB_METRICS_N_COUNTERS] = {
+    "hpb_messages_in_total", "hpb_bytes_in_total", "hpb_messages_out_total", "hpb_bytes_out_total",
+    "hpb_send_failures_total", "hpb_send_give_ups_total", "hpb_rebalances_total"
+};
+
+static const char *hpb_metrics_counter_helps[HPB_METRICS_N_COUNTERS] = {
+    "Messages received, by type.", "Bytes of the messages received, by type.",
+    "Messages handed to the transport, retries included, by type.", "Bytes of the messages handed to the transport, by type.",
+    "Messages which the transport failed to deliver.", "Messages given up after all their attempts failed.",
+    "Changes of membership which moved services between the clients."
+};
+
+static const char *hpb_metrics_gauge_names[HPB_METRICS_N_GAUGES] = {
+    "hpb_network_clients", "hpb_managed_services", "hpb_subscriptions", "hpb_replicas", "hpb_shards",
+    "hpb_direct_routes", "hpb_retry_queue_entries", "hpb_retry_queue_bytes", "hpb_pending_resolutions",
+    "hpb_pending_membership_changes"
+};
+
+static const char *hpb_metrics_gauge_helps[HPB_METRICS_N_GAUGES] = {
+    "Clients in the network.", "Services managed.", "Services subscribed.",
+    "Replicas of the services managed by other clients.", "Shards of the services managed by other clients.",
+    "Services published directly to their subscribers.", "Messages waiting to be delivered or retried.",
+    "Bytes of the messages waiting to be delivered or retried.", "Instances waiting to be resolved.",
+    "Membership changes waiting to be applied."
+};
+
+static const char *hpb_metrics_histogram_names[HPB_METRICS_N_HISTOGRAMS] = { "hpb_fanout_size" };
+
+static const char *hpb_metrics_histogram_helps[HPB_METRICS_N_HISTOGRAMS] = { "Recipients of each message of the managed services." };
+
+// Each thread takes the next shard the first time it counts, in every registry
+static __thread int hpb_metrics_thread_shard = -1;
+static int hpb_metrics_n_threads = 0;
+
+//
+// Header functions implementation
+//
+
+HpbMetrics *hpb_metrics_create()
+{
+    return (HpbMetrics *) calloc(1, sizeof(HpbMetrics));
+}
+
+void hpb_metrics_add(HpbMetrics *metrics, HpbMetricsCounter counter, uint64_t value)
+{
+    hpb_metrics_add_to_slot(metrics, (size_t) counter * HPB_METRICS_N_MESSAGE_TYPES, value);
+}
+
+void hpb_metrics_add_by_type(HpbMetrics *metrics, HpbMetricsCounter counter, int type, uint64_t value)
+{
+    type = (type >= 0 && type < HPB_METRICS_N_MESSAGE_TYPES) ? type : INVALID;
+    hpb_metrics_add_to_slot(metrics, (size_t) counter * HPB_METRICS_N_MESSAGE_TYPES + (size_t) type, value);
+}
+
+void hpb_metrics_observe(HpbMetrics *metrics, HpbMetricsHistogram histogram, uint64_t value)
+{
+    size_t slot = hpb_metrics_get_histogram_slot(histogram);
+
+    // Bucket i holds the values above 2^(i-1) and up to 2^i, and the values above the last one are only counted
+    int bucket = (value <= 1) ? 0 : 64 - __builtin_clzll(value - 1);
+    if(bucket < HPB_METRICS_HISTOGRAM_N_BUCKETS) {
+        hpb_metrics_add_to_slot(metrics, slot + (size_t) bucket, 1);
+    }
+
+    hpb_metrics_add_to_slot(metrics, slot + HPB_METRICS_HISTOGRAM_N_BUCKETS, value);
+    hpb_metrics_add_to_slot(metrics, slot + HPB_METRICS_HISTOGRAM_N_BUCKETS + 1, 1);
+}
+
+void hpb_metrics_set_gauge(HpbMetrics *metrics, HpbMetricsGauge gauge, int64_t value)
+{
+    __atomic_store_n(&metrics->gauges[gauge], value, __ATOMIC_RELAXED);
+}
+
+uint64_t hpb_metrics_get_counter(HpbMetrics *metrics, HpbMetricsCounter counter, int type)
+{
+    size_t slot = (size_t) counter * HPB_METRICS_N_MESSAGE_TYPES;
+
+    if(type >= 0) {
+        return hpb_metrics_get_slot(metrics, slot + (size_t) type);
+    }
+
+    uint64_t value = 0;
+    for(size_t i = 0; i < HPB_METRICS_N_MESSAGE_TYPES; i++) {
+        value += hpb_metrics_get_slot(metrics, slot + i);
+    }
+    return value;
+}
+
+void hpb_metrics_get_histogram(HpbMetrics *metrics, HpbMetricsHistogram histogram, HpbMetricsHistogramValues *values)
+{
+    size_t slot = hpb_metrics_get_histogram_slot(histogram);
+
+    for(size_t i = 0; i < HPB_METRICS_HISTOGRAM_N_BUCKETS; i++) {
+        values->buckets[i] = hpb_metrics_get_slot(metrics, slot + i);
+    }
+    values->sum = hpb_metrics_get_slot(metrics, slot + HPB_METRICS_HISTOGRAM_N_BUCKETS);
+    values->count = hpb_metrics_get_slot(metrics, slot + HPB_METRICS_HISTOGRAM_N_BUCKETS + 1);
+}
+
+void hpb_metrics_print(FILE *out, HpbMetrics *metrics)
+{
+    fprintf(out, "\n");
+    fprintf(out, "%-16s %12s %14s %12s %14s\n", "Message type", "Received", "Bytes in", "Sent", "Bytes out");
+    for(int type = 0; type < HPB_METRICS_N_MESSAGE_TYPES; type++)
+    {
+        fprintf(out, "%-16s %12llu %14llu %12llu %14llu\n", hpb_protocol_get_message_type_name((MessageType) type),
+                (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_IN, type),
+                (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_BYTES_IN, type),
+                (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_OUT, type),
+                (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_BYTES_OUT, type));
+    }
+    fprintf(out, "%-16s %12llu %14llu %12llu %14llu\n", "total",
+            (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_IN, -1),
+            (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_BYTES_IN, -1),
+            (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_OUT, -1),
+            (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_BYTES_OUT, -1));
+
+    fprintf(out, "\nSend failures: %llu, given up: %llu, rebalances: %llu\n",
+            (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_SEND_FAILURES, -1),
+            (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_SEND_GIVE_UPS, -1),
+            (unsigned long long) hpb_metrics_get_counter(metrics, HPB_METRICS_REBALANCES, -1));
+
+    HpbMetricsHistogramValues fanout;
+    hpb_metrics_get_histogram(metrics, HPB_METRICS_FANOUT_SIZE, &fanout);
+    fprintf(out, "Fan-outs: %llu", (unsigned long long) fanout.count);
+    if(fanout.count > 0)
+    {
+        fprintf(out, ", mean size %.1f, sizes up to", (double) fanout.sum / fanout.count);
+        uint64_t n_bucketed = 0;
+        for(int i = 0; i < HPB_METRICS_HISTOGRAM_N_BUCKETS; i++)
+        {
+            n_bucketed += fanout.buckets[i];
+            if(fanout.buckets[i] > 0) {
+                fprintf(out, " %llu: %llu", 1ULL << i, (unsigned long long) fanout.buckets[i]);
+            }
+        }
+        if(fanout.count > n_bucketed) {
+            fprintf(out, ", larger: %llu", (unsigned long long) (fanout.count - n_bucketed));
+        }
+    }
+    fprintf(out, "\n");
+
+    for(int gauge = 0; gauge < HPB_METRICS_N_GAUGES; gauge++)
+    {
+        // The names are shown without their prefix
+        fprintf(out, "%s%s: %lld", (gauge == 0) ? "" : ", ", hpb_metrics_gauge_names[gauge] + strlen("hpb_"),
+                (long long) __atomic_load_n(&metrics->gauges[gauge], __ATOMIC_RELAXED));
+    }
+    fprintf(out, "\n\n");
+}
+
+void hpb_metrics_print_prometheus(FILE *out, HpbMetrics *metrics)
+{
+    for(int counter = 0; counter < HPB_METRICS_N_COUNTERS; counter++)
+    {
+        fprintf(out, "# HELP %s %s\n", hpb_metrics_counter_names[counter], hpb_metrics_counter_helps[counter]);
+        fprintf(out, "# TYPE %s counter\n", hpb_metrics_counter_names[counter]);
+
+        if(counter >= HPB_METRICS_N_TYPED_COUNTERS)
+        {
+            fprintf(out, "%s %llu\n", hpb_metrics_counter_names[counter],
+                    (unsigned long long) hpb_metrics_get_counter(metrics, (HpbMetricsCounter) counter, -1));
+            continue;
+        }
+
+        for(int type = 0; type < HPB_METRICS_N_MESSAGE_TYPES; type++)
+        {
+            fprintf(out, "%s{type=\"%s\"} %llu\n", hpb_metrics_counter_names[counter], hpb_protocol_get_message_type_name((MessageType) type),
+                    (unsigned long long) hpb_metrics_get_counter(metrics, (HpbMetricsCounter) counter, type));
+        }
+    }
+
+    for(int gauge = 0; gauge < HPB_METRICS_N_GAUGES; gauge++)
+    {
+        fprintf(out, "# HELP %s %s\n", hpb_metrics_gauge_names[gauge], hpb_metrics_gauge_helps[gauge]);
+        fprintf(out, "# TYPE %s gauge\n", hpb_metrics_gauge_names[gauge]);
+        fprintf(out, "%s %lld\n", hpb_metrics_gauge_names[gauge], (long long) __atomic_load_n(&metrics->gauges[gauge], __ATOMIC_RELAXED));
+    }
+
+    for(int histogram = 0; histogram < HPB_METRICS_N_HISTOGRAMS; histogram++)
+    {
+        HpbMetricsHistogramValues values;
+        hpb_metrics_get_histogram(metrics, (HpbMetricsHistogram) histogram, &values);
+        const char *name = hpb_metrics_histogram_names[histogram];
+
+        // The buckets of the format are cumulative
+        fprintf(out, "# HELP %s %s\n", name, hpb_metrics_histogram_helps[histogram]);
+        fprintf(out, "# TYPE %s histogram\n", name);
+        uint64_t cumulative = 0;
+        for(int i = 0; i < HPB_METRICS_HISTOGRAM_N_BUCKETS; i++)
+        {
+            cumulative += values.buckets[i];
+            fprintf(out, "%s_bucket{le=\"%llu\"} %llu\n", name, 1ULL << i, (unsigned long long) cumulative);
+        }
+        fprintf(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long) values.count);
+        fprintf(out, "%s_sum %llu\n", name, (unsigned long long) values.sum);
+        fprintf(out, "%s_count %llu\n", name, (unsigned long long) values.count);
+    }
+}
+
+void hpb_metrics_destroy(HpbMetrics **metrics)
+{
+    if((*metrics) == NULL) {
+        return;
+    }
+
+    for(size_t i = 0; i < HPB_METRICS_MAX_SHARDS; i++) {
+        free((*metrics)->shards[i]);
+    }
+    free(*metrics);
+    (*metrics) = NULL;
+}
+
+HpbMetricsExporter *hpb_metrics_exporter_create(HpbEventLoop *loop, const char *path, HpbMetricsCollectCallback collect)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr.sun_path)) {
+        return NULL;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(fd < 0) {
+        return NULL;
+    }
+
+    // A socket left behind by a previous run is replaced
+    unlink(addr.sun_path);
+    if(bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, HPB_METRICS_MAX_CLIENTS) != 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    HpbMetricsExporter *exporter = (HpbMetricsExporter *) calloc(1, sizeof(HpbMetricsExporter));
+    if(exporter == NULL)
+    {
+        close(fd);
+        unlink(addr.sun_path);
+        return NULL;
+    }
+
+    exporter->loop = loop;
+    exporter->fd = fd;
+    exporter->path = strdup(path);
+    exporter->collect = collect;
+    hpb_event_loop_add_fd(loop, fd, hpb_metrics_exporter_on_accept, exporter);
+    return exporter;
+}
+
+void hpb_metrics_exporter_destroy(HpbMetricsExporter **exporter)
+{
+    if((*exporter) == NULL) {
+        return;
+    }
+
+    while((*exporter)->n_clients > 0) {
+        hpb_metrics_exporter_close_client(*exporter, 0);
+    }
+
+    hpb_event_loop_remove_fd((*exporter)->loop, (*exporter)->fd);
+    close((*exporter)->fd);
+    unlink((*exporter)->path);
+    free((*exporter)->path);
+    free(*exporter);
+    (*exporter) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static HpbMetricsShard *hpb_metrics_get_shard(HpbMetrics *metrics)
+{
+    if(hpb_metrics_thread_shard < 0) {
+        hpb_metrics_thread_shard = __atomic_fetch_add(&hpb_metrics_n_threads, 1, __ATOMIC_RELAXED) % HPB_METRICS_MAX_SHARDS;
+    }
+
+    HpbMetricsShard **slot = &metrics->shards[hpb_metrics_thread_shard];
+    HpbMetricsShard *shard = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if(shard != NULL) {
+        return shard;
+    }
+
+    // Two threads sharing a shard may both allocate it, and the second one uses the shard of the first
+    HpbMetricsShard *created = (HpbMetricsShard *) calloc(1, sizeof(HpbMetricsShard));
+    if(created == NULL) {
+        return NULL;
+    }
+
+    if(!__atomic_compare_exchange_n(slot, &shard, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        free(created);
+        return shard;
+    }
+
+    return created;
+}
+
+static void hpb_metrics_add_to_slot(HpbMetrics *metrics, size_t slot, uint64_t value)
+{
+    HpbMetricsShard *shard = hpb_metrics_get_shard(metrics);
+
+    // The shard is only shared by the threads beyond HPB_METRICS_MAX_SHARDS, so the atomic add is uncontended
+    if(shard != NULL) {
+        __atomic_fetch_add(&shard->slots[slot], value, __ATOMIC_RELAXED);
+    }
+}
+
+static uint64_t hpb_metrics_get_slot(HpbMetrics *metrics, size_t slot)
+{
+    uint64_t value = 0;
+
+    for(size_t i = 0; i < HPB_METRICS_MAX_SHARDS; i++)
+    {
+        HpbMetricsShard *shard = __atomic_load_n(&metrics->shards[i], __ATOMIC_ACQUIRE);
+        if(shard != NULL) {
+            value += __atomic_load_n(&shard->slots[slot], __ATOMIC_RELAXED);
+        }
+    }
+
+    return value;
+}
+
+static size_t hpb_metrics_get_histogram_slot(HpbMetricsHistogram histogram)
+{
+    return HPB_METRICS_N_COUNTERS * HPB_METRICS_N_MESSAGE_TYPES + (size_t) histogram * HPB_METRICS_HISTOGRAM_SLOTS;
+}
+
+static void hpb_metrics_exporter_on_accept(int fd, void *arg)
+{
+    HpbMetricsExporter *exporter = (HpbMetricsExporter *) arg;
+    int client;
+
+    // The connections are only read once the loop reports them readable, and never block on a send
+    while((client = accept(fd, NULL, NULL)) >= 0)
+    {
+        // A client which never sends its request does not hold a connection for long
+        if(exporter->n_clients == HPB_METRICS_MAX_CLIENTS) {
+            hpb_metrics_exporter_close_client(exporter, 0);
+        }
+
+        exporter->clients[exporter->n_clients++] = client;
+        hpb_event_loop_add_fd(exporter->loop, client, hpb_metrics_exporter_on_request, exporter);
+    }
+}
+
+static void hpb_metrics_exporter_on_request(int fd, void *arg)
+{
+    HpbMetricsExporter *exporter = (HpbMetricsExporter *) arg;
+    char request[HPB_METRICS_MAX_REQUEST];
+
+    // The request is not parsed further: any line is answered with the metrics
+    ssize_t n_read = read(fd, request, sizeof(request));
+    if(n_read > 0) {
+        hpb_metrics_exporter_serve(exporter, fd, n_read >= 4 && strncmp(request, "GET ", 4) == 0);
+    }
+
+    for(size_t i = 0; i < exporter->n_clients; i++)
+    {
+        if(exporter->clients[i] == fd)
+        {
+            hpb_metrics_exporter_close_client(exporter, i);
+            break;
+        }
+    }
+}
+
+static void hpb_metrics_exporter_serve(HpbMetricsExporter *exporter, int fd, bool is_http)
+{
+    char *body = NULL;
+    size_t body_size = 0;
+
+    FILE *out = open_memstream(&body, &body_size);
+    if(out == NULL) {
+        return;
+    }
+    hpb_metrics_print_prometheus(out, exporter->collect());
+    fclose(out);
+
+    // The socket buffer holds the whole response, so it is sent without waiting for the client, and a
+    // client which left is not worth a SIGPIPE
+    if(is_http)
+    {
+        char header[128];
+        int header_size = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                   "Content-Length: %zu\r\n\r\n", body_size);
+        send(fd, header, (size_t) header_size, MSG_NOSIGNAL | MSG_DONTWAIT);
+    }
+    send(fd, body, body_size, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+    free(body);
+    exporter->n_scrapes++;
+}
+
+static void hpb_metrics_exporter_close_client(HpbMetricsExporter *exporter, size_t index)
+{
+    int client = exporter->clients[index];
+
+    hpb_event_loop_remove_fd(exporter->loop, client);
+    close(client);
+    memmove(&exporter->clients[index], &exporter->clients[index + 1], (exporter->n_clients - index - 1) * sizeof(int));
+    exporter->n_clients--;
+}
@@ -1,20 +1,224 @@
 
 #include "hype_pub_sub/hpb_network.h"
 
+//
+// Static functions declaration
+//
+
+static HpbClient *hpb_network_get_manager(HpbNetwork *net, HLByte service_key[]);
+static HpbClient *hpb_network_get_closest_client(HpbNetwork *net, HLByte service_key[]);
+static size_t hpb_network_get_ring_position(HpbNetwork *net, HLByte service_key[]);
+static void hpb_network_build_ring(HpbNetwork *net);
+static bool hpb_network_is_own_duplicate(HpbNetwork *net, HpbClient *client);
+static int hpb_network_compare_vnodes(const void *vnode1, const void *vnode2);
+
+//
+// Header functions implementation
+//
+
 HpbNetwork *hpb_network_create(HypeInstance *own_instance)
 {
     HpbNetwork *net = (HpbNetwork*) malloc(sizeof(HpbNetwork));
     net->own_client = hpb_client_create(own_instance);
     net->network_clients = hpb_list_clients_create();
+    net->placement = HPB_PLACEMENT_XOR;
+    net->ring = NULL;
+    net->ring_size = 0;
+    net->is_ring_dirty = true;
     return net;
 }
 
+HpbClient *hpb_network_add_client(HpbNetwork *net, HypeInstance *instance)
+{
+    net->is_ring_dirty = true;
+    return hpb_list_clients_add(net->network_clients, instance);
+}
+
+int hpb_network_remove_client(HpbNetwork *net, HypeInstance *instance)
+{
+    net->is_ring_dirty = true;
+    return hpb_list_clients_remove(net->network_clients, instance);
+}
+
+void hpb_network_set_placement(HpbNetwork *net, HpbPlacement placement)
+{
+    net->placement = placement;
+    net->is_ring_dirty = true;
+}
+
 HypeInstance *hpb_network_get_service_manager_id(HpbNetwork *net, HLByte service_key[])
+{
+    return hpb_network_get_manager(net, service_key)->hype_instance;
+}
+
+size_t hpb_network_get_closest_instances(HpbNetwork *net, HLByte service_key[], HypeInstance *instances[], size_t max_instances)
+{
+    if(max_instances == 0) {
+        return 0;
+    }
+
+    if(net->placement == HPB_PLACEMENT_VNODES)
+    {
+        hpb_network_build_ring(net);
+    }
+
+    // The replicas follow the manager in the ring, skipping the other virtual keys of the devices already taken
+    if(net->placement == HPB_PLACEMENT_VNODES && net->ring_size > 0)
+    {
+        size_t n_instances = 0;
+        size_t position = hpb_network_get_ring_position(net, service_key);
+        for(size_t i = 0; i < net->ring_size && n_instances < max_instances; i++)
+        {
+            HpbClient *client = net->ring[(position + i) % net->ring_size].client;
+
+            bool is_taken = false;
+            for(size_t j = 0; j < n_instances && !is_taken; j++) {
+                is_taken = hpb_client_is_instance_equal(client, instances[j]);
+            }
+            if(!is_taken) {
+                instances[n_instances++] = client->hype_instance;
+            }
+        }
+        return n_instances;
+    }
+
+    // Insertion in a sorted array, since only a few instances are requested
+    HLByte (*distances)[SHA1_BLOCK_SIZE] = malloc(max_instances * SHA1_BLOCK_SIZE);
+    size_t n_instances = 0;
+
+    HpbClient *client = net->own_client;
+    LinkedListNode *node = net->network_clients->head;
+    while(client != NULL)
+    {
+        HLByte *dist = binary_utils_xor(service_key, client->key, SHA1_BLOCK_SIZE);
+
+        size_t position = n_instances;
+        while(position > 0 && binary_utils_get_higher_byte_array(distances[position - 1], dist, SHA1_BLOCK_SIZE) == 1) {
+            position--;
+        }
+
+        if(position < max_instances)
+        {
+            size_t last = (n_instances < max_instances) ? n_instances : max_instances - 1;
+            for(size_t i = last; i > position; i--)
+            {
+                memcpy(distances[i], distances[i - 1], SHA1_BLOCK_SIZE);
+                instances[i] = instances[i - 1];
+            }
+            memcpy(distances[position], dist, SHA1_BLOCK_SIZE);
+            instances[position] = client->hype_instance;
+            if(n_instances < max_instances) {
+                n_instances++;
+            }
+        }
+        free(dist);
+
+        client = (node != NULL) ? (HpbClient *) node->element : NULL;
+        node = (node != NULL) ? node->next : NULL;
+    }
+
+    free(distances);
+    return n_instances;
+}
+
+double hpb_network_get_load_skew(HpbNetwork *net, HpbNetworkLoad loads[], size_t max_loads)
+{
+    size_t n_clients = 0;
+    HpbNetworkLoad *all_loads = (HpbNetworkLoad *) calloc(net->network_clients->size + 1, sizeof(HpbNetworkLoad));
+    unsigned int total_capacity = 0;
+
+    HpbClient *client = net->own_client;
+    LinkedListNode *node = net->network_clients->head;
+    while(client != NULL)
+    {
+        if(client == net->own_client || !hpb_network_is_own_duplicate(net, client))
+        {
+            all_loads[n_clients++].client = client;
+            total_capacity += client->capacity;
+        }
+
+        client = (node != NULL) ? (HpbClient *) node->element : NULL;
+        node = (node != NULL) ? node->next : NULL;
+    }
+
+    // The sample keys are hashes, spread over the key space as the service keys are
+    HLByte sample[sizeof(uint32_t)];
+    HLByte sample_key[SHA1_BLOCK_SIZE];
+    for(uint32_t i = 0; i < HPB_NETWORK_LOAD_SAMPLES; i++)
+    {
+        binary_utils_write_uint32(sample, i);
+        sha1_digest(sample, sizeof(sample), sample_key);
+
+        HpbClient *manager = hpb_network_get_manager(net, sample_key);
+        for(size_t j = 0; j < n_clients; j++)
+        {
+            if(all_loads[j].client == manager)
+            {
+                all_loads[j].n_keys++;
+                break;
+            }
+        }
+    }
+
+    double max_skew = 0;
+    for(size_t i = 0; i < n_clients; i++)
+    {
+        double share = (double) all_loads[i].n_keys / HPB_NETWORK_LOAD_SAMPLES;
+        all_loads[i].skew = share * total_capacity / all_loads[i].client->capacity;
+        max_skew = (all_loads[i].skew > max_skew) ? all_loads[i].skew : max_skew;
+        if(loads != NULL && i < max_loads) {
+            loads[i] = all_loads[i];
+        }
+    }
+
+    free(all_loads);
+    return max_skew;
+}
+
+void hpb_network_update_clients(HpbNetwork *net)
+{
+    // On instance found -> hype_pub_sub_list_clients_add(net->network_client_ids, --- id ---)
+    // On instance lost -> hype_pub_sub_list_clients_remove(net->network_client_ids, --- id ---)
+    return;
+}
+
+void hpb_network_destroy(HpbNetwork **net)
+{
+    if((*net) == NULL) {
+        return;
+    }
+
+    hpb_client_destroy(&((*net)->own_client));
+    hpb_list_clients_destroy(&((*net)->network_clients));
+    free((*net)->ring);
+    free(*net);
+    (*net) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static HpbClient *hpb_network_get_manager(HpbNetwork *net, HLByte service_key[])
+{
+    if(net->placement == HPB_PLACEMENT_XOR) {
+        return hpb_network_get_closest_client(net, service_key);
+    }
+
+    hpb_network_build_ring(net);
+    if(net->ring_size == 0) { // The ring could not be built
+        return hpb_network_get_closest_client(net, service_key);
+    }
+
+    return net->ring[hpb_network_get_ring_position(net, service_key)].client;
+}
+
+static HpbClient *hpb_network_get_closest_client(HpbNetwork *net, HLByte service_key[])
 {
     // Compare the service key with the hash of the Hype clients id and return
     // the id of the closest client. Consider own ID also!!!!
 
-    HypeInstance *manager_instance = net->own_client->hype_instance;
+    HpbClient *manager = net->own_client;
     HLByte *lowest_dist = binary_utils_xor(service_key, net->own_client->key, SHA1_BLOCK_SIZE);
 
     LinkedListIterator *it = linked_list_iterator_create(net->network_clients);
@@ -31,7 +235,7 @@ HypeInstance *hpb_network_get_service_manager_id(HpbNetwork *net, HLByte service
         if(binary_utils_get_higher_byte_array(lowest_dist, dist, SHA1_BLOCK_SIZE) == 1)
         {
             memcpy(lowest_dist, dist, SHA1_BLOCK_SIZE);
-            manager_instance = client->hype_instance;
+            manager = client;
         }
         free(dist);
 
@@ -41,24 +245,86 @@ HypeInstance *hpb_network_get_service_manager_id(HpbNetwork *net, HLByte service
 
     free(lowest_dist);
 
-    return manager_instance;
+    return manager;
 }
 
-void hpb_network_update_clients(HpbNetwork *net)
+static size_t hpb_network_get_ring_position(HpbNetwork *net, HLByte service_key[])
 {
-    // On instance found -> hype_pub_sub_list_clients_add(net->network_client_ids, --- id ---)
-    // On instance lost -> hype_pub_sub_list_clients_remove(net->network_client_ids, --- id ---)
-    return;
+    // First virtual key at or after the service key, wrapping around the ring
+    size_t low = 0;
+    size_t high = net->ring_size;
+    while(low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if(memcmp(net->ring[middle].key, service_key, SHA1_BLOCK_SIZE) < 0) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    return (low == net->ring_size) ? 0 : low;
 }
 
-void hpb_network_destroy(HpbNetwork **net)
+static void hpb_network_build_ring(HpbNetwork *net)
 {
-    if((*net) == NULL) {
+    if(!net->is_ring_dirty) {
         return;
     }
 
-    hpb_client_destroy(&((*net)->own_client));
-    hpb_list_clients_destroy(&((*net)->network_clients));
-    free(*net);
-    (*net) = NULL;
+    size_t ring_size = 0;
+    HpbClient *client = net->own_client;
+    LinkedListNode *node = net->network_clients->head;
+    while(client != NULL)
+    {
+        if(client == net->own_client || !hpb_network_is_own_duplicate(net, client)) {
+            ring_size += client->capacity * HPB_NETWORK_VNODES_PER_CAPACITY;
+        }
+
+        client = (node != NULL) ? (HpbClient *) node->element : NULL;
+        node = (node != NULL) ? node->next : NULL;
+    }
+
+    free(net->ring);
+    net->ring_size = 0;
+    net->ring = (HpbNetworkVnode *) malloc(ring_size * sizeof(HpbNetworkVnode));
+    if(net->ring == NULL) {
+        return;
+    }
+
+    // Each virtual key is the hash of the key of the device followed by the index of the virtual key
+    HLByte seed[SHA1_BLOCK_SIZE + sizeof(uint32_t)];
+    client = net->own_client;
+    node = net->network_clients->head;
+    while(client != NULL)
+    {
+        if(client == net->own_client || !hpb_network_is_own_duplicate(net, client))
+        {
+            memcpy(seed, client->key, SHA1_BLOCK_SIZE);
+            for(uint32_t i = 0; i < client->capacity * HPB_NETWORK_VNODES_PER_CAPACITY; i++)
+            {
+                binary_utils_write_uint32(seed + SHA1_BLOCK_SIZE, i);
+                sha1_digest(seed, sizeof(seed), net->ring[net->ring_size].key);
+                net->ring[net->ring_size].client = client;
+                net->ring_size++;
+            }
+        }
+
+        client = (node != NULL) ? (HpbClient *) node->element : NULL;
+        node = (node != NULL) ? node->next : NULL;
+    }
+
+    qsort(net->ring, net->ring_size, sizeof(HpbNetworkVnode), hpb_network_compare_vnodes);
+    net->is_ring_dirty = false;
+}
+
+static bool hpb_network_is_own_duplicate(HpbNetwork *net, HpbClient *client)
+{
+    return hpb_client_is_instance_equal(client, net->own_client->hype_instance);
+}
+
+static int hpb_network_compare_vnodes(const void *vnode1, const void *vnode2)
+{
+    return memcmp(((const HpbNetworkVnode *) vnode1)->key, ((const HpbNetworkVnode *) vnode2)->key, SHA1_BLOCK_SIZE);
 }
@@ -6,11 +6,21 @@
 //
 
 static size_t hpb_protocol_build_packet(HLByte ** packet,int n_fields, ...);
+static size_t hpb_protocol_build_publish_packet(HLByte type, HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet);
+static size_t hpb_protocol_build_sequenced_packet(HLByte type, HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet);
+static void hpb_protocol_write_origin(HLByte *origin_bytes, HpbPublishOrigin origin);
+static HpbPublishOrigin hpb_protocol_read_origin(HLByte *origin_bytes);
+static size_t hpb_protocol_build_services_packet(HLByte type, HpbServiceManager *services[], size_t n_services, HLByte ** packet);
 static int hpb_protocol_receive_subscribe_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length);
 static int hpb_protocol_receive_unsubscribe_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length);
 static int hpb_protocol_receive_publish_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length);
 static int hpb_protocol_receive_info_msg(HLByte *msg, size_t msg_length);
-static MessageType hpb_protocol_get_message_type(HLByte *msg);
+static int hpb_protocol_receive_nack_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length);
+static int hpb_protocol_receive_handover_msg(HLByte *msg, size_t msg_length);
+static int hpb_protocol_receive_heartbeat_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length);
+static int hpb_protocol_receive_relay_msg(HLByte *msg, size_t msg_length);
+static int hpb_protocol_receive_direct_info_msg(HLByte *msg, size_t msg_length);
+static int hpb_protocol_receive_subscriber_list_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length);
 
 //
 // Header functions implementation
@@ -25,6 +35,30 @@ size_t hpb_protocol_build_subscribe_msg(HLByte service_key[], HLByte ** packet)
     return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field);
 }
 
+size_t hpb_protocol_build_pattern_subscribe_msg(HLByte service_key[], char *pattern, HLByte ** packet)
+{
+    HLByte type = (HLByte) (SUBSCRIBE_SERVICE | HPB_PROTOCOL_FLAG_WILDCARD);
+    HpbProtocolPacketField msg_type_field = {&type, MESSAGE_TYPE_BYTE_SIZE };
+    HpbProtocolPacketField ser_key_field = {service_key, SHA1_BLOCK_SIZE };
+    HpbProtocolPacketField pattern_field = {(HLByte *) pattern, strlen(pattern) };
+    size_t n_fields = 3;
+    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field, &pattern_field);
+}
+
+size_t hpb_protocol_build_filtered_subscribe_msg(HLByte service_key[], char *pattern, char *filter, HLByte ** packet)
+{
+    HLByte type = (HLByte) (SUBSCRIBE_SERVICE | HPB_PROTOCOL_FLAG_FILTER | ((pattern != NULL) ? HPB_PROTOCOL_FLAG_WILDCARD : 0));
+    size_t filter_length = strlen(filter);
+    HLByte filter_length_bytes[HPB_PROTOCOL_FILTER_LENGTH_SIZE] = { (HLByte) ((filter_length >> 8) & 0xFF), (HLByte) (filter_length & 0xFF) };
+    HpbProtocolPacketField msg_type_field = {&type, MESSAGE_TYPE_BYTE_SIZE };
+    HpbProtocolPacketField ser_key_field = {service_key, SHA1_BLOCK_SIZE };
+    HpbProtocolPacketField filter_length_field = {filter_length_bytes, HPB_PROTOCOL_FILTER_LENGTH_SIZE };
+    HpbProtocolPacketField filter_field = {(HLByte *) filter, filter_length };
+    HpbProtocolPacketField pattern_field = {(HLByte *) pattern, (pattern != NULL) ? strlen(pattern) : 0 };
+    size_t n_fields = 5;
+    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field, &filter_length_field, &filter_field, &pattern_field);
+}
+
 size_t hpb_protocol_build_unsubscribe_msg(HLByte service_key[], HLByte ** packet)
 {
     HLByte type = (HLByte) UNSUBSCRIBE_SERVICE;
@@ -34,24 +68,180 @@ size_t hpb_protocol_build_unsubscribe_msg(HLByte service_key[], HLByte ** packet
     return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field);
 }
 
-size_t hpb_protocol_build_publish_msg(HLByte service_key[], char *msg, size_t msg_length, HLByte ** packet)
+size_t hpb_protocol_build_publish_msg(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet)
+{
+    return hpb_protocol_build_publish_packet((HLByte) PUBLISH, service_key, origin, msg, msg_length, packet);
+}
+
+size_t hpb_protocol_build_retained_publish_msg(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet)
+{
+    return hpb_protocol_build_publish_packet((HLByte) (PUBLISH | HPB_PROTOCOL_FLAG_RETAIN), service_key, origin, msg, msg_length, packet);
+}
+
+size_t hpb_protocol_build_no_echo_publish_msg(HLByte service_key[], HpbPublishOrigin origin, bool is_retained, char *msg, size_t msg_length, HLByte ** packet)
+{
+    HLByte type = (HLByte) (PUBLISH | HPB_PROTOCOL_FLAG_NO_ECHO | ((is_retained) ? HPB_PROTOCOL_FLAG_RETAIN : 0));
+    return hpb_protocol_build_publish_packet(type, service_key, origin, msg, msg_length, packet);
+}
+
+size_t hpb_protocol_build_pattern_publish_msg(HLByte rendezvous_key[], HpbPublishOrigin origin, char *payload, size_t payload_length, HLByte ** packet)
+{
+    return hpb_protocol_build_publish_packet((HLByte) (PUBLISH | HPB_PROTOCOL_FLAG_WILDCARD), rendezvous_key, origin, payload, payload_length, packet);
+}
+
+size_t hpb_protocol_build_info_msg(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet)
+{
+    return hpb_protocol_build_sequenced_packet((HLByte) INFO, service_key, seq, origin, msg, msg_length, packet);
+}
+
+size_t hpb_protocol_build_direct_info_msg(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet)
+{
+    return hpb_protocol_build_publish_packet((HLByte) (INFO | HPB_PROTOCOL_FLAG_DIRECT), service_key, origin, msg, msg_length, packet);
+}
+
+size_t hpb_protocol_build_subscriber_list_req(HLByte service_key[], HLByte ** packet)
 {
-    HLByte type = (HLByte) PUBLISH;
+    HLByte type = (HLByte) SUBSCRIBER_LIST;
     HpbProtocolPacketField msg_type_field = {&type, MESSAGE_TYPE_BYTE_SIZE };
     HpbProtocolPacketField ser_key_field = {service_key, SHA1_BLOCK_SIZE };
-    HpbProtocolPacketField msg_field = {(HLByte *) msg, msg_length };
-    size_t n_fields = 3;
-    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field, &msg_field);
+    size_t n_fields = 2;
+    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field);
+}
+
+size_t hpb_protocol_build_subscriber_list_msg(HLByte service_key[], uint32_t version, HpbClientsList *subscribers, HLByte ** packet)
+{
+    // The size of the list is variable, so the packet is written directly instead of by fields
+    size_t p_size = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_SUBSCRIBER_LIST_VERSION_SIZE + HPB_PROTOCOL_SUBSCRIBER_LIST_COUNT_SIZE;
+    for(LinkedListNode *node = (subscribers != NULL) ? subscribers->head : NULL; node != NULL; node = node->next) {
+        p_size += HPB_PROTOCOL_HANDOVER_ID_SIZE + ((HpbClient *) node->element)->hype_instance->identifier->size;
+    }
+
+    *packet = (HLByte*) malloc(p_size * sizeof(HLByte));
+    HLByte *p = *packet;
+    p[0] = (HLByte) SUBSCRIBER_LIST;
+    p += MESSAGE_TYPE_BYTE_SIZE;
+    memcpy(p, service_key, SHA1_BLOCK_SIZE);
+    p += SHA1_BLOCK_SIZE;
+    binary_utils_write_uint32(p, version);
+    p += HPB_PROTOCOL_SUBSCRIBER_LIST_VERSION_SIZE;
+    binary_utils_write_uint32(p, (subscribers != NULL) ? (uint32_t) subscribers->size : HPB_PROTOCOL_SUBSCRIBER_LIST_REFUSED);
+    p += HPB_PROTOCOL_SUBSCRIBER_LIST_COUNT_SIZE;
+
+    for(LinkedListNode *node = (subscribers != NULL) ? subscribers->head : NULL; node != NULL; node = node->next)
+    {
+        HypeBuffer *identifier = ((HpbClient *) node->element)->hype_instance->identifier;
+        p[0] = (HLByte) identifier->size;
+        p += HPB_PROTOCOL_HANDOVER_ID_SIZE;
+        memcpy(p, identifier->data, identifier->size);
+        p += identifier->size;
+    }
+
+    return p_size;
 }
 
-size_t hpb_protocol_build_info_msg(HLByte service_key[], char *msg, size_t msg_length, HLByte ** packet)
+size_t hpb_protocol_build_nack_msg(HLByte service_key[], HpbSeqRange ranges[], size_t n_ranges, HLByte ** packet)
 {
-    HLByte type = (HLByte) INFO;
+    if(n_ranges > HPB_PROTOCOL_NACK_MAX_RANGES) {
+        n_ranges = HPB_PROTOCOL_NACK_MAX_RANGES;
+    }
+
+    HLByte type = (HLByte) NACK;
+    HLByte count = (HLByte) n_ranges;
+    HLByte ranges_bytes[HPB_PROTOCOL_NACK_MAX_RANGES * HPB_PROTOCOL_NACK_RANGE_SIZE];
+    for(size_t i = 0; i < n_ranges; i++)
+    {
+        binary_utils_write_uint32(ranges_bytes + i * HPB_PROTOCOL_NACK_RANGE_SIZE, ranges[i].first);
+        binary_utils_write_uint32(ranges_bytes + i * HPB_PROTOCOL_NACK_RANGE_SIZE + HPB_PROTOCOL_SEQ_SIZE, ranges[i].last);
+    }
+
     HpbProtocolPacketField msg_type_field = {&type, MESSAGE_TYPE_BYTE_SIZE };
     HpbProtocolPacketField ser_key_field = {service_key, SHA1_BLOCK_SIZE };
-    HpbProtocolPacketField msg_field = {(HLByte *) msg, msg_length };
+    HpbProtocolPacketField count_field = {&count, HPB_PROTOCOL_NACK_COUNT_SIZE };
+    HpbProtocolPacketField ranges_field = {ranges_bytes, n_ranges * HPB_PROTOCOL_NACK_RANGE_SIZE };
+    size_t n_fields = 4;
+    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field, &count_field, &ranges_field);
+}
+
+size_t hpb_protocol_build_handover_msg(HpbServiceManager *services[], size_t n_services, HLByte ** packet)
+{
+    return hpb_protocol_build_services_packet((HLByte) HANDOVER, services, n_services, packet);
+}
+
+size_t hpb_protocol_build_replica_msg(HpbServiceManager *services[], size_t n_services, HLByte ** packet)
+{
+    return hpb_protocol_build_services_packet((HLByte) (HANDOVER | HPB_PROTOCOL_FLAG_REPLICA), services, n_services, packet);
+}
+
+size_t hpb_protocol_build_shard_msg(HpbServiceManager *services[], size_t n_services, HLByte ** packet)
+{
+    return hpb_protocol_build_services_packet((HLByte) SHARD, services, n_services, packet);
+}
+
+size_t hpb_protocol_build_shard_publish_msg(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet)
+{
+    return hpb_protocol_build_sequenced_packet((HLByte) SHARD_PUBLISH, service_key, seq, origin, msg, msg_length, packet);
+}
+
+size_t hpb_protocol_build_relay_msg(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, uint8_t branching,
+                                    HpbRelayMember children[], size_t n_children, char *msg, size_t msg_length, HLByte ** packet)
+{
+    // The size of the subtree is variable, so the packet is written directly instead of by fields
+    size_t p_size = HPB_PROTOCOL_RELAY_HEADER_SIZE + msg_length;
+    for(size_t i = 0; i < n_children; i++) {
+        p_size += HPB_PROTOCOL_HANDOVER_ID_SIZE + children[i].instance->identifier->size;
+    }
+
+    *packet = (HLByte*) malloc(p_size * sizeof(HLByte));
+    HLByte *p = *packet;
+    p[0] = (HLByte) RELAY;
+    p += MESSAGE_TYPE_BYTE_SIZE;
+    memcpy(p, service_key, SHA1_BLOCK_SIZE);
+    p += SHA1_BLOCK_SIZE;
+    binary_utils_write_uint32(p, seq);
+    p += HPB_PROTOCOL_SEQ_SIZE;
+    hpb_protocol_write_origin(p, origin);
+    p += HPB_PROTOCOL_ORIGIN_SIZE;
+    p[0] = branching;
+    p += HPB_PROTOCOL_RELAY_BRANCHING_SIZE;
+    binary_utils_write_uint32(p, (uint32_t) n_children);
+    p += HPB_PROTOCOL_RELAY_COUNT_SIZE;
+
+    for(size_t i = 0; i < n_children; i++)
+    {
+        HypeBuffer *identifier = children[i].instance->identifier;
+        p[0] = (HLByte) identifier->size;
+        p += HPB_PROTOCOL_HANDOVER_ID_SIZE;
+        memcpy(p, identifier->data, identifier->size);
+        p += identifier->size;
+    }
+
+    memcpy(p, msg, msg_length);
+    return p_size;
+}
+
+size_t hpb_protocol_build_heartbeat_msg(HLByte *service_keys, HLByte *key_flags, size_t n_services, HLByte ** packet)
+{
+    HLByte type = (HLByte) HEARTBEAT;
+    HLByte count_bytes[HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE];
+    binary_utils_write_uint32(count_bytes, (uint32_t) n_services);
+    HpbProtocolPacketField msg_type_field = {&type, MESSAGE_TYPE_BYTE_SIZE };
+    HpbProtocolPacketField count_field = {count_bytes, HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE };
+    HpbProtocolPacketField keys_field = {service_keys, n_services * SHA1_BLOCK_SIZE };
+    HpbProtocolPacketField flags_field = {key_flags, n_services };
+    size_t n_fields = (key_flags != NULL) ? 4 : 3;
+    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &count_field, &keys_field, &flags_field);
+}
+
+size_t hpb_protocol_build_unknown_heartbeat_msg(HLByte *service_keys, size_t n_services, HLByte ** packet)
+{
+    HLByte type = (HLByte) (HEARTBEAT | HPB_PROTOCOL_FLAG_UNKNOWN);
+    HLByte count_bytes[HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE];
+    binary_utils_write_uint32(count_bytes, (uint32_t) n_services);
+    HpbProtocolPacketField msg_type_field = {&type, MESSAGE_TYPE_BYTE_SIZE };
+    HpbProtocolPacketField count_field = {count_bytes, HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE };
+    HpbProtocolPacketField keys_field = {service_keys, n_services * SHA1_BLOCK_SIZE };
     size_t n_fields = 3;
-    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field, &msg_field);
+    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &count_field, &keys_field);
 }
 
 int hpb_protocol_receive_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length)
@@ -61,6 +251,8 @@ int hpb_protocol_receive_msg(HypeInstance * instance_origin, HLByte *msg, size_t
     }
 
     int m_type = hpb_protocol_get_message_type(msg);
+    hpb_metrics_add_by_type(hpb_get()->metrics, HPB_METRICS_MESSAGES_IN, m_type, 1);
+    hpb_metrics_add_by_type(hpb_get()->metrics, HPB_METRICS_BYTES_IN, m_type, msg_length);
 
     switch (m_type)
     {
@@ -74,7 +266,29 @@ int hpb_protocol_receive_msg(HypeInstance * instance_origin, HLByte *msg, size_t
             hpb_protocol_receive_publish_msg(instance_origin, msg, msg_length);
             break;
         case INFO:
-            hpb_protocol_receive_info_msg(msg, msg_length);
+        case SHARD_PUBLISH:
+            if(msg[0] & HPB_PROTOCOL_FLAG_DIRECT) {
+                hpb_protocol_receive_direct_info_msg(msg, msg_length);
+            }
+            else {
+                hpb_protocol_receive_info_msg(msg, msg_length);
+            }
+            break;
+        case NACK:
+            hpb_protocol_receive_nack_msg(instance_origin, msg, msg_length);
+            break;
+        case HANDOVER:
+        case SHARD:
+            hpb_protocol_receive_handover_msg(msg, msg_length);
+            break;
+        case HEARTBEAT:
+            hpb_protocol_receive_heartbeat_msg(instance_origin, msg, msg_length);
+            break;
+        case RELAY:
+            hpb_protocol_receive_relay_msg(msg, msg_length);
+            break;
+        case SUBSCRIBER_LIST:
+            hpb_protocol_receive_subscriber_list_msg(instance_origin, msg, msg_length);
             break;
         case INVALID:
             return -1; // Message type not recognized. Discard
@@ -83,6 +297,46 @@ int hpb_protocol_receive_msg(HypeInstance * instance_origin, HLByte *msg, size_t
     return m_type;
 }
 
+MessageType hpb_protocol_get_message_type(HLByte *msg)
+{
+    HLByte type = msg[0] & HPB_PROTOCOL_MESSAGE_TYPE_MASK;
+
+    if(type == (HLByte) SUBSCRIBE_SERVICE)
+        return SUBSCRIBE_SERVICE;
+    else if(type == (HLByte) UNSUBSCRIBE_SERVICE)
+        return UNSUBSCRIBE_SERVICE;
+    else if(type == (HLByte) PUBLISH)
+        return PUBLISH;
+    else if(type == (HLByte) INFO)
+        return INFO;
+    else if(type == (HLByte) NACK)
+        return NACK;
+    else if(type == (HLByte) HANDOVER)
+        return HANDOVER;
+    else if(type == (HLByte) HEARTBEAT)
+        return HEARTBEAT;
+    else if(type == (HLByte) SHARD)
+        return SHARD;
+    else if(type == (HLByte) SHARD_PUBLISH)
+        return SHARD_PUBLISH;
+    else if(type == (HLByte) RELAY)
+        return RELAY;
+    else if(type == (HLByte) SUBSCRIBER_LIST)
+        return SUBSCRIBER_LIST;
+    else
+        return INVALID; // This should never happen
+}
+
+const char *hpb_protocol_get_message_type_name(MessageType type)
+{
+    static const char *names[INVALID + 1] = {
+        "subscribe", "unsubscribe", "publish", "info", "nack", "handover", "heartbeat", "shard", "shard_publish",
+        "relay", "subscriber_list", "invalid"
+    };
+
+    return (type >= SUBSCRIBE_SERVICE && type <= INVALID) ? names[type] : names[INVALID];
+}
+
 //
 // Static functions implementation
 //
@@ -121,32 +375,157 @@ static size_t hpb_protocol_build_packet(HLByte ** packet,int n_fields, ...)
     return p_size;
 }
 
-static MessageType hpb_protocol_get_message_type(HLByte *msg)
+static size_t hpb_protocol_build_publish_packet(HLByte type, HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet)
 {
-    if(msg[0] == (HLByte) SUBSCRIBE_SERVICE)
-        return SUBSCRIBE_SERVICE;
-    else if(msg[0] == (HLByte) UNSUBSCRIBE_SERVICE)
-        return UNSUBSCRIBE_SERVICE;
-    else if(msg[0] == (HLByte) PUBLISH)
-        return PUBLISH;
-    else if(msg[0] == (HLByte) INFO)
-        return INFO;
-    else
-        return INVALID; // This should never happen
+    HLByte origin_bytes[HPB_PROTOCOL_ORIGIN_SIZE];
+    hpb_protocol_write_origin(origin_bytes, origin);
+    HpbProtocolPacketField msg_type_field = {&type, MESSAGE_TYPE_BYTE_SIZE };
+    HpbProtocolPacketField ser_key_field = {service_key, SHA1_BLOCK_SIZE };
+    HpbProtocolPacketField origin_field = {origin_bytes, HPB_PROTOCOL_ORIGIN_SIZE };
+    HpbProtocolPacketField msg_field = {(HLByte *) msg, msg_length };
+    size_t n_fields = 4;
+    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field, &origin_field, &msg_field);
+}
+
+static size_t hpb_protocol_build_sequenced_packet(HLByte type, HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HLByte ** packet)
+{
+    HLByte seq_bytes[HPB_PROTOCOL_SEQ_SIZE];
+    binary_utils_write_uint32(seq_bytes, seq);
+    HLByte origin_bytes[HPB_PROTOCOL_ORIGIN_SIZE];
+    hpb_protocol_write_origin(origin_bytes, origin);
+    HpbProtocolPacketField msg_type_field = {&type, MESSAGE_TYPE_BYTE_SIZE };
+    HpbProtocolPacketField ser_key_field = {service_key, SHA1_BLOCK_SIZE };
+    HpbProtocolPacketField seq_field = {seq_bytes, HPB_PROTOCOL_SEQ_SIZE };
+    HpbProtocolPacketField origin_field = {origin_bytes, HPB_PROTOCOL_ORIGIN_SIZE };
+    HpbProtocolPacketField msg_field = {(HLByte *) msg, msg_length };
+    size_t n_fields = 5;
+    return hpb_protocol_build_packet(packet,n_fields, &msg_type_field, &ser_key_field, &seq_field, &origin_field, &msg_field);
+}
+
+static void hpb_protocol_write_origin(HLByte *origin_bytes, HpbPublishOrigin origin)
+{
+    binary_utils_write_uint32(origin_bytes, origin.publisher_tag);
+    binary_utils_write_uint32(origin_bytes + HPB_PROTOCOL_SEQ_SIZE, origin.publisher_seq);
+}
+
+static HpbPublishOrigin hpb_protocol_read_origin(HLByte *origin_bytes)
+{
+    HpbPublishOrigin origin;
+    origin.publisher_tag = binary_utils_read_uint32(origin_bytes);
+    origin.publisher_seq = binary_utils_read_uint32(origin_bytes + HPB_PROTOCOL_SEQ_SIZE);
+    return origin;
+}
+
+static size_t hpb_protocol_build_services_packet(HLByte type, HpbServiceManager *services[], size_t n_services, HLByte ** packet)
+{
+    // The size of the services is variable, so the packet is written directly instead of by fields
+    size_t p_size = MESSAGE_TYPE_BYTE_SIZE + HPB_PROTOCOL_HANDOVER_COUNT_SIZE;
+    for(size_t i = 0; i < n_services; i++)
+    {
+        p_size += HPB_PROTOCOL_HANDOVER_SERVICE_HEADER_SIZE + services[i]->retained_msg_length;
+        p_size += (services[i]->pattern != NULL) ? strlen(services[i]->pattern) : 0;
+        for(LinkedListNode *node = services[i]->subscribers->head; node != NULL; node = node->next) {
+            p_size += HPB_PROTOCOL_HANDOVER_ID_SIZE + ((HpbClient *) node->element)->hype_instance->identifier->size;
+        }
+    }
+
+    *packet = (HLByte*) malloc(p_size * sizeof(HLByte));
+    HLByte *p = *packet;
+    p[0] = type;
+    p += MESSAGE_TYPE_BYTE_SIZE;
+    binary_utils_write_uint32(p, (uint32_t) n_services);
+    p += HPB_PROTOCOL_HANDOVER_COUNT_SIZE;
+
+    for(size_t i = 0; i < n_services; i++)
+    {
+        memcpy(p, services[i]->service_key, SHA1_BLOCK_SIZE);
+        p += SHA1_BLOCK_SIZE;
+        binary_utils_write_uint32(p, services[i]->next_seq);
+        p += HPB_PROTOCOL_SEQ_SIZE;
+        hpb_protocol_write_origin(p, services[i]->retained_origin);
+        p += HPB_PROTOCOL_ORIGIN_SIZE;
+        binary_utils_write_uint32(p, (uint32_t) services[i]->retained_msg_length);
+        p += HPB_PROTOCOL_HANDOVER_LENGTH_SIZE;
+        size_t pattern_length = (services[i]->pattern != NULL) ? strlen(services[i]->pattern) : 0;
+        p[0] = (HLByte) ((pattern_length >> 8) & 0xFF);
+        p[1] = (HLByte) (pattern_length & 0xFF);
+        p += HPB_PROTOCOL_PATTERN_LENGTH_SIZE;
+        if(services[i]->retained_msg_length > 0) {
+            memcpy(p, services[i]->retained_msg, services[i]->retained_msg_length);
+        }
+        p += services[i]->retained_msg_length;
+        if(pattern_length > 0) {
+            memcpy(p, services[i]->pattern, pattern_length);
+        }
+        p += pattern_length;
+        binary_utils_write_uint32(p, (uint32_t) services[i]->subscribers->size);
+        p += HPB_PROTOCOL_HANDOVER_COUNT_SIZE;
+
+        for(LinkedListNode *node = services[i]->subscribers->head; node != NULL; node = node->next)
+        {
+            HypeBuffer *identifier = ((HpbClient *) node->element)->hype_instance->identifier;
+            p[0] = (HLByte) identifier->size;
+            p += HPB_PROTOCOL_HANDOVER_ID_SIZE;
+            memcpy(p, identifier->data, identifier->size);
+            p += identifier->size;
+        }
+    }
+
+    return p_size;
 }
 
 static int hpb_protocol_receive_subscribe_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length)
 {
-    if(msg_length != (MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE)) {
+    size_t offset = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE;
+    if(msg_length < offset) {
         return -1; // Invalid lenght for a subscribe message
     }
 
-    HLByte *service_key = (HLByte *) malloc(SHA1_BLOCK_SIZE * sizeof(char));
-    memcpy(service_key, msg+MESSAGE_TYPE_BYTE_SIZE, SHA1_BLOCK_SIZE);
-    hpb_process_subscribe_req(service_key, instance_origin);
+    char *filter = NULL;
+    if(msg[0] & HPB_PROTOCOL_FLAG_FILTER)
+    {
+        if(msg_length - offset < HPB_PROTOCOL_FILTER_LENGTH_SIZE) {
+            return -1;
+        }
+        size_t filter_length = (((size_t) msg[offset]) << 8) | ((size_t) msg[offset + 1]);
+        offset += HPB_PROTOCOL_FILTER_LENGTH_SIZE;
+        if(filter_length == 0 || msg_length - offset < filter_length) {
+            return -1; // Truncated filter
+        }
+
+        filter = (char *) malloc((filter_length + 1) * sizeof(char));
+        memcpy(filter, msg + offset, filter_length);
+        filter[filter_length] = '\0';
+        offset += filter_length;
+    }
 
-    free(service_key);
-    return 0;
+    HLByte *service_key = msg + MESSAGE_TYPE_BYTE_SIZE;
+    int result = 0;
+    if((msg[0] & HPB_PROTOCOL_FLAG_WILDCARD) && msg_length > offset)
+    {
+        size_t pattern_length = msg_length - offset;
+        char *pattern = (char *) malloc((pattern_length + 1) * sizeof(char));
+        memcpy(pattern, msg + offset, pattern_length);
+        pattern[pattern_length] = '\0';
+        result = hpb_process_pattern_subscribe_req(service_key, pattern, instance_origin);
+        free(pattern);
+    }
+    else if(msg_length != offset)
+    {
+        free(filter);
+        return -1; // Invalid lenght for a subscribe message
+    }
+    else {
+        hpb_process_subscribe_req(service_key, instance_origin);
+    }
+
+    // Every subscribe replaces the filter of the subscriber, so that subscribing without a filter clears it
+    if(result == 0) {
+        hpb_process_filter_req(service_key, filter, instance_origin);
+    }
+
+    free(filter);
+    return result;
 }
 
 static int hpb_protocol_receive_unsubscribe_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length)
@@ -165,16 +544,30 @@ static int hpb_protocol_receive_unsubscribe_msg(HypeInstance * instance_origin,
 
 static int hpb_protocol_receive_publish_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length)
 {
-    if(msg_length <= (MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE)) {
+    size_t header_size = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_ORIGIN_SIZE;
+    if(msg_length <= header_size) {
         return -1; // Invalid lenght for a publish message
     }
 
     HLByte *service_key = (HLByte *) malloc(SHA1_BLOCK_SIZE * sizeof(char));
     memcpy(service_key, msg+MESSAGE_TYPE_BYTE_SIZE, SHA1_BLOCK_SIZE);
-    size_t msg_content_size = msg_length - MESSAGE_TYPE_BYTE_SIZE - SHA1_BLOCK_SIZE;
+    HpbPublishOrigin origin = hpb_protocol_read_origin(msg + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE);
+    size_t msg_content_size = msg_length - header_size;
     char *msg_content = (char *) malloc(msg_content_size* sizeof(char));
-    memcpy(msg_content, (msg + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE), msg_content_size);
-    hpb_process_publish_req(service_key, msg_content, msg_content_size);
+    memcpy(msg_content, (msg + header_size), msg_content_size);
+
+    if(msg[0] & HPB_PROTOCOL_FLAG_WILDCARD) {
+        hpb_process_pattern_publish_req(origin, msg_content, msg_content_size);
+    }
+    else if(msg[0] & HPB_PROTOCOL_FLAG_NO_ECHO) {
+        hpb_process_no_echo_publish_req(service_key, origin, msg_content, msg_content_size, (msg[0] & HPB_PROTOCOL_FLAG_RETAIN) != 0, instance_origin);
+    }
+    else if(msg[0] & HPB_PROTOCOL_FLAG_RETAIN) {
+        hpb_process_retained_publish_req(service_key, origin, msg_content, msg_content_size);
+    }
+    else {
+        hpb_process_publish_req(service_key, origin, msg_content, msg_content_size);
+    }
 
     free(service_key);
     free(msg_content);
@@ -183,19 +576,278 @@ static int hpb_protocol_receive_publish_msg(HypeInstance * instance_origin, HLBy
 
 static int hpb_protocol_receive_info_msg(HLByte *msg, size_t msg_length)
 {
-    if(msg_length <= (MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE)) {
+    size_t header_size = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_SEQ_SIZE + HPB_PROTOCOL_ORIGIN_SIZE;
+    if(msg_length <= header_size) {
         return -1; // Invalid lenght for a info message
     }
 
     HLByte *service_key = (HLByte *) malloc(SHA1_BLOCK_SIZE * sizeof(char));
     memcpy(service_key, msg+MESSAGE_TYPE_BYTE_SIZE, SHA1_BLOCK_SIZE);
-    size_t msg_content_size = msg_length - MESSAGE_TYPE_BYTE_SIZE - SHA1_BLOCK_SIZE + 1; // +1 to add \0
+    uint32_t seq = binary_utils_read_uint32(msg + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE);
+    HpbPublishOrigin origin = hpb_protocol_read_origin(msg + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_SEQ_SIZE);
+    size_t msg_content_size = msg_length - header_size + 1; // +1 to add \0
     char *msg_content = (char *) malloc(msg_content_size* sizeof(char));
-    memcpy(msg_content, (msg + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE), msg_content_size-1);
+    memcpy(msg_content, (msg + header_size), msg_content_size-1);
     msg_content[msg_content_size-1] = '\0';
-    hpb_process_info_msg(service_key, msg_content, msg_content_size);
+
+    if(hpb_protocol_get_message_type(msg) == SHARD_PUBLISH) {
+        hpb_process_shard_publish_req(service_key, seq, origin, msg_content, msg_content_size - 1);
+    }
+    else {
+        hpb_process_sequenced_info_msg(service_key, seq, origin, msg_content, msg_content_size);
+    }
 
     free(service_key);
     free(msg_content);
     return 0;
 }
+
+static int hpb_protocol_receive_nack_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length)
+{
+    size_t header_size = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_NACK_COUNT_SIZE;
+    if(msg_length < header_size) {
+        return -1; // Invalid lenght for a NACK message
+    }
+
+    size_t n_ranges = msg[MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE];
+    if(n_ranges > HPB_PROTOCOL_NACK_MAX_RANGES || msg_length != header_size + n_ranges * HPB_PROTOCOL_NACK_RANGE_SIZE) {
+        return -1; // Invalid number of ranges
+    }
+
+    HpbSeqRange ranges[HPB_PROTOCOL_NACK_MAX_RANGES];
+    for(size_t i = 0; i < n_ranges; i++)
+    {
+        HLByte *range_bytes = msg + header_size + i * HPB_PROTOCOL_NACK_RANGE_SIZE;
+        ranges[i].first = binary_utils_read_uint32(range_bytes);
+        ranges[i].last = binary_utils_read_uint32(range_bytes + HPB_PROTOCOL_SEQ_SIZE);
+    }
+
+    hpb_process_nack_req(msg + MESSAGE_TYPE_BYTE_SIZE, ranges, n_ranges, instance_origin);
+    return 0;
+}
+
+static int hpb_protocol_receive_handover_msg(HLByte *msg, size_t msg_length)
+{
+    size_t offset = MESSAGE_TYPE_BYTE_SIZE + HPB_PROTOCOL_HANDOVER_COUNT_SIZE;
+    if(msg_length < offset) {
+        return -1; // Invalid lenght for a handover message
+    }
+
+    uint32_t n_services = binary_utils_read_uint32(msg + MESSAGE_TYPE_BYTE_SIZE);
+    for(uint32_t i = 0; i < n_services; i++)
+    {
+        if(msg_length - offset < HPB_PROTOCOL_HANDOVER_SERVICE_HEADER_SIZE) {
+            return -1; // Truncated service
+        }
+
+        HLByte *service_key = msg + offset;
+        offset += SHA1_BLOCK_SIZE;
+        uint32_t next_seq = binary_utils_read_uint32(msg + offset);
+        offset += HPB_PROTOCOL_SEQ_SIZE;
+        HpbPublishOrigin retained_origin = hpb_protocol_read_origin(msg + offset);
+        offset += HPB_PROTOCOL_ORIGIN_SIZE;
+        size_t retained_msg_length = binary_utils_read_uint32(msg + offset);
+        offset += HPB_PROTOCOL_HANDOVER_LENGTH_SIZE;
+        size_t pattern_length = (((size_t) msg[offset]) << 8) | ((size_t) msg[offset + 1]);
+        offset += HPB_PROTOCOL_PATTERN_LENGTH_SIZE;
+        if(msg_length - offset < retained_msg_length || msg_length - offset - retained_msg_length < pattern_length + HPB_PROTOCOL_HANDOVER_COUNT_SIZE) {
+            return -1; // Truncated retained message or pattern
+        }
+
+        char *retained_msg = (retained_msg_length > 0) ? (char *) (msg + offset) : NULL;
+        offset += retained_msg_length;
+        char *pattern = NULL;
+        if(pattern_length > 0)
+        {
+            pattern = (char *) malloc((pattern_length + 1) * sizeof(char));
+            memcpy(pattern, msg + offset, pattern_length);
+            pattern[pattern_length] = '\0';
+        }
+        offset += pattern_length;
+        size_t n_subscribers = binary_utils_read_uint32(msg + offset);
+        offset += HPB_PROTOCOL_HANDOVER_COUNT_SIZE;
+        if(n_subscribers > (msg_length - offset) / HPB_PROTOCOL_HANDOVER_ID_SIZE)
+        {
+            free(pattern);
+            return -1; // More subscribers than bytes left
+        }
+
+        HypeInstance **subscribers = (HypeInstance **) malloc(n_subscribers * sizeof(HypeInstance *));
+        size_t n_parsed = 0;
+        while(n_parsed < n_subscribers)
+        {
+            if(offset + HPB_PROTOCOL_HANDOVER_ID_SIZE > msg_length || msg_length - offset - HPB_PROTOCOL_HANDOVER_ID_SIZE < msg[offset]) {
+                break; // Truncated identifier
+            }
+
+            HypeBuffer *identifier = hype_buffer_create_from(msg + offset + HPB_PROTOCOL_HANDOVER_ID_SIZE, msg[offset]);
+            subscribers[n_parsed++] = hype_instance_create(identifier, NULL, false);
+            hype_buffer_release(identifier);
+            offset += HPB_PROTOCOL_HANDOVER_ID_SIZE + msg[offset];
+        }
+
+        if(n_parsed == n_subscribers && hpb_protocol_get_message_type(msg) == SHARD) {
+            hpb_process_shard_req(service_key, subscribers, n_subscribers);
+        }
+        else if(n_parsed == n_subscribers && (msg[0] & HPB_PROTOCOL_FLAG_REPLICA)) {
+            hpb_process_replica_req(service_key, pattern, next_seq, retained_origin, retained_msg, retained_msg_length, subscribers, n_subscribers);
+        }
+        else if(n_parsed == n_subscribers) {
+            hpb_process_handover_req(service_key, pattern, next_seq, retained_origin, retained_msg, retained_msg_length, subscribers, n_subscribers);
+        }
+
+        for(size_t j = 0; j < n_parsed; j++) {
+            hype_instance_release(subscribers[j]);
+        }
+        free(subscribers);
+        free(pattern);
+
+        if(n_parsed != n_subscribers) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int hpb_protocol_receive_heartbeat_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length)
+{
+    size_t header_size = MESSAGE_TYPE_BYTE_SIZE + HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE;
+    if(msg_length < header_size) {
+        return -1; // Invalid lenght for a heartbeat message
+    }
+
+    // The flags of the subscriptions, if any, follow the keys
+    size_t n_services = binary_utils_read_uint32(msg + MESSAGE_TYPE_BYTE_SIZE);
+    size_t keys_size = n_services * SHA1_BLOCK_SIZE;
+    bool has_flags = (msg_length - header_size == keys_size + n_services);
+    if(msg_length - header_size != keys_size && !has_flags) {
+        return -1; // Invalid number of services
+    }
+
+    if(msg[0] & HPB_PROTOCOL_FLAG_UNKNOWN) {
+        hpb_process_unknown_heartbeat_msg(msg + header_size, n_services, instance_origin);
+    }
+    else {
+        hpb_process_heartbeat_req(msg + header_size, (has_flags) ? msg + header_size + keys_size : NULL, n_services, instance_origin);
+    }
+    return 0;
+}
+
+static int hpb_protocol_receive_relay_msg(HLByte *msg, size_t msg_length)
+{
+    size_t offset = HPB_PROTOCOL_RELAY_HEADER_SIZE;
+    if(msg_length <= offset) {
+        return -1; // Invalid lenght for a relay message
+    }
+
+    HLByte *service_key = msg + MESSAGE_TYPE_BYTE_SIZE;
+    uint32_t seq = binary_utils_read_uint32(msg + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE);
+    HpbPublishOrigin origin = hpb_protocol_read_origin(msg + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_SEQ_SIZE);
+    uint8_t branching = msg[offset - HPB_PROTOCOL_RELAY_COUNT_SIZE - HPB_PROTOCOL_RELAY_BRANCHING_SIZE];
+    size_t n_children = binary_utils_read_uint32(msg + offset - HPB_PROTOCOL_RELAY_COUNT_SIZE);
+    if(n_children > (msg_length - offset) / HPB_PROTOCOL_HANDOVER_ID_SIZE) {
+        return -1; // More subscribers than bytes left
+    }
+
+    HypeInstance **children = (HypeInstance **) malloc(n_children * sizeof(HypeInstance *));
+    size_t n_parsed = 0;
+    while(n_parsed < n_children)
+    {
+        if(offset + HPB_PROTOCOL_HANDOVER_ID_SIZE > msg_length || msg_length - offset - HPB_PROTOCOL_HANDOVER_ID_SIZE < msg[offset]) {
+            break; // Truncated identifier
+        }
+
+        HypeBuffer *identifier = hype_buffer_create_from(msg + offset + HPB_PROTOCOL_HANDOVER_ID_SIZE, msg[offset]);
+        children[n_parsed++] = hype_instance_create(identifier, NULL, false);
+        hype_buffer_release(identifier);
+        offset += HPB_PROTOCOL_HANDOVER_ID_SIZE + msg[offset];
+    }
+
+    int result = -1;
+    if(n_parsed == n_children && offset < msg_length)
+    {
+        size_t msg_content_size = msg_length - offset + 1; // +1 to add \0
+        char *msg_content = (char *) malloc(msg_content_size* sizeof(char));
+        memcpy(msg_content, (msg + offset), msg_content_size-1);
+        msg_content[msg_content_size-1] = '\0';
+        result = hpb_process_relay_req(service_key, seq, origin, branching, children, n_children, msg_content, msg_content_size - 1);
+        free(msg_content);
+    }
+
+    for(size_t i = 0; i < n_parsed; i++) {
+        hype_instance_release(children[i]);
+    }
+    free(children);
+    return (result == 0) ? 0 : -1;
+}
+
+static int hpb_protocol_receive_direct_info_msg(HLByte *msg, size_t msg_length)
+{
+    size_t header_size = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_ORIGIN_SIZE;
+    if(msg_length <= header_size) {
+        return -1; // Invalid lenght for a direct info message
+    }
+
+    HpbPublishOrigin origin = hpb_protocol_read_origin(msg + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE);
+    size_t msg_content_size = msg_length - header_size + 1; // +1 to add \0
+    char *msg_content = (char *) malloc(msg_content_size* sizeof(char));
+    memcpy(msg_content, (msg + header_size), msg_content_size-1);
+    msg_content[msg_content_size-1] = '\0';
+
+    // The messages of the publisher are not sequenced by the manager, so they are only deduplicated by their origin
+    hpb_process_info_msg(msg + MESSAGE_TYPE_BYTE_SIZE, origin, msg_content, msg_content_size);
+
+    free(msg_content);
+    return 0;
+}
+
+static int hpb_protocol_receive_subscriber_list_msg(HypeInstance * instance_origin, HLByte *msg, size_t msg_length)
+{
+    size_t offset = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE;
+    if(msg_length == offset) {
+        return hpb_process_subscriber_list_req(msg + MESSAGE_TYPE_BYTE_SIZE, instance_origin);
+    }
+
+    offset += HPB_PROTOCOL_SUBSCRIBER_LIST_VERSION_SIZE + HPB_PROTOCOL_SUBSCRIBER_LIST_COUNT_SIZE;
+    if(msg_length < offset) {
+        return -1; // Invalid lenght for a subscriber list message
+    }
+
+    HLByte *service_key = msg + MESSAGE_TYPE_BYTE_SIZE;
+    uint32_t version = binary_utils_read_uint32(msg + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE);
+    uint32_t count = binary_utils_read_uint32(msg + offset - HPB_PROTOCOL_SUBSCRIBER_LIST_COUNT_SIZE);
+    if(count == HPB_PROTOCOL_SUBSCRIBER_LIST_REFUSED) {
+        return hpb_process_subscriber_list_msg(service_key, version, true, NULL, 0, instance_origin);
+    }
+
+    size_t n_subscribers = count;
+    if(n_subscribers > (msg_length - offset) / HPB_PROTOCOL_HANDOVER_ID_SIZE) {
+        return -1; // More subscribers than bytes left
+    }
+
+    HypeInstance **subscribers = (HypeInstance **) malloc(n_subscribers * sizeof(HypeInstance *));
+    size_t n_parsed = 0;
+    while(n_parsed < n_subscribers)
+    {
+        if(offset + HPB_PROTOCOL_HANDOVER_ID_SIZE > msg_length || msg_length - offset - HPB_PROTOCOL_HANDOVER_ID_SIZE < msg[offset]) {
+            break; // Truncated identifier
+        }
+
+        HypeBuffer *identifier = hype_buffer_create_from(msg + offset + HPB_PROTOCOL_HANDOVER_ID_SIZE, msg[offset]);
+        subscribers[n_parsed++] = hype_instance_create(identifier, NULL, false);
+        hype_buffer_release(identifier);
+        offset += HPB_PROTOCOL_HANDOVER_ID_SIZE + msg[offset];
+    }
+
+    int result = -1;
+    if(n_parsed == n_subscribers && offset == msg_length) {
+        result = hpb_process_subscriber_list_msg(service_key, version, false, subscribers, n_subscribers, instance_origin);
+    }
+
+    for(size_t i = 0; i < n_parsed; i++) {
+        hype_instance_release(subscribers[i]);
+    }
+    free(subscribers);
+    return result;
+}
@@ -0,0 +1,92 @@
+#include "hype_pub_sub/hpb_relay_tree.h"
+
+//
+// Static functions declaration
+//
+
+static int hpb_relay_tree_compare_members(const void *member1, const void *member2);
+
+//
+// Header functions implementation
+//
+
+void hpb_relay_tree_sort(HpbRelayMember members[], size_t n_members)
+{
+    if(n_members > 1) {
+        qsort(members, n_members, sizeof(HpbRelayMember), hpb_relay_tree_compare_members);
+    }
+}
+
+size_t hpb_relay_tree_split(HpbRelayMember members[], size_t n_members, size_t branching, HpbRelayBranch branches[])
+{
+    if(branching > HPB_RELAY_TREE_MAX_BRANCHING) {
+        branching = HPB_RELAY_TREE_MAX_BRANCHING;
+    }
+    if(branching == 0 || n_members == 0) {
+        return 0;
+    }
+
+    size_t n_branches = (n_members < branching) ? n_members : branching;
+    size_t first = 0;
+
+    for(size_t i = 0; i < n_branches; i++)
+    {
+        // The first n_members % n_branches ranges take one more member
+        size_t range_size = n_members / n_branches + ((i < n_members % n_branches) ? 1 : 0);
+
+        size_t relay = first;
+        for(size_t j = first + 1; j < first + range_size; j++)
+        {
+            if(members[j].link_cost_ms < members[relay].link_cost_ms) {
+                relay = j;
+            }
+        }
+
+        // The relay is rotated to the front, so that its subtree keeps the key order
+        if(relay != first)
+        {
+            HpbRelayMember relay_member = members[relay];
+            memmove(&members[first + 1], &members[first], (relay - first) * sizeof(HpbRelayMember));
+            members[first] = relay_member;
+        }
+
+        branches[i].relay = &members[first];
+        branches[i].children = &members[first + 1];
+        branches[i].n_children = range_size - 1;
+        first += range_size;
+    }
+
+    return n_branches;
+}
+
+size_t hpb_relay_tree_get_depth(size_t n_members, size_t branching)
+{
+    if(n_members == 0) {
+        return 0;
+    }
+    if(branching <= 1) {
+        return n_members;
+    }
+
+    // Each level holds branching times the relays of the previous one
+    size_t depth = 0;
+    size_t level_size = 1;
+    size_t n_covered = 0;
+    while(n_covered < n_members)
+    {
+        level_size *= branching;
+        n_covered += level_size;
+        depth++;
+    }
+
+    return depth;
+}
+
+//
+// Static functions implementation
+//
+
+static int hpb_relay_tree_compare_members(const void *member1, const void *member2)
+{
+    return memcmp(((const HpbRelayMember *) member1)->key, ((const HpbRelayMember *) member2)->key, SHA1_BLOCK_SIZE);
+}
@@ -0,0 +1,228 @@
+
+#include "hype_pub_sub/hpb_resolver.h"
+
+//
+// Static functions declaration
+//
+
+static HpbResolverEntry *hpb_resolver_find(LinkedList *entries, HypeInstance *instance);
+static HpbResolverEntry *hpb_resolver_get_closest(HpbResolver *resolver, HLByte *keys, size_t n_keys);
+static void hpb_resolver_start(HpbResolver *resolver, HpbResolverEntry *entry, uint64_t now_ms, HpbResolveCallback resolve, void *arg);
+static void hpb_resolver_expire(HpbResolver *resolver, uint64_t now_ms);
+static bool linked_list_callback_is_same_entry(void *entry1, void *entry2);
+static void linked_list_callback_free_entry(void **element);
+static void linked_list_callback_free_nothing(void **element);
+
+//
+// Header functions implementation
+//
+
+HpbResolver *hpb_resolver_create(size_t max_in_flight)
+{
+    HpbResolver *resolver = (HpbResolver *) calloc(1, sizeof(HpbResolver));
+
+    if(resolver == NULL) {
+        return NULL;
+    }
+
+    resolver->pending = linked_list_create();
+    resolver->in_flight = linked_list_create();
+    resolver->max_in_flight = max_in_flight;
+    return resolver;
+}
+
+bool hpb_resolver_add(HpbResolver *resolver, HypeInstance *instance, uint64_t now_ms)
+{
+    if(hpb_resolver_find(resolver->pending, instance) != NULL || hpb_resolver_find(resolver->in_flight, instance) != NULL) {
+        return false;
+    }
+
+    HpbResolverEntry *entry = (HpbResolverEntry *) malloc(sizeof(HpbResolverEntry));
+    entry->client = hpb_client_create(instance);
+    entry->found_ms = now_ms;
+    entry->started_ms = 0;
+    linked_list_add(resolver->pending, entry);
+
+    resolver->n_found++;
+    if(resolver->pending->size > resolver->max_pending) {
+        resolver->max_pending = resolver->pending->size;
+    }
+    return true;
+}
+
+bool hpb_resolver_complete(HpbResolver *resolver, HypeInstance *instance, bool success, uint64_t now_ms)
+{
+    HpbResolverEntry *entry = hpb_resolver_find(resolver->in_flight, instance);
+
+    if(entry == NULL) {
+        return false;
+    }
+
+    if(success)
+    {
+        uint64_t handshake_ms = now_ms - entry->started_ms;
+        resolver->n_resolved++;
+        resolver->handshake_total_ms += handshake_ms;
+        resolver->handshake_max_ms = (handshake_ms > resolver->handshake_max_ms) ? handshake_ms : resolver->handshake_max_ms;
+    }
+    else {
+        resolver->n_failed++;
+    }
+
+    linked_list_remove(resolver->in_flight, entry, linked_list_callback_is_same_entry, linked_list_callback_free_entry);
+    return true;
+}
+
+bool hpb_resolver_remove(HpbResolver *resolver, HypeInstance *instance)
+{
+    HpbResolverEntry *entry = hpb_resolver_find(resolver->pending, instance);
+    if(entry != NULL)
+    {
+        linked_list_remove(resolver->pending, entry, linked_list_callback_is_same_entry, linked_list_callback_free_entry);
+        return true;
+    }
+
+    return hpb_resolver_complete(resolver, instance, false, 0);
+}
+
+size_t hpb_resolver_dispatch(HpbResolver *resolver, HLByte *keys, size_t n_keys, uint64_t now_ms, HpbResolveCallback resolve, void *arg)
+{
+    hpb_resolver_expire(resolver, now_ms);
+
+    size_t n_started = 0;
+    while(resolver->in_flight->size < resolver->max_in_flight && resolver->pending->size > 0)
+    {
+        hpb_resolver_start(resolver, hpb_resolver_get_closest(resolver, keys, n_keys), now_ms, resolve, arg);
+        n_started++;
+    }
+
+    return n_started;
+}
+
+int hpb_resolver_set_max_in_flight(HpbResolver *resolver, size_t max_in_flight)
+{
+    if(max_in_flight < 1 || max_in_flight > HPB_RESOLVER_MAX_IN_FLIGHT) {
+        return -1;
+    }
+
+    resolver->max_in_flight = max_in_flight;
+    return 0;
+}
+
+void hpb_resolver_print_stats(HpbResolver *resolver)
+{
+    uint64_t n_started = resolver->n_resolved + resolver->n_failed + resolver->n_timeouts + resolver->in_flight->size;
+
+    printf("\n");
+    printf("Instances found: %llu, waiting: %zu (max %zu), resolving: %zu of %zu\n", (unsigned long long) resolver->n_found,
+           resolver->pending->size, resolver->max_pending, resolver->in_flight->size, resolver->max_in_flight);
+    printf("Handshakes resolved: %llu, failed: %llu, timed out: %llu\n", (unsigned long long) resolver->n_resolved,
+           (unsigned long long) resolver->n_failed, (unsigned long long) resolver->n_timeouts);
+    printf("Queue wait: avg %llu ms, max %llu ms\n",
+           (unsigned long long) ((n_started > 0) ? resolver->wait_total_ms / n_started : 0), (unsigned long long) resolver->wait_max_ms);
+    printf("Handshake latency: avg %llu ms, max %llu ms\n",
+           (unsigned long long) ((resolver->n_resolved > 0) ? resolver->handshake_total_ms / resolver->n_resolved : 0),
+           (unsigned long long) resolver->handshake_max_ms);
+    printf("\n");
+}
+
+void hpb_resolver_destroy(HpbResolver **resolver)
+{
+    if((*resolver) == NULL) {
+        return;
+    }
+
+    linked_list_destroy(&((*resolver)->pending), linked_list_callback_free_entry);
+    linked_list_destroy(&((*resolver)->in_flight), linked_list_callback_free_entry);
+    free(*resolver);
+    (*resolver) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static HpbResolverEntry *hpb_resolver_find(LinkedList *entries, HypeInstance *instance)
+{
+    for(LinkedListNode *node = entries->head; node != NULL; node = node->next)
+    {
+        HpbResolverEntry *entry = (HpbResolverEntry *) node->element;
+        if(hpb_client_is_instance_equal(entry->client, instance)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static HpbResolverEntry *hpb_resolver_get_closest(HpbResolver *resolver, HLByte *keys, size_t n_keys)
+{
+    HpbResolverEntry *closest = (HpbResolverEntry *) resolver->pending->head->element;
+    HLByte lowest_dist[SHA1_BLOCK_SIZE];
+    memset(lowest_dist, 0xFF, SHA1_BLOCK_SIZE);
+
+    // On equal distances the instance found first is kept
+    for(LinkedListNode *node = resolver->pending->head; node != NULL && n_keys > 0; node = node->next)
+    {
+        HpbResolverEntry *entry = (HpbResolverEntry *) node->element;
+        for(size_t i = 0; i < n_keys; i++)
+        {
+            HLByte *dist = binary_utils_xor(keys + i * SHA1_BLOCK_SIZE, entry->client->key, SHA1_BLOCK_SIZE);
+            if(binary_utils_get_higher_byte_array(lowest_dist, dist, SHA1_BLOCK_SIZE) == 1)
+            {
+                memcpy(lowest_dist, dist, SHA1_BLOCK_SIZE);
+                closest = entry;
+            }
+            free(dist);
+        }
+    }
+
+    return closest;
+}
+
+static void hpb_resolver_start(HpbResolver *resolver, HpbResolverEntry *entry, uint64_t now_ms, HpbResolveCallback resolve, void *arg)
+{
+    linked_list_remove(resolver->pending, entry, linked_list_callback_is_same_entry, linked_list_callback_free_nothing);
+    linked_list_add(resolver->in_flight, entry);
+
+    uint64_t wait_ms = now_ms - entry->found_ms;
+    resolver->wait_total_ms += wait_ms;
+    resolver->wait_max_ms = (wait_ms > resolver->wait_max_ms) ? wait_ms : resolver->wait_max_ms;
+    entry->started_ms = now_ms;
+
+    resolve(entry->client->hype_instance, arg);
+}
+
+static void hpb_resolver_expire(HpbResolver *resolver, uint64_t now_ms)
+{
+    LinkedListNode *node = resolver->in_flight->head;
+    while(node != NULL)
+    {
+        HpbResolverEntry *entry = (HpbResolverEntry *) node->element;
+        node = node->next;
+
+        if(entry->started_ms + HPB_RESOLVER_TIMEOUT_MS <= now_ms)
+        {
+            resolver->n_timeouts++;
+            linked_list_remove(resolver->in_flight, entry, linked_list_callback_is_same_entry, linked_list_callback_free_entry);
+        }
+    }
+}
+
+static bool linked_list_callback_is_same_entry(void *entry1, void *entry2)
+{
+    return entry1 == entry2;
+}
+
+static void linked_list_callback_free_entry(void **element)
+{
+    HpbResolverEntry *entry = (HpbResolverEntry *) (*element);
+    hpb_client_destroy(&(entry->client));
+    free(entry);
+    (*element) = NULL;
+}
+
+static void linked_list_callback_free_nothing(void **element)
+{
+    // The element moves to another list
+}
@@ -0,0 +1,396 @@
+
+#include "hype_pub_sub/hpb_retry_queue.h"
+
+//
+// Static functions declaration
+//
+
+static HpbRetryEntry *hpb_retry_queue_find(HpbRetryQueue *queue, uint64_t message_id);
+static HpbRetryEntry *hpb_retry_queue_find_oldest(HpbRetryQueue *queue, HpbRetryPriority priority);
+static void hpb_retry_queue_link(HpbRetryQueue *queue, HpbRetryEntry *entry);
+static void hpb_retry_queue_unlink(HpbRetryQueue *queue, HpbRetryEntry *entry);
+static void hpb_retry_queue_unaccount(HpbRetryQueue *queue, HpbRetryEntry *entry);
+static void hpb_retry_queue_remove_entry(HpbRetryQueue *queue, HpbRetryEntry *entry);
+static void hpb_retry_queue_entry_destroy(HpbRetryQueue *queue, HpbRetryEntry **entry);
+static size_t hpb_retry_queue_get_bucket(HpbRetryQueue *queue, uint64_t message_id);
+static uint64_t hpb_retry_queue_get_backoff(HpbRetryQueue *queue, unsigned int n_attempts);
+static uint32_t hpb_retry_queue_random(HpbRetryQueue *queue);
+
+//
+// Header functions implementation
+//
+
+HpbRetryQueue *hpb_retry_queue_create(size_t max_entries, size_t max_bytes, uint32_t seed)
+{
+    HpbRetryQueue *queue = (HpbRetryQueue *) calloc(1, sizeof(HpbRetryQueue));
+
+    if(queue == NULL) {
+        return NULL;
+    }
+
+    size_t n_buckets = 16;
+    while(n_buckets * HPB_RETRY_INDEX_LOAD < max_entries) {
+        n_buckets *= 2;
+    }
+
+    queue->index = (HpbRetryEntry **) calloc(n_buckets, sizeof(HpbRetryEntry *));
+    if(queue->index == NULL)
+    {
+        free(queue);
+        return NULL;
+    }
+
+    queue->index_mask = n_buckets - 1;
+    queue->max_entries = max_entries;
+    queue->max_bytes = max_bytes;
+    queue->rng_state = (seed != 0) ? seed : 0x9e3779b9; // xorshift generators must not be seeded with 0
+    pthread_mutex_init(&queue->mutex, NULL);
+    return queue;
+}
+
+HpbRetryPacket *hpb_retry_queue_packet_create(HpbRetryQueue *queue, HLByte *data, size_t size)
+{
+    HpbRetryPacket *packet = (HpbRetryPacket *) malloc(sizeof(HpbRetryPacket));
+    packet->data = (HLByte *) malloc(size * sizeof(HLByte));
+    memcpy(packet->data, data, size);
+    packet->size = size;
+    packet->ref_count = 1;
+    packet->n_entries = 0;
+    return packet;
+}
+
+void hpb_retry_queue_packet_release(HpbRetryQueue *queue, HpbRetryPacket *packet)
+{
+    pthread_mutex_lock(&queue->mutex);
+    packet->ref_count--;
+    bool is_to_free = (packet->ref_count == 0);
+    pthread_mutex_unlock(&queue->mutex);
+
+    if(is_to_free)
+    {
+        free(packet->data);
+        free(packet);
+    }
+}
+
+int hpb_retry_queue_track(HpbRetryQueue *queue, uint64_t message_id, HpbRetryPacket *packet, HypeInstance *destination, HpbRetryPriority priority, uint64_t now_ms)
+{
+    if(queue == NULL || packet == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&queue->mutex);
+
+    // Make room by evicting the oldest data entries. Control entries are only evicted by other control entries.
+    // The packets which are not tracked, such as those being fanned out, do not count against the bytes
+    while(queue->n_entries >= queue->max_entries || queue->n_bytes + ((packet->n_entries == 0) ? packet->size : 0) > queue->max_bytes)
+    {
+        HpbRetryEntry *victim = hpb_retry_queue_find_oldest(queue, HPB_RETRY_PRIORITY_DATA);
+        if(victim == NULL && priority == HPB_RETRY_PRIORITY_CONTROL) {
+            victim = hpb_retry_queue_find_oldest(queue, HPB_RETRY_PRIORITY_CONTROL);
+        }
+
+        if(victim == NULL)
+        {
+            queue->n_evicted++;
+            pthread_mutex_unlock(&queue->mutex);
+            return -1;
+        }
+
+        hpb_retry_queue_remove_entry(queue, victim);
+        queue->n_evicted++;
+    }
+
+    HpbRetryEntry *entry = (HpbRetryEntry *) malloc(sizeof(HpbRetryEntry));
+    entry->message_id = message_id;
+    entry->packet = packet;
+    packet->ref_count++;
+    if(packet->n_entries++ == 0) {
+        queue->n_bytes += packet->size;
+    }
+    entry->destination = hype_instance_create(destination->identifier, destination->announcement, destination->is_resolved);
+    entry->priority = priority;
+    entry->is_failed = false;
+    entry->n_attempts = 1;
+    entry->next_attempt_ms = 0;
+    entry->deadline_ms = now_ms + HPB_RETRY_DEADLINE_MS;
+    entry->sent_ms = now_ms;
+    queue->n_entries++;
+    hpb_retry_queue_link(queue, entry);
+
+    pthread_mutex_unlock(&queue->mutex);
+    return 0;
+}
+
+int hpb_retry_queue_delivered(HpbRetryQueue *queue, uint64_t message_id, HpbRetryCompletionCallback completion_callback, void *arg)
+{
+    if(queue == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&queue->mutex);
+    HpbRetryEntry *entry = hpb_retry_queue_find(queue, message_id);
+    if(entry != NULL)
+    {
+        hpb_retry_queue_unlink(queue, entry);
+        hpb_retry_queue_unaccount(queue, entry);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    if(entry == NULL) {
+        return -1;
+    }
+
+    if(completion_callback != NULL) {
+        completion_callback(entry, true, arg);
+    }
+
+    hpb_retry_queue_entry_destroy(queue, &entry);
+    return 0;
+}
+
+int hpb_retry_queue_failed(HpbRetryQueue *queue, uint64_t message_id, uint64_t now_ms)
+{
+    if(queue == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&queue->mutex);
+    HpbRetryEntry *entry = hpb_retry_queue_find(queue, message_id);
+    if(entry != NULL)
+    {
+        entry->is_failed = true;
+        entry->next_attempt_ms = now_ms + hpb_retry_queue_get_backoff(queue, entry->n_attempts);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    return (entry != NULL) ? 0 : -1;
+}
+
+int hpb_retry_queue_process(HpbRetryQueue *queue, uint64_t now_ms, HpbRetrySendCallback send_callback, void *send_arg,
+                            HpbRetryCompletionCallback completion_callback, void *completion_arg)
+{
+    if(queue == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&queue->mutex);
+
+    // The entries to resend leave the list while they are sent, so that they cannot be evicted meanwhile,
+    // but still count against the size of the queue
+    HpbRetryEntry **due = (HpbRetryEntry **) malloc((queue->n_entries + 1) * sizeof(HpbRetryEntry *));
+    HpbRetryEntry **expired = (HpbRetryEntry **) malloc((queue->n_entries + 1) * sizeof(HpbRetryEntry *));
+    size_t n_due = 0;
+    size_t n_expired = 0;
+
+    // Control messages are retried first, so that subscriptions are restored before data is resent
+    HpbRetryPriority priorities[] = { HPB_RETRY_PRIORITY_CONTROL, HPB_RETRY_PRIORITY_DATA };
+    for(int p = 0; p < 2; p++)
+    {
+        HpbRetryEntry *entry = queue->head;
+        while(entry != NULL)
+        {
+            HpbRetryEntry *next = entry->next;
+
+            if(entry->priority == priorities[p] && entry->deadline_ms <= now_ms)
+            {
+                hpb_retry_queue_unlink(queue, entry);
+                hpb_retry_queue_unaccount(queue, entry);
+                expired[n_expired++] = entry;
+                queue->n_expired++;
+            }
+            else if(entry->priority == priorities[p] && entry->is_failed && entry->next_attempt_ms <= now_ms)
+            {
+                hpb_retry_queue_unlink(queue, entry);
+                due[n_due++] = entry;
+            }
+
+            entry = next;
+        }
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    // Callbacks are invoked without holding the mutex since they may send new messages, and the transport may
+    // report the deliveries and the failures before they return
+    for(size_t i = 0; i < n_due; i++)
+    {
+        HpbRetryEntry *entry = due[i];
+        uint64_t message_id = send_callback(entry->packet->data, entry->packet->size, entry->destination, send_arg);
+
+        pthread_mutex_lock(&queue->mutex);
+        entry->n_attempts++;
+        queue->n_retries++;
+        if(message_id == 0) { // The SDK refused the message. Try again later.
+            entry->next_attempt_ms = now_ms + hpb_retry_queue_get_backoff(queue, entry->n_attempts);
+        }
+        else
+        {
+            entry->message_id = message_id;
+            entry->is_failed = false;
+        }
+        hpb_retry_queue_link(queue, entry);
+        pthread_mutex_unlock(&queue->mutex);
+    }
+
+    for(size_t i = 0; i < n_expired; i++)
+    {
+        if(completion_callback != NULL) {
+            completion_callback(expired[i], false, completion_arg);
+        }
+        hpb_retry_queue_entry_destroy(queue, &expired[i]);
+    }
+
+    free(due);
+    free(expired);
+    return (int) n_due;
+}
+
+void hpb_retry_queue_destroy(HpbRetryQueue **queue)
+{
+    if((*queue) == NULL) {
+        return;
+    }
+
+    while((*queue)->head != NULL) {
+        hpb_retry_queue_remove_entry(*queue, (*queue)->head);
+    }
+
+    free((*queue)->index);
+    pthread_mutex_destroy(&((*queue)->mutex));
+    free(*queue);
+    (*queue) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static HpbRetryEntry *hpb_retry_queue_find(HpbRetryQueue *queue, uint64_t message_id)
+{
+    HpbRetryEntry *entry = queue->index[hpb_retry_queue_get_bucket(queue, message_id)];
+    while(entry != NULL && entry->message_id != message_id) {
+        entry = entry->next_by_id;
+    }
+
+    return entry;
+}
+
+static HpbRetryEntry *hpb_retry_queue_find_oldest(HpbRetryQueue *queue, HpbRetryPriority priority)
+{
+    HpbRetryEntry *entry = queue->head;
+    while(entry != NULL && entry->priority != priority) {
+        entry = entry->next;
+    }
+
+    return entry;
+}
+
+// Must be called with the mutex locked
+static void hpb_retry_queue_link(HpbRetryQueue *queue, HpbRetryEntry *entry)
+{
+    entry->prev = queue->tail;
+    entry->next = NULL;
+    if(queue->tail != NULL) {
+        queue->tail->next = entry;
+    }
+    else {
+        queue->head = entry;
+    }
+    queue->tail = entry;
+
+    size_t bucket = hpb_retry_queue_get_bucket(queue, entry->message_id);
+    entry->next_by_id = queue->index[bucket];
+    queue->index[bucket] = entry;
+}
+
+// Must be called with the mutex locked
+static void hpb_retry_queue_unlink(HpbRetryQueue *queue, HpbRetryEntry *entry)
+{
+    if(entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    }
+    else {
+        queue->head = entry->next;
+    }
+
+    if(entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    }
+    else {
+        queue->tail = entry->prev;
+    }
+
+    HpbRetryEntry **slot = &(queue->index[hpb_retry_queue_get_bucket(queue, entry->message_id)]);
+    while(*slot != entry) {
+        slot = &((*slot)->next_by_id);
+    }
+    (*slot) = entry->next_by_id;
+    entry->prev = entry->next = entry->next_by_id = NULL;
+}
+
+// Must be called with the mutex locked
+static void hpb_retry_queue_unaccount(HpbRetryQueue *queue, HpbRetryEntry *entry)
+{
+    queue->n_entries--;
+    if(--entry->packet->n_entries == 0) {
+        queue->n_bytes -= entry->packet->size;
+    }
+}
+
+// Must be called with the mutex locked
+static void hpb_retry_queue_remove_entry(HpbRetryQueue *queue, HpbRetryEntry *entry)
+{
+    hpb_retry_queue_unlink(queue, entry);
+    hpb_retry_queue_unaccount(queue, entry);
+
+    entry->packet->ref_count--;
+    if(entry->packet->ref_count == 0)
+    {
+        free(entry->packet->data);
+        free(entry->packet);
+    }
+
+    hype_instance_release(entry->destination);
+    free(entry);
+}
+
+// Must be called without the mutex locked
+static void hpb_retry_queue_entry_destroy(HpbRetryQueue *queue, HpbRetryEntry **entry)
+{
+    hpb_retry_queue_packet_release(queue, (*entry)->packet);
+    hype_instance_release((*entry)->destination);
+    free(*entry);
+    (*entry) = NULL;
+}
+
+static size_t hpb_retry_queue_get_bucket(HpbRetryQueue *queue, uint64_t message_id)
+{
+    // The identifiers are often consecutive, so they are mixed before being masked
+    return (size_t) ((message_id * 0x9e3779b97f4a7c15ULL) >> 32) & queue->index_mask;
+}
+
+static uint64_t hpb_retry_queue_get_backoff(HpbRetryQueue *queue, unsigned int n_attempts)
+{
+    uint64_t backoff = HPB_RETRY_INITIAL_BACKOFF_MS;
+    for(unsigned int i = 1; i < n_attempts && backoff < HPB_RETRY_MAX_BACKOFF_MS; i++) {
+        backoff *= 2;
+    }
+
+    if(backoff > HPB_RETRY_MAX_BACKOFF_MS) {
+        backoff = HPB_RETRY_MAX_BACKOFF_MS;
+    }
+
+    // Jitter: the delay is randomized in [backoff/2, backoff] to avoid synchronized retries
+    return backoff / 2 + hpb_retry_queue_random(queue) % (backoff / 2 + 1);
+}
+
+static uint32_t hpb_retry_queue_random(HpbRetryQueue *queue)
+{
+    uint32_t x = queue->rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    queue->rng_state = x;
+    return x;
+}
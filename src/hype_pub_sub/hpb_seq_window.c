@@ -0,0 +1,90 @@
+
+#include "hype_pub_sub/hpb_seq_window.h"
+
+void hpb_seq_window_reset(HpbSeqWindow *window)
+{
+    window->is_initialized = false;
+    window->highest = 0;
+    window->received_mask = 0;
+}
+
+HpbSeqResult hpb_seq_window_receive(HpbSeqWindow *window, uint32_t seq)
+{
+    int32_t distance = (int32_t) (seq - window->highest);
+
+    if(!window->is_initialized || distance > HPB_SEQ_RESET_DISTANCE || distance < -HPB_SEQ_RESET_DISTANCE)
+    {
+        HpbSeqResult result = (window->is_initialized) ? HPB_SEQ_RESET : HPB_SEQ_NEW;
+        window->is_initialized = true;
+        window->highest = seq;
+        window->received_mask = UINT64_MAX; // Older messages are not expected
+        return result;
+    }
+
+    if(distance > 0)
+    {
+        window->received_mask = (distance >= HPB_SEQ_WINDOW_SIZE) ? 0 : (window->received_mask << distance);
+        window->received_mask |= 1;
+        window->highest = seq;
+        return HPB_SEQ_NEW;
+    }
+
+    if(-distance >= HPB_SEQ_WINDOW_SIZE) {
+        return HPB_SEQ_TOO_OLD;
+    }
+
+    uint64_t bit = ((uint64_t) 1) << (-distance);
+    if(window->received_mask & bit) {
+        return HPB_SEQ_DUPLICATE;
+    }
+
+    window->received_mask |= bit;
+    return HPB_SEQ_NEW;
+}
+
+size_t hpb_seq_window_get_missing(HpbSeqWindow *window, HpbSeqRange ranges[], size_t max_ranges)
+{
+    if(!window->is_initialized) {
+        return 0;
+    }
+
+    size_t n_ranges = 0;
+    bool is_in_range = false;
+
+    for(int i = HPB_SEQ_WINDOW_SIZE - 1; i > 0; i--)
+    {
+        bool is_missing = !(window->received_mask & (((uint64_t) 1) << i));
+        uint32_t seq = window->highest - (uint32_t) i;
+
+        if(is_missing && is_in_range) {
+            ranges[n_ranges - 1].last = seq;
+        }
+        else if(is_missing)
+        {
+            if(n_ranges == max_ranges) {
+                break;
+            }
+            ranges[n_ranges].first = seq;
+            ranges[n_ranges].last = seq;
+            n_ranges++;
+        }
+
+        is_in_range = is_missing;
+    }
+
+    return n_ranges;
+}
+
+size_t hpb_seq_window_count_missing(HpbSeqWindow *window)
+{
+    if(!window->is_initialized) {
+        return 0;
+    }
+
+    return (size_t) __builtin_popcountll(~(window->received_mask));
+}
+
+void hpb_seq_window_skip_missing(HpbSeqWindow *window)
+{
+    window->received_mask = UINT64_MAX;
+}
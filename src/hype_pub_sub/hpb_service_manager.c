@@ -1,12 +1,45 @@
 
 #include "hype_pub_sub/hpb_service_manager.h"
 
+//
+// Static functions declaration
+//
+
+static void hpb_service_manager_release_filter(HpbServiceManager *serv_man, HpbClient *client);
+static bool linked_list_callback_is_same_expression(void *filter, void *expression);
+static bool linked_list_callback_is_same_element(void *element1, void *element2);
+static void linked_list_callback_free_filter(void **element);
+
+//
+// Header functions implementation
+//
+
 HpbServiceManager *hpb_service_manager_create(HLByte service_key[SHA1_BLOCK_SIZE])
 {
     HpbServiceManager *servMan = (HpbServiceManager*) malloc(sizeof(HpbServiceManager));
     memcpy(servMan->service_key, service_key, SHA1_BLOCK_SIZE * sizeof(HLByte));
 
     servMan->subscribers = hpb_list_clients_create();
+    servMan->retained_msg = NULL;
+    servMan->retained_msg_length = 0;
+    memset(&(servMan->retained_origin), 0, sizeof(HpbPublishOrigin));
+    servMan->next_seq = (uint32_t) hpb_clock_now_us();
+    servMan->history = hpb_history_create(HPB_HISTORY_MAX_BYTES);
+    servMan->is_replica_dirty = true;
+    servMan->replicated_ms = 0;
+    servMan->pattern = NULL;
+    memcpy(servMan->placement_key, service_key, SHA1_BLOCK_SIZE * sizeof(HLByte));
+    servMan->filters = linked_list_create();
+    servMan->n_shards = 0;
+    servMan->is_shard_dirty = false;
+    servMan->sharded_ms = 0;
+    servMan->shard_owners = hpb_list_clients_create();
+    servMan->rate_window_ms = 0;
+    servMan->n_window_publishes = 0;
+    servMan->publish_rate = 0;
+    servMan->subscribers_version = 0;
+    servMan->pushed_version = 0;
+    servMan->direct_publishers = hpb_list_clients_create();
 
     return servMan;
 }
@@ -17,7 +50,11 @@ int hpb_service_manager_add_subscriber(HpbServiceManager *serv_man, HypeInstance
         return -1;
     }
 
+    size_t n_subscribers = serv_man->subscribers->size;
     hpb_list_clients_add(serv_man->subscribers, instance);
+    if(serv_man->subscribers->size != n_subscribers) {
+        serv_man->subscribers_version++;
+    }
     return 0;
 }
 
@@ -27,10 +64,152 @@ int hpb_service_manager_remove_subscriber(HpbServiceManager *serv_man, HypeInsta
         return -1;
     }
 
+    HpbClient *client = hpb_list_clients_find(serv_man->subscribers, instance);
+    if(client != NULL)
+    {
+        hpb_service_manager_release_filter(serv_man, client);
+        serv_man->subscribers_version++;
+    }
+
     hpb_list_clients_remove(serv_man->subscribers, instance);
     return 0;
 }
 
+int hpb_service_manager_set_retained_msg(HpbServiceManager *serv_man, HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    if(serv_man == NULL) {
+        return -1;
+    }
+
+    free(serv_man->retained_msg);
+    serv_man->retained_msg = NULL;
+    serv_man->retained_msg_length = 0;
+
+    if(msg == NULL || msg_length == 0) {
+        return 0;
+    }
+
+    serv_man->retained_msg = (char *) malloc(msg_length * sizeof(char));
+    memcpy(serv_man->retained_msg, msg, msg_length);
+    serv_man->retained_msg_length = msg_length;
+    serv_man->retained_origin = origin;
+    return 0;
+}
+
+int hpb_service_manager_set_pattern(HpbServiceManager *serv_man, char *pattern)
+{
+    if(serv_man == NULL || pattern == NULL || serv_man->pattern != NULL) {
+        return -1;
+    }
+
+    if(hpb_topic_get_rendezvous_key(pattern, strlen(pattern), serv_man->placement_key) != 0) {
+        return -1;
+    }
+
+    serv_man->pattern = strdup(pattern);
+    return 0;
+}
+
+int hpb_service_manager_set_filter(HpbServiceManager *serv_man, HypeInstance *instance, char *expression)
+{
+    if(serv_man == NULL) {
+        return -1;
+    }
+
+    HpbClient *client = hpb_list_clients_find(serv_man->subscribers, instance);
+    if(client == NULL) {
+        return -1;
+    }
+
+    // The direct publishers cannot evaluate the filters, so the change is pushed to them
+    serv_man->subscribers_version++;
+
+    if(expression == NULL)
+    {
+        hpb_service_manager_release_filter(serv_man, client);
+        return 0;
+    }
+
+    HpbFilter *filter = hpb_filter_compile(expression);
+    if(filter == NULL) {
+        return -1;
+    }
+
+    // The compiled filter is dropped in favour of the one already shared by other subscribers, if any
+    LinkedListNode *node = linked_list_find(serv_man->filters, filter->expression, linked_list_callback_is_same_expression);
+    HpbFilter *shared = (node != NULL) ? (HpbFilter *) node->element : NULL;
+    if(shared != NULL && shared == client->filter)
+    {
+        hpb_filter_destroy(&filter);
+        return 0;
+    }
+
+    hpb_service_manager_release_filter(serv_man, client);
+    if(shared != NULL) {
+        hpb_filter_destroy(&filter);
+    }
+    else
+    {
+        linked_list_add(serv_man->filters, filter);
+        shared = filter;
+    }
+
+    shared->n_subscribers++;
+    client->filter = shared;
+    return 0;
+}
+
+size_t hpb_service_manager_evaluate_filters(HpbServiceManager *serv_man, HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    if(serv_man == NULL || serv_man->filters->size == 0) {
+        return 0;
+    }
+
+    char *topic = NULL;
+    size_t topic_length = 0;
+    if(serv_man->pattern != NULL && hpb_topic_parse_payload(msg, msg_length, &topic, &topic_length, &msg, &msg_length) != 0) {
+        topic = NULL;
+    }
+
+    for(LinkedListNode *node = serv_man->filters->head; node != NULL; node = node->next) {
+        hpb_filter_evaluate((HpbFilter *) node->element, msg, msg_length, origin.publisher_tag, topic, topic_length);
+    }
+
+    return serv_man->filters->size;
+}
+
+void hpb_service_manager_get_shard_key(HpbServiceManager *serv_man, uint8_t shard, HLByte shard_key[])
+{
+    HLByte seed[SHA1_BLOCK_SIZE + HPB_SERVICE_MANAGER_SHARD_SIZE];
+    memcpy(seed, serv_man->service_key, SHA1_BLOCK_SIZE);
+    seed[SHA1_BLOCK_SIZE] = shard;
+    sha1_digest(seed, sizeof(seed), shard_key);
+}
+
+uint8_t hpb_service_manager_get_shard(HpbServiceManager *serv_man, HpbClient *client)
+{
+    if(serv_man->n_shards == 0) {
+        return 0;
+    }
+
+    // The keys of the clients are hashes, so they spread evenly over the shards
+    return (uint8_t) (binary_utils_read_uint32(client->key) % serv_man->n_shards);
+}
+
+void hpb_service_manager_count_publishes(HpbServiceManager *serv_man, uint32_t n_publishes, uint64_t now_ms)
+{
+    if(now_ms >= serv_man->rate_window_ms + HPB_SERVICE_MANAGER_RATE_WINDOW_MS)
+    {
+        // A window without publishes in between leaves a rate of 0
+        bool is_last_window = (now_ms < serv_man->rate_window_ms + 2 * HPB_SERVICE_MANAGER_RATE_WINDOW_MS);
+        serv_man->publish_rate = is_last_window ? serv_man->n_window_publishes * 1000 / HPB_SERVICE_MANAGER_RATE_WINDOW_MS : 0;
+        serv_man->n_window_publishes = 0;
+        serv_man->rate_window_ms = now_ms;
+    }
+
+    serv_man->n_window_publishes += n_publishes;
+}
+
 void hpb_service_manager_destroy(HpbServiceManager **serv_man)
 {
     if((*serv_man) == NULL) {
@@ -38,6 +217,45 @@ void hpb_service_manager_destroy(HpbServiceManager **serv_man)
     }
 
     hpb_list_clients_destroy(&((*serv_man)->subscribers));
+    free((*serv_man)->retained_msg);
+    free((*serv_man)->pattern);
+    linked_list_destroy(&((*serv_man)->filters), linked_list_callback_free_filter);
+    hpb_list_clients_destroy(&((*serv_man)->shard_owners));
+    hpb_list_clients_destroy(&((*serv_man)->direct_publishers));
+    hpb_history_destroy(&((*serv_man)->history));
     free(*serv_man);
     (*serv_man) = NULL;
 }
+
+//
+// Static functions implementation
+//
+
+static void hpb_service_manager_release_filter(HpbServiceManager *serv_man, HpbClient *client)
+{
+    HpbFilter *filter = client->filter;
+    if(filter == NULL) {
+        return;
+    }
+
+    client->filter = NULL;
+    filter->n_subscribers--;
+    if(filter->n_subscribers == 0) {
+        linked_list_remove(serv_man->filters, filter, linked_list_callback_is_same_element, linked_list_callback_free_filter);
+    }
+}
+
+static bool linked_list_callback_is_same_expression(void *filter, void *expression)
+{
+    return strcmp(((HpbFilter *) filter)->expression, (char *) expression) == 0;
+}
+
+static bool linked_list_callback_is_same_element(void *element1, void *element2)
+{
+    return element1 == element2;
+}
+
+static void linked_list_callback_free_filter(void **element)
+{
+    hpb_filter_destroy((HpbFilter **) element);
+}
@@ -0,0 +1,463 @@
+
+#include "hype_pub_sub/hpb_sim.h"
+
+static HpbSim *hpb_sim_clock = NULL;
+
+//
+// Static functions declaration
+//
+
+static int hpb_sim_transport_start(HpbTransport *transport);
+static void hpb_sim_transport_stop(HpbTransport *transport);
+static HypeInstance *hpb_sim_transport_get_own_instance(HpbTransport *transport);
+static uint64_t hpb_sim_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination);
+static void hpb_sim_transport_resolve(HpbTransport *transport, HypeInstance *instance);
+static void hpb_sim_transport_destroy(HpbTransport *transport);
+
+static uint64_t hpb_sim_clock_now_us();
+static HpbSimLink *hpb_sim_get_link(HpbSim *sim, size_t from, size_t to);
+static uint64_t hpb_sim_get_delay_us(HpbSim *sim, HpbSimLink *link);
+static void hpb_sim_schedule(HpbSim *sim, uint64_t time_us, HpbSimEventType type, size_t node, size_t peer, uint64_t message_id,
+                             HLByte *data, size_t data_size);
+static bool hpb_sim_is_before(HpbSimEvent *event1, HpbSimEvent *event2);
+static HpbSimEvent hpb_sim_pop(HpbSim *sim);
+static void hpb_sim_hash(HpbSim *sim, const void *data, size_t size);
+static void hpb_sim_process(HpbSim *sim, HpbSimEvent *event);
+static void linked_list_callback_free_link_override(void **element);
+
+static const HpbTransportOps hpb_sim_transport_ops = {
+    "sim",
+    hpb_sim_transport_start,
+    hpb_sim_transport_stop,
+    hpb_sim_transport_get_own_instance,
+    hpb_sim_transport_send,
+    hpb_sim_transport_resolve,
+    hpb_sim_transport_destroy
+};
+
+//
+// Header functions implementation
+//
+
+HpbSim *hpb_sim_create(HpbSimLink link, uint64_t seed)
+{
+    if(hpb_sim_clock != NULL) {
+        return NULL;
+    }
+
+    HpbSim *sim = (HpbSim *) calloc(1, sizeof(HpbSim));
+    if(sim == NULL) {
+        return NULL;
+    }
+
+    sim->events = (HpbSimEvent *) malloc(HPB_SIM_INITIAL_EVENTS * sizeof(HpbSimEvent));
+    sim->max_events = HPB_SIM_INITIAL_EVENTS;
+    sim->link = link;
+    sim->link_overrides = linked_list_create();
+    sim->rng = seed;
+    sim->trace_hash = HPB_SIM_TRACE_HASH_BASIS;
+
+    // The virtual time starts away from 0, which the HypePubSub timers use as "not set"
+    sim->now_us = 1000000;
+    hpb_sim_clock = sim;
+    hpb_clock_set_source(hpb_sim_clock_now_us);
+    return sim;
+}
+
+size_t hpb_sim_add_node(HpbSim *sim, uint8_t capacity)
+{
+    if(sim->n_nodes == sim->max_nodes)
+    {
+        sim->max_nodes = (sim->max_nodes == 0) ? 64 : 2 * sim->max_nodes;
+        sim->nodes = (HpbSimNode **) realloc(sim->nodes, sim->max_nodes * sizeof(HpbSimNode *));
+    }
+
+    HpbSimNode *node = (HpbSimNode *) calloc(1, sizeof(HpbSimNode));
+    node->sim = sim;
+    node->index = sim->n_nodes;
+    node->next_message_id = 1;
+
+    // The identifier of a node is its index, and its announcement carries its capacity as with the SDK
+    HLByte id[HPB_SIM_ID_SIZE] = {0};
+    id[0] = (HLByte) (node->index >> 24);
+    id[1] = (HLByte) (node->index >> 16);
+    id[2] = (HLByte) (node->index >> 8);
+    id[3] = (HLByte) node->index;
+    HypeBuffer *identifier = hype_buffer_create_from(id, HPB_SIM_ID_SIZE);
+    HypeBuffer *announcement = hype_buffer_create_from(&capacity, sizeof(capacity));
+    node->instance = hype_instance_create(identifier, announcement, true);
+    hype_buffer_release(identifier);
+    hype_buffer_release(announcement);
+
+    node->transport = hpb_transport_create(&hpb_sim_transport_ops, NULL, hpb_transport_get_pub_sub_callbacks(NULL), node);
+    node->context = hpb_create(node->transport);
+
+    // The fan-outs are sent from the simulation thread, so that the order of the events does not depend on the scheduler
+    hpb_fanout_set_workers(node->context->fanout, 0);
+    sim->nodes[sim->n_nodes++] = node;
+
+    // The periodic tasks of the nodes are spread over their interval instead of running all at once
+    hpb_transport_start(node->transport);
+    uint64_t offset_us = hpb_sim_random(sim) % (HPB_PERIODIC_TASKS_INTERVAL_MS * 1000);
+    hpb_sim_schedule(sim, sim->now_us + offset_us, HPB_SIM_EVENT_PERIODIC, node->index, node->index, 0, NULL, 0);
+
+    for(size_t i = 0; i < node->index; i++)
+    {
+        if(sim->nodes[i]->context == NULL) {
+            continue;
+        }
+
+        hpb_sim_schedule(sim, sim->now_us + hpb_sim_get_delay_us(sim, hpb_sim_get_link(sim, i, node->index)), HPB_SIM_EVENT_FOUND, i, node->index, 0, NULL, 0);
+        hpb_sim_schedule(sim, sim->now_us + hpb_sim_get_delay_us(sim, hpb_sim_get_link(sim, node->index, i)), HPB_SIM_EVENT_FOUND, node->index, i, 0, NULL, 0);
+    }
+
+    return node->index;
+}
+
+void hpb_sim_remove_node(HpbSim *sim, size_t index)
+{
+    if(!hpb_sim_is_node_present(sim, index)) {
+        return;
+    }
+
+    HpbSimNode *node = sim->nodes[index];
+    hpb_destroy_context(&(node->context));
+
+    // The nodes present notice the loss once the link times out
+    for(size_t i = 0; i < sim->n_nodes; i++)
+    {
+        if(i != index && sim->nodes[i]->context != NULL) {
+            hpb_sim_schedule(sim, sim->now_us + hpb_sim_get_delay_us(sim, hpb_sim_get_link(sim, index, i)), HPB_SIM_EVENT_LOST, i, index, 0, NULL, 0);
+        }
+    }
+}
+
+bool hpb_sim_is_node_present(HpbSim *sim, size_t index)
+{
+    return index < sim->n_nodes && sim->nodes[index]->context != NULL;
+}
+
+void hpb_sim_set_link(HpbSim *sim, size_t from, size_t to, HpbSimLink link)
+{
+    for(LinkedListNode *node = sim->link_overrides->head; node != NULL; node = node->next)
+    {
+        HpbSimLinkOverride *link_override = (HpbSimLinkOverride *) node->element;
+        if(link_override->from == from && link_override->to == to)
+        {
+            link_override->link = link;
+            return;
+        }
+    }
+
+    HpbSimLinkOverride *link_override = (HpbSimLinkOverride *) malloc(sizeof(HpbSimLinkOverride));
+    link_override->from = from;
+    link_override->to = to;
+    link_override->link = link;
+    linked_list_add(sim->link_overrides, link_override);
+}
+
+int hpb_sim_select_node(HpbSim *sim, size_t index)
+{
+    if(!hpb_sim_is_node_present(sim, index)) {
+        return -1;
+    }
+
+    hpb_set_current(sim->nodes[index]->context);
+    sim->current = index;
+    return 0;
+}
+
+uint64_t hpb_sim_run(HpbSim *sim, uint64_t duration_us)
+{
+    uint64_t end_us = sim->now_us + duration_us;
+    uint64_t n_processed = 0;
+
+    while(sim->n_events > 0 && sim->events[0].time_us <= end_us)
+    {
+        HpbSimEvent event = hpb_sim_pop(sim);
+        sim->now_us = event.time_us;
+        if(sim->nodes[event.node]->context != NULL)
+        {
+            uint64_t fields[] = {event.time_us, event.type, event.node, event.peer, event.data_size};
+            hpb_sim_hash(sim, fields, sizeof(fields));
+            hpb_sim_hash(sim, event.data, event.data_size);
+        }
+        hpb_sim_process(sim, &event);
+        free(event.data);
+        n_processed++;
+    }
+
+    sim->now_us = end_us;
+    return n_processed;
+}
+
+size_t hpb_sim_get_node_index(HypeInstance *instance)
+{
+    return (size_t) binary_utils_read_uint32(instance->identifier->data);
+}
+
+uint64_t hpb_sim_random(HpbSim *sim)
+{
+    // splitmix64, which is fast and good enough for the jitter and the losses
+    uint64_t z = (sim->rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void hpb_sim_destroy(HpbSim **sim)
+{
+    if((*sim) == NULL) {
+        return;
+    }
+
+    for(size_t i = 0; i < (*sim)->n_nodes; i++)
+    {
+        HpbSimNode *node = (*sim)->nodes[i];
+        hpb_destroy_context(&(node->context));
+        hpb_transport_destroy(&(node->transport));
+        hype_instance_release(node->instance);
+        free(node);
+    }
+
+    for(size_t i = 0; i < (*sim)->n_events; i++) {
+        free((*sim)->events[i].data);
+    }
+
+    free((*sim)->nodes);
+    free((*sim)->events);
+    linked_list_destroy(&((*sim)->link_overrides), linked_list_callback_free_link_override);
+    free(*sim);
+    (*sim) = NULL;
+
+    hpb_sim_clock = NULL;
+    hpb_clock_set_source(NULL);
+}
+
+//
+// Static functions implementation
+//
+
+static int hpb_sim_transport_start(HpbTransport *transport)
+{
+    HpbSimNode *node = (HpbSimNode *) transport->state;
+    hpb_sim_schedule(node->sim, node->sim->now_us, HPB_SIM_EVENT_START, node->index, node->index, 0, NULL, 0);
+    return 0;
+}
+
+static void hpb_sim_transport_stop(HpbTransport *transport)
+{
+    // The node is stopped by removing it from the simulation
+}
+
+static HypeInstance *hpb_sim_transport_get_own_instance(HpbTransport *transport)
+{
+    HpbSimNode *node = (HpbSimNode *) transport->state;
+    return hype_instance_create(node->instance->identifier, node->instance->announcement, node->instance->is_resolved);
+}
+
+static uint64_t hpb_sim_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination)
+{
+    HpbSimNode *node = (HpbSimNode *) transport->state;
+    HpbSim *sim = node->sim;
+    size_t to = hpb_sim_get_node_index(destination);
+    HpbSimLink *link = hpb_sim_get_link(sim, node->index, to);
+    uint64_t message_id = node->next_message_id++;
+
+    sim->n_sent++;
+    sim->bytes_sent += data_size;
+    sim->n_sent_by_type[(data_size > 0) ? hpb_protocol_get_message_type(data) : INVALID]++;
+
+    // A message lost or sent to a node not present is reported as failed once the link times out
+    if(!hpb_sim_is_node_present(sim, to) || (double) hpb_sim_random(sim) / UINT64_MAX < link->loss)
+    {
+        sim->n_lost++;
+        hpb_sim_schedule(sim, sim->now_us + 2 * link->latency_us, HPB_SIM_EVENT_SEND_FAILED, node->index, to, message_id, NULL, 0);
+        return message_id;
+    }
+
+    // The messages of a node leave one after the other at the bandwidth of the link
+    uint64_t start_us = (node->uplink_free_us > sim->now_us) ? node->uplink_free_us : sim->now_us;
+    uint64_t transmission_us = (link->bandwidth > 0) ? (data_size * 1000000) / link->bandwidth : 0;
+    node->uplink_free_us = start_us + transmission_us;
+    uint64_t arrival_us = node->uplink_free_us + hpb_sim_get_delay_us(sim, link);
+
+    HLByte *copy = (HLByte *) malloc(data_size);
+    memcpy(copy, data, data_size);
+    hpb_sim_schedule(sim, arrival_us, HPB_SIM_EVENT_RECEIVED, to, node->index, 0, copy, data_size);
+    hpb_sim_schedule(sim, arrival_us + link->latency_us, HPB_SIM_EVENT_DELIVERED, node->index, to, message_id, NULL, 0);
+    return message_id;
+}
+
+static void hpb_sim_transport_resolve(HpbTransport *transport, HypeInstance *instance)
+{
+    HpbSimNode *node = (HpbSimNode *) transport->state;
+    HpbSim *sim = node->sim;
+    size_t peer = hpb_sim_get_node_index(instance);
+    uint64_t latency_us = hpb_sim_get_link(sim, node->index, peer)->latency_us;
+
+    if(!hpb_sim_is_node_present(sim, peer))
+    {
+        hpb_sim_schedule(sim, sim->now_us + 2 * latency_us, HPB_SIM_EVENT_FAILED_RESOLVING, node->index, peer, 0, NULL, 0);
+        return;
+    }
+
+    // The handshake resolves both nodes: the peer when the request arrives and this node when the answer does
+    hpb_sim_schedule(sim, sim->now_us + latency_us, HPB_SIM_EVENT_RESOLVED, peer, node->index, 0, NULL, 0);
+    hpb_sim_schedule(sim, sim->now_us + 2 * latency_us, HPB_SIM_EVENT_RESOLVED, node->index, peer, 0, NULL, 0);
+}
+
+static void hpb_sim_transport_destroy(HpbTransport *transport)
+{
+    // The node is owned by the simulation
+}
+
+static uint64_t hpb_sim_clock_now_us()
+{
+    return hpb_sim_clock->now_us;
+}
+
+static HpbSimLink *hpb_sim_get_link(HpbSim *sim, size_t from, size_t to)
+{
+    for(LinkedListNode *node = sim->link_overrides->head; node != NULL; node = node->next)
+    {
+        HpbSimLinkOverride *link_override = (HpbSimLinkOverride *) node->element;
+        if(link_override->from == from && link_override->to == to) {
+            return &(link_override->link);
+        }
+    }
+
+    return &(sim->link);
+}
+
+static uint64_t hpb_sim_get_delay_us(HpbSim *sim, HpbSimLink *link)
+{
+    if(link->jitter_us == 0) {
+        return link->latency_us;
+    }
+
+    return link->latency_us + hpb_sim_random(sim) % (link->jitter_us + 1);
+}
+
+static void hpb_sim_schedule(HpbSim *sim, uint64_t time_us, HpbSimEventType type, size_t node, size_t peer, uint64_t message_id,
+                             HLByte *data, size_t data_size)
+{
+    if(sim->n_events == sim->max_events)
+    {
+        sim->max_events *= 2;
+        sim->events = (HpbSimEvent *) realloc(sim->events, sim->max_events * sizeof(HpbSimEvent));
+    }
+
+    HpbSimEvent event = {time_us, sim->next_seq++, type, node, peer, message_id, data, data_size};
+
+    // Sift up in the heap
+    size_t i = sim->n_events++;
+    while(i > 0 && hpb_sim_is_before(&event, &(sim->events[(i - 1) / 2])))
+    {
+        sim->events[i] = sim->events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    sim->events[i] = event;
+}
+
+static bool hpb_sim_is_before(HpbSimEvent *event1, HpbSimEvent *event2)
+{
+    // The events of the same time are processed in the order in which they were scheduled
+    return event1->time_us < event2->time_us || (event1->time_us == event2->time_us && event1->seq < event2->seq);
+}
+
+static HpbSimEvent hpb_sim_pop(HpbSim *sim)
+{
+    HpbSimEvent first = sim->events[0];
+    HpbSimEvent last = sim->events[--sim->n_events];
+
+    // Sift down the last event from the root
+    size_t i = 0;
+    while(2 * i + 1 < sim->n_events)
+    {
+        size_t child = 2 * i + 1;
+        if(child + 1 < sim->n_events && hpb_sim_is_before(&(sim->events[child + 1]), &(sim->events[child]))) {
+            child++;
+        }
+        if(!hpb_sim_is_before(&(sim->events[child]), &last)) {
+            break;
+        }
+
+        sim->events[i] = sim->events[child];
+        i = child;
+    }
+    if(sim->n_events > 0) {
+        sim->events[i] = last;
+    }
+
+    return first;
+}
+
+static void hpb_sim_hash(HpbSim *sim, const void *data, size_t size)
+{
+    const HLByte *bytes = (const HLByte *) data;
+    for(size_t i = 0; i < size; i++) {
+        sim->trace_hash = (sim->trace_hash ^ bytes[i]) * HPB_SIM_TRACE_HASH_PRIME;
+    }
+}
+
+static void hpb_sim_process(HpbSim *sim, HpbSimEvent *event)
+{
+    HpbSimNode *node = sim->nodes[event->node];
+    if(node->context == NULL) { // Events of the nodes removed are dropped
+        return;
+    }
+
+    HpbTransportCallbacks *callbacks = &(node->transport->callbacks);
+    HypeInstance *peer_instance = sim->nodes[event->peer]->instance;
+    hpb_set_current(node->context);
+    sim->current = node->index;
+
+    switch(event->type)
+    {
+        case HPB_SIM_EVENT_START:
+            if(callbacks->on_start != NULL) {
+                callbacks->on_start(true);
+            }
+            break;
+        case HPB_SIM_EVENT_PERIODIC:
+            hpb_process_periodic_tasks();
+            hpb_sim_schedule(sim, sim->now_us + HPB_PERIODIC_TASKS_INTERVAL_MS * 1000, HPB_SIM_EVENT_PERIODIC, node->index, node->index, 0, NULL, 0);
+            break;
+        case HPB_SIM_EVENT_FOUND:
+            if(hpb_sim_is_node_present(sim, event->peer)) {
+                callbacks->on_instance_found(peer_instance);
+            }
+            break;
+        case HPB_SIM_EVENT_RESOLVED:
+            if(hpb_sim_is_node_present(sim, event->peer))
+            {
+                sim->n_membership_events++;
+                callbacks->on_instance_resolved(peer_instance);
+            }
+            break;
+        case HPB_SIM_EVENT_FAILED_RESOLVING:
+            callbacks->on_instance_failed_resolving(peer_instance);
+            break;
+        case HPB_SIM_EVENT_LOST:
+            sim->n_membership_events++;
+            callbacks->on_instance_lost(peer_instance);
+            break;
+        case HPB_SIM_EVENT_RECEIVED:
+            sim->n_delivered++;
+            callbacks->on_message_received(peer_instance, event->data, event->data_size);
+            break;
+        case HPB_SIM_EVENT_DELIVERED:
+            callbacks->on_message_delivered(event->message_id);
+            break;
+        case HPB_SIM_EVENT_SEND_FAILED:
+            callbacks->on_message_send_failed(event->message_id);
+            break;
+    }
+}
+
+static void linked_list_callback_free_link_override(void **element)
+{
+    free(*element);
+    (*element) = NULL;
+}
@@ -0,0 +1,337 @@
+
+#include "hype_pub_sub/hpb_sim_scenario.h"
+
+// The state of the scenario running, which the message received callback of the nodes needs
+static HpbSim *hpb_scenario_sim = NULL;
+static HpbSimPublish *hpb_scenario_publishes = NULL;
+static size_t hpb_scenario_n_publishes = 0;
+
+//
+// Static functions declaration
+//
+
+static void hpb_sim_scenario_join(const HpbSimScenario *scenario, HpbSimScenarioNode **nodes);
+static void hpb_sim_scenario_leave();
+static void hpb_sim_scenario_publish(const HpbSimScenario *scenario, HpbSimScenarioNode *nodes);
+static uint64_t hpb_sim_scenario_next_publish_us(const HpbSimScenario *scenario);
+static void hpb_sim_scenario_run_phase(const HpbSimScenario *scenario, HpbSimScenarioNode **nodes, uint64_t duration_us,
+                                       size_t n_joins, size_t n_leaves, uint64_t *next_publish_us);
+static double hpb_sim_scenario_cpu_ms();
+static void hpb_sim_scenario_on_message_received(char *service_name, char *msg, size_t msg_length);
+
+//
+// Header functions implementation
+//
+
+int hpb_sim_scenario_run(const HpbSimScenario *scenario, HpbSimReport *report)
+{
+    if(scenario->n_nodes == 0 || scenario->n_topics == 0 || scenario->subscriptions_per_node > scenario->n_topics) {
+        return -1;
+    }
+
+    HpbSim *sim = hpb_sim_create(scenario->link, scenario->seed);
+    if(sim == NULL) {
+        return -1;
+    }
+
+    memset(report, 0, sizeof(HpbSimReport));
+    hpb_scenario_sim = sim;
+    hpb_scenario_publishes = NULL;
+    hpb_scenario_n_publishes = 0;
+    HpbSimScenarioNode *nodes = NULL;
+
+    for(size_t i = 0; i < scenario->n_nodes; i++) {
+        hpb_sim_scenario_join(scenario, &nodes);
+    }
+    hpb_sim_run(sim, HPB_SIM_SCENARIO_FORMATION_US);
+
+    uint64_t n_sent_by_type[HPB_SIM_N_MESSAGE_TYPES];
+    memcpy(n_sent_by_type, sim->n_sent_by_type, sizeof(n_sent_by_type));
+    uint64_t n_lost = sim->n_lost;
+    uint64_t next_publish_us = hpb_sim_scenario_next_publish_us(scenario);
+
+    for(size_t storm = 0; storm <= scenario->n_storms; storm++)
+    {
+        // The mesh runs without churn for a whole interval before the first storm, and for the rest of the interval after each storm
+        uint64_t storm_us = (storm == 0) ? 0 : scenario->storm_duration_us + HPB_SIM_SCENARIO_SETTLE_US;
+        uint64_t quiet_us = (scenario->storm_interval_us > storm_us) ? scenario->storm_interval_us - storm_us : 0;
+
+        if(storm_us > 0)
+        {
+            uint64_t n_sent = sim->n_sent;
+            uint64_t bytes_sent = sim->bytes_sent;
+            uint64_t n_instance_events = sim->n_membership_events;
+            double cpu_start_ms = hpb_sim_scenario_cpu_ms();
+            hpb_sim_scenario_run_phase(scenario, &nodes, storm_us, scenario->storm_joins, scenario->storm_leaves, &next_publish_us);
+            report->storm_cpu_ms += hpb_sim_scenario_cpu_ms() - cpu_start_ms;
+            report->storm_us += storm_us;
+            report->storm_msgs += sim->n_sent - n_sent;
+            report->storm_bytes += sim->bytes_sent - bytes_sent;
+            report->n_instance_events += sim->n_membership_events - n_instance_events;
+            report->n_joins += scenario->storm_joins;
+            report->n_leaves += scenario->storm_leaves;
+        }
+
+        if(quiet_us > 0)
+        {
+            uint64_t n_sent = sim->n_sent;
+            uint64_t bytes_sent = sim->bytes_sent;
+            double cpu_start_ms = hpb_sim_scenario_cpu_ms();
+            hpb_sim_scenario_run_phase(scenario, &nodes, quiet_us, 0, 0, &next_publish_us);
+            report->quiet_cpu_ms += hpb_sim_scenario_cpu_ms() - cpu_start_ms;
+            report->quiet_us += quiet_us;
+            report->quiet_msgs += sim->n_sent - n_sent;
+            report->quiet_bytes += sim->bytes_sent - bytes_sent;
+        }
+    }
+
+    // The last messages published are given the time to arrive
+    hpb_sim_run(sim, HPB_SIM_SCENARIO_SETTLE_US);
+
+    // Only the subscribers which stayed until the end are expected to receive the messages
+    for(size_t i = 0; i < hpb_scenario_n_publishes; i++)
+    {
+        HpbSimPublish *publish = &(hpb_scenario_publishes[i]);
+        for(size_t j = 0; j < publish->n_subscribers; j++)
+        {
+            if(hpb_sim_is_node_present(sim, publish->subscribers[j]))
+            {
+                report->n_expected++;
+                report->n_received += (publish->is_received[j]) ? 1 : 0;
+            }
+        }
+        free(publish->subscribers);
+        free(publish->is_received);
+    }
+
+    for(int i = 0; i < HPB_SIM_N_MESSAGE_TYPES; i++) {
+        report->n_sent_by_type[i] = sim->n_sent_by_type[i] - n_sent_by_type[i];
+    }
+    report->n_lost = sim->n_lost - n_lost;
+    report->n_published = hpb_scenario_n_publishes;
+    report->trace_hash = sim->trace_hash;
+
+    for(size_t i = 0; i < sim->n_nodes; i++) {
+        free(nodes[i].topics);
+    }
+    free(nodes);
+    free(hpb_scenario_publishes);
+    hpb_scenario_publishes = NULL;
+    hpb_scenario_n_publishes = 0;
+    hpb_scenario_sim = NULL;
+    hpb_sim_destroy(&sim);
+    return 0;
+}
+
+void hpb_sim_scenario_print_report(FILE *out, const HpbSimScenario *scenario, const HpbSimReport *report)
+{
+    uint64_t n_changes = report->n_joins + report->n_leaves;
+
+    fprintf(out, "scenario %s (seed %llu)\n", scenario->name, (unsigned long long) scenario->seed);
+    fprintf(out, "  nodes: %zu, joined %llu, left %llu, instance events %llu\n", scenario->n_nodes,
+            (unsigned long long) report->n_joins, (unsigned long long) report->n_leaves,
+            (unsigned long long) report->n_instance_events);
+    fprintf(out, "  storms: %llu msgs, %llu bytes in %.1f s; quiet: %llu msgs, %llu bytes in %.1f s\n",
+            (unsigned long long) report->storm_msgs, (unsigned long long) report->storm_bytes, report->storm_us / 1e6,
+            (unsigned long long) report->quiet_msgs, (unsigned long long) report->quiet_bytes, report->quiet_us / 1e6);
+    if(n_changes > 0)
+    {
+        // The raw traffic of the storms, since the quiet rate changes with the membership and is within the noise of a storm
+        fprintf(out, "  per membership event: %.1f msgs, %.0f bytes sent during the storms; quiet rate: %.1f msgs/s, %.0f bytes/s\n",
+                (double) report->storm_msgs / n_changes, (double) report->storm_bytes / n_changes,
+                (report->quiet_us > 0) ? report->quiet_msgs * 1e6 / report->quiet_us : 0.0,
+                (report->quiet_us > 0) ? report->quiet_bytes * 1e6 / report->quiet_us : 0.0);
+    }
+    fprintf(out, "  delivery: %llu/%llu (%.4f) of %llu publishes, %llu msgs lost\n", (unsigned long long) report->n_received,
+            (unsigned long long) report->n_expected, (report->n_expected > 0) ? (double) report->n_received / report->n_expected : 1.0,
+            (unsigned long long) report->n_published, (unsigned long long) report->n_lost);
+
+    fprintf(out, "  sent:");
+    for(int i = 0; i < HPB_SIM_N_MESSAGE_TYPES; i++)
+    {
+        if(report->n_sent_by_type[i] > 0) {
+            fprintf(out, " %s=%llu", hpb_protocol_get_message_type_name((MessageType) i), (unsigned long long) report->n_sent_by_type[i]);
+        }
+    }
+    fprintf(out, "\n");
+    fprintf(out, "  trace: %016llx\n", (unsigned long long) report->trace_hash);
+}
+
+//
+// Static functions implementation
+//
+
+static void hpb_sim_scenario_join(const HpbSimScenario *scenario, HpbSimScenarioNode **nodes)
+{
+    HpbSim *sim = hpb_scenario_sim;
+    size_t index = hpb_sim_add_node(sim, 1);
+    (*nodes) = (HpbSimScenarioNode *) realloc(*nodes, sim->n_nodes * sizeof(HpbSimScenarioNode));
+    HpbSimScenarioNode *node = &((*nodes)[index]);
+    node->topics = (size_t *) malloc(scenario->subscriptions_per_node * sizeof(size_t));
+    node->subscribed_us = sim->now_us;
+
+    hpb_sim_select_node(sim, index);
+    hpb_set_message_received_callback(hpb_sim_scenario_on_message_received);
+
+    for(size_t i = 0; i < scenario->subscriptions_per_node; i++)
+    {
+        // Distinct topics, drawn at random
+        bool is_chosen;
+        do
+        {
+            node->topics[i] = hpb_sim_random(sim) % scenario->n_topics;
+            is_chosen = false;
+            for(size_t j = 0; j < i; j++) {
+                is_chosen = is_chosen || node->topics[j] == node->topics[i];
+            }
+        } while(is_chosen);
+
+        char service_name[HPB_SIM_SCENARIO_MAX_MSG_SIZE];
+        snprintf(service_name, sizeof(service_name), "topic-%zu", node->topics[i]);
+        hpb_issue_subscribe_req(service_name);
+    }
+}
+
+static void hpb_sim_scenario_leave()
+{
+    HpbSim *sim = hpb_scenario_sim;
+    size_t n_present = 0;
+    for(size_t i = 0; i < sim->n_nodes; i++) {
+        n_present += hpb_sim_is_node_present(sim, i) ? 1 : 0;
+    }
+
+    // The last node stays, so that the mesh never empties
+    if(n_present <= 1) {
+        return;
+    }
+
+    size_t leaving = hpb_sim_random(sim) % n_present;
+    for(size_t i = 0; i < sim->n_nodes; i++)
+    {
+        if(hpb_sim_is_node_present(sim, i) && leaving-- == 0)
+        {
+            hpb_sim_remove_node(sim, i);
+            return;
+        }
+    }
+}
+
+static void hpb_sim_scenario_publish(const HpbSimScenario *scenario, HpbSimScenarioNode *nodes)
+{
+    HpbSim *sim = hpb_scenario_sim;
+    size_t topic = hpb_sim_random(sim) % scenario->n_topics;
+
+    hpb_scenario_publishes = (HpbSimPublish *) realloc(hpb_scenario_publishes, (hpb_scenario_n_publishes + 1) * sizeof(HpbSimPublish));
+    HpbSimPublish *publish = &(hpb_scenario_publishes[hpb_scenario_n_publishes]);
+    publish->subscribers = (size_t *) malloc(sim->n_nodes * sizeof(size_t));
+    publish->n_subscribers = 0;
+
+    // The nodes which subscribed to the topic before the publish expect the message
+    for(size_t i = 0; i < sim->n_nodes; i++)
+    {
+        if(!hpb_sim_is_node_present(sim, i) || nodes[i].subscribed_us >= sim->now_us) {
+            continue;
+        }
+
+        for(size_t j = 0; j < scenario->subscriptions_per_node; j++)
+        {
+            if(nodes[i].topics[j] == topic)
+            {
+                publish->subscribers[publish->n_subscribers++] = i;
+                break;
+            }
+        }
+    }
+    publish->is_received = (bool *) calloc(publish->n_subscribers + 1, sizeof(bool));
+
+    // The publisher is drawn among the nodes present
+    size_t publisher;
+    do {
+        publisher = hpb_sim_random(sim) % sim->n_nodes;
+    } while(!hpb_sim_is_node_present(sim, publisher));
+
+    char service_name[HPB_SIM_SCENARIO_MAX_MSG_SIZE];
+    char msg[HPB_SIM_SCENARIO_MAX_MSG_SIZE];
+    snprintf(service_name, sizeof(service_name), "topic-%zu", topic);
+    int msg_length = snprintf(msg, sizeof(msg), "%zu", hpb_scenario_n_publishes);
+    hpb_scenario_n_publishes++;
+
+    hpb_sim_select_node(sim, publisher);
+    hpb_issue_publish_req(service_name, msg, msg_length + 1);
+}
+
+static uint64_t hpb_sim_scenario_next_publish_us(const HpbSimScenario *scenario)
+{
+    if(scenario->publish_interval_us == 0) {
+        return UINT64_MAX;
+    }
+
+    // Uniform around the mean interval, which keeps the runs free of floating point
+    return hpb_scenario_sim->now_us + 1 + hpb_sim_random(hpb_scenario_sim) % (2 * scenario->publish_interval_us);
+}
+
+static void hpb_sim_scenario_run_phase(const HpbSimScenario *scenario, HpbSimScenarioNode **nodes, uint64_t duration_us,
+                                       size_t n_joins, size_t n_leaves, uint64_t *next_publish_us)
+{
+    HpbSim *sim = hpb_scenario_sim;
+    uint64_t start_us = sim->now_us;
+    uint64_t end_us = start_us + duration_us;
+    size_t n_changes = n_joins + n_leaves;
+    size_t n_done = 0;
+
+    while(true)
+    {
+        uint64_t next_change_us = (n_done < n_changes) ? start_us + (n_done * scenario->storm_duration_us) / n_changes : UINT64_MAX;
+        uint64_t next_us = end_us;
+        next_us = (next_change_us < next_us) ? next_change_us : next_us;
+        next_us = ((*next_publish_us) < next_us) ? (*next_publish_us) : next_us;
+        hpb_sim_run(sim, next_us - sim->now_us);
+
+        if(next_us == next_change_us)
+        {
+            // The joins and the leaves of the storm come in a random order
+            if(hpb_sim_random(sim) % (n_joins + n_leaves) < n_joins)
+            {
+                hpb_sim_scenario_join(scenario, nodes);
+                n_joins--;
+            }
+            else
+            {
+                hpb_sim_scenario_leave();
+                n_leaves--;
+            }
+            n_done++;
+        }
+        else if(next_us == (*next_publish_us))
+        {
+            hpb_sim_scenario_publish(scenario, *nodes);
+            (*next_publish_us) = hpb_sim_scenario_next_publish_us(scenario);
+        }
+        else {
+            break;
+        }
+    }
+}
+
+static double hpb_sim_scenario_cpu_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void hpb_sim_scenario_on_message_received(char *service_name, char *msg, size_t msg_length)
+{
+    size_t index = strtoull(msg, NULL, 10);
+    if(hpb_scenario_sim == NULL || index >= hpb_scenario_n_publishes) {
+        return;
+    }
+
+    HpbSimPublish *publish = &(hpb_scenario_publishes[index]);
+    for(size_t i = 0; i < publish->n_subscribers; i++)
+    {
+        if(publish->subscribers[i] == hpb_scenario_sim->current) {
+            publish->is_received[i] = true;
+        }
+    }
+}
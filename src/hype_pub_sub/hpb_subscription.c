@@ -10,9 +10,30 @@ HpbSubscription *hpb_subscription_create(char *serv_name, size_t serv_name_len,
     strncpy(subs->service_name, (const char*) serv_name, serv_name_len);
     sha1_digest((const BYTE *) serv_name, serv_name_len, subs->service_key);
     subs->manager_instance = hype_instance_create(instance->identifier,instance->announcement, instance->is_resolved);
+    hpb_subscription_reset_sequence(subs);
+    hpb_dedup_cache_reset(&(subs->dedup_cache));
+    subs->dedup_cache.n_suppressed = 0;
+    subs->manager_change_ms = 0;
+    subs->filter = NULL;
+
+    // Wildcard subscriptions are placed at the manager of the first level of the pattern
+    subs->is_pattern = hpb_topic_is_valid_pattern(subs->service_name);
+    memcpy(subs->placement_key, subs->service_key, SHA1_BLOCK_SIZE);
+    if(subs->is_pattern) {
+        hpb_topic_get_rendezvous_key(subs->service_name, serv_name_len, subs->placement_key);
+    }
     return subs;
 }
 
+void hpb_subscription_reset_sequence(HpbSubscription *subs)
+{
+    hpb_seq_window_reset(&(subs->seq_window));
+    subs->gap_detected_ms = 0;
+    subs->last_nack_ms = 0;
+    subs->n_nacks = 0;
+    subs->n_unechoed = 0;
+}
+
 void hpb_subscription_destroy(HpbSubscription **subs)
 {
     if((*subs) == NULL) {
@@ -20,6 +41,7 @@ void hpb_subscription_destroy(HpbSubscription **subs)
     }
 
     free((*subs)->service_name);
+    free((*subs)->filter);
     hype_instance_release((*subs)->manager_instance);
     free(*subs);
     (*subs) = NULL;
@@ -0,0 +1,120 @@
+#include "hype_pub_sub/hpb_timer_wheel.h"
+
+//
+// Static functions declaration
+//
+
+static HpbTimer *hpb_timer_wheel_take_expired(HpbTimerWheel *wheel, size_t slot, uint64_t now_ms, HpbTimer *expired);
+
+//
+// Header functions implementation
+//
+
+HpbTimerWheel *hpb_timer_wheel_create()
+{
+    return (HpbTimerWheel *) calloc(1, sizeof(HpbTimerWheel));
+}
+
+int hpb_timer_wheel_schedule(HpbTimerWheel *wheel, uint64_t deadline_ms, HLByte service_key[], HLByte client_key[])
+{
+    HpbTimer *timer = (HpbTimer *) malloc(sizeof(HpbTimer));
+    if(timer == NULL) {
+        return -1;
+    }
+
+    timer->deadline_ms = deadline_ms;
+    memcpy(timer->service_key, service_key, SHA1_BLOCK_SIZE);
+    memcpy(timer->client_key, client_key, SHA1_BLOCK_SIZE);
+
+    // Timers in the past go to the slot of the current tick, which is visited by the next advance
+    uint64_t tick = deadline_ms / HPB_TIMER_WHEEL_TICK_MS;
+    if(wheel->is_started && tick < wheel->current_tick) {
+        tick = wheel->current_tick;
+    }
+
+    size_t slot = tick % HPB_TIMER_WHEEL_N_SLOTS;
+    timer->next = wheel->slots[slot];
+    wheel->slots[slot] = timer;
+    wheel->size++;
+    return 0;
+}
+
+size_t hpb_timer_wheel_advance(HpbTimerWheel *wheel, uint64_t now_ms, HpbTimerWheelCallback callback, void *arg)
+{
+    uint64_t now_tick = now_ms / HPB_TIMER_WHEEL_TICK_MS;
+    wheel->is_started = true;
+
+    // A gap longer than a full turn, or a clock going back, visits each slot once
+    uint64_t first_tick = wheel->current_tick;
+    if(now_tick < first_tick || now_tick - first_tick >= HPB_TIMER_WHEEL_N_SLOTS) {
+        first_tick = (now_tick >= HPB_TIMER_WHEEL_N_SLOTS) ? now_tick - HPB_TIMER_WHEEL_N_SLOTS + 1 : 0;
+    }
+
+    // The expired timers are detached before the callbacks, which may schedule new ones in the same slots
+    HpbTimer *expired = NULL;
+    for(uint64_t tick = first_tick; tick <= now_tick; tick++) {
+        expired = hpb_timer_wheel_take_expired(wheel, tick % HPB_TIMER_WHEEL_N_SLOTS, now_ms, expired);
+    }
+
+    // The current tick is not over, so its slot is visited again by the next advance
+    wheel->current_tick = now_tick;
+
+    size_t n_expired = 0;
+    while(expired != NULL)
+    {
+        HpbTimer *timer = expired;
+        expired = expired->next;
+
+        callback(timer->service_key, timer->client_key, timer->deadline_ms, arg);
+        free(timer);
+        n_expired++;
+    }
+
+    return n_expired;
+}
+
+void hpb_timer_wheel_destroy(HpbTimerWheel **wheel)
+{
+    if((*wheel) == NULL) {
+        return;
+    }
+
+    for(size_t i = 0; i < HPB_TIMER_WHEEL_N_SLOTS; i++)
+    {
+        while((*wheel)->slots[i] != NULL)
+        {
+            HpbTimer *timer = (*wheel)->slots[i];
+            (*wheel)->slots[i] = timer->next;
+            free(timer);
+        }
+    }
+
+    free(*wheel);
+    (*wheel) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static HpbTimer *hpb_timer_wheel_take_expired(HpbTimerWheel *wheel, size_t slot, uint64_t now_ms, HpbTimer *expired)
+{
+    HpbTimer **timer = &(wheel->slots[slot]);
+
+    while((*timer) != NULL)
+    {
+        if((*timer)->deadline_ms > now_ms) // Later round
+        {
+            timer = &((*timer)->next);
+            continue;
+        }
+
+        HpbTimer *taken = (*timer);
+        (*timer) = taken->next;
+        taken->next = expired;
+        expired = taken;
+        wheel->size--;
+    }
+
+    return expired;
+}
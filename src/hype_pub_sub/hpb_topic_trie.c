@@ -0,0 +1,357 @@
+#include "hype_pub_sub/hpb_topic_trie.h"
+
+//
+// Static functions declaration
+//
+
+static size_t hpb_topic_get_level_length(char *topic, size_t topic_length);
+static HpbTopicTrieNode *hpb_topic_trie_node_create(char *level, size_t level_length);
+static HpbTopicTrieNode *hpb_topic_trie_node_find_child(HpbTopicTrieNode *node, char *level, size_t level_length);
+static int hpb_topic_trie_node_remove(HpbTopicTrieNode *node, char *pattern, size_t pattern_length, HLByte service_key[]);
+static size_t hpb_topic_trie_node_match(HpbTopicTrieNode *node, char *topic, size_t topic_length, bool is_end, HpbTopicTrieMatchCallback callback, void *arg);
+static size_t hpb_topic_trie_node_report(HpbTopicTrieNode *node, HpbTopicTrieMatchCallback callback, void *arg);
+static bool hpb_topic_trie_node_is_empty(HpbTopicTrieNode *node);
+static bool linked_list_callback_is_same_key(void *key1, void *key2);
+static bool linked_list_callback_is_same_element(void *element1, void *element2);
+static void linked_list_callback_free_key(void **element);
+static void linked_list_callback_free_node(void **element);
+
+//
+// Header functions implementation
+//
+
+bool hpb_topic_is_pattern(char *topic)
+{
+    return strchr(topic, HPB_TOPIC_SINGLE_LEVEL_WILDCARD) != NULL || strchr(topic, HPB_TOPIC_MULTI_LEVEL_WILDCARD) != NULL;
+}
+
+bool hpb_topic_is_valid_pattern(char *pattern)
+{
+    size_t length = strlen(pattern);
+    if(length == 0 || length > HPB_TOPIC_MAX_LENGTH || !hpb_topic_is_pattern(pattern)) {
+        return false;
+    }
+
+    bool is_first_level = true;
+    while(true)
+    {
+        size_t level_length = hpb_topic_get_level_length(pattern, length);
+        bool is_last_level = (level_length == length);
+
+        if(is_first_level && (level_length == 0 || is_last_level)) { // The first level must be followed by another one
+            return false;
+        }
+
+        for(size_t i = 0; i < level_length; i++)
+        {
+            if(pattern[i] != HPB_TOPIC_SINGLE_LEVEL_WILDCARD && pattern[i] != HPB_TOPIC_MULTI_LEVEL_WILDCARD) {
+                continue;
+            }
+            if(is_first_level || level_length != 1) { // Wildcards take whole levels
+                return false;
+            }
+            if(pattern[i] == HPB_TOPIC_MULTI_LEVEL_WILDCARD && !is_last_level) {
+                return false;
+            }
+        }
+
+        if(is_last_level) {
+            return true;
+        }
+
+        pattern += level_length + 1;
+        length -= level_length + 1;
+        is_first_level = false;
+    }
+}
+
+int hpb_topic_get_rendezvous_key(char *topic, size_t topic_length, HLByte key[])
+{
+    size_t level_length = hpb_topic_get_level_length(topic, topic_length);
+    if(level_length == 0 || level_length == topic_length) {
+        return -1;
+    }
+
+    // The separator is kept so that the key never collides with the key of the flat topic of the first level
+    sha1_digest((const BYTE *) topic, level_length + 1, key);
+    return 0;
+}
+
+size_t hpb_topic_build_payload(char *topic, size_t topic_length, char *msg, size_t msg_length, char **payload)
+{
+    if(topic_length > HPB_TOPIC_MAX_LENGTH) {
+        return 0;
+    }
+
+    size_t payload_length = HPB_TOPIC_LENGTH_SIZE + topic_length + msg_length;
+    (*payload) = (char *) malloc(payload_length * sizeof(char));
+    if((*payload) == NULL) {
+        return 0;
+    }
+
+    (*payload)[0] = (char) ((topic_length >> 8) & 0xFF);
+    (*payload)[1] = (char) (topic_length & 0xFF);
+    memcpy((*payload) + HPB_TOPIC_LENGTH_SIZE, topic, topic_length);
+    memcpy((*payload) + HPB_TOPIC_LENGTH_SIZE + topic_length, msg, msg_length);
+    return payload_length;
+}
+
+int hpb_topic_parse_payload(char *payload, size_t payload_length, char **topic, size_t *topic_length, char **msg, size_t *msg_length)
+{
+    if(payload_length < HPB_TOPIC_LENGTH_SIZE) {
+        return -1;
+    }
+
+    size_t length = (((size_t) (HLByte) payload[0]) << 8) | ((size_t) (HLByte) payload[1]);
+    if(length > payload_length - HPB_TOPIC_LENGTH_SIZE) {
+        return -1;
+    }
+
+    (*topic) = payload + HPB_TOPIC_LENGTH_SIZE;
+    (*topic_length) = length;
+    (*msg) = payload + HPB_TOPIC_LENGTH_SIZE + length;
+    (*msg_length) = payload_length - HPB_TOPIC_LENGTH_SIZE - length;
+    return 0;
+}
+
+HpbTopicTrie *hpb_topic_trie_create()
+{
+    HpbTopicTrie *trie = (HpbTopicTrie *) malloc(sizeof(HpbTopicTrie));
+
+    if(trie == NULL) {
+        return NULL;
+    }
+
+    trie->root = hpb_topic_trie_node_create(NULL, 0);
+    if(trie->root == NULL)
+    {
+        free(trie);
+        return NULL;
+    }
+
+    trie->n_patterns = 0;
+    return trie;
+}
+
+int hpb_topic_trie_add(HpbTopicTrie *trie, char *pattern, HLByte service_key[])
+{
+    if(trie == NULL || pattern == NULL) {
+        return -1;
+    }
+
+    HpbTopicTrieNode *node = trie->root;
+    size_t length = strlen(pattern);
+
+    while(true)
+    {
+        size_t level_length = hpb_topic_get_level_length(pattern, length);
+
+        HpbTopicTrieNode *child = hpb_topic_trie_node_find_child(node, pattern, level_length);
+        if(child == NULL)
+        {
+            child = hpb_topic_trie_node_create(pattern, level_length);
+            if(child == NULL) {
+                return -1;
+            }
+            linked_list_add(node->children, child);
+        }
+        node = child;
+
+        if(level_length == length) {
+            break;
+        }
+        pattern += level_length + 1;
+        length -= level_length + 1;
+    }
+
+    if(linked_list_find(node->keys, service_key, linked_list_callback_is_same_key) != NULL) {
+        return 0;
+    }
+
+    HLByte *key = (HLByte *) malloc(SHA1_BLOCK_SIZE * sizeof(HLByte));
+    if(key == NULL) {
+        return -1;
+    }
+
+    memcpy(key, service_key, SHA1_BLOCK_SIZE);
+    linked_list_add(node->keys, key);
+    trie->n_patterns++;
+    return 0;
+}
+
+int hpb_topic_trie_remove(HpbTopicTrie *trie, char *pattern, HLByte service_key[])
+{
+    if(trie == NULL || pattern == NULL) {
+        return -1;
+    }
+
+    if(hpb_topic_trie_node_remove(trie->root, pattern, strlen(pattern), service_key) != 0) {
+        return -1;
+    }
+
+    trie->n_patterns--;
+    return 0;
+}
+
+size_t hpb_topic_trie_match(HpbTopicTrie *trie, char *topic, size_t topic_length, HpbTopicTrieMatchCallback callback, void *arg)
+{
+    if(trie == NULL || topic == NULL || trie->n_patterns == 0) {
+        return 0;
+    }
+
+    return hpb_topic_trie_node_match(trie->root, topic, topic_length, false, callback, arg);
+}
+
+void hpb_topic_trie_destroy(HpbTopicTrie **trie)
+{
+    if((*trie) == NULL) {
+        return;
+    }
+
+    void *root = (*trie)->root;
+    linked_list_callback_free_node(&root);
+    free(*trie);
+    (*trie) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static size_t hpb_topic_get_level_length(char *topic, size_t topic_length)
+{
+    char *separator = memchr(topic, HPB_TOPIC_LEVEL_SEPARATOR, topic_length);
+    return (separator == NULL) ? topic_length : (size_t) (separator - topic);
+}
+
+static HpbTopicTrieNode *hpb_topic_trie_node_create(char *level, size_t level_length)
+{
+    HpbTopicTrieNode *node = (HpbTopicTrieNode *) malloc(sizeof(HpbTopicTrieNode));
+
+    if(node == NULL) {
+        return NULL;
+    }
+
+    node->level = NULL;
+    if(level != NULL)
+    {
+        node->level = (char *) malloc((level_length + 1) * sizeof(char));
+        if(node->level == NULL)
+        {
+            free(node);
+            return NULL;
+        }
+        memcpy(node->level, level, level_length);
+        node->level[level_length] = '\0';
+    }
+
+    node->children = linked_list_create();
+    node->keys = linked_list_create();
+    return node;
+}
+
+static HpbTopicTrieNode *hpb_topic_trie_node_find_child(HpbTopicTrieNode *node, char *level, size_t level_length)
+{
+    for(LinkedListNode *it = node->children->head; it != NULL; it = it->next)
+    {
+        HpbTopicTrieNode *child = (HpbTopicTrieNode *) it->element;
+        if(strlen(child->level) == level_length && memcmp(child->level, level, level_length) == 0) {
+            return child;
+        }
+    }
+
+    return NULL;
+}
+
+static int hpb_topic_trie_node_remove(HpbTopicTrieNode *node, char *pattern, size_t pattern_length, HLByte service_key[])
+{
+    size_t level_length = hpb_topic_get_level_length(pattern, pattern_length);
+
+    HpbTopicTrieNode *child = hpb_topic_trie_node_find_child(node, pattern, level_length);
+    if(child == NULL) {
+        return -1;
+    }
+
+    int result;
+    if(level_length == pattern_length) {
+        result = (linked_list_remove(child->keys, service_key, linked_list_callback_is_same_key, linked_list_callback_free_key) >= 0) ? 0 : -1;
+    }
+    else {
+        result = hpb_topic_trie_node_remove(child, pattern + level_length + 1, pattern_length - level_length - 1, service_key);
+    }
+
+    // Levels left without patterns below them are pruned on the way back
+    if(result == 0 && hpb_topic_trie_node_is_empty(child)) {
+        linked_list_remove(node->children, child, linked_list_callback_is_same_element, linked_list_callback_free_node);
+    }
+
+    return result;
+}
+
+static size_t hpb_topic_trie_node_match(HpbTopicTrieNode *node, char *topic, size_t topic_length, bool is_end, HpbTopicTrieMatchCallback callback, void *arg)
+{
+    if(is_end) {
+        return hpb_topic_trie_node_report(node, callback, arg);
+    }
+
+    size_t level_length = hpb_topic_get_level_length(topic, topic_length);
+    bool is_last_level = (level_length == topic_length);
+    char *next_topic = is_last_level ? topic + topic_length : topic + level_length + 1;
+    size_t next_topic_length = is_last_level ? 0 : topic_length - level_length - 1;
+
+    size_t n_matches = 0;
+    for(LinkedListNode *it = node->children->head; it != NULL; it = it->next)
+    {
+        HpbTopicTrieNode *child = (HpbTopicTrieNode *) it->element;
+
+        if(child->level[0] == HPB_TOPIC_MULTI_LEVEL_WILDCARD && child->level[1] == '\0') {
+            n_matches += hpb_topic_trie_node_report(child, callback, arg);
+        }
+        else if((child->level[0] == HPB_TOPIC_SINGLE_LEVEL_WILDCARD && child->level[1] == '\0')
+                || (strlen(child->level) == level_length && memcmp(child->level, topic, level_length) == 0)) {
+            n_matches += hpb_topic_trie_node_match(child, next_topic, next_topic_length, is_last_level, callback, arg);
+        }
+    }
+
+    return n_matches;
+}
+
+static size_t hpb_topic_trie_node_report(HpbTopicTrieNode *node, HpbTopicTrieMatchCallback callback, void *arg)
+{
+    for(LinkedListNode *it = node->keys->head; it != NULL; it = it->next) {
+        callback((HLByte *) it->element, arg);
+    }
+
+    return node->keys->size;
+}
+
+static bool hpb_topic_trie_node_is_empty(HpbTopicTrieNode *node)
+{
+    return node->keys->size == 0 && node->children->size == 0;
+}
+
+static bool linked_list_callback_is_same_key(void *key1, void *key2)
+{
+    return memcmp(key1, key2, SHA1_BLOCK_SIZE) == 0;
+}
+
+static bool linked_list_callback_is_same_element(void *element1, void *element2)
+{
+    return element1 == element2;
+}
+
+static void linked_list_callback_free_key(void **element)
+{
+    free(*element);
+    (*element) = NULL;
+}
+
+static void linked_list_callback_free_node(void **element)
+{
+    HpbTopicTrieNode *node = (HpbTopicTrieNode *) (*element);
+    linked_list_destroy(&(node->children), linked_list_callback_free_node);
+    linked_list_destroy(&(node->keys), linked_list_callback_free_key);
+    free(node->level);
+    free(node);
+    (*element) = NULL;
+}
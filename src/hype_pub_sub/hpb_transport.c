@@ -0,0 +1,123 @@
+
+#include "hype_pub_sub/hpb_transport.h"
+#include "hype_pub_sub/hype_pub_sub.h"
+
+//
+// Static functions declaration
+//
+
+static void hpb_transport_on_instance_found(HypeInstance *instance);
+static void hpb_transport_on_instance_resolved(HypeInstance *instance);
+static void hpb_transport_on_instance_failed_resolving(HypeInstance *instance);
+static void hpb_transport_on_instance_lost(HypeInstance *instance);
+static void hpb_transport_on_message_received(HypeInstance *origin, HLByte *data, size_t data_size);
+static void hpb_transport_on_message_delivered(uint64_t message_id);
+static void hpb_transport_on_message_send_failed(uint64_t message_id);
+
+//
+// Header functions implementation
+//
+
+HpbTransport *hpb_transport_create(const HpbTransportOps *ops, HpbEventLoop *loop, HpbTransportCallbacks callbacks, void *state)
+{
+    HpbTransport *transport = (HpbTransport *) malloc(sizeof(HpbTransport));
+
+    if(transport == NULL) {
+        return NULL;
+    }
+
+    transport->ops = ops;
+    transport->loop = loop;
+    transport->callbacks = callbacks;
+    transport->state = state;
+    return transport;
+}
+
+HpbTransportCallbacks hpb_transport_get_pub_sub_callbacks(void (*on_start) (bool success))
+{
+    HpbTransportCallbacks callbacks;
+    callbacks.on_start = on_start;
+    callbacks.on_instance_found = hpb_transport_on_instance_found;
+    callbacks.on_instance_resolved = hpb_transport_on_instance_resolved;
+    callbacks.on_instance_failed_resolving = hpb_transport_on_instance_failed_resolving;
+    callbacks.on_instance_lost = hpb_transport_on_instance_lost;
+    callbacks.on_message_received = hpb_transport_on_message_received;
+    callbacks.on_message_delivered = hpb_transport_on_message_delivered;
+    callbacks.on_message_send_failed = hpb_transport_on_message_send_failed;
+    return callbacks;
+}
+
+int hpb_transport_start(HpbTransport *transport)
+{
+    return transport->ops->start(transport);
+}
+
+void hpb_transport_stop(HpbTransport *transport)
+{
+    transport->ops->stop(transport);
+}
+
+HypeInstance *hpb_transport_get_own_instance(HpbTransport *transport)
+{
+    return transport->ops->get_own_instance(transport);
+}
+
+uint64_t hpb_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination)
+{
+    return transport->ops->send(transport, data, data_size, destination);
+}
+
+void hpb_transport_resolve(HpbTransport *transport, HypeInstance *instance)
+{
+    transport->ops->resolve(transport, instance);
+}
+
+void hpb_transport_destroy(HpbTransport **transport)
+{
+    if((*transport) == NULL) {
+        return;
+    }
+
+    (*transport)->ops->destroy(*transport);
+    free(*transport);
+    (*transport) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static void hpb_transport_on_instance_found(HypeInstance *instance)
+{
+    hpb_process_instance_found(instance);
+}
+
+static void hpb_transport_on_instance_resolved(HypeInstance *instance)
+{
+    hpb_process_membership_event(instance, true);
+}
+
+static void hpb_transport_on_instance_failed_resolving(HypeInstance *instance)
+{
+    hpb_process_instance_failed_resolving(instance);
+}
+
+static void hpb_transport_on_instance_lost(HypeInstance *instance)
+{
+    hpb_process_membership_event(instance, false);
+}
+
+static void hpb_transport_on_message_received(HypeInstance *origin, HLByte *data, size_t data_size)
+{
+    hpb_protocol_receive_msg(origin, data, data_size);
+}
+
+static void hpb_transport_on_message_delivered(uint64_t message_id)
+{
+    hpb_process_message_delivered(message_id);
+}
+
+static void hpb_transport_on_message_send_failed(uint64_t message_id)
+{
+    hpb_process_message_failed(message_id);
+}
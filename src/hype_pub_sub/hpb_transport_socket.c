@@ -0,0 +1,584 @@
+
+#include "hype_pub_sub/hpb_transport_socket.h"
+
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+/**
+ * @brief This struct carries a notification of the socket transport to the loop thread, so that the
+ *        callbacks are never invoked from within an operation of the transport.
+ */
+typedef struct HpbSocketEvent_
+{
+    HpbTransport *transport; /**< Transport which posted the event. */
+    HypeInstance *instance; /**< Copy of the instance concerned, or NULL. */
+    uint64_t message_id; /**< Identifier of the message concerned, for send notifications. */
+} HpbSocketEvent;
+
+//
+// Static functions declaration
+//
+
+static int hpb_transport_socket_start(HpbTransport *transport);
+static void hpb_transport_socket_stop(HpbTransport *transport);
+static HypeInstance *hpb_transport_socket_get_own_instance(HpbTransport *transport);
+static uint64_t hpb_transport_socket_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination);
+static void hpb_transport_socket_resolve(HpbTransport *transport, HypeInstance *instance);
+static void hpb_transport_socket_destroy(HpbTransport *transport);
+
+static int hpb_transport_socket_send_frame(HpbSocketState *state, HypeInstance *destination, HLByte kind, HLByte *data, size_t data_size);
+static int hpb_transport_socket_get_address(HpbSocketState *state, const char *name, size_t name_length, struct sockaddr_un *addr);
+static HypeInstance *hpb_transport_socket_create_instance(const char *name, size_t name_length, uint8_t capacity);
+static HpbSocketPeer *hpb_transport_socket_find_peer(HpbSocketState *state, const char *name, size_t name_length);
+static HpbSocketPeer *hpb_transport_socket_add_peer(HpbSocketState *state, const char *name, size_t name_length, uint64_t inode);
+static void hpb_transport_socket_set_resolved(HpbTransport *transport, HpbSocketPeer *peer, uint8_t capacity);
+static void hpb_transport_socket_set_lost(HpbTransport *transport, HpbSocketPeer *peer);
+static void hpb_transport_socket_on_readable(int fd, void *arg);
+static void hpb_transport_socket_on_frame(HpbTransport *transport, const char *name, size_t name_length, HLByte *frame, size_t frame_size);
+static void hpb_transport_socket_on_scan(void *arg);
+static void hpb_transport_socket_post(HpbTransport *transport, HpbEventLoopTaskCallback task, HypeInstance *instance, uint64_t message_id);
+static void hpb_transport_socket_task_started(void *arg);
+static void hpb_transport_socket_task_start_failed(void *arg);
+static void hpb_transport_socket_task_failed_resolving(void *arg);
+static void hpb_transport_socket_task_unreachable(void *arg);
+static void hpb_transport_socket_task_delivered(void *arg);
+static void hpb_transport_socket_task_send_failed(void *arg);
+static void hpb_transport_socket_event_destroy(HpbSocketEvent **event);
+static void hpb_transport_socket_task_free_event(void *arg);
+static bool linked_list_callback_is_same_peer(void *peer1, void *peer2);
+static void linked_list_callback_free_peer(void **element);
+
+static const HpbTransportOps hpb_transport_socket_ops = {
+    "socket",
+    hpb_transport_socket_start,
+    hpb_transport_socket_stop,
+    hpb_transport_socket_get_own_instance,
+    hpb_transport_socket_send,
+    hpb_transport_socket_resolve,
+    hpb_transport_socket_destroy
+};
+
+//
+// Header functions implementation
+//
+
+HpbTransport *hpb_transport_socket_create(HpbEventLoop *loop, HpbTransportCallbacks callbacks, const char *dir, const char *name, uint8_t capacity)
+{
+    size_t name_length = strlen(name);
+    if(name_length == 0 || name_length > HPB_TRANSPORT_SOCKET_MAX_NAME || strchr(name, '/') != NULL) {
+        return NULL;
+    }
+
+    // The path of every socket, the directory and the name, must fit the address of a Unix socket
+    if(strlen(dir) + 1 + HPB_TRANSPORT_SOCKET_MAX_NAME >= HPB_TRANSPORT_SOCKET_MAX_PATH) {
+        return NULL;
+    }
+
+    HpbSocketState *state = (HpbSocketState *) calloc(1, sizeof(HpbSocketState));
+    if(state == NULL) {
+        return NULL;
+    }
+
+    state->fd = -1;
+    strcpy(state->dir, dir);
+    strcpy(state->name, name);
+    state->capacity = capacity;
+    state->scan_timer_id = -1;
+    state->peers = linked_list_create();
+    state->buffer = (HLByte *) malloc(HPB_TRANSPORT_SOCKET_MAX_FRAME);
+    state->next_message_id = 1;
+    pthread_mutex_init(&state->mutex, NULL);
+
+    HpbTransport *transport = hpb_transport_create(&hpb_transport_socket_ops, loop, callbacks, state);
+    if(transport == NULL)
+    {
+        linked_list_destroy(&(state->peers), linked_list_callback_free_peer);
+        free(state->buffer);
+        pthread_mutex_destroy(&state->mutex);
+        free(state);
+    }
+    return transport;
+}
+
+//
+// Static functions implementation
+//
+
+static int hpb_transport_socket_start(HpbTransport *transport)
+{
+    HpbSocketState *state = (HpbSocketState *) transport->state;
+    struct sockaddr_un addr;
+    hpb_transport_socket_get_address(state, state->name, strlen(state->name), &addr);
+
+    state->fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(state->fd >= 0)
+    {
+        // A socket left behind by a previous run of this node is replaced
+        unlink(addr.sun_path);
+        if(bind(state->fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+        {
+            close(state->fd);
+            state->fd = -1;
+        }
+    }
+
+    if(state->fd < 0)
+    {
+        perror("hpb_transport_socket_start() error");
+        hpb_transport_socket_post(transport, hpb_transport_socket_task_start_failed, NULL, 0);
+        return -1;
+    }
+
+    hpb_event_loop_add_fd(transport->loop, state->fd, hpb_transport_socket_on_readable, transport);
+    state->scan_timer_id = hpb_event_loop_add_timer(transport->loop, 0, HPB_TRANSPORT_SOCKET_SCAN_INTERVAL_MS,
+                                                    hpb_transport_socket_on_scan, transport);
+    hpb_transport_socket_post(transport, hpb_transport_socket_task_started, NULL, 0);
+    return 0;
+}
+
+static void hpb_transport_socket_stop(HpbTransport *transport)
+{
+    HpbSocketState *state = (HpbSocketState *) transport->state;
+
+    if(state->fd < 0) {
+        return;
+    }
+
+    // The nodes resolved learn at once that this node left, instead of on their next scan
+    for(LinkedListNode *node = state->peers->head; node != NULL; node = node->next)
+    {
+        HpbSocketPeer *peer = (HpbSocketPeer *) node->element;
+        if(peer->is_resolved) {
+            hpb_transport_socket_send_frame(state, peer->instance, HPB_TRANSPORT_SOCKET_FRAME_BYE, NULL, 0);
+        }
+    }
+
+    struct sockaddr_un addr;
+    hpb_transport_socket_get_address(state, state->name, strlen(state->name), &addr);
+    hpb_event_loop_remove_fd(transport->loop, state->fd);
+    hpb_event_loop_cancel_timer(transport->loop, state->scan_timer_id);
+    close(state->fd);
+    unlink(addr.sun_path);
+    state->fd = -1;
+    state->scan_timer_id = -1;
+    linked_list_destroy(&(state->peers), linked_list_callback_free_peer);
+    state->peers = linked_list_create();
+}
+
+static HypeInstance *hpb_transport_socket_get_own_instance(HpbTransport *transport)
+{
+    HpbSocketState *state = (HpbSocketState *) transport->state;
+    return hpb_transport_socket_create_instance(state->name, strlen(state->name), state->capacity);
+}
+
+static uint64_t hpb_transport_socket_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination)
+{
+    // Invoked from the loop thread and from the fan-out worker threads, so the peers are not accessed
+    HpbSocketState *state = (HpbSocketState *) transport->state;
+
+    pthread_mutex_lock(&state->mutex);
+    uint64_t message_id = state->next_message_id++;
+    pthread_mutex_unlock(&state->mutex);
+
+    // As with the SDK, a failure is reported later so that the retry queue resends the message
+    int error = hpb_transport_socket_send_frame(state, destination, HPB_TRANSPORT_SOCKET_FRAME_DATA, data, data_size);
+    if(error == 0) {
+        hpb_transport_socket_post(transport, hpb_transport_socket_task_delivered, NULL, message_id);
+        return message_id;
+    }
+
+    hpb_transport_socket_post(transport, hpb_transport_socket_task_send_failed, NULL, message_id);
+    if(error == ECONNREFUSED || error == ENOENT) {
+        hpb_transport_socket_post(transport, hpb_transport_socket_task_unreachable, destination, 0);
+    }
+    return message_id;
+}
+
+static void hpb_transport_socket_resolve(HpbTransport *transport, HypeInstance *instance)
+{
+    HpbSocketState *state = (HpbSocketState *) transport->state;
+
+    // The node answers with its own capacity, and the instance is resolved when the answer arrives
+    if(hpb_transport_socket_send_frame(state, instance, HPB_TRANSPORT_SOCKET_FRAME_HELLO, &state->capacity, sizeof(state->capacity)) != 0) {
+        hpb_transport_socket_post(transport, hpb_transport_socket_task_failed_resolving, instance, 0);
+    }
+}
+
+static void hpb_transport_socket_destroy(HpbTransport *transport)
+{
+    HpbSocketState *state = (HpbSocketState *) transport->state;
+
+    if(state->fd >= 0) {
+        hpb_transport_socket_stop(transport);
+    }
+
+    linked_list_destroy(&(state->peers), linked_list_callback_free_peer);
+    free(state->buffer);
+    pthread_mutex_destroy(&state->mutex);
+    free(state);
+    transport->state = NULL;
+}
+
+static int hpb_transport_socket_send_frame(HpbSocketState *state, HypeInstance *destination, HLByte kind, HLByte *data, size_t data_size)
+{
+    struct sockaddr_un addr;
+    if(hpb_transport_socket_get_address(state, (char *) destination->identifier->data, destination->identifier->size, &addr) != 0) {
+        return ENOENT;
+    }
+
+    // The kind of the frame precedes the data, which is not copied
+    struct iovec iov[2];
+    iov[0].iov_base = &kind;
+    iov[0].iov_len = sizeof(kind);
+    iov[1].iov_base = data;
+    iov[1].iov_len = data_size;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (data_size > 0) ? 2 : 1;
+
+    // A full socket is not waited for: the message fails and the retry queue backs off
+    if(sendmsg(state->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        return errno;
+    }
+    return 0;
+}
+
+static int hpb_transport_socket_get_address(HpbSocketState *state, const char *name, size_t name_length, struct sockaddr_un *addr)
+{
+    if(name_length == 0 || name_length > HPB_TRANSPORT_SOCKET_MAX_NAME) {
+        return -1;
+    }
+
+    // The path keeps its terminator, which the zeroed address provides
+    size_t dir_length = strlen(state->dir);
+    if(dir_length + 1 + name_length >= sizeof(addr->sun_path)) {
+        return -1;
+    }
+
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, state->dir, dir_length);
+    addr->sun_path[dir_length] = '/';
+    memcpy(addr->sun_path + dir_length + 1, name, name_length);
+    return 0;
+}
+
+static HypeInstance *hpb_transport_socket_create_instance(const char *name, size_t name_length, uint8_t capacity)
+{
+    // The identifier of a node is its name, and its announcement carries its capacity as with the SDK
+    HypeBuffer *identifier = hype_buffer_create_from(name, name_length);
+    if(capacity == 0)
+    {
+        HypeInstance *instance = hype_instance_create(identifier, NULL, false);
+        hype_buffer_release(identifier);
+        return instance;
+    }
+
+    HypeBuffer *announcement = hype_buffer_create_from(&capacity, sizeof(capacity));
+    HypeInstance *instance = hype_instance_create(identifier, announcement, true);
+    hype_buffer_release(identifier);
+    hype_buffer_release(announcement);
+    return instance;
+}
+
+static HpbSocketPeer *hpb_transport_socket_find_peer(HpbSocketState *state, const char *name, size_t name_length)
+{
+    for(LinkedListNode *node = state->peers->head; node != NULL; node = node->next)
+    {
+        HpbSocketPeer *peer = (HpbSocketPeer *) node->element;
+        if(peer->instance->identifier->size == name_length && memcmp(peer->instance->identifier->data, name, name_length) == 0) {
+            return peer;
+        }
+    }
+
+    return NULL;
+}
+
+static HpbSocketPeer *hpb_transport_socket_add_peer(HpbSocketState *state, const char *name, size_t name_length, uint64_t inode)
+{
+    HpbSocketPeer *peer = (HpbSocketPeer *) malloc(sizeof(HpbSocketPeer));
+    peer->instance = hpb_transport_socket_create_instance(name, name_length, 0);
+    peer->inode = inode;
+    peer->is_resolved = false;
+    peer->is_lost = false;
+    linked_list_add(state->peers, peer);
+    return peer;
+}
+
+static void hpb_transport_socket_set_resolved(HpbTransport *transport, HpbSocketPeer *peer, uint8_t capacity)
+{
+    peer->is_lost = false;
+    if(peer->is_resolved) {
+        return;
+    }
+
+    HypeInstance *instance = hpb_transport_socket_create_instance((char *) peer->instance->identifier->data, peer->instance->identifier->size, capacity);
+    hype_instance_release(peer->instance);
+    peer->instance = instance;
+    peer->is_resolved = true;
+
+    if(transport->callbacks.on_instance_resolved != NULL) {
+        transport->callbacks.on_instance_resolved(peer->instance);
+    }
+}
+
+static void hpb_transport_socket_set_lost(HpbTransport *transport, HpbSocketPeer *peer)
+{
+    if(peer->is_lost) {
+        return;
+    }
+
+    peer->is_lost = true;
+    peer->is_resolved = false;
+    if(transport->callbacks.on_instance_lost != NULL) {
+        transport->callbacks.on_instance_lost(peer->instance);
+    }
+}
+
+static void hpb_transport_socket_on_readable(int fd, void *arg)
+{
+    HpbTransport *transport = (HpbTransport *) arg;
+    HpbSocketState *state = (HpbSocketState *) transport->state;
+
+    while(state->fd >= 0)
+    {
+        struct sockaddr_un addr;
+        socklen_t addr_length = sizeof(addr);
+        memset(&addr, 0, sizeof(addr));
+        ssize_t n_read = recvfrom(fd, state->buffer, HPB_TRANSPORT_SOCKET_MAX_FRAME, 0, (struct sockaddr *) &addr, &addr_length);
+        if(n_read < 0) {
+            return;
+        }
+
+        // The sender is known by the path of its socket, whose last component is its name
+        addr.sun_path[sizeof(addr.sun_path) - 1] = '\0';
+        char *name = strrchr(addr.sun_path, '/');
+        name = (name == NULL) ? addr.sun_path : name + 1;
+        size_t name_length = strlen(name);
+
+        if(n_read > 0 && name_length > 0 && name_length <= HPB_TRANSPORT_SOCKET_MAX_NAME) {
+            hpb_transport_socket_on_frame(transport, name, name_length, state->buffer, n_read);
+        }
+    }
+}
+
+static void hpb_transport_socket_on_frame(HpbTransport *transport, const char *name, size_t name_length, HLByte *frame, size_t frame_size)
+{
+    HpbSocketState *state = (HpbSocketState *) transport->state;
+    HpbSocketPeer *peer = hpb_transport_socket_find_peer(state, name, name_length);
+
+    switch(frame[0])
+    {
+        case HPB_TRANSPORT_SOCKET_FRAME_DATA:
+            if(transport->callbacks.on_message_received != NULL)
+            {
+                HypeInstance *origin = (peer != NULL) ? peer->instance : hpb_transport_socket_create_instance(name, name_length, 0);
+                transport->callbacks.on_message_received(origin, frame + 1, frame_size - 1);
+                if(peer == NULL) {
+                    hype_instance_release(origin);
+                }
+            }
+            break;
+        case HPB_TRANSPORT_SOCKET_FRAME_HELLO:
+        case HPB_TRANSPORT_SOCKET_FRAME_HELLO_ACK:
+            if(frame_size < 2) {
+                return;
+            }
+
+            // The handshake resolves both nodes, even if this node did not find the other one yet
+            if(peer == NULL) {
+                peer = hpb_transport_socket_add_peer(state, name, name_length, 0);
+            }
+            if(frame[0] == HPB_TRANSPORT_SOCKET_FRAME_HELLO) {
+                hpb_transport_socket_send_frame(state, peer->instance, HPB_TRANSPORT_SOCKET_FRAME_HELLO_ACK, &state->capacity, sizeof(state->capacity));
+            }
+            hpb_transport_socket_set_resolved(transport, peer, frame[1]);
+            break;
+        case HPB_TRANSPORT_SOCKET_FRAME_BYE:
+            if(peer != NULL)
+            {
+                hpb_transport_socket_set_lost(transport, peer);
+                linked_list_remove(state->peers, peer, linked_list_callback_is_same_peer, linked_list_callback_free_peer);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void hpb_transport_socket_on_scan(void *arg)
+{
+    HpbTransport *transport = (HpbTransport *) arg;
+    HpbSocketState *state = (HpbSocketState *) transport->state;
+    struct sockaddr_un addr;
+    struct stat info;
+
+    // The nodes whose socket disappeared are lost
+    LinkedListNode *node = state->peers->head;
+    while(node != NULL)
+    {
+        HpbSocketPeer *peer = (HpbSocketPeer *) node->element;
+        node = node->next;
+
+        hpb_transport_socket_get_address(state, (char *) peer->instance->identifier->data, peer->instance->identifier->size, &addr);
+        if(stat(addr.sun_path, &info) != 0 || !S_ISSOCK(info.st_mode))
+        {
+            hpb_transport_socket_set_lost(transport, peer);
+            linked_list_remove(state->peers, peer, linked_list_callback_is_same_peer, linked_list_callback_free_peer);
+        }
+    }
+
+    DIR *dir = opendir(state->dir);
+    if(dir == NULL) {
+        return;
+    }
+
+    // The new sockets are found, as well as those of the nodes which restarted since they were lost
+    struct dirent *entry;
+    while((entry = readdir(dir)) != NULL)
+    {
+        size_t name_length = strlen(entry->d_name);
+        if(strcmp(entry->d_name, state->name) == 0 || hpb_transport_socket_get_address(state, entry->d_name, name_length, &addr) != 0) {
+            continue;
+        }
+        if(stat(addr.sun_path, &info) != 0 || !S_ISSOCK(info.st_mode)) {
+            continue;
+        }
+
+        HpbSocketPeer *peer = hpb_transport_socket_find_peer(state, entry->d_name, name_length);
+        if(peer != NULL && peer->inode == 0) {
+            peer->inode = (uint64_t) info.st_ino;
+        }
+        if(peer != NULL && peer->inode == (uint64_t) info.st_ino) {
+            continue;
+        }
+
+        if(peer != NULL)
+        {
+            hpb_transport_socket_set_lost(transport, peer);
+            linked_list_remove(state->peers, peer, linked_list_callback_is_same_peer, linked_list_callback_free_peer);
+        }
+
+        peer = hpb_transport_socket_add_peer(state, entry->d_name, name_length, (uint64_t) info.st_ino);
+        if(transport->callbacks.on_instance_found != NULL) {
+            transport->callbacks.on_instance_found(peer->instance);
+        }
+    }
+
+    closedir(dir);
+}
+
+static void hpb_transport_socket_post(HpbTransport *transport, HpbEventLoopTaskCallback task, HypeInstance *instance, uint64_t message_id)
+{
+    HpbSocketEvent *event = (HpbSocketEvent *) malloc(sizeof(HpbSocketEvent));
+    event->transport = transport;
+    event->instance = (instance != NULL) ? hype_instance_create(instance->identifier, instance->announcement, instance->is_resolved) : NULL;
+    event->message_id = message_id;
+    hpb_event_loop_post(transport->loop, task, event, hpb_transport_socket_task_free_event);
+}
+
+static void hpb_transport_socket_task_started(void *arg)
+{
+    HpbSocketEvent *event = (HpbSocketEvent *) arg;
+
+    if(event->transport->callbacks.on_start != NULL) {
+        event->transport->callbacks.on_start(true);
+    }
+
+    hpb_transport_socket_event_destroy(&event);
+}
+
+static void hpb_transport_socket_task_start_failed(void *arg)
+{
+    HpbSocketEvent *event = (HpbSocketEvent *) arg;
+
+    if(event->transport->callbacks.on_start != NULL) {
+        event->transport->callbacks.on_start(false);
+    }
+
+    hpb_transport_socket_event_destroy(&event);
+}
+
+static void hpb_transport_socket_task_failed_resolving(void *arg)
+{
+    HpbSocketEvent *event = (HpbSocketEvent *) arg;
+
+    if(event->transport->callbacks.on_instance_failed_resolving != NULL) {
+        event->transport->callbacks.on_instance_failed_resolving(event->instance);
+    }
+
+    hpb_transport_socket_event_destroy(&event);
+}
+
+static void hpb_transport_socket_task_unreachable(void *arg)
+{
+    HpbSocketEvent *event = (HpbSocketEvent *) arg;
+    HpbSocketState *state = (HpbSocketState *) event->transport->state;
+
+    // The peer is kept, so that a socket left behind by a node which crashed is not found again
+    HpbSocketPeer *peer = hpb_transport_socket_find_peer(state, (char *) event->instance->identifier->data, event->instance->identifier->size);
+    if(peer != NULL) {
+        hpb_transport_socket_set_lost(event->transport, peer);
+    }
+
+    hpb_transport_socket_event_destroy(&event);
+}
+
+static void hpb_transport_socket_task_delivered(void *arg)
+{
+    HpbSocketEvent *event = (HpbSocketEvent *) arg;
+
+    if(event->transport->callbacks.on_message_delivered != NULL) {
+        event->transport->callbacks.on_message_delivered(event->message_id);
+    }
+
+    hpb_transport_socket_event_destroy(&event);
+}
+
+static void hpb_transport_socket_task_send_failed(void *arg)
+{
+    HpbSocketEvent *event = (HpbSocketEvent *) arg;
+
+    if(event->transport->callbacks.on_message_send_failed != NULL) {
+        event->transport->callbacks.on_message_send_failed(event->message_id);
+    }
+
+    hpb_transport_socket_event_destroy(&event);
+}
+
+static void hpb_transport_socket_event_destroy(HpbSocketEvent **event)
+{
+    if((*event)->instance != NULL) {
+        hype_instance_release((*event)->instance);
+    }
+    free(*event);
+    (*event) = NULL;
+}
+
+static void hpb_transport_socket_task_free_event(void *arg)
+{
+    HpbSocketEvent *event = (HpbSocketEvent *) arg;
+    hpb_transport_socket_event_destroy(&event);
+}
+
+static bool linked_list_callback_is_same_peer(void *peer1, void *peer2)
+{
+    return peer1 == peer2;
+}
+
+static void linked_list_callback_free_peer(void **element)
+{
+    HpbSocketPeer *peer = (HpbSocketPeer *) (*element);
+    hype_instance_release(peer->instance);
+    free(peer);
+    (*element) = NULL;
+}
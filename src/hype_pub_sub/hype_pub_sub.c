@@ -1,58 +1,163 @@
 
 #include "hype_pub_sub/hype_pub_sub.h"
 
+/**
+ * @brief This struct carries a publish to the wildcard subscriptions of a topic through the matches of the topic trie.
+ */
+typedef struct HpbPatternPublish_
+{
+    HpbPublishOrigin origin; /**< Publisher tag and publisher sequence number of the message. */
+    char *payload; /**< Topic and message. */
+    size_t payload_length; /**< Length of the payload. */
+} HpbPatternPublish;
+
+/**
+ * @brief This struct carries a packet sent by a fan-out to the worker threads, with the application which sends it,
+ *        since the current application of the process may change while the workers send.
+ */
+typedef struct HpbFanoutPacket_
+{
+    HypePubSub *context; /**< Application which sends the packet. */
+    HpbRetryPacket *packet; /**< Packet shared by the recipients. */
+} HpbFanoutPacket;
+
 static HypePubSub *hpb = NULL;
+static HpbTransport *hpb_transport = NULL;
+
+//
+// Static functions declaration
+//
+
+static HypePubSub *hpb_context_create(HypeInstance *own_instance, HpbTransport *transport);
+static void hpb_fanout_send_hype(HLByte *frame, size_t frame_size, HypeInstance *destination, void *arg);
+static void hpb_send(HLByte *data, size_t data_size, HypeInstance *destination, HpbRetryPriority priority);
+static void hpb_send_packet(HypePubSub *context, HpbRetryPacket *packet, HypeInstance *destination, HpbRetryPriority priority);
+static uint64_t hpb_send_hype(HLByte *data, size_t data_size, HypeInstance *destination, void *arg);
+static void hpb_retry_completion(HpbRetryEntry *entry, bool success, void *arg);
+static void hpb_handover_flush_publish(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, void *arg);
+static int hpb_publish(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, HypeInstance *publisher_instance);
+static int hpb_publish_retained(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, HypeInstance *publisher_instance);
+static int hpb_issue_publish(char *service_name, char *msg, size_t msg_length, bool is_retained);
+static void hpb_send_info(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HypeInstance *destination);
+static void hpb_request_missing_msgs(uint64_t now_ms);
+static void hpb_process_local_info(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length);
+static size_t hpb_get_retained_bytes();
+static void hpb_count_duplicate(HpbSubscription *subs);
+static void hpb_send_services(HpbServiceManager *services[], HypeInstance *destinations[], size_t n_services, bool is_replica);
+static void hpb_adopt_service(HLByte service_key[], char *pattern, uint32_t next_seq, HpbPublishOrigin retained_origin, char *retained_msg,
+                              size_t retained_msg_length, HypeInstance *subscribers[], size_t n_subscribers);
+static void hpb_replicate(HpbServiceManager *services[], size_t n_services);
+static void hpb_replicate_services(uint64_t now_ms);
+static void hpb_expire_replicas(uint64_t now_ms);
+static void hpb_grant_lease(HpbServiceManager *service, HypeInstance *subscriber_instance, uint64_t now_ms);
+static void hpb_expire_lease(HLByte service_key[], HLByte client_key[], uint64_t deadline_ms, void *arg);
+static void hpb_send_heartbeats(uint64_t now_ms);
+static void hpb_apply_membership_changes(uint64_t now_ms);
+static void hpb_apply_membership_change(HypeInstance *instance, bool is_resolved, void *arg);
+static void hpb_send_subscribe(HpbSubscription *subs);
+static void hpb_remove_managed_service(HLByte service_key[]);
+static void hpb_publish_to_pattern(HLByte service_key[], void *arg);
+static void hpb_shard_services(uint64_t now_ms);
+static void hpb_shard_service(HpbServiceManager *service, uint64_t now_ms);
+static void hpb_forward_to_shards(HpbServiceManager *service, uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length);
+static void hpb_expire_shards(uint64_t now_ms);
+static void hpb_disseminate(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HpbClient *recipients[], size_t n_recipients);
+static size_t hpb_relay(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, uint8_t branching, HpbRelayMember members[], size_t n_members, char *msg, size_t msg_length);
+static uint32_t hpb_get_link_cost(HypeInstance *instance);
+static bool hpb_is_direct_allowed(HpbServiceManager *service);
+static void hpb_push_subscriber_list(HpbServiceManager *service, uint64_t now_ms);
+static void hpb_push_subscriber_lists(uint64_t now_ms);
+static HpbDirectRoute *hpb_find_direct_route(HLByte service_key[]);
+static void hpb_request_subscriber_list(HpbDirectRoute *route, uint64_t now_ms);
+static void hpb_refresh_direct_routes(uint64_t now_ms);
+static HpbSubscription *hpb_deliver_own_publish(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length);
+static bool hpb_publish_direct(HLByte service_key[], HypeInstance *manager_instance, HpbPublishOrigin origin, char *msg, size_t msg_length);
+static bool linked_list_callback_is_same_route(void *route1, void *route2);
+static void linked_list_callback_free_direct_route(void **element);
+static void hpb_dispatch_resolutions(uint64_t now_ms);
+static void hpb_resolve_hype(HypeInstance *instance, void *arg);
+
+//
+// Header functions implementation
+//
 
 HypePubSub* hpb_get()
 {
     if(hpb == NULL)
     {
-        hpb = (HypePubSub*) malloc(sizeof(HypePubSub));
-        hpb->own_subscriptions = hpb_list_subscriptions_create();
-        hpb->managed_services = hpb_list_service_managers_create();
-
 #ifdef HPB_UNIT_TESTING
         HypeBuffer *buf = hype_buffer_create_from(HPB_DUMMY_OWN_INSTANCE_ID, HPB_DUMMY_OWN_INSTANCE_SIZE);
         HypeInstance *own_instance = hype_instance_create(buf, NULL, false);
         hype_buffer_release(buf);
 #else
-        HypeInstance *own_instance = hype_get_host_instance();
+        HypeInstance *own_instance = hpb_transport_get_own_instance(hpb_transport);
 #endif
-        hpb->network = hpb_network_create(own_instance);
-
-#ifdef HPB_UNIT_TESTING
+        hpb = hpb_context_create(own_instance, hpb_transport);
         hype_instance_release(own_instance);
-#endif
     }
 
     return hpb;
 }
 
+HypePubSub *hpb_create(HpbTransport *transport)
+{
+    HypeInstance *own_instance = hpb_transport_get_own_instance(transport);
+    HypePubSub *context = hpb_context_create(own_instance, transport);
+    hype_instance_release(own_instance);
+    return context;
+}
+
+void hpb_set_current(HypePubSub *context)
+{
+    hpb = context;
+}
+
+void hpb_set_transport(HpbTransport *transport)
+{
+    hpb_transport = transport;
+}
+
 int hpb_issue_subscribe_req(char* service_name)
 {
-    HypePubSub *hpb = hpb_get();
+    return hpb_issue_filtered_subscribe_req(service_name, NULL);
+}
 
-    HLByte service_key[SHA1_BLOCK_SIZE];
-    sha1_digest((const BYTE *) service_name, strlen(service_name), service_key);
+int hpb_issue_filtered_subscribe_req(char *service_name, char *filter)
+{
+    HypePubSub *hpb = hpb_get();
 
-    HypeInstance * manager_instance = hpb_network_get_service_manager_id(hpb->network, service_key);
+    // The filter is compiled here as well, so that an invalid filter is reported to the user instead of ignored by the manager
+    if(filter != NULL)
+    {
+        HpbFilter *compiled_filter = hpb_filter_compile(filter);
+        if(compiled_filter == NULL)
+        {
+            printf("Invalid filter: %s\n", filter);
+            return -1;
+        }
+        hpb_filter_destroy(&compiled_filter);
+    }
 
-    // Add subscription to the list of own subscriptions
-    hpb_list_subscriptions_add(hpb->own_subscriptions, service_name, strlen(service_name), manager_instance);
+    HLByte placement_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) service_name, strlen(service_name), placement_key);
 
-    // if this client is the manager of the service we don't need to send the subscribe message to
-    // the protocol manager
-    if(hpb_client_is_instance_equal(hpb->network->own_client, manager_instance)) {
-        hpb_process_subscribe_req(service_key, hpb->network->own_client->hype_instance);
+    // Wildcard subscriptions are managed by the manager of the first level of the pattern
+    if(hpb_topic_is_valid_pattern(service_name)) {
+        hpb_topic_get_rendezvous_key(service_name, strlen(service_name), placement_key);
     }
-    else {
-        HLByte *packet;
-        size_t packet_size = hpb_protocol_build_subscribe_msg(service_key, &packet);
-        HypeMessage *hype_msg = hype_send(packet, packet_size, manager_instance, false);
-        free(packet);
-        hype_message_release(hype_msg);
+
+    HypeInstance * manager_instance = hpb_network_get_service_manager_id(hpb->network, placement_key);
+
+    // Add subscription to the list of own subscriptions
+    HpbSubscription *subs = hpb_list_subscriptions_add(hpb->own_subscriptions, service_name, strlen(service_name), manager_instance);
+    if(subs == NULL) {
+        return -1;
     }
 
+    free(subs->filter);
+    subs->filter = (filter != NULL) ? strdup(filter) : NULL;
+
+    hpb_send_subscribe(subs);
     return 0;
 }
 
@@ -63,14 +168,15 @@ int hpb_issue_unsubscribe_req(char *service_name)
     HLByte service_key[SHA1_BLOCK_SIZE];
     sha1_digest((const BYTE *) service_name, strlen(service_name), service_key);
 
-    HypeInstance * manager_instance = hpb_network_get_service_manager_id(hpb->network, service_key);
-
-    if(hpb_list_subscriptions_find(hpb->own_subscriptions, service_key) == NULL)
+    HpbSubscription *subs = hpb_list_subscriptions_find(hpb->own_subscriptions, service_key);
+    if(subs == NULL)
     {
         printf("Trying to unsubscribe a service that was not previously subscribed: %s.\n", service_name);
         return -1;
     }
 
+    HypeInstance * manager_instance = hpb_network_get_service_manager_id(hpb->network, subs->placement_key);
+
     // Remove the subscription from the list of own subscriptions
     hpb_list_subscriptions_remove(hpb->own_subscriptions, service_key);
 
@@ -82,113 +188,177 @@ int hpb_issue_unsubscribe_req(char *service_name)
     else {
         HLByte *packet;
         size_t packet_size = hpb_protocol_build_unsubscribe_msg(service_key, &packet);
-        HypeMessage *hype_msg = hype_send(packet, packet_size, manager_instance, false);
+        hpb_send(packet, packet_size, manager_instance, HPB_RETRY_PRIORITY_CONTROL);
         free(packet);
-        hype_message_release(hype_msg);
     }
 
     return 0;
 }
 
 int hpb_issue_publish_req(char *service_name, char *msg, size_t msg_length)
+{
+    return hpb_issue_publish(service_name, msg, msg_length, false);
+}
+
+int hpb_issue_retained_publish_req(char *service_name, char *msg, size_t msg_length)
+{
+    return hpb_issue_publish(service_name, msg, msg_length, true);
+}
+
+int hpb_process_subscribe_req(HLByte service_key[], HypeInstance * instance_origin)
 {
     HypePubSub *hpb = hpb_get();
 
-    HLByte service_key[SHA1_BLOCK_SIZE];
-    sha1_digest((const BYTE *) service_name, strlen(service_name), service_key);
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
 
-    HypeInstance * manager_instance = hpb_network_get_service_manager_id(hpb->network, service_key);
+    if(service == NULL) // If the service does not exist we create it.
+    {
+        service = hpb_list_service_managers_add(hpb->managed_services, service_key);
+        if(service == NULL) { // If the service could not be created we exit.
+            return -1;
+        }
 
-    // if this client is the manager of the service we don't need to send the publish message
-    // to the protocol manager
-    if(hpb_client_is_instance_equal(hpb->network->own_client, manager_instance)) {
-        hpb_process_publish_req(service_key, msg, msg_length);
+        // The service is managed here again, so its publishes must no longer be forwarded
+        hpb_handover_remove_forward(hpb->handover, service_key);
     }
-    else {
-        HLByte *packet;
-        size_t packet_size = hpb_protocol_build_publish_msg(service_key, msg, msg_length, &packet);
-        HypeMessage *hype_msg = hype_send(packet, packet_size, manager_instance, false);
-        free(packet);
-        hype_message_release(hype_msg);
+
+    // Subscribers handed over by the previous manager subscribe again once they notice the new manager
+    bool is_new_subscriber = (hpb_list_clients_find(service->subscribers, instance_origin) == NULL);
+    hpb_service_manager_add_subscriber(service, instance_origin);
+    service->is_replica_dirty |= is_new_subscriber;
+    service->is_shard_dirty |= is_new_subscriber;
+    hpb_grant_lease(service, instance_origin, hpb_clock_now_ms());
+
+    // New subscribers get the retained message right away instead of waiting for the next publish
+    if(service->retained_msg != NULL && is_new_subscriber) {
+        // It carries the last sequence number of the service, from which the subscriber detects gaps
+        hpb_send_info(service_key, service->next_seq - 1, service->retained_origin, service->retained_msg, service->retained_msg_length, instance_origin);
     }
 
+    // Deliver the publishes which arrived before the first subscriber
+    hpb_handover_flush(hpb->handover, service_key, hpb_handover_flush_publish, NULL);
+
+    hpb_push_subscriber_list(service, hpb_clock_now_ms());
     return 0;
 }
 
-int hpb_process_subscribe_req(HLByte service_key[], HypeInstance * instance_origin)
+int hpb_process_pattern_subscribe_req(HLByte service_key[], char *pattern, HypeInstance * instance_origin)
 {
     HypePubSub *hpb = hpb_get();
 
+    if(!hpb_topic_is_valid_pattern(pattern)) {
+        return -1;
+    }
+
     HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
 
-    if(service == NULL) // If the service does not exist we create it.
+    if(service == NULL)
     {
         service = hpb_list_service_managers_add(hpb->managed_services, service_key);
-        if(service == NULL) { // If the service could not be created we exit.
+        if(service == NULL) {
             return -1;
         }
     }
 
-    hpb_list_clients_add(service->subscribers, instance_origin);
+    if(service->pattern == NULL)
+    {
+        hpb_service_manager_set_pattern(service, pattern);
+        hpb_topic_trie_add(hpb->topic_trie, service->pattern, service_key);
+    }
 
-    return 0;
+    return hpb_process_subscribe_req(service_key, instance_origin);
 }
 
-int hpb_process_unsubscribe_req(HLByte service_key[], HypeInstance * instance_origin)
+int hpb_process_filter_req(HLByte service_key[], char *filter, HypeInstance * instance_origin)
 {
     HypePubSub *hpb = hpb_get();
 
     HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
 
-    if(service == NULL) { // If the service does not exist we ignore the unsubscribe request.
+    if(service == NULL) {
         return -1;
     }
 
-    hpb_list_clients_remove(service->subscribers, instance_origin);
+    // Filtered subscribers are served by the manager, which evaluates their filter
+    service->is_shard_dirty = true;
 
-    if(service->subscribers->size == 0) { // Remove the service if there is no subscribers
-        hpb_list_service_managers_remove(hpb->managed_services, service_key);
+    int result = 0;
+    if(hpb_service_manager_set_filter(service, instance_origin, filter) != 0)
+    {
+        hpb_service_manager_set_filter(service, instance_origin, NULL);
+        result = -1;
     }
 
-    return 0;
+    hpb_push_subscriber_list(service, hpb_clock_now_ms());
+    return result;
 }
 
-int hpb_process_publish_req(HLByte service_key[], char *msg, size_t msg_length)
+int hpb_process_unsubscribe_req(HLByte service_key[], HypeInstance * instance_origin)
 {
     HypePubSub *hpb = hpb_get();
 
     HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
 
-    if(service == NULL) {
+    if(service == NULL) { // If the service does not exist we ignore the unsubscribe request.
         return -1;
     }
 
-    LinkedListIterator *it = linked_list_iterator_create(service->subscribers);
-    do
+    hpb_service_manager_remove_subscriber(service, instance_origin);
+    service->is_replica_dirty = true;
+    service->is_shard_dirty = true;
+
+    // Remove the service if there is no subscribers. Services with a retained message are kept for future subscribers.
+    if(service->subscribers->size == 0 && service->retained_msg == NULL)
     {
-        HpbClient* client = (HpbClient*) linked_list_iterator_get_element(it);
-        if(client == NULL) {
-            continue;
-        }
+        hpb_replicate(&service, 1); // The replicas of the empty service are dropped
+        hpb_remove_managed_service(service_key);
+        return 0;
+    }
 
-        if(hpb_client_is_instance_equal(hpb->network->own_client, client->hype_instance)) {
-            hpb_process_info_msg(service_key, msg, msg_length);
-        }
-        else {
-            HLByte *packet;
-            size_t packet_size = hpb_protocol_build_info_msg(service_key, msg, msg_length, &packet);
-            HypeMessage *hype_msg = hype_send(packet, packet_size, client->hype_instance, false);
-            free(packet);
-            hype_message_release(hype_msg);
-        }
+    hpb_push_subscriber_list(service, hpb_clock_now_ms());
+    return 0;
+}
 
-    } while(linked_list_iterator_advance(it) != -1);
-    linked_list_iterator_destroy(&it);
+int hpb_process_publish_req(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    hpb_get();
+    return hpb_publish(service_key, origin, msg, msg_length, NULL);
+}
 
-    return 0;
+int hpb_process_no_echo_publish_req(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, bool is_retained, HypeInstance * instance_origin)
+{
+    hpb_get();
+
+    if(is_retained) {
+        return hpb_publish_retained(service_key, origin, msg, msg_length, instance_origin);
+    }
+    return hpb_publish(service_key, origin, msg, msg_length, instance_origin);
+}
+
+int hpb_process_pattern_publish_req(HpbPublishOrigin origin, char *payload, size_t payload_length)
+{
+    HypePubSub *hpb = hpb_get();
+
+    char *topic;
+    char *msg;
+    size_t topic_length;
+    size_t msg_length;
+    if(hpb_topic_parse_payload(payload, payload_length, &topic, &topic_length, &msg, &msg_length) != 0) {
+        return -1;
+    }
+
+    // The payload is published as is, so that the subscribers of the patterns get the topic with the message
+    HpbPatternPublish publish = {origin, payload, payload_length};
+    return (int) hpb_topic_trie_match(hpb->topic_trie, topic, topic_length, hpb_publish_to_pattern, &publish);
+}
+
+int hpb_process_retained_publish_req(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    hpb_get();
+    return hpb_publish_retained(service_key, origin, msg, msg_length, NULL);
 }
 
-int hpb_process_info_msg(HLByte service_key[], char *msg, size_t msg_length)
+int hpb_process_info_msg(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length)
 {
     HypePubSub *hpb = hpb_get();
 
@@ -199,91 +369,1946 @@ int hpb_process_info_msg(HLByte service_key[], char *msg, size_t msg_length)
         return -1;
     }
 
+    // The same message may arrive through different managers, which assign it different sequence numbers
+    if(hpb_dedup_cache_is_duplicate(&(subs->dedup_cache), origin))
+    {
+        hpb->n_duplicates_suppressed++;
+        return -2;
+    }
+
+    // The first message after a manager change ends the failover of the subscription
+    if(subs->manager_change_ms != 0)
+    {
+        uint64_t failover_ms = hpb_clock_now_ms() - subs->manager_change_ms;
+        hpb->n_failovers++;
+        hpb->failover_total_ms += failover_ms;
+        hpb->failover_max_ms = (failover_ms > hpb->failover_max_ms) ? failover_ms : hpb->failover_max_ms;
+        subs->manager_change_ms = 0;
+    }
+
+    if(hpb->message_received_callback != NULL)
+    {
+        hpb->message_received_callback(subs->service_name, msg, msg_length);
+        return 0;
+    }
+
     printf("\n### Message Received! ###\n");
     printf("ServiceName: %s \n", subs->service_name);
 
     printf("ServiceKey: 0x"); binary_utils_print_hex_array(service_key, SHA1_BLOCK_SIZE);
+
+    // The messages of wildcard subscriptions carry the topic in which they were published
+    char *topic;
+    char *topic_msg;
+    size_t topic_length;
+    size_t topic_msg_length;
+    if(subs->is_pattern && msg_length > 0 && hpb_topic_parse_payload(msg, msg_length - 1, &topic, &topic_length, &topic_msg, &topic_msg_length) == 0)
+    {
+        printf("Topic: %.*s\n", (int) topic_length, topic);
+        printf("Message: %.*s\n\n", (int) topic_msg_length, topic_msg);
+        return 0;
+    }
+
     printf("Message: %s\n\n", msg);
     return 0;
 }
 
-int hpb_update_managed_services()
+int hpb_process_sequenced_info_msg(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length)
 {
     HypePubSub *hpb = hpb_get();
 
-    LinkedListIterator *it = linked_list_iterator_create(hpb->managed_services);
-    do
+    HpbSubscription *subs = hpb_list_subscriptions_find(hpb->own_subscriptions, service_key);
+
+    if(subs == NULL) {
+        return hpb_process_info_msg(service_key, origin, msg, msg_length);
+    }
+
+    HpbSeqResult result = hpb_seq_window_receive(&(subs->seq_window), seq);
+    if(result == HPB_SEQ_DUPLICATE || result == HPB_SEQ_TOO_OLD)
     {
-        HpbServiceManager* service_man = (HpbServiceManager*) linked_list_iterator_get_element(it);
-        if(service_man == NULL) {
+        hpb_count_duplicate(subs);
+        return -2;
+    }
+
+    // An own message delivered locally may still be sent by a manager which did not suppress it
+    if(origin.publisher_tag == hpb->publisher_tag && subs->n_unechoed > 0) {
+        subs->n_unechoed--;
+    }
+
+    // The own messages delivered locally leave gaps in the sequence which are not missing messages
+    size_t n_missing = hpb_seq_window_count_missing(&(subs->seq_window));
+    if(n_missing > 0 && n_missing <= subs->n_unechoed)
+    {
+        hpb_seq_window_skip_missing(&(subs->seq_window));
+        subs->n_unechoed -= (unsigned int) n_missing;
+    }
+
+    // The missing messages are only requested after a delay, since messages may arrive out of order
+    HpbSeqRange range;
+    if(hpb_seq_window_get_missing(&(subs->seq_window), &range, 1) == 0)
+    {
+        subs->gap_detected_ms = 0;
+        subs->n_nacks = 0;
+    }
+    else if(subs->gap_detected_ms == 0) {
+        subs->gap_detected_ms = hpb_clock_now_ms();
+    }
+
+    // The messages filtered out by the manager leave gaps in the sequence which are not missing messages
+    if(subs->filter != NULL)
+    {
+        hpb_seq_window_skip_missing(&(subs->seq_window));
+        subs->gap_detected_ms = 0;
+    }
+
+    return hpb_process_info_msg(service_key, origin, msg, msg_length);
+}
+
+int hpb_process_nack_req(HLByte service_key[], HpbSeqRange ranges[], size_t n_ranges, HypeInstance * instance_origin)
+{
+    HypePubSub *hpb = hpb_get();
+
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+
+    if(service == NULL) {
+        return -1;
+    }
+
+    HpbHistory *history = service->history;
+    if(history == NULL || history->size == 0) {
+        return 0;
+    }
+
+    // Only the messages still kept in the history are resent, the others are lost
+    uint32_t oldest_seq = history->entries[history->first].seq;
+    uint32_t newest_seq = history->entries[(history->first + history->size - 1) % HPB_HISTORY_MAX_ENTRIES].seq;
+    int n_resent = 0;
+    for(size_t i = 0; i < n_ranges; i++)
+    {
+        // The sequence numbers wrap, so they are compared by their signed distance
+        uint32_t first = ((int32_t) (ranges[i].first - oldest_seq) < 0) ? oldest_seq : ranges[i].first;
+        uint32_t last = ((int32_t) (ranges[i].last - newest_seq) > 0) ? newest_seq : ranges[i].last;
+        if((int32_t) (ranges[i].last - ranges[i].first) < 0 || (int32_t) (last - first) < 0) {
             continue;
         }
 
-        // Check if a new Hype client with a closer key to this service key has appeared. If this happens
-        // we remove the service from the list of managed services of this Hype client.
-        HypeInstance *new_manager_instance = hpb_network_get_service_manager_id(hpb->network, service_man->service_key);
-        if(memcmp(hpb->network->own_client->hype_instance, new_manager_instance, new_manager_instance->identifier->size) != 0) {
-            hpb_list_service_managers_remove(hpb->managed_services, service_man->service_key);
+        for(uint32_t offset = 0; offset <= last - first; offset++)
+        {
+            HpbHistoryEntry *entry = hpb_history_find(history, first + offset);
+            if(entry != NULL)
+            {
+                hpb_send_info(service_key, entry->seq, entry->origin, entry->msg, entry->msg_length, instance_origin);
+                n_resent++;
+            }
         }
+    }
 
-    } while(linked_list_iterator_advance(it) != -1);
+    return n_resent;
+}
 
-    linked_list_iterator_destroy(&it);
+int hpb_process_handover_req(HLByte service_key[], char *pattern, uint32_t next_seq, HpbPublishOrigin retained_origin, char *retained_msg,
+                             size_t retained_msg_length, HypeInstance *subscribers[], size_t n_subscribers)
+{
+    HypePubSub *hpb = hpb_get();
+
+    hpb_adopt_service(service_key, pattern, next_seq, retained_origin, retained_msg, retained_msg_length, subscribers, n_subscribers);
+    hpb->handover->n_services_received++;
+
+    // The state handed over is newer than any replica of the service
+    hpb_list_service_managers_remove(hpb->replicas, service_key);
     return 0;
 }
 
-void hpb_remove_subscriptions_from_lost_instance(HypeInstance * instance)
+int hpb_process_heartbeat_req(HLByte *service_keys, HLByte *key_flags, size_t n_services, HypeInstance *instance_origin)
 {
     HypePubSub *hpb = hpb_get();
 
-    LinkedListIterator * it = linked_list_iterator_create(hpb->managed_services);
-    do
+    HLByte *unknown_keys = (HLByte *) malloc(n_services * SHA1_BLOCK_SIZE);
+    size_t n_unknown = 0;
+
+    uint64_t now_ms = hpb_clock_now_ms();
+    for(size_t i = 0; i < n_services; i++)
     {
-        HpbServiceManager * service_manager = (HpbServiceManager*) linked_list_iterator_get_element(it);
-        hpb_process_unsubscribe_req(service_manager->service_key,instance);
+        HLByte *service_key = service_keys + i * SHA1_BLOCK_SIZE;
+        HLByte flags = (key_flags != NULL) ? key_flags[i] : 0;
+        HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+        HpbClient *subscriber = (service != NULL) ? hpb_list_clients_find(service->subscribers, instance_origin) : NULL;
 
-    } while(linked_list_iterator_advance(it) != -1);
+        // A subscriber without its pattern or filter, for example one promoted from a replica, is unknown as well
+        bool is_known = subscriber != NULL && (!(flags & HPB_PROTOCOL_FLAG_WILDCARD) || service->pattern != NULL)
+                        && (!(flags & HPB_PROTOCOL_FLAG_FILTER) || subscriber->filter != NULL);
 
-    linked_list_iterator_destroy(&it);
+        if(is_known) {
+            hpb_grant_lease(service, instance_origin, now_ms);
+        }
+        else if(flags == 0) {
+            hpb_process_subscribe_req(service_key, instance_origin);
+        }
+        else {
+            memcpy(unknown_keys + n_unknown * SHA1_BLOCK_SIZE, service_key, SHA1_BLOCK_SIZE);
+            n_unknown++;
+        }
+    }
+
+    if(n_unknown > 0 && hpb_client_is_instance_equal(hpb->network->own_client, instance_origin)) {
+        hpb_process_unknown_heartbeat_msg(unknown_keys, n_unknown, instance_origin);
+    }
+    else if(n_unknown > 0)
+    {
+        HLByte *packet;
+        size_t packet_size = hpb_protocol_build_unknown_heartbeat_msg(unknown_keys, n_unknown, &packet);
+        hpb_send(packet, packet_size, instance_origin, HPB_RETRY_PRIORITY_CONTROL);
+        free(packet);
+    }
+
+    free(unknown_keys);
+    return 0;
 }
 
-int hpb_update_own_subscriptions()
+int hpb_process_unknown_heartbeat_msg(HLByte *service_keys, size_t n_services, HypeInstance *instance_origin)
 {
     HypePubSub *hpb = hpb_get();
 
-    LinkedListIterator *it = linked_list_iterator_create(hpb->own_subscriptions);
-    do
+    for(size_t i = 0; i < n_services; i++)
     {
-        HpbSubscription* subscription = (HpbSubscription*) linked_list_iterator_get_element(it);
-        if(subscription == NULL) {
+        HpbSubscription *subs = hpb_list_subscriptions_find(hpb->own_subscriptions, service_keys + i * SHA1_BLOCK_SIZE);
+
+        // The subscription may have been cancelled or moved to another manager since the heartbeat
+        if(subs == NULL) {
             continue;
         }
+        HypeBuffer *manager_id = subs->manager_instance->identifier;
+        if(manager_id->size == instance_origin->identifier->size && memcmp(manager_id->data, instance_origin->identifier->data, manager_id->size) == 0) {
+            hpb_send_subscribe(subs);
+        }
+    }
 
-        HypeInstance *new_manager_instance = hpb_network_get_service_manager_id(hpb->network, subscription->service_key);
+    return 0;
+}
 
-        // If there is a node with a closer key to the service key we change the manager
-        if(memcmp(subscription->manager_instance, new_manager_instance, new_manager_instance->identifier->size) != 0)
-        {
-            memcpy(subscription->manager_instance, new_manager_instance, new_manager_instance->identifier->size);
-            hpb_issue_subscribe_req(subscription->service_name); // re-send the subscribe request to the new manager
-        }
+int hpb_process_replica_req(HLByte service_key[], char *pattern, uint32_t next_seq, HpbPublishOrigin retained_origin, char *retained_msg,
+                            size_t retained_msg_length, HypeInstance *subscribers[], size_t n_subscribers)
+{
+    HypePubSub *hpb = hpb_get();
 
-    } while(linked_list_iterator_advance(it) != -1);
+    hpb_list_service_managers_remove(hpb->replicas, service_key);
 
-    linked_list_iterator_destroy(&it);
+    if(n_subscribers == 0 && retained_msg == NULL) {
+        return 0;
+    }
+
+    HpbServiceManager *replica = hpb_list_service_managers_add(hpb->replicas, service_key);
+    if(replica == NULL) {
+        return -1;
+    }
 
+    replica->next_seq = next_seq;
+    if(pattern != NULL) {
+        hpb_service_manager_set_pattern(replica, pattern);
+    }
+    hpb_service_manager_set_retained_msg(replica, retained_origin, retained_msg, retained_msg_length);
+    for(size_t i = 0; i < n_subscribers; i++) {
+        hpb_list_clients_add(replica->subscribers, subscribers[i]);
+    }
+    replica->replicated_ms = hpb_clock_now_ms();
     return 0;
 }
 
-void hpb_destroy()
+int hpb_set_replication_factor(size_t replication_factor)
 {
-    if(hpb == NULL) {
-        return;
+    HypePubSub *hpb = hpb_get();
+
+    if(replication_factor > HPB_REPLICATION_MAX_FACTOR) {
+        return -1;
+    }
+
+    hpb->replication_factor = replication_factor;
+
+    // The new replicas get the state of the services at the next periodic tasks
+    for(LinkedListNode *node = hpb->managed_services->head; node != NULL; node = node->next) {
+        ((HpbServiceManager *) node->element)->is_replica_dirty = true;
+    }
+
+    return 0;
+}
+
+int hpb_process_shard_req(HLByte service_key[], HypeInstance *subscribers[], size_t n_subscribers)
+{
+    HypePubSub *hpb = hpb_get();
+
+    // The subscribers of the shards are replaced as a whole, so that the ones moved to other shards are dropped
+    hpb_list_service_managers_remove(hpb->shards, service_key);
+    if(n_subscribers == 0) {
+        return 0;
+    }
+
+    HpbServiceManager *shard = hpb_list_service_managers_add(hpb->shards, service_key);
+    if(shard == NULL) {
+        return -1;
+    }
+
+    for(size_t i = 0; i < n_subscribers; i++)
+    {
+        // Known instances are preferred, since they are resolved
+        HpbClient *client = hpb_list_clients_find(hpb->network->network_clients, subscribers[i]);
+        hpb_list_clients_add(shard->subscribers, (client != NULL) ? client->hype_instance : subscribers[i]);
+    }
+    shard->replicated_ms = hpb_clock_now_ms();
+
+    return 0;
+}
+
+int hpb_process_shard_publish_req(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    HypePubSub *hpb = hpb_get();
+
+    HpbServiceManager *shard = hpb_list_service_managers_find(hpb->shards, service_key);
+
+    if(shard == NULL) { // The subscribers which miss the message get it from the manager
+        return -1;
     }
 
-    hpb_list_subscriptions_destroy(&(hpb->own_subscriptions));
-    hpb_list_service_managers_destroy(&(hpb->managed_services));
-    hpb_network_destroy(&(hpb->network));
-    free(hpb);
-    hpb = NULL;
+    HpbClient **recipients = (HpbClient **) malloc(shard->subscribers->size * sizeof(HpbClient *));
+    size_t n_recipients = 0;
+    bool is_own_subscriber = false;
+
+    for(LinkedListNode *node = shard->subscribers->head; node != NULL; node = node->next)
+    {
+        HpbClient *client = (HpbClient *) node->element;
+        if(hpb_client_is_instance_equal(hpb->network->own_client, client->hype_instance)) {
+            is_own_subscriber = true;
+        }
+        else {
+            recipients[n_recipients++] = client;
+        }
+    }
+
+    // The frames keep the sequence number of the manager, to which the subscribers send their NACKs
+    hpb_disseminate(service_key, seq, origin, msg, msg_length, recipients, n_recipients);
+    hpb->n_shard_deliveries += n_recipients;
+    free(recipients);
+
+    if(is_own_subscriber) {
+        hpb_process_local_info(service_key, origin, msg, msg_length);
+    }
+
+    return 0;
+}
+
+int hpb_set_shards(size_t n_shards)
+{
+    HypePubSub *hpb = hpb_get();
+
+    if(n_shards > HPB_SHARDING_MAX_SHARDS) {
+        return -1;
+    }
+
+    // The managed services are split again, or merged back, at the next periodic tasks
+    hpb->n_shards = (n_shards > 1) ? n_shards : 0;
+    return 0;
+}
+
+int hpb_process_relay_req(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, uint8_t branching,
+                          HypeInstance *children[], size_t n_children, char *msg, size_t msg_length)
+{
+    HypePubSub *hpb = hpb_get();
+
+    if(n_children > 0 && branching == 0) {
+        return -1;
+    }
+
+    // The subtree keeps the key order given by the manager, but the relays are chosen by the links of this client
+    HpbRelayMember *members = (HpbRelayMember *) malloc(n_children * sizeof(HpbRelayMember));
+    for(size_t i = 0; i < n_children; i++)
+    {
+        members[i].instance = children[i];
+        sha1_digest(children[i]->identifier->data, children[i]->identifier->size, members[i].key);
+        members[i].link_cost_ms = hpb_get_link_cost(children[i]);
+    }
+
+    hpb->n_relay_forwards += hpb_relay(service_key, seq, origin, branching, members, n_children, msg, msg_length);
+    free(members);
+
+    // The relay is a subscriber as well, unless it unsubscribed after the manager sent the message
+    hpb_process_sequenced_info_msg(service_key, seq, origin, msg, msg_length + 1);
+    return 0;
+}
+
+int hpb_set_relay_branching(size_t branching)
+{
+    HypePubSub *hpb = hpb_get();
+
+    if(branching > HPB_RELAY_TREE_MAX_BRANCHING) {
+        return -1;
+    }
+
+    hpb->relay_branching = (branching > 1) ? branching : 0;
+    return 0;
+}
+
+int hpb_process_subscriber_list_req(HLByte service_key[], HypeInstance *publisher)
+{
+    HypePubSub *hpb = hpb_get();
+
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+
+    // A service which is not managed here has no subscribers yet, so its messages go through the manager until then
+    if(service == NULL || !hpb_is_direct_allowed(service))
+    {
+        HLByte *packet;
+        size_t packet_size = hpb_protocol_build_subscriber_list_msg(service_key, (service != NULL) ? service->subscribers_version : 0, NULL, &packet);
+        hpb_send(packet, packet_size, publisher, HPB_RETRY_PRIORITY_CONTROL);
+        free(packet);
+        return -1;
+    }
+
+    HpbClient *client = hpb_list_clients_add(service->direct_publishers, publisher);
+    client->lease_expiration_ms = hpb_clock_now_ms() + HPB_DIRECT_LEASE_MS;
+
+    HLByte *packet;
+    size_t packet_size = hpb_protocol_build_subscriber_list_msg(service_key, service->subscribers_version, service->subscribers, &packet);
+    hpb_send(packet, packet_size, publisher, HPB_RETRY_PRIORITY_CONTROL);
+    free(packet);
+    return 0;
+}
+
+int hpb_process_subscriber_list_msg(HLByte service_key[], uint32_t version, bool is_refused, HypeInstance *subscribers[],
+                                    size_t n_subscribers, HypeInstance *manager)
+{
+    HpbDirectRoute *route = hpb_find_direct_route(service_key);
+
+    if(route == NULL || !hpb_direct_route_update(route, manager, version, is_refused, subscribers, n_subscribers, hpb_clock_now_ms())) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int hpb_set_direct_publish(char *service_name, bool is_direct)
+{
+    HypePubSub *hpb = hpb_get();
+
+    HLByte service_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) service_name, strlen(service_name), service_key);
+    HpbDirectRoute *route = hpb_find_direct_route(service_key);
+
+    if(!is_direct)
+    {
+        // The manager stops pushing the subscribers once the lease of this client expires
+        if(route == NULL) {
+            return -1;
+        }
+        linked_list_remove(hpb->direct_routes, route, linked_list_callback_is_same_route, linked_list_callback_free_direct_route);
+        return 0;
+    }
+
+    if(route != NULL) {
+        return 0;
+    }
+    if(hpb_topic_is_pattern(service_name)) { // Messages are not published to patterns
+        return -1;
+    }
+
+    route = hpb_direct_route_create(service_name);
+    if(route == NULL) {
+        return -1;
+    }
+
+    linked_list_add(hpb->direct_routes, route);
+    hpb_direct_route_set_manager(route, hpb_network_get_service_manager_id(hpb->network, service_key));
+    hpb_request_subscriber_list(route, hpb_clock_now_ms());
+    return 0;
+}
+
+int hpb_process_membership_event(HypeInstance *instance, bool is_resolved)
+{
+    HypePubSub *hpb = hpb_get();
+
+    // A resolved or lost instance frees its handshake slot for the next instance found
+    uint64_t now_ms = hpb_clock_now_ms();
+    if(is_resolved) {
+        hpb_resolver_complete(hpb->resolver, instance, true, now_ms);
+    }
+    else {
+        hpb_resolver_remove(hpb->resolver, instance);
+    }
+    hpb_dispatch_resolutions(now_ms);
+
+    if(hpb_membership_add_event(hpb->membership, instance, is_resolved, now_ms) != 0) {
+        return -1;
+    }
+
+    if(hpb->membership->window_ms == 0) {
+        hpb_apply_membership_changes(now_ms);
+    }
+
+    return 0;
+}
+
+int hpb_process_instance_found(HypeInstance *instance)
+{
+    HypePubSub *hpb = hpb_get();
+
+    uint64_t now_ms = hpb_clock_now_ms();
+    if(!hpb_resolver_add(hpb->resolver, instance, now_ms)) {
+        return -1;
+    }
+
+    hpb_dispatch_resolutions(now_ms);
+    return 0;
+}
+
+int hpb_process_instance_failed_resolving(HypeInstance *instance)
+{
+    HypePubSub *hpb = hpb_get();
+
+    uint64_t now_ms = hpb_clock_now_ms();
+    if(!hpb_resolver_complete(hpb->resolver, instance, false, now_ms)) {
+        return -1;
+    }
+
+    hpb_dispatch_resolutions(now_ms);
+    return 0;
+}
+
+int hpb_set_max_resolutions(size_t max_resolutions)
+{
+    HypePubSub *hpb = hpb_get();
+
+    if(hpb_resolver_set_max_in_flight(hpb->resolver, max_resolutions) != 0) {
+        return -1;
+    }
+
+    hpb_dispatch_resolutions(hpb_clock_now_ms());
+    return 0;
+}
+
+void hpb_set_membership_window(uint64_t window_ms)
+{
+    hpb_get()->membership->window_ms = window_ms;
+}
+
+void hpb_set_placement(HpbPlacement placement)
+{
+    HypePubSub *hpb = hpb_get();
+
+    if(hpb->network->placement == placement) {
+        return;
+    }
+
+    hpb_network_set_placement(hpb->network, placement);
+
+    // The services and the replicas move as if the network had changed
+    for(LinkedListNode *node = hpb->managed_services->head; node != NULL; node = node->next) {
+        ((HpbServiceManager *) node->element)->is_replica_dirty = true;
+    }
+    hpb_update_managed_services();
+    hpb_update_own_subscriptions();
+}
+
+int hpb_promote_replicas()
+{
+    HypePubSub *hpb = hpb_get();
+
+    int n_promoted = 0;
+    LinkedListNode *node = hpb->replicas->head;
+    while(node != NULL)
+    {
+        HpbServiceManager *replica = (HpbServiceManager *) node->element;
+        node = node->next;
+
+        HypeInstance *manager_instance = hpb_network_get_service_manager_id(hpb->network, replica->placement_key);
+        if(!hpb_client_is_instance_equal(hpb->network->own_client, manager_instance)) {
+            continue;
+        }
+
+        HypeInstance **subscribers = (HypeInstance **) malloc(replica->subscribers->size * sizeof(HypeInstance *));
+        size_t n_subscribers = 0;
+        for(LinkedListNode *sub_node = replica->subscribers->head; sub_node != NULL; sub_node = sub_node->next) {
+            subscribers[n_subscribers++] = ((HpbClient *) sub_node->element)->hype_instance;
+        }
+
+        // The replica may lag behind the manager, so the sequence jumps far enough for the subscribers to restart it
+        hpb_adopt_service(replica->service_key, replica->pattern, replica->next_seq + 2 * HPB_SEQ_RESET_DISTANCE, replica->retained_origin,
+                          replica->retained_msg, replica->retained_msg_length, subscribers, n_subscribers);
+        free(subscribers);
+
+        hpb_list_service_managers_remove(hpb->replicas, replica->service_key);
+        hpb->n_promotions++;
+        n_promoted++;
+    }
+
+    // The lost instance may have held replicas, or shards, of the managed services
+    for(node = hpb->managed_services->head; node != NULL; node = node->next)
+    {
+        ((HpbServiceManager *) node->element)->is_replica_dirty = true;
+        ((HpbServiceManager *) node->element)->is_shard_dirty = true;
+    }
+
+    return n_promoted;
+}
+
+int hpb_update_managed_services()
+{
+    HypePubSub *hpb = hpb_get();
+
+    // The services are removed only after the iteration, once their state was sent
+    HpbServiceManager **services = (HpbServiceManager **) malloc(hpb->managed_services->size * sizeof(HpbServiceManager *));
+    HypeInstance **managers = (HypeInstance **) malloc(hpb->managed_services->size * sizeof(HypeInstance *));
+    size_t n_services = 0;
+
+    LinkedListIterator *it = linked_list_iterator_create(hpb->managed_services);
+    do
+    {
+        HpbServiceManager* service_man = (HpbServiceManager*) linked_list_iterator_get_element(it);
+        if(service_man == NULL) {
+            continue;
+        }
+
+        // Check if a new Hype client with a closer key to this service key has appeared. If this happens
+        // we remove the service from the list of managed services of this Hype client.
+        HypeInstance *new_manager_instance = hpb_network_get_service_manager_id(hpb->network, service_man->placement_key);
+        if(!hpb_client_is_instance_equal(hpb->network->own_client, new_manager_instance))
+        {
+            services[n_services] = service_man;
+            managers[n_services] = new_manager_instance;
+            n_services++;
+        }
+
+    } while(linked_list_iterator_advance(it) != -1);
+
+    linked_list_iterator_destroy(&it);
+
+    hpb_send_services(services, managers, n_services, false);
+
+    for(size_t i = 0; i < n_services; i++)
+    {
+        hpb_handover_add_forward(hpb->handover, services[i]->service_key, managers[i], hpb_clock_now_ms());
+        hpb_remove_managed_service(services[i]->service_key);
+    }
+
+    free(services);
+    free(managers);
+
+    // The clients next closest to the remaining services, and the owners of their shards, may have changed
+    for(LinkedListNode *node = hpb->managed_services->head; node != NULL; node = node->next)
+    {
+        ((HpbServiceManager *) node->element)->is_replica_dirty = true;
+        ((HpbServiceManager *) node->element)->is_shard_dirty = true;
+    }
+
+    return 0;
+}
+
+void hpb_remove_subscriptions_from_lost_instance(HypeInstance * instance)
+{
+    HypePubSub *hpb = hpb_get();
+
+    // Unsubscribing may remove the service, so the next node is taken first
+    LinkedListNode *node = hpb->managed_services->head;
+    while(node != NULL)
+    {
+        HpbServiceManager * service_manager = (HpbServiceManager*) node->element;
+        node = node->next;
+        hpb_process_unsubscribe_req(service_manager->service_key,instance);
+    }
+}
+
+int hpb_update_own_subscriptions()
+{
+    HypePubSub *hpb = hpb_get();
+
+    LinkedListIterator *it = linked_list_iterator_create(hpb->own_subscriptions);
+    do
+    {
+        HpbSubscription* subscription = (HpbSubscription*) linked_list_iterator_get_element(it);
+        if(subscription == NULL) {
+            continue;
+        }
+
+        HypeInstance *new_manager_instance = hpb_network_get_service_manager_id(hpb->network, subscription->placement_key);
+
+        // If there is a node with a closer key to the service key we change the manager
+        HypeBuffer *manager_id = subscription->manager_instance->identifier;
+        if(manager_id->size != new_manager_instance->identifier->size || memcmp(manager_id->data, new_manager_instance->identifier->data, manager_id->size) != 0)
+        {
+            hype_instance_release(subscription->manager_instance);
+            subscription->manager_instance = hype_instance_create(new_manager_instance->identifier, new_manager_instance->announcement,
+                                                                  new_manager_instance->is_resolved);
+            subscription->manager_change_ms = hpb_clock_now_ms();
+            hpb_subscription_reset_sequence(subscription); // The new manager has its own sequence numbers
+            hpb_send_subscribe(subscription); // re-send the subscribe request to the new manager
+        }
+
+    } while(linked_list_iterator_advance(it) != -1);
+
+    linked_list_iterator_destroy(&it);
+
+    return 0;
+}
+
+void hpb_set_publish_completion_callback(HpbPublishCompletionCallback callback)
+{
+    hpb_get()->publish_completion_callback = callback;
+}
+
+void hpb_set_message_received_callback(HpbMessageReceivedCallback callback)
+{
+    hpb_get()->message_received_callback = callback;
+}
+
+int hpb_process_message_failed(uint64_t message_id)
+{
+    HypePubSub *hpb = hpb_get();
+
+    hpb_metrics_add(hpb->metrics, HPB_METRICS_SEND_FAILURES, 1);
+    return hpb_retry_queue_failed(hpb->retry_queue, message_id, hpb_clock_now_ms());
+}
+
+int hpb_process_message_delivered(uint64_t message_id)
+{
+    HypePubSub *hpb = hpb_get();
+
+    return hpb_retry_queue_delivered(hpb->retry_queue, message_id, hpb_retry_completion, NULL);
+}
+
+HpbMetrics *hpb_collect_metrics()
+{
+    HypePubSub *hpb = hpb_get();
+    HpbMetrics *metrics = hpb->metrics;
+
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_NETWORK_CLIENTS, (int64_t) hpb->network->network_clients->size);
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_MANAGED_SERVICES, (int64_t) hpb->managed_services->size);
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_SUBSCRIPTIONS, (int64_t) hpb->own_subscriptions->size);
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_REPLICAS, (int64_t) hpb->replicas->size);
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_SHARDS, (int64_t) hpb->shards->size);
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_DIRECT_ROUTES, (int64_t) hpb->direct_routes->size);
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_PENDING_RESOLUTIONS, (int64_t) (hpb->resolver->pending->size + hpb->resolver->in_flight->size));
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_MEMBERSHIP_CHANGES, (int64_t) hpb->membership->changes->size);
+
+    // The retry queue is shared with the fan-out workers
+    pthread_mutex_lock(&hpb->retry_queue->mutex);
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_RETRY_ENTRIES, (int64_t) hpb->retry_queue->n_entries);
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_RETRY_BYTES, (int64_t) hpb->retry_queue->n_bytes);
+    pthread_mutex_unlock(&hpb->retry_queue->mutex);
+
+    return metrics;
+}
+
+void hpb_process_periodic_tasks()
+{
+    HypePubSub *hpb = hpb_get();
+
+    uint64_t now_ms = hpb_clock_now_ms();
+    hpb_retry_queue_process(hpb->retry_queue, now_ms, hpb_send_hype, hpb, hpb_retry_completion, NULL);
+    hpb_handover_expire(hpb->handover, now_ms);
+    hpb_request_missing_msgs(now_ms);
+    hpb_replicate_services(now_ms);
+    hpb_expire_replicas(now_ms);
+    hpb_send_heartbeats(now_ms);
+    hpb_apply_membership_changes(now_ms);
+    hpb_timer_wheel_advance(hpb->lease_timers, now_ms, hpb_expire_lease, NULL);
+    hpb_shard_services(now_ms);
+    hpb_expire_shards(now_ms);
+    hpb_push_subscriber_lists(now_ms);
+    hpb_refresh_direct_routes(now_ms);
+    hpb_dispatch_resolutions(now_ms);
+}
+
+void hpb_destroy()
+{
+    HypePubSub *context = hpb;
+    hpb_destroy_context(&context);
+}
+
+void hpb_destroy_context(HypePubSub **context)
+{
+    if((*context) == NULL) {
+        return;
+    }
+
+    hpb_list_subscriptions_destroy(&((*context)->own_subscriptions));
+    hpb_list_service_managers_destroy(&((*context)->managed_services));
+    hpb_network_destroy(&((*context)->network));
+    hpb_fanout_destroy(&((*context)->fanout));
+    hpb_retry_queue_destroy(&((*context)->retry_queue));
+    hpb_handover_destroy(&((*context)->handover));
+    hpb_list_service_managers_destroy(&((*context)->replicas));
+    hpb_timer_wheel_destroy(&((*context)->lease_timers));
+    hpb_membership_destroy(&((*context)->membership));
+    hpb_topic_trie_destroy(&((*context)->topic_trie));
+    hpb_list_service_managers_destroy(&((*context)->shards));
+    linked_list_destroy(&((*context)->direct_routes), linked_list_callback_free_direct_route);
+    hpb_resolver_destroy(&((*context)->resolver));
+    hpb_metrics_destroy(&((*context)->metrics));
+    if(hpb == (*context)) {
+        hpb = NULL; // The destroyed context is no longer the current one
+    }
+    free(*context);
+    (*context) = NULL;
+}
+
+//
+// Static functions implementation
+//
+
+static HypePubSub *hpb_context_create(HypeInstance *own_instance, HpbTransport *transport)
+{
+    HypePubSub *context = (HypePubSub*) malloc(sizeof(HypePubSub));
+    context->transport = transport;
+    context->own_subscriptions = hpb_list_subscriptions_create();
+    context->managed_services = hpb_list_service_managers_create();
+
+    context->network = hpb_network_create(own_instance);
+    context->fanout = hpb_fanout_create(HPB_FANOUT_DEFAULT_WORKERS, hpb_fanout_send_hype);
+
+    // The backoff jitter is seeded with the own key so that different clients do not retry in lockstep
+    uint32_t seed;
+    memcpy(&seed, context->network->own_client->key, sizeof(seed));
+    context->retry_queue = hpb_retry_queue_create(HPB_RETRY_QUEUE_MAX_ENTRIES, HPB_RETRY_QUEUE_MAX_BYTES, seed);
+    context->handover = hpb_handover_create(HPB_HANDOVER_BUFFER_MAX_BYTES);
+    context->publish_completion_callback = NULL;
+    context->message_received_callback = NULL;
+
+    // Publisher tags only need to tell apart the publishers of a service, so the key prefix is enough
+    context->publisher_tag = binary_utils_read_uint32(context->network->own_client->key);
+    context->next_publisher_seq = (uint32_t) hpb_clock_now_us();
+    context->n_duplicates_suppressed = 0;
+
+    context->replicas = hpb_list_service_managers_create();
+    context->replication_factor = HPB_REPLICATION_DEFAULT_FACTOR;
+    context->n_promotions = 0;
+    context->n_failovers = 0;
+    context->failover_total_ms = 0;
+    context->failover_max_ms = 0;
+
+    context->lease_timers = hpb_timer_wheel_create();
+    context->last_heartbeat_ms = 0;
+    context->n_lease_expirations = 0;
+    context->membership = hpb_membership_create(HPB_MEMBERSHIP_DEFAULT_WINDOW_MS);
+    context->topic_trie = hpb_topic_trie_create();
+    context->n_filter_evaluations = 0;
+    context->n_filtered = 0;
+    context->n_shards = HPB_SHARDING_DEFAULT_SHARDS;
+    context->shards = hpb_list_service_managers_create();
+    context->n_shard_forwards = 0;
+    context->n_shard_deliveries = 0;
+    context->relay_branching = 0;
+    context->n_relay_trees = 0;
+    context->n_relay_forwards = 0;
+    context->direct_routes = linked_list_create();
+    context->n_direct_publishes = 0;
+    context->n_local_deliveries = 0;
+    context->n_echoes_suppressed = 0;
+    context->resolver = hpb_resolver_create(HPB_RESOLVER_DEFAULT_MAX_IN_FLIGHT);
+    context->metrics = hpb_metrics_create();
+
+    return context;
+}
+
+static void hpb_fanout_send_hype(HLByte *frame, size_t frame_size, HypeInstance *destination, void *arg)
+{
+    // Invoked from the fan-out worker threads for large fan-outs. The frame is the data of the packet, which the
+    // recipients share with the retry queue
+    HpbFanoutPacket *fanout_packet = (HpbFanoutPacket *) arg;
+    hpb_send_packet(fanout_packet->context, fanout_packet->packet, destination, HPB_RETRY_PRIORITY_DATA);
+}
+
+static void hpb_send(HLByte *data, size_t data_size, HypeInstance *destination, HpbRetryPriority priority)
+{
+    HpbRetryPacket *packet = hpb_retry_queue_packet_create(hpb->retry_queue, data, data_size);
+    hpb_send_packet(hpb, packet, destination, priority);
+    hpb_retry_queue_packet_release(hpb->retry_queue, packet);
+}
+
+static void hpb_send_packet(HypePubSub *context, HpbRetryPacket *packet, HypeInstance *destination, HpbRetryPriority priority)
+{
+    uint64_t message_id = hpb_send_hype(packet->data, packet->size, destination, context);
+
+    if(message_id != 0) {
+        hpb_retry_queue_track(context->retry_queue, message_id, packet, destination, priority, hpb_clock_now_ms());
+    }
+}
+
+static uint64_t hpb_send_hype(HLByte *data, size_t data_size, HypeInstance *destination, void *arg)
+{
+    // The application is given by the caller, since the fan-out workers send for it whatever the current one
+    HypePubSub *context = (HypePubSub *) arg;
+
+    // The transport reports the delivery or the failure of the message later, by its identifier
+    if(context->transport == NULL) {
+        return 0;
+    }
+
+    int type = hpb_protocol_get_message_type(data);
+    hpb_metrics_add_by_type(context->metrics, HPB_METRICS_MESSAGES_OUT, type, 1);
+    hpb_metrics_add_by_type(context->metrics, HPB_METRICS_BYTES_OUT, type, data_size);
+
+    return hpb_transport_send(context->transport, data, data_size, destination);
+}
+
+static void hpb_retry_completion(HpbRetryEntry *entry, bool success, void *arg)
+{
+    if(!success)
+    {
+        // On the standard error, so that the give-ups of a churn do not drown the output of the application
+        fprintf(stderr, "Message to a Hype instance given up after %u attempts.\n", entry->n_attempts);
+        hpb_metrics_add(hpb->metrics, HPB_METRICS_SEND_GIVE_UPS, 1);
+    }
+
+    // The delivery times, retries included, measure the links used to choose the relays
+    HpbClient *client = hpb_list_clients_find(hpb->network->network_clients, entry->destination);
+    if(client != NULL) {
+        hpb_client_update_link_cost(client, success ? (uint32_t) (hpb_clock_now_ms() - entry->sent_ms) : HPB_CLIENT_FAILED_LINK_COST_MS);
+    }
+
+    // The manager never got the message, so no sequence number will be skipped for it
+    HLByte type = entry->packet->data[0];
+    if(!success && (type & HPB_PROTOCOL_MESSAGE_TYPE_MASK) == PUBLISH && (type & HPB_PROTOCOL_FLAG_NO_ECHO))
+    {
+        HpbSubscription *subs = hpb_list_subscriptions_find(hpb->own_subscriptions, entry->packet->data + MESSAGE_TYPE_BYTE_SIZE);
+        if(subs != NULL && subs->n_unechoed > 0) {
+            subs->n_unechoed--;
+        }
+    }
+
+    // The publishes to the wildcard subscriptions of a topic are not reported, since they are not requested by the application
+    if(hpb->publish_completion_callback != NULL && (type & HPB_PROTOCOL_MESSAGE_TYPE_MASK) == PUBLISH && !(type & HPB_PROTOCOL_FLAG_WILDCARD)) {
+        hpb->publish_completion_callback(entry->packet->data + MESSAGE_TYPE_BYTE_SIZE, success);
+    }
+}
+
+static void hpb_handover_flush_publish(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, void *arg)
+{
+    hpb_process_publish_req(service_key, origin, msg, msg_length);
+}
+
+static int hpb_publish(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, HypeInstance *publisher_instance)
+{
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+
+    if(service == NULL)
+    {
+        // If the service was just handed over, the publisher may still be using this client as manager
+        HypeInstance *new_manager = hpb_handover_find_forward(hpb->handover, service_key, hpb_clock_now_ms());
+        if(new_manager != NULL)
+        {
+            // The new manager would take this client for the publisher, so the publisher gets an echo, which it tolerates
+            HLByte *packet;
+            size_t packet_size = hpb_protocol_build_publish_msg(service_key, origin, msg, msg_length, &packet);
+            hpb_send(packet, packet_size, new_manager, HPB_RETRY_PRIORITY_DATA);
+            free(packet);
+            return 0;
+        }
+
+        // Otherwise this client may be a new manager whose subscribers did not arrive yet
+        return hpb_handover_buffer_publish(hpb->handover, service_key, origin, msg, msg_length, hpb_clock_now_ms());
+    }
+
+    // Each message gets the next sequence number of the service and is kept for the subscribers which miss it
+    uint32_t seq = service->next_seq++;
+    hpb_history_add(service->history, seq, origin, msg, msg_length);
+    hpb_service_manager_count_publishes(service, 1, hpb_clock_now_ms());
+
+    // Each distinct filter runs once, and its result is shared by the subscribers with the same filter
+    hpb->n_filter_evaluations += hpb_service_manager_evaluate_filters(service, origin, msg, msg_length);
+
+    HpbClient **recipients = (HpbClient **) malloc(service->subscribers->size * sizeof(HpbClient *));
+    size_t n_recipients = 0;
+    bool is_own_subscriber = false;
+
+    LinkedListIterator *it = linked_list_iterator_create(service->subscribers);
+    do
+    {
+        HpbClient* client = (HpbClient*) linked_list_iterator_get_element(it);
+        if(client == NULL || client->is_sharded) { // The owner of its shard sends the message to a sharded subscriber
+            continue;
+        }
+
+        if(client->filter != NULL && !client->filter->last_result)
+        {
+            hpb->n_filtered++;
+            continue;
+        }
+
+        // The publisher already delivered the message to itself
+        if(publisher_instance != NULL && hpb_client_is_instance_equal(client, publisher_instance))
+        {
+            hpb->n_echoes_suppressed++;
+            continue;
+        }
+
+        if(hpb_client_is_instance_equal(hpb->network->own_client, client->hype_instance)) {
+            is_own_subscriber = true;
+        }
+        else {
+            recipients[n_recipients++] = client;
+        }
+
+    } while(linked_list_iterator_advance(it) != -1);
+    linked_list_iterator_destroy(&it);
+
+    hpb_disseminate(service_key, seq, origin, msg, msg_length, recipients, n_recipients);
+    free(recipients);
+
+    hpb_forward_to_shards(service, seq, origin, msg, msg_length);
+
+    if(is_own_subscriber) {
+        hpb_process_local_info(service_key, origin, msg, msg_length);
+    }
+
+    return 0;
+}
+
+static int hpb_publish_retained(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, HypeInstance *publisher_instance)
+{
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+
+    // The service is created to keep the retained message, unless it was handed over to another manager
+    if(service == NULL && hpb_handover_find_forward(hpb->handover, service_key, hpb_clock_now_ms()) == NULL) {
+        service = hpb_list_service_managers_add(hpb->managed_services, service_key);
+    }
+
+    if(service != NULL)
+    {
+        size_t retained_bytes = hpb_get_retained_bytes() - service->retained_msg_length;
+        if(retained_bytes + msg_length <= HPB_RETAINED_MAX_BYTES) {
+            hpb_service_manager_set_retained_msg(service, origin, msg, msg_length);
+        }
+        else
+        {
+            // A stale retained message is worse than none
+            printf("Retained messages limit reached. The message is published without being retained.\n");
+            hpb_service_manager_set_retained_msg(service, origin, NULL, 0);
+        }
+        service->is_replica_dirty = true;
+    }
+
+    int result = hpb_publish(service_key, origin, msg, msg_length, publisher_instance);
+
+    if(service != NULL && service->subscribers->size == 0 && service->retained_msg == NULL)
+    {
+        hpb_replicate(&service, 1);
+        hpb_remove_managed_service(service_key);
+    }
+
+    return result;
+}
+
+static int hpb_issue_publish(char *service_name, char *msg, size_t msg_length, bool is_retained)
+{
+    HypePubSub *hpb = hpb_get();
+
+    HLByte service_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) service_name, strlen(service_name), service_key);
+
+    HypeInstance * manager_instance = hpb_network_get_service_manager_id(hpb->network, service_key);
+
+    HpbPublishOrigin origin;
+    origin.publisher_tag = hpb->publisher_tag;
+    origin.publisher_seq = hpb->next_publisher_seq++;
+
+    // if this client is the manager of the service we don't need to send the publish message
+    // to the protocol manager
+    if(hpb_client_is_instance_equal(hpb->network->own_client, manager_instance))
+    {
+        if(is_retained) {
+            hpb_process_retained_publish_req(service_key, origin, msg, msg_length);
+        }
+        else {
+            hpb_process_publish_req(service_key, origin, msg, msg_length);
+        }
+    }
+    else
+    {
+        // The own subscription gets the message at once, instead of waiting for the manager to send it back
+        HpbSubscription *own_subs = hpb_deliver_own_publish(service_key, origin, msg, msg_length);
+
+        // Retained messages always go through the manager, which keeps them for the future subscribers
+        if(is_retained || !hpb_publish_direct(service_key, manager_instance, origin, msg, msg_length))
+        {
+            HLByte *packet;
+            size_t packet_size;
+            if(own_subs != NULL)
+            {
+                // The sequence number given by the manager to the message will be missing from the info messages
+                own_subs->n_unechoed++;
+                packet_size = hpb_protocol_build_no_echo_publish_msg(service_key, origin, is_retained, msg, msg_length, &packet);
+            }
+            else if(is_retained) {
+                packet_size = hpb_protocol_build_retained_publish_msg(service_key, origin, msg, msg_length, &packet);
+            }
+            else {
+                packet_size = hpb_protocol_build_publish_msg(service_key, origin, msg, msg_length, &packet);
+            }
+            hpb_send(packet, packet_size, manager_instance, HPB_RETRY_PRIORITY_DATA);
+            free(packet);
+        }
+    }
+
+    // The messages of hierarchical topics are also sent to the manager of their first level, for the wildcard subscriptions
+    HLByte rendezvous_key[SHA1_BLOCK_SIZE];
+    if(hpb_topic_is_valid_pattern(service_name) || hpb_topic_get_rendezvous_key(service_name, strlen(service_name), rendezvous_key) != 0) {
+        return 0;
+    }
+
+    char *payload;
+    size_t payload_length = hpb_topic_build_payload(service_name, strlen(service_name), msg, msg_length, &payload);
+    if(payload_length == 0) {
+        return 0;
+    }
+
+    HypeInstance *rendezvous_instance = hpb_network_get_service_manager_id(hpb->network, rendezvous_key);
+    if(hpb_client_is_instance_equal(hpb->network->own_client, rendezvous_instance)) {
+        hpb_process_pattern_publish_req(origin, payload, payload_length);
+    }
+    else {
+        HLByte *packet;
+        size_t packet_size = hpb_protocol_build_pattern_publish_msg(rendezvous_key, origin, payload, payload_length, &packet);
+        hpb_send(packet, packet_size, rendezvous_instance, HPB_RETRY_PRIORITY_DATA);
+        free(packet);
+    }
+
+    free(payload);
+    return 0;
+}
+
+static void hpb_send_info(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HypeInstance *destination)
+{
+    if(hpb_client_is_instance_equal(hpb->network->own_client, destination))
+    {
+        hpb_process_local_info(service_key, origin, msg, msg_length);
+        return;
+    }
+
+    HLByte *packet;
+    size_t packet_size = hpb_protocol_build_info_msg(service_key, seq, origin, msg, msg_length, &packet);
+    hpb_send(packet, packet_size, destination, HPB_RETRY_PRIORITY_DATA);
+    free(packet);
+}
+
+static void hpb_process_local_info(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    // Messages kept by this client are not null terminated, unlike the ones received by the protocol
+    char *msg_content = (char *) malloc((msg_length + 1) * sizeof(char));
+    memcpy(msg_content, msg, msg_length);
+    msg_content[msg_length] = '\0';
+    hpb_process_info_msg(service_key, origin, msg_content, msg_length + 1);
+    free(msg_content);
+}
+
+static size_t hpb_get_retained_bytes()
+{
+    size_t retained_bytes = 0;
+
+    LinkedListNode *node = hpb->managed_services->head;
+    while(node != NULL)
+    {
+        retained_bytes += ((HpbServiceManager *) node->element)->retained_msg_length;
+        node = node->next;
+    }
+
+    return retained_bytes;
+}
+
+static void hpb_count_duplicate(HpbSubscription *subs)
+{
+    subs->dedup_cache.n_suppressed++;
+    hpb->n_duplicates_suppressed++;
+}
+
+static void hpb_send_services(HpbServiceManager *services[], HypeInstance *destinations[], size_t n_services, bool is_replica)
+{
+    HpbServiceManager **batch = (HpbServiceManager **) malloc(n_services * sizeof(HpbServiceManager *));
+    bool *is_sent = (bool *) calloc(n_services, sizeof(bool));
+
+    // A single message is sent to each destination, with all the services that go to it
+    for(size_t i = 0; i < n_services; i++)
+    {
+        if(is_sent[i]) {
+            continue;
+        }
+
+        HpbClient *destination = hpb_client_create(destinations[i]);
+        size_t n_batch = 0;
+        for(size_t j = i; j < n_services; j++)
+        {
+            if(!is_sent[j] && hpb_client_is_instance_equal(destination, destinations[j]))
+            {
+                batch[n_batch++] = services[j];
+                is_sent[j] = true;
+            }
+        }
+
+        HLByte *packet;
+        size_t packet_size = (is_replica) ? hpb_protocol_build_replica_msg(batch, n_batch, &packet)
+                                          : hpb_protocol_build_handover_msg(batch, n_batch, &packet);
+        hpb_send(packet, packet_size, destinations[i], HPB_RETRY_PRIORITY_CONTROL);
+        free(packet);
+        hpb_client_destroy(&destination);
+
+        if(!is_replica) {
+            hpb->handover->n_services_sent += n_batch;
+        }
+    }
+
+    free(batch);
+    free(is_sent);
+}
+
+static void hpb_adopt_service(HLByte service_key[], char *pattern, uint32_t next_seq, HpbPublishOrigin retained_origin, char *retained_msg,
+                              size_t retained_msg_length, HypeInstance *subscribers[], size_t n_subscribers)
+{
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+
+    if(service == NULL)
+    {
+        service = hpb_list_service_managers_add(hpb->managed_services, service_key);
+        if(service == NULL) {
+            return;
+        }
+
+        hpb_handover_remove_forward(hpb->handover, service_key);
+    }
+
+    if(pattern != NULL && service->pattern == NULL && hpb_service_manager_set_pattern(service, pattern) == 0) {
+        hpb_topic_trie_add(hpb->topic_trie, service->pattern, service_key);
+    }
+
+    // The subscribers keep receiving consecutive sequence numbers, unless this client already used its own
+    if(service->history == NULL || service->history->size == 0) {
+        service->next_seq = next_seq;
+    }
+
+    if(retained_msg != NULL && service->retained_msg == NULL && hpb_get_retained_bytes() + retained_msg_length <= HPB_RETAINED_MAX_BYTES) {
+        hpb_service_manager_set_retained_msg(service, retained_origin, retained_msg, retained_msg_length);
+    }
+
+    for(size_t i = 0; i < n_subscribers; i++)
+    {
+        // Known instances are preferred, since they are resolved
+        HpbClient *client = hpb_list_clients_find(hpb->network->network_clients, subscribers[i]);
+        hpb_service_manager_add_subscriber(service, (client != NULL) ? client->hype_instance : subscribers[i]);
+        hpb_grant_lease(service, subscribers[i], hpb_clock_now_ms());
+    }
+    service->is_replica_dirty = true;
+    service->is_shard_dirty = true;
+
+    // Deliver the publishes which arrived before the state of the service
+    if(service->subscribers->size > 0) {
+        hpb_handover_flush(hpb->handover, service_key, hpb_handover_flush_publish, NULL);
+    }
+}
+
+static void hpb_replicate(HpbServiceManager *services[], size_t n_services)
+{
+    if(hpb->replication_factor == 0 || n_services == 0) {
+        return;
+    }
+
+    size_t max_copies = n_services * hpb->replication_factor;
+    HpbServiceManager **copies = (HpbServiceManager **) malloc(max_copies * sizeof(HpbServiceManager *));
+    HypeInstance **destinations = (HypeInstance **) malloc(max_copies * sizeof(HypeInstance *));
+    HypeInstance *closest[HPB_REPLICATION_MAX_FACTOR + 1];
+    size_t n_copies = 0;
+
+    // The replicas are the clients next closest to the service after this one
+    for(size_t i = 0; i < n_services; i++)
+    {
+        size_t n_closest = hpb_network_get_closest_instances(hpb->network, services[i]->placement_key, closest, hpb->replication_factor + 1);
+        for(size_t j = 0; j < n_closest; j++)
+        {
+            if(!hpb_client_is_instance_equal(hpb->network->own_client, closest[j]) && n_copies < max_copies)
+            {
+                copies[n_copies] = services[i];
+                destinations[n_copies] = closest[j];
+                n_copies++;
+            }
+        }
+
+        services[i]->is_replica_dirty = false;
+        services[i]->replicated_ms = hpb_clock_now_ms();
+    }
+
+    hpb_send_services(copies, destinations, n_copies, true);
+    free(copies);
+    free(destinations);
+}
+
+static void hpb_replicate_services(uint64_t now_ms)
+{
+    if(hpb->replication_factor == 0 || hpb->network->network_clients->size == 0) {
+        return;
+    }
+
+    // Changed services are replicated at once, the others are refreshed so that their replicas do not expire
+    HpbServiceManager **services = (HpbServiceManager **) malloc(hpb->managed_services->size * sizeof(HpbServiceManager *));
+    size_t n_services = 0;
+    for(LinkedListNode *node = hpb->managed_services->head; node != NULL; node = node->next)
+    {
+        HpbServiceManager *service = (HpbServiceManager *) node->element;
+        if(service->is_replica_dirty || now_ms >= service->replicated_ms + HPB_REPLICATION_REFRESH_MS) {
+            services[n_services++] = service;
+        }
+    }
+
+    hpb_replicate(services, n_services);
+    free(services);
+}
+
+static void hpb_expire_replicas(uint64_t now_ms)
+{
+    LinkedListNode *node = hpb->replicas->head;
+    while(node != NULL)
+    {
+        HpbServiceManager *replica = (HpbServiceManager *) node->element;
+        node = node->next;
+
+        if(now_ms >= replica->replicated_ms + HPB_REPLICATION_EXPIRATION_MS) {
+            hpb_list_service_managers_remove(hpb->replicas, replica->service_key);
+        }
+    }
+}
+
+static void hpb_grant_lease(HpbServiceManager *service, HypeInstance *subscriber_instance, uint64_t now_ms)
+{
+    HpbClient *subscriber = hpb_list_clients_find(service->subscribers, subscriber_instance);
+    if(subscriber == NULL) {
+        return;
+    }
+
+    subscriber->lease_expiration_ms = now_ms + HPB_LEASE_DURATION_MS;
+
+    // Renewals only move the expiration, the timer already scheduled checks it when it fires
+    if(subscriber->lease_timer_ms == 0)
+    {
+        subscriber->lease_timer_ms = subscriber->lease_expiration_ms;
+        hpb_timer_wheel_schedule(hpb->lease_timers, subscriber->lease_timer_ms, service->service_key, subscriber->key);
+    }
+}
+
+static void hpb_expire_lease(HLByte service_key[], HLByte client_key[], uint64_t deadline_ms, void *arg)
+{
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+    if(service == NULL) {
+        return;
+    }
+
+    // The timer is stale if the subscriber left, or left and subscribed again, since it was scheduled
+    HpbClient *subscriber = hpb_list_clients_find_by_key(service->subscribers, client_key);
+    if(subscriber == NULL || subscriber->lease_timer_ms != deadline_ms) {
+        return;
+    }
+
+    if(subscriber->lease_expiration_ms > deadline_ms)
+    {
+        subscriber->lease_timer_ms = subscriber->lease_expiration_ms;
+        hpb_timer_wheel_schedule(hpb->lease_timers, subscriber->lease_timer_ms, service_key, client_key);
+        return;
+    }
+
+    hpb->n_lease_expirations++;
+    hpb_process_unsubscribe_req(service_key, subscriber->hype_instance);
+}
+
+static void hpb_send_heartbeats(uint64_t now_ms)
+{
+    if(now_ms < hpb->last_heartbeat_ms + HPB_LEASE_RENEWAL_MS || hpb->own_subscriptions->size == 0) {
+        return;
+    }
+
+    hpb->last_heartbeat_ms = now_ms;
+
+    size_t n_subscriptions = hpb->own_subscriptions->size;
+    HpbSubscription **subscriptions = (HpbSubscription **) malloc(n_subscriptions * sizeof(HpbSubscription *));
+    HLByte *service_keys = (HLByte *) malloc(n_subscriptions * SHA1_BLOCK_SIZE);
+    HLByte *key_flags = (HLByte *) malloc(n_subscriptions);
+    bool *is_sent = (bool *) calloc(n_subscriptions, sizeof(bool));
+
+    size_t i = 0;
+    for(LinkedListNode *node = hpb->own_subscriptions->head; node != NULL; node = node->next) {
+        subscriptions[i++] = (HpbSubscription *) node->element;
+    }
+
+    // A single heartbeat is sent to each manager, with all the subscriptions it manages
+    for(i = 0; i < n_subscriptions; i++)
+    {
+        if(is_sent[i]) {
+            continue;
+        }
+
+        HpbClient *manager = hpb_client_create(subscriptions[i]->manager_instance);
+        size_t n_keys = 0;
+        bool has_flags = false;
+        for(size_t j = i; j < n_subscriptions; j++)
+        {
+            if(!is_sent[j] && hpb_client_is_instance_equal(manager, subscriptions[j]->manager_instance))
+            {
+                memcpy(service_keys + n_keys * SHA1_BLOCK_SIZE, subscriptions[j]->service_key, SHA1_BLOCK_SIZE);
+                key_flags[n_keys] = (HLByte) (((subscriptions[j]->is_pattern) ? HPB_PROTOCOL_FLAG_WILDCARD : 0)
+                                              | ((subscriptions[j]->filter != NULL) ? HPB_PROTOCOL_FLAG_FILTER : 0));
+                has_flags = has_flags || key_flags[n_keys] != 0;
+                n_keys++;
+                is_sent[j] = true;
+            }
+        }
+
+        if(hpb_client_is_instance_equal(hpb->network->own_client, subscriptions[i]->manager_instance)) {
+            hpb_process_heartbeat_req(service_keys, key_flags, n_keys, hpb->network->own_client->hype_instance);
+        }
+        else
+        {
+            HLByte *packet;
+            size_t packet_size = hpb_protocol_build_heartbeat_msg(service_keys, (has_flags) ? key_flags : NULL, n_keys, &packet);
+            hpb_send(packet, packet_size, subscriptions[i]->manager_instance, HPB_RETRY_PRIORITY_CONTROL);
+            free(packet);
+        }
+        hpb_client_destroy(&manager);
+    }
+
+    free(subscriptions);
+    free(service_keys);
+    free(key_flags);
+    free(is_sent);
+}
+
+static void hpb_apply_membership_changes(uint64_t now_ms)
+{
+    HpbClientsList *lost_instances = hpb_list_clients_create();
+    size_t n_clients = hpb->network->network_clients->size;
+
+    if(hpb_membership_apply(hpb->membership, now_ms, hpb_apply_membership_change, lost_instances) == 0)
+    {
+        hpb_list_clients_destroy(&lost_instances);
+        return;
+    }
+
+    // Instances lost and resolved again within the window leave the network as it was
+    if(lost_instances->size == 0 && hpb->network->network_clients->size == n_clients)
+    {
+        hpb_list_clients_destroy(&lost_instances);
+        return;
+    }
+
+    hpb_metrics_add(hpb->metrics, HPB_METRICS_REBALANCES, 1);
+    if(lost_instances->size > 0) {
+        hpb_promote_replicas();
+    }
+    hpb_update_managed_services();
+    hpb_update_own_subscriptions();
+
+    for(LinkedListNode *node = lost_instances->head; node != NULL; node = node->next) {
+        hpb_remove_subscriptions_from_lost_instance(((HpbClient *) node->element)->hype_instance);
+    }
+
+    hpb_list_clients_destroy(&lost_instances);
+}
+
+static void hpb_apply_membership_change(HypeInstance *instance, bool is_resolved, void *arg)
+{
+    HpbClientsList *lost_instances = (HpbClientsList *) arg;
+
+    if(is_resolved) {
+        hpb_network_add_client(hpb->network, instance);
+    }
+    else if(hpb_network_remove_client(hpb->network, instance) >= 0) {
+        hpb_list_clients_add(lost_instances, instance);
+    }
+}
+
+static void hpb_send_subscribe(HpbSubscription *subs)
+{
+    // if this client is the manager of the service we don't need to send the subscribe message to
+    // the protocol manager
+    if(hpb_client_is_instance_equal(hpb->network->own_client, subs->manager_instance))
+    {
+        int result = (subs->is_pattern) ? hpb_process_pattern_subscribe_req(subs->service_key, subs->service_name, hpb->network->own_client->hype_instance)
+                                        : hpb_process_subscribe_req(subs->service_key, hpb->network->own_client->hype_instance);
+        if(result == 0) {
+            hpb_process_filter_req(subs->service_key, subs->filter, hpb->network->own_client->hype_instance);
+        }
+        return;
+    }
+
+    HLByte *packet;
+    size_t packet_size;
+    if(subs->filter != NULL) {
+        packet_size = hpb_protocol_build_filtered_subscribe_msg(subs->service_key, (subs->is_pattern) ? subs->service_name : NULL, subs->filter, &packet);
+    }
+    else if(subs->is_pattern) {
+        packet_size = hpb_protocol_build_pattern_subscribe_msg(subs->service_key, subs->service_name, &packet);
+    }
+    else {
+        packet_size = hpb_protocol_build_subscribe_msg(subs->service_key, &packet);
+    }
+    hpb_send(packet, packet_size, subs->manager_instance, HPB_RETRY_PRIORITY_CONTROL);
+    free(packet);
+}
+
+static void hpb_remove_managed_service(HLByte service_key[])
+{
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+
+    if(service != NULL && service->pattern != NULL) {
+        hpb_topic_trie_remove(hpb->topic_trie, service->pattern, service_key);
+    }
+
+    // The owners of the shards drop them instead of waiting for them to expire
+    if(service != NULL && service->shard_owners->size > 0)
+    {
+        service->n_shards = 0;
+        hpb_shard_service(service, hpb_clock_now_ms());
+    }
+
+    // The direct publishers go back to the manager, which may be a new one, instead of sending to a stale list
+    if(service != NULL && service->direct_publishers->size > 0)
+    {
+        HLByte *packet;
+        size_t packet_size = hpb_protocol_build_subscriber_list_msg(service_key, service->subscribers_version, NULL, &packet);
+        for(LinkedListNode *node = service->direct_publishers->head; node != NULL; node = node->next) {
+            hpb_send(packet, packet_size, ((HpbClient *) node->element)->hype_instance, HPB_RETRY_PRIORITY_CONTROL);
+        }
+        free(packet);
+    }
+
+    hpb_list_service_managers_remove(hpb->managed_services, service_key);
+}
+
+static void hpb_publish_to_pattern(HLByte service_key[], void *arg)
+{
+    HpbPatternPublish *publish = (HpbPatternPublish *) arg;
+    hpb_process_publish_req(service_key, publish->origin, publish->payload, publish->payload_length);
+}
+
+static void hpb_request_missing_msgs(uint64_t now_ms)
+{
+    LinkedListNode *node = hpb->own_subscriptions->head;
+    while(node != NULL)
+    {
+        HpbSubscription *subs = (HpbSubscription *) node->element;
+        node = node->next;
+
+        if(subs->gap_detected_ms == 0 || now_ms < subs->gap_detected_ms + HPB_NACK_DELAY_MS
+           || (subs->n_nacks > 0 && now_ms < subs->last_nack_ms + HPB_NACK_INTERVAL_MS)) {
+            continue;
+        }
+
+        // Messages which could not be recovered are given up, so that the gap is not requested forever
+        HpbSeqRange ranges[HPB_PROTOCOL_NACK_MAX_RANGES];
+        size_t n_ranges = hpb_seq_window_get_missing(&(subs->seq_window), ranges, HPB_PROTOCOL_NACK_MAX_RANGES);
+        if(n_ranges == 0 || subs->n_nacks == HPB_NACK_MAX_ATTEMPTS)
+        {
+            hpb_seq_window_skip_missing(&(subs->seq_window));
+            subs->gap_detected_ms = 0;
+            subs->n_nacks = 0;
+            continue;
+        }
+
+        HLByte *packet;
+        size_t packet_size = hpb_protocol_build_nack_msg(subs->service_key, ranges, n_ranges, &packet);
+        hpb_send(packet, packet_size, subs->manager_instance, HPB_RETRY_PRIORITY_CONTROL);
+        free(packet);
+        subs->last_nack_ms = now_ms;
+        subs->n_nacks++;
+    }
+}
+
+static void hpb_shard_services(uint64_t now_ms)
+{
+    for(LinkedListNode *node = hpb->managed_services->head; node != NULL; node = node->next)
+    {
+        HpbServiceManager *service = (HpbServiceManager *) node->element;
+        hpb_service_manager_count_publishes(service, 0, now_ms);
+
+        // A service is split once it is hot and merged back once it cooled down well below the thresholds
+        size_t n_subscribers = service->subscribers->size;
+        bool is_hot = n_subscribers >= HPB_SHARDING_SUBSCRIBERS_THRESHOLD
+                      || (service->publish_rate >= HPB_SHARDING_PUBLISH_RATE_THRESHOLD && n_subscribers >= HPB_SHARDING_MIN_SUBSCRIBERS);
+        bool is_cold = n_subscribers < HPB_SHARDING_SUBSCRIBERS_THRESHOLD / 2 && service->publish_rate < HPB_SHARDING_PUBLISH_RATE_THRESHOLD / 2;
+
+        uint8_t n_shards = service->n_shards;
+        if(hpb->n_shards == 0 || (n_shards > 0 && is_cold)) {
+            n_shards = 0;
+        }
+        else if(n_shards > 0 || is_hot) {
+            n_shards = (uint8_t) hpb->n_shards;
+        }
+
+        if(n_shards != service->n_shards)
+        {
+            service->n_shards = n_shards;
+            service->is_shard_dirty = true;
+            service->subscribers_version++; // The direct publishers must stop sending to the sharded subscribers
+        }
+
+        // The owners of the shards are refreshed so that their shards do not expire
+        if(service->is_shard_dirty || (service->shard_owners->size > 0 && now_ms >= service->sharded_ms + HPB_SHARDING_REFRESH_MS)) {
+            hpb_shard_service(service, now_ms);
+        }
+    }
+}
+
+static void hpb_shard_service(HpbServiceManager *service, uint64_t now_ms)
+{
+    // The owners of the shards are the managers of their keys, so a client may own several shards, or be the manager itself
+    HypeInstance *owners[HPB_SHARDING_MAX_SHARDS];
+    for(uint8_t i = 0; i < service->n_shards; i++)
+    {
+        HLByte shard_key[SHA1_BLOCK_SIZE];
+        hpb_service_manager_get_shard_key(service, i, shard_key);
+        owners[i] = hpb_network_get_service_manager_id(hpb->network, shard_key);
+    }
+
+    // Each owner gets the subscribers of all its shards at once
+    HpbServiceManager *states[2 * HPB_SHARDING_MAX_SHARDS];
+    HypeInstance *destinations[2 * HPB_SHARDING_MAX_SHARDS];
+    size_t n_states = 0;
+
+    for(LinkedListNode *node = service->subscribers->head; node != NULL; node = node->next)
+    {
+        HpbClient *client = (HpbClient *) node->element;
+        HypeInstance *owner = (service->n_shards > 0) ? owners[hpb_service_manager_get_shard(service, client)] : NULL;
+
+        // The own subscription and the filtered subscribers are served by the manager
+        client->is_sharded = (owner != NULL && client->filter == NULL
+                              && !hpb_client_is_instance_equal(hpb->network->own_client, owner)
+                              && !hpb_client_is_instance_equal(hpb->network->own_client, client->hype_instance));
+        if(!client->is_sharded) {
+            continue;
+        }
+
+        size_t i = 0;
+        while(i < n_states && destinations[i] != owner) {
+            i++;
+        }
+        if(i == n_states)
+        {
+            states[n_states] = hpb_service_manager_create(service->service_key);
+            destinations[n_states] = owner;
+            n_states++;
+        }
+        hpb_list_clients_add(states[i]->subscribers, client->hype_instance);
+    }
+
+    // The previous owners which no longer own a shard drop theirs
+    size_t n_owners = n_states;
+    for(LinkedListNode *node = service->shard_owners->head; node != NULL; node = node->next)
+    {
+        HpbClient *previous_owner = (HpbClient *) node->element;
+
+        bool is_owner = false;
+        for(size_t i = 0; i < n_owners && !is_owner; i++) {
+            is_owner = hpb_client_is_instance_equal(previous_owner, destinations[i]);
+        }
+        if(!is_owner && n_states < 2 * HPB_SHARDING_MAX_SHARDS)
+        {
+            states[n_states] = hpb_service_manager_create(service->service_key);
+            destinations[n_states] = previous_owner->hype_instance;
+            n_states++;
+        }
+    }
+
+    for(size_t i = 0; i < n_states; i++)
+    {
+        HLByte *packet;
+        size_t packet_size = hpb_protocol_build_shard_msg(&states[i], 1, &packet);
+        hpb_send(packet, packet_size, destinations[i], HPB_RETRY_PRIORITY_CONTROL);
+        free(packet);
+    }
+
+    HpbClientsList *shard_owners = hpb_list_clients_create();
+    for(size_t i = 0; i < n_owners; i++) {
+        hpb_list_clients_add(shard_owners, destinations[i]);
+    }
+    hpb_list_clients_destroy(&(service->shard_owners));
+    service->shard_owners = shard_owners;
+
+    for(size_t i = 0; i < n_states; i++) {
+        hpb_service_manager_destroy(&states[i]);
+    }
+
+    service->is_shard_dirty = false;
+    service->sharded_ms = now_ms;
+}
+
+static void hpb_forward_to_shards(HpbServiceManager *service, uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    if(service->shard_owners->size == 0) {
+        return;
+    }
+
+    // The message is sent once to each owner, whatever the number of subscribers of its shards
+    HLByte *packet;
+    size_t packet_size = hpb_protocol_build_shard_publish_msg(service->service_key, seq, origin, msg, msg_length, &packet);
+    for(LinkedListNode *node = service->shard_owners->head; node != NULL; node = node->next)
+    {
+        hpb_send(packet, packet_size, ((HpbClient *) node->element)->hype_instance, HPB_RETRY_PRIORITY_DATA);
+        hpb->n_shard_forwards++;
+    }
+    free(packet);
+}
+
+static void hpb_expire_shards(uint64_t now_ms)
+{
+    // The shards of a lost manager are dropped once it stops refreshing them
+    LinkedListNode *node = hpb->shards->head;
+    while(node != NULL)
+    {
+        HpbServiceManager *shard = (HpbServiceManager *) node->element;
+        node = node->next;
+
+        if(now_ms >= shard->replicated_ms + HPB_SHARDING_EXPIRATION_MS) {
+            hpb_list_service_managers_remove(hpb->shards, shard->service_key);
+        }
+    }
+}
+
+static void hpb_disseminate(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, char *msg, size_t msg_length, HpbClient *recipients[], size_t n_recipients)
+{
+    if(n_recipients == 0) {
+        return;
+    }
+
+    hpb_metrics_observe(hpb->metrics, HPB_METRICS_FANOUT_SIZE, n_recipients);
+
+    // Large sets of recipients get the message through a relay tree, so that only the relays are sent to
+    if(hpb->relay_branching > 1 && n_recipients > hpb->relay_branching)
+    {
+        HpbRelayMember *members = (HpbRelayMember *) malloc(n_recipients * sizeof(HpbRelayMember));
+        for(size_t i = 0; i < n_recipients; i++)
+        {
+            members[i].instance = recipients[i]->hype_instance;
+            memcpy(members[i].key, recipients[i]->key, SHA1_BLOCK_SIZE);
+            members[i].link_cost_ms = hpb_get_link_cost(recipients[i]->hype_instance);
+        }
+
+        hpb_relay_tree_sort(members, n_recipients);
+        hpb_relay(service_key, seq, origin, (uint8_t) hpb->relay_branching, members, n_recipients, msg, msg_length);
+        hpb->n_relay_trees++;
+        free(members);
+        return;
+    }
+
+    HypeInstance **instances = (HypeInstance **) malloc(n_recipients * sizeof(HypeInstance *));
+    for(size_t i = 0; i < n_recipients; i++) {
+        instances[i] = recipients[i]->hype_instance;
+    }
+
+    // The frame is encoded once and the recipients share the packet kept by the retry queue for the messages that fail
+    HLByte *frame;
+    size_t frame_size = hpb_protocol_build_info_msg(service_key, seq, origin, msg, msg_length, &frame);
+    HpbRetryPacket *packet = hpb_retry_queue_packet_create(hpb->retry_queue, frame, frame_size);
+    free(frame);
+    HpbFanoutPacket fanout_packet = {hpb, packet};
+    hpb_fanout_send(hpb->fanout, packet->data, packet->size, instances, n_recipients, &fanout_packet);
+    hpb_retry_queue_packet_release(hpb->retry_queue, packet);
+    free(instances);
+}
+
+static size_t hpb_relay(HLByte service_key[], uint32_t seq, HpbPublishOrigin origin, uint8_t branching, HpbRelayMember members[], size_t n_members, char *msg, size_t msg_length)
+{
+    HpbRelayBranch branches[HPB_RELAY_TREE_MAX_BRANCHING];
+    size_t n_branches = hpb_relay_tree_split(members, n_members, branching, branches);
+
+    // The leaves get a plain info message, and the relays their subtree as well
+    for(size_t i = 0; i < n_branches; i++)
+    {
+        HLByte *packet;
+        size_t packet_size;
+        if(branches[i].n_children == 0) {
+            packet_size = hpb_protocol_build_info_msg(service_key, seq, origin, msg, msg_length, &packet);
+        }
+        else {
+            packet_size = hpb_protocol_build_relay_msg(service_key, seq, origin, branching, branches[i].children, branches[i].n_children, msg, msg_length, &packet);
+        }
+        hpb_send(packet, packet_size, branches[i].relay->instance, HPB_RETRY_PRIORITY_DATA);
+        free(packet);
+    }
+
+    return n_branches;
+}
+
+static uint32_t hpb_get_link_cost(HypeInstance *instance)
+{
+    // Instances which are not in the network cannot be reached, so they are only relays if no one else can be
+    HpbClient *client = hpb_list_clients_find(hpb->network->network_clients, instance);
+    return (client != NULL) ? client->link_cost_ms : HPB_CLIENT_FAILED_LINK_COST_MS;
+}
+
+static bool hpb_is_direct_allowed(HpbServiceManager *service)
+{
+    // The publishers cannot evaluate filters, match patterns or reach the subscribers through the owners of their shards
+    return service->pattern == NULL && service->filters->size == 0 && service->n_shards == 0
+           && service->subscribers->size <= HPB_DIRECT_MAX_SUBSCRIBERS;
+}
+
+static void hpb_push_subscriber_list(HpbServiceManager *service, uint64_t now_ms)
+{
+    // The publishers which stopped renewing their lease stopped publishing directly, or were lost
+    LinkedListNode *node = service->direct_publishers->head;
+    while(node != NULL)
+    {
+        HpbClient *publisher = (HpbClient *) node->element;
+        node = node->next;
+
+        if(now_ms >= publisher->lease_expiration_ms) {
+            hpb_list_clients_remove(service->direct_publishers, publisher->hype_instance);
+        }
+    }
+
+    if(service->pushed_version == service->subscribers_version || service->direct_publishers->size == 0)
+    {
+        service->pushed_version = service->subscribers_version;
+        return;
+    }
+
+    // Each change is pushed at once, so that the publishers do not send to the old subscribers for longer than a message takes
+    bool is_allowed = hpb_is_direct_allowed(service);
+    HLByte *packet;
+    size_t packet_size = hpb_protocol_build_subscriber_list_msg(service->service_key, service->subscribers_version,
+                                                                is_allowed ? service->subscribers : NULL, &packet);
+    for(node = service->direct_publishers->head; node != NULL; node = node->next) {
+        hpb_send(packet, packet_size, ((HpbClient *) node->element)->hype_instance, HPB_RETRY_PRIORITY_CONTROL);
+    }
+    free(packet);
+    service->pushed_version = service->subscribers_version;
+
+    // The refused publishers ask again when they refresh their list
+    if(!is_allowed)
+    {
+        hpb_list_clients_destroy(&(service->direct_publishers));
+        service->direct_publishers = hpb_list_clients_create();
+    }
+}
+
+static void hpb_push_subscriber_lists(uint64_t now_ms)
+{
+    // The subscribers also change without requests, on lease expirations, lost devices and handovers
+    for(LinkedListNode *node = hpb->managed_services->head; node != NULL; node = node->next) {
+        hpb_push_subscriber_list((HpbServiceManager *) node->element, now_ms);
+    }
+}
+
+static HpbDirectRoute *hpb_find_direct_route(HLByte service_key[])
+{
+    for(LinkedListNode *node = hpb->direct_routes->head; node != NULL; node = node->next)
+    {
+        HpbDirectRoute *route = (HpbDirectRoute *) node->element;
+        if(memcmp(route->service_key, service_key, SHA1_BLOCK_SIZE) == 0) {
+            return route;
+        }
+    }
+
+    return NULL;
+}
+
+static void hpb_request_subscriber_list(HpbDirectRoute *route, uint64_t now_ms)
+{
+    route->requested_ms = now_ms;
+
+    // This client publishes locally in the services it manages
+    if(hpb_client_is_instance_equal(hpb->network->own_client, route->manager->hype_instance)) {
+        return;
+    }
+
+    HLByte *packet;
+    size_t packet_size = hpb_protocol_build_subscriber_list_req(route->service_key, &packet);
+    hpb_send(packet, packet_size, route->manager->hype_instance, HPB_RETRY_PRIORITY_CONTROL);
+    free(packet);
+}
+
+static void hpb_refresh_direct_routes(uint64_t now_ms)
+{
+    for(LinkedListNode *node = hpb->direct_routes->head; node != NULL; node = node->next)
+    {
+        HpbDirectRoute *route = (HpbDirectRoute *) node->element;
+
+        // A new manager is asked at once, and the current one before the list expires
+        HypeInstance *manager_instance = hpb_network_get_service_manager_id(hpb->network, route->service_key);
+        if(hpb_direct_route_set_manager(route, manager_instance) || now_ms >= route->requested_ms + HPB_DIRECT_REFRESH_MS) {
+            hpb_request_subscriber_list(route, now_ms);
+        }
+    }
+}
+
+static HpbSubscription *hpb_deliver_own_publish(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    HpbSubscription *subs = hpb_list_subscriptions_find(hpb->own_subscriptions, service_key);
+
+    // The messages of filtered subscriptions are still checked by the manager
+    if(subs == NULL || subs->is_pattern || subs->filter != NULL) {
+        return NULL;
+    }
+
+    hpb->n_local_deliveries++;
+    hpb_process_local_info(service_key, origin, msg, msg_length);
+    return subs;
+}
+
+static bool hpb_publish_direct(HLByte service_key[], HypeInstance *manager_instance, HpbPublishOrigin origin, char *msg, size_t msg_length)
+{
+    HpbDirectRoute *route = hpb_find_direct_route(service_key);
+
+    if(route == NULL || !hpb_direct_route_is_usable(route, manager_instance, hpb_clock_now_ms())) {
+        return false;
+    }
+
+    // The message is built once and shared by the sends to all the subscribers
+    HLByte *data;
+    size_t data_size = hpb_protocol_build_direct_info_msg(service_key, origin, msg, msg_length, &data);
+    HpbRetryPacket *packet = hpb_retry_queue_packet_create(hpb->retry_queue, data, data_size);
+    free(data);
+
+    for(LinkedListNode *node = route->subscribers->head; node != NULL; node = node->next)
+    {
+        // The own subscription got the message when it was published
+        HpbClient *subscriber = (HpbClient *) node->element;
+        if(!hpb_client_is_instance_equal(hpb->network->own_client, subscriber->hype_instance)) {
+            hpb_send_packet(hpb, packet, subscriber->hype_instance, HPB_RETRY_PRIORITY_DATA);
+        }
+    }
+
+    hpb_retry_queue_packet_release(hpb->retry_queue, packet);
+    hpb->n_direct_publishes++;
+    return true;
+}
+
+static bool linked_list_callback_is_same_route(void *route1, void *route2)
+{
+    return route1 == route2;
+}
+
+static void linked_list_callback_free_direct_route(void **element)
+{
+    HpbDirectRoute *route = (HpbDirectRoute *) (*element);
+    hpb_direct_route_destroy(&route);
+    (*element) = NULL;
+}
+
+static void hpb_dispatch_resolutions(uint64_t now_ms)
+{
+    if(hpb->resolver->pending->size == 0 && hpb->resolver->in_flight->size == 0) {
+        return;
+    }
+
+    // The clients closest to the subscribed and managed services are their likely managers and subscribers
+    size_t n_keys = 0;
+    HLByte *keys = (HLByte *) malloc((hpb->own_subscriptions->size + hpb->managed_services->size + 1) * SHA1_BLOCK_SIZE);
+    for(LinkedListNode *node = hpb->own_subscriptions->head; node != NULL; node = node->next) {
+        memcpy(keys + (n_keys++) * SHA1_BLOCK_SIZE, ((HpbSubscription *) node->element)->placement_key, SHA1_BLOCK_SIZE);
+    }
+    for(LinkedListNode *node = hpb->managed_services->head; node != NULL; node = node->next) {
+        memcpy(keys + (n_keys++) * SHA1_BLOCK_SIZE, ((HpbServiceManager *) node->element)->service_key, SHA1_BLOCK_SIZE);
+    }
+
+    hpb_resolver_dispatch(hpb->resolver, keys, n_keys, now_ms, hpb_resolve_hype, NULL);
+    free(keys);
+}
+
+static void hpb_resolve_hype(HypeInstance *instance, void *arg)
+{
+    // In case of success the transport reports the instance resolved, and otherwise that it failed resolving
+    if(hpb->transport != NULL) {
+        hpb_transport_resolve(hpb->transport, instance);
+    }
 }
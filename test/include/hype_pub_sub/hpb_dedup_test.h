@@ -0,0 +1,11 @@
+
+#ifndef HPB_DEDUP_TEST_H_INCLUDED_
+#define HPB_DEDUP_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_dedup.h"
+
+void hpb_dedup_test();
+
+#endif /* HPB_DEDUP_TEST_H_INCLUDED_ */
@@ -0,0 +1,13 @@
+#ifndef HPB_DIRECT_ROUTE_TEST_H_INCLUDED_
+#define HPB_DIRECT_ROUTE_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_direct_route.h"
+
+void hpb_direct_route_test();
+
+void hpb_direct_route_test_update();
+void hpb_direct_route_test_manager_change();
+
+#endif /* HPB_DIRECT_ROUTE_TEST_H_INCLUDED_ */
@@ -0,0 +1,16 @@
+
+#ifndef HPB_EVENT_LOOP_TEST_H_INCLUDED_
+#define HPB_EVENT_LOOP_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_event_loop.h"
+
+void hpb_event_loop_test();
+
+void hpb_event_loop_test_post_before_run();
+void hpb_event_loop_test_timers();
+void hpb_event_loop_test_fd_and_thread_post();
+void hpb_event_loop_test_destroy_pending();
+
+#endif /* HPB_EVENT_LOOP_TEST_H_INCLUDED_ */
@@ -0,0 +1,14 @@
+
+#ifndef HPB_FANOUT_TEST_H_INCLUDED_
+#define HPB_FANOUT_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_fanout.h"
+
+void hpb_fanout_test();
+
+void hpb_fanout_test_serial();
+void hpb_fanout_test_parallel();
+
+#endif /* HPB_FANOUT_TEST_H_INCLUDED_ */
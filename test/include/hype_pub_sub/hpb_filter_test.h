@@ -0,0 +1,14 @@
+#ifndef HPB_FILTER_TEST_H_INCLUDED_
+#define HPB_FILTER_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_filter.h"
+
+void hpb_filter_test();
+
+void hpb_filter_test_compile();
+void hpb_filter_test_evaluate();
+void hpb_filter_test_attributes();
+
+#endif /* HPB_FILTER_TEST_H_INCLUDED_ */
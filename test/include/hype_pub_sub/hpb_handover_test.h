@@ -0,0 +1,13 @@
+#ifndef HPB_HANDOVER_TEST_H_INCLUDED_
+#define HPB_HANDOVER_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_handover.h"
+
+void hpb_handover_test();
+
+void hpb_handover_test_forward();
+void hpb_handover_test_buffer();
+
+#endif /* HPB_HANDOVER_TEST_H_INCLUDED_ */
@@ -0,0 +1,10 @@
+#ifndef HPB_HISTOGRAM_TEST_H_INCLUDED_
+#define HPB_HISTOGRAM_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_histogram.h"
+
+void hpb_histogram_test();
+
+#endif /* HPB_HISTOGRAM_TEST_H_INCLUDED_ */
@@ -0,0 +1,10 @@
+#ifndef HPB_HISTORY_TEST_H_INCLUDED_
+#define HPB_HISTORY_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_history.h"
+
+void hpb_history_test();
+
+#endif /* HPB_HISTORY_TEST_H_INCLUDED_ */
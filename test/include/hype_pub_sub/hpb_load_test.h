@@ -0,0 +1,14 @@
+#ifndef HPB_LOAD_TEST_H_INCLUDED_
+#define HPB_LOAD_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_load.h"
+#include "hype_pub_sub/hpb_sim.h"
+
+void hpb_load_test();
+
+void hpb_load_test_payload();
+void hpb_load_test_sim();
+
+#endif /* HPB_LOAD_TEST_H_INCLUDED_ */
@@ -0,0 +1,14 @@
+
+#ifndef HPB_MEMBERSHIP_TEST_H_INCLUDED_
+#define HPB_MEMBERSHIP_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_membership.h"
+
+void hpb_membership_test();
+
+void hpb_membership_test_debounce();
+void hpb_membership_test_hold_down();
+
+#endif /* HPB_MEMBERSHIP_TEST_H_INCLUDED_ */
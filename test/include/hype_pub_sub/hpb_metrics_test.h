@@ -0,0 +1,16 @@
+#ifndef HPB_METRICS_TEST_H_INCLUDED_
+#define HPB_METRICS_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_metrics.h"
+#include "hype_pub_sub/hpb_sim.h"
+
+void hpb_metrics_test();
+
+void hpb_metrics_test_registry();
+void hpb_metrics_test_threads();
+void hpb_metrics_test_exporter();
+void hpb_metrics_test_sim();
+
+#endif /* HPB_METRICS_TEST_H_INCLUDED_ */
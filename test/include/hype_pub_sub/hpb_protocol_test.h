@@ -12,6 +12,12 @@ void hpb_protocol_test_build_subscribe_msg();
 void hpb_protocol_test_build_unsubscribe_msg();
 void hpb_protocol_test_build_publish_msg();
 void hpb_protocol_test_build_info_msg();
+void hpb_protocol_test_build_nack_msg();
+void hpb_protocol_test_build_handover_msg();
+void hpb_protocol_test_build_heartbeat_msg();
+void hpb_protocol_test_build_shard_msg();
+void hpb_protocol_test_build_relay_msg();
+void hpb_protocol_test_build_subscriber_list_msg();
 void hpb_protocol_test_receiving_msg();
 
 #endif /* HPB_PROTOCOL_TEST_H_INCLUDED_ */
@@ -0,0 +1,13 @@
+#ifndef HPB_RELAY_TREE_TEST_H_INCLUDED_
+#define HPB_RELAY_TREE_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_relay_tree.h"
+
+void hpb_relay_tree_test();
+
+void hpb_relay_tree_test_split();
+void hpb_relay_tree_test_depth();
+
+#endif /* HPB_RELAY_TREE_TEST_H_INCLUDED_ */
@@ -0,0 +1,13 @@
+#ifndef HPB_RESOLVER_TEST_H_INCLUDED_
+#define HPB_RESOLVER_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_resolver.h"
+
+void hpb_resolver_test();
+
+void hpb_resolver_test_limit();
+void hpb_resolver_test_priority();
+
+#endif /* HPB_RESOLVER_TEST_H_INCLUDED_ */
@@ -0,0 +1,15 @@
+#ifndef HPB_RETRY_QUEUE_TEST_H_INCLUDED_
+#define HPB_RETRY_QUEUE_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_retry_queue.h"
+
+void hpb_retry_queue_test();
+
+void hpb_retry_queue_test_backoff();
+void hpb_retry_queue_test_deadline();
+void hpb_retry_queue_test_eviction();
+void hpb_retry_queue_test_reentrant_send();
+
+#endif /* HPB_RETRY_QUEUE_TEST_H_INCLUDED_ */
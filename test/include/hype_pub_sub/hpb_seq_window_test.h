@@ -0,0 +1,13 @@
+#ifndef HPB_SEQ_WINDOW_TEST_H_INCLUDED_
+#define HPB_SEQ_WINDOW_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_seq_window.h"
+
+void hpb_seq_window_test();
+
+void hpb_seq_window_test_receive();
+void hpb_seq_window_test_missing();
+
+#endif /* HPB_SEQ_WINDOW_TEST_H_INCLUDED_ */
@@ -0,0 +1,13 @@
+#ifndef HPB_SIM_SCENARIO_TEST_H_INCLUDED_
+#define HPB_SIM_SCENARIO_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_sim_scenario.h"
+
+void hpb_sim_scenario_test();
+
+void hpb_sim_scenario_test_invalid();
+void hpb_sim_scenario_test_reproducible();
+
+#endif /* HPB_SIM_SCENARIO_TEST_H_INCLUDED_ */
@@ -0,0 +1,13 @@
+#ifndef HPB_SIM_TEST_H_INCLUDED_
+#define HPB_SIM_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_sim.h"
+
+void hpb_sim_test();
+
+void hpb_sim_test_nodes();
+void hpb_sim_test_publish();
+
+#endif /* HPB_SIM_TEST_H_INCLUDED_ */
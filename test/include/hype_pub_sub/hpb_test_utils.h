@@ -4,6 +4,7 @@
 
 #include <binary_utils.h>
 #include <hype_pub_sub/hpb_client.h>
+#include <hype_pub_sub/hpb_transport.h>
 
 #define HPB_UTILS_CLIENT_ID_TEST_SIZE 12
 
@@ -11,4 +12,6 @@ HypeInstance * hpb_test_utils_get_instance_from_id(HLByte *id, size_t size);
 
 HpbClient * hpb_test_utils_get_client_from_id(HLByte *id, size_t size);
 
+HpbTransport * hpb_test_utils_create_transport();
+
 #endif /* HPB_TEST_UTILS_H_INCLUDED_ */
@@ -0,0 +1,11 @@
+
+#ifndef HPB_TIMER_WHEEL_TEST_H_INCLUDED_
+#define HPB_TIMER_WHEEL_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_timer_wheel.h"
+
+void hpb_timer_wheel_test();
+
+#endif /* HPB_TIMER_WHEEL_TEST_H_INCLUDED_ */
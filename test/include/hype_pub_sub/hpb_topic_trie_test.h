@@ -0,0 +1,14 @@
+#ifndef HPB_TOPIC_TRIE_TEST_H_INCLUDED_
+#define HPB_TOPIC_TRIE_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_topic_trie.h"
+
+void hpb_topic_trie_test();
+
+void hpb_topic_trie_test_patterns();
+void hpb_topic_trie_test_payload();
+void hpb_topic_trie_test_match();
+
+#endif /* HPB_TOPIC_TRIE_TEST_H_INCLUDED_ */
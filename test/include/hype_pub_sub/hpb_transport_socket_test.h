@@ -0,0 +1,13 @@
+#ifndef HPB_TRANSPORT_SOCKET_TEST_H_INCLUDED_
+#define HPB_TRANSPORT_SOCKET_TEST_H_INCLUDED_
+
+#include <CUnit/Basic.h>
+
+#include "hype_pub_sub/hpb_transport_socket.h"
+
+void hpb_transport_socket_test();
+
+void hpb_transport_socket_test_create();
+void hpb_transport_socket_test_exchange();
+
+#endif /* HPB_TRANSPORT_SOCKET_TEST_H_INCLUDED_ */
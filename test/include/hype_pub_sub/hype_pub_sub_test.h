@@ -15,5 +15,15 @@ void hpb_test_issue_publish_req();
 void hpb_test_process_subscribe_and_unsubscribe();
 void hpb_test_process_publish_req();
 void hpb_test_process_info_req();
+void hpb_test_update_managed_services();
+void hpb_test_promote_replicas();
+void hpb_test_subscription_leases();
+void hpb_test_membership_events();
+void hpb_test_wildcard_subscriptions();
+void hpb_test_subscription_filters();
+void hpb_test_shard_subscribers();
+void hpb_test_relay_trees();
+void hpb_test_direct_publish();
+void hpb_test_local_delivery();
 
 #endif /* HPB_TEST_H_INCLUDED_ */
@@ -14,5 +14,6 @@ void binary_utils_test();
 void binary_utils_test_xor();
 void binary_utils_test_binary_conversions();
 void binary_utils_test_higher_byte_array();
+void binary_utils_test_uint32();
 
 #endif /* SHARED_BINARY_UTILS_TEST_H_INCLUDED_ */
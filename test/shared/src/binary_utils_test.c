@@ -6,6 +6,7 @@ void binary_utils_test()
     binary_utils_test_xor();
     binary_utils_test_binary_conversions();
     binary_utils_test_higher_byte_array();
+    binary_utils_test_uint32();
 }
 
 void binary_utils_test_xor()
@@ -65,6 +66,15 @@ void binary_utils_test_higher_byte_array()
     CU_ASSERT(binary_utils_get_higher_byte_array(val4, val1, length) == 2);
 }
 
+void binary_utils_test_uint32()
+{
+    HLByte buffer[4];
 
+    binary_utils_write_uint32(buffer, 0x01020304);
+    CU_ASSERT_NSTRING_EQUAL(buffer, "\x01\x02\x03\x04", 4);
+    CU_ASSERT(binary_utils_read_uint32(buffer) == 0x01020304);
 
-
+    binary_utils_write_uint32(buffer, 0xfffffffe);
+    CU_ASSERT(buffer[0] == 0xff && buffer[3] == 0xfe);
+    CU_ASSERT(binary_utils_read_uint32(buffer) == 0xfffffffe);
+}
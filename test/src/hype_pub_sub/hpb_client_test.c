@@ -39,6 +39,16 @@ void hpb_client_test()
     CU_ASSERT_FALSE(hpb_client_is_instance_equal(cl1, cl2->hype_instance));
     CU_ASSERT_TRUE(hpb_client_is_instance_equal(cl1, cl4->hype_instance));
 
+    // Test the moving average of the link cost, which starts at the first sample
+    CU_ASSERT(cl1->link_cost_ms == HPB_CLIENT_DEFAULT_LINK_COST_MS);
+    hpb_client_update_link_cost(cl1, 100);
+    CU_ASSERT(cl1->link_cost_ms == 100);
+    hpb_client_update_link_cost(cl1, 180);
+    CU_ASSERT(cl1->link_cost_ms == 110);
+    hpb_client_update_link_cost(cl1, 30);
+    CU_ASSERT(cl1->link_cost_ms == 100);
+    CU_ASSERT(cl1->n_link_samples == 3);
+
     // Test struct destruction
     hpb_client_destroy(&cl1);
     hpb_client_destroy(&cl2);
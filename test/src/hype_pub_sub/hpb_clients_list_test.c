@@ -131,6 +131,12 @@ void hpb_list_clients_test()
     CU_ASSERT_NSTRING_EQUAL(aux_cl->hype_instance->identifier->data, CLIENT4_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
     CU_ASSERT_NSTRING_EQUAL(aux_cl->key, CLIENT_KEY4, SHA1_BLOCK_SIZE);
 
+    // Test find by key
+    HLByte NON_EXISTENT_CLIENT_KEY[SHA1_BLOCK_SIZE] = {0};
+    CU_ASSERT_PTR_EQUAL(hpb_list_clients_find_by_key(clients, CLIENT_KEY3), hpb_list_clients_find(clients, instance3));
+    CU_ASSERT_PTR_EQUAL(hpb_list_clients_find_by_key(clients, CLIENT_KEY4), hpb_list_clients_find(clients, instance4));
+    CU_ASSERT_PTR_NULL(hpb_list_clients_find_by_key(clients, NON_EXISTENT_CLIENT_KEY));
+
     // Test the destruction of the client's list
     linked_list_iterator_destroy(&it);
     hpb_list_clients_destroy(&clients);
@@ -0,0 +1,49 @@
+
+#include "hpb_dedup_test.h"
+
+void hpb_dedup_test()
+{
+    HpbDedupCache cache;
+    hpb_dedup_cache_reset(&cache);
+    cache.n_suppressed = 0;
+
+    HpbPublishOrigin origin1 = {0x01020304, 100};
+    HpbPublishOrigin origin2 = {0x0a0b0c0d, 100};
+
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin1) == false);
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin2) == false); // Same sequence number, other publisher
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin1) == true);
+    CU_ASSERT(cache.n_publishers == 2);
+    CU_ASSERT(cache.n_suppressed == 1);
+
+    // Messages can arrive out of order
+    origin1.publisher_seq = 103;
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin1) == false);
+    origin1.publisher_seq = 101;
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin1) == false);
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin1) == true);
+
+    // Messages older than the window are suppressed
+    origin1.publisher_seq = 103 + HPB_SEQ_WINDOW_SIZE;
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin1) == false);
+    origin1.publisher_seq = 102;
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin1) == true);
+    CU_ASSERT(cache.n_suppressed == 3);
+
+    // The least recently seen publisher is forgotten when the cache is full
+    for(uint32_t tag = 1; tag < HPB_DEDUP_MAX_PUBLISHERS - 1; tag++)
+    {
+        HpbPublishOrigin origin = {tag, 1};
+        CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin) == false);
+    }
+    CU_ASSERT(cache.n_publishers == HPB_DEDUP_MAX_PUBLISHERS);
+    HpbPublishOrigin origin3 = {0xffffffff, 1};
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin3) == false);
+    CU_ASSERT(cache.n_publishers == HPB_DEDUP_MAX_PUBLISHERS);
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin2) == false);
+
+    hpb_dedup_cache_reset(&cache);
+    CU_ASSERT(cache.n_publishers == 0);
+    CU_ASSERT(hpb_dedup_cache_is_duplicate(&cache, origin3) == false);
+    CU_ASSERT(cache.n_suppressed == 3);
+}
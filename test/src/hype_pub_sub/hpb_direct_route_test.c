@@ -0,0 +1,75 @@
+#include "hpb_direct_route_test.h"
+#include "hpb_test_utils.h"
+
+void hpb_direct_route_test()
+{
+    hpb_direct_route_test_update();
+    hpb_direct_route_test_manager_change();
+}
+
+void hpb_direct_route_test_update()
+{
+    HypeInstance *manager = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *other = hpb_test_utils_get_instance_from_id("\x01\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *subscribers[2] = {manager, other};
+
+    HpbDirectRoute *route = hpb_direct_route_create("alarms");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(route);
+    CU_ASSERT_STRING_EQUAL(route->service_name, "alarms");
+    CU_ASSERT_FALSE(hpb_direct_route_is_usable(route, manager, 0));
+
+    // Lists are only taken from the manager to which they were requested
+    CU_ASSERT_FALSE(hpb_direct_route_update(route, manager, 1, false, subscribers, 2, 1000));
+    CU_ASSERT(hpb_direct_route_set_manager(route, manager));
+    CU_ASSERT_FALSE(hpb_direct_route_set_manager(route, manager));
+    CU_ASSERT_FALSE(hpb_direct_route_update(route, other, 1, false, subscribers, 2, 1000));
+    CU_ASSERT(hpb_direct_route_update(route, manager, 0xFFFFFFFF, false, subscribers, 2, 1000));
+    CU_ASSERT(route->subscribers->size == 2);
+    CU_ASSERT(hpb_direct_route_is_usable(route, manager, 1000));
+    CU_ASSERT_FALSE(hpb_direct_route_is_usable(route, other, 1000));
+
+    // Versions wrap around, and the lists which arrive late are discarded
+    CU_ASSERT(hpb_direct_route_update(route, manager, 0, false, subscribers, 1, 2000));
+    CU_ASSERT(route->subscribers->size == 1);
+    CU_ASSERT_FALSE(hpb_direct_route_update(route, manager, 0xFFFFFFFF, false, subscribers, 2, 3000));
+    CU_ASSERT(route->subscribers->size == 1);
+    CU_ASSERT(route->received_ms == 2000);
+
+    // A list expires unless renewed, and a refused list is not usable
+    CU_ASSERT(hpb_direct_route_is_usable(route, manager, 2000 + HPB_DIRECT_ROUTE_EXPIRATION_MS - 1));
+    CU_ASSERT_FALSE(hpb_direct_route_is_usable(route, manager, 2000 + HPB_DIRECT_ROUTE_EXPIRATION_MS));
+    CU_ASSERT(hpb_direct_route_update(route, manager, 1, true, subscribers, 2, 4000));
+    CU_ASSERT(route->subscribers->size == 0);
+    CU_ASSERT_FALSE(hpb_direct_route_is_usable(route, manager, 4000));
+    CU_ASSERT(hpb_direct_route_update(route, manager, 2, false, subscribers, 2, 5000));
+    CU_ASSERT(hpb_direct_route_is_usable(route, manager, 5000));
+
+    hpb_direct_route_destroy(&route);
+    CU_ASSERT_PTR_NULL(route);
+    hype_instance_release(manager);
+    hype_instance_release(other);
+}
+
+void hpb_direct_route_test_manager_change()
+{
+    HypeInstance *manager1 = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *manager2 = hpb_test_utils_get_instance_from_id("\x01\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *subscribers[1] = {manager1};
+
+    HpbDirectRoute *route = hpb_direct_route_create("alarms");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(route);
+    hpb_direct_route_set_manager(route, manager1);
+    CU_ASSERT(hpb_direct_route_update(route, manager1, 10, false, subscribers, 1, 1000));
+
+    // Each manager has its own versions, so the list of the previous one is forgotten
+    CU_ASSERT(hpb_direct_route_set_manager(route, manager2));
+    CU_ASSERT(route->subscribers->size == 0);
+    CU_ASSERT_FALSE(hpb_direct_route_is_usable(route, manager2, 1000));
+    CU_ASSERT_FALSE(hpb_direct_route_update(route, manager1, 11, false, subscribers, 1, 1000));
+    CU_ASSERT(hpb_direct_route_update(route, manager2, 0, false, subscribers, 1, 1000));
+    CU_ASSERT(hpb_direct_route_is_usable(route, manager2, 1000));
+
+    hpb_direct_route_destroy(&route);
+    hype_instance_release(manager1);
+    hype_instance_release(manager2);
+}
@@ -0,0 +1,168 @@
+
+#include "hpb_event_loop_test.h"
+
+#include <unistd.h>
+
+static int task_counter = 0;
+static int periodic_counter = 0;
+static int one_shot_counter = 0;
+static int fd_counter = 0;
+static int free_counter = 0;
+
+static void test_task_count(void *arg);
+static void test_task_stop(void *arg);
+static void test_task_free(void *arg);
+static void test_timer_periodic(void *arg);
+static void test_timer_one_shot(void *arg);
+static void test_fd_read(int fd, void *arg);
+static void *test_thread_post(void *arg);
+
+void hpb_event_loop_test()
+{
+    hpb_event_loop_test_post_before_run();
+    hpb_event_loop_test_timers();
+    hpb_event_loop_test_fd_and_thread_post();
+    hpb_event_loop_test_destroy_pending();
+}
+
+void hpb_event_loop_test_post_before_run()
+{
+    HpbEventLoop *loop = hpb_event_loop_create();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+
+    // Tasks posted before the loop runs (e.g. an early Hype start notification) must not be lost
+    task_counter = 0;
+    hpb_event_loop_post(loop, test_task_count, NULL, NULL);
+    hpb_event_loop_post(loop, test_task_count, NULL, NULL);
+    hpb_event_loop_post(loop, test_task_stop, loop, NULL);
+    CU_ASSERT(hpb_event_loop_run(loop) == 0);
+    CU_ASSERT(task_counter == 2);
+
+    hpb_event_loop_destroy(&loop);
+    CU_ASSERT_PTR_NULL(loop);
+}
+
+void hpb_event_loop_test_timers()
+{
+    HpbEventLoop *loop = hpb_event_loop_create();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+
+    periodic_counter = 0;
+    one_shot_counter = 0;
+
+    int periodic_id = hpb_event_loop_add_timer(loop, 5, 5, test_timer_periodic, NULL);
+    int one_shot_id = hpb_event_loop_add_timer(loop, 10, 0, test_timer_one_shot, NULL);
+    int cancelled_id = hpb_event_loop_add_timer(loop, 15, 0, test_timer_one_shot, NULL);
+    hpb_event_loop_add_timer(loop, 60, 0, test_task_stop, loop);
+    CU_ASSERT(periodic_id > 0);
+    CU_ASSERT(one_shot_id > 0);
+    CU_ASSERT(periodic_id != one_shot_id);
+
+    CU_ASSERT(hpb_event_loop_cancel_timer(loop, cancelled_id) == 0);
+    CU_ASSERT(hpb_event_loop_cancel_timer(loop, cancelled_id) == -1);
+
+    uint64_t start = hpb_clock_now_ms();
+    hpb_event_loop_run(loop);
+    uint64_t elapsed = hpb_clock_now_ms() - start;
+
+    CU_ASSERT(elapsed >= 60);
+    CU_ASSERT(one_shot_counter == 1);
+    CU_ASSERT(periodic_counter >= 5);
+    CU_ASSERT(periodic_counter <= 12);
+    CU_ASSERT(loop->timers->size == 1); // Only the periodic timer remains
+
+    hpb_event_loop_destroy(&loop);
+}
+
+void hpb_event_loop_test_fd_and_thread_post()
+{
+    HpbEventLoop *loop = hpb_event_loop_create();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+
+    int pipe_fds[2];
+    CU_ASSERT_FATAL(pipe(pipe_fds) == 0);
+    CU_ASSERT(hpb_event_loop_add_fd(loop, pipe_fds[0], test_fd_read, NULL) == 0);
+    CU_ASSERT(hpb_event_loop_add_fd(loop, pipe_fds[0], test_fd_read, NULL) == -1); // Already watched
+
+    fd_counter = 0;
+    task_counter = 0;
+    CU_ASSERT(write(pipe_fds[1], "abc", 3) == 3);
+
+    // Tasks posted by another thread are executed on the loop thread, in order
+    pthread_t thread;
+    pthread_create(&thread, NULL, test_thread_post, loop);
+    hpb_event_loop_run(loop);
+    pthread_join(thread, NULL);
+
+    CU_ASSERT(fd_counter == 3);
+    CU_ASSERT(task_counter == 10);
+
+    CU_ASSERT(hpb_event_loop_remove_fd(loop, pipe_fds[0]) == 0);
+    CU_ASSERT(hpb_event_loop_remove_fd(loop, pipe_fds[0]) == -1);
+
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    hpb_event_loop_destroy(&loop);
+}
+
+void hpb_event_loop_test_destroy_pending()
+{
+    HpbEventLoop *loop = hpb_event_loop_create();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+
+    // The arguments of the tasks which never ran are freed with the loop
+    task_counter = 0;
+    free_counter = 0;
+    hpb_event_loop_post(loop, test_task_count, malloc(16), test_task_free);
+    hpb_event_loop_post(loop, test_task_count, malloc(16), test_task_free);
+    hpb_event_loop_post(loop, test_task_count, NULL, NULL);
+    hpb_event_loop_destroy(&loop);
+    CU_ASSERT(task_counter == 0);
+    CU_ASSERT(free_counter == 2);
+}
+
+static void test_task_count(void *arg)
+{
+    task_counter++;
+}
+
+static void test_task_stop(void *arg)
+{
+    hpb_event_loop_stop((HpbEventLoop *) arg);
+}
+
+static void test_task_free(void *arg)
+{
+    free(arg);
+    free_counter++;
+}
+
+static void test_timer_periodic(void *arg)
+{
+    periodic_counter++;
+}
+
+static void test_timer_one_shot(void *arg)
+{
+    one_shot_counter++;
+}
+
+static void test_fd_read(int fd, void *arg)
+{
+    char buffer[16];
+    ssize_t n_read = read(fd, buffer, sizeof(buffer));
+    if(n_read > 0) {
+        fd_counter += n_read;
+    }
+}
+
+static void *test_thread_post(void *arg)
+{
+    HpbEventLoop *loop = (HpbEventLoop *) arg;
+
+    for(int i = 0; i < 10; i++) {
+        hpb_event_loop_post(loop, test_task_count, NULL, NULL);
+    }
+    hpb_event_loop_post(loop, test_task_stop, loop, NULL);
+    return NULL;
+}
@@ -0,0 +1,107 @@
+
+#include "hpb_fanout_test.h"
+#include "hpb_test_utils.h"
+
+#define HPB_FANOUT_TEST_N_RECIPIENTS 1000
+
+static size_t send_counter = 0;
+static HLByte *last_frame = NULL;
+
+static void test_send_count(HLByte *frame, size_t frame_size, HypeInstance *destination, void *arg);
+static HypeInstance **test_create_recipients(size_t n_recipients);
+static void test_release_recipients(HypeInstance **recipients, size_t n_recipients);
+
+void hpb_fanout_test()
+{
+    hpb_fanout_test_serial();
+    hpb_fanout_test_parallel();
+}
+
+void hpb_fanout_test_serial()
+{
+    HLByte frame[] = "frame";
+    HypeInstance **recipients = test_create_recipients(10);
+    HpbFanout *fanout = hpb_fanout_create(HPB_FANOUT_DEFAULT_WORKERS, test_send_count);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fanout);
+
+    send_counter = 0;
+    CU_ASSERT(hpb_fanout_send(fanout, frame, 5, recipients, 10, &send_counter) == 10);
+    CU_ASSERT(send_counter == 10);
+    CU_ASSERT_PTR_EQUAL(last_frame, frame);
+    CU_ASSERT_FALSE(fanout->are_workers_started); // Small fan-outs do not need the workers
+    CU_ASSERT(hpb_fanout_send(fanout, frame, 5, recipients, 0, &send_counter) == 0);
+
+    uint64_t p50_us, p99_us;
+    CU_ASSERT(hpb_fanout_get_percentiles(fanout, 0, &p50_us, &p99_us) == 1);
+    CU_ASSERT(p50_us <= p99_us);
+    CU_ASSERT(hpb_fanout_get_percentiles(fanout, 1, &p50_us, &p99_us) == 0);
+
+    hpb_fanout_destroy(&fanout);
+    CU_ASSERT_PTR_NULL(fanout);
+    test_release_recipients(recipients, 10);
+}
+
+void hpb_fanout_test_parallel()
+{
+    HLByte frame[] = "frame";
+    HypeInstance **recipients = test_create_recipients(HPB_FANOUT_TEST_N_RECIPIENTS);
+    HpbFanout *fanout = hpb_fanout_create(HPB_FANOUT_DEFAULT_WORKERS, test_send_count);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fanout);
+
+    send_counter = 0;
+    for(int i = 0; i < 5; i++) {
+        CU_ASSERT(hpb_fanout_send(fanout, frame, 5, recipients, HPB_FANOUT_TEST_N_RECIPIENTS, &send_counter) == HPB_FANOUT_TEST_N_RECIPIENTS);
+    }
+    CU_ASSERT(send_counter == 5 * HPB_FANOUT_TEST_N_RECIPIENTS);
+    CU_ASSERT(fanout->are_workers_started);
+    CU_ASSERT(hpb_fanout_set_workers(fanout, 0) == -1);
+    CU_ASSERT(fanout->n_workers == HPB_FANOUT_DEFAULT_WORKERS);
+    CU_ASSERT(fanout->stats.n_fanouts[2] == 5);
+
+    uint64_t p50_us, p99_us;
+    CU_ASSERT(hpb_fanout_get_percentiles(fanout, 2, &p50_us, &p99_us) == 5);
+    CU_ASSERT(p50_us <= p99_us);
+
+    // Without workers the same fan-out is sent serially
+    HpbFanout *serial_fanout = hpb_fanout_create(HPB_FANOUT_DEFAULT_WORKERS, test_send_count);
+    CU_ASSERT(hpb_fanout_set_workers(serial_fanout, HPB_FANOUT_MAX_WORKERS + 1) == 0);
+    CU_ASSERT(serial_fanout->n_workers == HPB_FANOUT_MAX_WORKERS);
+    CU_ASSERT(hpb_fanout_set_workers(serial_fanout, 0) == 0);
+    send_counter = 0;
+    CU_ASSERT(hpb_fanout_send(serial_fanout, frame, 5, recipients, HPB_FANOUT_TEST_N_RECIPIENTS, &send_counter) == HPB_FANOUT_TEST_N_RECIPIENTS);
+    CU_ASSERT(send_counter == HPB_FANOUT_TEST_N_RECIPIENTS);
+    CU_ASSERT_FALSE(serial_fanout->are_workers_started);
+
+    hpb_fanout_destroy(&fanout);
+    hpb_fanout_destroy(&serial_fanout);
+    test_release_recipients(recipients, HPB_FANOUT_TEST_N_RECIPIENTS);
+}
+
+static void test_send_count(HLByte *frame, size_t frame_size, HypeInstance *destination, void *arg)
+{
+    // The counter is the argument of the fan-out, which the workers must pass on as well
+    __sync_fetch_and_add((size_t *) arg, 1);
+    last_frame = frame;
+}
+
+static HypeInstance **test_create_recipients(size_t n_recipients)
+{
+    HypeInstance **recipients = (HypeInstance **) malloc(n_recipients * sizeof(HypeInstance *));
+
+    for(size_t i = 0; i < n_recipients; i++)
+    {
+        HLByte id[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0};
+        memcpy(id, &i, sizeof(i));
+        recipients[i] = hpb_test_utils_get_instance_from_id(id, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    }
+
+    return recipients;
+}
+
+static void test_release_recipients(HypeInstance **recipients, size_t n_recipients)
+{
+    for(size_t i = 0; i < n_recipients; i++) {
+        hype_instance_release(recipients[i]);
+    }
+    free(recipients);
+}
@@ -0,0 +1,113 @@
+#include "hpb_filter_test.h"
+
+static bool test_evaluate(char *expression, char *msg);
+
+void hpb_filter_test()
+{
+    hpb_filter_test_compile();
+    hpb_filter_test_evaluate();
+    hpb_filter_test_attributes();
+}
+
+void hpb_filter_test_compile()
+{
+    HpbFilter *filter = hpb_filter_compile(" type == alarm && ( device == 7 || level >= 3 ) ");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(filter);
+    CU_ASSERT_STRING_EQUAL(filter->expression, "type==alarm&&(device==7||level>=3)");
+    CU_ASSERT(filter->n_instructions == 5);
+    CU_ASSERT(filter->code[0].opcode == HPB_FILTER_OP_TEST);
+    CU_ASSERT(filter->code[0].comparison == HPB_FILTER_CMP_EQ);
+    CU_ASSERT_STRING_EQUAL(filter->code[0].name, "type");
+    CU_ASSERT(!filter->code[0].is_number);
+    CU_ASSERT(filter->code[1].is_number);
+    CU_ASSERT(filter->code[3].opcode == HPB_FILTER_OP_OR);
+    CU_ASSERT(filter->code[4].opcode == HPB_FILTER_OP_AND);
+    hpb_filter_destroy(&filter);
+    CU_ASSERT_PTR_NULL(filter);
+
+    // The spaces inside quotes are kept, since they are part of the value
+    filter = hpb_filter_compile("name == 'living room'");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(filter);
+    CU_ASSERT_STRING_EQUAL(filter->expression, "name=='living room'");
+    CU_ASSERT_STRING_EQUAL(filter->code[0].value, "living room");
+    hpb_filter_destroy(&filter);
+
+    CU_ASSERT_PTR_NULL(hpb_filter_compile(""));
+    CU_ASSERT_PTR_NULL(hpb_filter_compile("type =="));
+    CU_ASSERT_PTR_NULL(hpb_filter_compile("type = alarm"));
+    CU_ASSERT_PTR_NULL(hpb_filter_compile("type == alarm &&"));
+    CU_ASSERT_PTR_NULL(hpb_filter_compile("(type == alarm"));
+    CU_ASSERT_PTR_NULL(hpb_filter_compile("type == alarm)"));
+    CU_ASSERT_PTR_NULL(hpb_filter_compile("type alarm"));
+    CU_ASSERT_PTR_NULL(hpb_filter_compile("name == 'living room"));
+    CU_ASSERT_PTR_NULL(hpb_filter_compile("$unknown == 1"));
+
+    // Expressions whose evaluation stack would be too deep are rejected
+    char expression[HPB_FILTER_MAX_LENGTH + 1] = "";
+    for(int i = 0; i < HPB_FILTER_MAX_DEPTH; i++) {
+        strcat(expression, "a||(");
+    }
+    strcat(expression, "a");
+    for(int i = 0; i < HPB_FILTER_MAX_DEPTH; i++) {
+        strcat(expression, ")");
+    }
+    CU_ASSERT_PTR_NULL(hpb_filter_compile(expression));
+}
+
+void hpb_filter_test_evaluate()
+{
+    char *alarm = "type=alarm, device=7, level=2, text=door open";
+    CU_ASSERT(test_evaluate("type == alarm", alarm));
+    CU_ASSERT(!test_evaluate("type == reading", alarm));
+    CU_ASSERT(test_evaluate("type != reading", alarm));
+    CU_ASSERT(test_evaluate("type == alarm && (device == 7 || level >= 3)", alarm));
+    CU_ASSERT(!test_evaluate("type == alarm && device == 8 && level >= 3", alarm));
+    CU_ASSERT(test_evaluate("!(device == 8)", alarm));
+    CU_ASSERT(test_evaluate("device", alarm));
+    CU_ASSERT(!test_evaluate("battery", alarm));
+    CU_ASSERT(!test_evaluate("battery != 1", alarm));
+    CU_ASSERT(test_evaluate("type ~ ala", alarm));
+
+    // Numbers are compared as numbers, and quoted values as strings
+    CU_ASSERT(test_evaluate("level < 10", alarm));
+    CU_ASSERT(!test_evaluate("level < '10'", alarm));
+    CU_ASSERT(test_evaluate("device == 7.0", alarm));
+
+    // JSON-like payloads are read as well
+    char *json = "{\"type\": \"alarm\", \"temperature\": 21.5}";
+    CU_ASSERT(test_evaluate("type == alarm && temperature > 20", json));
+    CU_ASSERT(!test_evaluate("temperature > 25", json));
+}
+
+void hpb_filter_test_attributes()
+{
+    HpbFilter *filter = hpb_filter_compile("$length <= 5 && $publisher == 42 && $topic ~ room1");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(filter);
+    CU_ASSERT(filter->code[0].field == HPB_FILTER_FIELD_LENGTH);
+    CU_ASSERT(filter->code[1].field == HPB_FILTER_FIELD_PUBLISHER);
+
+    char *topic = "site1/room1/temperature";
+    CU_ASSERT(hpb_filter_evaluate(filter, "21.5", 4, 42, topic, strlen(topic)));
+    CU_ASSERT(filter->last_result);
+    CU_ASSERT(!hpb_filter_evaluate(filter, "21.5", 4, 43, topic, strlen(topic)));
+    CU_ASSERT(!filter->last_result);
+    CU_ASSERT(!hpb_filter_evaluate(filter, "21.5", 4, 42, NULL, 0));
+    CU_ASSERT(!hpb_filter_evaluate(filter, "21.5 C", 6, 42, topic, strlen(topic)));
+    hpb_filter_destroy(&filter);
+
+    // Without filter every message passes
+    CU_ASSERT(hpb_filter_evaluate(NULL, "21.5", 4, 42, NULL, 0));
+}
+
+static bool test_evaluate(char *expression, char *msg)
+{
+    HpbFilter *filter = hpb_filter_compile(expression);
+    CU_ASSERT_PTR_NOT_NULL(filter);
+    if(filter == NULL) {
+        return false;
+    }
+
+    bool result = hpb_filter_evaluate(filter, msg, strlen(msg), 0, NULL, 0);
+    hpb_filter_destroy(&filter);
+    return result;
+}
@@ -0,0 +1,98 @@
+
+#include "hpb_handover_test.h"
+#include "hpb_test_utils.h"
+
+static HLByte HPB_HANDOVER_TEST_SERVICE1[] = "\x8b\xa1\x04\x94\xc2\x9d\x24\x76\x04\xb1\x5c\xd2\x40\x01\x32\x33\x58\xa8\x9b\xf5";
+static HLByte HPB_HANDOVER_TEST_SERVICE2[] = "\xf2\x95\xa7\x85\x27\x72\xfd\x6c\x88\xb5\x14\x37\xf3\x5e\x5e\x73\x08\x9f\xad\x3e";
+
+static HpbPublishOrigin HPB_HANDOVER_TEST_ORIGIN = {0x01020304, 7};
+
+static size_t n_flushed_bytes = 0;
+
+static void test_flush(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, void *arg);
+
+void hpb_handover_test()
+{
+    hpb_handover_test_forward();
+    hpb_handover_test_buffer();
+}
+
+void hpb_handover_test_forward()
+{
+    HLByte id1[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0x01};
+    HLByte id2[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0x02};
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(id1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id(id2, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HpbHandover *handover = hpb_handover_create(HPB_HANDOVER_BUFFER_MAX_BYTES);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(handover);
+
+    CU_ASSERT_PTR_NULL(hpb_handover_find_forward(handover, HPB_HANDOVER_TEST_SERVICE1, 0));
+    CU_ASSERT(hpb_handover_add_forward(handover, HPB_HANDOVER_TEST_SERVICE1, instance1, 0) == 0);
+    HypeInstance *forward = hpb_handover_find_forward(handover, HPB_HANDOVER_TEST_SERVICE1, 10);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(forward);
+    CU_ASSERT(memcmp(forward->identifier->data, id1, HPB_UTILS_CLIENT_ID_TEST_SIZE) == 0);
+    CU_ASSERT_PTR_NULL(hpb_handover_find_forward(handover, HPB_HANDOVER_TEST_SERVICE2, 10));
+
+    // A new handover of the same service replaces the previous record
+    CU_ASSERT(hpb_handover_add_forward(handover, HPB_HANDOVER_TEST_SERVICE1, instance2, 100) == 0);
+    CU_ASSERT(handover->forwards->size == 1);
+    forward = hpb_handover_find_forward(handover, HPB_HANDOVER_TEST_SERVICE1, 200);
+    CU_ASSERT(memcmp(forward->identifier->data, id2, HPB_UTILS_CLIENT_ID_TEST_SIZE) == 0);
+    CU_ASSERT(handover->n_forwarded == 2);
+
+    // Records are not used after they expire
+    CU_ASSERT_PTR_NULL(hpb_handover_find_forward(handover, HPB_HANDOVER_TEST_SERVICE1, 100 + HPB_HANDOVER_FORWARD_TTL_MS));
+    hpb_handover_expire(handover, 100 + HPB_HANDOVER_FORWARD_TTL_MS);
+    CU_ASSERT(handover->forwards->size == 0);
+
+    hpb_handover_add_forward(handover, HPB_HANDOVER_TEST_SERVICE2, instance1, 0);
+    hpb_handover_remove_forward(handover, HPB_HANDOVER_TEST_SERVICE2);
+    CU_ASSERT(handover->forwards->size == 0);
+
+    hpb_handover_destroy(&handover);
+    CU_ASSERT_PTR_NULL(handover);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+}
+
+void hpb_handover_test_buffer()
+{
+    HpbHandover *handover = hpb_handover_create(10);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(handover);
+
+    CU_ASSERT(hpb_handover_buffer_publish(handover, HPB_HANDOVER_TEST_SERVICE1, HPB_HANDOVER_TEST_ORIGIN, "aaaa", 4, 0) == 0);
+    CU_ASSERT(hpb_handover_buffer_publish(handover, HPB_HANDOVER_TEST_SERVICE2, HPB_HANDOVER_TEST_ORIGIN, "bbbb", 4, 0) == 0);
+    CU_ASSERT(handover->n_bytes == 8);
+
+    // The oldest publish is dropped to make room, and larger publishes than the buffer are refused
+    CU_ASSERT(hpb_handover_buffer_publish(handover, HPB_HANDOVER_TEST_SERVICE1, HPB_HANDOVER_TEST_ORIGIN, "cccc", 4, 1000) == 0);
+    CU_ASSERT(handover->publishes->size == 2);
+    CU_ASSERT(handover->n_dropped == 1);
+    CU_ASSERT(hpb_handover_buffer_publish(handover, HPB_HANDOVER_TEST_SERVICE1, HPB_HANDOVER_TEST_ORIGIN, "ddddddddddd", 11, 1000) == -1);
+    CU_ASSERT(handover->n_dropped == 2);
+
+    n_flushed_bytes = 0;
+    CU_ASSERT(hpb_handover_flush(handover, HPB_HANDOVER_TEST_SERVICE1, test_flush, NULL) == 1);
+    CU_ASSERT(n_flushed_bytes == 4);
+    CU_ASSERT(hpb_handover_flush(handover, HPB_HANDOVER_TEST_SERVICE1, test_flush, NULL) == 0);
+    CU_ASSERT(handover->n_bytes == 4);
+
+    // Buffered publishes expire
+    hpb_handover_expire(handover, HPB_HANDOVER_BUFFER_TTL_MS - 1);
+    CU_ASSERT(handover->publishes->size == 1);
+    hpb_handover_expire(handover, HPB_HANDOVER_BUFFER_TTL_MS);
+    CU_ASSERT(handover->publishes->size == 0);
+    CU_ASSERT(handover->n_bytes == 0);
+    CU_ASSERT(hpb_handover_flush(handover, HPB_HANDOVER_TEST_SERVICE2, test_flush, NULL) == 0);
+
+    CU_ASSERT(hpb_handover_buffer_publish(handover, HPB_HANDOVER_TEST_SERVICE2, HPB_HANDOVER_TEST_ORIGIN, "eeee", 4, 0) == 0);
+    hpb_handover_destroy(&handover);
+}
+
+static void test_flush(HLByte service_key[], HpbPublishOrigin origin, char *msg, size_t msg_length, void *arg)
+{
+    CU_ASSERT(memcmp(service_key, HPB_HANDOVER_TEST_SERVICE1, SHA1_BLOCK_SIZE) == 0);
+    CU_ASSERT(origin.publisher_tag == HPB_HANDOVER_TEST_ORIGIN.publisher_tag && origin.publisher_seq == HPB_HANDOVER_TEST_ORIGIN.publisher_seq);
+    CU_ASSERT(strncmp(msg, "cccc", msg_length) == 0);
+    n_flushed_bytes += msg_length;
+}
@@ -0,0 +1,63 @@
+
+#include "hpb_histogram_test.h"
+
+void hpb_histogram_test()
+{
+    CU_ASSERT_PTR_NULL(hpb_histogram_create(1, 3));
+    CU_ASSERT_PTR_NULL(hpb_histogram_create(1000, 0));
+    CU_ASSERT_PTR_NULL(hpb_histogram_create(1000, HPB_HISTOGRAM_MAX_SIGNIFICANT_FIGURES + 1));
+
+    HpbHistogram *histogram = hpb_histogram_create(3600 * 1000000ULL, 3);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(histogram);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(histogram, 50.0) == 0);
+
+    // The values up to twice the precision are counted exactly
+    for(uint64_t value = 1; value <= 1000; value++) {
+        CU_ASSERT(hpb_histogram_record(histogram, value) == 0);
+    }
+    CU_ASSERT(histogram->total_count == 1000);
+    CU_ASSERT(histogram->min == 1);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(histogram, 50.0) == 500);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(histogram, 99.0) == 990);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(histogram, 99.9) == 999);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(histogram, 100.0) == 1000);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(histogram, 0.0) == 1);
+    CU_ASSERT_DOUBLE_EQUAL(hpb_histogram_get_mean(histogram), 500.5, 0.001);
+
+    // The larger values are known within the significant figures, and the maximum exactly
+    hpb_histogram_reset(histogram);
+    CU_ASSERT(histogram->total_count == 0);
+    for(int i = 0; i < 999; i++) {
+        hpb_histogram_record(histogram, 1000000);
+    }
+    hpb_histogram_record(histogram, 123456789);
+    uint64_t p50 = hpb_histogram_get_value_at_percentile(histogram, 50.0);
+    CU_ASSERT(p50 >= 1000000 && p50 <= 1001000);
+    uint64_t p99_9 = hpb_histogram_get_value_at_percentile(histogram, 99.9);
+    CU_ASSERT(p99_9 >= 1000000 && p99_9 <= 1001000);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(histogram, 99.95) == 123456789);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(histogram, 100.0) == 123456789);
+
+    // Two histograms with the same parameters can be added
+    HpbHistogram *other = hpb_histogram_create(3600 * 1000000ULL, 3);
+    HpbHistogram *different = hpb_histogram_create(3600 * 1000000ULL, 2);
+    hpb_histogram_record(other, 5);
+    CU_ASSERT(hpb_histogram_add(histogram, different) == -1);
+    CU_ASSERT(hpb_histogram_add(histogram, other) == 0);
+    CU_ASSERT(histogram->total_count == 1001);
+    CU_ASSERT(histogram->min == 5);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(histogram, 0.0) == 5);
+
+    // The values above the highest one are clamped
+    HpbHistogram *small = hpb_histogram_create(1000, 2);
+    CU_ASSERT(hpb_histogram_record(small, 5000) == -1);
+    CU_ASSERT(small->n_clamped == 1);
+    CU_ASSERT(small->max == 5000);
+    CU_ASSERT(hpb_histogram_get_value_at_percentile(small, 50.0) >= 1000);
+
+    hpb_histogram_destroy(&small);
+    hpb_histogram_destroy(&different);
+    hpb_histogram_destroy(&other);
+    hpb_histogram_destroy(&histogram);
+    CU_ASSERT_PTR_NULL(histogram);
+}
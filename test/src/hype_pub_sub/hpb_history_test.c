@@ -0,0 +1,47 @@
+
+#include "hpb_history_test.h"
+
+void hpb_history_test()
+{
+    HpbPublishOrigin origin = {0x01020304, 7};
+    HpbHistory *history = hpb_history_create(10);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(history);
+    CU_ASSERT_PTR_NULL(hpb_history_find(history, 1));
+
+    CU_ASSERT(hpb_history_add(history, 1, origin, "aaaa", 4) == 0);
+    CU_ASSERT(hpb_history_add(history, 2, origin, "bbbb", 4) == 0);
+    CU_ASSERT(history->n_bytes == 8);
+
+    HpbHistoryEntry *entry = hpb_history_find(history, 2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(entry);
+    CU_ASSERT_NSTRING_EQUAL(entry->msg, "bbbb", 4);
+    CU_ASSERT(entry->origin.publisher_tag == origin.publisher_tag && entry->origin.publisher_seq == origin.publisher_seq);
+    CU_ASSERT_PTR_NULL(hpb_history_find(history, 3));
+
+    // The oldest messages are dropped to respect the bytes limit
+    CU_ASSERT(hpb_history_add(history, 3, origin, "cccc", 4) == 0);
+    CU_ASSERT(history->size == 2);
+    CU_ASSERT_PTR_NULL(hpb_history_find(history, 1));
+    CU_ASSERT_PTR_NOT_NULL(hpb_history_find(history, 3));
+    CU_ASSERT(hpb_history_add(history, 4, origin, "ddddddddddd", 11) == -1);
+
+    // The sequence can have holes
+    CU_ASSERT(hpb_history_add(history, 5, origin, "e", 1) == 0);
+    entry = hpb_history_find(history, 5);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(entry);
+    CU_ASSERT(entry->seq == 5);
+
+    hpb_history_destroy(&history);
+    CU_ASSERT_PTR_NULL(history);
+
+    // The oldest messages are dropped to respect the entries limit
+    history = hpb_history_create(HPB_HISTORY_MAX_BYTES);
+    for(uint32_t seq = UINT32_MAX - 10; seq != HPB_HISTORY_MAX_ENTRIES; seq++) {
+        hpb_history_add(history, seq, origin, "x", 1);
+    }
+    CU_ASSERT(history->size == HPB_HISTORY_MAX_ENTRIES);
+    CU_ASSERT_PTR_NULL(hpb_history_find(history, UINT32_MAX));
+    CU_ASSERT_PTR_NOT_NULL(hpb_history_find(history, 0));
+    CU_ASSERT_PTR_NOT_NULL(hpb_history_find(history, HPB_HISTORY_MAX_ENTRIES - 1));
+    hpb_history_destroy(&history);
+}
@@ -0,0 +1,145 @@
+
+#include "hpb_load_test.h"
+
+static HpbSim *test_sim = NULL;
+static HpbLoadSink *test_sinks[3];
+
+static void test_on_message_received(char *service_name, char *msg, size_t msg_length);
+
+void hpb_load_test()
+{
+    hpb_load_test_payload();
+    hpb_load_test_sim();
+}
+
+void hpb_load_test_payload()
+{
+    CU_ASSERT_PTR_NULL(hpb_load_generator_create(1, 0.0, 1, 1000000, 100));
+    CU_ASSERT_PTR_NULL(hpb_load_generator_create(1, 100.0, 0, 1000000, 100));
+    CU_ASSERT_PTR_NULL(hpb_load_sink_create(HPB_LOAD_MAX_TOPICS + 1));
+
+    // The publishes given up are counted in their topic, from the key reported by the completion callback
+    HpbLoadGenerator *generator = hpb_load_generator_create(7, 100.0, 2, 1000000, 100);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(generator);
+    HLByte topic_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) HPB_LOAD_TOPIC_PREFIX "1", strlen(HPB_LOAD_TOPIC_PREFIX "1"), topic_key);
+    CU_ASSERT(hpb_load_generator_on_publish_completion(generator, topic_key, true) == -1);
+    CU_ASSERT(hpb_load_generator_on_publish_completion(generator, topic_key, false) == 0);
+    CU_ASSERT(generator->n_failed == 1);
+    CU_ASSERT(generator->n_failed_by_topic[0] == 0);
+    CU_ASSERT(generator->n_failed_by_topic[1] == 1);
+    sha1_digest((const BYTE *) "other", strlen("other"), topic_key);
+    CU_ASSERT(hpb_load_generator_on_publish_completion(generator, topic_key, false) == -1);
+    CU_ASSERT(generator->n_failed == 1);
+    hpb_load_generator_destroy(&generator);
+
+    HpbLoadSink *sink = hpb_load_sink_create(2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(sink);
+
+    // Messages which are not load messages, or of other topics, are not measured
+    char other_msg[] = "hello";
+    char other_topic_msg[] = HPB_LOAD_MAGIC " 7 2 8 2 0 0 0 0 ";
+    CU_ASSERT(hpb_load_sink_receive(sink, other_msg, sizeof(other_msg)) == -1);
+    CU_ASSERT(hpb_load_sink_receive(sink, other_topic_msg, sizeof(other_topic_msg)) == -1);
+    CU_ASSERT(sink->n_invalid == 2);
+
+    // The messages scheduled in the topics of the sink which were not received are lost, even in a topic never heard from
+    char msg0[] = HPB_LOAD_MAGIC " 7 2 8 1 0 0 0 0 ...";
+    char msg3[] = HPB_LOAD_MAGIC " 7 2 8 1 3 0 0 0 ...";
+    char msg1[] = HPB_LOAD_MAGIC " 7 2 8 1 1 0 0 0 ...";
+    CU_ASSERT(hpb_load_sink_receive(sink, msg0, sizeof(msg0)) == 0);
+    CU_ASSERT(hpb_load_sink_receive(sink, msg3, sizeof(msg3)) == 0);
+    CU_ASSERT(hpb_load_sink_get_lost(sink) == 4 + 2);
+    CU_ASSERT(hpb_load_sink_receive(sink, msg1, sizeof(msg1)) == 0);
+    CU_ASSERT(hpb_load_sink_get_lost(sink) == 4 + 1);
+    CU_ASSERT(sink->n_received == 3);
+    CU_ASSERT(sink->sources->size == 1);
+    CU_ASSERT(((HpbLoadSource *) sink->sources->head->element)->topics[1].n_reordered == 1);
+
+    // The publishes given up by the generator are not lost
+    char msg_failed[] = HPB_LOAD_MAGIC " 7 2 8 0 1 1 0 0 ...";
+    CU_ASSERT(hpb_load_sink_receive(sink, msg_failed, sizeof(msg_failed)) == 0);
+    CU_ASSERT(hpb_load_sink_get_lost(sink) == 2 + 1);
+    CU_ASSERT(hpb_load_sink_get_failed(sink) == 1);
+
+    // Another generator has sequence numbers of its own
+    char msg_other_tag[] = HPB_LOAD_MAGIC " 8 1 2 0 0 0 0 0 ...";
+    CU_ASSERT(hpb_load_sink_receive(sink, msg_other_tag, sizeof(msg_other_tag)) == 0);
+    CU_ASSERT(sink->sources->size == 2);
+    CU_ASSERT(hpb_load_sink_get_lost(sink) == 3 + 1);
+
+    hpb_load_sink_destroy(&sink);
+    CU_ASSERT_PTR_NULL(sink);
+}
+
+void hpb_load_test_sim()
+{
+    HypePubSub *previous = hpb_get();
+    HpbSimLink link = {2000, 0, 0, 0.0};
+    test_sim = hpb_sim_create(link, 1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(test_sim);
+
+    for(int i = 0; i < 4; i++) {
+        hpb_sim_add_node(test_sim, 1);
+    }
+    hpb_sim_run(test_sim, 500000);
+
+    // Nodes 1 to 3 are sinks of the load published by node 0
+    for(size_t i = 0; i < 3; i++)
+    {
+        test_sinks[i] = hpb_load_sink_create(4);
+        hpb_sim_select_node(test_sim, i + 1);
+        hpb_set_message_received_callback(test_on_message_received);
+        CU_ASSERT(hpb_load_sink_subscribe(test_sinks[i]) == 0);
+    }
+    hpb_sim_run(test_sim, 500000);
+
+    hpb_sim_select_node(test_sim, 0);
+    HpbLoadGenerator *generator = hpb_load_generator_create(42, 1000.0, 4, 1000000, 200);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(generator);
+    CU_ASSERT(generator->n_scheduled == 1000);
+
+    // A stall of the publisher sends the late messages at once, stamped with their scheduled time
+    for(int i = 0; i < 1000; i++)
+    {
+        uint64_t step_us = (i == 500) ? 100000 : 1000;
+        hpb_sim_run(test_sim, step_us);
+        hpb_sim_select_node(test_sim, 0);
+        hpb_load_generator_tick(generator);
+        if(hpb_load_generator_is_done(generator)) {
+            break;
+        }
+    }
+    hpb_sim_run(test_sim, 500000);
+
+    CU_ASSERT(hpb_load_generator_is_done(generator));
+    CU_ASSERT(generator->n_sent == 1000);
+    CU_ASSERT(generator->max_lag_us >= 90000);
+
+    for(size_t i = 0; i < 3; i++)
+    {
+        CU_ASSERT(test_sinks[i]->n_received == 1000);
+        CU_ASSERT(hpb_load_sink_get_lost(test_sinks[i]) == 0);
+        CU_ASSERT(hpb_load_sink_get_failed(test_sinks[i]) == 0);
+
+        // The messages go through the manager of their topic, unless the publisher manages it
+        uint64_t p50 = hpb_histogram_get_value_at_percentile(test_sinks[i]->uncorrected_latency, 50.0);
+        CU_ASSERT(p50 >= 2000 && p50 <= 4000);
+
+        // The stall only shows in the latency from the schedule
+        CU_ASSERT(hpb_histogram_get_value_at_percentile(test_sinks[i]->uncorrected_latency, 100.0) <= 4000);
+        CU_ASSERT(hpb_histogram_get_value_at_percentile(test_sinks[i]->latency, 100.0) >= 100000);
+        CU_ASSERT(hpb_histogram_get_value_at_percentile(test_sinks[i]->latency, 99.0) > 50000);
+        hpb_load_sink_destroy(&test_sinks[i]);
+    }
+
+    hpb_load_generator_destroy(&generator);
+    CU_ASSERT_PTR_NULL(generator);
+    hpb_sim_destroy(&test_sim);
+    hpb_set_current(previous);
+}
+
+static void test_on_message_received(char *service_name, char *msg, size_t msg_length)
+{
+    hpb_load_sink_receive(test_sinks[test_sim->current - 1], msg, msg_length);
+}
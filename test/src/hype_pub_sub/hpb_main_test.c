@@ -13,12 +13,37 @@
 #include "hpb_clients_list_test.h"
 #include "hpb_service_managers_list_test.h"
 #include "hpb_subscriptions_list_test.h"
+#include "hpb_event_loop_test.h"
+#include "hpb_fanout_test.h"
+#include "hpb_retry_queue_test.h"
+#include "hpb_handover_test.h"
+#include "hpb_seq_window_test.h"
+#include "hpb_history_test.h"
+#include "hpb_dedup_test.h"
+#include "hpb_timer_wheel_test.h"
+#include "hpb_membership_test.h"
+#include "hpb_topic_trie_test.h"
+#include "hpb_filter_test.h"
+#include "hpb_relay_tree_test.h"
+#include "hpb_direct_route_test.h"
+#include "hpb_resolver_test.h"
+#include "hpb_transport_socket_test.h"
+#include "hpb_sim_test.h"
+#include "hpb_sim_scenario_test.h"
+#include "hpb_histogram_test.h"
+#include "hpb_load_test.h"
+#include "hpb_metrics_test.h"
+#include "hpb_test_utils.h"
 
 
 int main()
 {
    CU_pSuite pSuite = NULL;
 
+   // The messages sent by the HypePubSub singleton are only tracked if the transport gives them an identifier
+   HpbTransport *transport = hpb_test_utils_create_transport();
+   hpb_set_transport(transport);
+
    if (CUE_SUCCESS != CU_initialize_registry())
       return CU_get_error();
 
@@ -42,7 +67,27 @@ int main()
        (CU_add_test(pSuite, "Test HpbProtocol module", hpb_protocol_test) == NULL) ||
        (CU_add_test(pSuite, "Test HpbClientsList module", hpb_list_clients_test) == NULL) ||
        (CU_add_test(pSuite, "Test HpbServiceManagersList module", hpb_list_service_managers_test) == NULL) ||
-       (CU_add_test(pSuite, "Test HpbSubscriptionsList module", hpb_list_subscriptions_test) == NULL)
+       (CU_add_test(pSuite, "Test HpbSubscriptionsList module", hpb_list_subscriptions_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbEventLoop module", hpb_event_loop_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbFanout module", hpb_fanout_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbRetryQueue module", hpb_retry_queue_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbHandover module", hpb_handover_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbSeqWindow module", hpb_seq_window_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbHistory module", hpb_history_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbDedup module", hpb_dedup_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbTimerWheel module", hpb_timer_wheel_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbMembership module", hpb_membership_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbTopicTrie module", hpb_topic_trie_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbFilter module", hpb_filter_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbRelayTree module", hpb_relay_tree_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbDirectRoute module", hpb_direct_route_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbResolver module", hpb_resolver_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbTransportSocket module", hpb_transport_socket_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbSim module", hpb_sim_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbSimScenario module", hpb_sim_scenario_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbHistogram module", hpb_histogram_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbLoad module", hpb_load_test) == NULL) ||
+       (CU_add_test(pSuite, "Test HpbMetrics module", hpb_metrics_test) == NULL)
       )
    {
       CU_cleanup_registry();
@@ -52,5 +97,6 @@ int main()
    CU_basic_set_mode(CU_BRM_VERBOSE);
    CU_basic_run_tests();
    CU_cleanup_registry();
+   hpb_transport_destroy(&transport);
    return CU_get_error();
 }
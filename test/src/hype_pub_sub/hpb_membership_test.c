@@ -0,0 +1,100 @@
+#include "hpb_membership_test.h"
+#include "hpb_test_utils.h"
+
+static size_t n_resolved = 0;
+static size_t n_lost = 0;
+
+static void test_apply(HypeInstance *instance, bool is_resolved, void *arg);
+
+void hpb_membership_test()
+{
+    hpb_membership_test_debounce();
+    hpb_membership_test_hold_down();
+}
+
+void hpb_membership_test_debounce()
+{
+    HLByte id1[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0x01};
+    HLByte id2[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0x02};
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(id1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id(id2, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HpbMembership *membership = hpb_membership_create(100);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(membership);
+    uint64_t now_ms = 1000000;
+    n_resolved = 0;
+    n_lost = 0;
+
+    // A burst of events is applied once, after the window, with a single change per instance
+    CU_ASSERT(hpb_membership_add_event(membership, instance1, true, now_ms) == 0);
+    CU_ASSERT(hpb_membership_add_event(membership, instance2, true, now_ms + 50) == 0);
+    CU_ASSERT(hpb_membership_add_event(membership, instance1, false, now_ms + 80) == 0);
+    CU_ASSERT(hpb_membership_add_event(membership, instance1, true, now_ms + 90) == 0);
+    CU_ASSERT(membership->changes->size == 2);
+    CU_ASSERT(hpb_membership_apply(membership, now_ms + 150, test_apply, NULL) == 0);
+    CU_ASSERT(hpb_membership_apply(membership, now_ms + 190, test_apply, NULL) == 2);
+    CU_ASSERT(n_resolved == 2);
+    CU_ASSERT(n_lost == 0);
+    CU_ASSERT(membership->n_events == 4);
+    CU_ASSERT(membership->n_applies == 1);
+    CU_ASSERT(hpb_membership_apply(membership, now_ms + 1000, test_apply, NULL) == 0);
+
+    // A steady stream of events cannot postpone the changes forever
+    now_ms += 10000;
+    uint64_t t;
+    size_t n_applied = 0;
+    for(t = 0; t <= HPB_MEMBERSHIP_MAX_DELAY_MS; t += 50)
+    {
+        hpb_membership_add_event(membership, instance2, (t / 50) % 2 == 0, now_ms + t);
+        n_applied += hpb_membership_apply(membership, now_ms + t, test_apply, NULL);
+    }
+    CU_ASSERT(n_applied == 1);
+
+    hpb_membership_destroy(&membership);
+    CU_ASSERT_PTR_NULL(membership);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+}
+
+void hpb_membership_test_hold_down()
+{
+    HLByte id1[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0x01};
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(id1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HpbMembership *membership = hpb_membership_create(100);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(membership);
+    uint64_t now_ms = 1000000;
+    n_resolved = 0;
+    n_lost = 0;
+
+    hpb_membership_add_event(membership, instance1, false, now_ms);
+    CU_ASSERT(hpb_membership_apply(membership, now_ms + 100, test_apply, NULL) == 1);
+    CU_ASSERT(n_lost == 1);
+
+    // An instance which comes back soon after being lost is held back until it stays
+    hpb_membership_add_event(membership, instance1, true, now_ms + 1000);
+    CU_ASSERT(hpb_membership_apply(membership, now_ms + 1100, test_apply, NULL) == 0);
+    CU_ASSERT(hpb_membership_apply(membership, now_ms + 5000, test_apply, NULL) == 0);
+    CU_ASSERT(membership->n_held == 1);
+
+    // Flapping again extends the hold down
+    hpb_membership_add_event(membership, instance1, false, now_ms + 6000);
+    CU_ASSERT(hpb_membership_apply(membership, now_ms + 6100, test_apply, NULL) == 1);
+    hpb_membership_add_event(membership, instance1, true, now_ms + 7000);
+    CU_ASSERT(hpb_membership_apply(membership, now_ms + 100 + HPB_MEMBERSHIP_HOLD_DOWN_MS, test_apply, NULL) == 0);
+    CU_ASSERT(hpb_membership_apply(membership, now_ms + 6100 + HPB_MEMBERSHIP_HOLD_DOWN_MS, test_apply, NULL) == 1);
+    CU_ASSERT(n_resolved == 1);
+    CU_ASSERT(n_lost == 2);
+    CU_ASSERT(membership->changes->size == 0);
+
+    hpb_membership_destroy(&membership);
+    hype_instance_release(instance1);
+}
+
+static void test_apply(HypeInstance *instance, bool is_resolved, void *arg)
+{
+    if(is_resolved) {
+        n_resolved++;
+    }
+    else {
+        n_lost++;
+    }
+}
@@ -0,0 +1,247 @@
+
+#include "hpb_metrics_test.h"
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define TEST_METRICS_N_THREADS 40 // More threads than shards, so that some of them share a shard
+#define TEST_METRICS_N_ADDS 10000
+#define TEST_METRICS_SOCKET_PATH "/tmp/hpb_metrics_test.sock"
+
+static HpbMetrics *test_metrics = NULL;
+static char test_response[16384];
+static size_t test_response_size = 0;
+
+static void *test_thread_add(void *arg);
+static void *test_thread_scrape(void *arg);
+static void test_task_stop(void *arg);
+static HpbMetrics *test_collect();
+
+void hpb_metrics_test()
+{
+    hpb_metrics_test_registry();
+    hpb_metrics_test_threads();
+    hpb_metrics_test_exporter();
+    hpb_metrics_test_sim();
+}
+
+void hpb_metrics_test_registry()
+{
+    HpbMetrics *metrics = hpb_metrics_create();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(metrics);
+    CU_ASSERT(hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_IN, -1) == 0);
+
+    hpb_metrics_add_by_type(metrics, HPB_METRICS_MESSAGES_IN, PUBLISH, 2);
+    hpb_metrics_add_by_type(metrics, HPB_METRICS_MESSAGES_IN, INFO, 3);
+    hpb_metrics_add_by_type(metrics, HPB_METRICS_BYTES_IN, INFO, 300);
+    hpb_metrics_add_by_type(metrics, HPB_METRICS_MESSAGES_IN, 200, 1); // Unknown types are counted as invalid
+    hpb_metrics_add(metrics, HPB_METRICS_REBALANCES, 1);
+    CU_ASSERT(hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_IN, PUBLISH) == 2);
+    CU_ASSERT(hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_IN, INFO) == 3);
+    CU_ASSERT(hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_IN, INVALID) == 1);
+    CU_ASSERT(hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_IN, -1) == 6);
+    CU_ASSERT(hpb_metrics_get_counter(metrics, HPB_METRICS_BYTES_IN, -1) == 300);
+    CU_ASSERT(hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_OUT, -1) == 0);
+    CU_ASSERT(hpb_metrics_get_counter(metrics, HPB_METRICS_REBALANCES, -1) == 1);
+
+    // Each value falls in the bucket of the next power of two, and the largest ones only in the count
+    uint64_t values[] = {0, 1, 2, 3, 4, 5, 8192, 8193};
+    for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        hpb_metrics_observe(metrics, HPB_METRICS_FANOUT_SIZE, values[i]);
+    }
+    HpbMetricsHistogramValues fanout;
+    hpb_metrics_get_histogram(metrics, HPB_METRICS_FANOUT_SIZE, &fanout);
+    CU_ASSERT(fanout.buckets[0] == 2);
+    CU_ASSERT(fanout.buckets[1] == 1);
+    CU_ASSERT(fanout.buckets[2] == 2);
+    CU_ASSERT(fanout.buckets[3] == 1);
+    CU_ASSERT(fanout.buckets[13] == 1);
+    CU_ASSERT(fanout.count == 8);
+    CU_ASSERT(fanout.sum == 16400);
+
+    hpb_metrics_set_gauge(metrics, HPB_METRICS_NETWORK_CLIENTS, 7);
+
+    // The exposition lists every type, and the buckets cumulatively
+    char *text = NULL;
+    size_t text_size = 0;
+    FILE *out = open_memstream(&text, &text_size);
+    hpb_metrics_print_prometheus(out, metrics);
+    fclose(out);
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "# TYPE hpb_messages_in_total counter\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "hpb_messages_in_total{type=\"publish\"} 2\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "hpb_messages_in_total{type=\"info\"} 3\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "hpb_messages_in_total{type=\"subscribe\"} 0\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "hpb_bytes_in_total{type=\"info\"} 300\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "hpb_rebalances_total 1\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "# TYPE hpb_network_clients gauge\nhpb_network_clients 7\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "hpb_fanout_size_bucket{le=\"4\"} 5\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "hpb_fanout_size_bucket{le=\"8192\"} 7\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "hpb_fanout_size_bucket{le=\"+Inf\"} 8\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(text, "hpb_fanout_size_sum 16400\nhpb_fanout_size_count 8\n"));
+    free(text);
+
+    hpb_metrics_destroy(&metrics);
+    CU_ASSERT_PTR_NULL(metrics);
+}
+
+void hpb_metrics_test_threads()
+{
+    test_metrics = hpb_metrics_create();
+
+    // The shards of all the threads are added up when the counters are read
+    pthread_t threads[TEST_METRICS_N_THREADS];
+    for(int i = 0; i < TEST_METRICS_N_THREADS; i++) {
+        pthread_create(&threads[i], NULL, test_thread_add, NULL);
+    }
+    for(int i = 0; i < TEST_METRICS_N_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    CU_ASSERT(hpb_metrics_get_counter(test_metrics, HPB_METRICS_MESSAGES_OUT, INFO) == TEST_METRICS_N_THREADS * TEST_METRICS_N_ADDS);
+    CU_ASSERT(hpb_metrics_get_counter(test_metrics, HPB_METRICS_BYTES_OUT, INFO) == TEST_METRICS_N_THREADS * TEST_METRICS_N_ADDS * 100ULL);
+    HpbMetricsHistogramValues fanout;
+    hpb_metrics_get_histogram(test_metrics, HPB_METRICS_FANOUT_SIZE, &fanout);
+    CU_ASSERT(fanout.buckets[4] == TEST_METRICS_N_THREADS * TEST_METRICS_N_ADDS);
+    CU_ASSERT(fanout.count == TEST_METRICS_N_THREADS * TEST_METRICS_N_ADDS);
+
+    hpb_metrics_destroy(&test_metrics);
+}
+
+void hpb_metrics_test_exporter()
+{
+    HpbEventLoop *loop = hpb_event_loop_create();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(loop);
+    test_metrics = hpb_metrics_create();
+    hpb_metrics_add(test_metrics, HPB_METRICS_SEND_FAILURES, 4);
+
+    CU_ASSERT_PTR_NULL(hpb_metrics_exporter_create(loop, "/nonexistent/hpb_metrics.sock", test_collect));
+    HpbMetricsExporter *exporter = hpb_metrics_exporter_create(loop, TEST_METRICS_SOCKET_PATH, test_collect);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(exporter);
+    CU_ASSERT(access(TEST_METRICS_SOCKET_PATH, F_OK) == 0);
+
+    // The client scrapes over HTTP while the loop serves it
+    pthread_t thread;
+    pthread_create(&thread, NULL, test_thread_scrape, loop);
+    hpb_event_loop_run(loop);
+    pthread_join(thread, NULL);
+
+    test_response[test_response_size] = '\0';
+    CU_ASSERT(strncmp(test_response, "HTTP/1.0 200 OK\r\n", 17) == 0);
+    CU_ASSERT_PTR_NOT_NULL(strstr(test_response, "Content-Type: text/plain; version=0.0.4\r\n"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(test_response, "\r\n\r\n# HELP hpb_messages_in_total"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(test_response, "hpb_send_failures_total 4\n"));
+    CU_ASSERT(exporter->n_scrapes == 1);
+    CU_ASSERT(exporter->n_clients == 0);
+
+    hpb_metrics_exporter_destroy(&exporter);
+    CU_ASSERT_PTR_NULL(exporter);
+    CU_ASSERT(access(TEST_METRICS_SOCKET_PATH, F_OK) != 0);
+    hpb_metrics_destroy(&test_metrics);
+    hpb_event_loop_destroy(&loop);
+}
+
+void hpb_metrics_test_sim()
+{
+    HypePubSub *previous = hpb_get();
+    HpbSimLink link = {2000, 0, 0, 0.0};
+    HpbSim *sim = hpb_sim_create(link, 1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(sim);
+
+    for(int i = 0; i < 4; i++) {
+        hpb_sim_add_node(sim, 1);
+    }
+    hpb_sim_run(sim, 500000);
+    for(size_t i = 1; i < 4; i++)
+    {
+        hpb_sim_select_node(sim, i);
+        hpb_issue_subscribe_req("metrics");
+    }
+    hpb_sim_run(sim, 500000);
+    hpb_sim_select_node(sim, 0);
+    hpb_issue_publish_req("metrics", "value", 5);
+    hpb_sim_run(sim, 500000);
+
+    // Every message handed to the simulated transport is counted by its sender, and received by another node
+    uint64_t n_out = 0;
+    uint64_t n_in = 0;
+    uint64_t n_fanouts = 0;
+    for(int type = 0; type < HPB_METRICS_N_MESSAGE_TYPES; type++)
+    {
+        uint64_t n_out_of_type = 0;
+        for(size_t i = 0; i < sim->n_nodes; i++) {
+            n_out_of_type += hpb_metrics_get_counter(sim->nodes[i]->context->metrics, HPB_METRICS_MESSAGES_OUT, type);
+        }
+        CU_ASSERT(n_out_of_type == sim->n_sent_by_type[type]);
+        n_out += n_out_of_type;
+    }
+    for(size_t i = 0; i < sim->n_nodes; i++)
+    {
+        n_in += hpb_metrics_get_counter(sim->nodes[i]->context->metrics, HPB_METRICS_MESSAGES_IN, -1);
+        HpbMetricsHistogramValues fanout;
+        hpb_metrics_get_histogram(sim->nodes[i]->context->metrics, HPB_METRICS_FANOUT_SIZE, &fanout);
+        n_fanouts += fanout.count;
+    }
+    CU_ASSERT(n_out > 0);
+    CU_ASSERT(n_in == sim->n_delivered);
+    CU_ASSERT(n_fanouts == 1);
+
+    hpb_sim_select_node(sim, 0);
+    HpbMetrics *metrics = hpb_collect_metrics();
+    CU_ASSERT(metrics->gauges[HPB_METRICS_NETWORK_CLIENTS] == 3);
+    CU_ASSERT(hpb_metrics_get_counter(metrics, HPB_METRICS_MESSAGES_OUT, PUBLISH) >= 1);
+
+    hpb_sim_destroy(&sim);
+    hpb_set_current(previous);
+}
+
+static void *test_thread_add(void *arg)
+{
+    for(int i = 0; i < TEST_METRICS_N_ADDS; i++)
+    {
+        hpb_metrics_add_by_type(test_metrics, HPB_METRICS_MESSAGES_OUT, INFO, 1);
+        hpb_metrics_add_by_type(test_metrics, HPB_METRICS_BYTES_OUT, INFO, 100);
+        hpb_metrics_observe(test_metrics, HPB_METRICS_FANOUT_SIZE, 10);
+    }
+
+    return NULL;
+}
+
+static void *test_thread_scrape(void *arg)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, TEST_METRICS_SOCKET_PATH);
+
+    test_response_size = 0;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd >= 0 && connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0)
+    {
+        const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+        if(write(fd, request, sizeof(request) - 1) == (ssize_t) (sizeof(request) - 1))
+        {
+            ssize_t n_read;
+            while((n_read = read(fd, test_response + test_response_size, sizeof(test_response) - 1 - test_response_size)) > 0) {
+                test_response_size += (size_t) n_read;
+            }
+        }
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+
+    hpb_event_loop_post((HpbEventLoop *) arg, test_task_stop, arg, NULL);
+    return NULL;
+}
+
+static void test_task_stop(void *arg)
+{
+    hpb_event_loop_stop((HpbEventLoop *) arg);
+}
+
+static HpbMetrics *test_collect()
+{
+    return test_metrics;
+}
@@ -36,14 +36,82 @@ void hpb_network_test()
     HpbNetwork *network = hpb_network_create(instance1);
     CU_ASSERT_PTR_NOT_NULL_FATAL(network);
 
-    hpb_list_clients_add(network->network_clients, instance1);
-    hpb_list_clients_add(network->network_clients, instance2);
-    hpb_list_clients_add(network->network_clients, instance3);
-    hpb_list_clients_add(network->network_clients, instance4);
+    hpb_network_add_client(network, instance1);
+    hpb_network_add_client(network, instance2);
+    hpb_network_add_client(network, instance3);
+    hpb_network_add_client(network, instance4);
 
     CU_ASSERT_NSTRING_EQUAL(hpb_network_get_service_manager_id(network, SERVICE_KEY1)->identifier->data, CLIENT4_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
     CU_ASSERT_NSTRING_EQUAL(hpb_network_get_service_manager_id(network, SERVICE_KEY2)->identifier->data, CLIENT1_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
 
+    // The closest instances are sorted by distance, and the own instance is considered as well
+    HypeInstance *closest[5];
+    CU_ASSERT(hpb_network_get_closest_instances(network, SERVICE_KEY1, closest, 3) == 3);
+    CU_ASSERT_NSTRING_EQUAL(closest[0]->identifier->data, CLIENT4_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    CU_ASSERT_NSTRING_EQUAL(closest[1]->identifier->data, CLIENT2_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    CU_ASSERT_NSTRING_EQUAL(closest[2]->identifier->data, CLIENT3_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    CU_ASSERT(hpb_network_get_closest_instances(network, SERVICE_KEY2, closest, 5) == 5);
+    CU_ASSERT(closest[0] == network->own_client->hype_instance);
+    CU_ASSERT_NSTRING_EQUAL(closest[2]->identifier->data, CLIENT3_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    CU_ASSERT_NSTRING_EQUAL(closest[4]->identifier->data, CLIENT4_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    CU_ASSERT(hpb_network_get_closest_instances(network, SERVICE_KEY2, closest, 0) == 0);
+
+    // With virtual keys, the replicas are the next distinct devices after the manager in the ring
+    hpb_network_set_placement(network, HPB_PLACEMENT_VNODES);
+    HypeInstance *manager = hpb_network_get_service_manager_id(network, SERVICE_KEY1);
+    CU_ASSERT(hpb_network_get_service_manager_id(network, SERVICE_KEY1) == manager);
+    CU_ASSERT(hpb_network_get_closest_instances(network, SERVICE_KEY1, closest, 5) == 4);
+    CU_ASSERT(closest[0] == manager);
+    for(int i = 0; i < 4; i++) {
+        for(int j = i + 1; j < 4; j++) {
+            CU_ASSERT(closest[i]->identifier->size != closest[j]->identifier->size
+                      || memcmp(closest[i]->identifier->data, closest[j]->identifier->data, closest[i]->identifier->size) != 0);
+        }
+    }
+
+    HpbNetworkLoad loads[4];
+    double skew = hpb_network_get_load_skew(network, loads, 4);
+    CU_ASSERT(skew >= 1.0 && skew < 1.5);
+    CU_ASSERT(loads[0].client == network->own_client);
+    CU_ASSERT(loads[0].n_keys + loads[1].n_keys + loads[2].n_keys + loads[3].n_keys == HPB_NETWORK_LOAD_SAMPLES);
+
+    // Only the services of a lost device move
+    HLByte sample[SHA1_BLOCK_SIZE];
+    HypeInstance *managers[64];
+    for(int i = 0; i < 64; i++)
+    {
+        sha1_digest((const BYTE *) &i, sizeof(i), sample);
+        managers[i] = hpb_network_get_service_manager_id(network, sample);
+    }
+    HpbClient *client3 = hpb_list_clients_find(network->network_clients, instance3);
+    HypeInstance *lost_instance = client3->hype_instance;
+    CU_ASSERT(hpb_network_remove_client(network, instance3) >= 0);
+    for(int i = 0; i < 64; i++)
+    {
+        sha1_digest((const BYTE *) &i, sizeof(i), sample);
+        HypeInstance *new_manager = hpb_network_get_service_manager_id(network, sample);
+        CU_ASSERT(managers[i] == lost_instance || new_manager == managers[i]);
+        CU_ASSERT(!hpb_client_is_instance_equal(network->own_client, new_manager) || new_manager == network->own_client->hype_instance);
+    }
+
+    // A device with four times the capacity gets about four times the services
+    HLByte capacity = 4;
+    HypeBuffer *identifier = hype_buffer_create_from(CLIENT3_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeBuffer *announcement = hype_buffer_create_from(&capacity, sizeof(capacity));
+    HypeInstance *big_instance = hype_instance_create(identifier, announcement, true);
+    HpbClient *big_client = hpb_network_add_client(network, big_instance);
+    CU_ASSERT(big_client->capacity == 4);
+    CU_ASSERT(hpb_network_get_load_skew(network, loads, 4) < 1.5);
+    CU_ASSERT(loads[3].client == big_client);
+    CU_ASSERT(loads[3].n_keys > 2 * loads[1].n_keys && loads[3].n_keys > 2 * loads[2].n_keys);
+    hype_buffer_release(identifier);
+    hype_buffer_release(announcement);
+    hype_instance_release(big_instance);
+
+    // Back to the XOR placement
+    hpb_network_set_placement(network, HPB_PLACEMENT_XOR);
+    CU_ASSERT_NSTRING_EQUAL(hpb_network_get_service_manager_id(network, SERVICE_KEY2)->identifier->data, CLIENT1_HYPE_ID, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+
     hype_instance_release(instance1);
     hype_instance_release(instance2);
     hype_instance_release(instance3);
@@ -9,6 +9,12 @@ void hpb_protocol_test()
     hpb_protocol_test_build_unsubscribe_msg();
     hpb_protocol_test_build_publish_msg();
     hpb_protocol_test_build_info_msg();
+    hpb_protocol_test_build_nack_msg();
+    hpb_protocol_test_build_handover_msg();
+    hpb_protocol_test_build_heartbeat_msg();
+    hpb_protocol_test_build_shard_msg();
+    hpb_protocol_test_build_relay_msg();
+    hpb_protocol_test_build_subscriber_list_msg();
     hpb_protocol_test_receiving_msg();
 
     hpb_destroy(); // Frees the memory allocated by hpb_get() method calls
@@ -65,24 +71,56 @@ void hpb_protocol_test_build_publish_msg()
     HLByte SERVICE_KEY2[] = "\xf6\xcb\x6d\x9d\xb0\x98\x91\x9b\x2d\x39\x55\x11\x41\xc5\xcb\xe7\x67\xb5\x06\xd6";
     HLByte MSG2[] = "HypePubSubApp";
     size_t MSG2_SIZE = 13;
+    HpbPublishOrigin ORIGIN = {0x01020304, 0xfffffffe};
 
-    packet_size = hpb_protocol_build_publish_msg(SERVICE_KEY1, (char*) MSG1, MSG1_SIZE, &packet);
-    CU_ASSERT_EQUAL(packet_size, 35)
+    packet_size = hpb_protocol_build_publish_msg(SERVICE_KEY1, ORIGIN, (char*) MSG1, MSG1_SIZE, &packet);
+    CU_ASSERT_EQUAL(packet_size, 43)
     CU_ASSERT(packet[0] == (HLByte) PUBLISH);
     offset = MESSAGE_TYPE_BYTE_SIZE;
     CU_ASSERT(memcmp(packet + offset, SERVICE_KEY1, SHA1_BLOCK_SIZE) == 0);
     offset += SHA1_BLOCK_SIZE;
+    CU_ASSERT(binary_utils_read_uint32(packet + offset) == ORIGIN.publisher_tag);
+    CU_ASSERT(binary_utils_read_uint32(packet + offset + HPB_PROTOCOL_SEQ_SIZE) == ORIGIN.publisher_seq);
+    offset += HPB_PROTOCOL_ORIGIN_SIZE;
     CU_ASSERT(memcmp(packet + offset, MSG1, MSG1_SIZE) == 0);
     free(packet);
 
-    packet_size = hpb_protocol_build_publish_msg(SERVICE_KEY2, (char*) MSG2, MSG2_SIZE, &packet);
-    CU_ASSERT_EQUAL(packet_size, 34)
+    packet_size = hpb_protocol_build_publish_msg(SERVICE_KEY2, ORIGIN, (char*) MSG2, MSG2_SIZE, &packet);
+    CU_ASSERT_EQUAL(packet_size, 42)
     CU_ASSERT(packet[0] == (HLByte) PUBLISH);
     offset = MESSAGE_TYPE_BYTE_SIZE;
     CU_ASSERT(memcmp(packet + offset, SERVICE_KEY2, SHA1_BLOCK_SIZE) == 0);
     offset += SHA1_BLOCK_SIZE;
+    CU_ASSERT(binary_utils_read_uint32(packet + offset) == ORIGIN.publisher_tag);
+    CU_ASSERT(binary_utils_read_uint32(packet + offset + HPB_PROTOCOL_SEQ_SIZE) == ORIGIN.publisher_seq);
+    offset += HPB_PROTOCOL_ORIGIN_SIZE;
     CU_ASSERT(memcmp(packet + offset, MSG2, MSG2_SIZE) == 0);
     free(packet);
+
+    // Retained publishes only differ by the flag in the message type byte
+    packet_size = hpb_protocol_build_retained_publish_msg(SERVICE_KEY1, ORIGIN, (char*) MSG1, MSG1_SIZE, &packet);
+    CU_ASSERT_EQUAL(packet_size, 43)
+    CU_ASSERT(packet[0] == (HLByte) (PUBLISH | HPB_PROTOCOL_FLAG_RETAIN));
+    CU_ASSERT((packet[0] & HPB_PROTOCOL_MESSAGE_TYPE_MASK) == (HLByte) PUBLISH);
+    offset = MESSAGE_TYPE_BYTE_SIZE;
+    CU_ASSERT(memcmp(packet + offset, SERVICE_KEY1, SHA1_BLOCK_SIZE) == 0);
+    offset += SHA1_BLOCK_SIZE;
+    CU_ASSERT(binary_utils_read_uint32(packet + offset) == ORIGIN.publisher_tag);
+    CU_ASSERT(binary_utils_read_uint32(packet + offset + HPB_PROTOCOL_SEQ_SIZE) == ORIGIN.publisher_seq);
+    offset += HPB_PROTOCOL_ORIGIN_SIZE;
+    CU_ASSERT(memcmp(packet + offset, MSG1, MSG1_SIZE) == 0);
+    free(packet);
+
+    // Publishes which should not be sent back to the publisher carry another flag, together with the retain flag
+    packet_size = hpb_protocol_build_no_echo_publish_msg(SERVICE_KEY2, ORIGIN, false, (char*) MSG2, MSG2_SIZE, &packet);
+    CU_ASSERT_EQUAL(packet_size, 42)
+    CU_ASSERT(packet[0] == (HLByte) (PUBLISH | HPB_PROTOCOL_FLAG_NO_ECHO));
+    CU_ASSERT(memcmp(packet + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_ORIGIN_SIZE, MSG2, MSG2_SIZE) == 0);
+    free(packet);
+    packet_size = hpb_protocol_build_no_echo_publish_msg(SERVICE_KEY2, ORIGIN, true, (char*) MSG2, MSG2_SIZE, &packet);
+    CU_ASSERT(packet[0] == (HLByte) (PUBLISH | HPB_PROTOCOL_FLAG_NO_ECHO | HPB_PROTOCOL_FLAG_RETAIN));
+    CU_ASSERT((packet[0] & HPB_PROTOCOL_MESSAGE_TYPE_MASK) == (HLByte) PUBLISH);
+    free(packet);
 }
 
 void hpb_protocol_test_build_info_msg()
@@ -96,26 +134,315 @@ void hpb_protocol_test_build_info_msg()
     HLByte SERVICE_KEY2[] = "\xf6\xcb\x6d\x9d\xb0\x98\x91\x9b\x2d\x39\x55\x11\x41\xc5\xcb\xe7\x67\xb5\x06\xd6";
     HLByte MSG2[] = "Info-HypePubSubApp";
     size_t MSG2_SIZE = 18;
+    HpbPublishOrigin ORIGIN = {0x01020304, 0xfffffffe};
 
-    packet_size = hpb_protocol_build_info_msg(SERVICE_KEY1, (char*) MSG1, MSG1_SIZE, &packet);
-    CU_ASSERT_EQUAL(packet_size, 40)
+    packet_size = hpb_protocol_build_info_msg(SERVICE_KEY1, 1, ORIGIN, (char*) MSG1, MSG1_SIZE, &packet);
+    CU_ASSERT_EQUAL(packet_size, 52)
     CU_ASSERT(packet[0] == (HLByte) INFO);
     offset = MESSAGE_TYPE_BYTE_SIZE;
     CU_ASSERT(memcmp(packet + offset, SERVICE_KEY1, SHA1_BLOCK_SIZE) == 0);
     offset += SHA1_BLOCK_SIZE;
+    CU_ASSERT(binary_utils_read_uint32(packet + offset) == 1);
+    offset += HPB_PROTOCOL_SEQ_SIZE;
+    CU_ASSERT(binary_utils_read_uint32(packet + offset) == ORIGIN.publisher_tag);
+    CU_ASSERT(binary_utils_read_uint32(packet + offset + HPB_PROTOCOL_SEQ_SIZE) == ORIGIN.publisher_seq);
+    offset += HPB_PROTOCOL_ORIGIN_SIZE;
     CU_ASSERT(memcmp(packet + offset, MSG1, MSG1_SIZE) == 0);
     free(packet);
 
-    packet_size = hpb_protocol_build_info_msg(SERVICE_KEY2, (char*) MSG2, MSG2_SIZE, &packet);
-    CU_ASSERT_EQUAL(packet_size, 39)
+    packet_size = hpb_protocol_build_info_msg(SERVICE_KEY2, 0xfffffffe, ORIGIN, (char*) MSG2, MSG2_SIZE, &packet);
+    CU_ASSERT_EQUAL(packet_size, 51)
     CU_ASSERT(packet[0] == (HLByte) INFO);
     offset = MESSAGE_TYPE_BYTE_SIZE;
     CU_ASSERT(memcmp(packet + offset, SERVICE_KEY2, SHA1_BLOCK_SIZE) == 0);
     offset += SHA1_BLOCK_SIZE;
+    CU_ASSERT(binary_utils_read_uint32(packet + offset) == 0xfffffffe);
+    offset += HPB_PROTOCOL_SEQ_SIZE;
+    CU_ASSERT(binary_utils_read_uint32(packet + offset) == ORIGIN.publisher_tag);
+    CU_ASSERT(binary_utils_read_uint32(packet + offset + HPB_PROTOCOL_SEQ_SIZE) == ORIGIN.publisher_seq);
+    offset += HPB_PROTOCOL_ORIGIN_SIZE;
     CU_ASSERT(memcmp(packet + offset, MSG2, MSG2_SIZE) == 0);
     free(packet);
 }
 
+void hpb_protocol_test_build_nack_msg()
+{
+    HLByte *packet;
+    size_t packet_size;
+    HLByte SERVICE_KEY[] = "\x05\xeb\x63\x7c\xbd\x3f\x33\x69\x1d\x74\x3c\x2a\x39\xaf\xee\xda\x5e\xc9\x45\xad";
+    HpbSeqRange ranges[HPB_PROTOCOL_NACK_MAX_RANGES + 1] = {{10, 12}, {15, 15}};
+
+    packet_size = hpb_protocol_build_nack_msg(SERVICE_KEY, ranges, 2, &packet);
+    CU_ASSERT_EQUAL(packet_size, 38)
+    CU_ASSERT(packet[0] == (HLByte) NACK);
+    CU_ASSERT(memcmp(packet + MESSAGE_TYPE_BYTE_SIZE, SERVICE_KEY, SHA1_BLOCK_SIZE) == 0);
+    CU_ASSERT(packet[MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE] == 2);
+    CU_ASSERT(binary_utils_read_uint32(packet + 22) == 10);
+    CU_ASSERT(binary_utils_read_uint32(packet + 26) == 12);
+    CU_ASSERT(binary_utils_read_uint32(packet + 30) == 15);
+    CU_ASSERT(binary_utils_read_uint32(packet + 34) == 15);
+    free(packet);
+
+    // The number of ranges is bounded
+    packet_size = hpb_protocol_build_nack_msg(SERVICE_KEY, ranges, HPB_PROTOCOL_NACK_MAX_RANGES + 1, &packet);
+    CU_ASSERT_EQUAL(packet_size, 22 + HPB_PROTOCOL_NACK_MAX_RANGES * HPB_PROTOCOL_NACK_RANGE_SIZE)
+    free(packet);
+}
+
+void hpb_protocol_test_build_handover_msg()
+{
+    HLByte *packet;
+    size_t packet_size;
+    HLByte SERVICE_KEY1[] = "\x05\xeb\x63\x7c\xbd\x3f\x33\x69\x1d\x74\x3c\x2a\x39\xaf\xee\xda\x5e\xc9\x45\xad";
+    HLByte SERVICE_KEY2[] = "\xf6\xcb\x6d\x9d\xb0\x98\x91\x9b\x2d\x39\x55\x11\x41\xc5\xcb\xe7\x67\xb5\x06\xd6";
+    HpbPublishOrigin ORIGIN = {0x01020304, 9};
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id("\x01\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+
+    HpbServiceManager *services[2];
+    services[0] = hpb_service_manager_create(SERVICE_KEY1);
+    services[0]->next_seq = 0xfffffff0;
+    hpb_service_manager_set_retained_msg(services[0], ORIGIN, "state=on", 8);
+    hpb_service_manager_add_subscriber(services[0], instance1);
+    hpb_service_manager_add_subscriber(services[0], instance2);
+    services[1] = hpb_service_manager_create(SERVICE_KEY2);
+    services[1]->next_seq = 7;
+    hpb_service_manager_add_subscriber(services[1], instance2);
+    CU_ASSERT(hpb_service_manager_set_pattern(services[1], "site1/+/temperature") == 0);
+
+    packet_size = hpb_protocol_build_handover_msg(services, 2, &packet);
+    CU_ASSERT_EQUAL(packet_size, 5 + (HPB_PROTOCOL_HANDOVER_SERVICE_HEADER_SIZE + 8 + 2 * 13) + (HPB_PROTOCOL_HANDOVER_SERVICE_HEADER_SIZE + 19 + 13))
+    CU_ASSERT(packet[0] == (HLByte) HANDOVER);
+    CU_ASSERT(binary_utils_read_uint32(packet + MESSAGE_TYPE_BYTE_SIZE) == 2);
+    CU_ASSERT(memcmp(packet + 5, SERVICE_KEY1, SHA1_BLOCK_SIZE) == 0);
+    CU_ASSERT(binary_utils_read_uint32(packet + 5 + SHA1_BLOCK_SIZE) == 0xfffffff0);
+
+    // Truncated messages are discarded, and complete ones create the services with their state
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size - 1) == HANDOVER);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEY2));
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size) == HANDOVER);
+    free(packet);
+
+    HpbServiceManager *received1 = hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEY1);
+    HpbServiceManager *received2 = hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEY2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(received1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(received2);
+    CU_ASSERT(received1->subscribers->size == 2);
+    CU_ASSERT(received1->next_seq == 0xfffffff0);
+    CU_ASSERT(received1->retained_msg_length == 8);
+    CU_ASSERT(received1->retained_origin.publisher_seq == ORIGIN.publisher_seq);
+    CU_ASSERT(received2->subscribers->size == 1);
+    CU_ASSERT(received2->next_seq == 7);
+    CU_ASSERT_PTR_NOT_NULL(hpb_list_clients_find(received2->subscribers, instance2));
+    CU_ASSERT_PTR_NULL(received1->pattern);
+    CU_ASSERT_STRING_EQUAL(received2->pattern, "site1/+/temperature");
+    CU_ASSERT_NSTRING_EQUAL(received2->placement_key, services[1]->placement_key, SHA1_BLOCK_SIZE);
+    CU_ASSERT(hpb_get()->topic_trie->n_patterns == 1);
+
+    hpb_list_service_managers_remove(hpb_get()->managed_services, SERVICE_KEY1);
+    hpb_process_unsubscribe_req(SERVICE_KEY2, instance2);
+    CU_ASSERT(hpb_get()->topic_trie->n_patterns == 0);
+
+    // Replicas share the format of the handover, but they are kept apart from the managed services
+    packet_size = hpb_protocol_build_replica_msg(services, 2, &packet);
+    CU_ASSERT(packet[0] == (HLByte) (HANDOVER | HPB_PROTOCOL_FLAG_REPLICA));
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size) == HANDOVER);
+    free(packet);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEY1));
+    HpbServiceManager *replica1 = hpb_list_service_managers_find(hpb_get()->replicas, SERVICE_KEY1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(replica1);
+    CU_ASSERT(replica1->subscribers->size == 2);
+    CU_ASSERT(replica1->next_seq == 0xfffffff0);
+    CU_ASSERT(replica1->retained_msg_length == 8);
+    CU_ASSERT(hpb_get()->replicas->size == 2);
+    CU_ASSERT_STRING_EQUAL(hpb_list_service_managers_find(hpb_get()->replicas, SERVICE_KEY2)->pattern, "site1/+/temperature");
+    hpb_list_service_managers_remove(hpb_get()->replicas, SERVICE_KEY1);
+    hpb_list_service_managers_remove(hpb_get()->replicas, SERVICE_KEY2);
+
+    hpb_service_manager_destroy(&services[0]);
+    hpb_service_manager_destroy(&services[1]);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+}
+
+void hpb_protocol_test_build_heartbeat_msg()
+{
+    HLByte *packet;
+    size_t packet_size;
+    HLByte SERVICE_KEYS[] = "\x05\xeb\x63\x7c\xbd\x3f\x33\x69\x1d\x74\x3c\x2a\x39\xaf\xee\xda\x5e\xc9\x45\xad"
+                            "\xf6\xcb\x6d\x9d\xb0\x98\x91\x9b\x2d\x39\x55\x11\x41\xc5\xcb\xe7\x67\xb5\x06\xd6";
+    HLByte KEY_FLAGS[] = {0, HPB_PROTOCOL_FLAG_WILDCARD};
+    HypeInstance *instance = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+
+    packet_size = hpb_protocol_build_heartbeat_msg(SERVICE_KEYS, NULL, 2, &packet);
+    CU_ASSERT_EQUAL(packet_size, MESSAGE_TYPE_BYTE_SIZE + HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE + 2 * SHA1_BLOCK_SIZE)
+    CU_ASSERT(packet[0] == (HLByte) HEARTBEAT);
+    CU_ASSERT(binary_utils_read_uint32(packet + MESSAGE_TYPE_BYTE_SIZE) == 2);
+    CU_ASSERT(memcmp(packet + MESSAGE_TYPE_BYTE_SIZE + HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE, SERVICE_KEYS, 2 * SHA1_BLOCK_SIZE) == 0);
+
+    // A heartbeat with a wrong count is discarded, and a valid one subscribes the unknown subscriber again
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size - 1) == HEARTBEAT);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEYS));
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == HEARTBEAT);
+    free(packet);
+
+    for(int i = 0; i < 2; i++)
+    {
+        HpbServiceManager *service = hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEYS + i * SHA1_BLOCK_SIZE);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+        CU_ASSERT_PTR_NOT_NULL(hpb_list_clients_find(service->subscribers, instance));
+        hpb_list_service_managers_remove(hpb_get()->managed_services, SERVICE_KEYS + i * SHA1_BLOCK_SIZE);
+    }
+
+    // The flags follow the keys, and an unknown wildcard subscription is not recreated from its key
+    packet_size = hpb_protocol_build_heartbeat_msg(SERVICE_KEYS, KEY_FLAGS, 2, &packet);
+    CU_ASSERT_EQUAL(packet_size, MESSAGE_TYPE_BYTE_SIZE + HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE + 2 * SHA1_BLOCK_SIZE + 2)
+    CU_ASSERT(memcmp(packet + packet_size - 2, KEY_FLAGS, 2) == 0);
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == HEARTBEAT);
+    CU_ASSERT_PTR_NOT_NULL(hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEYS));
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEYS + SHA1_BLOCK_SIZE));
+    hpb_list_service_managers_remove(hpb_get()->managed_services, SERVICE_KEYS);
+    free(packet);
+
+    // The reply of the manager carries the keys it could not renew
+    packet_size = hpb_protocol_build_unknown_heartbeat_msg(SERVICE_KEYS + SHA1_BLOCK_SIZE, 1, &packet);
+    CU_ASSERT_EQUAL(packet_size, MESSAGE_TYPE_BYTE_SIZE + HPB_PROTOCOL_HEARTBEAT_COUNT_SIZE + SHA1_BLOCK_SIZE)
+    CU_ASSERT(packet[0] == (HLByte) (HEARTBEAT | HPB_PROTOCOL_FLAG_UNKNOWN));
+    CU_ASSERT(hpb_protocol_get_message_type(packet) == HEARTBEAT);
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == HEARTBEAT);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEYS + SHA1_BLOCK_SIZE));
+    free(packet);
+
+    hype_instance_release(instance);
+}
+
+void hpb_protocol_test_build_shard_msg()
+{
+    HLByte *packet;
+    size_t packet_size;
+    HLByte SERVICE_KEY[] = "\x05\xeb\x63\x7c\xbd\x3f\x33\x69\x1d\x74\x3c\x2a\x39\xaf\xee\xda\x5e\xc9\x45\xad";
+    HpbPublishOrigin ORIGIN = {0x01020304, 9};
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id("\x01\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+
+    HpbServiceManager *shard = hpb_service_manager_create(SERVICE_KEY);
+    hpb_service_manager_add_subscriber(shard, instance1);
+    hpb_service_manager_add_subscriber(shard, instance2);
+
+    // The shards share the format of the handover, but they are kept apart from the managed services
+    packet_size = hpb_protocol_build_shard_msg(&shard, 1, &packet);
+    CU_ASSERT(packet[0] == (HLByte) SHARD);
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size) == SHARD);
+    free(packet);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEY));
+    HpbServiceManager *received = hpb_list_service_managers_find(hpb_get()->shards, SERVICE_KEY);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(received);
+    CU_ASSERT(received->subscribers->size == 2);
+
+    // Forwarded messages have the format of an info message, with the sequence number of the manager
+    packet_size = hpb_protocol_build_shard_publish_msg(SERVICE_KEY, 42, ORIGIN, "on", 2, &packet);
+    CU_ASSERT(packet[0] == (HLByte) SHARD_PUBLISH);
+    CU_ASSERT(memcmp(packet + MESSAGE_TYPE_BYTE_SIZE, SERVICE_KEY, SHA1_BLOCK_SIZE) == 0);
+    CU_ASSERT(binary_utils_read_uint32(packet + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE) == 42);
+    uint64_t n_deliveries = hpb_get()->n_shard_deliveries;
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size) == SHARD_PUBLISH);
+    CU_ASSERT(hpb_get()->n_shard_deliveries == n_deliveries + 2);
+    free(packet);
+
+    // A shard without subscribers drops the shards of the service
+    hpb_service_manager_remove_subscriber(shard, instance1);
+    hpb_service_manager_remove_subscriber(shard, instance2);
+    packet_size = hpb_protocol_build_shard_msg(&shard, 1, &packet);
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size) == SHARD);
+    free(packet);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb_get()->shards, SERVICE_KEY));
+
+    hpb_service_manager_destroy(&shard);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+}
+
+void hpb_protocol_test_build_relay_msg()
+{
+    HLByte *packet;
+    size_t packet_size;
+    HLByte SERVICE_KEY[] = "\x05\xeb\x63\x7c\xbd\x3f\x33\x69\x1d\x74\x3c\x2a\x39\xaf\xee\xda\x5e\xc9\x45\xad";
+    HpbPublishOrigin ORIGIN = {0x01020304, 9};
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id("\x01\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HpbRelayMember children[2] = {{instance1, {0}, 0}, {instance2, {0}, 0}};
+
+    packet_size = hpb_protocol_build_relay_msg(SERVICE_KEY, 42, ORIGIN, 4, children, 2, "on", 2, &packet);
+    CU_ASSERT_EQUAL(packet_size, HPB_PROTOCOL_RELAY_HEADER_SIZE + 2 * 13 + 2)
+    CU_ASSERT(packet[0] == (HLByte) RELAY);
+    CU_ASSERT(memcmp(packet + MESSAGE_TYPE_BYTE_SIZE, SERVICE_KEY, SHA1_BLOCK_SIZE) == 0);
+    CU_ASSERT(binary_utils_read_uint32(packet + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE) == 42);
+    CU_ASSERT(packet[HPB_PROTOCOL_RELAY_HEADER_SIZE - HPB_PROTOCOL_RELAY_COUNT_SIZE - 1] == 4);
+    CU_ASSERT(binary_utils_read_uint32(packet + HPB_PROTOCOL_RELAY_HEADER_SIZE - HPB_PROTOCOL_RELAY_COUNT_SIZE) == 2);
+    CU_ASSERT(memcmp(packet + packet_size - 2, "on", 2) == 0);
+
+    // Truncated subtrees are discarded, and complete ones are forwarded to a relay per subscriber
+    uint64_t n_forwards = hpb_get()->n_relay_forwards;
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, HPB_PROTOCOL_RELAY_HEADER_SIZE + 13 + 5) == RELAY);
+    CU_ASSERT(hpb_get()->n_relay_forwards == n_forwards);
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size) == RELAY);
+    CU_ASSERT(hpb_get()->n_relay_forwards == n_forwards + 2);
+    free(packet);
+
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+}
+
+void hpb_protocol_test_build_subscriber_list_msg()
+{
+    HLByte *packet;
+    size_t packet_size;
+    HLByte SERVICE_KEY[] = "\x05\xeb\x63\x7c\xbd\x3f\x33\x69\x1d\x74\x3c\x2a\x39\xaf\xee\xda\x5e\xc9\x45\xad";
+    HpbPublishOrigin ORIGIN = {0x01020304, 9};
+    size_t header_size = MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_SUBSCRIBER_LIST_VERSION_SIZE + HPB_PROTOCOL_SUBSCRIBER_LIST_COUNT_SIZE;
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id("\x01\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HpbClientsList *subscribers = hpb_list_clients_create();
+    hpb_list_clients_add(subscribers, instance1);
+    hpb_list_clients_add(subscribers, instance2);
+
+    packet_size = hpb_protocol_build_subscriber_list_req(SERVICE_KEY, &packet);
+    CU_ASSERT_EQUAL(packet_size, 21)
+    CU_ASSERT(packet[0] == (HLByte) SUBSCRIBER_LIST);
+    CU_ASSERT(memcmp(packet + MESSAGE_TYPE_BYTE_SIZE, SERVICE_KEY, SHA1_BLOCK_SIZE) == 0);
+    free(packet);
+
+    packet_size = hpb_protocol_build_subscriber_list_msg(SERVICE_KEY, 7, subscribers, &packet);
+    CU_ASSERT_EQUAL(packet_size, header_size + 2 * 13)
+    CU_ASSERT(packet[0] == (HLByte) SUBSCRIBER_LIST);
+    CU_ASSERT(binary_utils_read_uint32(packet + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE) == 7);
+    CU_ASSERT(binary_utils_read_uint32(packet + header_size - HPB_PROTOCOL_SUBSCRIBER_LIST_COUNT_SIZE) == 2);
+    CU_ASSERT(packet[header_size] == 12);
+    CU_ASSERT(memcmp(packet + header_size + 1, instance1->identifier->data, 12) == 0);
+
+    // Truncated lists are discarded, and lists of services not published directly are ignored
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size - 1) == SUBSCRIBER_LIST);
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size) == SUBSCRIBER_LIST);
+    free(packet);
+
+    packet_size = hpb_protocol_build_subscriber_list_msg(SERVICE_KEY, 8, NULL, &packet);
+    CU_ASSERT_EQUAL(packet_size, header_size)
+    CU_ASSERT(binary_utils_read_uint32(packet + header_size - HPB_PROTOCOL_SUBSCRIBER_LIST_COUNT_SIZE) == HPB_PROTOCOL_SUBSCRIBER_LIST_REFUSED);
+    free(packet);
+
+    // Direct info messages have the format of publish messages, with the info type
+    packet_size = hpb_protocol_build_direct_info_msg(SERVICE_KEY, ORIGIN, "on", 2, &packet);
+    CU_ASSERT_EQUAL(packet_size, MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_ORIGIN_SIZE + 2)
+    CU_ASSERT(packet[0] == (HLByte) (INFO | HPB_PROTOCOL_FLAG_DIRECT));
+    CU_ASSERT(binary_utils_read_uint32(packet + MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE) == 0x01020304);
+    CU_ASSERT(memcmp(packet + packet_size - 2, "on", 2) == 0);
+    CU_ASSERT(hpb_protocol_receive_msg(instance1, packet, packet_size) == INFO);
+    free(packet);
+
+    hpb_list_clients_destroy(&subscribers);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+}
 
 void hpb_protocol_test_receiving_msg()
 {
@@ -124,6 +451,7 @@ void hpb_protocol_test_receiving_msg()
     HLByte SERVICE_KEY[] = "\x9a\xc1\xb0\x41\x5e\x0a\x97\x73\x8c\x57\xe7\xe6\x3f\x68\x50\xab\x21\xe4\x7e\xb4";
     HLByte MSG[] = "HelloHypeWorld";
     size_t MSG_SIZE = 14;
+    HpbPublishOrigin ORIGIN = {0x01020304, 1};
     HypeInstance *instance = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
 
     packet_size = hpb_protocol_build_subscribe_msg(SERVICE_KEY, &packet);
@@ -134,13 +462,67 @@ void hpb_protocol_test_receiving_msg()
     CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == UNSUBSCRIBE_SERVICE);
     free(packet);
 
-    packet_size = hpb_protocol_build_publish_msg(SERVICE_KEY, (char*) MSG, MSG_SIZE, &packet);
+    packet_size = hpb_protocol_build_publish_msg(SERVICE_KEY, ORIGIN, (char*) MSG, MSG_SIZE, &packet);
     CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == PUBLISH);
     free(packet);
 
-    packet_size = hpb_protocol_build_info_msg(SERVICE_KEY, (char *) MSG, MSG_SIZE, &packet);
+    packet_size = hpb_protocol_build_info_msg(SERVICE_KEY, 1, ORIGIN, (char *) MSG, MSG_SIZE, &packet);
     CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == INFO);
     free(packet);
 
+    HpbSeqRange range = {1, 1};
+    packet_size = hpb_protocol_build_nack_msg(SERVICE_KEY, &range, 1, &packet);
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == NACK);
+    free(packet);
+
+    packet_size = hpb_protocol_build_retained_publish_msg(SERVICE_KEY, ORIGIN, (char*) MSG, MSG_SIZE, &packet);
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == PUBLISH);
+    free(packet);
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb_get()->managed_services, SERVICE_KEY);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT(service->retained_msg_length == MSG_SIZE);
+
+    // Wildcard subscriptions carry their pattern, and the publishes to their topics the topic
+    char *pattern = "site1/+/temperature";
+    HLByte pattern_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) pattern, strlen(pattern), pattern_key);
+    packet_size = hpb_protocol_build_pattern_subscribe_msg(pattern_key, pattern, &packet);
+    CU_ASSERT(packet[0] == (HLByte) (SUBSCRIBE_SERVICE | HPB_PROTOCOL_FLAG_WILDCARD));
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == SUBSCRIBE_SERVICE);
+    free(packet);
+    service = hpb_list_service_managers_find(hpb_get()->managed_services, pattern_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT_STRING_EQUAL(service->pattern, pattern);
+
+    char *payload;
+    size_t payload_length = hpb_topic_build_payload("site1/room1/temperature", 23, (char *) MSG, MSG_SIZE, &payload);
+    uint32_t next_seq = service->next_seq;
+    packet_size = hpb_protocol_build_pattern_publish_msg(service->placement_key, ORIGIN, payload, payload_length, &packet);
+    CU_ASSERT(packet[0] == (HLByte) (PUBLISH | HPB_PROTOCOL_FLAG_WILDCARD));
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == PUBLISH);
+    CU_ASSERT(service->next_seq == next_seq + 1);
+    free(packet);
+    free(payload);
+    hpb_process_unsubscribe_req(pattern_key, instance);
+
+    // Filtered subscriptions carry their filter before the pattern, and subscribing again without it clears it
+    packet_size = hpb_protocol_build_filtered_subscribe_msg(pattern_key, pattern, "$topic ~ room1", &packet);
+    CU_ASSERT(packet[0] == (HLByte) (SUBSCRIBE_SERVICE | HPB_PROTOCOL_FLAG_WILDCARD | HPB_PROTOCOL_FLAG_FILTER));
+    CU_ASSERT_EQUAL(packet_size, MESSAGE_TYPE_BYTE_SIZE + SHA1_BLOCK_SIZE + HPB_PROTOCOL_FILTER_LENGTH_SIZE + 14 + 19);
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == SUBSCRIBE_SERVICE);
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size - 19 - 1) == SUBSCRIBE_SERVICE); // Truncated filter
+    free(packet);
+    service = hpb_list_service_managers_find(hpb_get()->managed_services, pattern_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT_STRING_EQUAL(service->pattern, pattern);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(hpb_list_clients_find(service->subscribers, instance)->filter);
+    CU_ASSERT_STRING_EQUAL(hpb_list_clients_find(service->subscribers, instance)->filter->expression, "$topic~room1");
+    packet_size = hpb_protocol_build_pattern_subscribe_msg(pattern_key, pattern, &packet);
+    CU_ASSERT(hpb_protocol_receive_msg(instance, packet, packet_size) == SUBSCRIBE_SERVICE);
+    free(packet);
+    CU_ASSERT_PTR_NULL(hpb_list_clients_find(service->subscribers, instance)->filter);
+    CU_ASSERT(service->filters->size == 0);
+    hpb_process_unsubscribe_req(pattern_key, instance);
+
     hype_instance_release(instance);
 }
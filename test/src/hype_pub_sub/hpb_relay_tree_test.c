@@ -0,0 +1,61 @@
+#include "hpb_relay_tree_test.h"
+
+#define HPB_RELAY_TREE_TEST_N_MEMBERS 10
+
+void hpb_relay_tree_test()
+{
+    hpb_relay_tree_test_split();
+    hpb_relay_tree_test_depth();
+}
+
+void hpb_relay_tree_test_split()
+{
+    HpbRelayMember members[HPB_RELAY_TREE_TEST_N_MEMBERS];
+    HpbRelayBranch branches[HPB_RELAY_TREE_MAX_BRANCHING];
+    uint32_t link_costs[HPB_RELAY_TREE_TEST_N_MEMBERS] = {50, 40, 30, 20, 10, 5, 60, 70, 80, 90};
+
+    // The members are added in reverse key order
+    for(int i = 0; i < HPB_RELAY_TREE_TEST_N_MEMBERS; i++)
+    {
+        memset(members[i].key, 0, SHA1_BLOCK_SIZE);
+        members[i].key[0] = (HLByte) (HPB_RELAY_TREE_TEST_N_MEMBERS - 1 - i);
+        members[i].instance = NULL;
+        members[i].link_cost_ms = link_costs[HPB_RELAY_TREE_TEST_N_MEMBERS - 1 - i];
+    }
+    hpb_relay_tree_sort(members, HPB_RELAY_TREE_TEST_N_MEMBERS);
+    for(int i = 0; i < HPB_RELAY_TREE_TEST_N_MEMBERS; i++) {
+        CU_ASSERT(members[i].key[0] == i);
+    }
+
+    // Ranges of 4, 3 and 3 members, led by their cheapest link, cover all the members
+    CU_ASSERT(hpb_relay_tree_split(members, HPB_RELAY_TREE_TEST_N_MEMBERS, 3, branches) == 3);
+    CU_ASSERT(branches[0].relay->key[0] == 3);
+    CU_ASSERT(branches[0].n_children == 3);
+    CU_ASSERT(branches[0].children[0].key[0] == 0);
+    CU_ASSERT(branches[0].children[2].key[0] == 2);
+    CU_ASSERT(branches[1].relay->key[0] == 5);
+    CU_ASSERT(branches[1].n_children == 2);
+    CU_ASSERT(branches[1].children[0].key[0] == 4);
+    CU_ASSERT(branches[1].children[1].key[0] == 6);
+    CU_ASSERT(branches[2].relay->key[0] == 7);
+    CU_ASSERT(branches[2].n_children == 2);
+
+    // Fewer members than branches are all relays without children
+    CU_ASSERT(hpb_relay_tree_split(members, 2, 4, branches) == 2);
+    CU_ASSERT(branches[0].n_children == 0);
+    CU_ASSERT(branches[1].n_children == 0);
+    CU_ASSERT(hpb_relay_tree_split(members, HPB_RELAY_TREE_TEST_N_MEMBERS, 0, branches) == 0);
+    CU_ASSERT(hpb_relay_tree_split(members, 0, 4, branches) == 0);
+    CU_ASSERT(hpb_relay_tree_split(members, HPB_RELAY_TREE_TEST_N_MEMBERS, HPB_RELAY_TREE_MAX_BRANCHING + 1, branches) == HPB_RELAY_TREE_TEST_N_MEMBERS);
+}
+
+void hpb_relay_tree_test_depth()
+{
+    CU_ASSERT(hpb_relay_tree_get_depth(0, 4) == 0);
+    CU_ASSERT(hpb_relay_tree_get_depth(4, 4) == 1);
+    CU_ASSERT(hpb_relay_tree_get_depth(5, 4) == 2);
+    CU_ASSERT(hpb_relay_tree_get_depth(20, 4) == 2);
+    CU_ASSERT(hpb_relay_tree_get_depth(21, 4) == 3);
+    CU_ASSERT(hpb_relay_tree_get_depth(1000, 4) == 5);
+    CU_ASSERT(hpb_relay_tree_get_depth(3, 1) == 3);
+}
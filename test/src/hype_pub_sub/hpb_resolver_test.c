@@ -0,0 +1,98 @@
+#include "hpb_resolver_test.h"
+#include "hpb_test_utils.h"
+
+static void hpb_resolver_test_resolve(HypeInstance *instance, void *arg)
+{
+    HypeInstance **last_resolved = (HypeInstance **) arg;
+    (*last_resolved) = instance;
+}
+
+void hpb_resolver_test()
+{
+    hpb_resolver_test_limit();
+    hpb_resolver_test_priority();
+}
+
+void hpb_resolver_test_limit()
+{
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id("\x01\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *instance3 = hpb_test_utils_get_instance_from_id("\x02\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *last_resolved = NULL;
+
+    HpbResolver *resolver = hpb_resolver_create(2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(resolver);
+    CU_ASSERT(hpb_resolver_add(resolver, instance1, 1000));
+    CU_ASSERT_FALSE(hpb_resolver_add(resolver, instance1, 1000));
+    CU_ASSERT(hpb_resolver_add(resolver, instance2, 1000));
+    CU_ASSERT(hpb_resolver_add(resolver, instance3, 1000));
+    CU_ASSERT(resolver->max_pending == 3);
+
+    // Only two handshakes run at the same time, in the order in which the instances were found
+    CU_ASSERT(hpb_resolver_dispatch(resolver, NULL, 0, 1100, hpb_resolver_test_resolve, &last_resolved) == 2);
+    CU_ASSERT(memcmp(last_resolved->identifier->data, instance2->identifier->data, 12) == 0);
+    CU_ASSERT(resolver->pending->size == 1 && resolver->in_flight->size == 2);
+    CU_ASSERT(hpb_resolver_dispatch(resolver, NULL, 0, 1100, hpb_resolver_test_resolve, &last_resolved) == 0);
+    CU_ASSERT_FALSE(hpb_resolver_add(resolver, instance2, 1100));
+    CU_ASSERT(resolver->wait_max_ms == 100);
+
+    // A handshake which ends frees its slot for the next instance
+    CU_ASSERT(hpb_resolver_complete(resolver, instance1, true, 1400));
+    CU_ASSERT_FALSE(hpb_resolver_complete(resolver, instance1, true, 1400));
+    CU_ASSERT(resolver->n_resolved == 1 && resolver->handshake_max_ms == 300);
+    CU_ASSERT(hpb_resolver_dispatch(resolver, NULL, 0, 1500, hpb_resolver_test_resolve, &last_resolved) == 1);
+    CU_ASSERT(memcmp(last_resolved->identifier->data, instance3->identifier->data, 12) == 0);
+    CU_ASSERT(resolver->wait_max_ms == 500);
+
+    // Lost instances and handshakes not reported by the SDK free their slots as well
+    CU_ASSERT(hpb_resolver_remove(resolver, instance2));
+    CU_ASSERT(resolver->n_failed == 1);
+    CU_ASSERT(hpb_resolver_dispatch(resolver, NULL, 0, 1500 + HPB_RESOLVER_TIMEOUT_MS, hpb_resolver_test_resolve, &last_resolved) == 0);
+    CU_ASSERT(resolver->n_timeouts == 1);
+    CU_ASSERT(resolver->in_flight->size == 0);
+    CU_ASSERT_FALSE(hpb_resolver_remove(resolver, instance3));
+
+    CU_ASSERT(hpb_resolver_set_max_in_flight(resolver, 0) == -1);
+    CU_ASSERT(hpb_resolver_set_max_in_flight(resolver, HPB_RESOLVER_MAX_IN_FLIGHT + 1) == -1);
+    CU_ASSERT(hpb_resolver_set_max_in_flight(resolver, 1) == 0);
+
+    hpb_resolver_destroy(&resolver);
+    CU_ASSERT_PTR_NULL(resolver);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+    hype_instance_release(instance3);
+}
+
+void hpb_resolver_test_priority()
+{
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id("\x85\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id("\x01\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *instance3 = hpb_test_utils_get_instance_from_id("\x02\xa9\xd4\xc4\xde\xd2\x87\x75\x0f\xc0\xed\x32", 12);
+    HypeInstance *last_resolved = NULL;
+
+    HpbResolver *resolver = hpb_resolver_create(1);
+    hpb_resolver_add(resolver, instance1, 0);
+    hpb_resolver_add(resolver, instance2, 0);
+    hpb_resolver_add(resolver, instance3, 0);
+
+    // The instances closest to the keys of interest are resolved first, whatever the order in which they were found
+    HLByte keys[2 * SHA1_BLOCK_SIZE];
+    sha1_digest(instance3->identifier->data, instance3->identifier->size, keys);
+    sha1_digest(instance2->identifier->data, instance2->identifier->size, keys + SHA1_BLOCK_SIZE);
+    keys[SHA1_BLOCK_SIZE + SHA1_BLOCK_SIZE - 1] ^= 0x01;
+
+    CU_ASSERT(hpb_resolver_dispatch(resolver, keys, 2, 10, hpb_resolver_test_resolve, &last_resolved) == 1);
+    CU_ASSERT(memcmp(last_resolved->identifier->data, instance3->identifier->data, 12) == 0);
+    hpb_resolver_complete(resolver, instance3, true, 20);
+    CU_ASSERT(hpb_resolver_dispatch(resolver, keys, 2, 20, hpb_resolver_test_resolve, &last_resolved) == 1);
+    CU_ASSERT(memcmp(last_resolved->identifier->data, instance2->identifier->data, 12) == 0);
+    hpb_resolver_complete(resolver, instance2, false, 30);
+    CU_ASSERT(hpb_resolver_dispatch(resolver, keys, 2, 30, hpb_resolver_test_resolve, &last_resolved) == 1);
+    CU_ASSERT(memcmp(last_resolved->identifier->data, instance1->identifier->data, 12) == 0);
+    CU_ASSERT(resolver->pending->size == 0);
+
+    hpb_resolver_destroy(&resolver);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+    hype_instance_release(instance3);
+}
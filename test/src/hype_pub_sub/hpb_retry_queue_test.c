@@ -0,0 +1,201 @@
+
+#include "hpb_retry_queue_test.h"
+#include "hpb_test_utils.h"
+
+static uint64_t next_message_id = 1000;
+static size_t n_sent = 0;
+static HLByte sent_types[16];
+static size_t n_completed = 0;
+static size_t n_succeeded = 0;
+
+static uint64_t test_send(HLByte *packet, size_t packet_size, HypeInstance *destination, void *arg);
+static void test_completion(HpbRetryEntry *entry, bool success, void *arg);
+static uint64_t test_send_reporting(HLByte *packet, size_t packet_size, HypeInstance *destination, void *arg);
+
+void hpb_retry_queue_test()
+{
+    hpb_retry_queue_test_backoff();
+    hpb_retry_queue_test_deadline();
+    hpb_retry_queue_test_eviction();
+    hpb_retry_queue_test_reentrant_send();
+}
+
+void hpb_retry_queue_test_backoff()
+{
+    HLByte id[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0x01};
+    HypeInstance *destination = hpb_test_utils_get_instance_from_id(id, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HpbRetryQueue *queue = hpb_retry_queue_create(HPB_RETRY_QUEUE_MAX_ENTRIES, HPB_RETRY_QUEUE_MAX_BYTES, 1234);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(queue);
+
+    HLByte data_bytes[] = {'d', 'a', 't', 'a'};
+    HLByte control_bytes[] = {'c', 't', 'r', 'l'};
+    HpbRetryPacket *data = hpb_retry_queue_packet_create(queue, data_bytes, 4);
+    HpbRetryPacket *control = hpb_retry_queue_packet_create(queue, control_bytes, 4);
+    CU_ASSERT(queue->n_bytes == 0); // Only the packets tracked are accounted
+
+    CU_ASSERT(hpb_retry_queue_track(queue, 1, data, destination, HPB_RETRY_PRIORITY_DATA, 0) == 0);
+    CU_ASSERT(hpb_retry_queue_track(queue, 2, control, destination, HPB_RETRY_PRIORITY_CONTROL, 0) == 0);
+    hpb_retry_queue_packet_release(queue, data);
+    hpb_retry_queue_packet_release(queue, control);
+    CU_ASSERT(queue->n_bytes == 8); // The packets are still referenced by the entries
+
+    // Nothing is resent before a failure is reported
+    n_sent = 0;
+    CU_ASSERT(hpb_retry_queue_process(queue, 10, test_send, NULL, test_completion, NULL) == 0);
+    CU_ASSERT(hpb_retry_queue_failed(queue, 3, 10) == -1);
+    CU_ASSERT(hpb_retry_queue_failed(queue, 1, 10) == 0);
+    CU_ASSERT(hpb_retry_queue_failed(queue, 2, 10) == 0);
+
+    // The first retry is done between half and the whole initial backoff
+    CU_ASSERT(hpb_retry_queue_process(queue, 10 + HPB_RETRY_INITIAL_BACKOFF_MS / 2 - 1, test_send, NULL, test_completion, NULL) == 0);
+    CU_ASSERT(hpb_retry_queue_process(queue, 10 + HPB_RETRY_INITIAL_BACKOFF_MS, test_send, NULL, test_completion, NULL) == 2);
+    CU_ASSERT(n_sent == 2);
+    CU_ASSERT(sent_types[0] == 'c'); // Control messages are retried first
+    CU_ASSERT(sent_types[1] == 'd');
+    CU_ASSERT(queue->n_retries == 2);
+
+    // The entries are now tracked with the identifiers of the new attempts
+    CU_ASSERT(hpb_retry_queue_failed(queue, 1, 200) == -1);
+    n_completed = 0;
+    n_succeeded = 0;
+    CU_ASSERT(hpb_retry_queue_delivered(queue, next_message_id - 1, test_completion, NULL) == 0);
+    CU_ASSERT(hpb_retry_queue_delivered(queue, next_message_id - 2, test_completion, NULL) == 0);
+    CU_ASSERT(hpb_retry_queue_delivered(queue, next_message_id - 2, test_completion, NULL) == -1);
+    CU_ASSERT(n_completed == 2);
+    CU_ASSERT(n_succeeded == 2);
+    CU_ASSERT(queue->n_entries == 0);
+    CU_ASSERT(queue->n_bytes == 0);
+
+    hpb_retry_queue_destroy(&queue);
+    CU_ASSERT_PTR_NULL(queue);
+    hype_instance_release(destination);
+}
+
+void hpb_retry_queue_test_deadline()
+{
+    HLByte id[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0x02};
+    HypeInstance *destination = hpb_test_utils_get_instance_from_id(id, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HpbRetryQueue *queue = hpb_retry_queue_create(HPB_RETRY_QUEUE_MAX_ENTRIES, HPB_RETRY_QUEUE_MAX_BYTES, 0);
+
+    HLByte bytes[] = {'d', 'a', 't', 'a'};
+    HpbRetryPacket *packet = hpb_retry_queue_packet_create(queue, bytes, 4);
+    CU_ASSERT(hpb_retry_queue_track(queue, 1, packet, destination, HPB_RETRY_PRIORITY_DATA, 0) == 0);
+    hpb_retry_queue_packet_release(queue, packet);
+
+    // Keep failing until the deadline. The backoff never exceeds its maximum.
+    uint64_t now_ms = 0;
+    uint64_t message_id = 1;
+    n_sent = 0;
+    n_completed = 0;
+    n_succeeded = 0;
+    while(now_ms < HPB_RETRY_DEADLINE_MS)
+    {
+        CU_ASSERT(hpb_retry_queue_failed(queue, message_id, now_ms) == 0);
+        HpbRetryEntry *entry = queue->head;
+        CU_ASSERT(entry->next_attempt_ms - now_ms <= HPB_RETRY_MAX_BACKOFF_MS);
+        now_ms = entry->next_attempt_ms;
+        hpb_retry_queue_process(queue, now_ms, test_send, NULL, test_completion, NULL);
+        if(queue->n_entries == 0) {
+            break;
+        }
+        message_id = next_message_id - 1;
+    }
+
+    CU_ASSERT(n_sent > 5);
+    hpb_retry_queue_process(queue, HPB_RETRY_DEADLINE_MS, test_send, NULL, test_completion, NULL);
+    CU_ASSERT(n_completed == 1); // Expired entries are reported as failed
+    CU_ASSERT(n_succeeded == 0);
+    CU_ASSERT(queue->n_entries == 0);
+    CU_ASSERT(queue->n_expired == 1);
+    CU_ASSERT(queue->n_bytes == 0);
+
+    hpb_retry_queue_destroy(&queue);
+    hype_instance_release(destination);
+}
+
+void hpb_retry_queue_test_eviction()
+{
+    HLByte id[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0x03};
+    HypeInstance *destination = hpb_test_utils_get_instance_from_id(id, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HpbRetryQueue *queue = hpb_retry_queue_create(2, HPB_RETRY_QUEUE_MAX_BYTES, 7);
+
+    HLByte bytes[] = {'x'};
+    HpbRetryPacket *packet = hpb_retry_queue_packet_create(queue, bytes, 1);
+
+    CU_ASSERT(hpb_retry_queue_track(queue, 1, packet, destination, HPB_RETRY_PRIORITY_DATA, 0) == 0);
+    CU_ASSERT(hpb_retry_queue_track(queue, 2, packet, destination, HPB_RETRY_PRIORITY_CONTROL, 0) == 0);
+    CU_ASSERT(packet->ref_count == 3);
+
+    // The oldest data entry is evicted first
+    CU_ASSERT(hpb_retry_queue_track(queue, 3, packet, destination, HPB_RETRY_PRIORITY_CONTROL, 0) == 0);
+    CU_ASSERT(queue->n_evicted == 1);
+    CU_ASSERT(hpb_retry_queue_failed(queue, 1, 0) == -1);
+
+    // Data entries are refused when only control entries remain, control entries replace the oldest one
+    CU_ASSERT(hpb_retry_queue_track(queue, 4, packet, destination, HPB_RETRY_PRIORITY_DATA, 0) == -1);
+    CU_ASSERT(hpb_retry_queue_track(queue, 5, packet, destination, HPB_RETRY_PRIORITY_CONTROL, 0) == 0);
+    CU_ASSERT(hpb_retry_queue_failed(queue, 2, 0) == -1);
+    CU_ASSERT(hpb_retry_queue_failed(queue, 3, 0) == 0);
+    CU_ASSERT(queue->n_entries == 2);
+    CU_ASSERT(queue->n_evicted == 3);
+
+    hpb_retry_queue_packet_release(queue, packet);
+    CU_ASSERT(queue->n_bytes == 1);
+    hpb_retry_queue_destroy(&queue);
+    hype_instance_release(destination);
+}
+
+void hpb_retry_queue_test_reentrant_send()
+{
+    HLByte id[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0x04};
+    HypeInstance *destination = hpb_test_utils_get_instance_from_id(id, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HpbRetryQueue *queue = hpb_retry_queue_create(HPB_RETRY_QUEUE_MAX_ENTRIES, 4, 3);
+
+    // A packet which is not tracked, such as one being fanned out, does not evict the tracked ones
+    HLByte bytes[] = {'d', 'a', 't', 'a'};
+    HpbRetryPacket *untracked = hpb_retry_queue_packet_create(queue, bytes, 4);
+    HpbRetryPacket *packet = hpb_retry_queue_packet_create(queue, bytes, 4);
+    CU_ASSERT(hpb_retry_queue_track(queue, 1, packet, destination, HPB_RETRY_PRIORITY_DATA, 0) == 0);
+    CU_ASSERT(hpb_retry_queue_track(queue, 2, packet, destination, HPB_RETRY_PRIORITY_DATA, 0) == 0);
+    CU_ASSERT(queue->n_bytes == 4);
+    CU_ASSERT(queue->n_evicted == 0);
+    hpb_retry_queue_packet_release(queue, untracked);
+    hpb_retry_queue_packet_release(queue, packet);
+
+    // A transport which reports the result of a resend before returning does not deadlock the queue
+    CU_ASSERT(hpb_retry_queue_failed(queue, 1, 0) == 0);
+    n_sent = 0;
+    CU_ASSERT(hpb_retry_queue_process(queue, HPB_RETRY_INITIAL_BACKOFF_MS, test_send_reporting, queue, test_completion, NULL) == 1);
+    CU_ASSERT(n_sent == 1);
+    CU_ASSERT(queue->n_entries == 1);
+    CU_ASSERT(hpb_retry_queue_delivered(queue, next_message_id - 1, test_completion, NULL) == 0);
+    CU_ASSERT(queue->n_entries == 0);
+    CU_ASSERT(queue->n_bytes == 0);
+
+    hpb_retry_queue_destroy(&queue);
+    hype_instance_release(destination);
+}
+
+static uint64_t test_send(HLByte *packet, size_t packet_size, HypeInstance *destination, void *arg)
+{
+    if(n_sent < sizeof(sent_types)) {
+        sent_types[n_sent] = packet[0];
+    }
+    n_sent++;
+    return next_message_id++;
+}
+
+static uint64_t test_send_reporting(HLByte *packet, size_t packet_size, HypeInstance *destination, void *arg)
+{
+    // The entry of message 2 is delivered from within the send, as a synchronous transport would report it
+    hpb_retry_queue_delivered((HpbRetryQueue *) arg, 2, test_completion, NULL);
+    return test_send(packet, packet_size, destination, arg);
+}
+
+static void test_completion(HpbRetryEntry *entry, bool success, void *arg)
+{
+    n_completed++;
+    if(success) {
+        n_succeeded++;
+    }
+}
@@ -0,0 +1,69 @@
+
+#include "hpb_seq_window_test.h"
+
+void hpb_seq_window_test()
+{
+    hpb_seq_window_test_receive();
+    hpb_seq_window_test_missing();
+}
+
+void hpb_seq_window_test_receive()
+{
+    HpbSeqWindow window;
+    hpb_seq_window_reset(&window);
+
+    CU_ASSERT(hpb_seq_window_receive(&window, 100) == HPB_SEQ_NEW);
+    CU_ASSERT(hpb_seq_window_receive(&window, 100) == HPB_SEQ_DUPLICATE);
+    CU_ASSERT(hpb_seq_window_receive(&window, 99) == HPB_SEQ_DUPLICATE); // Sent before the first message received
+    CU_ASSERT(hpb_seq_window_receive(&window, 102) == HPB_SEQ_NEW);
+    CU_ASSERT(hpb_seq_window_receive(&window, 101) == HPB_SEQ_NEW);
+    CU_ASSERT(hpb_seq_window_receive(&window, 101) == HPB_SEQ_DUPLICATE);
+    CU_ASSERT(window.highest == 102);
+
+    CU_ASSERT(hpb_seq_window_receive(&window, 102 + HPB_SEQ_WINDOW_SIZE) == HPB_SEQ_NEW);
+    CU_ASSERT(hpb_seq_window_receive(&window, 102) == HPB_SEQ_TOO_OLD);
+
+    // Sequence numbers wrap around
+    hpb_seq_window_reset(&window);
+    CU_ASSERT(hpb_seq_window_receive(&window, UINT32_MAX) == HPB_SEQ_NEW);
+    CU_ASSERT(hpb_seq_window_receive(&window, 0) == HPB_SEQ_NEW);
+    CU_ASSERT(hpb_seq_window_receive(&window, UINT32_MAX) == HPB_SEQ_DUPLICATE);
+    CU_ASSERT(window.highest == 0);
+
+    // A far away sequence number means that the sender started a new sequence
+    CU_ASSERT(hpb_seq_window_receive(&window, 5000) == HPB_SEQ_RESET);
+    CU_ASSERT(window.highest == 5000);
+    CU_ASSERT(hpb_seq_window_receive(&window, 10) == HPB_SEQ_RESET);
+    CU_ASSERT(window.highest == 10);
+}
+
+void hpb_seq_window_test_missing()
+{
+    HpbSeqWindow window;
+    HpbSeqRange ranges[4];
+    hpb_seq_window_reset(&window);
+
+    CU_ASSERT(hpb_seq_window_get_missing(&window, ranges, 4) == 0);
+    CU_ASSERT(hpb_seq_window_count_missing(&window) == 0);
+    hpb_seq_window_receive(&window, 10);
+    CU_ASSERT(hpb_seq_window_get_missing(&window, ranges, 4) == 0);
+    CU_ASSERT(hpb_seq_window_count_missing(&window) == 0);
+
+    hpb_seq_window_receive(&window, 13);
+    hpb_seq_window_receive(&window, 15);
+    hpb_seq_window_receive(&window, 20);
+    CU_ASSERT(hpb_seq_window_get_missing(&window, ranges, 4) == 3);
+    CU_ASSERT(ranges[0].first == 11 && ranges[0].last == 12);
+    CU_ASSERT(ranges[1].first == 14 && ranges[1].last == 14);
+    CU_ASSERT(ranges[2].first == 16 && ranges[2].last == 19);
+    CU_ASSERT(hpb_seq_window_get_missing(&window, ranges, 2) == 2);
+    CU_ASSERT(hpb_seq_window_count_missing(&window) == 7);
+
+    hpb_seq_window_receive(&window, 14);
+    CU_ASSERT(hpb_seq_window_get_missing(&window, ranges, 4) == 2);
+
+    hpb_seq_window_skip_missing(&window);
+    CU_ASSERT(hpb_seq_window_get_missing(&window, ranges, 4) == 0);
+    CU_ASSERT(hpb_seq_window_count_missing(&window) == 0);
+    CU_ASSERT(hpb_seq_window_receive(&window, 16) == HPB_SEQ_DUPLICATE);
+}
@@ -43,6 +43,20 @@ void hpb_service_manager_test()
     CU_ASSERT_FATAL(serv1->subscribers->size == 0);
     CU_ASSERT_PTR_NULL(serv1->subscribers->head);
 
+    // Test set_retained_msg
+    HpbPublishOrigin origin = {0x01020304, 7};
+    CU_ASSERT_PTR_NULL(serv2->retained_msg);
+    CU_ASSERT(hpb_service_manager_set_retained_msg(serv2, origin, "state=on", 8) == 0);
+    CU_ASSERT(serv2->retained_msg_length == 8);
+    CU_ASSERT_NSTRING_EQUAL(serv2->retained_msg, "state=on", 8);
+    CU_ASSERT(hpb_service_manager_set_retained_msg(serv2, origin, "state=off", 9) == 0);
+    CU_ASSERT(serv2->retained_msg_length == 9);
+    CU_ASSERT_NSTRING_EQUAL(serv2->retained_msg, "state=off", 9);
+    CU_ASSERT(serv2->retained_origin.publisher_seq == origin.publisher_seq);
+    CU_ASSERT(hpb_service_manager_set_retained_msg(serv1, origin, NULL, 0) == 0);
+    CU_ASSERT_PTR_NULL(serv1->retained_msg);
+    CU_ASSERT(hpb_service_manager_set_retained_msg(NULL, origin, "state=on", 8) == -1);
+
     hpb_service_manager_destroy(&serv1);
     hpb_service_manager_destroy(&serv2);
     CU_ASSERT_PTR_NULL(serv1);
@@ -0,0 +1,60 @@
+
+#include "hpb_sim_scenario_test.h"
+
+static HpbSimScenario test_get_scenario(uint64_t seed);
+
+void hpb_sim_scenario_test()
+{
+    hpb_sim_scenario_test_invalid();
+    hpb_sim_scenario_test_reproducible();
+}
+
+void hpb_sim_scenario_test_invalid()
+{
+    HpbSimReport report;
+    HpbSimScenario scenario = test_get_scenario(1);
+    scenario.subscriptions_per_node = scenario.n_topics + 1;
+    CU_ASSERT(hpb_sim_scenario_run(&scenario, &report) == -1);
+
+    scenario = test_get_scenario(1);
+    scenario.n_nodes = 0;
+    CU_ASSERT(hpb_sim_scenario_run(&scenario, &report) == -1);
+}
+
+void hpb_sim_scenario_test_reproducible()
+{
+    HypePubSub *previous = hpb_get();
+    HpbSimReport report1;
+    HpbSimReport report2;
+    HpbSimReport report3;
+
+    HpbSimScenario scenario = test_get_scenario(7);
+    CU_ASSERT_FATAL(hpb_sim_scenario_run(&scenario, &report1) == 0);
+    CU_ASSERT(report1.n_joins == 2);
+    CU_ASSERT(report1.n_leaves == 2);
+    CU_ASSERT(report1.n_instance_events > 0);
+    CU_ASSERT(report1.n_published > 0);
+    CU_ASSERT(report1.n_expected > 0);
+    CU_ASSERT(report1.n_received <= report1.n_expected);
+
+    // The same seed gives the same run, and another seed a different one
+    CU_ASSERT_FATAL(hpb_sim_scenario_run(&scenario, &report2) == 0);
+    CU_ASSERT(report1.trace_hash == report2.trace_hash);
+    CU_ASSERT(report1.storm_msgs == report2.storm_msgs);
+    CU_ASSERT(report1.quiet_bytes == report2.quiet_bytes);
+    CU_ASSERT(report1.n_received == report2.n_received);
+    CU_ASSERT(memcmp(report1.n_sent_by_type, report2.n_sent_by_type, sizeof(report1.n_sent_by_type)) == 0);
+
+    scenario.seed = 8;
+    CU_ASSERT_FATAL(hpb_sim_scenario_run(&scenario, &report3) == 0);
+    CU_ASSERT(report1.trace_hash != report3.trace_hash);
+
+    hpb_set_current(previous);
+}
+
+static HpbSimScenario test_get_scenario(uint64_t seed)
+{
+    HpbSimLink link = {5000, 2000, 0, 0.01};
+    HpbSimScenario scenario = {"test", link, seed, 10, 5, 2, 100000, 1, 2, 2, 1000000, 8000000};
+    return scenario;
+}
@@ -0,0 +1,86 @@
+
+#include "hpb_sim_test.h"
+
+static int n_received = 0;
+static char received_msg[32];
+
+static void test_on_message_received(char *service_name, char *msg, size_t msg_length);
+
+void hpb_sim_test()
+{
+    hpb_sim_test_nodes();
+    hpb_sim_test_publish();
+}
+
+void hpb_sim_test_nodes()
+{
+    HypePubSub *previous = hpb_get();
+    HpbSimLink link = {1000, 0, 0, 0.0};
+    HpbSim *sim = hpb_sim_create(link, 1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(sim);
+    CU_ASSERT_PTR_NULL(hpb_sim_create(link, 1)); // A single simulation at a time
+
+    CU_ASSERT(hpb_sim_add_node(sim, 1) == 0);
+    CU_ASSERT(hpb_sim_add_node(sim, 1) == 1);
+    CU_ASSERT(hpb_sim_add_node(sim, 1) == 2);
+    CU_ASSERT(hpb_sim_get_node_index(sim->nodes[2]->instance) == 2);
+
+    // Each node resolves the other two, and applies the changes of membership once their window elapses
+    CU_ASSERT(hpb_sim_run(sim, 500000) > 0);
+    for(size_t i = 0; i < 3; i++) {
+        CU_ASSERT(sim->nodes[i]->context->network->network_clients->size == 2);
+    }
+
+    hpb_sim_remove_node(sim, 1);
+    CU_ASSERT(!hpb_sim_is_node_present(sim, 1));
+    CU_ASSERT(hpb_sim_select_node(sim, 1) == -1);
+    hpb_sim_run(sim, 500000);
+    CU_ASSERT(sim->nodes[0]->context->network->network_clients->size == 1);
+    CU_ASSERT(sim->nodes[2]->context->network->network_clients->size == 1);
+
+    hpb_sim_destroy(&sim);
+    CU_ASSERT_PTR_NULL(sim);
+    hpb_set_current(previous);
+}
+
+void hpb_sim_test_publish()
+{
+    HypePubSub *previous = hpb_get();
+    HpbSimLink link = {1000, 500, 1000000, 0.0};
+    HpbSim *sim = hpb_sim_create(link, 1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(sim);
+
+    for(int i = 0; i < 4; i++) {
+        hpb_sim_add_node(sim, 1);
+    }
+    hpb_sim_run(sim, 500000);
+
+    CU_ASSERT(hpb_sim_select_node(sim, 0) == 0);
+    hpb_set_message_received_callback(test_on_message_received);
+    hpb_issue_subscribe_req("topic");
+    hpb_sim_run(sim, 500000);
+
+    hpb_sim_select_node(sim, 3);
+    hpb_issue_publish_req("topic", "hello", 6);
+    hpb_sim_run(sim, 500000);
+    CU_ASSERT(n_received == 1);
+    CU_ASSERT_STRING_EQUAL(received_msg, "hello");
+
+    // The messages to a removed node fail and are counted as lost
+    hpb_sim_remove_node(sim, 0);
+    hpb_sim_select_node(sim, 3);
+    hpb_issue_publish_req("topic", "bye", 4);
+    hpb_sim_run(sim, 500000);
+    CU_ASSERT(n_received == 1);
+    CU_ASSERT(sim->n_sent > 0);
+    CU_ASSERT(sim->n_delivered <= sim->n_sent);
+
+    hpb_sim_destroy(&sim);
+    hpb_set_current(previous);
+}
+
+static void test_on_message_received(char *service_name, char *msg, size_t msg_length)
+{
+    n_received++;
+    snprintf(received_msg, sizeof(received_msg), "%s", msg);
+}
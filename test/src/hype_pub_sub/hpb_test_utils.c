@@ -1,7 +1,27 @@
 
 #include <hpb_test_utils.h>
 #include <hype/hype.h>
+#include <string.h>
+#include <hype_pub_sub/hpb_constants.h>
 
+static uint64_t hpb_test_utils_next_message_id = 1;
+
+static int hpb_test_utils_transport_start(HpbTransport *transport);
+static void hpb_test_utils_transport_stop(HpbTransport *transport);
+static HypeInstance *hpb_test_utils_transport_get_own_instance(HpbTransport *transport);
+static uint64_t hpb_test_utils_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination);
+static void hpb_test_utils_transport_resolve(HpbTransport *transport, HypeInstance *instance);
+static void hpb_test_utils_transport_destroy(HpbTransport *transport);
+
+static const HpbTransportOps hpb_test_utils_transport_ops = {
+    "test",
+    hpb_test_utils_transport_start,
+    hpb_test_utils_transport_stop,
+    hpb_test_utils_transport_get_own_instance,
+    hpb_test_utils_transport_send,
+    hpb_test_utils_transport_resolve,
+    hpb_test_utils_transport_destroy
+};
 
 HypeInstance * hpb_test_utils_get_instance_from_id(HLByte *id, size_t size)
 {
@@ -18,3 +38,38 @@ HpbClient * hpb_test_utils_get_client_from_id(HLByte *id, size_t size)
     hype_instance_release(instance);
     return client;
 }
+
+HpbTransport * hpb_test_utils_create_transport()
+{
+    // Every message is accepted and gets an identifier, so that the sends are tracked by the retry queue
+    HpbTransportCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    return hpb_transport_create(&hpb_test_utils_transport_ops, NULL, callbacks, NULL);
+}
+
+static int hpb_test_utils_transport_start(HpbTransport *transport)
+{
+    return 0;
+}
+
+static void hpb_test_utils_transport_stop(HpbTransport *transport)
+{
+}
+
+static HypeInstance *hpb_test_utils_transport_get_own_instance(HpbTransport *transport)
+{
+    return hpb_test_utils_get_instance_from_id((HLByte *) HPB_DUMMY_OWN_INSTANCE_ID, HPB_DUMMY_OWN_INSTANCE_SIZE);
+}
+
+static uint64_t hpb_test_utils_transport_send(HpbTransport *transport, HLByte *data, size_t data_size, HypeInstance *destination)
+{
+    return __atomic_fetch_add(&hpb_test_utils_next_message_id, 1, __ATOMIC_SEQ_CST);
+}
+
+static void hpb_test_utils_transport_resolve(HpbTransport *transport, HypeInstance *instance)
+{
+}
+
+static void hpb_test_utils_transport_destroy(HpbTransport *transport)
+{
+}
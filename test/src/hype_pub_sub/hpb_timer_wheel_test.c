@@ -0,0 +1,65 @@
+#include "hpb_timer_wheel_test.h"
+
+static HLByte HPB_TIMER_WHEEL_TEST_SERVICE[] = "\x8b\xa1\x04\x94\xc2\x9d\x24\x76\x04\xb1\x5c\xd2\x40\x01\x32\x33\x58\xa8\x9b\xf5";
+static HLByte HPB_TIMER_WHEEL_TEST_CLIENT1[] = "\x9a\xc1\xb0\x41\x5e\x0a\x97\x73\x8c\x57\xe7\xe6\x3f\x68\x50\xab\x21\xe4\x7e\xb4";
+static HLByte HPB_TIMER_WHEEL_TEST_CLIENT2[] = "\x44\x20\x01\xf9\x64\xd9\xfe\x34\x9a\x5f\x30\x8a\xb1\x41\x15\x0e\x05\x5b\xe5\x46";
+
+static uint64_t last_deadline_ms = 0;
+static size_t n_client1_expired = 0;
+
+static void test_expire(HLByte service_key[], HLByte client_key[], uint64_t deadline_ms, void *arg);
+
+void hpb_timer_wheel_test()
+{
+    HpbTimerWheel *wheel = hpb_timer_wheel_create();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(wheel);
+    uint64_t start_ms = 1000000;
+
+    CU_ASSERT(hpb_timer_wheel_advance(wheel, start_ms, test_expire, NULL) == 0);
+
+    // Timers expire once their deadline is reached, not at the start of their tick
+    CU_ASSERT(hpb_timer_wheel_schedule(wheel, start_ms + 1500, HPB_TIMER_WHEEL_TEST_SERVICE, HPB_TIMER_WHEEL_TEST_CLIENT1) == 0);
+    CU_ASSERT(hpb_timer_wheel_schedule(wheel, start_ms + 3000, HPB_TIMER_WHEEL_TEST_SERVICE, HPB_TIMER_WHEEL_TEST_CLIENT2) == 0);
+    CU_ASSERT(wheel->size == 2);
+    CU_ASSERT(hpb_timer_wheel_advance(wheel, start_ms + 1200, test_expire, NULL) == 0);
+    CU_ASSERT(hpb_timer_wheel_advance(wheel, start_ms + 1500, test_expire, NULL) == 1);
+    CU_ASSERT(last_deadline_ms == start_ms + 1500);
+    CU_ASSERT(n_client1_expired == 1);
+    CU_ASSERT(wheel->size == 1);
+
+    // Timers in the past expire at the next advance
+    CU_ASSERT(hpb_timer_wheel_schedule(wheel, start_ms, HPB_TIMER_WHEEL_TEST_SERVICE, HPB_TIMER_WHEEL_TEST_CLIENT1) == 0);
+    CU_ASSERT(hpb_timer_wheel_advance(wheel, start_ms + 1600, test_expire, NULL) == 1);
+    CU_ASSERT(n_client1_expired == 2);
+
+    // Timers further than a full turn wait for their round
+    uint64_t far_ms = start_ms + 2000 + HPB_TIMER_WHEEL_N_SLOTS * HPB_TIMER_WHEEL_TICK_MS;
+    CU_ASSERT(hpb_timer_wheel_schedule(wheel, far_ms, HPB_TIMER_WHEEL_TEST_SERVICE, HPB_TIMER_WHEEL_TEST_CLIENT1) == 0);
+    CU_ASSERT(hpb_timer_wheel_advance(wheel, start_ms + 2500, test_expire, NULL) == 0);
+    CU_ASSERT(hpb_timer_wheel_advance(wheel, start_ms + 3000, test_expire, NULL) == 1);
+    CU_ASSERT(last_deadline_ms == start_ms + 3000);
+    CU_ASSERT(hpb_timer_wheel_advance(wheel, far_ms - 1, test_expire, NULL) == 0);
+    CU_ASSERT(hpb_timer_wheel_advance(wheel, far_ms, test_expire, NULL) == 1);
+    CU_ASSERT(n_client1_expired == 3);
+    CU_ASSERT(wheel->size == 0);
+
+    // Gaps longer than a full turn expire every timer due
+    CU_ASSERT(hpb_timer_wheel_schedule(wheel, far_ms + 10000, HPB_TIMER_WHEEL_TEST_SERVICE, HPB_TIMER_WHEEL_TEST_CLIENT1) == 0);
+    CU_ASSERT(hpb_timer_wheel_schedule(wheel, far_ms + 50000, HPB_TIMER_WHEEL_TEST_SERVICE, HPB_TIMER_WHEEL_TEST_CLIENT2) == 0);
+    CU_ASSERT(hpb_timer_wheel_advance(wheel, far_ms + 500000, test_expire, NULL) == 2);
+
+    // Pending timers are freed with the wheel
+    CU_ASSERT(hpb_timer_wheel_schedule(wheel, far_ms + 600000, HPB_TIMER_WHEEL_TEST_SERVICE, HPB_TIMER_WHEEL_TEST_CLIENT1) == 0);
+    hpb_timer_wheel_destroy(&wheel);
+    CU_ASSERT_PTR_NULL(wheel);
+}
+
+static void test_expire(HLByte service_key[], HLByte client_key[], uint64_t deadline_ms, void *arg)
+{
+    CU_ASSERT(memcmp(service_key, HPB_TIMER_WHEEL_TEST_SERVICE, SHA1_BLOCK_SIZE) == 0);
+    last_deadline_ms = deadline_ms;
+
+    if(memcmp(client_key, HPB_TIMER_WHEEL_TEST_CLIENT1, SHA1_BLOCK_SIZE) == 0) {
+        n_client1_expired++;
+    }
+}
@@ -0,0 +1,121 @@
+#include "hpb_topic_trie_test.h"
+#include "hpb_test_utils.h"
+
+static size_t n_matches[3];
+
+static void test_match(HLByte service_key[], void *arg);
+
+void hpb_topic_trie_test()
+{
+    hpb_topic_trie_test_patterns();
+    hpb_topic_trie_test_payload();
+    hpb_topic_trie_test_match();
+}
+
+void hpb_topic_trie_test_patterns()
+{
+    CU_ASSERT(hpb_topic_is_pattern("site1/+/temperature"));
+    CU_ASSERT(hpb_topic_is_pattern("site1/#"));
+    CU_ASSERT(!hpb_topic_is_pattern("site1/room1/temperature"));
+
+    CU_ASSERT(hpb_topic_is_valid_pattern("site1/+/temperature"));
+    CU_ASSERT(hpb_topic_is_valid_pattern("site1/+/+"));
+    CU_ASSERT(hpb_topic_is_valid_pattern("site1/#"));
+    CU_ASSERT(!hpb_topic_is_valid_pattern("+/temperature"));
+    CU_ASSERT(!hpb_topic_is_valid_pattern("#"));
+    CU_ASSERT(!hpb_topic_is_valid_pattern("site1"));
+    CU_ASSERT(!hpb_topic_is_valid_pattern("site1/room1/temperature"));
+    CU_ASSERT(!hpb_topic_is_valid_pattern("site1/#/temperature"));
+    CU_ASSERT(!hpb_topic_is_valid_pattern("site1/room+/temperature"));
+    CU_ASSERT(!hpb_topic_is_valid_pattern("/room1/temperature"));
+
+    // Topics and patterns of the same first level meet at the same key
+    HLByte key1[SHA1_BLOCK_SIZE];
+    HLByte key2[SHA1_BLOCK_SIZE];
+    HLByte flat_key[SHA1_BLOCK_SIZE];
+    char *topic = "site1/room1/temperature";
+    char *pattern = "site1/+/temperature";
+    CU_ASSERT(hpb_topic_get_rendezvous_key(topic, strlen(topic), key1) == 0);
+    CU_ASSERT(hpb_topic_get_rendezvous_key(pattern, strlen(pattern), key2) == 0);
+    CU_ASSERT_NSTRING_EQUAL(key1, key2, SHA1_BLOCK_SIZE);
+    sha1_digest((const BYTE *) "site1", strlen("site1"), flat_key);
+    CU_ASSERT(memcmp(key1, flat_key, SHA1_BLOCK_SIZE) != 0);
+    CU_ASSERT(hpb_topic_get_rendezvous_key("site1", strlen("site1"), key1) == -1);
+}
+
+void hpb_topic_trie_test_payload()
+{
+    char *topic = "site1/room1/temperature";
+    char *payload = NULL;
+    char *parsed_topic = NULL;
+    char *parsed_msg = NULL;
+    size_t parsed_topic_length = 0;
+    size_t parsed_msg_length = 0;
+
+    size_t payload_length = hpb_topic_build_payload(topic, strlen(topic), "21.5", 4, &payload);
+    CU_ASSERT(payload_length == HPB_TOPIC_LENGTH_SIZE + strlen(topic) + 4);
+    CU_ASSERT(hpb_topic_parse_payload(payload, payload_length, &parsed_topic, &parsed_topic_length, &parsed_msg, &parsed_msg_length) == 0);
+    CU_ASSERT(parsed_topic_length == strlen(topic));
+    CU_ASSERT_NSTRING_EQUAL(parsed_topic, topic, strlen(topic));
+    CU_ASSERT(parsed_msg_length == 4);
+    CU_ASSERT_NSTRING_EQUAL(parsed_msg, "21.5", 4);
+
+    // Truncated payloads are rejected
+    CU_ASSERT(hpb_topic_parse_payload(payload, 1, &parsed_topic, &parsed_topic_length, &parsed_msg, &parsed_msg_length) == -1);
+    CU_ASSERT(hpb_topic_parse_payload(payload, HPB_TOPIC_LENGTH_SIZE + 5, &parsed_topic, &parsed_topic_length, &parsed_msg, &parsed_msg_length) == -1);
+    free(payload);
+}
+
+void hpb_topic_trie_test_match()
+{
+    HLByte keys[3][SHA1_BLOCK_SIZE] = {{0x01}, {0x02}, {0x03}};
+    char *patterns[3] = {"site1/+/temperature", "site1/#", "site1/room1/+"};
+    HpbTopicTrie *trie = hpb_topic_trie_create();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(trie);
+
+    for(int i = 0; i < 3; i++) {
+        CU_ASSERT(hpb_topic_trie_add(trie, patterns[i], keys[i]) == 0);
+    }
+    CU_ASSERT(hpb_topic_trie_add(trie, patterns[0], keys[0]) == 0); // Already present
+    CU_ASSERT(trie->n_patterns == 3);
+    CU_ASSERT(trie->root->children->size == 1);
+
+    memset(n_matches, 0, sizeof(n_matches));
+    CU_ASSERT(hpb_topic_trie_match(trie, "site1/room1/temperature", strlen("site1/room1/temperature"), test_match, keys) == 3);
+    CU_ASSERT(hpb_topic_trie_match(trie, "site1/room2/temperature", strlen("site1/room2/temperature"), test_match, keys) == 2);
+    CU_ASSERT(hpb_topic_trie_match(trie, "site1/room2/humidity", strlen("site1/room2/humidity"), test_match, keys) == 1);
+    CU_ASSERT(hpb_topic_trie_match(trie, "site1/room1/temperature/max", strlen("site1/room1/temperature/max"), test_match, keys) == 1);
+    CU_ASSERT(hpb_topic_trie_match(trie, "site1", strlen("site1"), test_match, keys) == 0);
+    CU_ASSERT(hpb_topic_trie_match(trie, "site2/room1/temperature", strlen("site2/room1/temperature"), test_match, keys) == 0);
+    CU_ASSERT(n_matches[0] == 2);
+    CU_ASSERT(n_matches[1] == 4);
+    CU_ASSERT(n_matches[2] == 1);
+
+    // The topic does not need to be null terminated
+    CU_ASSERT(hpb_topic_trie_match(trie, "site1/room1/temperatureXYZ", strlen("site1/room1/temperature"), test_match, keys) == 3);
+
+    // Removing the patterns prunes their levels
+    CU_ASSERT(hpb_topic_trie_remove(trie, "site1/+/humidity", keys[0]) == -1);
+    CU_ASSERT(hpb_topic_trie_remove(trie, patterns[0], keys[1]) == -1);
+    CU_ASSERT(hpb_topic_trie_remove(trie, patterns[0], keys[0]) == 0);
+    CU_ASSERT(hpb_topic_trie_match(trie, "site1/room2/temperature", strlen("site1/room2/temperature"), test_match, keys) == 1);
+    CU_ASSERT(hpb_topic_trie_remove(trie, patterns[1], keys[1]) == 0);
+    CU_ASSERT(hpb_topic_trie_remove(trie, patterns[2], keys[2]) == 0);
+    CU_ASSERT(trie->n_patterns == 0);
+    CU_ASSERT(trie->root->children->size == 0);
+
+    hpb_topic_trie_destroy(&trie);
+    CU_ASSERT_PTR_NULL(trie);
+}
+
+static void test_match(HLByte service_key[], void *arg)
+{
+    HLByte (*keys)[SHA1_BLOCK_SIZE] = (HLByte (*)[SHA1_BLOCK_SIZE]) arg;
+
+    for(int i = 0; i < 3; i++)
+    {
+        if(memcmp(keys[i], service_key, SHA1_BLOCK_SIZE) == 0) {
+            n_matches[i]++;
+        }
+    }
+}
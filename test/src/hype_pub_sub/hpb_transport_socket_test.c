@@ -0,0 +1,187 @@
+
+#include "hpb_transport_socket_test.h"
+
+#include <unistd.h>
+
+#define HPB_TEST_TIMEOUT_MS 5000
+
+static HpbEventLoop *test_loop = NULL;
+static HpbTransport *test_node_a = NULL;
+static HpbTransport *test_node_b = NULL;
+static int n_started = 0;
+static int n_found = 0;
+static int n_resolved = 0;
+static int n_lost = 0;
+static int n_received = 0;
+static int n_delivered = 0;
+static int n_send_failed = 0;
+static uint64_t sent_message_id = 0;
+static uint8_t resolved_capacity = 0;
+static char received_msg[32];
+
+static HypeInstance *test_get_instance(char *name);
+static bool test_is_instance(HypeInstance *instance, char *name);
+static void test_on_start(bool success);
+static void test_on_instance_found(HypeInstance *instance);
+static void test_on_instance_resolved(HypeInstance *instance);
+static void test_on_instance_lost(HypeInstance *instance);
+static void test_on_message_received(HypeInstance *origin, HLByte *data, size_t data_size);
+static void test_on_message_delivered(uint64_t message_id);
+static void test_on_message_send_failed(uint64_t message_id);
+static void test_timer_stop(void *arg);
+
+void hpb_transport_socket_test()
+{
+    hpb_transport_socket_test_create();
+    hpb_transport_socket_test_exchange();
+}
+
+void hpb_transport_socket_test_create()
+{
+    HpbTransportCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+
+    CU_ASSERT_PTR_NULL(hpb_transport_socket_create(NULL, callbacks, "/tmp", "", 1));
+    CU_ASSERT_PTR_NULL(hpb_transport_socket_create(NULL, callbacks, "/tmp", "a/b", 1));
+    CU_ASSERT_PTR_NULL(hpb_transport_socket_create(NULL, callbacks, "/tmp", "a_name_which_is_longer_than_the_maximum", 1));
+
+    HpbTransport *transport = hpb_transport_socket_create(NULL, callbacks, "/tmp", "node", 3);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(transport);
+
+    // The identifier of a node is its name and its announcement carries its capacity
+    HypeInstance *own_instance = hpb_transport_get_own_instance(transport);
+    CU_ASSERT(test_is_instance(own_instance, "node"));
+    CU_ASSERT(own_instance->announcement->size == 1);
+    CU_ASSERT(own_instance->announcement->data[0] == 3);
+    hype_instance_release(own_instance);
+
+    hpb_transport_destroy(&transport);
+    CU_ASSERT_PTR_NULL(transport);
+}
+
+void hpb_transport_socket_test_exchange()
+{
+    char dir[] = "/tmp/hpb_transport_test_XXXXXX";
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mkdtemp(dir));
+
+    HpbTransportCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.on_start = test_on_start;
+    callbacks.on_instance_found = test_on_instance_found;
+    callbacks.on_instance_resolved = test_on_instance_resolved;
+    callbacks.on_instance_lost = test_on_instance_lost;
+    callbacks.on_message_received = test_on_message_received;
+    callbacks.on_message_delivered = test_on_message_delivered;
+    callbacks.on_message_send_failed = test_on_message_send_failed;
+
+    test_loop = hpb_event_loop_create();
+    test_node_a = hpb_transport_socket_create(test_loop, callbacks, dir, "a", 2);
+    test_node_b = hpb_transport_socket_create(test_loop, callbacks, dir, "b", 5);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(test_node_a);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(test_node_b);
+
+    // Both nodes find each other, a resolves b, which is resolved as well, and a message is sent from a to b
+    CU_ASSERT(hpb_transport_start(test_node_a) == 0);
+    CU_ASSERT(hpb_transport_start(test_node_b) == 0);
+    hpb_event_loop_add_timer(test_loop, HPB_TEST_TIMEOUT_MS, 0, test_timer_stop, NULL);
+    hpb_event_loop_run(test_loop);
+
+    CU_ASSERT(n_started == 2);
+    CU_ASSERT(n_found == 2);
+    CU_ASSERT(n_resolved == 2);
+    CU_ASSERT(resolved_capacity == 5);
+    CU_ASSERT(n_received == 1);
+    CU_ASSERT(strcmp(received_msg, "hello b") == 0);
+    CU_ASSERT(n_delivered == 1);
+
+    // A message to a node which does not exist fails, and a node which stops is lost by the others
+    HypeInstance *instance_c = test_get_instance("c");
+    CU_ASSERT(hpb_transport_send(test_node_a, (HLByte *) "x", 1, instance_c) != 0);
+    hype_instance_release(instance_c);
+    hpb_transport_stop(test_node_b);
+    hpb_event_loop_add_timer(test_loop, 200, 0, test_timer_stop, NULL);
+    hpb_event_loop_run(test_loop);
+
+    CU_ASSERT(n_send_failed == 1);
+    CU_ASSERT(n_lost == 1);
+
+    hpb_transport_stop(test_node_a);
+    hpb_transport_destroy(&test_node_a);
+    hpb_transport_destroy(&test_node_b);
+    hpb_event_loop_destroy(&test_loop);
+    CU_ASSERT(rmdir(dir) == 0);
+}
+
+static HypeInstance *test_get_instance(char *name)
+{
+    HypeBuffer *identifier = hype_buffer_create_from(name, strlen(name));
+    HypeInstance *instance = hype_instance_create(identifier, NULL, false);
+    hype_buffer_release(identifier);
+    return instance;
+}
+
+static bool test_is_instance(HypeInstance *instance, char *name)
+{
+    return instance->identifier->size == strlen(name) && memcmp(instance->identifier->data, name, strlen(name)) == 0;
+}
+
+static void test_on_start(bool success)
+{
+    n_started += success ? 1 : 0;
+}
+
+static void test_on_instance_found(HypeInstance *instance)
+{
+    n_found++;
+    if(test_is_instance(instance, "b")) {
+        hpb_transport_resolve(test_node_a, instance);
+    }
+}
+
+static void test_on_instance_resolved(HypeInstance *instance)
+{
+    n_resolved++;
+    if(test_is_instance(instance, "b"))
+    {
+        resolved_capacity = instance->announcement->data[0];
+        sent_message_id = hpb_transport_send(test_node_a, (HLByte *) "hello b", 7, instance);
+    }
+}
+
+static void test_on_instance_lost(HypeInstance *instance)
+{
+    n_lost += test_is_instance(instance, "b") ? 1 : 0;
+}
+
+static void test_on_message_received(HypeInstance *origin, HLByte *data, size_t data_size)
+{
+    if(test_is_instance(origin, "a") && data_size < sizeof(received_msg))
+    {
+        memcpy(received_msg, data, data_size);
+        received_msg[data_size] = '\0';
+        n_received++;
+    }
+
+    if(n_received == 1 && n_delivered == 1) {
+        hpb_event_loop_stop(test_loop);
+    }
+}
+
+static void test_on_message_delivered(uint64_t message_id)
+{
+    n_delivered += (message_id == sent_message_id) ? 1 : 0;
+
+    if(n_received == 1 && n_delivered == 1) {
+        hpb_event_loop_stop(test_loop);
+    }
+}
+
+static void test_on_message_send_failed(uint64_t message_id)
+{
+    n_send_failed++;
+}
+
+static void test_timer_stop(void *arg)
+{
+    hpb_event_loop_stop(test_loop);
+}
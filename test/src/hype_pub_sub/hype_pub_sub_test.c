@@ -35,6 +35,16 @@ void hpb_test()
     hpb_test_process_subscribe_and_unsubscribe();
     hpb_test_process_publish_req();
     hpb_test_process_info_req();
+    hpb_test_update_managed_services();
+    hpb_test_promote_replicas();
+    hpb_test_subscription_leases();
+    hpb_test_membership_events();
+    hpb_test_wildcard_subscriptions();
+    hpb_test_subscription_filters();
+    hpb_test_shard_subscribers();
+    hpb_test_relay_trees();
+    hpb_test_direct_publish();
+    hpb_test_local_delivery();
 
     hpb_destroy();
 }
@@ -151,10 +161,710 @@ void hpb_test_process_subscribe_and_unsubscribe()
 
 void hpb_test_process_publish_req()
 {
+    HypePubSub *hpb = hpb_get();
+
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT2, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    char msg[] = "HelloHypeWorld";
+    HpbPublishOrigin origin = {0x01020304, 1};
+
+    // Publishes to a service without subscribers are held until the first subscriber arrives
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1));
+    CU_ASSERT(hpb_process_publish_req(HPB_TEST_SERVICE1, origin, msg, strlen(msg)) == 0);
+    CU_ASSERT(hpb->handover->publishes->size == 1);
+    hpb_process_subscribe_req(HPB_TEST_SERVICE1, instance1);
+    CU_ASSERT(hpb->handover->publishes->size == 0);
+    CU_ASSERT(hpb->handover->n_flushed == 1);
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, instance1);
+
+    // Publishes to a service which was handed over are forwarded to the new manager
+    hpb_handover_add_forward(hpb->handover, HPB_TEST_SERVICE1, instance2, hpb_clock_now_ms());
+    origin.publisher_seq++;
+    CU_ASSERT(hpb_process_publish_req(HPB_TEST_SERVICE1, origin, msg, strlen(msg)) == 0);
+    CU_ASSERT(hpb->handover->n_forwarded == 1);
+    CU_ASSERT(hpb->handover->publishes->size == 0);
+
+    // Managing the service again stops the forwarding
+    hpb_process_subscribe_req(HPB_TEST_SERVICE1, instance1);
+    CU_ASSERT_PTR_NULL(hpb_handover_find_forward(hpb->handover, HPB_TEST_SERVICE1, hpb_clock_now_ms()));
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, instance1);
 
+    // Retained messages keep the service alive without subscribers and are replaced by newer ones
+    CU_ASSERT(hpb_process_retained_publish_req(HPB_TEST_SERVICE2, origin, "state=on", 8) == 0);
+    HpbServiceManager *service2 = hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service2);
+    CU_ASSERT(service2->retained_msg_length == 8);
+    CU_ASSERT(hpb_process_retained_publish_req(HPB_TEST_SERVICE2, origin, "state=off", 9) == 0);
+    CU_ASSERT_NSTRING_EQUAL(service2->retained_msg, "state=off", 9);
+    hpb_process_subscribe_req(HPB_TEST_SERVICE2, instance1);
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE2, instance1);
+    CU_ASSERT_PTR_NOT_NULL(hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE2));
+
+    // Retained messages which do not fit in the limit are published but not retained
+    char *large_msg = (char *) calloc(HPB_RETAINED_MAX_BYTES, sizeof(char));
+    CU_ASSERT(hpb_process_retained_publish_req(HPB_TEST_SERVICE1, origin, large_msg, HPB_RETAINED_MAX_BYTES) == 0);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1));
+    free(large_msg);
+
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
 }
 
 void hpb_test_process_info_req()
 {
+    HypePubSub *hpb = hpb_get();
+
+    // This client is the only one in the network, so it manages its own subscriptions
+    hpb_issue_subscribe_req("sequenced");
+    HpbSubscription *subs = (HpbSubscription *) hpb->own_subscriptions->head->element;
+    char msg[] = "HelloHypeWorld";
+    HpbPublishOrigin origin10 = {0x01020304, 10}, origin11 = {0x01020304, 11}, origin12 = {0x01020304, 12}, origin13 = {0x01020304, 13};
+
+    CU_ASSERT(hpb_process_sequenced_info_msg(subs->service_key, 10, origin10, msg, sizeof(msg)) == 0);
+    CU_ASSERT(subs->gap_detected_ms == 0);
+    CU_ASSERT(hpb_process_sequenced_info_msg(subs->service_key, 13, origin13, msg, sizeof(msg)) == 0);
+    CU_ASSERT(subs->gap_detected_ms != 0);
+
+    HpbSeqRange ranges[2];
+    CU_ASSERT(hpb_seq_window_get_missing(&(subs->seq_window), ranges, 2) == 1);
+    CU_ASSERT(ranges[0].first == 11 && ranges[0].last == 12);
+
+    // Duplicates are discarded and the gap is closed by the late messages
+    uint64_t n_suppressed = hpb->n_duplicates_suppressed;
+    CU_ASSERT(hpb_process_sequenced_info_msg(subs->service_key, 13, origin13, msg, sizeof(msg)) == -2);
+    CU_ASSERT(hpb_process_sequenced_info_msg(subs->service_key, 12, origin12, msg, sizeof(msg)) == 0);
+    CU_ASSERT(hpb_process_sequenced_info_msg(subs->service_key, 11, origin11, msg, sizeof(msg)) == 0);
+    CU_ASSERT(subs->gap_detected_ms == 0);
+
+    // A message delivered again by another manager, under another sequence number, is suppressed as well
+    CU_ASSERT(hpb_process_sequenced_info_msg(subs->service_key, 5000, origin12, msg, sizeof(msg)) == -2);
+    CU_ASSERT(hpb_process_info_msg(subs->service_key, origin10, msg, sizeof(msg)) == -2);
+    CU_ASSERT(hpb->n_duplicates_suppressed == n_suppressed + 3);
+    CU_ASSERT(subs->dedup_cache.n_suppressed == 3);
+
+    // The manager resends the messages kept in the history of the service
+    HLByte service_key[SHA1_BLOCK_SIZE];
+    memcpy(service_key, subs->service_key, SHA1_BLOCK_SIZE);
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    uint32_t first_seq = service->next_seq;
+    hpb_issue_publish_req("sequenced", msg, sizeof(msg));
+    hpb_issue_publish_req("sequenced", msg, sizeof(msg));
+    hpb_issue_publish_req("sequenced", msg, sizeof(msg));
+    CU_ASSERT(service->next_seq == first_seq + 3);
+
+    HpbSeqRange missing[] = {{first_seq, first_seq + 1}, {first_seq + 2, first_seq + 5}};
+    CU_ASSERT(hpb_process_nack_req(service_key, missing, 2, hpb->network->own_client->hype_instance) == 3);
+    CU_ASSERT(hpb_process_nack_req(HPB_TEST_SERVICE1, missing, 2, hpb->network->own_client->hype_instance) == -1);
+
+    // Inverted ranges are skipped, and the others are clamped to the history
+    HpbSeqRange invalid[] = {{first_seq + 2, first_seq}, {first_seq + 2, first_seq + 0x7ffffff0}};
+    CU_ASSERT(hpb_process_nack_req(service_key, invalid, 2, hpb->network->own_client->hype_instance) == 1);
+
+    hpb_issue_unsubscribe_req("sequenced");
+}
+
+void hpb_test_update_managed_services()
+{
+    HypePubSub *hpb = hpb_get();
+
+    HLByte *client_ids[] = {HPB_TEST_CLIENT1, HPB_TEST_CLIENT2, HPB_TEST_CLIENT3, HPB_TEST_CLIENT4, HPB_TEST_CLIENT5,
+                            HPB_TEST_CLIENT6, HPB_TEST_CLIENT7, HPB_TEST_CLIENT8, HPB_TEST_CLIENT9, HPB_TEST_CLIENT10};
+    HLByte *service_keys[] = {HPB_TEST_SERVICE1, HPB_TEST_SERVICE2};
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+
+    hpb_process_subscribe_req(HPB_TEST_SERVICE1, instance1);
+    hpb_process_subscribe_req(HPB_TEST_SERVICE2, instance1);
+
+    for(int i = 0; i < 10; i++)
+    {
+        HypeInstance *instance = hpb_test_utils_get_instance_from_id(client_ids[i], HPB_UTILS_CLIENT_ID_TEST_SIZE);
+        hpb_network_add_client(hpb->network, instance);
+        hype_instance_release(instance);
+    }
+
+    // The services which move to other clients are handed over, with their subscribers, instead of being dropped
+    uint64_t n_sent = hpb->handover->n_services_sent;
+    CU_ASSERT(hpb_update_managed_services() == 0);
+    uint64_t n_moved = 0;
+    for(int i = 0; i < 2; i++)
+    {
+        HypeInstance *new_manager = hpb_network_get_service_manager_id(hpb->network, service_keys[i]);
+        if(hpb_client_is_instance_equal(hpb->network->own_client, new_manager)) {
+            continue;
+        }
+
+        n_moved++;
+        CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb->managed_services, service_keys[i]));
+        CU_ASSERT_PTR_NOT_NULL(hpb_handover_find_forward(hpb->handover, service_keys[i], hpb_clock_now_ms()));
+    }
+    CU_ASSERT(n_moved > 0);
+    CU_ASSERT(hpb->handover->n_services_sent == n_sent + n_moved);
+
+    for(int i = 0; i < 10; i++)
+    {
+        HypeInstance *instance = hpb_test_utils_get_instance_from_id(client_ids[i], HPB_UTILS_CLIENT_ID_TEST_SIZE);
+        hpb_network_remove_client(hpb->network, instance);
+        hype_instance_release(instance);
+    }
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, instance1);
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE2, instance1);
+    hype_instance_release(instance1);
+}
+
+void hpb_test_promote_replicas()
+{
+    HypePubSub *hpb = hpb_get();
+    HpbPublishOrigin origin = {0x01020304, 1};
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT2, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *subscribers[] = {instance1, instance2};
+
+    // A newer replica replaces the previous one, and an empty one drops it
+    CU_ASSERT(hpb_process_replica_req(HPB_TEST_SERVICE1, NULL, 5, origin, NULL, 0, subscribers, 2) == 0);
+    CU_ASSERT(hpb_process_replica_req(HPB_TEST_SERVICE2, NULL, 9, origin, "on", 2, subscribers, 1) == 0);
+    CU_ASSERT(hpb_process_replica_req(HPB_TEST_SERVICE2, NULL, 9, origin, NULL, 0, subscribers, 0) == 0);
+    CU_ASSERT(hpb->replicas->size == 1);
+    CU_ASSERT(hpb_process_replica_req(HPB_TEST_SERVICE1, NULL, 6, origin, "on", 2, subscribers, 1) == 0);
+    HpbServiceManager *replica = hpb_list_service_managers_find(hpb->replicas, HPB_TEST_SERVICE1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(replica);
+    CU_ASSERT(replica->subscribers->size == 1);
+    CU_ASSERT(replica->next_seq == 6);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1));
+
+    // Alone in the network, this client is the closest one to every service and takes over its replicas
+    uint64_t n_promotions = hpb->n_promotions;
+    CU_ASSERT(hpb_promote_replicas() == 1);
+    CU_ASSERT(hpb->n_promotions == n_promotions + 1);
+    CU_ASSERT(hpb->replicas->size == 0);
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT(service->next_seq == 6 + 2 * HPB_SEQ_RESET_DISTANCE);
+    CU_ASSERT(service->retained_msg_length == 2);
+    CU_ASSERT_PTR_NOT_NULL(hpb_list_clients_find(service->subscribers, instance1));
+
+    CU_ASSERT(hpb_set_replication_factor(HPB_REPLICATION_MAX_FACTOR + 1) == -1);
+    CU_ASSERT(hpb_set_replication_factor(0) == 0);
+    CU_ASSERT(hpb_set_replication_factor(HPB_REPLICATION_DEFAULT_FACTOR) == 0);
+
+    hpb_list_service_managers_remove(hpb->managed_services, HPB_TEST_SERVICE1);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+}
+
+void hpb_test_subscription_leases()
+{
+    HypePubSub *hpb = hpb_get();
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+
+    // Subscribers get a lease, which heartbeats renew without scheduling another timer
+    uint64_t now_ms = hpb_clock_now_ms();
+    CU_ASSERT(hpb_process_subscribe_req(HPB_TEST_SERVICE1, instance1) == 0);
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    HpbClient *subscriber = hpb_list_clients_find(service->subscribers, instance1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(subscriber);
+    CU_ASSERT(subscriber->lease_expiration_ms >= now_ms + HPB_LEASE_DURATION_MS);
+    CU_ASSERT(subscriber->lease_timer_ms == subscriber->lease_expiration_ms);
+    size_t n_timers = hpb->lease_timers->size;
+
+    subscriber->lease_expiration_ms = 0;
+    CU_ASSERT(hpb_process_heartbeat_req(HPB_TEST_SERVICE1, NULL, 1, instance1) == 0);
+    CU_ASSERT(subscriber->lease_expiration_ms >= now_ms + HPB_LEASE_DURATION_MS);
+    CU_ASSERT(hpb->lease_timers->size == n_timers);
+
+    // A timer which fires before the renewed expiration is scheduled again
+    subscriber->lease_timer_ms = 1;
+    hpb_timer_wheel_schedule(hpb->lease_timers, 1, HPB_TEST_SERVICE1, subscriber->key);
+    hpb_process_periodic_tasks();
+    CU_ASSERT_PTR_EQUAL(hpb_list_clients_find(service->subscribers, instance1), subscriber);
+    CU_ASSERT(subscriber->lease_timer_ms == subscriber->lease_expiration_ms);
+
+    // A lease which was not renewed removes the subscriber, and the service with its last subscriber
+    uint64_t n_expirations = hpb->n_lease_expirations;
+    subscriber->lease_expiration_ms = 1;
+    subscriber->lease_timer_ms = 1;
+    hpb_timer_wheel_schedule(hpb->lease_timers, 1, HPB_TEST_SERVICE1, subscriber->key);
+    hpb_process_periodic_tasks();
+    CU_ASSERT(hpb->n_lease_expirations == n_expirations + 1);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1));
+
+    // The heartbeats of an expired subscriber subscribe it again
+    CU_ASSERT(hpb_process_heartbeat_req(HPB_TEST_SERVICE1, NULL, 1, instance1) == 0);
+    service = hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT_PTR_NOT_NULL(hpb_list_clients_find(service->subscribers, instance1));
+
+    // The heartbeats renew the wildcard subscriptions, and subscribe them again with their pattern once unknown
+    HypeInstance *own_instance = hpb->network->own_client->hype_instance;
+    char *pattern = "site1/+/pressure";
+    HLByte pattern_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) pattern, strlen(pattern), pattern_key);
+    HLByte flags = HPB_PROTOCOL_FLAG_WILDCARD;
+    CU_ASSERT(hpb_issue_subscribe_req(pattern) == 0);
+    service = hpb_list_service_managers_find(hpb->managed_services, pattern_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    subscriber = hpb_list_clients_find(service->subscribers, own_instance);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(subscriber);
+    subscriber->lease_expiration_ms = 0;
+    CU_ASSERT(hpb_process_heartbeat_req(pattern_key, &flags, 1, own_instance) == 0);
+    CU_ASSERT(subscriber->lease_expiration_ms >= now_ms + HPB_LEASE_DURATION_MS);
+
+    CU_ASSERT(hpb_process_unsubscribe_req(pattern_key, own_instance) == 0);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb->managed_services, pattern_key));
+    CU_ASSERT(hpb_process_heartbeat_req(pattern_key, &flags, 1, own_instance) == 0);
+    service = hpb_list_service_managers_find(hpb->managed_services, pattern_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT_STRING_EQUAL(service->pattern, pattern);
+    CU_ASSERT(hpb_issue_unsubscribe_req(pattern) == 0);
+
+    // A subscriber which lost its filter at the manager is subscribed again with it
+    HLByte service_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) "leased-service", strlen("leased-service"), service_key);
+    flags = HPB_PROTOCOL_FLAG_FILTER;
+    CU_ASSERT(hpb_issue_filtered_subscribe_req("leased-service", "level > 2") == 0);
+    service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT(hpb_process_filter_req(service_key, NULL, own_instance) == 0);
+    CU_ASSERT(hpb_process_heartbeat_req(service_key, &flags, 1, own_instance) == 0);
+    subscriber = hpb_list_clients_find(service->subscribers, own_instance);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(subscriber);
+    CU_ASSERT_PTR_NOT_NULL(subscriber->filter);
+    CU_ASSERT(hpb_issue_unsubscribe_req("leased-service") == 0);
+
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, instance1);
+    hype_instance_release(instance1);
+}
+
+void hpb_test_membership_events()
+{
+    HypePubSub *hpb = hpb_get();
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT2, HPB_UTILS_CLIENT_ID_TEST_SIZE);
 
+    // The events wait for the window to end before changing the network
+    hpb_set_membership_window(HPB_MEMBERSHIP_DEFAULT_WINDOW_MS);
+    CU_ASSERT(hpb_process_membership_event(instance1, true) == 0);
+    CU_ASSERT(hpb_process_membership_event(instance2, true) == 0);
+    CU_ASSERT(hpb->network->network_clients->size == 0);
+
+    // Without a window each event is applied at once
+    hpb_set_membership_window(0);
+    CU_ASSERT(hpb_process_membership_event(instance2, false) == 0);
+    CU_ASSERT(hpb->network->network_clients->size == 1);
+    CU_ASSERT_PTR_NOT_NULL(hpb_list_clients_find(hpb->network->network_clients, instance1));
+
+    // An instance lost a moment ago is held back
+    CU_ASSERT(hpb_process_membership_event(instance1, false) == 0);
+    CU_ASSERT(hpb_process_membership_event(instance1, true) == 0);
+    CU_ASSERT(hpb->network->network_clients->size == 0);
+    CU_ASSERT(hpb->membership->n_held == 1);
+
+    hpb_set_membership_window(HPB_MEMBERSHIP_DEFAULT_WINDOW_MS);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+}
+
+void hpb_test_wildcard_subscriptions()
+{
+    HypePubSub *hpb = hpb_get();
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    char *pattern = "site1/+/temperature";
+    HLByte pattern_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) pattern, strlen(pattern), pattern_key);
+
+    // Alone in the network, this client manages its own wildcard subscription
+    CU_ASSERT(hpb_issue_subscribe_req(pattern) == 0);
+    HpbSubscription *subs = hpb_list_subscriptions_find(hpb->own_subscriptions, pattern_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(subs);
+    CU_ASSERT(subs->is_pattern);
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, pattern_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT_STRING_EQUAL(service->pattern, pattern);
+    CU_ASSERT_NSTRING_EQUAL(service->placement_key, subs->placement_key, SHA1_BLOCK_SIZE);
+    CU_ASSERT(hpb->topic_trie->n_patterns == 1);
+
+    // A second subscriber shares the service of the pattern, and invalid patterns are rejected
+    CU_ASSERT(hpb_process_pattern_subscribe_req(pattern_key, pattern, instance1) == 0);
+    CU_ASSERT(service->subscribers->size == 2);
+    CU_ASSERT(hpb->topic_trie->n_patterns == 1);
+    CU_ASSERT(hpb_process_pattern_subscribe_req(HPB_TEST_SERVICE1, "+/temperature", instance1) == -1);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1));
+
+    // Only the topics which match the pattern are published in its service
+    uint32_t next_seq = service->next_seq;
+    CU_ASSERT(hpb_issue_publish_req("site1/room1/temperature", "21.5", 4) == 0);
+    CU_ASSERT(hpb_issue_publish_req("site1/room2/temperature", "19.0", 4) == 0);
+    CU_ASSERT(hpb_issue_publish_req("site1/room1/humidity", "40", 2) == 0);
+    CU_ASSERT(hpb_issue_publish_req("site2/room1/temperature", "18.0", 4) == 0);
+    CU_ASSERT(service->next_seq == next_seq + 2);
+    HpbHistoryEntry *entry = hpb_history_find(service->history, next_seq);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(entry);
+    CU_ASSERT(entry->msg_length == HPB_TOPIC_LENGTH_SIZE + 23 + 4);
+    CU_ASSERT(hpb_process_pattern_publish_req(entry->origin, entry->msg, 1) == -1);
+
+    // The pattern leaves the trie with the last subscriber
+    CU_ASSERT(hpb_issue_unsubscribe_req(pattern) == 0);
+    CU_ASSERT(hpb_process_unsubscribe_req(pattern_key, instance1) == 0);
+    CU_ASSERT_PTR_NULL(hpb_list_service_managers_find(hpb->managed_services, pattern_key));
+    CU_ASSERT(hpb->topic_trie->n_patterns == 0);
+
+    hype_instance_release(instance1);
+}
+
+void hpb_test_subscription_filters()
+{
+    HypePubSub *hpb = hpb_get();
+    HypeInstance *instance1 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *instance2 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT2, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *instance3 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT3, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HpbPublishOrigin origin = {1, 1};
+
+    CU_ASSERT(hpb_process_subscribe_req(HPB_TEST_SERVICE1, instance1) == 0);
+    CU_ASSERT(hpb_process_subscribe_req(HPB_TEST_SERVICE1, instance2) == 0);
+    CU_ASSERT(hpb_process_subscribe_req(HPB_TEST_SERVICE1, instance3) == 0);
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+
+    // Subscribers with the same filter share it, whatever their spacing
+    CU_ASSERT(hpb_process_filter_req(HPB_TEST_SERVICE1, "type == alarm", instance1) == 0);
+    CU_ASSERT(hpb_process_filter_req(HPB_TEST_SERVICE1, "type==alarm", instance2) == 0);
+    CU_ASSERT(service->filters->size == 1);
+    HpbFilter *filter = (HpbFilter *) service->filters->head->element;
+    CU_ASSERT(filter->n_subscribers == 2);
+    CU_ASSERT_PTR_EQUAL(hpb_list_clients_find(service->subscribers, instance1)->filter, filter);
+    CU_ASSERT_PTR_EQUAL(hpb_list_clients_find(service->subscribers, instance2)->filter, filter);
+
+    // Subscribers with an invalid filter get all the messages
+    CU_ASSERT(hpb_process_filter_req(HPB_TEST_SERVICE1, "type ==", instance3) == -1);
+    CU_ASSERT_PTR_NULL(hpb_list_clients_find(service->subscribers, instance3)->filter);
+    CU_ASSERT(hpb_process_filter_req(HPB_TEST_SERVICE2, "type == alarm", instance3) == -1);
+
+    // The filter runs once per message and its subscribers only get the messages which pass it
+    uint64_t n_filtered = hpb->n_filtered;
+    uint64_t n_filter_evaluations = hpb->n_filter_evaluations;
+    CU_ASSERT(hpb_process_publish_req(HPB_TEST_SERVICE1, origin, "type=reading, device=7", 22) == 0);
+    CU_ASSERT(hpb->n_filtered == n_filtered + 2);
+    CU_ASSERT(hpb->n_filter_evaluations == n_filter_evaluations + 1);
+    CU_ASSERT(!filter->last_result);
+    origin.publisher_seq++;
+    CU_ASSERT(hpb_process_publish_req(HPB_TEST_SERVICE1, origin, "type=alarm, device=7", 20) == 0);
+    CU_ASSERT(hpb->n_filtered == n_filtered + 2);
+    CU_ASSERT(hpb->n_filter_evaluations == n_filter_evaluations + 2);
+    CU_ASSERT(filter->last_result);
+
+    // The filter is released with its last subscriber
+    CU_ASSERT(hpb_process_filter_req(HPB_TEST_SERVICE1, NULL, instance2) == 0);
+    CU_ASSERT(filter->n_subscribers == 1);
+    CU_ASSERT(hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, instance1) == 0);
+    CU_ASSERT(service->filters->size == 0);
+
+    // Invalid filters are rejected before subscribing
+    CU_ASSERT(hpb_issue_filtered_subscribe_req("filtered-service", "level >") == -1);
+    HLByte service_key[SHA1_BLOCK_SIZE];
+    sha1_digest((const BYTE *) "filtered-service", strlen("filtered-service"), service_key);
+    CU_ASSERT_PTR_NULL(hpb_list_subscriptions_find(hpb->own_subscriptions, service_key));
+    CU_ASSERT(hpb_issue_filtered_subscribe_req("filtered-service", "level > 2") == 0);
+    HpbSubscription *subs = hpb_list_subscriptions_find(hpb->own_subscriptions, service_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(subs);
+    CU_ASSERT_STRING_EQUAL(subs->filter, "level > 2");
+    CU_ASSERT(hpb_issue_subscribe_req("filtered-service") == 0);
+    CU_ASSERT_PTR_NULL(subs->filter);
+    CU_ASSERT(hpb_issue_unsubscribe_req("filtered-service") == 0);
+
+    CU_ASSERT(hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, instance2) == 0);
+    CU_ASSERT(hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, instance3) == 0);
+    hype_instance_release(instance1);
+    hype_instance_release(instance2);
+    hype_instance_release(instance3);
+}
+
+void hpb_test_shard_subscribers()
+{
+    HypePubSub *hpb = hpb_get();
+    HLByte *client_ids[] = {HPB_TEST_CLIENT2, HPB_TEST_CLIENT3, HPB_TEST_CLIENT4, HPB_TEST_CLIENT5, HPB_TEST_CLIENT6,
+                            HPB_TEST_CLIENT7, HPB_TEST_CLIENT8, HPB_TEST_CLIENT9, HPB_TEST_CLIENT10};
+    HypeInstance *subscribers[HPB_SHARDING_SUBSCRIBERS_THRESHOLD + 8];
+    size_t n_subscribers = sizeof(subscribers) / sizeof(subscribers[0]);
+    HpbPublishOrigin origin = {1, 1};
+
+    for(int i = 0; i < 9; i++)
+    {
+        HypeInstance *instance = hpb_test_utils_get_instance_from_id(client_ids[i], HPB_UTILS_CLIENT_ID_TEST_SIZE);
+        hpb_network_add_client(hpb->network, instance);
+        hype_instance_release(instance);
+    }
+
+    // The service is managed here whatever the network, so that its shards are spread over the other clients
+    HLByte *service_key = hpb->network->own_client->key;
+    for(size_t i = 0; i < n_subscribers; i++)
+    {
+        HLByte id[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0};
+        binary_utils_write_uint32(id, (uint32_t) (0x80000000 + i));
+        subscribers[i] = hpb_test_utils_get_instance_from_id(id, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+        CU_ASSERT(hpb_process_subscribe_req(service_key, subscribers[i]) == 0);
+    }
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, service_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT(service->n_shards == 0);
+
+    // A hot service is split, and the manager only sends to the subscribers which are not sharded
+    hpb_process_periodic_tasks();
+    CU_ASSERT(service->n_shards == HPB_SHARDING_DEFAULT_SHARDS);
+    CU_ASSERT(service->shard_owners->size > 0);
+    CU_ASSERT(!service->is_shard_dirty);
+    size_t n_sharded = 0;
+    for(LinkedListNode *node = service->subscribers->head; node != NULL; node = node->next) {
+        n_sharded += ((HpbClient *) node->element)->is_sharded ? 1 : 0;
+    }
+    CU_ASSERT(n_sharded > 0);
+
+    uint64_t n_forwards = hpb->n_shard_forwards;
+    CU_ASSERT(hpb_process_publish_req(service_key, origin, "on", 2) == 0);
+    CU_ASSERT(hpb->n_shard_forwards == n_forwards + service->shard_owners->size);
+    CU_ASSERT(service->n_window_publishes == 1);
+
+    // The service is merged back once it cooled down, or when the sharding is disabled
+    CU_ASSERT(hpb_set_shards(HPB_SHARDING_MAX_SHARDS + 1) == -1);
+    for(size_t i = 0; i < n_subscribers / 2; i++) {
+        CU_ASSERT(hpb_process_unsubscribe_req(service_key, subscribers[i]) == 0);
+    }
+    hpb_process_periodic_tasks();
+    CU_ASSERT(service->n_shards == HPB_SHARDING_DEFAULT_SHARDS);
+    CU_ASSERT(hpb_set_shards(0) == 0);
+    hpb_process_periodic_tasks();
+    CU_ASSERT(service->n_shards == 0);
+    CU_ASSERT(service->shard_owners->size == 0);
+    CU_ASSERT(!((HpbClient *) service->subscribers->head->element)->is_sharded);
+    CU_ASSERT(hpb_set_shards(HPB_SHARDING_DEFAULT_SHARDS) == 0);
+
+    // The shards owned here expire unless their manager refreshes them
+    CU_ASSERT(hpb_process_shard_publish_req(HPB_TEST_SERVICE1, 1, origin, "on", 2) == -1);
+    CU_ASSERT(hpb_process_shard_req(HPB_TEST_SERVICE1, subscribers, 2) == 0);
+    HpbServiceManager *shard = hpb_list_service_managers_find(hpb->shards, HPB_TEST_SERVICE1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(shard);
+    CU_ASSERT(shard->subscribers->size == 2);
+    uint64_t n_deliveries = hpb->n_shard_deliveries;
+    CU_ASSERT(hpb_process_shard_publish_req(HPB_TEST_SERVICE1, 1, origin, "on", 2) == 0);
+    CU_ASSERT(hpb->n_shard_deliveries == n_deliveries + 2);
+    shard->replicated_ms = 0;
+    hpb_process_periodic_tasks();
+    CU_ASSERT(hpb->shards->size == 0);
+
+    for(size_t i = 0; i < n_subscribers; i++)
+    {
+        hpb_process_unsubscribe_req(service_key, subscribers[i]);
+        hype_instance_release(subscribers[i]);
+    }
+    for(int i = 0; i < 9; i++)
+    {
+        HypeInstance *instance = hpb_test_utils_get_instance_from_id(client_ids[i], HPB_UTILS_CLIENT_ID_TEST_SIZE);
+        hpb_network_remove_client(hpb->network, instance);
+        hype_instance_release(instance);
+    }
+}
+
+void hpb_test_relay_trees()
+{
+    HypePubSub *hpb = hpb_get();
+    HypeInstance *subscribers[20];
+    size_t n_subscribers = sizeof(subscribers) / sizeof(subscribers[0]);
+    HpbPublishOrigin origin = {1, 1};
+
+    hpb_set_shards(0);
+    for(size_t i = 0; i < n_subscribers; i++)
+    {
+        HLByte id[HPB_UTILS_CLIENT_ID_TEST_SIZE] = {0};
+        binary_utils_write_uint32(id, (uint32_t) (0x90000000 + i));
+        subscribers[i] = hpb_test_utils_get_instance_from_id(id, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+        CU_ASSERT(hpb_process_subscribe_req(HPB_TEST_SERVICE1, subscribers[i]) == 0);
+    }
+
+    // Without relay trees every subscriber is sent to, and with them only the relays
+    size_t n_tracked = hpb->retry_queue->n_entries;
+    CU_ASSERT(hpb_process_publish_req(HPB_TEST_SERVICE1, origin, "on", 2) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + n_subscribers);
+
+    CU_ASSERT(hpb_set_relay_branching(HPB_RELAY_TREE_MAX_BRANCHING + 1) == -1);
+    CU_ASSERT(hpb_set_relay_branching(4) == 0);
+    uint64_t n_relay_trees = hpb->n_relay_trees;
+    n_tracked = hpb->retry_queue->n_entries;
+    origin.publisher_seq++;
+    CU_ASSERT(hpb_process_publish_req(HPB_TEST_SERVICE1, origin, "on", 2) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 4);
+    CU_ASSERT(hpb->n_relay_trees == n_relay_trees + 1);
+
+    // A relay forwards the message to a relay per branch of its subtree
+    uint64_t n_relay_forwards = hpb->n_relay_forwards;
+    CU_ASSERT(hpb_process_relay_req(HPB_TEST_SERVICE2, 1, origin, 4, subscribers, 6, "on", 2) == 0);
+    CU_ASSERT(hpb->n_relay_forwards == n_relay_forwards + 4);
+    CU_ASSERT(hpb_process_relay_req(HPB_TEST_SERVICE2, 2, origin, 0, subscribers, 6, "on", 2) == -1);
+
+    CU_ASSERT(hpb_set_relay_branching(0) == 0);
+    hpb_set_shards(HPB_SHARDING_DEFAULT_SHARDS);
+    for(size_t i = 0; i < n_subscribers; i++)
+    {
+        hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, subscribers[i]);
+        hype_instance_release(subscribers[i]);
+    }
+}
+
+void hpb_test_direct_publish()
+{
+    HypePubSub *hpb = hpb_get();
+    HypeInstance *subscriber1 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *subscriber2 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT2, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *publisher = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT3, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+
+    // Services without subscribers are refused, and the others get their list
+    size_t n_tracked = hpb->retry_queue->n_entries;
+    CU_ASSERT(hpb_process_subscriber_list_req(HPB_TEST_SERVICE1, publisher) == -1);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 1);
+    CU_ASSERT(hpb_process_subscribe_req(HPB_TEST_SERVICE1, subscriber1) == 0);
+    CU_ASSERT(hpb_process_subscriber_list_req(HPB_TEST_SERVICE1, publisher) == 0);
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    CU_ASSERT(service->direct_publishers->size == 1);
+
+    // Each change of the subscribers is pushed to the publishers at once
+    uint32_t version = service->subscribers_version;
+    n_tracked = hpb->retry_queue->n_entries;
+    CU_ASSERT(hpb_process_subscribe_req(HPB_TEST_SERVICE1, subscriber2) == 0);
+    CU_ASSERT(service->subscribers_version == version + 1);
+    CU_ASSERT(service->pushed_version == service->subscribers_version);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 1);
+    CU_ASSERT(hpb_process_subscribe_req(HPB_TEST_SERVICE1, subscriber2) == 0);
+    CU_ASSERT(service->subscribers_version == version + 1);
+
+    // The publishers cannot evaluate filters, so they are refused and dropped
+    CU_ASSERT(hpb_process_filter_req(HPB_TEST_SERVICE1, "level >= 3", subscriber2) == 0);
+    CU_ASSERT(service->direct_publishers->size == 0);
+    CU_ASSERT(hpb_process_subscriber_list_req(HPB_TEST_SERVICE1, publisher) == -1);
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, subscriber1);
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, subscriber2);
+
+    // The publisher side needs a service managed by another client
+    hpb_network_add_client(hpb->network, publisher);
+    char service_name[32];
+    HLByte service_key[SHA1_BLOCK_SIZE];
+    for(int i = 0; ; i++)
+    {
+        snprintf(service_name, sizeof(service_name), "direct%i", i);
+        sha1_digest((const BYTE *) service_name, strlen(service_name), service_key);
+        if(!hpb_client_is_instance_equal(hpb->network->own_client, hpb_network_get_service_manager_id(hpb->network, service_key))) {
+            break;
+        }
+    }
+    HypeInstance *manager = hpb_network_get_service_manager_id(hpb->network, service_key);
+
+    // Messages go through the manager until it pushes the subscribers
+    n_tracked = hpb->retry_queue->n_entries;
+    CU_ASSERT(hpb_set_direct_publish(service_name, true) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 1);
+    CU_ASSERT(hpb_issue_publish_req(service_name, "on", 2) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 2);
+    CU_ASSERT(hpb->n_direct_publishes == 0);
+
+    HypeInstance *subscribers[2] = {subscriber1, subscriber2};
+    CU_ASSERT(hpb_process_subscriber_list_msg(service_key, 5, false, subscribers, 2, subscriber1) == -1);
+    CU_ASSERT(hpb_process_subscriber_list_msg(service_key, 5, false, subscribers, 2, manager) == 0);
+    CU_ASSERT(hpb_process_subscriber_list_msg(service_key, 4, false, subscribers, 1, manager) == -1);
+    n_tracked = hpb->retry_queue->n_entries;
+    CU_ASSERT(hpb_issue_publish_req(service_name, "on", 2) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 2);
+    CU_ASSERT(hpb->n_direct_publishes == 1);
+
+    // Retained messages and refused services go through the manager
+    n_tracked = hpb->retry_queue->n_entries;
+    CU_ASSERT(hpb_issue_retained_publish_req(service_name, "on", 2) == 0);
+    CU_ASSERT(hpb_process_subscriber_list_msg(service_key, 6, true, NULL, 0, manager) == 0);
+    CU_ASSERT(hpb_issue_publish_req(service_name, "on", 2) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 2);
+    CU_ASSERT(hpb->n_direct_publishes == 1);
+
+    CU_ASSERT(hpb_set_direct_publish(service_name, false) == 0);
+    CU_ASSERT(hpb_set_direct_publish(service_name, false) == -1);
+    CU_ASSERT(hpb_set_direct_publish("site1/+/temperature", true) == -1);
+
+    hpb_network_remove_client(hpb->network, publisher);
+    hype_instance_release(subscriber1);
+    hype_instance_release(subscriber2);
+    hype_instance_release(publisher);
+}
+
+void hpb_test_local_delivery()
+{
+    HypePubSub *hpb = hpb_get();
+    HypeInstance *subscriber1 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT1, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+    HypeInstance *subscriber2 = hpb_test_utils_get_instance_from_id(HPB_TEST_CLIENT2, HPB_UTILS_CLIENT_ID_TEST_SIZE);
+
+    // The manager does not send the message back to the subscriber which published it
+    hpb_process_subscribe_req(HPB_TEST_SERVICE1, subscriber1);
+    hpb_process_subscribe_req(HPB_TEST_SERVICE1, subscriber2);
+    HpbServiceManager *service = hpb_list_service_managers_find(hpb->managed_services, HPB_TEST_SERVICE1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(service);
+    HpbPublishOrigin origin = {binary_utils_read_uint32(hpb_list_clients_find(service->subscribers, subscriber1)->key), 1};
+
+    size_t n_tracked = hpb->retry_queue->n_entries;
+    CU_ASSERT(hpb_process_no_echo_publish_req(HPB_TEST_SERVICE1, origin, "on", 2, false, subscriber1) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 1);
+    CU_ASSERT(hpb->n_echoes_suppressed == 1);
+    origin.publisher_seq++;
+    CU_ASSERT(hpb_process_publish_req(HPB_TEST_SERVICE1, origin, "on", 2) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 3);
+    CU_ASSERT(hpb->n_echoes_suppressed == 1);
+
+    // The publisher is the instance which sent the request, whatever the tag of the origin
+    origin.publisher_seq++;
+    CU_ASSERT(hpb_process_no_echo_publish_req(HPB_TEST_SERVICE1, origin, "on", 2, false, subscriber2) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 4);
+    CU_ASSERT(hpb->n_echoes_suppressed == 2);
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, subscriber1);
+    hpb_process_unsubscribe_req(HPB_TEST_SERVICE1, subscriber2);
+
+    // The publisher side needs a service managed by another client
+    hpb_network_add_client(hpb->network, subscriber1);
+    char service_name[32];
+    HLByte service_key[SHA1_BLOCK_SIZE];
+    for(int i = 0; ; i++)
+    {
+        snprintf(service_name, sizeof(service_name), "local%i", i);
+        sha1_digest((const BYTE *) service_name, strlen(service_name), service_key);
+        if(!hpb_client_is_instance_equal(hpb->network->own_client, hpb_network_get_service_manager_id(hpb->network, service_key))) {
+            break;
+        }
+    }
+
+    // The own subscription gets the message when it is published, and the manager is asked not to echo it
+    CU_ASSERT(hpb_issue_subscribe_req(service_name) == 0);
+    HpbSubscription *subs = hpb_list_subscriptions_find(hpb->own_subscriptions, service_key);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(subs);
+    n_tracked = hpb->retry_queue->n_entries;
+    CU_ASSERT(hpb_issue_publish_req(service_name, "on", 2) == 0);
+    CU_ASSERT(hpb->retry_queue->n_entries == n_tracked + 1);
+    CU_ASSERT(hpb->n_local_deliveries == 1);
+    CU_ASSERT(subs->n_unechoed == 1);
+
+    // The sequence number skipped by the manager is not a missing message, but the following gaps are
+    HpbPublishOrigin other_origin = {0x01020304, 1};
+    CU_ASSERT(hpb_process_sequenced_info_msg(service_key, 10, other_origin, "on", 3) == 0);
+    other_origin.publisher_seq++;
+    CU_ASSERT(hpb_process_sequenced_info_msg(service_key, 12, other_origin, "on", 3) == 0);
+    CU_ASSERT(subs->n_unechoed == 0);
+    CU_ASSERT(subs->gap_detected_ms == 0);
+    other_origin.publisher_seq++;
+    CU_ASSERT(hpb_process_sequenced_info_msg(service_key, 14, other_origin, "on", 3) == 0);
+    CU_ASSERT(subs->gap_detected_ms != 0);
+
+    // An echo sent anyway, e.g. after a handover, is suppressed as a duplicate
+    CU_ASSERT(hpb_issue_publish_req(service_name, "on", 2) == 0);
+    CU_ASSERT(subs->n_unechoed == 1);
+    HpbPublishOrigin own_origin = {hpb->publisher_tag, hpb->next_publisher_seq - 1};
+    CU_ASSERT(hpb_process_sequenced_info_msg(service_key, 15, own_origin, "on", 3) == -2);
+    CU_ASSERT(subs->n_unechoed == 0);
+
+    CU_ASSERT(hpb_issue_unsubscribe_req(service_name) == 0);
+    hpb_network_remove_client(hpb->network, subscriber1);
+    hype_instance_release(subscriber1);
+    hype_instance_release(subscriber2);
 }